@@ -31,12 +31,14 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <elf.h>
+#include <linux/auxvec.h>
 #include <asm/page.h>
 #include "pthread_internal.h"
 #include "atexit.h"
 #include "libc_init_common.h"
 
 #include <bionic_tls.h>
+#include <bionic_cpu_features.h>
 #include <errno.h>
 
 extern unsigned __get_sp(void);
@@ -52,16 +54,63 @@ unsigned int __page_shift = PAGE_SHIFT;
 
 int __system_properties_init(void);
 
+unsigned __libc_cpu_features;
+
+/* from the kernel's asm/hwcap.h on ARM */
+#define HWCAP_NEON  (1 << 12)
+
+void __libc_init_cpu_features(uintptr_t* auxv)
+{
+    unsigned features = 0;
+
+#if defined(__arm__)
+    /* the kernel reports the NEON unit through AT_HWCAP */
+    for ( ; auxv[0] != AT_NULL; auxv += 2) {
+        if (auxv[0] == AT_HWCAP) {
+            if (auxv[1] & HWCAP_NEON)
+                features |= BIONIC_CPU_ARM_NEON;
+            break;
+        }
+    }
+#elif defined(__i386__)
+    {
+        unsigned eax, ebx, ecx, edx;
+
+        /* %ebx may hold the GOT pointer, so save it around cpuid */
+        __asm__ __volatile__ ("xchgl %%ebx, %1\n"
+                              "cpuid\n"
+                              "xchgl %%ebx, %1\n"
+                              : "=a"(eax), "=r"(ebx), "=c"(ecx), "=d"(edx)
+                              : "0"(1));
+        if (edx & (1 << 26))
+            features |= BIONIC_CPU_X86_SSE2;
+        if (ecx & (1 << 9))
+            features |= BIONIC_CPU_X86_SSSE3;
+    }
+#endif
+
+    __libc_cpu_features = features;
+}
+
 void __libc_init_common(uintptr_t *elfdata)
 {
     int     argc = *elfdata;
     char**  argv = (char**)(elfdata + 1);
     char**  envp = argv + argc + 1;
+    char**  auxv;
 
     pthread_attr_t             thread_attr;
     static pthread_internal_t  thread;
     static void*               tls_area[BIONIC_TLS_SLOTS];
 
+    /* the auxiliary vector follows the environment, detect the CPU
+     * features and the vDSO first so that everything after can rely
+     * on them */
+    for (auxv = envp; *auxv != NULL; auxv++)
+        ;
+    __libc_init_cpu_features((uintptr_t*)(auxv + 1));
+    __libc_init_vdso((uintptr_t*)(auxv + 1));
+
     /* setup pthread runtime and main thread descriptor */
     unsigned stacktop = (__get_sp() & ~(PAGE_SIZE - 1)) + PAGE_SIZE;
     unsigned stacksize = 128 * 1024;
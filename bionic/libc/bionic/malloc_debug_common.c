@@ -238,6 +238,8 @@ void* memalign(size_t alignment, size_t bytes) {
 #ifndef LIBC_STATIC
 #include <sys/system_properties.h>
 #include <dlfcn.h>
+#include <errno.h>
+#include <string.h>
 #include "logd.h"
 
 // =============================================================================
@@ -288,6 +290,172 @@ static void* libc_malloc_impl_handle = NULL;
 #define MALLOC_ALIGNMENT ((size_t)8U)
 #endif  /* MALLOC_ALIGNMENT */
 
+// =============================================================================
+// per-thread allocation cache
+// =============================================================================
+
+/* Small blocks freed by a thread are kept on free lists private to that
+ * thread, one per 8-byte size class, and handed out again by its next
+ * malloc of that class without taking the dlmalloc lock. The cached blocks
+ * stay allocated as far as dlmalloc is concerned, so realloc, memalign and
+ * malloc_usable_size work on them unchanged. A list that grows past its
+ * limit returns half of its blocks to dlmalloc, and a thread's lists are
+ * emptied when it exits.
+ *
+ * Enabled with the libc.malloc.thread_cache system property. The debug
+ * levels above take precedence, since they need to see every free.
+ */
+#define TCACHE_GRANULE      8
+#define TCACHE_NUM_CLASSES  32                      /* blocks up to 256 bytes */
+#define TCACHE_MAX_SIZE     (TCACHE_NUM_CLASSES * TCACHE_GRANULE)
+#define TCACHE_CLASS_BYTES  2048                    /* cached bytes per class */
+
+typedef struct TCacheBlock TCacheBlock;
+struct TCacheBlock {
+    TCacheBlock* next;
+};
+
+typedef struct ThreadCache ThreadCache;
+struct ThreadCache {
+    TCacheBlock* lists[TCACHE_NUM_CLASSES + 1];     /* indexed by size / 8 */
+    unsigned int counts[TCACHE_NUM_CLASSES + 1];
+};
+
+static pthread_key_t gThreadCacheKey;
+
+static unsigned int tcache_limit(size_t cls)
+{
+    return TCACHE_CLASS_BYTES / (cls * TCACHE_GRANULE);
+}
+
+static ThreadCache* tcache_get(void)
+{
+    ThreadCache* tc = (ThreadCache*)pthread_getspecific(gThreadCacheKey);
+    if (tc == NULL) {
+        tc = (ThreadCache*)dlcalloc(1, sizeof(*tc));
+        if (tc != NULL) {
+            pthread_setspecific(gThreadCacheKey, tc);
+        }
+    }
+    return tc;
+}
+
+/* Give blocks of one class back to dlmalloc until only "keep" are left. */
+static void tcache_release(ThreadCache* tc, size_t cls, unsigned int keep)
+{
+    while (tc->counts[cls] > keep) {
+        TCacheBlock* block = tc->lists[cls];
+        tc->lists[cls] = block->next;
+        tc->counts[cls]--;
+        dlfree(block);
+    }
+}
+
+/* TLS destructor, called when a thread exits. */
+static void tcache_destroy(void* arg)
+{
+    ThreadCache* tc = (ThreadCache*)arg;
+    size_t cls;
+
+    for (cls = 1; cls <= TCACHE_NUM_CLASSES; cls++) {
+        tcache_release(tc, cls, 0);
+    }
+    dlfree(tc);
+}
+
+static void* tc_malloc(size_t bytes)
+{
+    if (bytes <= TCACHE_MAX_SIZE) {
+        size_t cls = (bytes + TCACHE_GRANULE - 1) / TCACHE_GRANULE;
+        ThreadCache* tc;
+
+        if (cls == 0) {
+            cls = 1;
+        }
+        tc = tcache_get();
+        if (tc != NULL && tc->lists[cls] != NULL) {
+            TCacheBlock* block = tc->lists[cls];
+            tc->lists[cls] = block->next;
+            tc->counts[cls]--;
+            return block;
+        }
+        /* round up so the block can be reused for the whole class */
+        return dlmalloc(cls * TCACHE_GRANULE);
+    }
+    return dlmalloc(bytes);
+}
+
+static void tc_free(void* mem)
+{
+    size_t cls;
+    ThreadCache* tc;
+    TCacheBlock* block;
+
+    if (mem == NULL) {
+        return;
+    }
+
+    /* a block is filed under the largest class it can fully satisfy */
+    cls = dlmalloc_usable_size(mem) / TCACHE_GRANULE;
+    if (cls == 0 || cls > TCACHE_NUM_CLASSES || (tc = tcache_get()) == NULL) {
+        dlfree(mem);
+        return;
+    }
+
+    block = (TCacheBlock*)mem;
+    block->next = tc->lists[cls];
+    tc->lists[cls] = block;
+    if (++tc->counts[cls] > tcache_limit(cls)) {
+        tcache_release(tc, cls, tcache_limit(cls) / 2);
+    }
+}
+
+static void* tc_calloc(size_t n_elements, size_t elem_size)
+{
+    size_t bytes;
+    void* mem;
+
+    if (n_elements != 0 && elem_size > (size_t)-1 / n_elements) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    bytes = n_elements * elem_size;
+    if (bytes > TCACHE_MAX_SIZE) {
+        return dlcalloc(n_elements, elem_size);
+    }
+    mem = tc_malloc(bytes);
+    if (mem != NULL) {
+        memset(mem, 0, bytes);
+    }
+    return mem;
+}
+
+static void* tc_realloc(void* oldMem, size_t bytes)
+{
+    if (oldMem == NULL) {
+        return tc_malloc(bytes);
+    }
+    return dlrealloc(oldMem, bytes);
+}
+
+/* Switches the dispatch table over to the thread cache. */
+static void thread_cache_init(void)
+{
+    if (pthread_key_create(&gThreadCacheKey, tcache_destroy) != 0) {
+        error_log("%s: Unable to create malloc thread cache key\n",
+                  __progname);
+        return;
+    }
+
+    gMallocUse.malloc = tc_malloc;
+    gMallocUse.free = tc_free;
+    gMallocUse.calloc = tc_calloc;
+    gMallocUse.realloc = tc_realloc;
+    gMallocUse.memalign = dlmemalign;
+    __libc_malloc_dispatch = &gMallocUse;
+    info_log("%s: using malloc thread cache\n", __progname);
+}
+
 /* Initializes memory allocation framework once per process. */
 static void malloc_init_impl(void)
 {
@@ -322,6 +490,10 @@ static void malloc_init_impl(void)
     /* Debug level 0 means that we should use dlxxx allocation
      * routines (default). */
     if (!debug_level) {
+        if (__system_property_get("libc.malloc.thread_cache", env) &&
+                atoi(env)) {
+            thread_cache_init();
+        }
         return;
     }
 
@@ -29,6 +29,7 @@
 #include <linux/time.h>
 #include <string.h>
 #include <errno.h>
+#include <unistd.h>
 
 /* This file implements the support required to implement SIGEV_THREAD posix 
  * timers. See the following pages for additionnal details:
@@ -38,9 +39,15 @@
  * www.opengroup.org/onlinepubs/000095399/functions/xsh_chap02_04.html#tag_02_04_01
  *
  * The Linux kernel doesn't support these, so we need to implement them in the
- * C library. We use a very basic scheme where each timer is associated to a
- * thread that will loop, waiting for timeouts or messages from the program
- * corresponding to calls to timer_settime() and timer_delete().
+ * C library. All SIGEV_THREAD timers of a process are multiplexed on a single
+ * dispatch thread, created with the first such timer. It sleeps until the
+ * earliest expiration, or until timer_settime(), timer_delete() or
+ * __timer_table_start_stop() changes the table, and then runs the callbacks
+ * of all expired timers in turn. Timers expiring within TIMER_SLACK_NS of
+ * each other are handled by the same wake-up.
+ *
+ * Since callbacks share the dispatch thread, sigev_notify_attributes is
+ * ignored and a callback that blocks delays the other timers.
  *
  * Note also an important thing: Posix mandates that in the case of fork(),
  * the timers of the child process should be disarmed, but not deleted.
@@ -49,7 +56,8 @@
  * or in the parent process.
  *
  * the stop/start is implemented by the __timer_table_start_stop() function
- * below.
+ * below. The dispatch thread doesn't survive the fork either, so the child
+ * starts a new one when it creates its first timer.
  */
 
 /* normal (i.e. non-SIGEV_THREAD) timer ids are created directly by the kernel
@@ -69,8 +77,7 @@
 
 /* this value is used internally to indicate a 'free' or 'zombie' 
  * thr_timer structure. Here, 'zombie' means that timer_delete()
- * has been called, but that the corresponding thread hasn't
- * exited yet.
+ * has been called while the timer's callback was running.
  */
 #define  TIMER_ID_NONE            ((timer_t)0xffffffff)
 
@@ -80,6 +87,9 @@
 /* the maximum value of overrun counters */
 #define  DELAYTIMER_MAX    0x7fffffff
 
+/* expirations this close to the earliest one are handled together */
+#define  TIMER_SLACK_NS    1000000
+
 #define  __likely(x)   __builtin_expect(!!(x),1)
 #define  __unlikely(x) __builtin_expect(!!(x),0)
 
@@ -90,31 +100,28 @@ typedef struct thr_timer_table    thr_timer_table_t;
  * it's really a 'union sigval' a.k.a. sigval_t */
 typedef void (*thr_timer_func_t)( sigval_t );
 
+/* all fields are protected by the table lock */
 struct thr_timer {
     thr_timer_t*       next;     /* next in free list */
     timer_t            id;       /* TIMER_ID_NONE iff free or dying */
     clockid_t          clock;
-    pthread_t          thread;
-    pthread_attr_t     attributes;
     thr_timer_func_t   callback;
     sigval_t           value;
 
-    /* the following are used to communicate between
-     * the timer thread and the timer_XXX() functions
-     */
-    pthread_mutex_t           mutex;     /* lock */
-    pthread_cond_t            cond;      /* signal a state change to thread */
-    int volatile              done;      /* set by timer_delete */
-    int volatile              stopped;   /* set by _start_stop() */
-    struct timespec volatile  expires;   /* next expiration time, or 0 */
-    struct timespec volatile  period;    /* reload value, or 0 */
-    int volatile              overruns;  /* current number of overruns */
+    int                done;     /* set by timer_delete */
+    int                stopped;  /* set by _start_stop() */
+    int                running;  /* callback in progress */
+    struct timespec    expires;  /* next expiration time, or 0 */
+    struct timespec    period;   /* reload value, or 0 */
+    int                overruns; /* current number of overruns */
 };
 
-#define  MAX_THREAD_TIMERS  32
+#define  MAX_THREAD_TIMERS  128
 
 struct thr_timer_table {
     pthread_mutex_t  lock;
+    pthread_cond_t   cond;        /* signal a state change to the dispatcher */
+    pid_t            dispatcher;  /* process running the dispatcher, or 0 */
     thr_timer_t*     free_timer;
     thr_timer_t      timers[ MAX_THREAD_TIMERS ];
 };
@@ -129,6 +136,7 @@ thr_timer_table_init( thr_timer_table_t*  t )
 
     memset(t, 0, sizeof *t);
     pthread_mutex_init( &t->lock, NULL );
+    pthread_cond_init( &t->cond, NULL );
 
     for (nn = 0; nn < MAX_THREAD_TIMERS; nn++)
         t->timers[nn].id = TIMER_ID_NONE;
@@ -139,22 +147,19 @@ thr_timer_table_init( thr_timer_table_t*  t )
 }
 
 
+/* the following functions must be called with the table lock held */
+
 static thr_timer_t*
 thr_timer_table_alloc( thr_timer_table_t*  t )
 {
     thr_timer_t*  timer;
 
-    if (t == NULL)
-        return NULL;
-
-    pthread_mutex_lock(&t->lock);
     timer = t->free_timer;
     if (timer != NULL) {
         t->free_timer = timer->next;
         timer->next   = NULL;
         timer->id     = TIMER_ID_WRAP((timer - t->timers));
     }
-    pthread_mutex_unlock(&t->lock);
     return timer;
 }
 
@@ -162,12 +167,9 @@ thr_timer_table_alloc( thr_timer_table_t*  t )
 static void
 thr_timer_table_free( thr_timer_table_t*  t, thr_timer_t*  timer )
 {
-    pthread_mutex_lock( &t->lock );
     timer->id     = TIMER_ID_NONE;
-    timer->thread = 0;
     timer->next   = t->free_timer;
     t->free_timer = timer;
-    pthread_mutex_unlock( &t->lock );
 }
 
 
@@ -181,14 +183,12 @@ thr_timer_table_start_stop( thr_timer_table_t*  t, int  stop )
     for (nn = 0; nn < MAX_THREAD_TIMERS; nn++) {
         thr_timer_t*  timer  = &t->timers[nn];
 
-        if (TIMER_ID_IS_VALID(timer->id)) {
-            /* tell the thread to start/stop */
-            pthread_mutex_lock(&timer->mutex);
+        if (TIMER_ID_IS_VALID(timer->id))
             timer->stopped = stop;
-            pthread_cond_signal( &timer->cond );
-            pthread_mutex_unlock(&timer->mutex);
-        }
     }
+
+    /* tell the dispatcher to start/stop */
+    pthread_cond_signal( &t->cond );
     pthread_mutex_unlock(&t->lock);
 }
 
@@ -198,33 +198,22 @@ thr_timer_table_start_stop( thr_timer_table_t*  t, int  stop )
  */
 static thr_timer_t*
 thr_timer_table_from_id( thr_timer_table_t*  t,
-                         timer_t             id,
-                         int                 remove )
+                         timer_t             id )
 {
     unsigned      index;
     thr_timer_t*  timer;
 
-    if (t == NULL || !TIMER_ID_IS_WRAPPED(id))
+    if (!TIMER_ID_IS_WRAPPED(id))
         return NULL;
 
     index = (unsigned) TIMER_ID_UNWRAP(id);
     if (index >= MAX_THREAD_TIMERS)
         return NULL;
 
-    pthread_mutex_lock(&t->lock);
-
     timer = &t->timers[index];
 
-    if (!TIMER_ID_IS_VALID(timer->id)) {
-        timer = NULL;
-    } else {
-        /* if we're removing this timer, clear the id
-         * right now to prevent another thread to
-         * use the same id after the unlock */
-        if (remove)
-            timer->id = TIMER_ID_NONE;
-    }
-    pthread_mutex_unlock(&t->lock);
+    if (!TIMER_ID_IS_VALID(timer->id))
+        return NULL;
 
     return timer;
 }
@@ -269,26 +258,29 @@ __timer_table_start_stop( int  stop )
     }
 }
 
+/* lock the table and return the timer corresponding to a wrapped id,
+ * or NULL (with the table unlocked) if there is none */
 static thr_timer_t*
-thr_timer_from_id( timer_t   id )
+thr_timer_lock_from_id( timer_t   id )
 {
     thr_timer_table_t*  table = __timer_table_get();
-    thr_timer_t*        timer = thr_timer_table_from_id( table, id, 0 );
+    thr_timer_t*        timer;
 
-    return timer;
-}
+    if (table == NULL)
+        return NULL;
 
+    pthread_mutex_lock(&table->lock);
+    timer = thr_timer_table_from_id( table, id );
+    if (timer == NULL)
+        pthread_mutex_unlock(&table->lock);
 
-static __inline__ void
-thr_timer_lock( thr_timer_t*  t )
-{
-    pthread_mutex_lock(&t->mutex);
+    return timer;
 }
 
 static __inline__ void
-thr_timer_unlock( thr_timer_t*  t )
+thr_timer_unlock( void )
 {
-    pthread_mutex_unlock(&t->mutex);
+    pthread_mutex_unlock(&__timer_table->lock);
 }
 
 /** POSIX TIMERS APIs */
@@ -302,6 +294,31 @@ extern int __timer_getoverrun(timer_t);
 
 static void*  timer_thread_start( void* );
 
+/* start the dispatch thread if this process doesn't have one yet,
+ * called with the table lock held */
+static int
+thr_timer_table_start_dispatcher( thr_timer_table_t*  t )
+{
+    pthread_attr_t  attr;
+    pthread_t       thread;
+    pid_t           pid = getpid();
+    int             ret;
+
+    if (t->dispatcher == pid)
+        return 0;
+
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+
+    ret = pthread_create( &thread, &attr, timer_thread_start, t );
+    pthread_attr_destroy(&attr);
+    if (ret != 0)
+        return -1;
+
+    t->dispatcher = pid;
+    return 0;
+}
+
 /* then the wrappers themselves */
 int
 timer_create( clockid_t  clockid, struct sigevent*  evp, timer_t  *ptimerid)
@@ -324,52 +341,41 @@ timer_create( clockid_t  clockid, struct sigevent*  evp, timer_t  *ptimerid)
             return -1;
     }
 
-    /* create a new timer and its thread */
+    /* create a new timer, and the dispatch thread if needed */
     {
         thr_timer_table_t*  table = __timer_table_get();
-        thr_timer_t*        timer = thr_timer_table_alloc( table );
-        struct sigevent     evp0;
+        thr_timer_t*        timer;
 
-        if (timer == NULL) {
+        if (table == NULL) {
             errno = ENOMEM;
             return -1;
         }
 
-        /* copy the thread attributes */
-        if (evp->sigev_notify_attributes == NULL) {
-            pthread_attr_init(&timer->attributes);
-        }
-        else {
-            timer->attributes = ((pthread_attr_t*)evp->sigev_notify_attributes)[0];
-        }
+        pthread_mutex_lock(&table->lock);
 
-        /* Posix says that the default is PTHREAD_CREATE_DETACHED and
-         * that PTHREAD_CREATE_JOINABLE has undefined behaviour.
-         * So simply always use DETACHED :-)
-         */
-        pthread_attr_setdetachstate(&timer->attributes, PTHREAD_CREATE_DETACHED);
+        timer = thr_timer_table_alloc( table );
+        if (timer == NULL || thr_timer_table_start_dispatcher( table ) < 0) {
+            if (timer != NULL)
+                thr_timer_table_free( table, timer );
+            pthread_mutex_unlock(&table->lock);
+            errno = ENOMEM;
+            return -1;
+        }
 
         timer->callback = evp->sigev_notify_function;
         timer->value    = evp->sigev_value;
         timer->clock    = clockid;
 
-        pthread_mutex_init( &timer->mutex, NULL );
-        pthread_cond_init( &timer->cond, NULL );
-
         timer->done           = 0;
         timer->stopped        = 0;
+        timer->running        = 0;
         timer->expires.tv_sec = timer->expires.tv_nsec = 0;
         timer->period.tv_sec  = timer->period.tv_nsec  = 0;
         timer->overruns       = 0;
 
-        /* create the thread */
-        if (pthread_create( &timer->thread, &timer->attributes, timer_thread_start, timer ) < 0) {
-            thr_timer_table_free( __timer_table, timer );
-            errno = ENOMEM;
-            return -1;
-        }
-
         *ptimerid = timer->id;
+
+        pthread_mutex_unlock(&table->lock);
         return 0;
     }
 }
@@ -382,25 +388,25 @@ timer_delete( timer_t  id )
         return __timer_delete( id );
     else
     {
-        thr_timer_table_t*  table = __timer_table_get();
-        thr_timer_t*        timer = thr_timer_table_from_id(table, id, 1);
+        thr_timer_t*  timer = thr_timer_lock_from_id(id);
 
         if (timer == NULL) {
             errno = EINVAL;
             return -1;
         }
 
-        /* tell the timer's thread to stop */
-        thr_timer_lock(timer);
-        timer->done = 1;
-        pthread_cond_signal( &timer->cond );
-        thr_timer_unlock(timer);
-
-        /* NOTE: the thread will call __timer_table_free() to free the
-         * timer object. the '1' parameter to thr_timer_table_from_id
-         * above ensured that the object and its timer_id cannot be
-         * reused before that.
+        /* if the callback is running, the dispatcher frees the timer
+         * once it returns. clearing the id right now prevents another
+         * thread from using it in the meantime
          */
+        if (timer->running) {
+            timer->done = 1;
+            timer->id   = TIMER_ID_NONE;
+        } else {
+            thr_timer_table_free( __timer_table, timer );
+        }
+        pthread_cond_signal( &__timer_table->cond );
+        thr_timer_unlock();
         return 0;
     }
 }
@@ -443,15 +449,14 @@ timer_gettime( timer_t  id, struct itimerspec*  ospec )
     if ( __likely(!TIMER_ID_IS_WRAPPED(id)) ) {
         return __timer_gettime( id, ospec );
     } else {
-        thr_timer_t*  timer = thr_timer_from_id(id);
+        thr_timer_t*  timer = thr_timer_lock_from_id(id);
 
         if (timer == NULL) {
             errno = EINVAL;
             return -1;
         }
-        thr_timer_lock(timer);
         timer_gettime_internal( timer, ospec );
-        thr_timer_unlock(timer);
+        thr_timer_unlock();
     }
     return 0;
 }
@@ -471,14 +476,13 @@ timer_settime( timer_t                   id,
     if ( __likely(!TIMER_ID_IS_WRAPPED(id)) ) {
         return __timer_settime( id, flags, spec, ospec );
     } else {
-        thr_timer_t*        timer = thr_timer_from_id(id);
+        thr_timer_t*        timer = thr_timer_lock_from_id(id);
         struct timespec     expires, now;
 
         if (timer == NULL) {
             errno = EINVAL;
             return -1;
         }
-        thr_timer_lock(timer);
 
         /* return current timer value if ospec isn't NULL */
         if (ospec != NULL) {
@@ -500,10 +504,10 @@ timer_settime( timer_t                   id,
         }
         timer->expires = expires;
         timer->period  = spec->it_interval;
-        thr_timer_unlock( timer );
 
-        /* signal the change to the thread */
-        pthread_cond_signal( &timer->cond );
+        /* signal the change to the dispatcher */
+        pthread_cond_signal( &__timer_table->cond );
+        thr_timer_unlock();
     }
     return 0;
 }
@@ -515,7 +519,7 @@ timer_getoverrun(timer_t  id)
     if ( __likely(!TIMER_ID_IS_WRAPPED(id)) ) {
         return __timer_getoverrun( id );
     } else {
-        thr_timer_t*  timer = thr_timer_from_id(id);
+        thr_timer_t*  timer = thr_timer_lock_from_id(id);
         int           result;
 
         if (timer == NULL) {
@@ -523,117 +527,150 @@ timer_getoverrun(timer_t  id)
             return -1;
         }
 
-        thr_timer_lock(timer);
         result = timer->overruns;
-        thr_timer_unlock(timer);
+        thr_timer_unlock();
 
         return result;
     }
 }
 
 
+/* reload or disarm a timer that just expired, counting the periods
+ * that were missed. called with the table lock held */
+static void
+thr_timer_expire( thr_timer_t*  timer, const struct timespec*  now )
+{
+    struct timespec  expires = timer->expires;
+    struct timespec  period  = timer->period;
+
+    if (!timespec_is_zero( &period ) )
+    {
+        /* for periodic timers, compute total overrun count */
+        timer->overruns = 0;
+        do {
+            timespec_add( &expires, &period );
+            if (timer->overruns < DELAYTIMER_MAX)
+                timer->overruns += 1;
+        } while ( timespec_cmp( &expires, now ) <= 0 );
+
+        /* the expiration being handled now isn't an overrun */
+        timer->overruns -= 1;
+    }
+    else
+    {
+        /* for non-periodic timer, things are simple */
+        timespec_zero( &expires );
+    }
+    timer->expires = expires;
+}
+
+
 static void*
 timer_thread_start( void*  _arg )
 {
-    thr_timer_t*  timer = _arg;
+    thr_timer_table_t*  t = _arg;
+    struct timespec     deltas[ MAX_THREAD_TIMERS ];
 
-    thr_timer_lock( timer );
+    pthread_mutex_lock( &t->lock );
 
-    /* we loop until timer->done is set in timer_delete() */
-    while (!timer->done) 
+    /* the dispatcher never exits, it just sleeps when no timer is armed */
+    for (;;)
     {
-        struct timespec   expires = timer->expires;
-        struct timespec   period  = timer->period;
-        struct timespec   now;
-
-        /* if the timer is stopped or disarmed, wait indefinitely
-         * for a state change from timer_settime/_delete/_start_stop
-         */
-        if ( timer->stopped || timespec_is_zero(&expires) )
-        {
-            pthread_cond_wait( &timer->cond, &timer->mutex );
-            continue;
-        }
+        thr_timer_t*     fire = NULL;
+        struct timespec  fire_delta, now;
+        struct timespec  wait;
+        int              nn, armed = 0;
 
-        /* otherwise, we need to do a timed wait until either a
-        * state change of the timer expiration time.
-        */
-        clock_gettime(timer->clock, &now);
+        /* compute the time left until each armed timer expires, and pick
+         * the most overdue one among those that already have */
+        for (nn = 0; nn < MAX_THREAD_TIMERS; nn++) {
+            thr_timer_t*  timer = &t->timers[nn];
 
-        if (timespec_cmp( &expires, &now ) > 0)
-        {
-            /* cool, there was no overrun, so compute the
-             * relative timeout as 'expires - now', then wait
-             */
-            int              ret;
-            struct timespec  diff = expires;
-            timespec_sub( &diff, &now );
+            timespec_zero(&deltas[nn]);
 
-            ret = __pthread_cond_timedwait_relative(
-                        &timer->cond, &timer->mutex, &diff);
+            if (!TIMER_ID_IS_VALID(timer->id) || timer->stopped ||
+                timer->running || timespec_is_zero(&timer->expires))
+                continue;
 
-            /* if we didn't timeout, it means that a state change
-                * occured, so reloop to take care of it.
-                */
-            if (ret != ETIMEDOUT)
+            clock_gettime( timer->clock, &now );
+            deltas[nn] = timer->expires;
+            timespec_sub( &deltas[nn], &now );
+
+            if (timespec_cmp0( &deltas[nn] ) <= 0) {
+                if (fire == NULL || timespec_cmp( &deltas[nn], &fire_delta ) < 0) {
+                    fire       = timer;
+                    fire_delta = deltas[nn];
+                }
                 continue;
+            }
+
+            if (!armed || timespec_cmp( &deltas[nn], &wait ) < 0)
+                wait = deltas[nn];
+            armed = 1;
         }
-        else
+
+        if (fire != NULL)
         {
-            /* overrun was detected before we could wait ! */
-            if (!timespec_is_zero( &period ) )
-            {
-                /* for periodic timers, compute total overrun count */
-                do {
-                    timespec_add( &expires, &period );
-                    if (timer->overruns < DELAYTIMER_MAX)
-                        timer->overruns += 1;
-                } while ( timespec_cmp( &expires, &now ) < 0 );
-
-                /* backtrack the last one, because we're going to
-                 * add the same value just a bit later */
-                timespec_sub( &expires, &period );
-            }
-            else
-            {
-                /* for non-periodic timer, things are simple */
-                timer->overruns = 1;
+            clock_gettime( fire->clock, &now );
+            thr_timer_expire( fire, &now );
+
+            /* now call the timer callback function. release the
+             * lock to allow the function to modify the timer setting
+             * or call timer_getoverrun().
+             *
+             * NOTE: at this point we trust the callback not to be a
+             *       total moron and pthread_kill() the dispatch thread
+             */
+            fire->running = 1;
+            pthread_mutex_unlock( &t->lock );
+            fire->callback( fire->value );
+            pthread_mutex_lock( &t->lock );
+            fire->running = 0;
+
+            /* now clear the overruns counter. it only makes sense
+             * within the callback */
+            fire->overruns = 0;
+
+            /* timer_delete() was called from the callback or by
+             * another thread while it ran */
+            if (fire->done) {
+                fire->done = 0;
+                thr_timer_table_free( t, fire );
             }
+            continue;
         }
 
-        /* if we get there, a timeout was detected.
-         * first reload/disarm the timer has needed
+        /* if the table is empty or stopped, wait indefinitely for a
+         * state change from timer_settime/_delete/_start_stop
          */
-        if ( !timespec_is_zero(&period) ) {
-            timespec_add( &expires, &period );
-        } else {
-            timespec_zero( &expires );
+        if (!armed) {
+            pthread_cond_wait( &t->cond, &t->lock );
+            continue;
         }
-        timer->expires = expires;
 
-        /* now call the timer callback function. release the
-         * lock to allow the function to modify the timer setting
-         * or call timer_getoverrun().
-         *
-         * NOTE: at this point we trust the callback not to be a
-         *       total moron and pthread_kill() the timer thread
+        /* otherwise, sleep until the earliest expiration, pushed back to
+         * the latest one within TIMER_SLACK_NS of it so that they are
+         * all handled by a single wake-up
          */
-        thr_timer_unlock(timer);
-        timer->callback( timer->value );
-        thr_timer_lock(timer);
+        {
+            struct timespec  limit = wait;
 
-        /* now clear the overruns counter. it only makes sense
-         * within the callback */
-        timer->overruns = 0;
-    }
+            limit.tv_nsec += TIMER_SLACK_NS;
+            if (limit.tv_nsec >= 1000000000) {
+                limit.tv_sec  += 1;
+                limit.tv_nsec -= 1000000000;
+            }
 
-    thr_timer_unlock( timer );
+            for (nn = 0; nn < MAX_THREAD_TIMERS; nn++) {
+                if (timespec_cmp0( &deltas[nn] ) > 0 &&
+                    timespec_cmp( &deltas[nn], &wait ) > 0 &&
+                    timespec_cmp( &deltas[nn], &limit ) <= 0)
+                    wait = deltas[nn];
+            }
+        }
 
-    /* free the timer object now. there is no need to call
-     * __timer_table_get() since we're guaranteed that __timer_table
-     * is initialized in this thread
-     */
-    thr_timer_table_free(__timer_table, timer);
+        __pthread_cond_timedwait_relative( &t->cond, &t->lock, &wait );
+    }
 
     return NULL;
 }
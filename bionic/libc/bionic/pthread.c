@@ -907,6 +907,44 @@ int pthread_mutex_destroy(pthread_mutex_t *mutex)
 }
 
 
+/*
+ * Number of times a contending thread polls a normal mutex before it goes
+ * to sleep on the futex.  Most critical sections are much shorter than
+ * the cost of a futex wait/wake round trip, so on SMP it pays to wait a
+ * little for the owner running on another core.
+ */
+#if ANDROID_SMP != 0
+#define  MUTEX_SPIN_COUNT  100
+#else
+#define  MUTEX_SPIN_COUNT  0
+#endif
+
+/*
+ * Spin while a normal mutex is held without contention, trying to take it
+ * as soon as it is released.  Returns 0 if the lock was acquired.
+ *
+ * We only spin in state 1: in state 2 other threads are already asleep on
+ * the futex, the owner will have to wake one of them, and polling would
+ * just steal the lock from under the sleeper that is being woken.
+ */
+static __inline__ int
+_normal_lock_spin(pthread_mutex_t*  mutex, int  shared)
+{
+    int  spins;
+
+    for (spins = 0; spins < MUTEX_SPIN_COUNT; spins++) {
+        int  oldv = mutex->value;
+
+        if (oldv == (shared|0)) {
+            if (__atomic_cmpxchg(shared|0, shared|1, &mutex->value) == 0)
+                return 0;
+        } else if (oldv != (shared|1)) {
+            break;
+        }
+    }
+    return -1;
+}
+
 /*
  * Lock a non-recursive mutex.
  *
@@ -930,7 +968,8 @@ _normal_lock(pthread_mutex_t*  mutex)
      * if it made the swap successfully.  If the result is nonzero, this
      * lock is already held by another thread.
      */
-    if (__atomic_cmpxchg(shared|0, shared|1, &mutex->value ) != 0) {
+    if (__atomic_cmpxchg(shared|0, shared|1, &mutex->value ) != 0 &&
+        _normal_lock_spin(mutex, shared) != 0) {
         /*
          * We want to go to sleep until the mutex is available, which
          * requires promoting it to state 2.  We need to swap in the new
@@ -108,6 +108,28 @@ const prop_info *__system_property_find(const char *name)
     unsigned len = strlen(name);
     prop_info *pi;
 
+    if(count == 0) {
+        return 0;
+    }
+
+    if(pa->hash_buckets != 0) {
+        volatile unsigned short *chain = PROP_HASH_CHAIN(pa);
+        unsigned n;
+
+        n = PROP_HASH_TABLE(pa)[prop_name_hash(name, len) & (pa->hash_buckets - 1)];
+        while(n != 0) {
+            unsigned entry = toc[n - 1];
+            if(TOC_NAME_LEN(entry) == len) {
+                pi = TOC_TO_INFO(pa, entry);
+                if(!memcmp(name, pi->name, len)) {
+                    return pi;
+                }
+            }
+            n = chain[n - 1];
+        }
+        return 0;
+    }
+
     while(count--) {
         unsigned entry = *toc++;
         if(TOC_NAME_LEN(entry) != len) continue;
@@ -240,6 +262,14 @@ int __system_property_set(const char *key, const char *value)
     return 0;
 }
 
+unsigned __system_property_serial(const prop_info *pi)
+{
+    if(pi == 0) {
+        return __system_property_area__->serial;
+    }
+    return pi->serial;
+}
+
 int __system_property_wait(const prop_info *pi)
 {
     unsigned n;
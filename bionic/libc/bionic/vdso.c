@@ -0,0 +1,163 @@
+/*
+ * Copyright (C) 2011 The Android Open Source Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the 
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED 
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <sys/time.h>
+#include <linux/auxvec.h>
+#include <linux/elf.h>
+#include "libc_init_common.h"
+
+/* Newer kernels export clock_gettime() and gettimeofday() from the vDSO,
+ * a small shared object they map into every process, so that reading the
+ * clocks doesn't have to enter the kernel. We look these functions up once
+ * at startup, and fall back to the system calls if the kernel doesn't map
+ * a vDSO or the vDSO doesn't provide them.
+ *
+ * The plain system call stubs are __clock_gettime and __gettimeofday.
+ * The vDSO functions return a negative errno value on failure, like the
+ * raw system calls.
+ */
+
+#ifndef AT_SYSINFO_EHDR
+#define AT_SYSINFO_EHDR  33
+#endif
+
+extern int __clock_gettime(clockid_t, struct timespec*);
+extern int __gettimeofday(struct timeval*, struct timezone*);
+
+typedef int (*vdso_clock_gettime_t)(clockid_t, struct timespec*);
+typedef int (*vdso_gettimeofday_t)(struct timeval*, struct timezone*);
+
+static vdso_clock_gettime_t  __vdso_clock_gettime_fn;
+static vdso_gettimeofday_t   __vdso_gettimeofday_fn;
+
+/* find a global function exported by the vDSO mapped at 'base' */
+static void*
+vdso_lookup(const char* base, const char* name)
+{
+    const Elf32_Ehdr*  ehdr = (const Elf32_Ehdr*) base;
+    const Elf32_Phdr*  phdr = (const Elf32_Phdr*) (base + ehdr->e_phoff);
+    const Elf32_Dyn*   dyn = NULL;
+    const Elf32_Sym*   symtab = NULL;
+    const char*        strtab = NULL;
+    const Elf32_Word*  hash = NULL;
+    Elf32_Addr         load_addr = 0;
+    int                found_load = 0;
+    Elf32_Word         nn;
+
+    for (nn = 0; nn < ehdr->e_phnum; nn++) {
+        if (phdr[nn].p_type == PT_LOAD && !found_load) {
+            load_addr  = phdr[nn].p_vaddr - phdr[nn].p_offset;
+            found_load = 1;
+        } else if (phdr[nn].p_type == PT_DYNAMIC) {
+            dyn = (const Elf32_Dyn*) (base + phdr[nn].p_offset);
+        }
+    }
+    if (!found_load || dyn == NULL)
+        return NULL;
+
+    /* the dynamic entries hold link-time addresses, relative to load_addr */
+    for ( ; dyn->d_tag != DT_NULL; dyn++) {
+        const char*  p = base + (dyn->d_un.d_ptr - load_addr);
+
+        switch (dyn->d_tag) {
+        case DT_SYMTAB: symtab = (const Elf32_Sym*) p; break;
+        case DT_STRTAB: strtab = p; break;
+        case DT_HASH:   hash = (const Elf32_Word*) p; break;
+        }
+    }
+    if (symtab == NULL || strtab == NULL || hash == NULL)
+        return NULL;
+
+    /* hash[1] is the number of symbols */
+    for (nn = 0; nn < hash[1]; nn++) {
+        const Elf32_Sym*  sym = &symtab[nn];
+        int               bind = ELF32_ST_BIND(sym->st_info);
+
+        if (ELF32_ST_TYPE(sym->st_info) != STT_FUNC ||
+            (bind != STB_GLOBAL && bind != STB_WEAK) ||
+            sym->st_shndx == SHN_UNDEF)
+            continue;
+
+        if (!strcmp(strtab + sym->st_name, name))
+            return (void*) (base + (sym->st_value - load_addr));
+    }
+    return NULL;
+}
+
+void __libc_init_vdso(uintptr_t* auxv)
+{
+    const char*  base = NULL;
+
+    for ( ; auxv[0] != AT_NULL; auxv += 2) {
+        if (auxv[0] == AT_SYSINFO_EHDR) {
+            base = (const char*) auxv[1];
+            break;
+        }
+    }
+    if (base == NULL)
+        return;
+
+    __vdso_clock_gettime_fn = vdso_lookup(base, "__vdso_clock_gettime");
+    __vdso_gettimeofday_fn  = vdso_lookup(base, "__vdso_gettimeofday");
+}
+
+int clock_gettime(clockid_t clock, struct timespec* ts)
+{
+    vdso_clock_gettime_t  fn = __vdso_clock_gettime_fn;
+
+    if (fn != NULL) {
+        int  ret = fn(clock, ts);
+        if (ret < 0) {
+            errno = -ret;
+            return -1;
+        }
+        return ret;
+    }
+
+    return __clock_gettime(clock, ts);
+}
+
+int gettimeofday(struct timeval* tv, struct timezone* tz)
+{
+    vdso_gettimeofday_t  fn = __vdso_gettimeofday_fn;
+
+    if (fn != NULL) {
+        int  ret = fn(tv, tz);
+        if (ret < 0) {
+            errno = -ret;
+            return -1;
+        }
+        return ret;
+    }
+
+    return __gettimeofday(tv, tz);
+}
@@ -53,10 +53,28 @@ struct prop_area {
     unsigned volatile serial;
     unsigned magic;
     unsigned version;
-    unsigned reserved[4];
+    unsigned hash_buckets;  /* power of two, 0 if the area has no index */
+    unsigned hash_offset;   /* unsigned[hash_buckets], 1-based toc index */
+    unsigned chain_offset;  /* unsigned short[PA_COUNT_MAX], next in bucket */
+    unsigned reserved;
     unsigned toc[1];
 };
 
+#define PROP_HASH_TABLE(area) \
+    ((volatile unsigned*) (((char*) area) + (area)->hash_offset))
+#define PROP_HASH_CHAIN(area) \
+    ((volatile unsigned short*) (((char*) area) + (area)->chain_offset))
+
+/* FNV-1a over the property name, shared by init and the readers. */
+static __inline__ unsigned prop_name_hash(const char *name, unsigned len)
+{
+    unsigned h = 2166136261u;
+    while(len--) {
+        h = (h ^ (unsigned char) *name++) * 16777619u;
+    }
+    return h;
+}
+
 #define SERIAL_VALUE_LEN(serial) ((serial) >> 24)
 #define SERIAL_DIRTY(serial) ((serial) & 1)
 
@@ -93,10 +111,20 @@ struct prop_msg
 **   2. memcpy(pi->value, local_value, value_len)
 **   3. pi->serial = (value_len << 24) | ((pi->serial + 1) & 0xffffff)
 **
-** Improvements:
-** - maintain the toc sorted by pi->name to allow lookup
-**   by binary search
+** - adding a property requires the following steps
+**   1. fill in the prop_info and its toc entry
+**   2. chain[index] = hash[bucket]
+**   3. hash[bucket] = index + 1 (release store)
+**   4. count = count + 1 (release store)
+**
+** Readers walk a bucket without locking.  A bucket head is only
+** ever replaced by a fully initialized entry whose chain link
+** points at the previous head, so a reader racing with an insert
+** either sees the new entry or the list as it was before.
 **
+** prop_area.serial is incremented on every change to any
+** property; callers that cache values can compare it (or
+** pi->serial for a single property) instead of reading again.
 */
 
 #define PROP_PATH_RAMDISK_DEFAULT  "/default.prop"
@@ -84,6 +84,13 @@ int __system_property_read(const prop_info *pi, char *name, char *value);
 */ 
 const prop_info *__system_property_find_nth(unsigned n);
 
+/* Return a serial number that changes whenever the value of pi
+** changes, or if pi is NULL, whenever any property is added or
+** changed.  Callers may cache a value together with its serial
+** and only read it again once the serial differs.
+*/
+unsigned __system_property_serial(const prop_info *pi);
+
 __END_DECLS
 
 #endif
@@ -59,7 +59,8 @@
  *     differently will be treated distinctly).
  *
  *    the smallest TTL value among the answer records are used as the time
- *    to keep an answer in the cache.
+ *    to keep an answer in the cache. answers without records (NXDOMAIN or
+ *    no data) use the SOA record of the authority section instead.
  *
  *    this is bad, but we absolutely want to avoid parsing the answer packets
  *    (and should be solved by the later full DNS cache process).
@@ -114,6 +115,12 @@
  */
 #define  CONFIG_SECONDS    (60*10)    /* 10 minutes */
 
+/* negative answers (NXDOMAIN, or no records of the requested type) are
+ * kept for the TTL given by the SOA record of the authority section, as
+ * described in RFC 2308, but never longer than CONFIG_NEGATIVE_SECONDS.
+ */
+#define  CONFIG_NEGATIVE_SECONDS  (60*5)  /* 5 minutes */
+
 /* default number of entries kept in the cache. This value has been
  * determined by browsing through various sites and counting the number
  * of corresponding requests. Keep in mind that our framework is currently
@@ -1008,10 +1015,76 @@ typedef struct Entry {
     int              id;        /* for debugging purpose */
 } Entry;
 
+/**
+ * Find the time to keep a negative answer, i.e. the smaller of the
+ * TTL and the MINIMUM field of the SOA record in the authority section
+ * (RFC 2308 section 5).
+ *
+ * Zero (0) is returned if there is no usable SOA record, in which case
+ * the answer shall not be cached.
+ */
+static u_long
+answer_getNegativeTTL(ns_msg handle)
+{
+    int nscount, n, len;
+    u_long result, ttl, minimum;
+    const u_char* rdata;
+    const u_char* rdataend;
+    ns_rr rr;
+
+    result = 0;
+    nscount = ns_msg_count(handle, ns_s_ns);
+    for (n = 0; n < nscount; n++) {
+        if (ns_parserr(&handle, ns_s_ns, n, &rr) != 0) {
+            XLOG("ns_parserr failed nscount no = %d. errno = %s\n", n, strerror(errno));
+            continue;
+        }
+        if (ns_rr_type(rr) != ns_t_soa) {
+            continue;
+        }
+
+        /* skip MNAME and RNAME to reach SERIAL, REFRESH, RETRY,
+         * EXPIRE and MINIMUM */
+        rdata = ns_rr_rdata(rr);
+        rdataend = rdata + ns_rr_rdlen(rr);
+        if ((len = dn_skipname(rdata, rdataend)) < 0) {
+            continue;
+        }
+        rdata += len;
+        if ((len = dn_skipname(rdata, rdataend)) < 0) {
+            continue;
+        }
+        rdata += len;
+        if (rdataend - rdata < 5 * NS_INT32SZ) {
+            continue;
+        }
+        minimum = ns_get32(rdata + 4 * NS_INT32SZ);
+
+        ttl = ns_rr_ttl(rr);
+        if (minimum < ttl) {
+            ttl = minimum;
+        }
+        if (result == 0 || ttl < result) {
+            result = ttl;
+        }
+    }
+
+    if (result > CONFIG_NEGATIVE_SECONDS) {
+        result = CONFIG_NEGATIVE_SECONDS;
+    }
+
+    XLOG("negative TTL = %d\n", result);
+
+    return result;
+}
+
 /**
  * Parse the answer records and find the smallest
  * TTL among the answer records.
  *
+ * Answers without any record are negative
+ * answers, see answer_getNegativeTTL().
+ *
  * The returned TTL is the number of seconds to
  * keep the answer in the cache.
  *
@@ -1022,7 +1095,7 @@ static u_long
 answer_getTTL(const void* answer, int answerlen)
 {
     ns_msg handle;
-    int ancount, n;
+    int ancount, n, rcode;
     u_long result, ttl;
     ns_rr rr;
 
@@ -1030,6 +1103,13 @@ answer_getTTL(const void* answer, int answerlen)
     if (ns_initparse(answer, answerlen, &handle) >= 0) {
         // get number of answer records
         ancount = ns_msg_count(handle, ns_s_an);
+        if (ancount == 0) {
+            rcode = ns_msg_getflag(handle, ns_f_rcode);
+            if (rcode == ns_r_noerror || rcode == ns_r_nxdomain) {
+                return answer_getNegativeTTL(handle);
+            }
+            return 0;
+        }
         for (n = 0; n < ancount; n++) {
             if (ns_parserr(&handle, ns_s_an, n, &rr) == 0) {
                 ttl = ns_rr_ttl(rr);
@@ -37,7 +37,10 @@ static __inline void	 swapfunc(char *, char *, int, int);
 #define min(a, b)	(a) < (b) ? a : b
 
 /*
- * Qsort routine from Bentley & McIlroy's "Engineering a Sort Function".
+ * Qsort routine from Bentley & McIlroy's "Engineering a Sort Function",
+ * turned into an introsort: once the partitioning has gone deeper than
+ * twice the log2 of the original size, the remaining subarray is heap
+ * sorted so that the worst case stays O(n log n).
  */
 #define swapcode(TYPE, parmi, parmj, n) {		\
 	long i = (n) / sizeof (TYPE);			\
@@ -80,15 +83,45 @@ med3(char *a, char *b, char *c, int (*cmp)(const void *, const void *))
               :(cmp(b, c) > 0 ? b : (cmp(a, c) < 0 ? a : c ));
 }
 
-void
-qsort(void *aa, size_t n, size_t es, int (*cmp)(const void *, const void *))
+static void
+siftdown(char *a, size_t root, size_t n, size_t es, int swaptype,
+    int (*cmp)(const void *, const void *))
+{
+	size_t child;
+
+	while ((child = 2 * root + 1) < n) {
+		if (child + 1 < n && cmp(a + child * es, a + (child + 1) * es) < 0)
+			child++;
+		if (cmp(a + root * es, a + child * es) >= 0)
+			return;
+		swap(a + root * es, a + child * es);
+		root = child;
+	}
+}
+
+static void
+heapsort_fallback(char *a, size_t n, size_t es, int swaptype,
+    int (*cmp)(const void *, const void *))
+{
+	size_t i;
+
+	for (i = n / 2; i > 0; i--)
+		siftdown(a, i - 1, n, es, swaptype, cmp);
+	for (i = n - 1; i > 0; i--) {
+		swap(a, a + i * es);
+		siftdown(a, 0, i, es, swaptype, cmp);
+	}
+}
+
+static void
+introsort(char *a, size_t n, size_t es, int (*cmp)(const void *, const void *),
+    int depth)
 {
 	char *pa, *pb, *pc, *pd, *pl, *pm, *pn;
-	int d, r, swaptype, swap_cnt;
-	char *a = aa;
+	int d, r, swaptype;
+	size_t nl, nr;
 
 loop:	SWAPINIT(a, es);
-	swap_cnt = 0;
 	if (n < 7) {
 		for (pm = (char *)a + es; pm < (char *) a + n * es; pm += es)
 			for (pl = pm; pl > (char *) a && cmp(pl - es, pl) > 0;
@@ -96,6 +129,10 @@ loop:	SWAPINIT(a, es);
 				swap(pl, pl - es);
 		return;
 	}
+	if (depth-- == 0) {
+		heapsort_fallback(a, n, es, swaptype, cmp);
+		return;
+	}
 	pm = (char *)a + (n / 2) * es;
 	if (n > 7) {
 		pl = (char *)a;
@@ -115,7 +152,6 @@ loop:	SWAPINIT(a, es);
 	for (;;) {
 		while (pb <= pc && (r = cmp(pb, a)) <= 0) {
 			if (r == 0) {
-				swap_cnt = 1;
 				swap(pa, pb);
 				pa += es;
 			}
@@ -123,7 +159,6 @@ loop:	SWAPINIT(a, es);
 		}
 		while (pb <= pc && (r = cmp(pc, a)) >= 0) {
 			if (r == 0) {
-				swap_cnt = 1;
 				swap(pc, pd);
 				pd -= es;
 			}
@@ -132,30 +167,43 @@ loop:	SWAPINIT(a, es);
 		if (pb > pc)
 			break;
 		swap(pb, pc);
-		swap_cnt = 1;
 		pb += es;
 		pc -= es;
 	}
-	if (swap_cnt == 0) {  /* Switch to insertion sort */
-		for (pm = (char *) a + es; pm < (char *) a + n * es; pm += es)
-			for (pl = pm; pl > (char *) a && cmp(pl - es, pl) > 0;
-			     pl -= es)
-				swap(pl, pl - es);
-		return;
-	}
 
 	pn = (char *)a + n * es;
 	r = min(pa - (char *)a, pb - pa);
 	vecswap(a, pb - r, r);
 	r = min(pd - pc, pn - pd - (int)es);
 	vecswap(pb, pn - r, r);
-	if ((r = pb - pa) > (int)es)
-		qsort(a, r / es, es, cmp);
-	if ((r = pd - pc) > (int)es) {
-		/* Iterate rather than recurse to save stack space */
-		a = pn - r;
-		n = r / es;
-		goto loop;
+
+	/*
+	 * Recurse into the smaller side and iterate on the larger one, so
+	 * that the stack depth stays logarithmic.
+	 */
+	nl = (pb - pa) / es;
+	nr = (pd - pc) / es;
+	if (nl < nr) {
+		if (nl > 1)
+			introsort(a, nl, es, cmp, depth);
+		a = pn - nr * es;
+		n = nr;
+	} else {
+		if (nr > 1)
+			introsort(pn - nr * es, nr, es, cmp, depth);
+		n = nl;
 	}
-	/* qsort(pn - r, r / es, es, cmp); */
+	if (n > 1)
+		goto loop;
+}
+
+void
+qsort(void *a, size_t n, size_t es, int (*cmp)(const void *, const void *))
+{
+	size_t i;
+	int depth;
+
+	for (depth = 0, i = n; i > 1; i >>= 1)
+		depth += 2;
+	introsort(a, n, es, cmp, depth);
 }
@@ -66,6 +66,7 @@ static int extractAndProcessZip(int zipFd, int cacheFd,
     int err;
     int result = -1;
     int dexoptFlags = 0;        /* bit flags, from enum DexoptFlags */
+    int maxThreads = 0;         /* CPU budget for parallel verify+opt */
     DexClassVerifyMode verifyMode = VERIFY_MODE_ALL;
     DexOptimizerMode dexOptMode = OPTIMIZE_MODE_VERIFIED;
 
@@ -167,6 +168,14 @@ static int extractAndProcessZip(int zipFd, int cacheFd,
             default:                                            break;
             }
         }
+
+        opc = strstr(dexoptFlagStr, "p=");      /* parallel verify+opt */
+        if (opc != NULL) {
+            /* "p=N" caps the thread count at N, zero means no cap */
+            maxThreads = atoi(opc+2);
+            if (maxThreads != 1)
+                dexoptFlags |= DEXOPT_PARALLEL;
+        }
     }
 
     /*
@@ -179,6 +188,8 @@ static int extractAndProcessZip(int zipFd, int cacheFd,
         LOGE("DexOptZ: VM init failed");
         goto bail;
     }
+    if (maxThreads > 0 && gDvm.dexOptThreads > maxThreads)
+        gDvm.dexOptThreads = maxThreads;
 
     //vmStarted = 1;
 
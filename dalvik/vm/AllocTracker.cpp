@@ -46,6 +46,18 @@
 #define kMaxAllocRecordStackDepth   16      /* max 255 */
 #define kNumAllocRecords            512     /* MUST be power of 2 */
 
+#define kMaxAllocSiteStackDepth     8       /* max 255 */
+#define kNumAllocSites              1024    /* MUST be power of 2 */
+#define kNumSampledObjects          8192    /* MUST be power of 2 */
+
+/*
+ * One element of an allocation stack trace.
+ */
+struct AllocStackElem {
+    const Method*   method;     /* which method we're executing in */
+    int             pc;         /* current execution offset, in 16-bit units */
+};
+
 /*
  * Record the details of an allocation.
  */
@@ -55,10 +67,7 @@ struct AllocRecord {
     u2              threadId;   /* simple thread ID; could be recycled */
 
     /* stack trace elements; unused entries have method==NULL */
-    struct {
-        const Method* method;   /* which method we're executing in */
-        int         pc;         /* current execution offset, in 16-bit units */
-    } stackElem[kMaxAllocRecordStackDepth];
+    AllocStackElem  stackElem[kMaxAllocRecordStackDepth];
 
     /*
      * This was going to be either wall-clock time in seconds or monotonic
@@ -69,6 +78,44 @@ struct AllocRecord {
     //u4      timestamp;
 };
 
+/*
+ * An allocation site: the class allocated and the top of the stack that
+ * allocated it.  Sites live in an open-addressed hash table.
+ */
+struct AllocSite {
+    ClassObject*    clazz;      /* class allocated; NULL if slot is free */
+    u4              hash;
+    u4              samples;    /* #of sampled allocations */
+    u4              bytes;      /* total size of sampled allocations */
+    u4              liveSamples;/* #of sampled allocations not yet freed */
+    u4              liveBytes;  /* total size of those */
+
+    /* stack trace elements; unused entries have method==NULL */
+    AllocStackElem  stackElem[kMaxAllocSiteStackDepth];
+};
+
+/*
+ * A sampled object that is still alive, so that we can take it off its
+ * site's live count when the GC frees it.
+ */
+struct SampledObject {
+    const Object*   obj;        /* NULL if slot is free */
+    u4              size;
+    u4              site;       /* index into AllocSiteTable.sites */
+};
+
+/*
+ * Everything the sampler collects.  Both tables use linear probing and
+ * are never allowed to fill past 3/4.
+ */
+struct AllocSiteTable {
+    AllocSite       sites[kNumAllocSites];
+    int             siteCount;
+    SampledObject   objects[kNumSampledObjects];
+    int             objectCount;
+    u4              droppedSamples; /* samples lost to a full table */
+};
+
 /*
  * Initialize a few things.  This gets called early, so keep activity to
  * a minimum.
@@ -81,6 +128,15 @@ bool dvmAllocTrackerStartup()
     /* initialized when enabled by DDMS */
     assert(gDvm.allocRecords == NULL);
 
+    /* sampling can be requested on the command line */
+    assert(gDvm.allocSites == NULL);
+    if (gDvm.allocSampleInterval != 0) {
+        int interval = gDvm.allocSampleInterval;
+        gDvm.allocSampleInterval = 0;
+        if (!dvmEnableAllocSampling(interval))
+            return false;
+    }
+
     return true;
 }
 
@@ -90,6 +146,7 @@ bool dvmAllocTrackerStartup()
 void dvmAllocTrackerShutdown()
 {
     free(gDvm.allocRecords);
+    free(gDvm.allocSites);
     dvmDestroyMutex(&gDvm.allocTrackerLock);
 }
 
@@ -142,28 +199,29 @@ void dvmDisableAllocTracker()
 }
 
 /*
- * Get the last few stack frames.
+ * Get the last "maxDepth" stack frames.
  */
-static void getStackFrames(Thread* self, AllocRecord* pRec)
+static void getStackFrames(Thread* self, AllocStackElem* stackElem,
+    int maxDepth)
 {
     int stackDepth = 0;
     void* fp;
 
     fp = self->interpSave.curFrame;
 
-    while ((fp != NULL) && (stackDepth < kMaxAllocRecordStackDepth)) {
+    while ((fp != NULL) && (stackDepth < maxDepth)) {
         const StackSaveArea* saveArea = SAVEAREA_FROM_FP(fp);
         const Method* method = saveArea->method;
 
         if (!dvmIsBreakFrame((u4*) fp)) {
-            pRec->stackElem[stackDepth].method = method;
+            stackElem[stackDepth].method = method;
             if (dvmIsNativeMethod(method)) {
-                pRec->stackElem[stackDepth].pc = 0;
+                stackElem[stackDepth].pc = 0;
             } else {
                 assert(saveArea->xtra.currentPc >= method->insns &&
                         saveArea->xtra.currentPc <
                         method->insns + dvmGetMethodInsnsSize(method));
-                pRec->stackElem[stackDepth].pc =
+                stackElem[stackDepth].pc =
                     (int) (saveArea->xtra.currentPc - method->insns);
             }
             stackDepth++;
@@ -174,9 +232,9 @@ static void getStackFrames(Thread* self, AllocRecord* pRec)
     }
 
     /* clear out the rest (normally there won't be any) */
-    while (stackDepth < kMaxAllocRecordStackDepth) {
-        pRec->stackElem[stackDepth].method = NULL;
-        pRec->stackElem[stackDepth].pc = 0;
+    while (stackDepth < maxDepth) {
+        stackElem[stackDepth].method = NULL;
+        stackElem[stackDepth].pc = 0;
         stackDepth++;
     }
 }
@@ -207,7 +265,7 @@ void dvmDoTrackAllocation(ClassObject* clazz, size_t size)
     pRec->clazz = clazz;
     pRec->size = size;
     pRec->threadId = self->threadId;
-    getStackFrames(self, pRec);
+    getStackFrames(self, pRec->stackElem, kMaxAllocRecordStackDepth);
 
     if (gDvm.allocRecordCount < kNumAllocRecords)
         gDvm.allocRecordCount++;
@@ -216,6 +274,255 @@ void dvmDoTrackAllocation(ClassObject* clazz, size_t size)
 }
 
 
+
+/*
+ * ===========================================================================
+ *      Allocation site sampling
+ * ===========================================================================
+ */
+
+/*
+ * The sampler is meant to be cheap enough to leave on.  Each thread counts
+ * down the bytes it allocates, and only the allocation that takes the count
+ * past zero is charged to its site; the countdown is then rearmed with the
+ * interval.  A site that allocates N bytes thus gets about N/interval
+ * samples however it splits them into objects, and every other allocation
+ * costs a subtraction.
+ *
+ * Sampled objects are remembered until the sweep frees them, which gives
+ * each site a count of retained bytes next to its allocated bytes.
+ */
+
+/*
+ * Enable allocation site sampling.
+ *
+ * Returns "true" on success.
+ */
+bool dvmEnableAllocSampling(int interval)
+{
+    bool result = true;
+
+    if (interval <= 0)
+        return false;
+
+    dvmLockMutex(&gDvm.allocTrackerLock);
+
+    if (gDvm.allocSites == NULL) {
+        LOGI("Enabling alloc sampling (every %d bytes, %d sites --> %d bytes)",
+            interval, kNumAllocSites, sizeof(AllocSiteTable));
+        gDvm.allocSites = (AllocSiteTable*) calloc(1, sizeof(AllocSiteTable));
+    }
+
+    if (gDvm.allocSites != NULL)
+        gDvm.allocSampleInterval = interval;
+    else
+        result = false;
+
+    dvmUnlockMutex(&gDvm.allocTrackerLock);
+    return result;
+}
+
+/*
+ * Disable allocation site sampling.
+ */
+void dvmDisableAllocSampling()
+{
+    dvmLockMutex(&gDvm.allocTrackerLock);
+
+    gDvm.allocSampleInterval = 0;
+    free(gDvm.allocSites);
+    gDvm.allocSites = NULL;
+
+    dvmUnlockMutex(&gDvm.allocTrackerLock);
+}
+
+/*
+ * Hash an allocation site.  Unused stack entries are zeroed, so hashing
+ * the whole array is fine.
+ */
+static u4 hashAllocSite(const ClassObject* clazz,
+    const AllocStackElem* stackElem)
+{
+    u4 hash = (u4) (uintptr_t) clazz;
+
+    for (int i = 0; i < kMaxAllocSiteStackDepth; i++) {
+        hash = hash * 31 + (u4) (uintptr_t) stackElem[i].method;
+        hash = hash * 31 + stackElem[i].pc;
+    }
+    return hash;
+}
+
+/*
+ * Hash an object address.  Objects are 8-byte aligned.
+ */
+static inline u4 hashSampledObject(const Object* obj)
+{
+    return ((u4) (uintptr_t) obj >> 3) * 2654435761U;
+}
+
+/*
+ * Find the site for this class and stack, adding it if it's new.
+ *
+ * Returns the index of the site, or -1 if the table is full.
+ */
+static int findOrAddSite(AllocSiteTable* table, ClassObject* clazz,
+    const AllocStackElem* stackElem)
+{
+    u4 hash = hashAllocSite(clazz, stackElem);
+    int idx = hash & (kNumAllocSites-1);
+
+    while (true) {
+        AllocSite* pSite = &table->sites[idx];
+
+        if (pSite->clazz == NULL) {
+            if (table->siteCount >= kNumAllocSites * 3 / 4)
+                return -1;
+            pSite->clazz = clazz;
+            pSite->hash = hash;
+            memcpy(pSite->stackElem, stackElem, sizeof(pSite->stackElem));
+            table->siteCount++;
+            return idx;
+        }
+        if (pSite->hash == hash && pSite->clazz == clazz &&
+            memcmp(pSite->stackElem, stackElem, sizeof(pSite->stackElem)) == 0)
+        {
+            return idx;
+        }
+
+        idx = (idx + 1) & (kNumAllocSites-1);
+    }
+}
+
+/*
+ * Remember a sampled object.  Returns "false" if the table is full.
+ */
+static bool addSampledObject(AllocSiteTable* table, const Object* obj,
+    u4 size, int site)
+{
+    if (table->objectCount >= kNumSampledObjects * 3 / 4)
+        return false;
+
+    int idx = hashSampledObject(obj) & (kNumSampledObjects-1);
+    while (table->objects[idx].obj != NULL)
+        idx = (idx + 1) & (kNumSampledObjects-1);
+
+    table->objects[idx].obj = obj;
+    table->objects[idx].size = size;
+    table->objects[idx].site = site;
+    table->objectCount++;
+    return true;
+}
+
+/*
+ * Forget a sampled object, copying its entry to "*pEntry".  Returns "false"
+ * if the object wasn't sampled.
+ */
+static bool removeSampledObject(AllocSiteTable* table, const Object* obj,
+    SampledObject* pEntry)
+{
+    const int mask = kNumSampledObjects-1;
+    SampledObject* objects = table->objects;
+    int idx = hashSampledObject(obj) & mask;
+
+    while (objects[idx].obj != obj) {
+        if (objects[idx].obj == NULL)
+            return false;
+        idx = (idx + 1) & mask;
+    }
+    *pEntry = objects[idx];
+
+    /*
+     * Close the hole by shifting back any later entry of the same run that
+     * can legally live there, so that lookups never stop early.
+     */
+    int hole = idx;
+    for (int next = (idx + 1) & mask; objects[next].obj != NULL;
+        next = (next + 1) & mask)
+    {
+        int home = hashSampledObject(objects[next].obj) & mask;
+        if (((next - home) & mask) >= ((next - hole) & mask)) {
+            objects[hole] = objects[next];
+            hole = next;
+        }
+    }
+    objects[hole].obj = NULL;
+    table->objectCount--;
+    return true;
+}
+
+/*
+ * Charge an allocation to its site if this thread is due for a sample.
+ */
+void dvmDoSampleAllocation(const Object* obj, ClassObject* clazz, size_t size)
+{
+    Thread* self = dvmThreadSelf();
+    if (self == NULL)
+        return;
+
+    self->allocSampleBytesLeft -= size;
+    if (self->allocSampleBytesLeft > 0)
+        return;
+
+    int interval = gDvm.allocSampleInterval;
+    if (interval == 0)
+        return;
+    self->allocSampleBytesLeft += interval;
+    if (self->allocSampleBytesLeft <= 0)
+        self->allocSampleBytesLeft = interval;
+
+    /* the stack walk doesn't need the lock */
+    AllocStackElem stackElem[kMaxAllocSiteStackDepth];
+    getStackFrames(self, stackElem, kMaxAllocSiteStackDepth);
+
+    dvmLockMutex(&gDvm.allocTrackerLock);
+
+    AllocSiteTable* table = gDvm.allocSites;
+    if (table != NULL) {
+        int site = findOrAddSite(table, clazz, stackElem);
+        if (site >= 0) {
+            AllocSite* pSite = &table->sites[site];
+            pSite->samples++;
+            pSite->bytes += size;
+            if (addSampledObject(table, obj, size, site)) {
+                pSite->liveSamples++;
+                pSite->liveBytes += size;
+            } else {
+                table->droppedSamples++;
+            }
+        } else {
+            table->droppedSamples++;
+        }
+    }
+
+    dvmUnlockMutex(&gDvm.allocTrackerLock);
+}
+
+/*
+ * Take freed objects off the live counts of their sites.
+ *
+ * The sweep may hold the heap lock here.  Nothing holding allocTrackerLock
+ * ever waits for the heap lock, so that's safe.
+ */
+void dvmSampledAllocationsFreed(size_t numPtrs, void** ptrs)
+{
+    dvmLockMutex(&gDvm.allocTrackerLock);
+
+    AllocSiteTable* table = gDvm.allocSites;
+    if (table != NULL) {
+        for (size_t i = 0; i < numPtrs && table->objectCount > 0; i++) {
+            SampledObject entry;
+            if (removeSampledObject(table, (const Object*) ptrs[i], &entry)) {
+                AllocSite* pSite = &table->sites[entry.site];
+                pSite->liveSamples--;
+                pSite->liveBytes -= entry.size;
+            }
+        }
+    }
+
+    dvmUnlockMutex(&gDvm.allocTrackerLock);
+}
+
+
 /*
  * ===========================================================================
  *      Reporting
@@ -652,3 +959,274 @@ void dvmDumpTrackedAllocations(bool enable)
             free(data);
     }
 }
+
+
+/*
+The allocation site report follows the same pattern, with one entry per
+site:
+
+Message header (all values big-endian):
+  (1b) message header len (to allow future expansion); includes itself
+  (1b) entry header len
+  (1b) stack frame len
+  (2b) number of entries
+  (4b) offset to string table from start of message
+  (2b) number of class name strings
+  (2b) number of method name strings
+  (2b) number of source file name strings
+  (4b) sample interval, in bytes
+  (4b) number of samples dropped because a table was full
+  For each entry:
+    (4b) number of sampled allocations
+    (4b) total size of sampled allocations
+    (4b) number of sampled allocations still live
+    (4b) total size of those
+    (2b) allocated object's class name index
+    (1b) stack depth
+    For each stack frame: as above
+  (xb) class name strings
+  (xb) method name strings
+  (xb) source file strings
+
+Each sample stands for about "interval" bytes allocated at that site, so
+the allocation and retained volumes can be estimated by scaling the counts.
+*/
+const int kSiteMessageHeaderLen = 23;
+const int kSiteEntryHeaderLen = 19;
+
+/*
+ * Return the number of valid frames in a stack trace.
+ */
+static int getStackDepth(const AllocStackElem* stackElem, int maxDepth)
+{
+    int depth;
+    for (depth = 0; depth < maxDepth; depth++) {
+        if (stackElem[depth].method == NULL)
+            break;
+    }
+    return depth;
+}
+
+/*
+ * Generate string tables for the allocation sites.
+ */
+static void populateSiteStringTables(const AllocSiteTable* table,
+    PointerSet* classNames, PointerSet* methodNames, PointerSet* fileNames)
+{
+    for (int idx = 0; idx < kNumAllocSites; idx++) {
+        const AllocSite* pSite = &table->sites[idx];
+        if (pSite->clazz == NULL)
+            continue;
+
+        dvmPointerSetAddEntry(classNames, pSite->clazz->descriptor);
+
+        int depth = getStackDepth(pSite->stackElem, kMaxAllocSiteStackDepth);
+        for (int i = 0; i < depth; i++) {
+            const Method* method = pSite->stackElem[i].method;
+            dvmPointerSetAddEntry(classNames, method->clazz->descriptor);
+            dvmPointerSetAddEntry(methodNames, method->name);
+            dvmPointerSetAddEntry(fileNames, getMethodSourceFile(method));
+        }
+    }
+}
+
+/*
+ * Generate everything but the string tables.  Called twice, like
+ * generateBaseOutput().
+ */
+static size_t generateSiteOutput(const AllocSiteTable* table, u1* ptr,
+    size_t baseLen, const PointerSet* classNames,
+    const PointerSet* methodNames, const PointerSet* fileNames)
+{
+    u1* origPtr = ptr;
+
+    if (origPtr != NULL) {
+        set1(&ptr[0], kSiteMessageHeaderLen);
+        set1(&ptr[1], kSiteEntryHeaderLen);
+        set1(&ptr[2], kStackFrameLen);
+        set2BE(&ptr[3], table->siteCount);
+        set4BE(&ptr[5], baseLen);
+        set2BE(&ptr[9], dvmPointerSetGetCount(classNames));
+        set2BE(&ptr[11], dvmPointerSetGetCount(methodNames));
+        set2BE(&ptr[13], dvmPointerSetGetCount(fileNames));
+        set4BE(&ptr[15], gDvm.allocSampleInterval);
+        set4BE(&ptr[19], table->droppedSamples);
+    }
+    ptr += kSiteMessageHeaderLen;
+
+    for (int idx = 0; idx < kNumAllocSites; idx++) {
+        const AllocSite* pSite = &table->sites[idx];
+        if (pSite->clazz == NULL)
+            continue;
+
+        int depth = getStackDepth(pSite->stackElem, kMaxAllocSiteStackDepth);
+
+        /* output header */
+        if (origPtr != NULL) {
+            set4BE(&ptr[0], pSite->samples);
+            set4BE(&ptr[4], pSite->bytes);
+            set4BE(&ptr[8], pSite->liveSamples);
+            set4BE(&ptr[12], pSite->liveBytes);
+            set2BE(&ptr[16],
+                dvmPointerSetFind(classNames, pSite->clazz->descriptor));
+            set1(&ptr[18], depth);
+        }
+        ptr += kSiteEntryHeaderLen;
+
+        /* convert stack frames */
+        for (int i = 0; i < depth; i++) {
+            if (origPtr != NULL) {
+                const Method* method = pSite->stackElem[i].method;
+                int lineNum;
+
+                lineNum = dvmLineNumFromPC(method, pSite->stackElem[i].pc);
+                if (lineNum > 32767)
+                    lineNum = 32767;
+
+                set2BE(&ptr[0], dvmPointerSetFind(classNames,
+                        method->clazz->descriptor));
+                set2BE(&ptr[2], dvmPointerSetFind(methodNames,
+                        method->name));
+                set2BE(&ptr[4], dvmPointerSetFind(fileNames,
+                        getMethodSourceFile(method)));
+                set2BE(&ptr[6], (u2)lineNum);
+            }
+            ptr += kStackFrameLen;
+        }
+    }
+
+    return ptr - origPtr;
+}
+
+/*
+ * Generate a DDM packet with the sampled allocation sites.
+ *
+ * On success, returns "true" with "*pData" and "*pDataLen" set.
+ */
+bool dvmGenerateAllocSiteReport(u1** pData, size_t* pDataLen)
+{
+    bool result = false;
+    u1* buffer = NULL;
+    PointerSet* classNames = NULL;
+    PointerSet* methodNames = NULL;
+    PointerSet* fileNames = NULL;
+
+    dvmLockMutex(&gDvm.allocTrackerLock);
+
+    const AllocSiteTable* table = gDvm.allocSites;
+    if (table == NULL)
+        goto bail;
+
+    classNames = dvmPointerSetAlloc(128);
+    methodNames = dvmPointerSetAlloc(128);
+    fileNames = dvmPointerSetAlloc(128);
+    if (classNames == NULL || methodNames == NULL || fileNames == NULL) {
+        LOGE("Failed allocating pointer sets");
+        goto bail;
+    }
+
+    populateSiteStringTables(table, classNames, methodNames, fileNames);
+
+    size_t baseSize, totalSize;
+    baseSize = generateSiteOutput(table, NULL, 0,
+        classNames, methodNames, fileNames);
+    totalSize = baseSize;
+    totalSize += computeStringTableSize(classNames);
+    totalSize += computeStringTableSize(methodNames);
+    totalSize += computeStringTableSize(fileNames);
+
+    u1* strPtr;
+
+    buffer = (u1*) malloc(totalSize);
+    if (buffer == NULL)
+        goto bail;
+    strPtr = buffer + baseSize;
+    generateSiteOutput(table, buffer, baseSize,
+        classNames, methodNames, fileNames);
+    strPtr += outputStringTable(classNames, strPtr);
+    strPtr += outputStringTable(methodNames, strPtr);
+    strPtr += outputStringTable(fileNames, strPtr);
+    if (strPtr - buffer != (int)totalSize) {
+        LOGE("size mismatch (%d vs %zd)", strPtr - buffer, totalSize);
+        dvmAbort();
+    }
+
+    *pData = buffer;
+    *pDataLen = totalSize;
+    buffer = NULL;          // don't free -- caller will own
+    result = true;
+
+bail:
+    dvmPointerSetFree(classNames);
+    dvmPointerSetFree(methodNames);
+    dvmPointerSetFree(fileNames);
+    free(buffer);
+    dvmUnlockMutex(&gDvm.allocTrackerLock);
+    return result;
+}
+
+/*
+ * Sort sites by live bytes, largest first.
+ */
+static int compareSiteLiveBytes(const void* vp1, const void* vp2)
+{
+    const AllocSite* pSite1 = *(const AllocSite**) vp1;
+    const AllocSite* pSite2 = *(const AllocSite**) vp2;
+
+    if (pSite1->liveBytes != pSite2->liveBytes)
+        return (pSite1->liveBytes > pSite2->liveBytes) ? -1 : 1;
+    return (pSite1->bytes > pSite2->bytes) ? -1 :
+           (pSite1->bytes < pSite2->bytes) ? 1 : 0;
+}
+
+/*
+ * Dump the top allocation sites to the log file.
+ */
+void dvmDumpAllocSites()
+{
+    const int kMaxDumpedSites = 20;
+
+    dvmLockMutex(&gDvm.allocTrackerLock);
+    AllocSiteTable* table = gDvm.allocSites;
+    if (table == NULL) {
+        dvmUnlockMutex(&gDvm.allocTrackerLock);
+        return;
+    }
+
+    const AllocSite* sorted[kNumAllocSites];
+    int count = 0;
+    for (int idx = 0; idx < kNumAllocSites; idx++) {
+        if (table->sites[idx].clazz != NULL)
+            sorted[count++] = &table->sites[idx];
+    }
+    qsort(sorted, count, sizeof(sorted[0]), compareSiteLiveBytes);
+
+    LOGI("Allocation sites (interval=%d sites=%d live=%d dropped=%u)",
+        gDvm.allocSampleInterval, count, table->objectCount,
+        table->droppedSamples);
+    for (int i = 0; i < count && i < kMaxDumpedSites; i++) {
+        const AllocSite* pSite = sorted[i];
+        LOGI(" %6u live (%8u bytes) of %6u (%8u bytes) %s",
+            pSite->liveSamples, pSite->liveBytes,
+            pSite->samples, pSite->bytes, pSite->clazz->descriptor);
+
+        int depth = getStackDepth(pSite->stackElem, kMaxAllocSiteStackDepth);
+        for (int j = 0; j < depth; j++) {
+            const Method* method = pSite->stackElem[j].method;
+            if (dvmIsNativeMethod(method)) {
+                LOGI("    %s.%s (Native)",
+                    method->clazz->descriptor, method->name);
+            } else {
+                LOGI("    %s.%s +%d",
+                    method->clazz->descriptor, method->name,
+                    pSite->stackElem[j].pc);
+            }
+        }
+
+        /* pause periodically to help logcat catch up */
+        if ((i % 5) == 4)
+            usleep(40000);
+    }
+
+    dvmUnlockMutex(&gDvm.allocTrackerLock);
+}
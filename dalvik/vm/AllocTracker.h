@@ -24,6 +24,7 @@ bool dvmAllocTrackerStartup(void);
 void dvmAllocTrackerShutdown(void);
 
 struct AllocRecord;
+struct AllocSiteTable;
 
 /*
  * Enable allocation tracking.  Does nothing if tracking is already enabled.
@@ -36,14 +37,37 @@ bool dvmEnableAllocTracker(void);
 void dvmDisableAllocTracker(void);
 
 /*
- * If allocation tracking is enabled, add a new entry to the set.
+ * Enable allocation site sampling, taking roughly one sample for every
+ * "interval" bytes allocated by each thread.  If sampling is already
+ * enabled the interval is changed and the collected data is kept.
  */
-#define dvmTrackAllocation(_clazz, _size)                                   \
+bool dvmEnableAllocSampling(int interval);
+
+/*
+ * Disable allocation site sampling and discard the collected data.
+ */
+void dvmDisableAllocSampling(void);
+
+/*
+ * If allocation tracking is enabled, add a new entry to the set.  If
+ * allocation sampling is enabled, charge the allocation to its site when
+ * it is due for a sample.
+ */
+#define dvmTrackAllocation(_obj, _clazz, _size)                             \
     {                                                                       \
         if (gDvm.allocRecords != NULL)                                      \
             dvmDoTrackAllocation(_clazz, _size);                            \
+        if (gDvm.allocSampleInterval != 0)                                  \
+            dvmDoSampleAllocation(_obj, _clazz, _size);                     \
     }
 void dvmDoTrackAllocation(ClassObject* clazz, size_t size);
+void dvmDoSampleAllocation(const Object* obj, ClassObject* clazz, size_t size);
+
+/*
+ * Tell the sampler that the GC has freed these objects, so that sampled
+ * allocations among them stop counting as live.  Called by the sweep.
+ */
+void dvmSampledAllocationsFreed(size_t numPtrs, void** ptrs);
 
 /*
  * Generate a DDM packet with all of the tracked allocation data.
@@ -59,4 +83,18 @@ bool dvmGenerateTrackedAllocationReport(u1** pData, size_t* pDataLen);
  */
 void dvmDumpTrackedAllocations(bool enable);
 
+/*
+ * Generate a DDM packet with the allocation sites collected by the sampler.
+ * Returns "false" if sampling is not enabled or we run out of memory.
+ *
+ * On success, "*pData" refers to newly-allocated storage that must be
+ * freed by the caller.
+ */
+bool dvmGenerateAllocSiteReport(u1** pData, size_t* pDataLen);
+
+/*
+ * Dump the allocation sites with the most live sampled bytes to the log.
+ */
+void dvmDumpAllocSites(void);
+
 #endif  // DALVIK_ALLOCTRACKER_H_
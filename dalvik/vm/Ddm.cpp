@@ -483,3 +483,30 @@ ArrayObject* dvmDdmGetRecentAllocations()
         memcpy(arrayObj->contents, data, len);
     return arrayObj;
 }
+
+/*
+ * Gather up the allocation site data and copy it into a byte[].
+ *
+ * Returns NULL on failure with an exception raised.
+ */
+ArrayObject* dvmDdmGetAllocationSites()
+{
+    u1* data;
+    size_t len;
+
+    if (gDvm.allocSites == NULL) {
+        dvmThrowIllegalStateException("allocation sampling is not enabled");
+        return NULL;
+    }
+    if (!dvmGenerateAllocSiteReport(&data, &len)) {
+        /* assume OOM */
+        dvmThrowOutOfMemoryError("alloc site native");
+        return NULL;
+    }
+
+    ArrayObject* arrayObj = dvmAllocPrimitiveArray('B', len, ALLOC_DEFAULT);
+    if (arrayObj != NULL)
+        memcpy(arrayObj->contents, data, len);
+    free(data);
+    return arrayObj;
+}
@@ -84,4 +84,11 @@ ArrayObject* dvmDdmGetStackTraceById(u4 threadId);
  */
 ArrayObject* dvmDdmGetRecentAllocations(void);
 
+/*
+ * Gather up the sampled allocation sites and return them in a byte[].
+ *
+ * Returns NULL on failure with an exception raised.
+ */
+ArrayObject* dvmDdmGetAllocationSites(void);
+
 #endif  // DALVIK_DDM_H_
@@ -404,6 +404,29 @@ void dvmDbgActive()
 #endif
 }
 
+/*
+ * Breakpoints, single-step and method entry/exit events are found by
+ * examining every instruction, which forces all threads into the debug
+ * interpreter.  Until the debugger asks for one of those we leave threads
+ * in the fast interpreter; exceptions, thread and class events are posted
+ * from elsewhere and don't need it.
+ *
+ * Called by the JDWP code with the event list lock held, when the number
+ * of such events goes from zero to one or back.
+ */
+void dvmDbgSetInstructionEvents(bool enable)
+{
+    if (gDvm.debuggerInstrEvents == enable)
+        return;
+
+    LOGV("Debugger instruction events %s", enable ? "on" : "off");
+    gDvm.debuggerInstrEvents = enable;
+    if (enable)
+        dvmEnableAllSubMode(kSubModeDebuggerStep);
+    else
+        dvmDisableAllSubMode(kSubModeDebuggerStep);
+}
+
 /*
  * Disable debugging features.
  *
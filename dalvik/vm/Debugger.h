@@ -129,6 +129,12 @@ void dvmDbgConnected(void);
 void dvmDbgActive(void);
 void dvmDbgDisconnected(void);
 
+/*
+ * Turn on or off the per-instruction checks needed for breakpoints,
+ * single-step and method entry/exit events.
+ */
+void dvmDbgSetInstructionEvents(bool enable);
+
 /*
  * Returns "true" if a debugger is connected.  Returns "false" if it's
  * just DDM.
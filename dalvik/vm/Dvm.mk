@@ -217,7 +217,8 @@ ifeq ($(WITH_JIT),true)
 	compiler/SSATransformation.cpp \
 	compiler/Loop.cpp \
 	compiler/Ralloc.cpp \
-	interp/Jit.cpp
+	interp/Jit.cpp \
+	interp/JitProfile.cpp
 endif
 
 LOCAL_C_INCLUDES += \
@@ -19,6 +19,61 @@
  */
 #include "Dalvik.h"
 
+#ifdef HAVE_POSIX_FILEMAP
+# include <sys/mman.h>
+#endif
+
+
+/*
+ * Allocate zero-filled storage for the resolved-entry tables.  With mmap
+ * the pages are handed out by the kernel on first write; without it we
+ * fall back to the native heap.
+ *
+ * Returns NULL on failure.
+ */
+static u1* allocResolvedTables(size_t length, MemMapping* pMap)
+{
+    void* ptr;
+
+    memset(pMap, 0, sizeof(*pMap));
+
+    /* an empty DEX still needs non-NULL table pointers */
+    if (length == 0)
+        length = sizeof(void*);
+
+#ifdef HAVE_POSIX_FILEMAP
+    ptr = mmap(NULL, length, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANON, -1, 0);
+    if (ptr == MAP_FAILED) {
+        LOGW("mmap(%d, RW, PRIVATE|ANON) failed: %s", (int) length,
+            strerror(errno));
+        return NULL;
+    }
+#else
+    ptr = calloc(1, length);
+    if (ptr == NULL)
+        return NULL;
+#endif
+
+    pMap->addr = pMap->baseAddr = ptr;
+    pMap->length = pMap->baseLength = length;
+    return (u1*) ptr;
+}
+
+/*
+ * Release the storage obtained from allocResolvedTables().  Safe to call
+ * on a zeroed MemMapping.
+ */
+static void freeResolvedTables(MemMapping* pMap)
+{
+#ifdef HAVE_POSIX_FILEMAP
+    sysReleaseShmem(pMap);
+#else
+    free(pMap->baseAddr);
+    pMap->baseAddr = NULL;
+    pMap->baseLength = 0;
+#endif
+}
 
 /*
  * Create auxillary data structures.
@@ -36,12 +91,23 @@
  * use the entry for virtual methods that are only called through
  * invoke-virtual-quick), creating the possibility of some space reduction
  * at dexopt time.
+ *
+ * The four tables are carved out of a single private anonymous mapping
+ * rather than the native heap.  Pages we never store into stay backed by
+ * the kernel's zero page, so a process only pays for the parts of each
+ * table it actually resolves.  Because the bootstrap DEX files are opened
+ * in the zygote, everything resolved there before the fork is shared
+ * copy-on-write with the apps; a child dirties a page only when it
+ * resolves something new on it.  The interpreter and JIT index these
+ * tables directly, so they have to stay flat arrays.
  */
 static DvmDex* allocateAuxStructures(DexFile* pDexFile)
 {
     DvmDex* pDvmDex;
     const DexHeader* pHeader;
     u4 stringCount, classCount, methodCount, fieldCount;
+    size_t tableSize;
+    u1* tables;
 
     pDvmDex = (DvmDex*) calloc(1, sizeof(DvmDex));
     if (pDvmDex == NULL)
@@ -57,39 +123,33 @@ static DvmDex* allocateAuxStructures(DexFile* pDexFile)
     methodCount = pHeader->methodIdsSize;
     fieldCount = pHeader->fieldIdsSize;
 
-    pDvmDex->pResStrings = (struct StringObject**)
-        calloc(stringCount, sizeof(struct StringObject*));
-
-    pDvmDex->pResClasses = (struct ClassObject**)
-        calloc(classCount, sizeof(struct ClassObject*));
-
-    pDvmDex->pResMethods = (struct Method**)
-        calloc(methodCount, sizeof(struct Method*));
-
-    pDvmDex->pResFields = (struct Field**)
-        calloc(fieldCount, sizeof(struct Field*));
+    tableSize = (stringCount + classCount + methodCount + fieldCount) *
+        sizeof(void*);
 
     LOGV("+++ DEX %p: allocateAux %d+%d+%d+%d * 4 = %d bytes",
         pDvmDex, stringCount, classCount, methodCount, fieldCount,
-        (stringCount + classCount + methodCount + fieldCount) * 4);
+        (int) tableSize);
 
     pDvmDex->pInterfaceCache = dvmAllocAtomicCache(DEX_INTERFACE_CACHE_SIZE);
 
-    if (pDvmDex->pResStrings == NULL ||
-        pDvmDex->pResClasses == NULL ||
-        pDvmDex->pResMethods == NULL ||
-        pDvmDex->pResFields == NULL ||
-        pDvmDex->pInterfaceCache == NULL)
-    {
+    tables = allocResolvedTables(tableSize, &pDvmDex->resMap);
+
+    if (tables == NULL || pDvmDex->pInterfaceCache == NULL) {
         LOGE("Alloc failure in allocateAuxStructures");
-        free(pDvmDex->pResStrings);
-        free(pDvmDex->pResClasses);
-        free(pDvmDex->pResMethods);
-        free(pDvmDex->pResFields);
+        freeResolvedTables(&pDvmDex->resMap);
+        dvmFreeAtomicCache(pDvmDex->pInterfaceCache);
         free(pDvmDex);
         return NULL;
     }
 
+    pDvmDex->pResStrings = (struct StringObject**) tables;
+    tables += stringCount * sizeof(struct StringObject*);
+    pDvmDex->pResClasses = (struct ClassObject**) tables;
+    tables += classCount * sizeof(struct ClassObject*);
+    pDvmDex->pResMethods = (struct Method**) tables;
+    tables += methodCount * sizeof(struct Method*);
+    pDvmDex->pResFields = (struct Field**) tables;
+
     return pDvmDex;
 
 }
@@ -197,10 +257,7 @@ void dvmDexFileFree(DvmDex* pDvmDex)
     dexFileFree(pDvmDex->pDexFile);
 
     LOGV("+++ DEX %p: freeing aux structs", pDvmDex);
-    free(pDvmDex->pResStrings);
-    free(pDvmDex->pResClasses);
-    free(pDvmDex->pResMethods);
-    free(pDvmDex->pResFields);
+    freeResolvedTables(&pDvmDex->resMap);
     dvmFreeAtomicCache(pDvmDex->pInterfaceCache);
 
     sysReleaseShmem(&pDvmDex->memMap);
@@ -63,6 +63,9 @@ struct DvmDex {
 
     /* lock ensuring mutual exclusion during updates */
     pthread_mutex_t     modLock;
+
+    /* private anonymous mapping backing the pRes* tables */
+    MemMapping          resMap;
 };
 
 
@@ -91,6 +91,7 @@ struct DvmGlobals {
     size_t      heapMaximumSize;
     size_t      heapGrowthLimit;
     size_t      stackSize;
+    size_t      linearAllocMaxSize;     // 0 means use the built-in default
 
     bool        verboseGc;
     bool        verboseJni;
@@ -139,6 +140,9 @@ struct DvmGlobals {
 
     bool        dexOptForSmp;
 
+    /* threads verifying and optimizing classes in dexopt */
+    int         dexOptThreads;
+
     /*
      * GC option flags.
      */
@@ -181,6 +185,13 @@ struct DvmGlobals {
      */
     HashTable*  loadedClasses;
 
+    /*
+     * Direct-mapped cache in front of loadedClasses, indexed by descriptor
+     * hash.  Read without holding the table lock; holds only classes that
+     * were linked when inserted, matched on their defining loader.
+     */
+    ClassObject** classLookupCache;
+
     /*
      * Value for the next class serial number to be assigned.  This is
      * incremented as we load classes.  Failed loads and races may result
@@ -210,6 +221,13 @@ struct DvmGlobals {
     /* Hash table of strings interned by the class loader. */
     HashTable*  literalStrings;
 
+    /*
+     * Direct-mapped cache of entries from both tables, indexed by string
+     * hash and read without internLock.  Literal entries have the low bit
+     * set.
+     */
+    StringObject** internCache;
+
     /*
      * Classes constructed directly by the vm.
      */
@@ -482,6 +500,14 @@ struct DvmGlobals {
      */
     int  sumThreadSuspendCount;
 
+    /*
+     * How long dvmSuspendAllThreads() took to stop everybody, as a
+     * histogram with log2(usec) buckets, and the worst case seen.
+     * Guarded by _threadSuspendLock.
+     */
+    u4   suspendAllHistogram[16];
+    u4   suspendAllMaxUsec;
+
     /*
      * MUTEX ORDERING: when locking multiple mutexes, always grab them in
      * this order to avoid deadlock:
@@ -604,6 +630,7 @@ struct DvmGlobals {
      */
     bool        debuggerConnected;      /* debugger or DDMS is connected */
     bool        debuggerActive;         /* debugger is making requests */
+    bool        debuggerInstrEvents;    /* ...that need every instruction */
     JdwpState*  jdwpState;
 
     /*
@@ -643,6 +670,15 @@ struct DvmGlobals {
     int             allocRecordHead;        /* most-recently-added entry */
     int             allocRecordCount;       /* #of valid entries */
 
+    /*
+     * Allocation site sampling, set up with -Xallocsample or through DDM.
+     * When "allocSampleInterval" is nonzero, about one allocation per that
+     * many bytes is charged to its site in "allocSites".  Also guarded by
+     * allocTrackerLock.
+     */
+    int             allocSampleInterval;
+    AllocSiteTable* allocSites;
+
     /*
      * When a profiler is enabled, this is incremented.  Distinct profilers
      * include "dmtrace" method tracing, emulator method tracing, and
@@ -857,6 +893,17 @@ struct DvmJitGlobals {
     /* Lock to change the protection type of the code cache */
     pthread_mutex_t    codeCacheProtectionLock;
 
+    /* true/false: populate the code cache in the zygote, from -Xjitzygotecache */
+    bool zygoteCodeCache;
+
+    /*
+     * Code cache bytes and trace profile counters inherited from the zygote.
+     * The translations in there are shared copy-on-write with the zygote and
+     * its other children, so they are never patched after the fork.
+     */
+    unsigned int zygoteCacheByteUsed;
+    unsigned int zygoteTraceCounters;
+
     /* Number of times that the code cache has been reset */
     int numCodeCacheReset;
 
@@ -887,9 +934,18 @@ struct DvmJitGlobals {
     /* Periodic trace profiling countdown timer */
     int profileCountdown;
 
+    /* Where the per-APK hot trace profiles live, from -Xjitwarmstart */
+    char* warmProfileDir;
+
+    /* Trace heads compiled in this and earlier runs */
+    struct JitWarmProfile* warmProfile;
+
     /* Vector to disable selected optimizations */
     int disableOpt;
 
+    /* true/false: compile throw-free leaf callees as whole methods */
+    bool wholeMethodJit;
+
     /* Table to track the overall and trace statistics of hot methods */
     HashTable*  methodStatsTable;
 
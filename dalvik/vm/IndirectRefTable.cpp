@@ -50,7 +50,13 @@ bool IndirectRefTable::init(size_t initialCount,
     segmentState.all = IRT_FIRST_SEGMENT;
     alloc_entries_ = initialCount;
     max_entries_ = maxCount;
+    initial_entries_ = initialCount;
     kind_ = desiredKind;
+    free_head_ = -1;
+    serial_seed_ = 0;
+    peak_entries_ = 0;
+    holes_filled_ = 0;
+    holes_scanned_ = 0;
 
     return true;
 }
@@ -65,6 +71,82 @@ void IndirectRefTable::destroy()
     table_ = NULL;
     slot_data_ = NULL;
     alloc_entries_ = max_entries_ = -1;
+    free_head_ = -1;
+}
+
+/*
+ * Grow or shrink the storage to "newSize" entries.  Everything in use must
+ * fit in the new size.
+ *
+ * Returns "false" if the allocation failed, in which case the table is
+ * left as it was.
+ */
+bool IndirectRefTable::resize(size_t newSize)
+{
+    assert(newSize >= segmentState.parts.topIndex);
+    assert(newSize <= max_entries_);
+
+    if (newSize < alloc_entries_) {
+        /*
+         * Remember the highest serial we're about to throw away, so that
+         * the slots we hand out the next time we grow can't be mistaken
+         * for the ones that were here before.
+         */
+        for (size_t i = newSize; i < alloc_entries_; i++) {
+            if (slot_data_[i].serial >= serial_seed_) {
+                serial_seed_ = slot_data_[i].serial + 1;
+            }
+        }
+    }
+
+    Object** newTable = (Object**) realloc(table_, newSize * sizeof(Object*));
+    if (newTable == NULL) {
+        return false;
+    }
+    table_ = newTable;
+    IndirectRefSlot* newSlots =
+            (IndirectRefSlot*) realloc(slot_data_, newSize * sizeof(IndirectRefSlot));
+    if (newSlots != NULL) {
+        slot_data_ = newSlots;
+    } else if (newSize > alloc_entries_) {
+        return false;
+    }
+    /* else: an oversized slot_data_ is harmless, and "table_" already shrank */
+
+    // Clear the newly-allocated slot_data_ elements.
+    for (size_t i = alloc_entries_; i < newSize; i++) {
+        memset(&slot_data_[i], 0, sizeof(IndirectRefSlot));
+        slot_data_[i].serial = serial_seed_;
+    }
+
+    alloc_entries_ = newSize;
+    return true;
+}
+
+/*
+ * Give back storage left over from an earlier spike.  We wait until the
+ * table is down to a quarter of its allocation and then halve it, which
+ * leaves enough headroom that a table hovering around one size doesn't
+ * keep bouncing between two allocations.
+ */
+void IndirectRefTable::maybeShrink()
+{
+    size_t topIndex = segmentState.parts.topIndex;
+    if (alloc_entries_ <= initial_entries_ || topIndex > alloc_entries_ / 4) {
+        return;
+    }
+
+    size_t newSize = alloc_entries_ / 2;
+    if (newSize < initial_entries_) {
+        newSize = initial_entries_;
+    }
+    LOGV("+++ shrinking %s table from %d to %d (top=%d)",
+        indirectRefKindToString(kind_), alloc_entries_, newSize, topIndex);
+    if (!resize(newSize)) {
+        /* not fatal; we just keep the larger allocation */
+        LOGW("Unable to shrink %s reference table to %d entries",
+            indirectRefKindToString(kind_), newSize);
+    }
 }
 
 /*
@@ -95,7 +177,9 @@ IndirectRef IndirectRefTable::add(u4 cookie, Object* obj)
     assert(alloc_entries_ <= max_entries_);
     assert(segmentState.parts.numHoles >= prevState.parts.numHoles);
 
-    if (topIndex == alloc_entries_) {
+    /* a segment with holes in it always has room */
+    int numHoles = segmentState.parts.numHoles - prevState.parts.numHoles;
+    if (numHoles == 0 && topIndex == alloc_entries_) {
         /* reached end of allocated space; did we hit buffer max? */
         if (topIndex == max_entries_) {
             LOGE("JNI ERROR (app bug): %s reference table overflow (max=%d)",
@@ -110,20 +194,13 @@ IndirectRef IndirectRefTable::add(u4 cookie, Object* obj)
         }
         assert(newSize > alloc_entries_);
 
-        table_ = (Object**) realloc(table_, newSize * sizeof(Object*));
-        slot_data_ = (IndirectRefSlot*) realloc(slot_data_, newSize * sizeof(IndirectRefSlot));
-        if (table_ == NULL || slot_data_ == NULL) {
+        if (!resize(newSize)) {
             LOGE("JNI ERROR (app bug): unable to expand %s reference table (from %d to %d, max=%d)",
                     indirectRefKindToString(kind_),
                     alloc_entries_, newSize, max_entries_);
             dump(indirectRefKindToString(kind_));
             dvmAbort();
         }
-
-        // Clear the newly-allocated slot_data_ elements.
-        memset(slot_data_ + alloc_entries_, 0, (newSize - alloc_entries_) * sizeof(IndirectRefSlot));
-
-        alloc_entries_ = newSize;
     }
 
     /*
@@ -132,8 +209,18 @@ IndirectRef IndirectRefTable::add(u4 cookie, Object* obj)
      * add to the end of the list.
      */
     IndirectRef result;
-    int numHoles = segmentState.parts.numHoles - prevState.parts.numHoles;
-    if (numHoles > 0) {
+    if (numHoles > 0 && usesFreeList()) {
+        /* take the most recently opened hole */
+        int idx = free_head_;
+        assert(idx >= 0 && idx < (int) topIndex);
+        assert(table_[idx] == NULL);
+        unlinkHole(idx);
+        updateSlotAdd(obj, idx);
+        result = toIndirectRef(obj, idx);
+        table_[idx] = obj;
+        segmentState.parts.numHoles--;
+        holes_filled_++;
+    } else if (numHoles > 0) {
         assert(topIndex > 1);
         /* find the first hole; likely to be near the end of the list */
         Object** pScan = &table_[topIndex - 1];
@@ -141,16 +228,21 @@ IndirectRef IndirectRefTable::add(u4 cookie, Object* obj)
         while (*--pScan != NULL) {
             assert(pScan >= table_ + prevState.parts.topIndex);
         }
+        holes_scanned_ += &table_[topIndex - 1] - pScan;
         updateSlotAdd(obj, pScan - table_);
         result = toIndirectRef(obj, pScan - table_);
         *pScan = obj;
         segmentState.parts.numHoles--;
+        holes_filled_++;
     } else {
         /* add to the end */
         updateSlotAdd(obj, topIndex);
         result = toIndirectRef(obj, topIndex);
         table_[topIndex++] = obj;
         segmentState.parts.topIndex = topIndex;
+        if (topIndex > peak_entries_) {
+            peak_entries_ = topIndex;
+        }
     }
 
     assert(result != NULL);
@@ -278,6 +370,9 @@ bool IndirectRefTable::remove(u4 cookie, IndirectRef iref)
                     break;
                 }
                 LOGV("+++ ate hole at %d", topIndex-1);
+                if (usesFreeList()) {
+                    unlinkHole(topIndex-1);
+                }
                 numHoles--;
             }
             segmentState.parts.numHoles = numHoles + prevState.parts.numHoles;
@@ -286,6 +381,7 @@ bool IndirectRefTable::remove(u4 cookie, IndirectRef iref)
             segmentState.parts.topIndex = topIndex-1;
             LOGV("+++ ate last entry %d", topIndex-1);
         }
+        maybeShrink();
     } else {
         /*
          * Not the top-most entry.  This creates a hole.  We NULL out the
@@ -301,6 +397,9 @@ bool IndirectRefTable::remove(u4 cookie, IndirectRef iref)
         }
 
         table_[idx] = NULL;
+        if (usesFreeList()) {
+            pushHole(idx);
+        }
         segmentState.parts.numHoles++;
         LOGV("+++ left hole at %d, holes=%d", idx, segmentState.parts.numHoles);
     }
@@ -322,4 +421,7 @@ const char* indirectRefKindToString(IndirectRefKind kind)
 void IndirectRefTable::dump(const char* descr) const
 {
     dvmDumpReferenceTableContents(table_, capacity(), descr);
+    LOGW("%s: top=%d holes=%d alloc=%d peak=%d (holes filled=%u, scanned=%u)",
+        descr, segmentState.parts.topIndex, segmentState.parts.numHoles,
+        alloc_entries_, peak_entries_, holes_filled_, holes_scanned_);
 }
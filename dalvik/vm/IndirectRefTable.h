@@ -119,6 +119,8 @@ INLINE IndirectRefKind indirectRefKind(IndirectRef iref)
 struct IndirectRefSlot {
     u4          serial;         /* slot serial */
     Object*     previous[kIRTPrevCount];
+    int         nextHole;       /* free list links, -1 if none */
+    int         prevHole;
 };
 
 /* use as initial value for "cookie", and when table has only one segment */
@@ -176,10 +178,17 @@ struct IndirectRefSlot {
  * stale references aren't possible (though we may be able to get similar
  * benefits with other approaches).
  *
- * TODO: consider a "lastDeleteIndex" for quick hole-filling when an
- * add immediately follows a delete; must invalidate after segment pop
- * (which could increase the cost/complexity of method call/return).
- * Might be worth only using it for JNI globals.
+ * Tables that only ever have one segment (JNI globals and weak globals)
+ * also keep their holes on a doubly-linked free list threaded through
+ * "slot_data_", so that filling a hole doesn't require a scan and eating
+ * holes off the top can unlink them in constant time.  The list can't be
+ * used for JNI locals, because the interpreter pops segments with a bare
+ * store to "segmentState" and never tells us which holes went away.
+ *
+ * An expandable table that has shrunk back down after a spike gives some
+ * of its storage back when the top-most entry is removed.  Slots that are
+ * released this way have their serial numbers carried over to the slots
+ * that later replace them, so stale references still fail the check.
  *
  * TODO: may want completely different add/remove algorithms for global
  * and local refs to improve performance.  A large circular buffer might
@@ -263,9 +272,17 @@ public:
     size_t          alloc_entries_;
     /* max #of entries allowed */
     size_t          max_entries_;
-
-    // TODO: want hole-filling stats (#of holes filled, total entries scanned)
-    //       for performance evaluation.
+    /* #of entries we started with; we never shrink below this */
+    size_t          initial_entries_;
+    /* first hole on the free list, or -1 (single-segment tables only) */
+    int             free_head_;
+    /* serial given to newly-allocated slots */
+    u4              serial_seed_;
+
+    /* usage stats, reported by dump() */
+    size_t          peak_entries_;
+    u4              holes_filled_;
+    u4              holes_scanned_;
 
     /*
      * Add a new entry.  "obj" must be a valid non-NULL object reference
@@ -370,6 +387,38 @@ private:
         return (IndirectRef) uref;
     }
 
+    /*
+     * The free list is only valid when there are no segments to pop.
+     */
+    bool usesFreeList() const {
+        return kind_ != kIndirectKindLocal;
+    }
+
+    /*
+     * Link or unlink the hole at "idx" on the free list.
+     */
+    void pushHole(int idx) {
+        IndirectRefSlot* pSlot = &slot_data_[idx];
+        pSlot->prevHole = -1;
+        pSlot->nextHole = free_head_;
+        if (free_head_ >= 0) {
+            slot_data_[free_head_].prevHole = idx;
+        }
+        free_head_ = idx;
+    }
+    void unlinkHole(int idx) {
+        IndirectRefSlot* pSlot = &slot_data_[idx];
+        if (pSlot->prevHole >= 0) {
+            slot_data_[pSlot->prevHole].nextHole = pSlot->nextHole;
+        } else {
+            assert(free_head_ == idx);
+            free_head_ = pSlot->nextHole;
+        }
+        if (pSlot->nextHole >= 0) {
+            slot_data_[pSlot->nextHole].prevHole = pSlot->prevHole;
+        }
+    }
+
     /*
      * Update extended debug info when an entry is added.
      *
@@ -384,6 +433,10 @@ private:
         }
     }
 
+    /* storage management */
+    bool resize(size_t newSize);
+    void maybeShrink();
+
     /* extra debugging checks */
     bool getChecked(IndirectRef) const;
     bool checkEntry(const char*, IndirectRef, int) const;
@@ -35,6 +35,9 @@
 #define kMinHeapSize        (2*1024*1024)
 #define kMaxHeapSize        (1*1024*1024*1024)
 
+#define kMinLinearAllocSize (1*1024*1024)
+#define kMaxLinearAllocSize (256*1024*1024)
+
 /*
  * Register VM-agnostic native methods for system classes.
  */
@@ -115,12 +118,15 @@ static void usage(const char* progName)
     dvmFprintf(stderr, "  -Xjniopts:{warnonly,forcecopy}\n");
     dvmFprintf(stderr, "  -Xjnitrace:substring (eg NativeClass or nativeMethod)\n");
     dvmFprintf(stderr, "  -Xstacktracefile:<filename>\n");
+    dvmFprintf(stderr, "  -Xallocsample:<bytes>\n");
     dvmFprintf(stderr, "  -Xgc:[no]precise\n");
     dvmFprintf(stderr, "  -Xgc:[no]preverify\n");
     dvmFprintf(stderr, "  -Xgc:[no]postverify\n");
     dvmFprintf(stderr, "  -Xgc:[no]concurrent\n");
     dvmFprintf(stderr, "  -Xgc:[no]verifycardtable\n");
     dvmFprintf(stderr, "  -XX:+DisableExplicitGC\n");
+    dvmFprintf(stderr, "  -XX:LinearAllocMax=N  (must be multiple of 1K, %dMB to %dMB)\n",
+        kMinLinearAllocSize / (1024*1024), kMaxLinearAllocSize / (1024*1024));
     dvmFprintf(stderr, "  -X[no]genregmap\n");
     dvmFprintf(stderr, "  -Xverifyopt:[no]checkmon\n");
     dvmFprintf(stderr, "  -Xcheckdexsum\n");
@@ -138,6 +144,9 @@ static void usage(const char* progName)
     dvmFprintf(stderr, "  -Xjitprofile\n");
     dvmFprintf(stderr, "  -Xjitdisableopt\n");
     dvmFprintf(stderr, "  -Xjitsuspendpoll\n");
+    dvmFprintf(stderr, "  -Xjitwholemethod\n");
+    dvmFprintf(stderr, "  -Xjitwarmstart:<directory>\n");
+    dvmFprintf(stderr, "  -Xjitzygotecache\n");
 #endif
     dvmFprintf(stderr, "\n");
     dvmFprintf(stderr, "Configured with:"
@@ -795,6 +804,22 @@ static int processOptions(int argc, const char* const argv[],
                 dvmFprintf(stderr, "Invalid -XX:HeapGrowthLimit option '%s'\n", argv[i]);
                 return -1;
             }
+        } else if (strncmp(argv[i], "-XX:LinearAllocMax=", 19) == 0) {
+            size_t val = parseMemOption(argv[i] + 19, 1024);
+            if (val != 0) {
+                if (val >= kMinLinearAllocSize && val <= kMaxLinearAllocSize) {
+                    gDvm.linearAllocMaxSize = val;
+                } else {
+                    dvmFprintf(stderr,
+                        "Invalid -XX:LinearAllocMax '%s', range is %dMB to %dMB\n",
+                        argv[i], kMinLinearAllocSize / (1024*1024),
+                        kMaxLinearAllocSize / (1024*1024));
+                    return -1;
+                }
+            } else {
+                dvmFprintf(stderr, "Invalid -XX:LinearAllocMax option '%s'\n", argv[i]);
+                return -1;
+            }
         } else if (strncmp(argv[i], "-Xss", 4) == 0) {
             size_t val = parseMemOption(argv[i]+4, 1);
             if (val != 0) {
@@ -905,6 +930,14 @@ static int processOptions(int argc, const char* const argv[],
                 return -1;
             }
             gDvm.jniGrefLimit = lim;
+        } else if (strncmp(argv[i], "-Xallocsample:", 14) == 0) {
+            int interval = atoi(argv[i] + 14);
+            if (interval <= 0) {
+                dvmFprintf(stderr, "Bad value for -Xallocsample: '%s'\n",
+                    argv[i]+14);
+                return -1;
+            }
+            gDvm.allocSampleInterval = interval;
         } else if (strncmp(argv[i], "-Xjnitrace:", 11) == 0) {
             gDvm.jniTrace = strdup(argv[i] + 11);
         } else if (strcmp(argv[i], "-Xlog-stdio") == 0) {
@@ -964,6 +997,12 @@ static int processOptions(int argc, const char* const argv[],
           }
         } else if (strncmp(argv[i], "-Xjitsuspendpoll", 16) == 0) {
           gDvmJit.genSuspendPoll = true;
+        } else if (strncmp(argv[i], "-Xjitwholemethod", 16) == 0) {
+          gDvmJit.wholeMethodJit = true;
+        } else if (strncmp(argv[i], "-Xjitwarmstart:", 15) == 0) {
+          gDvmJit.warmProfileDir = strdup(argv[i] + 15);
+        } else if (strncmp(argv[i], "-Xjitzygotecache", 16) == 0) {
+          gDvmJit.zygoteCodeCache = true;
 #endif
 
         } else if (strncmp(argv[i], "-Xstacktracefile:", 17) == 0) {
@@ -1056,6 +1095,7 @@ static void setCommandLineDefaults()
     gDvm.heapMaximumSize = 16 * 1024 * 1024;  // Spec says 75% physical mem
     gDvm.heapGrowthLimit = 0;  // 0 means no growth limit
     gDvm.stackSize = kDefaultStackSize;
+    gDvm.linearAllocMaxSize = 0;    // LinearAlloc picks its own default
 
     gDvm.concurrentMarkSweep = true;
 
@@ -1359,7 +1399,9 @@ std::string dvmStartup(int argc, const char* const argv[],
 
     /*
      * Init for either zygote mode or non-zygote mode.  The key difference
-     * is that we don't start any additional threads in Zygote mode.
+     * is that we don't start any additional threads in Zygote mode (save
+     * for the compiler thread with -Xjitzygotecache, which is stopped again
+     * before the first fork).
      */
     if (gDvm.zygote) {
         if (!initZygote()) {
@@ -1430,6 +1472,17 @@ static bool initZygote()
     /* zygote goes into its own process group */
     setpgid(0,0);
 
+#ifdef WITH_JIT
+    /*
+     * Compile what the framework preload finds hot here, so that every
+     * child starts out with the same translations mapped in.
+     */
+    if (gDvm.executionMode == kExecutionModeJit && gDvmJit.zygoteCodeCache) {
+        if (!dvmCompilerStartup())
+            return false;
+    }
+#endif
+
     return true;
 }
 
@@ -1600,6 +1653,12 @@ int dvmPrepForDexOpt(const char* bootClassPath, DexOptimizerMode dexOptMode,
     } else {
         gDvm.dexOptForSmp = (ANDROID_SMP != 0);
     }
+    gDvm.dexOptThreads = 1;
+    if (dexoptFlags & DEXOPT_PARALLEL) {
+        long numCpus = sysconf(_SC_NPROCESSORS_ONLN);
+        if (numCpus > 1)
+            gDvm.dexOptThreads = (int) numCpus;
+    }
 
     /*
      * Initialize the heap, some basic thread control mutexes, and
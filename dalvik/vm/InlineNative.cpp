@@ -22,6 +22,12 @@
 
 #include <math.h>
 
+#if defined(__ARM_NEON__)
+# include <arm_neon.h>
+#elif defined(__SSE2__)
+# include <emmintrin.h>
+#endif
+
 #ifdef HAVE__MEMCMP16
 /* hand-coded assembly implementation, available on some platforms */
 //#warning "trying memcmp16"
@@ -115,6 +121,101 @@ static bool org_apache_harmony_dalvik_NativeTestTarget_emptyInlineMethod(
 }
 
 
+/*
+ * ===========================================================================
+ *      Character array scanning
+ * ===========================================================================
+ */
+
+/*
+ * These look at 8 chars at a time with NEON or SSE2 when the target has
+ * it, and fall back to a plain loop for whatever is left over.  Only whole
+ * blocks are loaded, so we never read past the end of the data.
+ *
+ * On NEON, moving a result from a vector register to a core register is
+ * expensive, so we fold the comparison down to 64 bits and only make one
+ * such move per block.
+ */
+#define kCharBlock  8
+
+#if defined(__ARM_NEON__) || defined(__SSE2__)
+# define HAVE_VECTOR_CHARS
+#endif
+
+#if defined(__ARM_NEON__)
+static inline bool anyNonZero(uint16x8_t v)
+{
+    uint32x2_t fold = vreinterpret_u32_u16(vorr_u16(vget_low_u16(v),
+                                                    vget_high_u16(v)));
+    return (vget_lane_u32(fold, 0) | vget_lane_u32(fold, 1)) != 0;
+}
+#endif
+
+/*
+ * Returns the index of the first position where "s0" and "s1" differ,
+ * or "count" if they're the same.
+ */
+static inline int firstCharDiff(const u2* s0, const u2* s1, int count)
+{
+    int i = 0;
+
+#if defined(__ARM_NEON__)
+    for ( ; i + kCharBlock <= count; i += kCharBlock) {
+        uint16x8_t diff = veorq_u16(vld1q_u16(s0 + i), vld1q_u16(s1 + i));
+        if (anyNonZero(diff))
+            break;
+    }
+#elif defined(__SSE2__)
+    for ( ; i + kCharBlock <= count; i += kCharBlock) {
+        __m128i eq = _mm_cmpeq_epi16(
+            _mm_loadu_si128((const __m128i*) (s0 + i)),
+            _mm_loadu_si128((const __m128i*) (s1 + i)));
+        int mask = _mm_movemask_epi8(eq);
+        if (mask != 0xffff)
+            return i + __builtin_ctz(~mask) / 2;
+    }
+#endif
+
+    for ( ; i < count; i++) {
+        if (s0[i] != s1[i])
+            break;
+    }
+    return i;
+}
+
+/*
+ * Returns the index of the first "ch" in chars[start..count), or -1.
+ */
+static inline int findChar(const u2* chars, int start, int count, u2 ch)
+{
+    int i = start;
+
+#if defined(__ARM_NEON__)
+    uint16x8_t needle = vdupq_n_u16(ch);
+    for ( ; i + kCharBlock <= count; i += kCharBlock) {
+        if (anyNonZero(vceqq_u16(vld1q_u16(chars + i), needle)))
+            break;
+    }
+#elif defined(__SSE2__)
+    __m128i needle = _mm_set1_epi16((short) ch);
+    for ( ; i + kCharBlock <= count; i += kCharBlock) {
+        int mask = _mm_movemask_epi8(_mm_cmpeq_epi16(
+            _mm_loadu_si128((const __m128i*) (chars + i)), needle));
+        if (mask != 0)
+            return i + __builtin_ctz(mask) / 2;
+    }
+#endif
+
+    const u2* ptr = chars + i;
+    const u2* endPtr = chars + count;
+    while (ptr < endPtr) {
+        if (*ptr++ == ch)
+            return (ptr-1) - chars;
+    }
+    return -1;
+}
+
+
 /*
  * ===========================================================================
  *      java.lang.String
@@ -241,7 +342,18 @@ bool javaLangString_compareTo(u4 arg0, u4 arg1, u4 arg2, u4 arg3,
     thisChars = ((const u2*)(void*)thisArray->contents) + thisOffset;
     compChars = ((const u2*)(void*)compArray->contents) + compOffset;
 
-#ifdef HAVE__MEMCMP16
+#if defined(HAVE_VECTOR_CHARS)
+    /*
+     * Find the first mismatch a block at a time, then return the
+     * difference between the characters there.
+     */
+    int i = firstCharDiff(thisChars, compChars, minCount);
+    if (i < minCount) {
+        pResult->i = (s4) thisChars[i] - (s4) compChars[i];
+        return true;
+    }
+
+#elif defined(HAVE__MEMCMP16)
     /*
      * Use assembly version, which returns the difference between the
      * characters.  The annoying part here is that 0x00e9 - 0xffff != 0x00ea,
@@ -362,7 +474,9 @@ bool javaLangString_equals(u4 arg0, u4 arg1, u4 arg2, u4 arg3,
     thisChars = ((const u2*)(void*)thisArray->contents) + thisOffset;
     compChars = ((const u2*)(void*)compArray->contents) + compOffset;
 
-#ifdef HAVE__MEMCMP16
+#if defined(HAVE_VECTOR_CHARS)
+    pResult->i = (firstCharDiff(thisChars, compChars, thisCount) == thisCount);
+#elif defined(HAVE__MEMCMP16)
     pResult->i = (__memcmp16(thisChars, compChars, thisCount) == 0);
 # ifdef CHECK_MEMCMP16
     int otherRes = (memcmp(thisChars, compChars, thisCount * 2) == 0);
@@ -446,9 +560,6 @@ bool javaLangString_isEmpty(u4 arg0, u4 arg1, u4 arg2, u4 arg3,
  */
 static inline int indexOfCommon(Object* strObj, int ch, int start)
 {
-    //if ((ch & 0xffff) != ch)        /* 32-bit code point */
-    //    return -1;
-
     /* pull out the basic elements */
     ArrayObject* charArray =
         (ArrayObject*) dvmGetFieldObject(strObj, STRING_FIELDOFF_VALUE);
@@ -464,24 +575,11 @@ static inline int indexOfCommon(Object* strObj, int ch, int start)
     if (start < 0)
         start = 0;
 
-#if 0
-    /* 16-bit loop, simple */
-    while (start < count) {
-        if (chars[start] == ch)
-            return start;
-        start++;
-    }
-#else
-    /* 16-bit loop, slightly better on ARM */
-    const u2* ptr = chars + start;
-    const u2* endPtr = chars + count;
-    while (ptr < endPtr) {
-        if (*ptr++ == ch)
-            return (ptr-1) - chars;
-    }
-#endif
+    /* a char can't match a value outside of the 16-bit range */
+    if ((ch & 0xffff) != ch)
+        return -1;
 
-    return -1;
+    return findChar(chars, start, count, (u2) ch);
 }
 
 /*
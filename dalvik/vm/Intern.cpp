@@ -20,6 +20,12 @@
 
 #include <stddef.h>
 
+/* number of entries in gDvm.internCache; must be power of 2 */
+#define kInternCacheSize    4096
+
+/* tag for literal strings in gDvm.internCache */
+#define kInternCacheLiteral 0x1
+
 /*
  * Prep string interning.
  */
@@ -32,6 +38,9 @@ bool dvmStringInternStartup()
     gDvm.literalStrings = dvmHashTableCreate(256, NULL);
     if (gDvm.literalStrings == NULL)
         return false;
+    /* not fatal if this fails, we just always take the lock */
+    gDvm.internCache = (StringObject**)
+        calloc(kInternCacheSize, sizeof(StringObject*));
     return true;
 }
 
@@ -49,6 +58,52 @@ void dvmStringInternShutdown()
     gDvm.internedStrings = NULL;
     dvmHashTableFree(gDvm.literalStrings);
     gDvm.literalStrings = NULL;
+    free(gDvm.internCache);
+    gDvm.internCache = NULL;
+}
+
+/*
+ * Look for "strObj" in the intern cache.  This doesn't take internLock.
+ * Entries are only ever replaced under the lock, and weak entries are
+ * dropped while the GC has every thread suspended, so whatever we read
+ * here is a live interned string.
+ *
+ * If "literalOnly" is set, entries from the weak table are ignored, since
+ * the caller would have to move them to the literal table.
+ */
+static StringObject* lookupCachedString(u4 key, StringObject* strObj,
+    bool literalOnly)
+{
+    if (gDvm.internCache == NULL)
+        return NULL;
+
+    uintptr_t entry = (uintptr_t) android_atomic_acquire_load(
+            (int32_t*) &gDvm.internCache[key & (kInternCacheSize-1)]);
+    if (entry == 0)
+        return NULL;
+    if (literalOnly && (entry & kInternCacheLiteral) == 0)
+        return NULL;
+
+    StringObject* cached = (StringObject*) (entry & ~kInternCacheLiteral);
+    if (dvmHashcmpStrings(cached, strObj) != 0)
+        return NULL;
+    return cached;
+}
+
+/*
+ * Publish an interned string in the cache.  The caller must hold
+ * internLock.
+ */
+static void cacheString(u4 key, StringObject* strObj, bool isLiteral)
+{
+    if (gDvm.internCache == NULL)
+        return;
+
+    uintptr_t entry = (uintptr_t) strObj;
+    if (isLiteral)
+        entry |= kInternCacheLiteral;
+    android_atomic_release_store((int32_t) entry,
+        (int32_t*) &gDvm.internCache[key & (kInternCacheSize-1)]);
 }
 
 static StringObject* lookupString(HashTable* table, u4 key, StringObject* value)
@@ -74,7 +129,19 @@ static StringObject* lookupInternedString(StringObject* strObj, bool isLiteral)
 
     assert(strObj != NULL);
     u4 key = dvmComputeStringHash(strObj);
+
+    /*
+     * The literal table never shrinks and doesn't change much after
+     * startup, so most lookups are satisfied here without the lock.
+     * Only one string per value is ever interned across both tables, so
+     * any hit is the right answer for a non-literal lookup.
+     */
+    found = lookupCachedString(key, strObj, isLiteral);
+    if (found != NULL)
+        return found;
+
     dvmLockMutex(&gDvm.internLock);
+    bool foundLiteral;
     if (isLiteral) {
         /*
          * Check the literal table for a match.
@@ -108,11 +175,13 @@ static StringObject* lookupInternedString(StringObject* strObj, bool isLiteral)
                 assert(found == strObj);
             }
         }
+        foundLiteral = true;
     } else {
         /*
          * Check the literal table for a match.
          */
         found = lookupString(gDvm.literalStrings, key, strObj);
+        foundLiteral = (found != NULL);
         if (found == NULL) {
             /*
              * No match was found in the literal table.  Insert into
@@ -122,6 +191,7 @@ static StringObject* lookupInternedString(StringObject* strObj, bool isLiteral)
         }
     }
     assert(found != NULL);
+    cacheString(key, found, foundLiteral);
     dvmUnlockMutex(&gDvm.internLock);
     return found;
 }
@@ -174,6 +244,21 @@ void dvmGcDetachDeadInternedStrings(int (*isUnmarkedObject)(void *))
     if (gDvm.internedStrings != NULL) {
         dvmLockMutex(&gDvm.internLock);
         dvmHashForeachRemove(gDvm.internedStrings, isUnmarkedObject);
+
+        /*
+         * Drop cached weak strings that are going away.  Literals are
+         * immortal and stay put.
+         */
+        if (gDvm.internCache != NULL) {
+            for (int i = 0; i < kInternCacheSize; i++) {
+                uintptr_t entry = (uintptr_t) gDvm.internCache[i];
+                if (entry != 0 && (entry & kInternCacheLiteral) == 0 &&
+                    (*isUnmarkedObject)((void*) entry))
+                {
+                    gDvm.internCache[i] = NULL;
+                }
+            }
+        }
         dvmUnlockMutex(&gDvm.internLock);
     }
 }
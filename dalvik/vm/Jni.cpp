@@ -744,7 +744,9 @@ static bool dvmRegisterJNIMethod(ClassObject* clazz, const char* methodName,
     }
 
     // If a signature starts with a '!', we take that as a sign that the native code doesn't
-    // need the extra JNI arguments (the JNIEnv* and the jclass).
+    // need the extra JNI arguments (the JNIEnv* and the jclass).  If it also only takes and
+    // returns primitives, it's called without leaving THREAD_RUNNING (see
+    // dvmCallCriticalJNIMethod), so it must not block.
     bool fastJni = false;
     if (*signature == '!') {
         fastJni = true;
@@ -845,6 +847,13 @@ void dvmUseJNIBridge(Method* method, void* func) {
     }
 
     DalvikBridgeFunc bridge = gDvmJni.useCheckJni ? dvmCheckCallJNIMethod : dvmCallJNIMethod;
+
+    // A fast JNI method that only deals in primitives has nothing for the
+    // bridge or CheckJNI to do, so it can be called directly.
+    if (method->fastJni && method->noRef && method->shorty[0] != 'L' &&
+            !method->shouldTrace) {
+        bridge = dvmCallCriticalJNIMethod;
+    }
     dvmSetNativeFunc(method, bridge, (const u2*) func);
 }
 
@@ -1215,6 +1224,32 @@ void dvmCallJNIMethod(const u4* args, JValue* pResult, const Method* method, Thr
     }
 }
 
+/*
+ * Bridge for fast JNI methods whose arguments and return value are all
+ * primitives.  There are no references to add to the local frame and the
+ * native code has no JNIEnv* to call back into the VM with, so we skip
+ * both the local references and the switch to THREAD_NATIVE.  The thread
+ * stays THREAD_RUNNING for the duration of the call, so these methods
+ * must be short and must never block.
+ *
+ * The native code still receives the (NULL) JNIEnv* and the jclass
+ * slots, so it has the same signature as any other static native.
+ */
+void dvmCallCriticalJNIMethod(const u4* args, JValue* pResult, const Method* method,
+        Thread* self) {
+    assert(method->fastJni && method->noRef);
+    assert(dvmIsStaticMethod(method) && !dvmIsSynchronizedMethod(method));
+
+    ANDROID_MEMBAR_FULL();      /* guarantee ordering on method->insns */
+    assert(method->insns != NULL);
+
+    // The class is only passed so that dvmPlatformInvoke treats this as a
+    // static call; without a JNIEnv* the native code can't use it.
+    dvmPlatformInvoke(NULL, method->clazz,
+            method->jniArgInfo, method->insSize, (u4*) args, method->shorty,
+            (void*) method->insns, pResult);
+}
+
 /*
  * Extract the return type enum from the "jniArgInfo" field.
  */
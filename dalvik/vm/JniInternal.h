@@ -107,6 +107,8 @@ void dvmCallJNIMethod(const u4* args, JValue* pResult,
     const Method* method, Thread* self);
 void dvmCheckCallJNIMethod(const u4* args, JValue* pResult,
     const Method* method, Thread* self);
+void dvmCallCriticalJNIMethod(const u4* args, JValue* pResult,
+    const Method* method, Thread* self);
 
 /*
  * Configure "method" to use the JNI bridge to call "func".
@@ -61,6 +61,11 @@ this for free in a given block.
 A NULL value for the "classLoader" argument refers to the bootstrap class
 loader, which is never unloaded (until the VM shuts down).
 
+The region is reserved up front at its maximum size (-XX:LinearAllocMax)
+but pages start out PROT_NONE and are only touched as the allocation
+pointer reaches them, so a large reservation costs address space rather
+than memory.
+
 Because the memory is not expected to be updated, we can use mprotect to
 guard the pages on debug builds.  Handy when tracking down corruption.
 */
@@ -69,7 +74,10 @@ guard the pages on debug builds.  Handy when tracking down corruption.
 #define BLOCK_ALIGN         8
 
 /* default length of memory segment (worst case is probably "dexopt") */
-#define DEFAULT_MAX_LENGTH  (8*1024*1024)
+#define DEFAULT_MAX_LENGTH  (16*1024*1024)
+
+/* log a warning once usage crosses this percentage of the region */
+#define WARN_FULL_PERCENT   75
 
 /* leave enough space for a length word */
 #define HEADER_EXTRA        4
@@ -112,8 +120,9 @@ LinearAllocHdr* dvmLinearAllocCreate(Object* classLoader)
 #endif
     LinearAllocHdr* pHdr;
 
-    pHdr = (LinearAllocHdr*) malloc(sizeof(*pHdr));
-
+    pHdr = (LinearAllocHdr*) calloc(1, sizeof(*pHdr));
+    if (pHdr == NULL)
+        return NULL;
 
     /*
      * "curOffset" points to the location of the next pre-block header,
@@ -127,12 +136,17 @@ LinearAllocHdr* dvmLinearAllocCreate(Object* classLoader)
     assert(BLOCK_ALIGN >= HEADER_EXTRA);
     pHdr->curOffset = pHdr->firstOffset =
         (BLOCK_ALIGN-HEADER_EXTRA) + SYSTEM_PAGE_SIZE;
-    pHdr->mapLength = DEFAULT_MAX_LENGTH;
+    if (gDvm.linearAllocMaxSize != 0) {
+        pHdr->mapLength = (gDvm.linearAllocMaxSize + SYSTEM_PAGE_SIZE-1)
+                            & ~(SYSTEM_PAGE_SIZE-1);
+    } else {
+        pHdr->mapLength = DEFAULT_MAX_LENGTH;
+    }
 
 #ifdef USE_ASHMEM
     int fd;
 
-    fd = ashmem_create_region("dalvik-LinearAlloc", DEFAULT_MAX_LENGTH);
+    fd = ashmem_create_region("dalvik-LinearAlloc", pHdr->mapLength);
     if (fd < 0) {
         LOGE("ashmem LinearAlloc failed %s", strerror(errno));
         free(pHdr);
@@ -314,9 +328,21 @@ void* dvmLinearAlloc(Object* classLoader, size_t size)
          */
         LOGE("LinearAlloc exceeded capacity (%d), last=%d",
             pHdr->mapLength, (int) size);
+        LOGE("LinearAlloc %d allocations, %d freed (%d bytes);"
+             " raise the limit with -XX:LinearAllocMax",
+            pHdr->allocCount, pHdr->freeCount, pHdr->freeBytes);
         dvmAbort();
     }
 
+    if (!pHdr->warnedNearlyFull &&
+        nextOffset / (pHdr->mapLength / 100) >= WARN_FULL_PERCENT)
+    {
+        LOGW("LinearAlloc %p is %d%% full (%d of %d, %d freed)",
+            classLoader, WARN_FULL_PERCENT, nextOffset, pHdr->mapLength,
+            pHdr->freeBytes);
+        pHdr->warnedNearlyFull = true;
+    }
+
     /*
      * Round up "size" to encompass the entire region, including the 0-7
      * pad bytes before the next chunk header.  This way we get maximum
@@ -384,6 +410,7 @@ void* dvmLinearAlloc(Object* classLoader, size_t size)
      * Update data structure.
      */
     pHdr->curOffset = nextOffset;
+    pHdr->allocCount++;
 
     dvmUnlockMutex(&pHdr->lock);
     return pHdr->mapAddr + startOffset + HEADER_EXTRA;
@@ -577,8 +604,16 @@ void dvmLinearFree(Object* classLoader, void* mem)
     if (ENFORCE_READ_ONLY)
         dvmLinearSetReadWrite(classLoader, mem);
 
+    LinearAllocHdr* pHdr = getHeader(classLoader);
     u4* pLen = getBlockHeader(mem);
+
+    dvmLockMutex(&pHdr->lock);
+    if ((*pLen & LENGTHFLAG_FREE) == 0) {
+        pHdr->freeCount++;
+        pHdr->freeBytes += *pLen & LENGTHFLAG_MASK;
+    }
     *pLen |= LENGTHFLAG_FREE;
+    dvmUnlockMutex(&pHdr->lock);
 
     if (ENFORCE_READ_ONLY)
         dvmLinearSetReadOnly(classLoader, mem);
@@ -647,6 +682,8 @@ void dvmLinearAllocDump(Object* classLoader)
     LOGD("LinearAlloc %p using %d of %d (%d%%)",
         classLoader, pHdr->curOffset, pHdr->mapLength,
         (pHdr->curOffset * 100) / pHdr->mapLength);
+    LOGD("  %d allocs, %d freed (%d bytes)",
+        pHdr->allocCount, pHdr->freeCount, pHdr->freeBytes);
 
     dvmUnlockMutex(&pHdr->lock);
 }
@@ -685,6 +722,28 @@ static void checkAllFree(Object* classLoader)
     dvmUnlockMutex(&pHdr->lock);
 }
 
+/*
+ * Report usage counters for a linear alloc area.
+ */
+void dvmLinearAllocGetStats(Object* classLoader, LinearAllocStats* pStats)
+{
+    memset(pStats, 0, sizeof(*pStats));
+#ifdef DISABLE_LINEAR_ALLOC
+    return;
+#endif
+    LinearAllocHdr* pHdr = getHeader(classLoader);
+    if (pHdr == NULL)
+        return;
+
+    dvmLockMutex(&pHdr->lock);
+    pStats->used = pHdr->curOffset - pHdr->firstOffset;
+    pStats->capacity = pHdr->mapLength;
+    pStats->freed = pHdr->freeBytes;
+    pStats->allocCount = pHdr->allocCount;
+    pStats->freeCount = pHdr->freeCount;
+    dvmUnlockMutex(&pHdr->lock);
+}
+
 /*
  * Determine if [start, start+length) is contained in the in-use area of
  * a single LinearAlloc.  The full set of linear allocators is scanned.
@@ -39,6 +39,22 @@ struct LinearAllocHdr {
     int     firstOffset;        /* for chasing through */
 
     short*  writeRefCount;      /* for ENFORCE_READ_ONLY */
+
+    int     allocCount;         /* number of dvmLinearAlloc calls */
+    int     freeCount;          /* number of blocks marked free */
+    int     freeBytes;          /* bytes in blocks marked free */
+    bool    warnedNearlyFull;   /* have we logged the high-water warning? */
+};
+
+/*
+ * Usage summary for a linear alloc region, from dvmLinearAllocGetStats.
+ */
+struct LinearAllocStats {
+    size_t  used;               /* bytes handed out, including headers */
+    size_t  capacity;           /* size of the reserved region */
+    size_t  freed;              /* bytes in blocks that were freed */
+    int     allocCount;         /* number of allocations */
+    int     freeCount;          /* number of blocks freed */
 };
 
 
@@ -111,6 +127,11 @@ char* dvmLinearStrdup(Object* classLoader, const char* str);
  */
 void dvmLinearAllocDump(Object* classLoader);
 
+/*
+ * Fill out "pStats" with the usage counters for a linear alloc area.
+ */
+void dvmLinearAllocGetStats(Object* classLoader, LinearAllocStats* pStats);
+
 /*
  * Determine if [start, start+length) is contained in the in-use area of
  * a single LinearAlloc.  The full set of linear allocators is scanned.
@@ -535,7 +535,7 @@ bool dvmIterativeSleep(int iteration, int maxTotalSleep, u8 relStartTime)
      * at iteration==1 is actually (minSleep * 2).
      */
     curDelay = minSleep;
-    while (iteration-- > 0)
+    for (int i = iteration; i > 0; i--)
         curDelay *= 2;
     assert(curDelay > 0);
 
@@ -78,6 +78,12 @@
 
 #define FILL_PATTERN        0xeeeeeeee
 
+/*
+ * Each sample briefly suspends every thread, so we don't allow the
+ * sampling interval to get too short.
+ */
+#define kMinSamplingIntervalUs      100
+
 
 /*
  * Returns true if the thread CPU clock should be used.
@@ -101,6 +107,18 @@ static inline bool useWallClock() {
 #endif
 }
 
+/*
+ * Clocks actually recorded in the trace.  The sampler runs on its own
+ * thread and can't read another thread's CPU clock, so sampled traces
+ * only carry wall-clock times.
+ */
+static inline bool traceUsesThreadCpuClock() {
+    return useThreadCpuClock() && gDvm.methodTrace.samplingIntervalUs == 0;
+}
+static inline bool traceUsesWallClock() {
+    return useWallClock() || gDvm.methodTrace.samplingIntervalUs != 0;
+}
+
 /*
  * Get the wall-clock date/time, in usec.
  */
@@ -181,6 +199,8 @@ bool dvmProfilingStartup()
     memset(&gDvm.methodTrace, 0, sizeof(gDvm.methodTrace));
     dvmInitMutex(&gDvm.methodTrace.startStopLock);
     pthread_cond_init(&gDvm.methodTrace.threadExitCond, NULL);
+    dvmInitMutex(&gDvm.methodTrace.samplingLock);
+    pthread_cond_init(&gDvm.methodTrace.samplingCond, NULL);
 
     assert(!dvmCheckException(dvmThreadSelf()));
 
@@ -349,6 +369,235 @@ static void dumpMethodList(FILE* fp)
     dvmHashTableUnlock(gDvm.loadedClasses);
 }
 
+/*
+ * Append one record to the trace buffer.  Returns "false" if the buffer
+ * is full.
+ *
+ * Multiple threads may be banging on this all at once.  We use atomic ops
+ * rather than mutexes for speed.
+ */
+static bool putTraceRecord(u4 threadId, const Method* method, int action,
+    u4 cpuClockDiff, u4 wallClockDiff)
+{
+    MethodTraceState* state = &gDvm.methodTrace;
+    int oldOffset, newOffset;
+
+    /*
+     * Advance "curOffset" atomically.
+     */
+    do {
+        oldOffset = state->curOffset;
+        newOffset = oldOffset + state->recordSize;
+        if (newOffset > state->bufferSize) {
+            state->overflow = true;
+            return false;
+        }
+    } while (android_atomic_release_cas(oldOffset, newOffset,
+            &state->curOffset) != 0);
+
+    //assert(METHOD_ACTION((u4) method) == 0);
+
+    u4 methodVal = METHOD_COMBINE((u4) method, action);
+
+    /*
+     * Write data into "oldOffset".
+     */
+    u1* ptr = state->buf + oldOffset;
+    *ptr++ = (u1) threadId;
+    *ptr++ = (u1) (threadId >> 8);
+    *ptr++ = (u1) methodVal;
+    *ptr++ = (u1) (methodVal >> 8);
+    *ptr++ = (u1) (methodVal >> 16);
+    *ptr++ = (u1) (methodVal >> 24);
+
+    if (traceUsesThreadCpuClock()) {
+        *ptr++ = (u1) cpuClockDiff;
+        *ptr++ = (u1) (cpuClockDiff >> 8);
+        *ptr++ = (u1) (cpuClockDiff >> 16);
+        *ptr++ = (u1) (cpuClockDiff >> 24);
+    }
+
+    if (traceUsesWallClock()) {
+        *ptr++ = (u1) wallClockDiff;
+        *ptr++ = (u1) (wallClockDiff >> 8);
+        *ptr++ = (u1) (wallClockDiff >> 16);
+        *ptr++ = (u1) (wallClockDiff >> 24);
+    }
+    return true;
+}
+
+/*
+ * Sample one suspended thread.
+ *
+ * The trace format only knows about method entry and exit, so we compare
+ * the stack against the one we saw last time and emit an exit for every
+ * frame that went away and an entry for every frame that showed up.  A
+ * method that stays on the stack across samples is charged with all of
+ * the time in between, which is what turns the samples into a call tree.
+ *
+ * Returns "false" if the buffer filled up.
+ */
+static bool sampleThread(Thread* thread, u4 wallClockDiff)
+{
+    const u4* topFp = (const u4*) thread->interpSave.curFrame;
+    int depth = dvmComputeExactFrameDepth(topFp);
+
+    /*
+     * Grow the stack storage if needed.  We fill a second copy right
+     * behind the previous sample, so we need room for both.
+     */
+    int needed = thread->sampleStackDepth + depth;
+    if (needed > thread->sampleStackAlloc) {
+        int newAlloc = needed < 32 ? 64 : needed * 2;
+        const Method** newStack = (const Method**)
+            realloc(thread->sampleStack, newAlloc * sizeof(const Method*));
+        if (newStack == NULL) {
+            LOGW("Unable to sample threadid=%d (depth %d)",
+                thread->threadId, depth);
+            return true;
+        }
+        thread->sampleStack = newStack;
+        thread->sampleStackAlloc = newAlloc;
+    }
+
+    const Method** prev = thread->sampleStack;
+    int prevDepth = thread->sampleStackDepth;
+    const Method** cur = prev + prevDepth;
+    int i = 0;
+    for (const u4* fp = topFp; fp != NULL; fp = SAVEAREA_FROM_FP(fp)->prevFrame) {
+        if (!dvmIsBreakFrame(fp)) {
+            cur[i++] = SAVEAREA_FROM_FP(fp)->method;
+        }
+    }
+    assert(i == depth);
+
+    /* frames are innermost first, so the shared part is at the end */
+    int common = 0;
+    while (common < depth && common < prevDepth &&
+            cur[depth - 1 - common] == prev[prevDepth - 1 - common]) {
+        common++;
+    }
+
+    bool ok = true;
+    for (i = 0; ok && i < prevDepth - common; i++) {
+        ok = putTraceRecord(thread->threadId, prev[i], METHOD_TRACE_EXIT,
+                0, wallClockDiff);
+    }
+    for (i = depth - common - 1; ok && i >= 0; i--) {
+        ok = putTraceRecord(thread->threadId, cur[i], METHOD_TRACE_ENTER,
+                0, wallClockDiff);
+    }
+
+    memmove(prev, cur, depth * sizeof(const Method*));
+    thread->sampleStackDepth = depth;
+    return ok;
+}
+
+/*
+ * Suspend everybody and sample all stacks.  Threads are stopped at a
+ * safepoint, so the interpreted frames -- including the ones belonging to
+ * JIT-compiled code, which keeps curFrame current across invokes -- are
+ * consistent.
+ */
+static bool sampleAllThreads(Thread* self)
+{
+    MethodTraceState* state = &gDvm.methodTrace;
+    bool ok = true;
+
+    dvmSuspendAllThreads(SUSPEND_FOR_SAMPLING);
+    u4 wallClockDiff = (u4) (getWallTimeInUsec() - state->startWhen);
+
+    dvmLockThreadList(self);
+    for (Thread* thread = gDvm.threadList; ok && thread != NULL;
+            thread = thread->next) {
+        if (thread == self || thread->status == THREAD_ZOMBIE) {
+            continue;
+        }
+        ok = sampleThread(thread, wallClockDiff);
+    }
+    dvmUnlockThreadList();
+
+    dvmResumeAllThreads(SUSPEND_FOR_SAMPLING);
+    return ok;
+}
+
+/*
+ * The sampling profiler thread.  Runs until told to stop or until the
+ * trace buffer fills up.
+ */
+static void* samplingThreadStart(void* arg)
+{
+    MethodTraceState* state = &gDvm.methodTrace;
+    Thread* self = dvmThreadSelf();
+    int intervalUs = state->samplingIntervalUs;
+
+    dvmChangeStatus(self, THREAD_VMWAIT);
+    dvmLockMutex(&state->samplingLock);
+    while (!state->samplingShutdown) {
+        dvmRelativeCondWait(&state->samplingCond, &state->samplingLock,
+            intervalUs / 1000, (intervalUs % 1000) * 1000);
+        if (state->samplingShutdown) {
+            break;
+        }
+
+        dvmUnlockMutex(&state->samplingLock);
+        bool ok = sampleAllThreads(self);
+        dvmLockMutex(&state->samplingLock);
+
+        if (!ok) {
+            LOGI("TRACE buffer full, sampling stopped");
+            break;
+        }
+    }
+
+    /* tell dvmMethodTraceStop we're done with the buffer */
+    state->samplingRunning = false;
+    dvmBroadcastCond(&state->samplingCond);
+    dvmUnlockMutex(&state->samplingLock);
+    dvmChangeStatus(self, THREAD_RUNNING);
+    return NULL;
+}
+
+/*
+ * Ask the sampling thread to stop, and wait until it no longer touches
+ * the trace buffer.  The thread itself can't finish exiting until the
+ * trace is done, so we don't join it.
+ */
+static void stopSamplingThread()
+{
+    MethodTraceState* state = &gDvm.methodTrace;
+    Thread* self = dvmThreadSelf();
+
+    ThreadStatus oldStatus = dvmChangeStatus(self, THREAD_VMWAIT);
+    dvmLockMutex(&state->samplingLock);
+    state->samplingShutdown = true;
+    dvmBroadcastCond(&state->samplingCond);
+    while (state->samplingRunning) {
+        dvmWaitCond(&state->samplingCond, &state->samplingLock);
+    }
+    dvmUnlockMutex(&state->samplingLock);
+    dvmChangeStatus(self, oldStatus);
+
+    if (state->samplingThreadHandle != 0) {
+        pthread_detach(state->samplingThreadHandle);
+        state->samplingThreadHandle = 0;
+    }
+}
+
+/*
+ * Release the per-thread sample stacks.
+ */
+static void freeSampleStacks()
+{
+    dvmLockThreadList(NULL);
+    for (Thread* thread = gDvm.threadList; thread != NULL; thread = thread->next) {
+        free(thread->sampleStack);
+        thread->sampleStack = NULL;
+        thread->sampleStackDepth = thread->sampleStackAlloc = 0;
+    }
+    dvmUnlockThreadList();
+}
+
 /*
  * Start method tracing.  Method tracing is global to the VM (i.e. we
  * trace all threads).
@@ -360,11 +609,12 @@ static void dumpMethodList(FILE* fp)
  * On failure, we throw an exception and return.
  */
 void dvmMethodTraceStart(const char* traceFileName, int traceFd, int bufferSize,
-    int flags, bool directToDdms)
+    int flags, bool directToDdms, int samplingIntervalUs)
 {
     MethodTraceState* state = &gDvm.methodTrace;
 
     assert(bufferSize > 0);
+    assert(samplingIntervalUs >= 0);
 
     dvmLockMutex(&state->startStopLock);
     while (state->traceEnabled != 0) {
@@ -378,8 +628,17 @@ void dvmMethodTraceStart(const char* traceFileName, int traceFd, int bufferSize,
      * following to take a Thread* argument, and set the appropriate
      * interpBreak flags only on the target thread.
      */
-    updateActiveProfilers(kSubModeMethodTrace, true);
-    LOGI("TRACE STARTED: '%s' %dKB", traceFileName, bufferSize / 1024);
+    if (samplingIntervalUs != 0 && samplingIntervalUs < kMinSamplingIntervalUs) {
+        samplingIntervalUs = kMinSamplingIntervalUs;
+    }
+    state->samplingIntervalUs = samplingIntervalUs;
+    if (samplingIntervalUs == 0) {
+        updateActiveProfilers(kSubModeMethodTrace, true);
+        LOGI("TRACE STARTED: '%s' %dKB", traceFileName, bufferSize / 1024);
+    } else {
+        LOGI("TRACE STARTED: '%s' %dKB, sampling every %dus",
+            traceFileName, bufferSize / 1024, samplingIntervalUs);
+    }
 
     /*
      * Allocate storage and open files.
@@ -427,7 +686,7 @@ void dvmMethodTraceStart(const char* traceFileName, int traceFd, int bufferSize,
 
     state->startWhen = getWallTimeInUsec();
 
-    if (useThreadCpuClock() && useWallClock()) {
+    if (traceUsesThreadCpuClock() && traceUsesWallClock()) {
         state->traceVersion = 3;
         state->recordSize = TRACE_REC_SIZE_DUAL_CLOCK;
     } else {
@@ -453,11 +712,25 @@ void dvmMethodTraceStart(const char* traceFileName, int traceFd, int bufferSize,
      * signaled before exiting, so we have to make sure we wake them up.
      */
     android_atomic_release_store(true, &state->traceEnabled);
+
+    if (samplingIntervalUs != 0) {
+        state->samplingShutdown = false;
+        state->samplingRunning = true;
+        if (!dvmCreateInternalThread(&state->samplingThreadHandle,
+                "Sampling Profiler", samplingThreadStart, NULL)) {
+            /* we'll write out an empty trace when asked to stop */
+            LOGE("Unable to start sampling profiler thread");
+            state->samplingRunning = false;
+            state->samplingThreadHandle = 0;
+        }
+    }
     dvmUnlockMutex(&state->startStopLock);
     return;
 
 fail:
-    updateActiveProfilers(kSubModeMethodTrace, false);
+    if (samplingIntervalUs == 0) {
+        updateActiveProfilers(kSubModeMethodTrace, false);
+    }
     if (state->traceFile != NULL) {
         fclose(state->traceFile);
         state->traceFile = NULL;
@@ -564,6 +837,8 @@ void dvmMethodTraceStop()
         LOGD("TRACE stop requested, but not running");
         dvmUnlockMutex(&state->startStopLock);
         return;
+    } else if (state->samplingIntervalUs != 0) {
+        stopSamplingThread();
     } else {
         updateActiveProfilers(kSubModeMethodTrace, false);
     }
@@ -661,8 +936,8 @@ void dvmMethodTraceStop()
     fprintf(state->traceFile, "%d\n", state->traceVersion);
     fprintf(state->traceFile, "data-file-overflow=%s\n",
         state->overflow ? "true" : "false");
-    if (useThreadCpuClock()) {
-        if (useWallClock()) {
+    if (traceUsesThreadCpuClock()) {
+        if (traceUsesWallClock()) {
             fprintf(state->traceFile, "clock=dual\n");
         } else {
             fprintf(state->traceFile, "clock=thread-cpu\n");
@@ -675,6 +950,10 @@ void dvmMethodTraceStop()
         (finalCurOffset - TRACE_HEADER_LEN) / state->recordSize);
     fprintf(state->traceFile, "clock-call-overhead-nsec=%d\n", clockNsec);
     fprintf(state->traceFile, "vm=dalvik\n");
+    if (state->samplingIntervalUs != 0) {
+        fprintf(state->traceFile, "sampling-interval-usec=%d\n",
+            state->samplingIntervalUs);
+    }
     if ((state->flags & TRACE_ALLOC_COUNTS) != 0) {
         fprintf(state->traceFile, "alloc-count=%d\n",
             gDvm.allocProf.allocCount);
@@ -714,6 +993,9 @@ void dvmMethodTraceStop()
     }
 
     /* done! */
+    if (state->samplingIntervalUs != 0) {
+        freeSampleStacks();
+    }
     free(state->buf);
     state->buf = NULL;
     fclose(state->traceFile);
@@ -733,9 +1015,8 @@ void dvmMethodTraceStop()
 void dvmMethodTraceAdd(Thread* self, const Method* method, int action)
 {
     MethodTraceState* state = &gDvm.methodTrace;
-    u4 methodVal;
-    int oldOffset, newOffset;
-    u1* ptr;
+    u4 cpuClockDiff = 0;
+    u4 wallClockDiff = 0;
 
     assert(method != NULL);
 
@@ -754,51 +1035,16 @@ void dvmMethodTraceAdd(Thread* self, const Method* method, int action)
     }
 #endif
 
-    /*
-     * Advance "curOffset" atomically.
-     */
-    do {
-        oldOffset = state->curOffset;
-        newOffset = oldOffset + state->recordSize;
-        if (newOffset > state->bufferSize) {
-            state->overflow = true;
-            return;
-        }
-    } while (android_atomic_release_cas(oldOffset, newOffset,
-            &state->curOffset) != 0);
-
-    //assert(METHOD_ACTION((u4) method) == 0);
-
-    methodVal = METHOD_COMBINE((u4) method, action);
-
-    /*
-     * Write data into "oldOffset".
-     */
-    ptr = state->buf + oldOffset;
-    *ptr++ = (u1) self->threadId;
-    *ptr++ = (u1) (self->threadId >> 8);
-    *ptr++ = (u1) methodVal;
-    *ptr++ = (u1) (methodVal >> 8);
-    *ptr++ = (u1) (methodVal >> 16);
-    *ptr++ = (u1) (methodVal >> 24);
-
 #if defined(HAVE_POSIX_CLOCKS)
-    if (useThreadCpuClock()) {
-        u4 cpuClockDiff = (u4) (getThreadCpuTimeInUsec() - self->cpuClockBase);
-        *ptr++ = (u1) cpuClockDiff;
-        *ptr++ = (u1) (cpuClockDiff >> 8);
-        *ptr++ = (u1) (cpuClockDiff >> 16);
-        *ptr++ = (u1) (cpuClockDiff >> 24);
+    if (traceUsesThreadCpuClock()) {
+        cpuClockDiff = (u4) (getThreadCpuTimeInUsec() - self->cpuClockBase);
     }
 #endif
-
-    if (useWallClock()) {
-        u4 wallClockDiff = (u4) (getWallTimeInUsec() - state->startWhen);
-        *ptr++ = (u1) wallClockDiff;
-        *ptr++ = (u1) (wallClockDiff >> 8);
-        *ptr++ = (u1) (wallClockDiff >> 16);
-        *ptr++ = (u1) (wallClockDiff >> 24);
+    if (traceUsesWallClock()) {
+        wallClockDiff = (u4) (getWallTimeInUsec() - state->startWhen);
     }
+
+    putTraceRecord(self->threadId, method, action, cpuClockDiff, wallClockDiff);
 }
 
 
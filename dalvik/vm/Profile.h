@@ -52,6 +52,17 @@ struct MethodTraceState {
 
     int     traceVersion;
     size_t  recordSize;
+
+    /*
+     * Sampling profiler.  "samplingIntervalUs" is zero when we're
+     * instrumenting method entry and exit instead.
+     */
+    int     samplingIntervalUs;
+    pthread_t samplingThreadHandle;
+    pthread_mutex_t samplingLock;
+    pthread_cond_t samplingCond;
+    bool    samplingShutdown;
+    bool    samplingRunning;
 };
 
 /*
@@ -80,10 +91,14 @@ struct AllocProfState {
 
 
 /*
- * Start/stop method tracing.
+ * Start/stop method tracing.  If "samplingIntervalUs" is nonzero, we
+ * periodically sample the stacks of all threads instead of recording
+ * every method entry and exit.
  */
 void dvmMethodTraceStart(const char* traceFileName, int traceFd, int bufferSize,
-        int flags, bool directToDdms);
+        int flags, bool directToDdms, int samplingIntervalUs);
+
+#define kDefaultSamplingIntervalUs  1000
 bool dvmIsMethodTraceActive(void);
 void dvmMethodTraceStop(void);
 
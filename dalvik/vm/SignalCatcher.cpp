@@ -170,6 +170,7 @@ static void handleSigQuit()
 #endif
 
     if (false) dvmDumpTrackedAllocations(true);
+    if (gDvm.allocSites != NULL) dvmDumpAllocSites();
 
     dvmResumeAllThreads(SUSPEND_FOR_STACK_DUMP);
 
@@ -36,8 +36,9 @@
  *
  * The two states of an Object's lock are referred to as "thin" and
  * "fat".  A lock may transition from the "thin" state to the "fat"
- * state and this transition is referred to as inflation.  Once a lock
- * has been inflated it remains in the "fat" state indefinitely.
+ * state and this transition is referred to as inflation.  A lock that
+ * has been inflated remains in the "fat" state until the GC finds its
+ * monitor idle and deflates it (see dvmSweepMonitorList).
  *
  * The lock value itself is stored in Object.lock.  The LSB of the
  * lock encodes its state.  When cleared, the lock is in the "thin"
@@ -76,6 +77,13 @@ struct Monitor {
 
     Thread*     waitSet;	/* threads currently waiting on this monitor */
 
+    /*
+     * Threads blocked in lockMonitor() or anywhere in waitMonitor().
+     * These hold on to the Monitor pointer without owning it, so the
+     * monitor can't be deflated while this is nonzero.
+     */
+    int         waiters;
+
     pthread_mutex_t lock;
 
     Monitor*    next;
@@ -218,7 +226,29 @@ static void freeMonitor(Monitor *mon)
 }
 
 /*
- * Frees monitor objects belonging to unmarked objects.
+ * Returns true if nobody owns, waits on or is trying to acquire "mon".
+ * Only meaningful while all other threads are suspended.
+ */
+static bool monitorIsIdle(Monitor *mon)
+{
+    if (mon->owner != NULL || mon->waitSet != NULL || mon->waiters != 0)
+        return false;
+    /*
+     * A thread can be suspended between acquiring the mutex and setting
+     * the owner field in lockMonitor(), so check the mutex itself too.
+     */
+    if (dvmTryLockMutex(&mon->lock) != 0)
+        return false;
+    dvmUnlockMutex(&mon->lock);
+    return true;
+}
+
+/*
+ * Frees monitor objects belonging to unmarked objects, and deflates the
+ * monitors of live objects that nobody is using.  This is called with
+ * all other threads suspended; a thread that read a fat lock word never
+ * reaches a suspend point before it either owns the monitor or is
+ * counted in "waiters".
  */
 void dvmSweepMonitorList(Monitor** mon, int (*isUnmarkedObject)(void*))
 {
@@ -236,6 +266,13 @@ void dvmSweepMonitorList(Monitor** mon, int (*isUnmarkedObject)(void*))
             prev->next = curr->next;
             freeMonitor(curr);
             curr = prev->next;
+        } else if (obj != NULL && monitorIsIdle(curr)) {
+            /* deflate to an unlocked thin lock, keeping the hash state */
+            assert(LW_MONITOR(obj->lock) == curr);
+            prev->next = curr->next;
+            freeMonitor(curr);
+            obj->lock &= (LW_HASH_STATE_MASK << LW_HASH_STATE_SHIFT);
+            curr = prev->next;
         } else {
             prev = curr;
             curr = curr->next;
@@ -350,6 +387,7 @@ static void lockMonitor(Thread* self, Monitor* mon)
         return;
     }
     if (dvmTryLockMutex(&mon->lock) != 0) {
+        android_atomic_inc(&mon->waiters);
         oldStatus = dvmChangeStatus(self, THREAD_MONITOR);
         waitThreshold = gDvm.lockProfThreshold;
         if (waitThreshold) {
@@ -363,6 +401,7 @@ static void lockMonitor(Thread* self, Monitor* mon)
             waitEnd = dvmGetRelativeTimeUsec();
         }
         dvmChangeStatus(self, oldStatus);
+        android_atomic_dec(&mon->waiters);
         if (waitThreshold) {
             waitMs = (waitEnd - waitStart) / 1000;
             if (waitMs >= waitThreshold) {
@@ -659,6 +698,7 @@ static void waitMonitor(Thread* self, Monitor* mon, s8 msec, s4 nsec,
      * not order sensitive as we hold the pthread mutex.
      */
     waitSetAppend(mon, self);
+    android_atomic_inc(&mon->waiters);
     int prevLockCount = mon->lockCount;
     mon->lockCount = 0;
     mon->owner = NULL;
@@ -739,6 +779,7 @@ done:
     mon->ownerFileName = savedFileName;
     mon->ownerLineNumber = savedLineNumber;
     waitSetRemove(mon, self);
+    android_atomic_dec(&mon->waiters);
 
     /* set self->status back to THREAD_RUNNING, and self-suspend if needed */
     dvmChangeStatus(self, THREAD_RUNNING);
@@ -845,6 +886,49 @@ static void inflateMonitor(Thread *self, Object *obj)
     android_atomic_release_store(thin, (int32_t *)&obj->lock);
 }
 
+#if ANDROID_SMP != 0
+/*
+ * Bounds for the number of times we poll a contended thin lock before
+ * giving up the CPU.  The budget grows when spinning pays off and shrinks
+ * when it doesn't; it's shared by all threads and updated without
+ * synchronization, which is fine for a heuristic.
+ */
+#define kThinSpinMin    16
+#define kThinSpinMax    2048
+static int gThinSpinBudget = 256;
+
+/*
+ * Briefly busy-wait for the owner of a thin lock to release it, on the
+ * theory that most critical sections are short.  The calling thread is
+ * still THREAD_RUNNING, so the bound also limits how long we can hold
+ * off a suspend request.
+ *
+ * Returns true if we acquired the lock.
+ */
+static bool spinOnThinLock(volatile u4 *thinp, u4 threadId)
+{
+    int budget = gThinSpinBudget;
+
+    for (int i = 0; i < budget; i++) {
+        u4 thin = *thinp;
+        if (LW_SHAPE(thin) != LW_SHAPE_THIN)
+            break;
+        if (LW_LOCK_OWNER(thin) == 0) {
+            u4 newThin = thin | (threadId << LW_LOCK_OWNER_SHIFT);
+            if (android_atomic_acquire_cas(thin, newThin,
+                    (int32_t *)thinp) == 0) {
+                if (budget < kThinSpinMax)
+                    gThinSpinBudget = budget * 2;
+                return true;
+            }
+        }
+    }
+    if (budget > kThinSpinMin)
+        gThinSpinBudget = budget / 2;
+    return false;
+}
+#endif
+
 /*
  * Implements monitorenter for "synchronized" stuff.
  *
@@ -904,6 +988,16 @@ retry:
         } else {
             LOGV("(%d) spin on lock %p: %#x (%#x) %#x",
                  threadId, &obj->lock, 0, *thinp, thin);
+#if ANDROID_SMP != 0
+            /*
+             * The lock is owned by another thread, which is probably
+             * about to release it.  If it does so while we spin, keep
+             * the lock thin; inflating only pays off for locks that
+             * are held for a while.
+             */
+            if (spinOnThinLock(thinp, threadId))
+                return;
+#endif
             /*
              * The lock is owned by another thread.  Notify the VM
              * that we are about to wait.
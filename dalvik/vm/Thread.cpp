@@ -422,6 +422,7 @@ static const char* getSuspendCauseStr(SuspendCause why)
     case SUSPEND_FOR_STACK_DUMP:    return "stack-dump";
     case SUSPEND_FOR_VERIFY:        return "verify";
     case SUSPEND_FOR_HPROF:         return "hprof";
+    case SUSPEND_FOR_SAMPLING:      return "sampling";
 #if defined(WITH_JIT)
     case SUSPEND_FOR_TBL_RESIZE:    return "table-resize";
     case SUSPEND_FOR_IC_PATCH:      return "inline-cache-patch";
@@ -987,6 +988,7 @@ static void freeThread(Thread* thread)
 
     thread->jniLocalRefTable.destroy();
     dvmClearReferenceTable(&thread->internalLocalRefTable);
+    free(thread->sampleStack);
     if (&thread->jniMonitorRefTable.table != NULL)
         dvmClearReferenceTable(&thread->jniMonitorRefTable);
 
@@ -2162,6 +2164,75 @@ void dvmDetachCurrentThread()
 }
 
 
+/*
+ * Attach the current thread to the dexopt VM.
+ *
+ * The dexopt VM never gets as far as creating the thread classes, so no
+ * Thread/VMThread objects are made here.  That is enough to load, verify
+ * and optimize classes, which is all the workers do.  On success the
+ * thread is on the thread list and in the RUNNING state.
+ */
+bool dvmAttachDexOptThread()
+{
+    Thread* self;
+    bool ok;
+
+    assert(gDvm.optimizing);
+
+    self = allocThread(gDvm.stackSize);
+    if (self == NULL)
+        return false;
+    setThreadSelf(self);
+
+    dvmLockThreadList(self);
+    ok = prepareThread(self);
+    if (ok) {
+        self->next = gDvm.threadList->next;
+        if (self->next != NULL)
+            self->next->prev = self;
+        self->prev = gDvm.threadList;
+        gDvm.threadList->next = self;
+    } else {
+        releaseThreadId(self);
+    }
+    dvmUnlockThreadList();
+
+    if (!ok) {
+        setThreadSelf(NULL);
+        freeThread(self);
+        return false;
+    }
+
+    /* Stall until a GC that started before we got on the list is done */
+    assert(self->status == THREAD_INITIALIZING);
+    dvmChangeStatus(self, THREAD_VMWAIT);
+    dvmLockMutex(&gDvm.gcHeapLock);
+    dvmUnlockMutex(&gDvm.gcHeapLock);
+    dvmChangeStatus(self, THREAD_RUNNING);
+
+    return true;
+}
+
+/*
+ * Detach a thread attached with dvmAttachDexOptThread().
+ */
+void dvmDetachDexOptThread()
+{
+    Thread* self = dvmThreadSelf();
+
+    dvmChangeStatus(self, THREAD_VMWAIT);
+
+    dvmLockThreadList(self);
+    self->status = THREAD_ZOMBIE;
+    unlinkThread(self);
+    releaseThreadId(self);
+    dvmUnlockThreadList();
+
+    setThreadSelf(NULL);
+
+    freeThread(self);
+}
+
 /*
  * Suspend a single thread.  Do not use to suspend yourself.
  *
@@ -2532,6 +2603,94 @@ static void waitForThreadSuspend(Thread* self, Thread* thread)
  * thread before doing anything that could cause VM suspension (like object
  * allocation).
  */
+/*
+ * Returns true if dvmSuspendAllThreads() doesn't need to wait for "thread".
+ */
+static bool skipSuspendWait(Thread* self, Thread* thread, SuspendCause why)
+{
+    if (thread == self)
+        return true;
+
+    /* debugger events don't suspend JDWP thread */
+    if ((why == SUSPEND_FOR_DEBUG || why == SUSPEND_FOR_DEBUG_EVENT) &&
+        thread->handle == dvmJdwpGetDebugThread(gDvm.jdwpState))
+        return true;
+
+    return false;
+}
+
+/*
+ * Poll every thread in the list until none of them is THREAD_RUNNING, or
+ * until we've spent "kMaxPollUsec" trying.  The caller waits for any
+ * that are left individually.
+ *
+ * The caller must hold the thread list lock.
+ */
+static void waitForAllRunningThreads(Thread* self, SuspendCause why,
+    u8 startWhen)
+{
+    const u8 kMaxPollUsec = 5000;
+    Thread* thread;
+
+    for (;;) {
+        bool anyRunning = false;
+        for (thread = gDvm.threadList; thread != NULL; thread = thread->next) {
+            if (!skipSuspendWait(self, thread, why) &&
+                thread->status == THREAD_RUNNING)
+            {
+                anyRunning = true;
+                break;
+            }
+        }
+        if (!anyRunning)
+            break;
+        if (dvmGetRelativeTimeUsec() - startWhen >= kMaxPollUsec)
+            break;
+        sched_yield();
+    }
+}
+
+/*
+ * Add a suspend-all latency sample to the histogram.  The caller must
+ * hold the thread suspend lock.
+ */
+static void recordSuspendAllTime(u8 usec)
+{
+    int bucket = 0;
+    while (bucket < (int) NELEM(gDvm.suspendAllHistogram) - 1 &&
+           (usec >> (bucket + 1)) != 0)
+    {
+        bucket++;
+    }
+    gDvm.suspendAllHistogram[bucket]++;
+    if (usec > gDvm.suspendAllMaxUsec)
+        gDvm.suspendAllMaxUsec = (u4) usec;
+}
+
+/*
+ * Print the suspend-all latency histogram.  Bucket N counts pauses of
+ * [2^N, 2^(N+1)) usec; empty buckets are skipped.
+ */
+static void dumpSuspendAllTimes(const DebugOutputTarget* target)
+{
+    char buf[256];
+    int len = 0;
+
+    for (int i = 0; i < (int) NELEM(gDvm.suspendAllHistogram); i++) {
+        if (gDvm.suspendAllHistogram[i] == 0)
+            continue;
+        len += snprintf(buf + len, sizeof(buf) - len, " %uus:%u",
+                    1u << i, gDvm.suspendAllHistogram[i]);
+        if (len >= (int) sizeof(buf))
+            break;
+    }
+    if (len == 0)
+        return;
+    buf[sizeof(buf) - 1] = '\0';
+    dvmPrintDebugMessage(target, "(suspend-all: max=%uus%s)\n",
+        gDvm.suspendAllMaxUsec, buf);
+}
+
 void dvmSuspendAllThreads(SuspendCause why)
 {
     Thread* self = dvmThreadSelf();
@@ -2550,6 +2709,8 @@ void dvmSuspendAllThreads(SuspendCause why)
 
     LOG_THREAD("threadid=%d: SuspendAll starting", self->threadId);
 
+    u8 startWhen = dvmGetRelativeTimeUsec();
+
     /*
      * This is possible if the current thread was in VMWAIT mode when a
      * suspend-all happened, and then decided to do its own suspend-all.
@@ -2593,7 +2754,14 @@ void dvmSuspendAllThreads(SuspendCause why)
      * so if another thread is fiddling with its suspend count (perhaps
      * self-suspending for the debugger) it won't block while we're waiting
      * in here.
+     *
+     * All of the threads are heading for a suspend check at the same time,
+     * and most of them get there within microseconds.  Poll the whole list
+     * for a little while before falling back on waiting for each straggler
+     * in turn, which sleeps in much coarser steps.
      */
+    waitForAllRunningThreads(self, why, startWhen);
+
     for (thread = gDvm.threadList; thread != NULL; thread = thread->next) {
         if (thread == self)
             continue;
@@ -2611,6 +2779,8 @@ void dvmSuspendAllThreads(SuspendCause why)
             thread->suspendCount, thread->dbgSuspendCount);
     }
 
+    recordSuspendAllTime(dvmGetRelativeTimeUsec() - startWhen);
+
     dvmUnlockThreadList();
     unlockThreadSuspend();
 
@@ -3376,6 +3546,7 @@ void dvmDumpAllThreadsEx(const DebugOutputTarget* target, bool grabLock)
         gDvm.threadSuspendCountLock.value,
         gDvm.gcHeapLock.value);
 #endif
+    dumpSuspendAllTimes(target);
 
     if (grabLock)
         dvmLockThreadList(dvmThreadSelf());
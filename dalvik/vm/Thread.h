@@ -290,6 +290,9 @@ struct Thread {
     /* memory allocation profiling state */
     AllocProfState allocProf;
 
+    /* bytes left to allocate before the next allocation site sample */
+    int         allocSampleBytesLeft;
+
 #ifdef WITH_JNI_STACK_CHECK
     u4          stackCrc;
 #endif
@@ -303,6 +306,11 @@ struct Thread {
     pthread_mutex_t   callbackMutex;
     SafePointCallback callback;
     void*             callbackArg;
+
+    /* stack seen by the last profiler sample, innermost frame first */
+    const Method** sampleStack;
+    int         sampleStackDepth;
+    int         sampleStackAlloc;
 };
 
 /* start point for an internal thread; mimics pthread args */
@@ -354,6 +362,7 @@ enum SuspendCause {
     SUSPEND_FOR_DEX_OPT,
     SUSPEND_FOR_VERIFY,
     SUSPEND_FOR_HPROF,
+    SUSPEND_FOR_SAMPLING,
 #if defined(WITH_JIT)
     SUSPEND_FOR_TBL_RESIZE,  // jit-table resize
     SUSPEND_FOR_IC_PATCH,    // polymorphic callsite inline-cache patch
@@ -498,6 +507,13 @@ bool dvmCreateInternalThread(pthread_t* pHandle, const char* name,
 bool dvmAttachCurrentThread(const JavaVMAttachArgs* pArgs, bool isDaemon);
 void dvmDetachCurrentThread(void);
 
+/*
+ * Attach or detach a dexopt worker.  These threads have no java.lang.Thread
+ * peer, just like the main thread in the dexopt VM.
+ */
+bool dvmAttachDexOptThread(void);
+void dvmDetachDexOptThread(void);
+
 /*
  * Get the "main" or "system" thread group.
  */
@@ -189,7 +189,7 @@ Object* dvmAllocObject(ClassObject* clazz, int flags)
     newObj = (Object*)dvmMalloc(clazz->objectSize, flags);
     if (newObj != NULL) {
         DVM_OBJECT_INIT(newObj, clazz);
-        dvmTrackAllocation(clazz, clazz->objectSize);   /* notify DDMS */
+        dvmTrackAllocation(newObj, clazz, clazz->objectSize); /* notify DDMS */
     }
 
     return newObj;
@@ -233,7 +233,7 @@ Object* dvmCloneObject(Object* obj, int flags)
         dvmSetFinalizable(copy);
     }
 
-    dvmTrackAllocation(clazz, size);    /* notify DDMS */
+    dvmTrackAllocation(copy, clazz, size);  /* notify DDMS */
 
     return copy;
 }
@@ -82,6 +82,17 @@ bool dvmCardTableStartup(size_t heapMaximumSize)
     assert(((uintptr_t)biasedBase & 0xff) == GC_CARD_DIRTY);
     gDvm.biasedCardTableBase = biasedBase;
 
+    /* Set up the mod-union table of the immune heaps.  Only the pages
+     * covering the zygote heap are ever touched.
+     */
+    allocBase = dvmAllocRegion(length, PROT_READ | PROT_WRITE,
+                               "dalvik-mod-union-table");
+    if (allocBase == NULL) {
+        return false;
+    }
+    gcHeap->modUnionTableBase = (u1*)allocBase;
+    gcHeap->modUnionTableLength = length;
+
     return true;
 }
 
@@ -92,12 +103,64 @@ void dvmCardTableShutdown()
 {
     gDvm.biasedCardTableBase = NULL;
     munmap(gDvm.gcHeap->cardTableBase, gDvm.gcHeap->cardTableLength);
+    munmap(gDvm.gcHeap->modUnionTableBase,
+           gDvm.gcHeap->modUnionTableLength);
+}
+
+/*
+ * Records the dirty cards of the immune heaps in the mod-union table.
+ * An immune object can only refer to an object of the active heap
+ * after a store that went through the write barrier, so together with
+ * the card table this covers every such object.
+ */
+static void foldImmuneCards()
+{
+    GcHeap *h = gDvm.gcHeap;
+    const u1 *heapBase = (const u1 *)dvmHeapSourceGetBase();
+    const u1 *immuneLimit = (const u1 *)dvmHeapSourceGetImmuneLimit(true);
+    if (immuneLimit <= heapBase) {
+        return;
+    }
+    const u1 *start = dvmCardFromAddr(heapBase);
+    const u1 *end = dvmCardFromAddr(immuneLimit);
+    assert((size_t)(end - start) <= h->modUnionTableLength);
+    u1 *modUnion = h->modUnionTableBase;
+    for (const u1 *card = start; card < end; ++card, ++modUnion) {
+        if (*card == GC_CARD_DIRTY) {
+            *modUnion = GC_CARD_DIRTY;
+        }
+    }
 }
 
 void dvmClearCardTable()
 {
-    assert(gDvm.gcHeap->cardTableBase != NULL);
-    memset(gDvm.gcHeap->cardTableBase, GC_CARD_CLEAN, gDvm.gcHeap->cardTableLength);
+    GcHeap *h = gDvm.gcHeap;
+    assert(h->cardTableBase != NULL);
+    foldImmuneCards();
+    /*
+     * The table covers the maximum size of the heap, a memset would
+     * commit every page of it.  Return the pages to the system instead,
+     * successive page faults will return zeroed (clean) cards.
+     */
+    assert(GC_CARD_CLEAN == 0);
+    madvise(h->cardTableBase, h->cardTableOffset + h->cardTableLength,
+            MADV_DONTNEED);
+}
+
+/*
+ * Returns true if the card of an address in the immune heaps has been
+ * dirtied since the immune heaps were split off.
+ */
+bool dvmIsImmuneCardDirty(const void *addr)
+{
+    GcHeap *h = gDvm.gcHeap;
+    const u1 *card = dvmCardFromAddr(addr);
+    if (*card == GC_CARD_DIRTY) {
+        return true;
+    }
+    size_t index = card - dvmCardFromAddr(dvmHeapSourceGetBase());
+    assert(index < h->modUnionTableLength);
+    return h->modUnionTableBase[index] == GC_CARD_DIRTY;
 }
 
 /*
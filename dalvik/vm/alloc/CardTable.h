@@ -40,10 +40,17 @@ bool dvmCardTableStartup(size_t heapMaximumSize);
 void dvmCardTableShutdown(void);
 
 /*
- * Resets all of the bytes in the card table to clean.
+ * Resets all of the bytes in the card table to clean.  The dirty cards
+ * of the immune heaps are first recorded in the mod-union table.
  */
 void dvmClearCardTable(void);
 
+/*
+ * Returns true if the card of an address in the immune heaps has been
+ * dirtied since the immune heaps were split off.
+ */
+bool dvmIsImmuneCardDirty(const void *addr);
+
 /*
  * Returns the address of the relevent byte in the card table, given
  * an address on the heap.
@@ -1829,6 +1829,8 @@ static void pinThreadStack(const Thread *thread)
                         pinObject((Object *)regValue);
                     }
                 }
+            } else {
+                dvmReleaseRegisterMapLine(pMap, regVector);
             }
         }
         /*
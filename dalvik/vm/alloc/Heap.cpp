@@ -385,6 +385,17 @@ void* dvmMalloc(size_t size, int flags)
     dvmUnlockHeap();
 
     if (ptr != NULL) {
+        /*
+         * The heap source only cleared the header.  Clear the rest
+         * here so that threads contending for the heap lock do not
+         * wait on the memset of a large allocation.  Nothing can see
+         * the storage yet: it is unreachable and this thread will not
+         * reach a suspend point before returning it.
+         */
+        if (size > sizeof(Object)) {
+            memset((u1 *)ptr + sizeof(Object), 0, size - sizeof(Object));
+        }
+
         /*
          * If caller hasn't asked us not to track it, add it to the
          * internal tracking list.
@@ -530,6 +541,11 @@ void dvmCollectGarbageInternal(const GcSpec* spec)
     dvmHeapScanMarkedObjects();
 
     if (spec->isConcurrent) {
+        /*
+         * Trace from the objects dirtied while we were recursing
+         * before suspending the threads again.
+         */
+        dvmHeapPreScanDirtyObjects();
         /*
          * Re-acquire the heap lock and perform the final thread
          * suspension.
@@ -128,15 +128,17 @@ void dvmHeapBitmapWalk(const HeapBitmap *bitmap, BitmapCallback *callback,
  * bit for an address below the finger, this address will not be
  * visited.
  */
-void dvmHeapBitmapScanWalk(HeapBitmap *bitmap,
+void dvmHeapBitmapScanWalk(HeapBitmap *bitmap, uintptr_t base,
                            BitmapScanCallback *callback, void *arg)
 {
     assert(bitmap != NULL);
     assert(bitmap->bits != NULL);
     assert(callback != NULL);
+    assert(base >= bitmap->base);
+    assert(HB_OFFSET_TO_MASK(base - bitmap->base) == HB_OFFSET_TO_MASK(0));
     uintptr_t end = HB_OFFSET_TO_INDEX(bitmap->max - bitmap->base);
     uintptr_t i;
-    for (i = 0; i <= end; ++i) {
+    for (i = HB_OFFSET_TO_INDEX(base - bitmap->base); i <= end; ++i) {
         unsigned long word = bitmap->bits[i];
         if (UNLIKELY(word != 0)) {
             unsigned long highBit = 1 << (HB_BITS_PER_WORD - 1);
@@ -110,9 +110,9 @@ void dvmHeapBitmapWalk(const HeapBitmap *bitmap,
 
 /*
  * Like dvmHeapBitmapWalk but takes a callback function with a finger
- * address.
+ * address.  Bits for addresses below base are not visited.
  */
-void dvmHeapBitmapScanWalk(HeapBitmap *bitmap,
+void dvmHeapBitmapScanWalk(HeapBitmap *bitmap, uintptr_t base,
                            BitmapScanCallback *callback, void *arg);
 
 /*
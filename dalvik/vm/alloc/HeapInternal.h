@@ -50,6 +50,12 @@ struct GcHeap {
     size_t cardTableLength;
     size_t cardTableOffset;
 
+    /* Cards of the immune heaps dirtied since those heaps were split
+     * off, one byte per card starting at the heap base.
+     */
+    u1* modUnionTableBase;
+    size_t modUnionTableLength;
+
     /* Is the GC running?  Used to avoid recursive calls to GC.
      */
     bool gcRunning;
@@ -597,29 +597,46 @@ bool dvmHeapSourceStartupAfterZygote()
 }
 
 /*
- * This is called while in zygote mode, right before we fork() for the
- * first time.  We create a heap for all future zygote process allocations,
+ * This is called while in zygote mode, right before every fork().  The
+ * first time, we create a heap for all future zygote process allocations,
  * in an attempt to avoid touching pages in the zygote heap.  (This would
  * probably be unnecessary if we had a compacting GC -- the source of our
  * troubles is small allocations filling in the gaps from larger ones.)
+ *
+ * Whatever is resident in the zygote at fork time is mapped copy-on-write
+ * into the child, so we also hand back what the child has no use for.
+ * The zygote has no GC daemon and is never trimmed otherwise, so the free
+ * pages of the heap being split off are released here; they would never
+ * be allocated from again.  The card table is cleared before each fork
+ * (after folding the zygote heap's cards into the mod-union table, like
+ * at the start of a concurrent GC) so the child faults in fresh zero
+ * pages instead of copying the zygote's.  The mark bitmap and mark stack
+ * are already released at the end of every GC.
  */
 bool dvmHeapSourceStartupBeforeFork()
 {
     HeapSource *hs = gHs; // use a local to avoid the implicit "volatile"
+    bool result = true;
 
     HS_BOILERPLATE();
 
     assert(gDvm.zygote);
 
+    dvmLockHeap();
     if (!gDvm.newZygoteHeapAllocated) {
+        trimHeaps();
+
         /* Create a new heap for post-fork zygote allocations.  We only
          * try once, even if it fails.
          */
         LOGV("Splitting out new zygote heap");
         gDvm.newZygoteHeapAllocated = true;
-        return addNewHeap(hs);
+        result = addNewHeap(hs);
     }
-    return true;
+    dvmClearCardTable();
+    dvmUnlockHeap();
+
+    return result;
 }
 
 void dvmHeapSourceThreadShutdown()
@@ -804,10 +821,16 @@ void* dvmHeapSourceAlloc(size_t n)
                   FRACTIONAL_MB(hs->softLimit), n);
         return NULL;
     }
-    void* ptr = mspace_calloc(heap->msp, 1, n);
+    void* ptr = mspace_malloc(heap->msp, n);
     if (ptr == NULL) {
         return NULL;
     }
+    /*
+     * Only clear the object header while the heap lock is held, heap
+     * walkers must see a NULL class.  dvmMalloc() clears the rest of
+     * the storage once it has released the lock.
+     */
+    memset(ptr, 0, MIN(n, sizeof(Object)));
     countAllocation(heap, ptr);
     /*
      * Check to see if a concurrent GC should be initiated.
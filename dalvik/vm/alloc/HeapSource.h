@@ -100,13 +100,14 @@ size_t dvmHeapSourceGetValue(HeapSourceValueSpec spec,
                              size_t perHeapStats[], size_t arrayLen);
 
 /*
- * Allocates <n> bytes of zeroed data.
+ * Allocates <n> bytes of data.  Only the leading sizeof(Object) bytes
+ * are zeroed, the caller must clear the rest.
  */
 void *dvmHeapSourceAlloc(size_t n);
 
 /*
- * Allocates <n> bytes of zeroed data, growing up to absoluteMaxSize
- * if necessary.
+ * Allocates <n> bytes of data, growing up to absoluteMaxSize if
+ * necessary.  Only the leading sizeof(Object) bytes are zeroed.
  */
 void *dvmHeapSourceAllocAndGrow(size_t n);
 
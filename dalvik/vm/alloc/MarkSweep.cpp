@@ -590,6 +590,39 @@ static void scanBitmapCallback(Object *obj, void *finger, void *arg)
     scanObject(obj, ctx);
 }
 
+/*
+ * Scans the immune objects that may refer to the active heap, those
+ * whose card was dirtied since the immune heaps were split off.  The
+ * other immune objects can only refer to immune objects, which are
+ * all marked, so they are not traced.
+ */
+static void scanImmuneObjects(GcMarkContext *ctx)
+{
+    const u1 *base = (const u1 *)dvmHeapSourceGetBase();
+    const u1 *limit = (const u1 *)ctx->immuneLimit;
+    const HeapBitmap *markBits = ctx->bitmap;
+
+    /* Everything the scan marks in the active heap is above the
+     * finger and will be visited by the bitmap walk that follows.
+     */
+    ctx->finger = limit;
+    for (const u1 *card = base; card < limit; card += GC_CARD_SIZE) {
+        if (!dvmIsImmuneCardDirty(card)) {
+            continue;
+        }
+        const u1 *ptr = card;
+        const u1 *cardLimit = card + GC_CARD_SIZE;
+        while (ptr < cardLimit) {
+            Object *obj = nextGrayObject(ptr, cardLimit, markBits);
+            if (obj == NULL) {
+                break;
+            }
+            scanObject(obj, ctx);
+            ptr = (u1*)obj + ALIGN_UP(objectSize(obj), HB_OBJECT_ALIGNMENT);
+        }
+    }
+}
+
 /* Given bitmaps with the root set marked, find and mark all
  * reachable objects.  When this returns, the entire set of
  * live objects will be marked and the mark stack will be empty.
@@ -597,13 +630,24 @@ static void scanBitmapCallback(Object *obj, void *finger, void *arg)
 void dvmHeapScanMarkedObjects(void)
 {
     GcMarkContext *ctx = &gDvm.gcHeap->markContext;
+    uintptr_t base = ctx->bitmap->base;
 
     assert(ctx->finger == NULL);
 
+    /* During a partial collection the immune objects are all marked,
+     * only scan those that may point into the active heap, then walk
+     * the bitmap from the start of the active heap.
+     */
+    if (ctx->immuneLimit != NULL &&
+            ctx->immuneLimit > (const char *)dvmHeapSourceGetBase()) {
+        scanImmuneObjects(ctx);
+        base = (uintptr_t)ctx->immuneLimit;
+    }
+
     /* The bitmaps currently have bits set for the root set.
      * Walk across the bitmaps and scan each object.
      */
-    dvmHeapBitmapScanWalk(ctx->bitmap, scanBitmapCallback, ctx);
+    dvmHeapBitmapScanWalk(ctx->bitmap, base, scanBitmapCallback, ctx);
 
     ctx->finger = (void *)ULONG_MAX;
 
@@ -613,6 +657,21 @@ void dvmHeapScanMarkedObjects(void)
     processMarkStack(ctx);
 }
 
+/*
+ * Blackens the gray objects found on dirty cards while the mutators
+ * are still running.  The cards are left dirty, the final pause scans
+ * them again in dvmHeapReScanMarkedObjects() but by then most of what
+ * they point to is already marked, which shortens the pause.
+ */
+void dvmHeapPreScanDirtyObjects()
+{
+    GcMarkContext *ctx = &gDvm.gcHeap->markContext;
+
+    assert(ctx->finger == (void *)ULONG_MAX);
+    scanGrayObjects(ctx);
+    processMarkStack(ctx);
+}
+
 void dvmHeapReScanMarkedObjects()
 {
     GcMarkContext *ctx = &gDvm.gcHeap->markContext;
@@ -868,6 +927,9 @@ static void sweepBitmapCallback(size_t numPtrs, void **ptrs, void *arg)
     if (ctx->isConcurrent) {
         dvmLockHeap();
     }
+    if (gDvm.allocSites != NULL) {
+        dvmSampledAllocationsFreed(numPtrs, ptrs);
+    }
     ctx->numBytes += dvmHeapSourceFreeList(numPtrs, ptrs);
     ctx->numObjects += numPtrs;
     if (ctx->isConcurrent) {
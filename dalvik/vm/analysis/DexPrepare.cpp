@@ -43,6 +43,7 @@
 #include <fcntl.h>
 #include <errno.h>
 #include <unistd.h>
+#include <pthread.h>
 #include <zlib.h>
 
 /* fwd */
@@ -996,32 +997,143 @@ static bool loadAllClasses(DvmDex* pDvmDex)
  * Verify and/or optimize all classes that were successfully loaded from
  * this DEX file.
  */
-static void verifyAndOptimizeClasses(DexFile* pDexFile, bool doVerify,
-    bool doOpt)
+static void verifyAndOptimizeClassIdx(DexFile* pDexFile, u4 idx,
+    bool doVerify, bool doOpt)
 {
-    u4 count = pDexFile->pHeader->classDefsSize;
-    u4 idx;
+    const DexClassDef* pClassDef;
+    const char* classDescriptor;
+    ClassObject* clazz;
 
-    for (idx = 0; idx < count; idx++) {
-        const DexClassDef* pClassDef;
-        const char* classDescriptor;
-        ClassObject* clazz;
+    pClassDef = dexGetClassDef(pDexFile, idx);
+    classDescriptor = dexStringByTypeIdx(pDexFile, pClassDef->classIdx);
 
-        pClassDef = dexGetClassDef(pDexFile, idx);
-        classDescriptor = dexStringByTypeIdx(pDexFile, pClassDef->classIdx);
+    /* all classes are loaded into the bootstrap class loader */
+    clazz = dvmLookupClass(classDescriptor, NULL, false);
+    if (clazz != NULL) {
+        verifyAndOptimizeClass(pDexFile, clazz, pClassDef, doVerify, doOpt);
 
-        /* all classes are loaded into the bootstrap class loader */
-        clazz = dvmLookupClass(classDescriptor, NULL, false);
-        if (clazz != NULL) {
-            verifyAndOptimizeClass(pDexFile, clazz, pClassDef, doVerify, doOpt);
+    } else {
+        // TODO: log when in verbose mode
+        LOGV("DexOpt: not optimizing unavailable class '%s'",
+            classDescriptor);
+    }
+}
 
-        } else {
-            // TODO: log when in verbose mode
-            LOGV("DexOpt: not optimizing unavailable class '%s'",
-                classDescriptor);
+/*
+ * Class indices handed out to the threads verifying and optimizing a DEX
+ * file in parallel.
+ */
+struct VerifyWork {
+    DexFile*        pDexFile;
+    bool            doVerify;
+    bool            doOpt;
+    u4              count;
+    volatile int32_t nextIdx;
+};
+
+/*
+ * Pull classes off the shared index until there are none left.
+ *
+ * Everything was loaded and linked by loadAllClasses(), so a class only
+ * touches its own instructions and DexClassDef here; whatever else it
+ * resolves goes through the same thread-safe paths as class resolution
+ * in a running VM.
+ */
+static void processVerifyWork(VerifyWork* pWork)
+{
+    Thread* self = dvmThreadSelf();
+
+    while (true) {
+        u4 idx = (u4) android_atomic_inc(&pWork->nextIdx);
+        if (idx >= pWork->count)
+            break;
+
+        verifyAndOptimizeClassIdx(pWork->pDexFile, idx, pWork->doVerify,
+            pWork->doOpt);
+
+        /* don't hold up a GC started by another thread for long */
+        dvmCheckSuspendPending(self);
+    }
+}
+
+static void* verifyWorkerStart(void* arg)
+{
+    VerifyWork* pWork = (VerifyWork*) arg;
+
+    if (!dvmAttachDexOptThread()) {
+        LOGW("DexOpt: unable to attach verifier thread");
+        return NULL;
+    }
+    processVerifyWork(pWork);
+    dvmDetachDexOptThread();
+
+    return NULL;
+}
+
+/*
+ * Spread the classes over gDvm.dexOptThreads threads, the current one
+ * included.  If a worker can't be started, the others just pick up its
+ * share.
+ */
+static void verifyAndOptimizeClassesParallel(DexFile* pDexFile,
+    bool doVerify, bool doOpt)
+{
+    Thread* self = dvmThreadSelf();
+    int numWorkers = gDvm.dexOptThreads - 1;
+    pthread_t* workers;
+    VerifyWork work;
+    int started = 0;
+
+    work.pDexFile = pDexFile;
+    work.doVerify = doVerify;
+    work.doOpt = doOpt;
+    work.count = pDexFile->pHeader->classDefsSize;
+    work.nextIdx = 0;
+
+    workers = (pthread_t*) malloc(sizeof(pthread_t) * numWorkers);
+    if (workers != NULL) {
+        for (started = 0; started < numWorkers; started++) {
+            if (pthread_create(&workers[started], NULL, verifyWorkerStart,
+                    &work) != 0)
+            {
+                LOGW("DexOpt: started only %d verifier threads", started);
+                break;
+            }
         }
     }
 
+    processVerifyWork(&work);
+
+    ThreadStatus oldStatus = dvmChangeStatus(self, THREAD_VMWAIT);
+    for (int i = 0; i < started; i++)
+        pthread_join(workers[i], NULL);
+    dvmChangeStatus(self, oldStatus);
+
+    free(workers);
+
+    LOGV("DexOpt: verified %d classes on %d threads", work.count, started + 1);
+}
+
+static void verifyAndOptimizeClasses(DexFile* pDexFile, bool doVerify,
+    bool doOpt)
+{
+    u4 count = pDexFile->pHeader->classDefsSize;
+    u4 idx;
+
+    /*
+     * The bootstrap classes are left to one thread; the classes that
+     * make up the VM itself are still being sorted out while they are
+     * verified.
+     */
+    if (gDvm.optimizing && gDvm.dexOptThreads > 1 &&
+        !gDvm.optimizingBootstrapClass && count > 1)
+    {
+        verifyAndOptimizeClassesParallel(pDexFile, doVerify, doOpt);
+    } else {
+        for (idx = 0; idx < count; idx++)
+            verifyAndOptimizeClassIdx(pDexFile, idx, doVerify, doOpt);
+    }
+
 #ifdef VERIFIER_STATS
     LOGI("Verifier stats:");
     LOGI(" methods examined        : %u", gDvm.verifierStats.methodsExamined);
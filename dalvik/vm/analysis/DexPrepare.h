@@ -44,7 +44,8 @@ enum DexoptFlags {
     DEXOPT_IS_BOOTSTRAP      = 1 << 4,  /* is dex in bootstrap class path? */
     DEXOPT_GEN_REGISTER_MAPS = 1 << 5,  /* generate register maps during vfy */
     DEXOPT_UNIPROCESSOR      = 1 << 6,  /* specify uniprocessor target */
-    DEXOPT_SMP               = 1 << 7   /* specify SMP target */
+    DEXOPT_SMP               = 1 << 7,  /* specify SMP target */
+    DEXOPT_PARALLEL          = 1 << 8   /* verify+opt on all online CPUs */
 };
 
 /*
@@ -49,6 +49,8 @@ static void computeMapStats(RegisterMap* pMap, const Method* method);
 static RegisterMap* compressMapDifferential(const RegisterMap* pMap,\
     const Method* meth);
 static RegisterMap* uncompressMapDifferential(const RegisterMap* pMap);
+static bool lookupLineDifferential(const RegisterMap* pMap, int addr,
+    u1* bits);
 
 #ifdef REGISTER_MAP_STATS
 /*
@@ -909,6 +911,22 @@ const u1* dvmRegisterMapGetLine(const RegisterMap* pMap, int addr)
     case kRegMapFormatCompact16:
         addrWidth = 2;
         break;
+    case kRegMapFormatDifferential:
+        {
+            /*
+             * Decode just the line we're after into a temporary copy
+             * rather than expanding the whole map.  This is freed by
+             * dvmReleaseRegisterMapLine().
+             */
+            u1* bits = (u1*) malloc(pMap->regWidth);
+            if (bits == NULL)
+                return NULL;
+            if (!lookupLineDifferential(pMap, addr, bits)) {
+                free(bits);
+                return NULL;
+            }
+            return bits;
+        }
     default:
         LOGE("Unknown format %d", format);
         dvmAbort();
@@ -1684,6 +1702,59 @@ static inline void toggleBit(u1* ptr, int idx)
     ptr[idx >> 3] ^= 1 << (idx & 0x07);
 }
 
+/*
+ * Find the bit vector for "addr" in a differential map without expanding
+ * the entire map.  Entries are stored in ascending address order, so we
+ * decode lines until we reach "addr" and stop as soon as we move past it.
+ * "bits" must be able to hold regWidth bytes.
+ *
+ * Returns true if an entry for "addr" was found.
+ */
+static bool lookupLineDifferential(const RegisterMap* pMap, int addr,
+    u1* bits)
+{
+    int regWidth = dvmRegisterMapGetRegWidth(pMap);
+    int numEntries = dvmRegisterMapGetNumEntries(pMap);
+
+    assert(dvmRegisterMapGetFormat(pMap) == kRegMapFormatDifferential);
+
+    const u1* srcPtr = pMap->data;
+    readUnsignedLeb128(&srcPtr);            /* skip the data size */
+
+    /* the 16-bit address flag doesn't matter here */
+    int lineAddr = *srcPtr++ & 0x7f;
+    memcpy(bits, srcPtr, regWidth);
+    srcPtr += regWidth;
+
+    int entry;
+    for (entry = 1; lineAddr < addr && entry < numEntries; entry++) {
+        u1 key = *srcPtr++;
+
+        if ((key & 0x07) == 7) {
+            lineAddr += readUnsignedLeb128(&srcPtr);
+        } else {
+            lineAddr += (key & 0x07) +1;
+        }
+
+        if ((key & 0x08) != 0) {
+            int bitCount = (key >> 4);
+            if (bitCount == 15) {
+                memcpy(bits, srcPtr, regWidth);
+                srcPtr += regWidth;
+            } else {
+                while (bitCount--) {
+                    int bitIndex = readUnsignedLeb128(&srcPtr);
+                    toggleBit(bits, bitIndex);
+                }
+            }
+        } else {
+            toggleBit(bits, key >> 4);
+        }
+    }
+
+    return lineAddr == addr;
+}
+
 /*
  * Expand a compressed map to an uncompressed form.
  *
@@ -142,11 +142,21 @@ const u1* dvmRegisterMapGetLine(const RegisterMap* pMap, int addr);
  * If "pMap" points to a compressed map from which we have expanded a
  * single line onto the heap, this will free "data"; otherwise, it does
  * nothing.
- *
- * TODO: decide if this is still a useful concept.
  */
 INLINE void dvmReleaseRegisterMapLine(const RegisterMap* pMap, const u1* data)
-{}
+{
+    if (dvmRegisterMapGetFormat(pMap) == kRegMapFormatDifferential)
+        free((void*) data);
+}
+
+/*
+ * Differential maps with no more than this many entries are not expanded
+ * at GC time; dvmRegisterMapGetLine() decodes the line it needs directly.
+ * Most methods are small, so this keeps the bulk of the expanded copies
+ * off the native heap while large (and expensive to walk) maps are still
+ * expanded once and cached.
+ */
+#define kRegMapDirectLookupMaxEntries   32
 
 
 /*
@@ -239,7 +249,8 @@ RegisterMap* dvmGenerateRegisterMapV(VerifierData* vdata);
 /*
  * Get the expanded form of the register map associated with the specified
  * method.  May update method->registerMap, possibly freeing the previous
- * map.
+ * map.  Small differential maps are returned as-is; they're still suitable
+ * for dvmRegisterMapGetLine().
  *
  * Returns NULL on failure (e.g. unable to expand map).
  *
@@ -255,6 +266,10 @@ INLINE const RegisterMap* dvmGetExpandedRegisterMap(Method* method)
     RegisterMapFormat format = dvmRegisterMapGetFormat(curMap);
     if (format == kRegMapFormatCompact8 || format == kRegMapFormatCompact16) {
         return curMap;
+    } else if (format == kRegMapFormatDifferential &&
+        dvmRegisterMapGetNumEntries(curMap) <= kRegMapDirectLookupMaxEntries)
+    {
+        return curMap;
     } else {
         return dvmGetExpandedRegisterMap0(method);
     }
@@ -308,22 +308,29 @@ static void resetCodeCache(void)
     /* Reset the JitEntry table contents to the initial unpopulated state */
     dvmJitResetTable();
 
+    /*
+     * Translations inherited from the zygote are kept - they are shared with
+     * the other children and never chain into anything compiled here.
+     */
+    unsigned int keepBytes = MAX(gDvmJit.templateSize,
+                                 gDvmJit.zygoteCacheByteUsed);
+
     UNPROTECT_CODE_CACHE(gDvmJit.codeCache, gDvmJit.codeCacheByteUsed);
     /*
      * Wipe out the code cache content to force immediate crashes if
      * stale JIT'ed code is invoked.
      */
-    memset((char *) gDvmJit.codeCache + gDvmJit.templateSize,
+    memset((char *) gDvmJit.codeCache + keepBytes,
            0,
-           gDvmJit.codeCacheByteUsed - gDvmJit.templateSize);
+           gDvmJit.codeCacheByteUsed - keepBytes);
     dvmCompilerCacheFlush((intptr_t) gDvmJit.codeCache,
                           (intptr_t) gDvmJit.codeCache +
                           gDvmJit.codeCacheByteUsed, 0);
 
     PROTECT_CODE_CACHE(gDvmJit.codeCache, gDvmJit.codeCacheByteUsed);
 
-    /* Reset the current mark of used bytes to the end of template code */
-    gDvmJit.codeCacheByteUsed = gDvmJit.templateSize;
+    /* Reset the current mark of used bytes to the end of kept code */
+    gDvmJit.codeCacheByteUsed = keepBytes;
     gDvmJit.numCompilations = 0;
 
     /* Reset the work queue */
@@ -369,46 +376,14 @@ void dvmCompilerPerformSafePointChecks(void)
     dvmCompilerPatchInlineCache();
 }
 
-static bool compilerThreadStartup(void)
+/* Allocate the JitTable, the profile table and the trace counters */
+static bool setupJitTables(void)
 {
     JitEntry *pJitTable = NULL;
     unsigned char *pJitProfTable = NULL;
     JitTraceProfCounters *pJitTraceProfCounters = NULL;
     unsigned int i;
 
-    if (!dvmCompilerArchInit())
-        goto fail;
-
-    /*
-     * Setup the code cache if we have not inherited a valid code cache
-     * from the zygote.
-     */
-    if (gDvmJit.codeCache == NULL) {
-        if (!dvmCompilerSetupCodeCache())
-            goto fail;
-    }
-
-    /* Allocate the initial arena block */
-    if (dvmCompilerHeapInit() == false) {
-        goto fail;
-    }
-
-    /* Cache the thread pointer */
-    gDvmJit.compilerThread = dvmThreadSelf();
-
-    dvmLockMutex(&gDvmJit.compilerLock);
-
-    /* Track method-level compilation statistics */
-    gDvmJit.methodStatsTable =  dvmHashTableCreate(32, NULL);
-
-#if defined(WITH_JIT_TUNING)
-    gDvm.verboseShutdown = true;
-#endif
-
-    dvmUnlockMutex(&gDvmJit.compilerLock);
-
-    /* Set up the JitTable */
-
     /* Power of 2? */
     assert(gDvmJit.jitTableSize &&
            !(gDvmJit.jitTableSize & (gDvmJit.jitTableSize - 1)));
@@ -420,7 +395,7 @@ static bool compilerThreadStartup(void)
     if (!pJitTable) {
         LOGE("jit table allocation failed");
         dvmUnlockMutex(&gDvmJit.tableLock);
-        goto fail;
+        return false;
     }
     /*
      * NOTE: the profile table must only be allocated once, globally.
@@ -435,7 +410,7 @@ static bool compilerThreadStartup(void)
         LOGE("jit prof table allocation failed");
         free(pJitProfTable);
         dvmUnlockMutex(&gDvmJit.tableLock);
-        goto fail;
+        return false;
     }
     memset(pJitProfTable, gDvmJit.threshold, JIT_PROF_SIZE);
     for (i=0; i < gDvmJit.jitTableSize; i++) {
@@ -450,7 +425,7 @@ static bool compilerThreadStartup(void)
     if (!pJitTraceProfCounters) {
         LOGE("jit trace prof counters allocation failed");
         dvmUnlockMutex(&gDvmJit.tableLock);
-        goto fail;
+        return false;
     }
 
     gDvmJit.pJitEntryTable = pJitTable;
@@ -468,10 +443,70 @@ static bool compilerThreadStartup(void)
     dvmJitUpdateThreadStateAll();
     dvmUnlockMutex(&gDvmJit.tableLock);
 
+    return true;
+}
+
+static bool compilerThreadStartup(void)
+{
+    /* Tables inherited from the zygote keep the size they had there */
+    bool inheritedTables = (gDvmJit.pJitEntryTable != NULL);
+    unsigned int jitTableSize = gDvmJit.jitTableSize;
+
+    if (!dvmCompilerArchInit())
+        goto fail;
+
+    /*
+     * Setup the code cache if we have not inherited a valid code cache
+     * from the zygote.
+     */
+    if (gDvmJit.codeCache == NULL) {
+        if (!dvmCompilerSetupCodeCache())
+            goto fail;
+    }
+
+    /* Allocate the initial arena block */
+    if (dvmCompilerHeapInit() == false) {
+        goto fail;
+    }
+
+    /* Cache the thread pointer */
+    gDvmJit.compilerThread = dvmThreadSelf();
+
+    dvmLockMutex(&gDvmJit.compilerLock);
+
+    /* Track method-level compilation statistics */
+    if (gDvmJit.methodStatsTable == NULL)
+        gDvmJit.methodStatsTable =  dvmHashTableCreate(32, NULL);
+
+#if defined(WITH_JIT_TUNING)
+    gDvm.verboseShutdown = true;
+#endif
+
+    dvmUnlockMutex(&gDvmJit.compilerLock);
+
+    /* Set up the JitTable */
+    if (!inheritedTables) {
+        if (!setupJitTables())
+            goto fail;
+    } else {
+        gDvmJit.jitTableSize = jitTableSize;
+        gDvmJit.jitTableMask = jitTableSize - 1;
+
+        /* The zygote turned trace requests off before forking us */
+        dvmLockMutex(&gDvmJit.tableLock);
+        gDvmJit.pProfTable =
+            dvmDebuggerOrProfilerActive() ? NULL : gDvmJit.pProfTableCopy;
+        dvmJitUpdateThreadStateAll();
+        dvmUnlockMutex(&gDvmJit.tableLock);
+    }
+
     /* Signal running threads to refresh their cached pJitTable pointers */
     dvmSuspendAllThreads(SUSPEND_FOR_REFRESH);
     dvmResumeAllThreads(SUSPEND_FOR_REFRESH);
 
+    /* Catch up on classes initialized before we had a profile table */
+    dvmJitWarmProfileSeedLoadedClasses();
+
     /* Enable signature breakpoints by customizing the following code */
 #if defined(SIGNATURE_BREAKPOINT)
     /*
@@ -594,9 +629,12 @@ static void *compilerThreadStart(void *arg)
      * point. In case the callback happens earlier, in order not to permanently
      * hold the system_server (which is not using the timed wait) in
      * interpreter-only mode we bypass the delay here.
+     *
+     * A compiler thread running in the zygote is there precisely to compile
+     * the framework preload, so it doesn't wait either.
      */
     if (gDvmJit.runningInAndroidFramework &&
-        !gDvmJit.alreadyEnabledViaFramework) {
+        !gDvmJit.alreadyEnabledViaFramework && !gDvm.zygote) {
         /*
          * If the current VM instance is the system server (detected by having
          * 0 in gDvm.systemServerPid), we will use the indefinite wait on the
@@ -641,6 +679,14 @@ static void *compilerThreadStart(void *arg)
             int cc;
             cc = pthread_cond_signal(&gDvmJit.compilerQueueEmpty);
             assert(cc == 0);
+            /* Good time to persist newly compiled trace heads */
+            if (gDvmJit.warmProfile != NULL) {
+                dvmUnlockMutex(&gDvmJit.compilerLock);
+                dvmJitWarmProfileSave(false);
+                dvmLockMutex(&gDvmJit.compilerLock);
+                if (workQueueLength() != 0 || gDvmJit.haltCompilerThread)
+                    continue;
+            }
             pthread_cond_wait(&gDvmJit.compilerQueueActivity,
                               &gDvmJit.compilerLock);
             continue;
@@ -754,6 +800,77 @@ bool dvmCompilerStartup(void)
                                    compilerThreadStart, NULL);
 }
 
+/*
+ * Called by the zygote before forking.  The first time around, let the
+ * compiler finish what the preload queued up and stop the compiler thread
+ * for good (the child inherits the code cache and the JIT tables, and
+ * starts a compiler thread of its own).  From then on the translations are
+ * shared copy-on-write with every child, so they are marked as off-limits
+ * for chaining and inline cache patches, which would otherwise dirty the
+ * pages in each process.
+ */
+void dvmCompilerPreZygoteFork(void)
+{
+    void *threadReturn;
+
+    if (!gDvmJit.compilerHandle)
+        return;
+
+    dvmCompilerDrainQueue();
+
+    gDvmJit.haltCompilerThread = true;
+    dvmLockMutex(&gDvmJit.compilerLock);
+    pthread_cond_signal(&gDvmJit.compilerQueueActivity);
+    dvmUnlockMutex(&gDvmJit.compilerLock);
+
+    if (pthread_join(gDvmJit.compilerHandle, &threadReturn) != 0) {
+        LOGE("Compiler thread join failed before zygote fork");
+        dvmAbort();
+    }
+    gDvmJit.compilerHandle = 0;
+    gDvmJit.haltCompilerThread = false;
+
+    /* Nothing to share if the compiler never got going */
+    if (gDvmJit.pProfTableCopy == NULL)
+        return;
+
+    /* The zygote itself has nothing left to compile for */
+    dvmLockMutex(&gDvmJit.tableLock);
+    gDvmJit.pProfTable = NULL;
+    dvmJitUpdateThreadStateAll();
+    dvmUnlockMutex(&gDvmJit.tableLock);
+
+    /* Children start compiling on a page of their own */
+    unsigned int byteUsed = (gDvmJit.codeCacheByteUsed +
+                             gDvmJit.pageSizeMask) & ~gDvmJit.pageSizeMask;
+
+    /*
+     * Leave the children enough room to compile their own code, or they
+     * would keep resetting the cache.  If the preload filled it up too much
+     * the children will simply throw the inherited translations away.
+     */
+    if (byteUsed > gDvmJit.codeCacheSize / 2) {
+        LOGW("JIT: %d bytes of zygote translations are not shared",
+             gDvmJit.codeCacheByteUsed);
+        return;
+    }
+
+    gDvmJit.codeCacheByteUsed = byteUsed;
+    gDvmJit.zygoteCacheByteUsed = byteUsed;
+    gDvmJit.zygoteTraceCounters = gDvmJit.pJitTraceProfCounters->next;
+
+    LOGD("JIT: sharing %d zygote translations (%d bytes) with children",
+         gDvmJit.numCompilations, byteUsed - gDvmJit.templateSize);
+}
+
+/* Is the address in the part of the code cache shared with the zygote? */
+bool dvmCompilerIsZygoteCode(const void *addr)
+{
+    return (const char *) addr >= (const char *) gDvmJit.codeCache &&
+           (const char *) addr < (const char *) gDvmJit.codeCache +
+                                  gDvmJit.zygoteCacheByteUsed;
+}
+
 void dvmCompilerShutdown(void)
 {
     void *threadReturn;
@@ -784,6 +901,9 @@ void dvmCompilerShutdown(void)
             LOGD("Compiler thread has shut down");
     }
 
+    /* Keep what we learned for the next run */
+    dvmJitWarmProfileSave(true);
+
     /* Break loops within the translation cache */
     dvmJitUnchainAll();
 
@@ -1151,12 +1151,18 @@ static void processCanThrow(CompilationUnit *cUnit, BasicBlock *curBlock,
  * Similar to dvmCompileTrace, but the entity processed here is the whole
  * method.
  *
+ * This is called in the middle of compiling a trace that invokes "method",
+ * so a failure here must not take the enclosing trace down with it.  We
+ * use our own bail point; on the way out info->codeAddress is NULL and
+ * the caller will stop trying this method.
+ *
  * TODO: implementation will be revisited when the trace builder can provide
  * whole-method traces.
  */
 bool dvmCompileMethod(const Method *method, JitTranslationInfo *info)
 {
     CompilationUnit cUnit;
+    jmp_buf bailBuf;
     const DexCode *dexCode = dvmGetMethodCode(method);
     const u2 *codePtr = dexCode->insns;
     const u2 *codeEnd = dexCode->insns + dexCode->insnsSize;
@@ -1171,9 +1177,18 @@ bool dvmCompileMethod(const Method *method, JitTranslationInfo *info)
 
     memset(&cUnit, 0, sizeof(cUnit));
     cUnit.method = method;
+    cUnit.printMe = gDvmJit.printMe;
 
     cUnit.jitMode = kJitMethod;
 
+    cUnit.bailPtr = &bailBuf;
+    if (setjmp(bailBuf)) {
+        LOGD("Jit: method compilation of %s%s abandoned",
+             method->clazz->descriptor, method->name);
+        info->codeAddress = NULL;
+        return false;
+    }
+
     /* Initialize the block list */
     dvmInitGrowableList(&cUnit.blockList, 4);
 
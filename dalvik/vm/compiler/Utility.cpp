@@ -23,7 +23,11 @@ static int numArenaBlocks;
 /* Allocate the initial memory block for arena-based allocation */
 bool dvmCompilerHeapInit(void)
 {
-    assert(arenaHead == NULL);
+    /* A compiler thread restarted after a zygote fork keeps its arena */
+    if (arenaHead != NULL) {
+        dvmCompilerArenaReset();
+        return true;
+    }
     arenaHead =
         (ArenaMemBlock *) malloc(sizeof(ArenaMemBlock) + ARENA_DEFAULT_SIZE);
     if (arenaHead == NULL) {
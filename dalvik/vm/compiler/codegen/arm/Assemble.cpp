@@ -1585,6 +1585,7 @@ static u4 assembleChainingBranch(int branchOffset, bool thumbTarget)
  * 22-bit branch offset.
  * If the target is nearby, use a single-instruction bl.
  * If one or more threads is suspended, don't chain.
+ * Translations shared with the zygote are never chained from.
  */
 void* dvmJitChain(void* tgtAddr, u4* branchAddr)
 {
@@ -1598,7 +1599,8 @@ void* dvmJitChain(void* tgtAddr, u4* branchAddr)
      * suspend themselves via the interpreter.
      */
     if ((gDvmJit.pProfTable != NULL) && (gDvm.sumThreadSuspendCount == 0) &&
-        (gDvmJit.codeCacheFull == false)) {
+        (gDvmJit.codeCacheFull == false) &&
+        !dvmCompilerIsZygoteCode(branchAddr)) {
         assert((branchOffset >= -(1<<22)) && (branchOffset <= ((1<<22)-2)));
 
         gDvmJit.translationChains++;
@@ -1760,6 +1762,11 @@ const Method *dvmJitToPatchPredictedChain(const Method *method,
 #else
     PredictedChainingCell newCell;
     int baseAddr, branchOffset, tgtAddr;
+    /* Keep the pages shared with the zygote clean */
+    if (dvmCompilerIsZygoteCode(cell)) {
+        newRechainCount = PREDICTED_CHAIN_COUNTER_AVOID;
+        goto done;
+    }
     if (dvmIsNativeMethod(method)) {
         UNPROTECT_CODE_CACHE(cell, sizeof(*cell));
 
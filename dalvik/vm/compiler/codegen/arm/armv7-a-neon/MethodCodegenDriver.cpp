@@ -430,8 +430,13 @@ static bool methodBlockCodeGen(CompilationUnit *cUnit, BasicBlock *bb)
 
 void dvmCompilerMethodMIR2LIR(CompilationUnit *cUnit)
 {
-    // FIXME - enable method compilation for selected routines here
-    if (strcmp(cUnit->method->name, "add")) return;
+    /*
+     * Nothing here sets up PC reconstruction cells yet, so only methods
+     * whose instructions can't throw are handled.
+     */
+    CompilerMethodStats *methodStats =
+        dvmCompilerAnalyzeMethodBody(cUnit->method, true);
+    if (!(methodStats->attributes & METHOD_IS_THROW_FREE)) return;
 
     /* Used to hold the labels of each block */
     cUnit->blockLabelList =
@@ -443,9 +448,6 @@ void dvmCompilerMethodMIR2LIR(CompilationUnit *cUnit)
 
     dvmCompilerApplyGlobalOptimizations(cUnit);
 
-    // FIXME - temporarily enable verbose printing for all methods
-    cUnit->printMe = true;
-
 #if defined(WITH_SELF_VERIFICATION)
     selfVerificationBranchInsertPass(cUnit);
 #endif
@@ -76,8 +76,9 @@ bool dvmCompilerArchVariantInit(void)
         dvmAbort();
     }
 
-    /* FIXME - comment out the following to enable method-based JIT */
-    gDvmJit.disableOpt |= (1 << kMethodJit);
+    /* Whole-method compilation of leaf callees is still opt-in */
+    if (!gDvmJit.wholeMethodJit)
+        gDvmJit.disableOpt |= (1 << kMethodJit);
 
     // Make sure all threads have current values
     dvmJitUpdateThreadStateAll();
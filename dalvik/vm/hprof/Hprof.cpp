@@ -15,11 +15,16 @@
  */
 
 /*
- * Preparation and completion of hprof data generation.  The output is
- * written into two files and then combined.  This is necessary because
- * we generate some of the data (strings and classes) while we dump the
- * heap, and some analysis tools require that the class and string data
- * appear first.
+ * Preparation and completion of hprof data generation.  We generate some
+ * of the data (strings and classes) while we dump the heap, and some
+ * analysis tools require that the class and string data appear first.
+ *
+ * When the dump goes to DDMS, the output is collected in two memory
+ * buffers and then combined.  When it goes to a file, we walk the heap
+ * twice instead: the first pass only collects the strings and classes,
+ * and the second streams the heap records straight to the file.  That
+ * costs some extra time with the world stopped, but memory use no longer
+ * grows with the size of the heap.
  */
 
 #include "Hprof.h"
@@ -32,6 +37,7 @@
 #include <errno.h>
 #include <sys/time.h>
 #include <time.h>
+#include <zlib.h>
 
 #define kHeadSuffix "-hptemp"
 
@@ -55,6 +61,27 @@ hprof_context_t* hprofStartup(const char *outputFileName, int fd,
     return ctx;
 }
 
+/*
+ * Write the strings and classes we collected while walking the heap,
+ * which have to precede the heap dump records.
+ */
+static void dumpHead(hprof_context_t *ctx)
+{
+    LOGI("hprof: dumping heap strings to \"%s\".", ctx->fileName);
+    hprofDumpStrings(ctx);
+    hprofDumpClasses(ctx);
+
+    /* Write a dummy stack trace record so the analysis
+     * tools don't freak out.
+     */
+    hprofStartNewRecord(ctx, HPROF_TAG_STACK_TRACE, HPROF_TIME);
+    hprofAddU4ToRecord(&ctx->curRec, HPROF_NULL_STACK_TRACE);
+    hprofAddU4ToRecord(&ctx->curRec, HPROF_NULL_THREAD);
+    hprofAddU4ToRecord(&ctx->curRec, 0);    // no frames
+
+    hprofFlushCurrentRecord(ctx);
+}
+
 /*
  * Finish up the hprof dump.  Returns true on success.
  */
@@ -76,19 +103,7 @@ bool hprofShutdown(hprof_context_t *tailCtx)
     hprofContextInit(headCtx, strdup(tailCtx->fileName), tailCtx->fd, true,
         tailCtx->directToDdms);
 
-    LOGI("hprof: dumping heap strings to \"%s\".", tailCtx->fileName);
-    hprofDumpStrings(headCtx);
-    hprofDumpClasses(headCtx);
-
-    /* Write a dummy stack trace record so the analysis
-     * tools don't freak out.
-     */
-    hprofStartNewRecord(headCtx, HPROF_TAG_STACK_TRACE, HPROF_TIME);
-    hprofAddU4ToRecord(&headCtx->curRec, HPROF_NULL_STACK_TRACE);
-    hprofAddU4ToRecord(&headCtx->curRec, HPROF_NULL_THREAD);
-    hprofAddU4ToRecord(&headCtx->curRec, 0);    // no frames
-
-    hprofFlushCurrentRecord(headCtx);
+    dumpHead(headCtx);
 
     hprofShutdown_Class();
     hprofShutdown_String();
@@ -165,6 +180,11 @@ void hprofFreeContext(hprof_context_t *ctx)
 
     if (ctx->memFp != NULL)
         fclose(ctx->memFp);
+    if (ctx->zstream != NULL) {
+        deflateEnd(ctx->zstream);
+        free(ctx->zstream);
+    }
+    free(ctx->outBuf);
     free(ctx->curRec.body);
     free(ctx->fileName);
     free(ctx->fileDataPtr);
@@ -222,35 +242,121 @@ static void hprofBitmapCallback(Object *obj, void *arg)
     hprofDumpHeapObject(ctx, obj);
 }
 
+/*
+ * Emit the roots and every live object.
+ */
+static void walkHeap(hprof_context_t *ctx)
+{
+    hprofStartHeapDump(ctx);
+    dvmVisitRoots(hprofRootVisitor, ctx);
+    dvmHeapBitmapWalk(dvmHeapSourceGetLiveBits(), hprofBitmapCallback, ctx);
+    hprofFinishHeapDump(ctx);
+//TODO: write a HEAP_SUMMARY record
+    hprofFlushCurrentRecord(ctx);
+}
+
+/*
+ * Stream a dump to "fd", or to a new file called "fileName" if "fd" is
+ * negative.  Returns true on success.
+ */
+static bool streamHeapDump(const char *fileName, int fd, int flags)
+{
+    int outFd;
+    if (fd >= 0) {
+        outFd = dup(fd);
+        if (outFd < 0) {
+            LOGE("dup(%d) failed: %s", fd, strerror(errno));
+            return false;
+        }
+    } else {
+        outFd = open(fileName, O_WRONLY|O_CREAT|O_TRUNC, 0644);
+        if (outFd < 0) {
+            LOGE("can't open %s: %s", fileName, strerror(errno));
+            return false;
+        }
+    }
+
+    hprof_context_t *ctx = (hprof_context_t *)malloc(sizeof(*ctx));
+    if (ctx == NULL) {
+        LOGE("hprof: can't allocate context.");
+        close(outFd);
+        return false;
+    }
+    if (!hprofContextInitStream(ctx, strdup(fileName), outFd,
+            (flags & HPROF_FLAG_COMPRESS) != 0))
+    {
+        hprofFreeContext(ctx);
+        close(outFd);
+        return false;
+    }
+    ctx->omitPrimitiveData = (flags & HPROF_FLAG_OMIT_PRIMITIVE_DATA) != 0;
+
+    hprofStartup_String();
+    hprofStartup_Class();
+
+    /* first pass: just find the strings and classes */
+    ctx->discardOutput = true;
+    walkHeap(ctx);
+    ctx->discardOutput = false;
+
+    hprofWriteHeader(ctx);
+    dumpHead(ctx);
+
+    /* second pass: the heap dump proper */
+    walkHeap(ctx);
+
+    hprofShutdown_Class();
+    hprofShutdown_String();
+
+    bool success = (hprofFinishStream(ctx) == 0);
+    if (success) {
+        /* throw out a log message for the benefit of "runhat" */
+        LOGI("hprof: heap dump completed (%dKB%s)",
+            (ctx->bytesWritten + 1023) / 1024,
+            (flags & HPROF_FLAG_COMPRESS) != 0 ? ", compressed" : "");
+    } else {
+        LOGE("hprof: write to \"%s\" failed", fileName);
+    }
+
+    hprofFreeContext(ctx);
+    close(outFd);
+    return success;
+}
+
 /*
  * Walk the roots and heap writing heap information to the specified
  * file.
  *
  * If "fd" is >= 0, the output will be written to that file descriptor.
- * Otherwise, "fileName" is used to create an output file.
+ * Otherwise, "fileName" is used to create an output file.  File output
+ * is streamed, so the dump doesn't need memory proportional to the heap.
  *
  * If "directToDdms" is set, the other arguments are ignored, and data is
- * sent directly to DDMS.
+ * sent directly to DDMS.  HPROF_FLAG_COMPRESS is ignored in that case,
+ * because DDMS expects a plain hprof file.
  *
  * Returns 0 on success, or an error code on failure.
  */
-int hprofDumpHeap(const char* fileName, int fd, bool directToDdms)
+int hprofDumpHeap(const char* fileName, int fd, bool directToDdms, int flags)
 {
-    hprof_context_t *ctx;
     int success;
 
     assert(fileName != NULL);
     dvmLockHeap();
     dvmSuspendAllThreads(SUSPEND_FOR_HPROF);
-    ctx = hprofStartup(fileName, fd, directToDdms);
-    if (ctx == NULL) {
-        return -1;
+    if (directToDdms) {
+        hprof_context_t *ctx = hprofStartup(fileName, fd, directToDdms);
+        if (ctx == NULL) {
+            success = -1;
+        } else {
+            ctx->omitPrimitiveData =
+                (flags & HPROF_FLAG_OMIT_PRIMITIVE_DATA) != 0;
+            walkHeap(ctx);
+            success = hprofShutdown(ctx) ? 0 : -1;
+        }
+    } else {
+        success = streamHeapDump(fileName, fd, flags) ? 0 : -1;
     }
-    dvmVisitRoots(hprofRootVisitor, ctx);
-    dvmHeapBitmapWalk(dvmHeapSourceGetLiveBits(), hprofBitmapCallback, ctx);
-    hprofFinishHeapDump(ctx);
-//TODO: write a HEAP_SUMMARY record
-    success = hprofShutdown(ctx) ? 0 : -1;
     dvmResumeAllThreads(SUSPEND_FOR_HPROF);
     dvmUnlockHeap();
     return success;
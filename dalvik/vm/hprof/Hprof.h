@@ -23,6 +23,14 @@
 #define UNIQUE_ERROR() \
     -((((uintptr_t)__func__) << 16 | __LINE__) & (0x7fffffff))
 
+/*
+ * Flags for hprofDumpHeap().
+ */
+enum {
+    HPROF_FLAG_COMPRESS             = 0x01,     // gzip the output
+    HPROF_FLAG_OMIT_PRIMITIVE_DATA  = 0x02,     // no primitive array contents
+};
+
 #define HPROF_TIME 0
 #define HPROF_NULL_STACK_TRACE   0
 #define HPROF_NULL_THREAD        0
@@ -140,6 +148,22 @@ struct hprof_context_t {
     size_t fileDataSize;        // for open_memstream
     FILE *memFp;
     int fd;
+
+    /*
+     * If "streaming" is set, records are written to "fd" as they are
+     * flushed, through "outBuf" and optionally a gzip stream, instead
+     * of being collected in memFp.  While "discardOutput" is set the
+     * records are thrown away; that's used for the pass that only
+     * finds the strings and classes.
+     */
+    bool streaming;
+    bool discardOutput;
+    bool omitPrimitiveData;
+    bool writeFailed;
+    struct z_stream_s *zstream;
+    unsigned char *outBuf;
+    size_t outLen;
+    size_t bytesWritten;
 };
 
 
@@ -187,8 +211,12 @@ int hprofDumpHeapObject(hprof_context_t *ctx, const Object *obj);
 
 void hprofContextInit(hprof_context_t *ctx, char *fileName, int fd,
                       bool writeHeader, bool directToDdms);
+bool hprofContextInitStream(hprof_context_t *ctx, char *fileName, int fd,
+                            bool compress);
+int hprofWriteHeader(hprof_context_t *ctx);
+int hprofFinishStream(hprof_context_t *ctx);
 
-int hprofFlushRecord(hprof_record_t *rec, FILE *fp);
+int hprofFlushRecord(hprof_context_t *ctx, hprof_record_t *rec);
 int hprofFlushCurrentRecord(hprof_context_t *ctx);
 int hprofStartNewRecord(hprof_context_t *ctx, u1 tag, u4 time);
 
@@ -222,6 +250,6 @@ hprof_context_t* hprofStartup(const char *outputFileName, int fd,
     bool directToDdms);
 bool hprofShutdown(hprof_context_t *ctx);
 void hprofFreeContext(hprof_context_t *ctx);
-int hprofDumpHeap(const char* fileName, int fd, bool directToDdms);
+int hprofDumpHeap(const char* fileName, int fd, bool directToDdms, int flags);
 
 #endif  // DALVIK_HPROF_HPROF_H_
@@ -20,7 +20,8 @@
 
 /* Set DUMP_PRIM_DATA to 1 if you want to include the contents
  * of primitive arrays (byte arrays, character arrays, etc.)
- * in heap dumps.  This can be a large amount of data.
+ * in heap dumps.  This can be a large amount of data.  A single dump
+ * can also leave them out with HPROF_FLAG_OMIT_PRIMITIVE_DATA.
  */
 #define DUMP_PRIM_DATA 1
 
@@ -377,21 +378,23 @@ int hprofDumpHeapObject(hprof_context_t *ctx, const Object *obj)
 
                 /* obj is a primitive array.
                  */
-#if DUMP_PRIM_DATA
-                hprofAddU1ToRecord(rec, HPROF_PRIMITIVE_ARRAY_DUMP);
-#else
-                hprofAddU1ToRecord(rec, HPROF_PRIMITIVE_ARRAY_NODATA_DUMP);
-#endif
+                bool dumpPrimData = DUMP_PRIM_DATA && !ctx->omitPrimitiveData;
+                if (dumpPrimData) {
+                    hprofAddU1ToRecord(rec, HPROF_PRIMITIVE_ARRAY_DUMP);
+                } else {
+                    hprofAddU1ToRecord(rec, HPROF_PRIMITIVE_ARRAY_NODATA_DUMP);
+                }
 
                 hprofAddIdToRecord(rec, (hprof_object_id)obj);
                 hprofAddU4ToRecord(rec, stackTraceSerialNumber(obj));
                 hprofAddU4ToRecord(rec, length);
                 hprofAddU1ToRecord(rec, t);
 
-#if DUMP_PRIM_DATA
                 /* Dump the raw, packed element values.
                  */
-                if (size == 1) {
+                if (!dumpPrimData) {
+                    /* contents omitted */
+                } else if (size == 1) {
                     hprofAddU1ListToRecord(rec, (const u1 *)aobj->contents,
                             length);
                 } else if (size == 2) {
@@ -404,7 +407,6 @@ int hprofDumpHeapObject(hprof_context_t *ctx, const Object *obj)
                     hprofAddU8ListToRecord(rec, (const u8 *)aobj->contents,
                             length);
                 }
-#endif
             }
         } else {
             const ClassObject *sclass;
@@ -17,10 +17,14 @@
 #include <cutils/open_memstream.h>
 #include <time.h>
 #include <errno.h>
+#include <zlib.h>
 #include "Hprof.h"
 
 #define HPROF_MAGIC_STRING  "JAVA PROFILE 1.0.3"
 
+/* size of the staging buffer used when streaming to an fd */
+#define STREAM_BUFFER_SIZE  ((size_t)64 * 1024)
+
 #define U2_TO_BUF_BE(buf, offset, value) \
     do { \
         unsigned char *buf_ = (unsigned char *)(buf); \
@@ -88,60 +92,228 @@ void hprofContextInit(hprof_context_t *ctx, char *fileName, int fd,
 //xxx check for/return an error
 
     if (writeHeader) {
-        char magic[] = HPROF_MAGIC_STRING;
-        unsigned char buf[4];
-        struct timeval now;
-        u8 nowMs;
-
-        /* Write the file header.
-         *
-         * [u1]*: NUL-terminated magic string.
-         */
-        fwrite(magic, 1, sizeof(magic), fp);
+        hprofWriteHeader(ctx);
+    }
+}
 
-        /* u4: size of identifiers.  We're using addresses
-         *     as IDs, so make sure a pointer fits.
-         */
-        U4_TO_BUF_BE(buf, 0, sizeof(void *));
-        fwrite(buf, 1, sizeof(u4), fp);
+/*
+ * Initialize an hprof context struct that writes its records straight to
+ * "fd" as they are flushed, so that memory use doesn't grow with the size
+ * of the heap.  The header is not written; call hprofWriteHeader() when
+ * ready.
+ *
+ * This will take ownership of "fileName", but not of "fd".
+ */
+bool hprofContextInitStream(hprof_context_t *ctx, char *fileName, int fd,
+                            bool compress)
+{
+    memset(ctx, 0, sizeof (*ctx));
 
-        /* The current time, in milliseconds since 0:00 GMT, 1/1/70.
+    ctx->fileName = fileName;
+    ctx->fd = fd;
+    ctx->streaming = true;
+
+    ctx->curRec.allocLen = 128;
+    ctx->curRec.body = (unsigned char *)malloc(ctx->curRec.allocLen);
+    ctx->outBuf = (unsigned char *)malloc(STREAM_BUFFER_SIZE);
+    if (ctx->curRec.body == NULL || ctx->outBuf == NULL) {
+        LOGE("hprof: can't allocate output buffers");
+        return false;
+    }
+
+    if (compress) {
+        z_stream *zstream = (z_stream *)calloc(1, sizeof(*zstream));
+        if (zstream == NULL) {
+            LOGE("hprof: can't allocate compression state");
+            return false;
+        }
+        /* 16 + MAX_WBITS gets us a gzip header and trailer.  Favor speed
+         * over size, since the world is stopped while we do this.
          */
-        if (gettimeofday(&now, NULL) < 0) {
-            nowMs = 0;
-        } else {
-            nowMs = (u8)now.tv_sec * 1000 + now.tv_usec / 1000;
+        int zerr = deflateInit2(zstream, Z_BEST_SPEED, Z_DEFLATED,
+                16 + MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+        if (zerr != Z_OK) {
+            LOGE("hprof: deflateInit2 failed: %d", zerr);
+            free(zstream);
+            return false;
         }
+        ctx->zstream = zstream;
+    }
 
-        /* u4: high word of the 64-bit time.
-         */
-        U4_TO_BUF_BE(buf, 0, (u4)(nowMs >> 32));
-        fwrite(buf, 1, sizeof(u4), fp);
+    return true;
+}
 
-        /* u4: low word of the 64-bit time.
-         */
-        U4_TO_BUF_BE(buf, 0, (u4)(nowMs & 0xffffffffULL));
-        fwrite(buf, 1, sizeof(u4), fp); //xxx fix the time
+/*
+ * Write out whatever is in the staging buffer.
+ *
+ * A write failure doesn't stop the heap walk -- we just drop the rest of
+ * the output and report the failure from hprofFinishStream().
+ */
+static void flushStreamBuffer(hprof_context_t *ctx)
+{
+    if (ctx->outLen == 0) {
+        return;
+    }
+    if (!ctx->writeFailed &&
+        sysWriteFully(ctx->fd, ctx->outBuf, ctx->outLen, "hprof") != 0)
+    {
+        ctx->writeFailed = true;
+    }
+    ctx->bytesWritten += ctx->outLen;
+    ctx->outLen = 0;
+}
+
+/*
+ * Run "len" bytes (possibly zero, when finishing) through the compressor.
+ */
+static int deflateToStream(hprof_context_t *ctx, const void *data, size_t len,
+                           int flush)
+{
+    z_stream *zstream = ctx->zstream;
+
+    zstream->next_in = (Bytef *)data;
+    zstream->avail_in = len;
+    for (;;) {
+        zstream->next_out = ctx->outBuf + ctx->outLen;
+        zstream->avail_out = STREAM_BUFFER_SIZE - ctx->outLen;
+        int zerr = deflate(zstream, flush);
+        ctx->outLen = STREAM_BUFFER_SIZE - zstream->avail_out;
+        if ((zerr != Z_OK && zerr != Z_STREAM_END && zerr != Z_BUF_ERROR) ||
+            (zerr == Z_BUF_ERROR && zstream->avail_out != 0))
+        {
+            /* Z_BUF_ERROR with room left means no progress was possible */
+            if (zerr != Z_BUF_ERROR) {
+                LOGE("hprof: deflate failed: %d", zerr);
+                ctx->writeFailed = true;
+                return UNIQUE_ERROR();
+            }
+            return 0;
+        }
+        if (zstream->avail_out == 0) {
+            flushStreamBuffer(ctx);
+            continue;
+        }
+        if (flush == Z_FINISH ? zerr == Z_STREAM_END : zstream->avail_in == 0) {
+            return 0;
+        }
+    }
+}
+
+/*
+ * Append raw bytes to the output.
+ */
+static int hprofWrite(hprof_context_t *ctx, const void *data, size_t len)
+{
+    if (ctx->discardOutput || ctx->writeFailed) {
+        return 0;
+    }
+
+    if (!ctx->streaming) {
+        if (fwrite(data, 1, len, ctx->memFp) != len) {
+            return UNIQUE_ERROR();
+        }
+        return 0;
     }
+
+    if (ctx->zstream != NULL) {
+        return deflateToStream(ctx, data, len, Z_NO_FLUSH);
+    }
+
+    const unsigned char *ptr = (const unsigned char *)data;
+    while (len > 0) {
+        size_t chunk = STREAM_BUFFER_SIZE - ctx->outLen;
+        if (chunk > len) {
+            chunk = len;
+        }
+        memcpy(ctx->outBuf + ctx->outLen, ptr, chunk);
+        ctx->outLen += chunk;
+        ptr += chunk;
+        len -= chunk;
+        if (ctx->outLen == STREAM_BUFFER_SIZE) {
+            flushStreamBuffer(ctx);
+        }
+    }
+    return 0;
 }
 
-int hprofFlushRecord(hprof_record_t *rec, FILE *fp)
+/*
+ * Push everything we've got out to the fd, and close out the gzip stream
+ * if there is one.  Returns nonzero if anything failed along the way.
+ */
+int hprofFinishStream(hprof_context_t *ctx)
+{
+    assert(ctx->streaming);
+
+    if (ctx->zstream != NULL) {
+        if (!ctx->writeFailed) {
+            deflateToStream(ctx, NULL, 0, Z_FINISH);
+        }
+        deflateEnd(ctx->zstream);
+        free(ctx->zstream);
+        ctx->zstream = NULL;
+    }
+    flushStreamBuffer(ctx);
+
+    return ctx->writeFailed ? UNIQUE_ERROR() : 0;
+}
+
+int hprofWriteHeader(hprof_context_t *ctx)
+{
+    char magic[] = HPROF_MAGIC_STRING;
+    unsigned char buf[3 * sizeof(u4)];
+    struct timeval now;
+    u8 nowMs;
+
+    /* Write the file header.
+     *
+     * [u1]*: NUL-terminated magic string.
+     */
+    int err = hprofWrite(ctx, magic, sizeof(magic));
+    if (err != 0) {
+        return err;
+    }
+
+    /* u4: size of identifiers.  We're using addresses
+     *     as IDs, so make sure a pointer fits.
+     */
+    U4_TO_BUF_BE(buf, 0, sizeof(void *));
+
+    /* The current time, in milliseconds since 0:00 GMT, 1/1/70.
+     */
+    if (gettimeofday(&now, NULL) < 0) {
+        nowMs = 0;
+    } else {
+        nowMs = (u8)now.tv_sec * 1000 + now.tv_usec / 1000;
+    }
+
+    /* u4: high word of the 64-bit time.
+     */
+    U4_TO_BUF_BE(buf, 4, (u4)(nowMs >> 32));
+
+    /* u4: low word of the 64-bit time.
+     */
+    U4_TO_BUF_BE(buf, 8, (u4)(nowMs & 0xffffffffULL));
+
+    return hprofWrite(ctx, buf, sizeof(buf)); //xxx fix the time
+}
+
+int hprofFlushRecord(hprof_context_t *ctx, hprof_record_t *rec)
 {
     if (rec->dirty) {
         unsigned char headBuf[sizeof (u1) + 2 * sizeof (u4)];
-        int nb;
+        int err;
 
         headBuf[0] = rec->tag;
         U4_TO_BUF_BE(headBuf, 1, rec->time);
         U4_TO_BUF_BE(headBuf, 5, rec->length);
 
-        nb = fwrite(headBuf, 1, sizeof(headBuf), fp);
-        if (nb != sizeof(headBuf)) {
-            return UNIQUE_ERROR();
+        err = hprofWrite(ctx, headBuf, sizeof(headBuf));
+        if (err != 0) {
+            return err;
         }
-        nb = fwrite(rec->body, 1, rec->length, fp);
-        if (nb != (int)rec->length) {
-            return UNIQUE_ERROR();
+        err = hprofWrite(ctx, rec->body, rec->length);
+        if (err != 0) {
+            return err;
         }
 
         rec->dirty = false;
@@ -153,7 +325,7 @@ int hprofFlushRecord(hprof_record_t *rec, FILE *fp)
 
 int hprofFlushCurrentRecord(hprof_context_t *ctx)
 {
-    return hprofFlushRecord(&ctx->curRec, ctx->memFp);
+    return hprofFlushRecord(ctx, &ctx->curRec);
 }
 
 int hprofStartNewRecord(hprof_context_t *ctx, u1 tag, u4 time)
@@ -161,7 +333,7 @@ int hprofStartNewRecord(hprof_context_t *ctx, u1 tag, u4 time)
     hprof_record_t *rec = &ctx->curRec;
     int err;
 
-    err = hprofFlushRecord(rec, ctx->memFp);
+    err = hprofFlushRecord(ctx, rec);
     if (err != 0) {
         return err;
     } else if (rec->dirty) {
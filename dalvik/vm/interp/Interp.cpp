@@ -571,7 +571,8 @@ bool dvmAddSingleStep(Thread* thread, int size, int depth)
 
     /*
      * Pull the goodies out.  "xtra.currentPc" should be accurate since
-     * we update it on every instruction while the debugger is connected.
+     * the thread is suspended, and the PC is exported at every suspension
+     * point.
      */
     pCtrl->method = saveArea->method;
     // Clear out any old address set
@@ -665,7 +666,7 @@ void dvmReportPreNativeInvoke(const Method* methodToCall, Thread* self, u4* fp)
         dvmCheckJit(self->interpSave.pc, self);
     }
 #endif
-    if (self->interpBreak.ctl.subMode & kSubModeDebuggerActive) {
+    if (self->interpBreak.ctl.subMode & kSubModeDebuggerStep) {
         Object* thisPtr = dvmGetThisPtr(self->interpSave.method, fp);
         assert(thisPtr == NULL || dvmIsHeapAddress(thisPtr));
         dvmDbgPostLocationEvent(methodToCall, -1, thisPtr, DBG_METHOD_ENTRY);
@@ -679,7 +680,7 @@ void dvmReportPreNativeInvoke(const Method* methodToCall, Thread* self, u4* fp)
  */
 void dvmReportPostNativeInvoke(const Method* methodToCall, Thread* self, u4* fp)
 {
-    if (self->interpBreak.ctl.subMode & kSubModeDebuggerActive) {
+    if (self->interpBreak.ctl.subMode & kSubModeDebuggerStep) {
         Object* thisPtr = dvmGetThisPtr(self->interpSave.method, fp);
         assert(thisPtr == NULL || dvmIsHeapAddress(thisPtr));
         dvmDbgPostLocationEvent(methodToCall, -1, thisPtr, DBG_METHOD_EXIT);
@@ -1681,6 +1682,9 @@ void dvmInitializeInterpBreak(Thread* thread)
     if (gDvm.debuggerActive) {
         dvmEnableSubMode(thread, kSubModeDebuggerActive);
     }
+    if (gDvm.debuggerInstrEvents) {
+        dvmEnableSubMode(thread, kSubModeDebuggerStep);
+    }
 #if 0
     // Debugging stress mode - force checkBefore
     dvmEnableSubMode(thread, kSubModeCheckAlways);
@@ -1761,7 +1765,7 @@ void dvmCheckBefore(const u2 *pc, u4 *fp, Thread* self)
         }
     }
 
-    if (self->interpBreak.ctl.subMode & kSubModeDebuggerActive) {
+    if (self->interpBreak.ctl.subMode & kSubModeDebuggerStep) {
         updateDebugger(method, pc, fp, self);
     }
     if (gDvm.instructionCountEnableCount != 0) {
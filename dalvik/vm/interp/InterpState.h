@@ -52,6 +52,7 @@ enum ExecutionSubModes {
     kSubModeCallbackPending   = 0x0020,
     kSubModeCountedStep       = 0x0040,
     kSubModeCheckAlways       = 0x0080,
+    kSubModeDebuggerStep      = 0x0100,   /* debugger watches every inst */
     kSubModeJitTraceBuild     = 0x4000,
     kSubModeJitSV             = 0x8000,
     kSubModeDebugProfile   = (kSubModeMethodTrace |
@@ -77,7 +78,7 @@ enum InterpBreakFlags {
  * the future we might want to make this mapping target-dependent.
  */
 #define SINGLESTEP_BREAK_MASK ( kSubModeInstCounting | \
-                                kSubModeDebuggerActive | \
+                                kSubModeDebuggerStep | \
                                 kSubModeCountedStep | \
                                 kSubModeCheckAlways | \
                                 kSubModeJitSV | \
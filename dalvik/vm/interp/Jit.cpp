@@ -944,6 +944,10 @@ void dvmCheckJit(const u2* pc, Thread* self)
                 if (dvmCompilerWorkEnqueue(
                        self->currTraceHead,kWorkOrderTrace,desc)) {
                     /* Work order successfully enqueued */
+                    if (gDvmJit.warmProfile != NULL) {
+                        dvmJitWarmProfileRecord(self->traceMethod,
+                                                self->currTraceHead);
+                    }
                     if (gDvmJit.blockingMode) {
                         dvmCompilerDrainQueue();
                     }
@@ -1203,6 +1207,14 @@ void dvmJitCheckTraceRequest(Thread* self)
     /* Check if the JIT request can be handled now */
     if ((gDvmJit.pJitEntryTable != NULL) &&
         ((self->interpBreak.ctl.breakFlags & kInterpSingleStep) == 0)){
+        /* Traces that were hot in an earlier run don't need to prove it */
+        if (self->jitState == kJitTSelectRequest &&
+            gDvmJit.warmProfile != NULL &&
+            dvmJitIsWarmTraceHead(self->interpSave.method,
+                                  self->interpSave.pc)) {
+            self->jitState = kJitTSelectRequestHot;
+        }
+
         /* Bypass the filter for hot trace requests or during stress mode */
         if (self->jitState == kJitTSelectRequest &&
             gDvmJit.threshold > 6) {
@@ -1367,16 +1379,35 @@ bool dvmJitResizeJitTable( unsigned int size )
 }
 
 /*
- * Reset the JitTable to the initial clean state.
+ * Reset the JitTable to the initial clean state.  Translations inherited
+ * from the zygote survive the code cache reset, so their entries are put
+ * back afterwards.
  */
 void dvmJitResetTable()
 {
     JitEntry *jitEntry = gDvmJit.pJitEntryTable;
     unsigned int size = gDvmJit.jitTableSize;
     unsigned int i;
+    JitEntry *keep = NULL;
+    unsigned int numKeep = 0;
 
     dvmLockMutex(&gDvmJit.tableLock);
 
+    if (gDvmJit.zygoteCacheByteUsed != 0 && gDvmJit.jitTableEntriesUsed != 0) {
+        keep = (JitEntry *) malloc(sizeof(JitEntry) *
+                                   gDvmJit.jitTableEntriesUsed);
+        if (keep == NULL) {
+            LOGW("JIT: no memory to keep the zygote translations on reset");
+        } else {
+            for (i=0; i < size; i++) {
+                if (jitEntry[i].dPC != NULL &&
+                    dvmCompilerIsZygoteCode(jitEntry[i].codeAddress)) {
+                    keep[numKeep++] = jitEntry[i];
+                }
+            }
+        }
+    }
+
     /* Note: If need to preserve any existing counts. Do so here. */
     if (gDvmJit.pJitTraceProfCounters) {
         for (i=0; i < JIT_PROF_BLOCK_BUCKETS; i++) {
@@ -1384,7 +1415,8 @@ void dvmJitResetTable()
                 memset((void *) gDvmJit.pJitTraceProfCounters->buckets[i],
                        0, sizeof(JitTraceCounter_t) * JIT_PROF_BLOCK_ENTRIES);
         }
-        gDvmJit.pJitTraceProfCounters->next = 0;
+        /* Counters embedded in the zygote translations stay taken */
+        gDvmJit.pJitTraceProfCounters->next = gDvmJit.zygoteTraceCounters;
     }
 
     memset((void *) jitEntry, 0, sizeof(JitEntry) * size);
@@ -1392,6 +1424,19 @@ void dvmJitResetTable()
         jitEntry[i].u.info.chain = size;  /* Initialize chain termination */
     }
     gDvmJit.jitTableEntriesUsed = 0;
+
+    for (i=0; i < numKeep; i++) {
+        JitEntry *entry = lookupAndAdd(keep[i].dPC, true /* callerLocked */,
+                                       keep[i].u.info.isMethodEntry);
+        if (entry == NULL)
+            break;
+        JitEntryInfoUnion newValue = keep[i].u;
+        newValue.info.chain = entry->u.info.chain;
+        entry->u = newValue;
+        entry->codeAddress = keep[i].codeAddress;
+    }
+    free(keep);
+
     dvmUnlockMutex(&gDvmJit.tableLock);
 }
 
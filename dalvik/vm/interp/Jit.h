@@ -177,4 +177,12 @@ void dvmJitUpdateThreadStateAll(void);
 void dvmJitResumeTranslation(Thread* self, const u2* pc, const u4* fp);
 }
 
+/* Hot trace heads remembered across runs, see JitProfile.cpp */
+void dvmJitWarmProfileOpen(const char* sourceName);
+void dvmJitWarmProfileInitClass(const ClassObject* clazz);
+void dvmJitWarmProfileSeedLoadedClasses(void);
+bool dvmJitIsWarmTraceHead(const Method* method, const u2* pc);
+void dvmJitWarmProfileRecord(const Method* method, const u2* pc);
+void dvmJitWarmProfileSave(bool force);
+
 #endif  // DALVIK_INTERP_JIT_H_
@@ -0,0 +1,482 @@
+/*
+ * Copyright (C) 2011 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifdef WITH_JIT
+
+/*
+ * Warm start for the trace JIT.
+ *
+ * Every process starts with an empty code cache and has to rediscover its
+ * hot traces through the profile counters, so the first seconds of each
+ * run are interpreted.  To shorten that, we remember the trace heads that
+ * got compiled and store them in a per-APK file under the directory given
+ * with -Xjitwarmstart.  On the next launch:
+ *
+ *  - the compiler thread is started right away instead of after the usual
+ *    startup delay;
+ *  - when a class with remembered trace heads is initialized, the profile
+ *    counters of those heads are set to fire on their next execution;
+ *  - a remembered trace head skips the second-level hotness filter.
+ *
+ * A remembered trace is thus selected and compiled the first time it runs.
+ * We don't persist the trace descriptions themselves: they point at
+ * resolved methods and callsite classes that only exist in this process,
+ * and one interpreted pass through the trace recovers them.
+ *
+ * Entries are keyed by a hash of the method's class descriptor, name and
+ * shorty plus the trace head's offset, and tagged with the checksum of the
+ * DEX file defining the method.  An entry whose DEX has changed never
+ * matches, and is dropped from the file once the new DEX has been seen.
+ * A hash collision can only make us compile some other trace early.
+ */
+
+#include "Dalvik.h"
+#include "Jit.h"
+
+#include <fcntl.h>
+#include <limits.h>
+#include <unistd.h>
+#include <errno.h>
+
+#define kWarmProfileMagic       0x3150574a      /* "JWP1" */
+#define kNumWarmEntries         4096            /* MUST be power of 2 */
+#define kNumWarmClassBits       4096            /* MUST be power of 2 */
+
+/* save at most this often, and only after this many new trace heads */
+#define kWarmSaveIntervalUsec   (10 * 1000 * 1000)
+#define kWarmSaveMinNewEntries  16
+
+/*
+ * A remembered trace head.  The first four words are what goes to disk.
+ */
+struct JitWarmEntry {
+    u4      checksum;       /* checksum of the method's DEX; 0 if unused */
+    u4      classHash;      /* hash of the class descriptor */
+    u4      methodHash;     /* hash of descriptor, name and shorty */
+    u4      offset;         /* trace head, in 16-bit units from insns */
+    bool    recorded;       /* compiled in this run */
+    bool    stale;          /* the method now comes from a different DEX */
+};
+
+struct JitWarmProfile {
+    pthread_mutex_t lock;
+    char*           fileName;
+
+    /* linear probing on methodHash, never more than 3/4 full */
+    JitWarmEntry    entries[kNumWarmEntries];
+    int             numEntries;
+
+    int             numUnsaved;
+    u8              lastSaveUsec;
+
+    /* classes that may have entries, indexed by the low bits of classHash */
+    u1              classFilter[kNumWarmClassBits / 8];
+};
+
+static u4 hashMethod(const Method* method, u4 classHash)
+{
+    u4 hash = classHash;
+    hash = hash * 31 + dvmComputeUtf8Hash(method->name);
+    hash = hash * 31 + dvmComputeUtf8Hash(method->shorty);
+    return hash;
+}
+
+/*
+ * Return the checksum of the DEX file that defines "clazz", or 0 for
+ * classes that don't come from one.
+ */
+static u4 getDexChecksum(const ClassObject* clazz)
+{
+    if (clazz->pDvmDex == NULL)
+        return 0;
+    return clazz->pDvmDex->pHeader->checksum;
+}
+
+static inline bool testClassFilter(const JitWarmProfile* profile, u4 classHash)
+{
+    u4 bit = classHash & (kNumWarmClassBits - 1);
+    return (profile->classFilter[bit >> 3] & (1 << (bit & 7))) != 0;
+}
+
+static inline void setClassFilter(JitWarmProfile* profile, u4 classHash)
+{
+    u4 bit = classHash & (kNumWarmClassBits - 1);
+    profile->classFilter[bit >> 3] |= 1 << (bit & 7);
+}
+
+/*
+ * Find an entry, or the free slot where it belongs.  Entries with the same
+ * methodHash are all in the probe run that starts at their home slot.
+ *
+ * Must be called with the profile lock held.
+ */
+static JitWarmEntry* findEntry(JitWarmProfile* profile, u4 checksum,
+    u4 methodHash, u4 offset)
+{
+    int idx = methodHash & (kNumWarmEntries - 1);
+
+    while (true) {
+        JitWarmEntry* pEntry = &profile->entries[idx];
+        if (pEntry->checksum == 0)
+            return pEntry;
+        if (pEntry->methodHash == methodHash && pEntry->offset == offset &&
+            pEntry->checksum == checksum)
+        {
+            return pEntry;
+        }
+        idx = (idx + 1) & (kNumWarmEntries - 1);
+    }
+}
+
+/*
+ * Add an entry if it's new.  Returns the entry, or NULL if the table is
+ * full.
+ *
+ * Must be called with the profile lock held.
+ */
+static JitWarmEntry* addEntry(JitWarmProfile* profile, u4 checksum,
+    u4 classHash, u4 methodHash, u4 offset)
+{
+    JitWarmEntry* pEntry = findEntry(profile, checksum, methodHash, offset);
+
+    if (pEntry->checksum == 0) {
+        if (profile->numEntries >= kNumWarmEntries * 3 / 4)
+            return NULL;
+        pEntry->checksum = checksum;
+        pEntry->classHash = classHash;
+        pEntry->methodHash = methodHash;
+        pEntry->offset = offset;
+        pEntry->recorded = false;
+        pEntry->stale = false;
+        profile->numEntries++;
+        setClassFilter(profile, classHash);
+    }
+    return pEntry;
+}
+
+/*
+ * Read the entries saved by an earlier run.  A missing or damaged file
+ * just leaves the profile empty.
+ */
+static void loadProfile(JitWarmProfile* profile)
+{
+    int fd = open(profile->fileName, O_RDONLY);
+    if (fd < 0) {
+        if (errno != ENOENT) {
+            LOGW("JIT: can't open warm profile '%s': %s",
+                profile->fileName, strerror(errno));
+        }
+        return;
+    }
+
+    u4 header[2];
+    if (read(fd, header, sizeof(header)) != (ssize_t) sizeof(header) ||
+        header[0] != kWarmProfileMagic)
+    {
+        LOGW("JIT: ignoring bad warm profile '%s'", profile->fileName);
+        close(fd);
+        return;
+    }
+
+    u4 count = header[1];
+    for (u4 i = 0; i < count; i++) {
+        u4 words[4];
+        if (read(fd, words, sizeof(words)) != (ssize_t) sizeof(words))
+            break;
+        if (words[0] == 0)
+            continue;
+        if (addEntry(profile, words[0], words[1], words[2], words[3]) == NULL)
+            break;
+    }
+    close(fd);
+
+    LOGV("JIT: loaded %d warm trace heads from '%s'",
+        profile->numEntries, profile->fileName);
+}
+
+/*
+ * Write the profile.  Entries from DEX files we haven't seen in this run
+ * are kept around, in case the app just didn't load them this time; only
+ * entries whose method now comes from a different DEX are dropped.
+ * Writes to a temporary file and renames it so that a reader never sees a
+ * partial profile.
+ *
+ * Must be called with the profile lock held.
+ */
+static bool saveProfile(JitWarmProfile* profile)
+{
+    char tmpName[PATH_MAX];
+    snprintf(tmpName, sizeof(tmpName), "%s.%d", profile->fileName, getpid());
+
+    int fd = open(tmpName, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0) {
+        LOGW("JIT: can't create warm profile '%s': %s",
+            tmpName, strerror(errno));
+        return false;
+    }
+
+    u4 header[2] = { kWarmProfileMagic, 0 };
+    bool ok = (write(fd, header, sizeof(header)) == (ssize_t) sizeof(header));
+
+    for (int i = 0; ok && i < kNumWarmEntries; i++) {
+        const JitWarmEntry* pEntry = &profile->entries[i];
+        if (pEntry->checksum == 0 || pEntry->stale)
+            continue;
+
+        u4 words[4] = { pEntry->checksum, pEntry->classHash,
+                        pEntry->methodHash, pEntry->offset };
+        ok = (write(fd, words, sizeof(words)) == (ssize_t) sizeof(words));
+        header[1]++;
+    }
+
+    if (ok) {
+        ok = (lseek(fd, 0, SEEK_SET) == 0 &&
+              write(fd, header, sizeof(header)) == (ssize_t) sizeof(header));
+    }
+    if (close(fd) != 0)
+        ok = false;
+
+    if (!ok || rename(tmpName, profile->fileName) != 0) {
+        LOGW("JIT: failed writing warm profile '%s'", profile->fileName);
+        unlink(tmpName);
+        return false;
+    }
+
+    LOGV("JIT: saved %d warm trace heads to '%s'",
+        header[1], profile->fileName);
+    return true;
+}
+
+/*
+ * Make the profile counters of a class's remembered trace heads fire on
+ * their next execution.
+ */
+static void seedClass(JitWarmProfile* profile, const ClassObject* clazz)
+{
+    unsigned char* pProfTable = gDvmJit.pProfTable;
+    if (pProfTable == NULL)
+        return;
+
+    u4 classHash = dvmComputeUtf8Hash(clazz->descriptor);
+    if (!testClassFilter(profile, classHash))
+        return;
+
+    u4 checksum = getDexChecksum(clazz);
+    if (checksum == 0)
+        return;
+
+    dvmLockMutex(&profile->lock);
+
+    int numMethods = clazz->directMethodCount + clazz->virtualMethodCount;
+    for (int i = 0; i < numMethods; i++) {
+        const Method* method = (i < clazz->directMethodCount) ?
+            &clazz->directMethods[i] :
+            &clazz->virtualMethods[i - clazz->directMethodCount];
+        if (method->insns == NULL)
+            continue;
+
+        u4 methodHash = hashMethod(method, classHash);
+        u4 insnsSize = dvmGetMethodInsnsSize(method);
+        int idx = methodHash & (kNumWarmEntries - 1);
+
+        for (; profile->entries[idx].checksum != 0;
+            idx = (idx + 1) & (kNumWarmEntries - 1))
+        {
+            JitWarmEntry* pEntry = &profile->entries[idx];
+            if (pEntry->methodHash != methodHash)
+                continue;
+            if (pEntry->checksum != checksum) {
+                pEntry->stale = true;
+                continue;
+            }
+            if (pEntry->offset >= insnsSize)
+                continue;
+
+            /* same hash as common_updateProfile in the interpreter */
+            u4 pc = (u4) (method->insns + pEntry->offset);
+            pProfTable[(pc ^ (pc >> 12)) & (JIT_PROF_SIZE - 1)] = 1;
+        }
+    }
+
+    dvmUnlockMutex(&profile->lock);
+}
+
+static int seedLoadedClass(void* vclazz, void* arg)
+{
+    const ClassObject* clazz = (const ClassObject*) vclazz;
+
+    if (clazz->status >= CLASS_INITIALIZING)
+        seedClass((JitWarmProfile*) arg, clazz);
+    return 0;
+}
+
+/*
+ * Seed the counters for classes that were initialized before the profile
+ * table existed.
+ */
+void dvmJitWarmProfileSeedLoadedClasses()
+{
+    JitWarmProfile* profile = gDvmJit.warmProfile;
+    if (profile == NULL || profile->numEntries == 0)
+        return;
+
+    dvmHashTableLock(gDvm.loadedClasses);
+    dvmHashForeach(gDvm.loadedClasses, seedLoadedClass, profile);
+    dvmHashTableUnlock(gDvm.loadedClasses);
+}
+
+/*
+ * Open the warm profile for an application DEX file.  Only the first one
+ * opened in the process gets a profile; it collects the traces of every
+ * DEX the process uses.
+ */
+void dvmJitWarmProfileOpen(const char* sourceName)
+{
+    if (gDvmJit.warmProfileDir == NULL || gDvmJit.warmProfile != NULL ||
+        gDvm.executionMode != kExecutionModeJit || gDvmJit.disableJit)
+    {
+        return;
+    }
+
+    /* mangle the path the same way the dalvik-cache does */
+    char fileName[PATH_MAX];
+    while (*sourceName == '/')
+        sourceName++;
+    int len = snprintf(fileName, sizeof(fileName), "%s/%s.jitprof",
+        gDvmJit.warmProfileDir, sourceName);
+    if (len >= (int) sizeof(fileName))
+        return;
+    for (char* cp = fileName + strlen(gDvmJit.warmProfileDir) + 1;
+        *cp != '\0'; cp++)
+    {
+        if (*cp == '/')
+            *cp = '@';
+    }
+
+    JitWarmProfile* profile =
+        (JitWarmProfile*) calloc(1, sizeof(JitWarmProfile));
+    if (profile == NULL)
+        return;
+    dvmInitMutex(&profile->lock);
+    profile->fileName = strdup(fileName);
+    profile->lastSaveUsec = dvmGetRelativeTimeUsec();
+
+    loadProfile(profile);
+
+    ANDROID_MEMBAR_STORE();
+    gDvmJit.warmProfile = profile;
+
+    if (profile->numEntries != 0) {
+        /*
+         * We know what's going to be hot, so there's no reason to wait for
+         * the app to get through its startup before compiling.
+         */
+        dvmLockMutex(&gDvmJit.compilerLock);
+        gDvmJit.alreadyEnabledViaFramework = true;
+        pthread_cond_signal(&gDvmJit.compilerQueueActivity);
+        dvmUnlockMutex(&gDvmJit.compilerLock);
+
+        dvmJitWarmProfileSeedLoadedClasses();
+    }
+}
+
+/*
+ * Called when a class starts initialization, before any of its code runs.
+ */
+void dvmJitWarmProfileInitClass(const ClassObject* clazz)
+{
+    JitWarmProfile* profile = gDvmJit.warmProfile;
+
+    if (profile != NULL && profile->numEntries != 0)
+        seedClass(profile, clazz);
+}
+
+/*
+ * Returns "true" if "pc" in "method" was a compiled trace head in an
+ * earlier run.
+ */
+bool dvmJitIsWarmTraceHead(const Method* method, const u2* pc)
+{
+    JitWarmProfile* profile = gDvmJit.warmProfile;
+    if (profile == NULL || profile->numEntries == 0)
+        return false;
+
+    u4 classHash = dvmComputeUtf8Hash(method->clazz->descriptor);
+    if (!testClassFilter(profile, classHash))
+        return false;
+
+    u4 checksum = getDexChecksum(method->clazz);
+    if (checksum == 0)
+        return false;
+
+    dvmLockMutex(&profile->lock);
+    const JitWarmEntry* pEntry = findEntry(profile, checksum,
+        hashMethod(method, classHash), pc - method->insns);
+    bool result = (pEntry->checksum != 0);
+    dvmUnlockMutex(&profile->lock);
+
+    return result;
+}
+
+/*
+ * Remember a trace head that was just handed to the compiler.
+ */
+void dvmJitWarmProfileRecord(const Method* method, const u2* pc)
+{
+    JitWarmProfile* profile = gDvmJit.warmProfile;
+    if (profile == NULL)
+        return;
+
+    u4 checksum = getDexChecksum(method->clazz);
+    if (checksum == 0)
+        return;
+
+    u4 classHash = dvmComputeUtf8Hash(method->clazz->descriptor);
+    u4 methodHash = hashMethod(method, classHash);
+
+    dvmLockMutex(&profile->lock);
+    JitWarmEntry* pEntry = addEntry(profile, checksum, classHash, methodHash,
+        pc - method->insns);
+    if (pEntry != NULL && !pEntry->recorded) {
+        pEntry->recorded = true;
+        profile->numUnsaved++;
+    }
+    dvmUnlockMutex(&profile->lock);
+}
+
+/*
+ * Write the profile out if enough has changed since the last time, or
+ * unconditionally if "force" is set.  Called from the compiler thread.
+ */
+void dvmJitWarmProfileSave(bool force)
+{
+    JitWarmProfile* profile = gDvmJit.warmProfile;
+    if (profile == NULL)
+        return;
+
+    dvmLockMutex(&profile->lock);
+    u8 now = dvmGetRelativeTimeUsec();
+    if (profile->numUnsaved != 0 &&
+        (force || (profile->numUnsaved >= kWarmSaveMinNewEntries &&
+                   now - profile->lastSaveUsec >= kWarmSaveIntervalUsec)))
+    {
+        if (saveProfile(profile))
+            profile->numUnsaved = 0;
+        profile->lastSaveUsec = now;
+    }
+    dvmUnlockMutex(&profile->lock);
+}
+
+#endif /* WITH_JIT */
@@ -176,6 +176,23 @@ static void dumpEvent(const JdwpEvent* pEvent)
     }
 }
 
+/*
+ * Returns "true" if events of this kind can only be detected by looking
+ * at every instruction the interpreter executes.
+ */
+static bool isInstructionEvent(JdwpEventKind eventKind)
+{
+    switch (eventKind) {
+    case EK_SINGLE_STEP:
+    case EK_BREAKPOINT:
+    case EK_METHOD_ENTRY:
+    case EK_METHOD_EXIT:
+        return true;
+    default:
+        return false;
+    }
+}
+
 /*
  * Add an event to the list.  Ordering is not important.
  *
@@ -222,6 +239,9 @@ JdwpError dvmJdwpRegisterEvent(JdwpState* state, JdwpEvent* pEvent)
     state->eventList = pEvent;
     state->numEvents++;
 
+    if (isInstructionEvent(pEvent->eventKind) && state->numInstrEvents++ == 0)
+        dvmDbgSetInstructionEvents(true);
+
     unlockEventMutex(state);
 
     return ERR_NONE;
@@ -269,6 +289,9 @@ static void unregisterEvent(JdwpState* state, JdwpEvent* pEvent)
 
     state->numEvents--;
     assert(state->numEvents != 0 || state->eventList == NULL);
+
+    if (isInstructionEvent(pEvent->eventKind) && --state->numInstrEvents == 0)
+        dvmDbgSetInstructionEvents(false);
 }
 
 /*
@@ -101,6 +101,7 @@ struct JdwpState {
      * Events requested by the debugger (breakpoints, class prep, etc).
      */
     int             numEvents;      /* #of elements in eventList */
+    int             numInstrEvents; /* #of events checked per-instruction */
     JdwpEvent*      eventList;      /* linked list of events */
     pthread_mutex_t eventLock;      /* guards numEvents/eventList */
 
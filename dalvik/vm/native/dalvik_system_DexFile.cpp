@@ -19,6 +19,9 @@
  */
 #include "Dalvik.h"
 #include "native/InternalNativePriv.h"
+#if defined(WITH_JIT)
+#include "interp/Jit.h"
+#endif
 
 /*
  * Return true if the given name ends with ".dex".
@@ -228,6 +231,9 @@ static void Dalvik_dalvik_system_DexFile_openDexFile(const u4* args,
     if (pDexOrJar != NULL) {
         pDexOrJar->fileName = sourceName;
         addToDexFileTable(pDexOrJar);
+#if defined(WITH_JIT)
+        dvmJitWarmProfileOpen(sourceName);
+#endif
     } else {
         free(sourceName);
     }
@@ -55,6 +55,7 @@ static void Dalvik_dalvik_system_VMDebug_getVmFeatureList(const u4* args, JValue
     std::vector<std::string> features;
     features.push_back("method-trace-profiling");
     features.push_back("method-trace-profiling-streaming");
+    features.push_back("method-sample-profiling");
     features.push_back("hprof-heap-dump");
     features.push_back("hprof-heap-dump-streaming");
 
@@ -223,17 +224,9 @@ static void Dalvik_dalvik_system_VMDebug_resetAllocCount(const u4* args,
 }
 
 /*
- * static void startMethodTracingNative(String traceFileName,
- *     FileDescriptor fd, int bufferSize, int flags)
- *
- * Start method trace profiling.
- *
- * If both "traceFileName" and "fd" are null, the result will be sent
- * directly to DDMS.  (The non-DDMS versions of the calls are expected
- * to enforce non-NULL filenames.)
+ * Common code for the instrumented and sampled method trace entry points.
  */
-static void Dalvik_dalvik_system_VMDebug_startMethodTracingNative(const u4* args,
-    JValue* pResult)
+static void startMethodTracing(const u4* args, int samplingIntervalUs)
 {
     StringObject* traceFileStr = (StringObject*) args[0];
     Object* traceFd = (Object*) args[1];
@@ -245,9 +238,9 @@ static void Dalvik_dalvik_system_VMDebug_startMethodTracingNative(const u4* args
         bufferSize = 8 * 1024 * 1024;
     }
 
-    if (bufferSize < 1024) {
+    if (bufferSize < 1024 || samplingIntervalUs < 0) {
         dvmThrowIllegalArgumentException(NULL);
-        RETURN_VOID();
+        return;
     }
 
     char* traceFileName = NULL;
@@ -257,20 +250,57 @@ static void Dalvik_dalvik_system_VMDebug_startMethodTracingNative(const u4* args
     int fd = -1;
     if (traceFd != NULL) {
         int origFd = getFileDescriptor(traceFd);
-        if (origFd < 0)
-            RETURN_VOID();
+        if (origFd < 0) {
+            free(traceFileName);
+            return;
+        }
 
         fd = dup(origFd);
         if (fd < 0) {
             dvmThrowExceptionFmt(gDvm.exRuntimeException,
                 "dup(%d) failed: %s", origFd, strerror(errno));
-            RETURN_VOID();
+            free(traceFileName);
+            return;
         }
     }
 
     dvmMethodTraceStart(traceFileName != NULL ? traceFileName : "[DDMS]",
-        fd, bufferSize, flags, (traceFileName == NULL && fd == -1));
+        fd, bufferSize, flags, (traceFileName == NULL && fd == -1),
+        samplingIntervalUs);
     free(traceFileName);
+}
+
+/*
+ * static void startMethodTracingNative(String traceFileName,
+ *     FileDescriptor fd, int bufferSize, int flags)
+ *
+ * Start method trace profiling.
+ *
+ * If both "traceFileName" and "fd" are null, the result will be sent
+ * directly to DDMS.  (The non-DDMS versions of the calls are expected
+ * to enforce non-NULL filenames.)
+ */
+static void Dalvik_dalvik_system_VMDebug_startMethodTracingNative(const u4* args,
+    JValue* pResult)
+{
+    startMethodTracing(args, 0);
+    RETURN_VOID();
+}
+
+/*
+ * static void startMethodTracingSamplingNative(String traceFileName,
+ *     FileDescriptor fd, int bufferSize, int flags, int intervalUs)
+ *
+ * Like startMethodTracingNative, but samples the stacks of all threads
+ * every "intervalUs" microseconds (zero picks the default) instead of
+ * instrumenting every method call.
+ */
+static void Dalvik_dalvik_system_VMDebug_startMethodTracingSamplingNative(
+    const u4* args, JValue* pResult)
+{
+    int intervalUs = args[4];
+
+    startMethodTracing(args, intervalUs == 0 ? kDefaultSamplingIntervalUs : intervalUs);
     RETURN_VOID();
 }
 
@@ -422,6 +452,41 @@ static void Dalvik_dalvik_system_VMDebug_getInstructionCount(const u4* args,
     RETURN_VOID();
 }
 
+/*
+ * static void getLinearAllocStats(long[] data)
+ *
+ * Fill in the bootstrap LinearAlloc usage: bytes used, bytes reserved,
+ * bytes freed, allocation count, free count.  Extra array elements are
+ * left alone.
+ */
+static void Dalvik_dalvik_system_VMDebug_getLinearAllocStats(const u4* args,
+    JValue* pResult)
+{
+    ArrayObject* dataArray = (ArrayObject*) args[0];
+
+    if (dataArray == NULL) {
+        dvmThrowNullPointerException("data == null");
+        RETURN_VOID();
+    }
+
+    LinearAllocStats stats;
+    dvmLinearAllocGetStats(NULL, &stats);
+
+    s8 values[5];
+    values[0] = stats.used;
+    values[1] = stats.capacity;
+    values[2] = stats.freed;
+    values[3] = stats.allocCount;
+    values[4] = stats.freeCount;
+
+    u4 length = dataArray->length;
+    if (length > NELEM(values))
+        length = NELEM(values);
+    memcpy(dataArray->contents, values, length * sizeof(s8));
+
+    RETURN_VOID();
+}
+
 /*
  * static boolean resetInstructionCount()
  *
@@ -488,13 +553,10 @@ static void Dalvik_dalvik_system_VMDebug_threadCpuTimeNanos(const u4* args,
 }
 
 /*
- * static void dumpHprofData(String fileName, FileDescriptor fd)
- *
- * Cause "hprof" data to be dumped.  We can throw an IOException if an
- * error occurs during file handling.
+ * Common code for the dumpHprofData variants.  A file name ending in ".gz"
+ * turns on compression.
  */
-static void Dalvik_dalvik_system_VMDebug_dumpHprofData(const u4* args,
-    JValue* pResult)
+static void dumpHprofData(const u4* args, int flags)
 {
     StringObject* fileNameStr = (StringObject*) args[0];
     Object* fileDescriptor = (Object*) args[1];
@@ -506,7 +568,7 @@ static void Dalvik_dalvik_system_VMDebug_dumpHprofData(const u4* args,
      */
     if (fileNameStr == NULL && fileDescriptor == NULL) {
         dvmThrowNullPointerException("fileName == null && fd == null");
-        RETURN_VOID();
+        return;
     }
 
     if (fileNameStr != NULL) {
@@ -514,7 +576,11 @@ static void Dalvik_dalvik_system_VMDebug_dumpHprofData(const u4* args,
         if (fileName == NULL) {
             /* unexpected -- malloc failure? */
             dvmThrowRuntimeException("malloc failure?");
-            RETURN_VOID();
+            return;
+        }
+        size_t len = strlen(fileName);
+        if (len > 3 && strcmp(fileName + len - 3, ".gz") == 0) {
+            flags |= HPROF_FLAG_COMPRESS;
         }
     } else {
         fileName = strdup("[fd]");
@@ -525,20 +591,43 @@ static void Dalvik_dalvik_system_VMDebug_dumpHprofData(const u4* args,
         fd = getFileDescriptor(fileDescriptor);
         if (fd < 0) {
             free(fileName);
-            RETURN_VOID();
+            return;
         }
     }
 
-    result = hprofDumpHeap(fileName, fd, false);
+    result = hprofDumpHeap(fileName, fd, false, flags);
     free(fileName);
 
     if (result != 0) {
         /* ideally we'd throw something more specific based on actual failure */
         dvmThrowRuntimeException(
             "Failure during heap dump; check log output for details");
-        RETURN_VOID();
     }
+}
 
+/*
+ * static void dumpHprofData(String fileName, FileDescriptor fd)
+ *
+ * Cause "hprof" data to be dumped.  We can throw an IOException if an
+ * error occurs during file handling.
+ */
+static void Dalvik_dalvik_system_VMDebug_dumpHprofData(const u4* args,
+    JValue* pResult)
+{
+    dumpHprofData(args, 0);
+    RETURN_VOID();
+}
+
+/*
+ * static void dumpHprofData(String fileName, FileDescriptor fd, int flags)
+ *
+ * Like dumpHprofData(String, FileDescriptor), with HPROF_FLAG_* options
+ * (compression, leaving out primitive array contents).
+ */
+static void Dalvik_dalvik_system_VMDebug_dumpHprofDataFlags(const u4* args,
+    JValue* pResult)
+{
+    dumpHprofData(args, args[2]);
     RETURN_VOID();
 }
 
@@ -552,7 +641,7 @@ static void Dalvik_dalvik_system_VMDebug_dumpHprofDataDdms(const u4* args,
 {
     int result;
 
-    result = hprofDumpHeap("[DDMS]", -1, true);
+    result = hprofDumpHeap("[DDMS]", -1, true, 0);
 
     if (result != 0) {
         /* ideally we'd throw something more specific based on actual failure */
@@ -758,6 +847,9 @@ const DalvikNativeMethod dvm_dalvik_system_VMDebug[] = {
         Dalvik_dalvik_system_VMDebug_stopAllocCounting },
     { "startMethodTracingNative",   "(Ljava/lang/String;Ljava/io/FileDescriptor;II)V",
         Dalvik_dalvik_system_VMDebug_startMethodTracingNative },
+    { "startMethodTracingSamplingNative",
+                                    "(Ljava/lang/String;Ljava/io/FileDescriptor;III)V",
+        Dalvik_dalvik_system_VMDebug_startMethodTracingSamplingNative },
     { "isMethodTracingActive",      "()Z",
         Dalvik_dalvik_system_VMDebug_isMethodTracingActive },
     { "stopMethodTracing",          "()V",
@@ -774,6 +866,8 @@ const DalvikNativeMethod dvm_dalvik_system_VMDebug[] = {
         Dalvik_dalvik_system_VMDebug_resetInstructionCount },
     { "getInstructionCount",        "([I)V",
         Dalvik_dalvik_system_VMDebug_getInstructionCount },
+    { "getLinearAllocStats",        "([J)V",
+        Dalvik_dalvik_system_VMDebug_getLinearAllocStats },
     { "isDebuggerConnected",        "()Z",
         Dalvik_dalvik_system_VMDebug_isDebuggerConnected },
     { "isDebuggingEnabled",         "()Z",
@@ -788,6 +882,8 @@ const DalvikNativeMethod dvm_dalvik_system_VMDebug[] = {
         Dalvik_dalvik_system_VMDebug_threadCpuTimeNanos },
     { "dumpHprofData",              "(Ljava/lang/String;Ljava/io/FileDescriptor;)V",
         Dalvik_dalvik_system_VMDebug_dumpHprofData },
+    { "dumpHprofData",              "(Ljava/lang/String;Ljava/io/FileDescriptor;I)V",
+        Dalvik_dalvik_system_VMDebug_dumpHprofDataFlags },
     { "dumpHprofDataDdms",          "()V",
         Dalvik_dalvik_system_VMDebug_dumpHprofDataDdms },
     { "cacheRegisterMap",           "(Ljava/lang/String;)Z",
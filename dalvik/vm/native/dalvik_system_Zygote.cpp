@@ -240,6 +240,11 @@ static void Dalvik_dalvik_system_Zygote_fork(const u4* args, JValue* pResult)
         dvmAbort();
     }
 
+#ifdef WITH_JIT
+    /* Stop the compiler thread and share what it compiled */
+    dvmCompilerPreZygoteFork();
+#endif
+
     setSignalHandler();
 
     dvmDumpLoaderStats("zygote");
@@ -395,6 +400,11 @@ static pid_t forkAndSpecializeCommon(const u4* args, bool isSystemServer)
         dvmAbort();
     }
 
+#ifdef WITH_JIT
+    /* Stop the compiler thread and share what it compiled */
+    dvmCompilerPreZygoteFork();
+#endif
+
     setSignalHandler();
 
     dvmDumpLoaderStats("zygote");
@@ -148,6 +148,41 @@ static void
     RETURN_PTR(data);
 }
 
+/*
+ * public static void enableAllocationSampling(int interval)
+ *
+ * Sample about one allocation per "interval" bytes; zero disables sampling.
+ */
+static void
+    Dalvik_org_apache_harmony_dalvik_ddmc_DdmVmInternal_enableAllocationSampling(
+    const u4* args, JValue* pResult)
+{
+    int interval = (int) args[0];
+
+    if (interval > 0)
+        (void) dvmEnableAllocSampling(interval);
+    else
+        dvmDisableAllocSampling();
+    RETURN_VOID();
+}
+
+/*
+ * public static byte[] getAllocationSites()
+ *
+ * Fill a buffer with the sampled allocation sites.
+ */
+static void
+    Dalvik_org_apache_harmony_dalvik_ddmc_DdmVmInternal_getAllocationSites(
+    const u4* args, JValue* pResult)
+{
+    ArrayObject* data;
+
+    UNUSED_PARAMETER(args);
+    data = dvmDdmGetAllocationSites();
+    dvmReleaseTrackedAlloc((Object*) data, NULL);
+    RETURN_PTR(data);
+}
+
 const DalvikNativeMethod dvm_org_apache_harmony_dalvik_ddmc_DdmVmInternal[] = {
     { "threadNotify",       "(Z)V",
       Dalvik_org_apache_harmony_dalvik_ddmc_DdmVmInternal_threadNotify },
@@ -165,5 +200,9 @@ const DalvikNativeMethod dvm_org_apache_harmony_dalvik_ddmc_DdmVmInternal[] = {
       Dalvik_org_apache_harmony_dalvik_ddmc_DdmVmInternal_getRecentAllocationStatus },
     { "getRecentAllocations", "()[B",
       Dalvik_org_apache_harmony_dalvik_ddmc_DdmVmInternal_getRecentAllocations },
+    { "enableAllocationSampling", "(I)V",
+      Dalvik_org_apache_harmony_dalvik_ddmc_DdmVmInternal_enableAllocationSampling },
+    { "getAllocationSites", "()[B",
+      Dalvik_org_apache_harmony_dalvik_ddmc_DdmVmInternal_getAllocationSites },
     { NULL, NULL, NULL },
 };
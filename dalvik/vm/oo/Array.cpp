@@ -59,7 +59,7 @@ static ArrayObject* allocArray(ClassObject* arrayClass, size_t length,
     if (newArray != NULL) {
         DVM_OBJECT_INIT(newArray, arrayClass);
         newArray->length = length;
-        dvmTrackAllocation(arrayClass, totalSize);
+        dvmTrackAllocation(newArray, arrayClass, totalSize);
     }
     return newArray;
 }
@@ -21,9 +21,18 @@
 
 #define LOG_CLASS_LOADING 0
 
+/* set to 1 to count class table lookups, cache hits and lock contention */
+#define CLASS_LOOKUP_STATS 0
+
+/* number of entries in gDvm.classLookupCache; must be power of 2 */
+#define kClassLookupCacheSize   4096
+
 #include "Dalvik.h"
 #include "libdex/DexClass.h"
 #include "analysis/Optimize.h"
+#if defined(WITH_JIT)
+#include "interp/Jit.h"
+#endif
 
 #include <stdlib.h>
 #include <stddef.h>
@@ -417,6 +426,10 @@ bool dvmClassStartup()
     gDvm.loadedClasses =
         dvmHashTableCreate(256, (HashFreeFunc) dvmFreeClassInnards);
 
+    /* not fatal if this fails, we just always go to the hash table */
+    gDvm.classLookupCache = (ClassObject**)
+        calloc(kClassLookupCacheSize, sizeof(ClassObject*));
+
     gDvm.pBootLoaderAlloc = dvmLinearAllocCreate(NULL);
     if (gDvm.pBootLoaderAlloc == NULL)
         return false;
@@ -468,6 +481,8 @@ bool dvmClassStartup()
 void dvmClassShutdown()
 {
     /* discard all system-loaded classes */
+    free(gDvm.classLookupCache);
+    gDvm.classLookupCache = NULL;
     dvmHashTableFree(gDvm.loadedClasses);
     gDvm.loadedClasses = NULL;
 
@@ -937,6 +952,33 @@ struct ClassMatchCriteria {
     Object*     loader;
 };
 
+#if CLASS_LOOKUP_STATS
+/* updated without synchronization, so treat them as approximate */
+static struct {
+    int     lookups;
+    int     cacheHits;
+    int     locks;
+    int     contended;
+} gClassLookupStats;
+# define CLASS_LOOKUP_STAT(_field)  (gClassLookupStats._field++)
+#else
+# define CLASS_LOOKUP_STAT(_field)  ((void) 0)
+#endif
+
+/*
+ * Lock the class table, noting whether we had to wait for it.
+ */
+static inline void lockClassTable()
+{
+#if CLASS_LOOKUP_STATS
+    CLASS_LOOKUP_STAT(locks);
+    if (dvmTryLockMutex(&gDvm.loadedClasses->lock) == 0)
+        return;
+    CLASS_LOOKUP_STAT(contended);
+#endif
+    dvmHashTableLock(gDvm.loadedClasses);
+}
+
 #define kInitLoaderInc  4       /* must be power of 2 */
 
 static InitiatingLoaderList *dvmGetInitiatingLoaderList(ClassObject* clazz)
@@ -1132,11 +1174,41 @@ ClassObject* dvmLookupClass(const char* descriptor, Object* loader,
     LOGVV("threadid=%d: dvmLookupClass searching for '%s' %p",
         dvmThreadSelf()->threadId, descriptor, loader);
 
-    dvmHashTableLock(gDvm.loadedClasses);
+    CLASS_LOOKUP_STAT(lookups);
+
+    /*
+     * Try the lookup cache first.  Classes are never unloaded and only
+     * linked classes are put in the cache, so anything we find here is
+     * safe to use once we've checked that it's the one we want.
+     */
+    ClassObject** cache = gDvm.classLookupCache;
+    if (cache != NULL) {
+        ClassObject* cached = (ClassObject*) android_atomic_acquire_load(
+                (int32_t*) &cache[hash & (kClassLookupCacheSize-1)]);
+        if (cached != NULL && cached->classLoader == loader &&
+            strcmp(cached->descriptor, descriptor) == 0)
+        {
+            CLASS_LOOKUP_STAT(cacheHits);
+            found = cached;
+            goto got_class;
+        }
+    }
+
+    lockClassTable();
     found = dvmHashTableLookup(gDvm.loadedClasses, hash, &crit,
                 hashcmpClassByCrit, false);
     dvmHashTableUnlock(gDvm.loadedClasses);
 
+    if (cache != NULL && found != NULL &&
+        ((ClassObject*) found)->classLoader == loader &&
+        dvmIsClassLinked((ClassObject*) found))
+    {
+        android_atomic_release_store((int32_t) found,
+            (int32_t*) &cache[hash & (kClassLookupCacheSize-1)]);
+    }
+
+got_class:
+
     /*
      * The class has been added to the hash table but isn't ready for use.
      * We're going to act like we didn't see it, so that the caller will
@@ -1173,7 +1245,7 @@ bool dvmAddClassToHash(ClassObject* clazz)
 
     hash = dvmComputeUtf8Hash(clazz->descriptor);
 
-    dvmHashTableLock(gDvm.loadedClasses);
+    lockClassTable();
     found = dvmHashTableLookup(gDvm.loadedClasses, hash, clazz,
                 hashcmpClassByClass, true);
     dvmHashTableUnlock(gDvm.loadedClasses);
@@ -1188,17 +1260,17 @@ bool dvmAddClassToHash(ClassObject* clazz)
     return (found == (void*) clazz);
 }
 
-#if 0
 /*
  * Compute hash value for a class.
  */
-u4 hashcalcClass(const void* item)
+static u4 hashcalcClass(const void* item)
 {
     return dvmComputeUtf8Hash(((const ClassObject*) item)->descriptor);
 }
 
 /*
- * Check the performance of the "loadedClasses" hash table.
+ * Check the performance of the "loadedClasses" hash table and its lookup
+ * cache.  The counters are only maintained when CLASS_LOOKUP_STATS is set.
  */
 void dvmCheckClassTablePerf()
 {
@@ -1206,8 +1278,13 @@ void dvmCheckClassTablePerf()
     dvmHashTableProbeCount(gDvm.loadedClasses, hashcalcClass,
         hashcmpClassByClass);
     dvmHashTableUnlock(gDvm.loadedClasses);
-}
+
+#if CLASS_LOOKUP_STATS
+    LOGI("Class lookup: %d lookups, %d cache hits, %d/%d table locks contended",
+        gClassLookupStats.lookups, gClassLookupStats.cacheHits,
+        gClassLookupStats.contended, gClassLookupStats.locks);
 #endif
+}
 
 /*
  * Remove a class object from the hash table.
@@ -1218,7 +1295,7 @@ static void removeClassFromHash(ClassObject* clazz)
 
     u4 hash = dvmComputeUtf8Hash(clazz->descriptor);
 
-    dvmHashTableLock(gDvm.loadedClasses);
+    lockClassTable();
     if (!dvmHashTableRemove(gDvm.loadedClasses, hash, clazz))
         LOGW("Hash table remove failed on class '%s'", clazz->descriptor);
     dvmHashTableUnlock(gDvm.loadedClasses);
@@ -2854,6 +2931,88 @@ bail:
     return okay;
 }
 
+/*
+ * Temporary name-hashed index over a vtable, used while linking to find
+ * overridden or implemented methods without comparing against every slot.
+ * Classes near the bottom of large hierarchies (View, Activity, ...) have
+ * vtables with hundreds of entries, and the preloaded framework classes go
+ * through this once each at zygote startup.
+ *
+ * Each bucket chains vtable slots in ascending order.  The index only
+ * depends on method names, so it stays valid when a slot is replaced by an
+ * override.
+ */
+struct VtableIndex {
+    u4      mask;
+    int*    heads;          /* bucket -> first slot, or -1 */
+    int*    next;           /* slot -> next slot in bucket, or -1 */
+};
+
+/*
+ * Don't bother building an index unless the table is at least this big
+ * and we're going to search it at least this many times.
+ */
+#define kVtableIndexMinSlots    32
+#define kVtableIndexMinLookups  4
+
+/*
+ * Build an index over the first "count" entries of "vtable".
+ *
+ * Returns false if the index wasn't worth building or couldn't be
+ * allocated; callers fall back to a linear search.
+ */
+static bool vtableIndexInit(VtableIndex* pIndex, Method* const* vtable,
+    int count, int lookups)
+{
+    if (count < kVtableIndexMinSlots || lookups < kVtableIndexMinLookups)
+        return false;
+
+    u4 numBuckets = dexRoundUpPower2(count);
+    pIndex->heads = (int*) malloc(sizeof(int) * (numBuckets + count));
+    if (pIndex->heads == NULL)
+        return false;
+    pIndex->next = pIndex->heads + numBuckets;
+    pIndex->mask = numBuckets - 1;
+
+    memset(pIndex->heads, 0xff, sizeof(int) * numBuckets);
+    for (int slot = count - 1; slot >= 0; slot--) {
+        u4 bucket = dvmComputeUtf8Hash(vtable[slot]->name) & pIndex->mask;
+        pIndex->next[slot] = pIndex->heads[bucket];
+        pIndex->heads[bucket] = slot;
+    }
+    return true;
+}
+
+static void vtableIndexFree(VtableIndex* pIndex)
+{
+    free(pIndex->heads);
+}
+
+/*
+ * Find the slot in "vtable" whose name and prototype match "meth".  If
+ * more than one does, "lowest" selects the first one rather than the
+ * last one.
+ *
+ * Returns the slot index, or -1 if there's no match.
+ */
+static int vtableIndexFind(const VtableIndex* pIndex, Method* const* vtable,
+    const Method* meth, bool lowest)
+{
+    u4 bucket = dvmComputeUtf8Hash(meth->name) & pIndex->mask;
+    int found = -1;
+
+    for (int slot = pIndex->heads[bucket]; slot >= 0;
+        slot = pIndex->next[slot])
+    {
+        if (dvmCompareMethodNamesAndProtos(meth, vtable[slot]) == 0) {
+            found = slot;
+            if (lowest)
+                break;
+        }
+    }
+    return found;
+}
+
 /*
  * Create the virtual method table.
  *
@@ -2906,11 +3065,24 @@ static bool createVtable(ClassObject* clazz)
         /*
          * See if any of our virtual methods override the superclass.
          */
+        VtableIndex index;
+        bool indexed = vtableIndexInit(&index, clazz->vtable,
+                            clazz->super->vtableCount,
+                            clazz->virtualMethodCount);
+
         for (i = 0; i < clazz->virtualMethodCount; i++) {
             Method* localMeth = &clazz->virtualMethods[i];
             int si;
 
-            for (si = 0; si < clazz->super->vtableCount; si++) {
+            if (indexed) {
+                si = vtableIndexFind(&index, clazz->vtable, localMeth, true);
+                if (si < 0)
+                    si = clazz->super->vtableCount;
+            } else {
+                si = 0;
+            }
+
+            for ( ; si < clazz->super->vtableCount; si++) {
                 Method* superMeth = clazz->vtable[si];
 
                 if (dvmCompareMethodNamesAndProtos(localMeth, superMeth) == 0)
@@ -2920,6 +3092,8 @@ static bool createVtable(ClassObject* clazz)
                         LOGW("Method %s.%s overrides final %s.%s",
                             localMeth->clazz->descriptor, localMeth->name,
                             superMeth->clazz->descriptor, superMeth->name);
+                        if (indexed)
+                            vtableIndexFree(&index);
                         goto bail;
                     }
                     clazz->vtable[si] = localMeth;
@@ -2941,6 +3115,9 @@ static bool createVtable(ClassObject* clazz)
             }
         }
 
+        if (indexed)
+            vtableIndexFree(&index);
+
         if (actualCount != (u2) actualCount) {
             LOGE("Too many methods (%d) in class '%s'", actualCount,
                  clazz->descriptor);
@@ -3014,6 +3191,8 @@ static bool createIftable(ClassObject* clazz)
     int poolOffset = 0, poolSize = 0;
     Method** mirandaList = NULL;
     int mirandaCount = 0, mirandaAlloc = 0;
+    VtableIndex vtableIndex;
+    bool vtableIndexed = false;
 
     int superIfCount;
     if (clazz->super != NULL)
@@ -3170,6 +3349,9 @@ static bool createIftable(ClassObject* clazz)
                         poolSize * sizeof(int*));
     zapIfvipool = true;
 
+    vtableIndexed = vtableIndexInit(&vtableIndex, clazz->vtable,
+                        clazz->vtableCount, poolSize);
+
     /*
      * Fill in the vtable offsets for the interfaces that weren't part of
      * our superclass.
@@ -3222,7 +3404,13 @@ static bool createIftable(ClassObject* clazz)
                 free(desc);
             }
 
-            for (j = clazz->vtableCount-1; j >= 0; j--) {
+            if (vtableIndexed) {
+                j = vtableIndexFind(&vtableIndex, clazz->vtable, imeth, false);
+            } else {
+                j = clazz->vtableCount-1;
+            }
+
+            for ( ; j >= 0; j--) {
                 if (dvmCompareMethodNamesAndProtos(imeth, clazz->vtable[j])
                     == 0)
                 {
@@ -3304,6 +3492,11 @@ static bool createIftable(ClassObject* clazz)
         }
     }
 
+    if (vtableIndexed) {
+        vtableIndexFree(&vtableIndex);
+        vtableIndexed = false;
+    }
+
     if (mirandaCount != 0) {
         static const int kManyMirandas = 150;   /* arbitrary */
         Method* newVirtualMethods;
@@ -3451,6 +3644,8 @@ bail:
         dvmLinearReadOnly(clazz->classLoader, clazz->vtable);
     if (zapIfvipool)
         dvmLinearReadOnly(clazz->classLoader, clazz->ifviPool);
+    if (vtableIndexed)
+        vtableIndexFree(&vtableIndex);
     return result;
 }
 
@@ -4439,6 +4634,11 @@ noverify:
                                  (int32_t*)(void*)&clazz->status);
     dvmUnlockObject(self, (Object*) clazz);
 
+#if defined(WITH_JIT)
+    /* get the class's known-hot traces compiled on first use */
+    dvmJitWarmProfileInitClass(clazz);
+#endif
+
     /* init our superclass */
     if (clazz->super != NULL && clazz->super->status != CLASS_INITIALIZED) {
         assert(!dvmIsInterfaceClass(clazz));
@@ -4823,6 +5023,9 @@ void dvmDumpLoaderStats(const char* msg)
     LOGI("GC precise methods: %d",
         dvmPointerSetGetCount(gDvm.preciseMethods));
 #endif
+#if CLASS_LOOKUP_STATS
+    dvmCheckClassTablePerf();
+#endif
 }
 
 /*
@@ -176,6 +176,7 @@ void dvmSetBootPathExtraDex(DvmDex* pDvmDex);
 void dvmDumpClass(const ClassObject* clazz, int flags);
 void dvmDumpAllClasses(int flags);
 void dvmDumpLoaderStats(const char* msg);
+void dvmCheckClassTablePerf(void);
 int  dvmGetNumLoadedClasses();
 
 /* flags for dvmDumpClass / dvmDumpAllClasses */
@@ -60,18 +60,21 @@ include $(CLEAR_VARS)
 LOCAL_SRC_FILES:= \
 	android_audio_hw.c \
 	liba2dp.c \
-	ipc.c \
-	../sbc/sbc_primitives.c \
-	../sbc/sbc_primitives_neon.c
+	ipc.c
 
+# The ARMv6 primitives are only enabled when built in ARM (or Thumb-2) mode,
+# so the whole codec is built in ARM mode.
 ifeq ($(TARGET_ARCH),x86)
 LOCAL_SRC_FILES+= \
+	../sbc/sbc_primitives.c \
 	../sbc/sbc_primitives_mmx.c \
 	../sbc/sbc.c
 else
 LOCAL_SRC_FILES+= \
 	../sbc/sbc.c.arm \
-	../sbc/sbc_primitives_armv6.c
+	../sbc/sbc_primitives.c.arm \
+	../sbc/sbc_primitives_armv6.c.arm \
+	../sbc/sbc_primitives_neon.c.arm
 endif
 
 # to improve SBC performance
@@ -690,6 +690,8 @@ EntryImpl* BackendImpl::OpenEntryImpl(const std::string& key) {
 
   CACHE_UMA(AGE_MS, "OpenTime", GetSizeGroup(), start);
   stats_.OnEvent(Stats::OPEN_HIT);
+  stats_.AddToCounter(Stats::OPEN_TIME,
+                      (TimeTicks::Now() - start).InMicroseconds());
   SIMPLE_STATS_COUNTER("disk_cache.hit");
   return cache_entry;
 }
@@ -776,6 +778,8 @@ EntryImpl* BackendImpl::CreateEntryImpl(const std::string& key) {
 
   CACHE_UMA(AGE_MS, "CreateTime", GetSizeGroup(), start);
   stats_.OnEvent(Stats::CREATE_HIT);
+  stats_.AddToCounter(Stats::CREATE_TIME,
+                      (TimeTicks::Now() - start).InMicroseconds());
   SIMPLE_STATS_COUNTER("disk_cache.miss");
   Trace("create entry hit ");
   return cache_entry.release();
@@ -60,7 +60,9 @@ static const char* kCounterNames[] = {
   "Fatal error",
   "Last report",
   "Last report timer",
-  "Doom recent entries"
+  "Doom recent entries",
+  "Open time",
+  "Create time"
 };
 COMPILE_ASSERT(arraysize(kCounterNames) == disk_cache::Stats::MAX_COUNTER,
                update_the_names);
@@ -87,6 +89,12 @@ bool LoadStats(BackendImpl* backend, Addr address, OnDiskStats* stats) {
   // counter; we keep old data if we can.
   if (static_cast<unsigned int>(stats->size) > sizeof(*stats)) {
     memset(stats, 0, sizeof(*stats));
+  } else if (static_cast<unsigned int>(stats->size) < sizeof(*stats)) {
+    // Counters added after this block was written start from zero rather
+    // than from whatever was left in the rest of the block.
+    memset(reinterpret_cast<char*>(stats) + stats->size, 0,
+           sizeof(*stats) - stats->size);
+    stats->size = sizeof(*stats);
   }
 
   return true;
@@ -189,6 +197,11 @@ int64 Stats::GetCounter(Counters counter) const {
   return counters_[counter];
 }
 
+void Stats::AddToCounter(Counters counter, int64 value) {
+  DCHECK(counter > MIN_COUNTER || counter < MAX_COUNTER);
+  counters_[counter] += value;
+}
+
 void Stats::GetItems(StatsItems* items) {
   std::pair<std::string, std::string> item;
   for (int i = 0; i < kDataSizesLength; i++) {
@@ -202,6 +215,17 @@ void Stats::GetItems(StatsItems* items) {
     item.second = base::StringPrintf("0x%" PRIx64, counters_[i]);
     items->push_back(item);
   }
+
+  // The latency counters only make sense next to the number of operations.
+  item.first = "Average open time (us)";
+  item.second = base::StringPrintf("%" PRId64,
+      GetAverage(OPEN_TIME, OPEN_HIT));
+  items->push_back(item);
+
+  item.first = "Average create time (us)";
+  item.second = base::StringPrintf("%" PRId64,
+      GetAverage(CREATE_TIME, CREATE_HIT));
+  items->push_back(item);
 }
 
 int Stats::GetHitRatio() const {
@@ -217,6 +241,8 @@ void Stats::ResetRatios() {
   SetCounter(OPEN_MISS, 0);
   SetCounter(RESURRECT_HIT, 0);
   SetCounter(CREATE_HIT, 0);
+  SetCounter(OPEN_TIME, 0);
+  SetCounter(CREATE_TIME, 0);
 }
 
 int Stats::GetLargeEntriesSize() {
@@ -317,6 +343,14 @@ int Stats::GetStatsBucket(int32 size) {
   return result;
 }
 
+int64 Stats::GetAverage(Counters total, Counters count) const {
+  int64 events = GetCounter(count);
+  if (!events)
+    return 0;
+
+  return GetCounter(total) / events;
+}
+
 int Stats::GetRatio(Counters hit, Counters miss) const {
   int64 ratio = GetCounter(hit) * 100;
   if (!ratio)
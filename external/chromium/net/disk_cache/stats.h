@@ -46,6 +46,8 @@ class Stats {
     LAST_REPORT,  // Time of the last time we sent a report.
     LAST_REPORT_TIMER,  // Timer count of the last time we sent a report.
     DOOM_RECENT,  // The cache was partially cleared.
+    OPEN_TIME,  // Total time spent on successful opens, in microseconds.
+    CREATE_TIME,  // Total time spent on successful creates, in microseconds.
     MAX_COUNTER
   };
 
@@ -61,6 +63,7 @@ class Stats {
   void OnEvent(Counters an_event);
   void SetCounter(Counters counter, int64 value);
   int64 GetCounter(Counters counter) const;
+  void AddToCounter(Counters counter, int64 value);
 
   void GetItems(StatsItems* items);
   int GetHitRatio() const;
@@ -81,6 +84,7 @@ class Stats {
  private:
   int GetStatsBucket(int32 size);
   int GetRatio(Counters hit, Counters miss) const;
+  int64 GetAverage(Counters total, Counters count) const;
 
   BackendImpl* backend_;
   uint32 storage_addr_;
@@ -17,6 +17,9 @@
 #define PNG_INTERNAL
 #define PNG_NO_PEDANTIC_WARNINGS
 #include "png.h"
+#if defined(__ARM_NEON__)
+#  include <arm_neon.h>
+#endif
 #ifdef PNG_READ_SUPPORTED
 
 #if defined(_WIN32_WCE) && (_WIN32_WCE<0x500)
@@ -2947,12 +2950,125 @@ png_do_read_interlace(png_structp png_ptr)
 }
 #endif /* PNG_READ_INTERLACING_SUPPORTED */
 
+#if defined(__ARM_NEON__)
+/* NEON versions of the Up filter and of the Sub, Avg and Paeth filters for
+ * 4 byte pixels, the layout of RGBA and gray-alpha-16 rows.  Sub, Avg and
+ * Paeth depend on the previous pixel, so for them the four channels of one
+ * pixel are handled at a time.
+ */
+static void
+png_read_filter_row_up_neon(png_uint_32 rowbytes, png_bytep rp,
+   png_bytep pp)
+{
+   png_uint_32 i;
+
+   for (i = 0; i + 16 <= rowbytes; i += 16, rp += 16, pp += 16)
+      vst1q_u8(rp, vaddq_u8(vld1q_u8(rp), vld1q_u8(pp)));
+
+   for (; i < rowbytes; i++, rp++, pp++)
+      *rp = (png_byte)(*rp + *pp);
+}
+
+#define png_ld4(p, v) vreinterpret_u8_u32(vld1_lane_u32((uint32_t *)(p), \
+   vreinterpret_u32_u8(v), 0))
+#define png_st4(p, v) vst1_lane_u32((uint32_t *)(p), vreinterpret_u32_u8(v), 0)
+
+static void
+png_read_filter_row_sub4_neon(png_uint_32 rowbytes, png_bytep rp)
+{
+   uint8x8_t a = vdup_n_u8(0);
+   png_bytep rp_stop = rp + rowbytes;
+
+   for (; rp < rp_stop; rp += 4)
+   {
+      a = vadd_u8(png_ld4(rp, a), a);
+      png_st4(rp, a);
+   }
+}
+
+static void
+png_read_filter_row_avg4_neon(png_uint_32 rowbytes, png_bytep rp,
+   png_bytep pp)
+{
+   uint8x8_t a = vdup_n_u8(0);
+   uint8x8_t b = a;
+   png_bytep rp_stop = rp + rowbytes;
+
+   for (; rp < rp_stop; rp += 4, pp += 4)
+   {
+      b = png_ld4(pp, b);
+      a = vadd_u8(png_ld4(rp, a), vhadd_u8(a, b));
+      png_st4(rp, a);
+   }
+}
+
+static uint8x8_t
+png_paeth_neon(uint8x8_t a, uint8x8_t b, uint8x8_t c)
+{
+   uint16x8_t pa, pb, pc, p;
+   uint8x8_t use_a, use_b;
+
+   pa = vabdl_u8(b, c);                             /* |p - a| */
+   pb = vabdl_u8(a, c);                             /* |p - b| */
+   pc = vabdq_u16(vaddl_u8(a, b), vaddl_u8(c, c));  /* |p - c| */
+
+   p = vandq_u16(vcleq_u16(pa, pb), vcleq_u16(pa, pc));
+   use_a = vmovn_u16(p);
+   use_b = vmovn_u16(vcleq_u16(pb, pc));
+
+   return vbsl_u8(use_a, a, vbsl_u8(use_b, b, c));
+}
+
+static void
+png_read_filter_row_paeth4_neon(png_uint_32 rowbytes, png_bytep rp,
+   png_bytep pp)
+{
+   uint8x8_t a = vdup_n_u8(0);
+   uint8x8_t b = a;
+   uint8x8_t c = a;
+   png_bytep rp_stop = rp + rowbytes;
+
+   for (; rp < rp_stop; rp += 4, pp += 4)
+   {
+      b = png_ld4(pp, b);
+      a = vadd_u8(png_ld4(rp, a), png_paeth_neon(a, b, c));
+      png_st4(rp, a);
+      c = b;
+   }
+}
+#endif /* __ARM_NEON__ */
+
 void /* PRIVATE */
 png_read_filter_row(png_structp png_ptr, png_row_infop row_info, png_bytep row,
    png_bytep prev_row, int filter)
 {
    png_debug(1, "in png_read_filter_row");
    png_debug2(2, "row = %lu, filter = %d", png_ptr->row_number, filter);
+
+#if defined(__ARM_NEON__)
+   if (filter == PNG_FILTER_VALUE_UP)
+   {
+      png_read_filter_row_up_neon(row_info->rowbytes, row, prev_row);
+      return;
+   }
+
+   if (row_info->pixel_depth == 32)
+   {
+      switch (filter)
+      {
+         case PNG_FILTER_VALUE_SUB:
+            png_read_filter_row_sub4_neon(row_info->rowbytes, row);
+            return;
+         case PNG_FILTER_VALUE_AVG:
+            png_read_filter_row_avg4_neon(row_info->rowbytes, row, prev_row);
+            return;
+         case PNG_FILTER_VALUE_PAETH:
+            png_read_filter_row_paeth4_neon(row_info->rowbytes, row, prev_row);
+            return;
+      }
+   }
+#endif
+
    switch (filter)
    {
       case PNG_FILTER_VALUE_NONE:
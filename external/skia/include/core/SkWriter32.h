@@ -119,6 +119,9 @@ public:
     // return the current offset (will always be a multiple of 4)
     uint32_t  size() const { return fSize; }
     void      reset();
+    // empty the writer but keep the blocks it allocated, to be reused by the
+    // next writes instead of allocating new ones
+    void      rewind();
     uint32_t* reserve(size_t size); // size MUST be multiple of 4
 
     // return the address of the 4byte int at the specified offset (which must
@@ -5,6 +5,7 @@
 #include "SkRect.h"
 #include "SkImageDecoder.h"
 #include "SkStream.h"
+#include "SkTDArray.h"
 
 class SkBitmapRegionDecoder {
 public:
@@ -14,8 +15,10 @@ public:
         fStream = stream;
         fWidth = width;
         fHeight = height;
+        fCacheBytes = 0;
     }
     virtual ~SkBitmapRegionDecoder() {
+        purgeCache(0);
         delete fDecoder;
         fStream->unref();
     }
@@ -29,6 +32,27 @@ public:
     virtual SkImageDecoder* getDecoder() { return fDecoder; }
 
 private:
+    // A previously decoded region. Viewers that pan over a large image ask
+    // for the same tiles over and over, a hit is a copy instead of a decode.
+    struct CachedRegion {
+        SkIRect fRect;
+        SkBitmap::Config fPref;
+        int fSampleSize;
+        bool fDither;
+        bool fPreferQuality;
+        SkBitmap fBitmap;
+    };
+
+    // Most recently used first.
+    SkTDArray<CachedRegion*> fCache;
+    size_t fCacheBytes;
+
+    CachedRegion* findCached(const SkIRect& rect, SkBitmap::Config pref,
+                             int sampleSize);
+    void addCached(const SkBitmap& bitmap, const SkIRect& rect,
+                   SkBitmap::Config pref, int sampleSize);
+    void purgeCache(size_t limit);
+
     SkImageDecoder *fDecoder;
     SkStream *fStream;
     int fWidth;
@@ -0,0 +1,40 @@
+/*
+ * Copyright (C) 2011 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SkParallelPicture_DEFINED
+#define SkParallelPicture_DEFINED
+
+#include "SkTypes.h"
+
+class SkBitmap;
+class SkPicture;
+
+class SkParallelPicture {
+public:
+    /** Play the picture back into dst, split into horizontal bands that are
+        rasterized on up to threadCount threads. The calling thread draws the
+        first band itself. The result is the same as drawing the picture into
+        a canvas on dst, independent of the number of threads.
+
+        Each extra thread plays back a copy of the picture made by
+        serializing it, so shaders and other objects that keep state while
+        drawing are never shared between threads. All the factories the
+        picture uses must therefore be registered with SkFlattenable.
+     */
+    static void Draw(SkPicture* picture, const SkBitmap& dst, int threadCount);
+};
+
+#endif
@@ -53,6 +53,15 @@ void SkWriter32::reset() {
     fSingleBlock = NULL;
 }
 
+void SkWriter32::rewind() {
+    for (Block* block = fHead; block; block = block->fNext) {
+        block->fAllocated = 0;
+    }
+
+    fSize = 0;
+    fTail = fHead;
+}
+
 void SkWriter32::reset(void* block, size_t size) {
     this->reset();
     SkASSERT(0 == ((fSingleBlock - (char*)0) & 3));   // need 4-byte alignment
@@ -76,8 +85,15 @@ uint32_t* SkWriter32::reserve(size_t size) {
         SkASSERT(NULL == fHead);
         fHead = fTail = block = Block::Create(SkMax32(size, fMinSize));
     } else if (block->available() < size) {
-        fTail = Block::Create(SkMax32(size, fMinSize));
-        block->fNext = fTail;
+        // the blocks after the tail are empty, kept by rewind()
+        Block* next = block->fNext;
+        if (NULL != next && next->available() >= size) {
+            fTail = next;
+        } else {
+            fTail = Block::Create(SkMax32(size, fMinSize));
+            fTail->fNext = next;
+            block->fNext = fTail;
+        }
         block = fTail;
     }
     
@@ -1,7 +1,74 @@
 #include "SkBitmapRegionDecoder.h"
 
+// Upper bound on the pixel memory kept around for repeated regions.
+static const size_t kCacheLimit = 4 * 1024 * 1024;
+
 bool SkBitmapRegionDecoder::decodeRegion(SkBitmap* bitmap, SkIRect rect,
         SkBitmap::Config pref, int sampleSize) {
+    CachedRegion* cached = findCached(rect, pref, sampleSize);
+    if (cached != NULL) {
+        const SkBitmap& src = cached->fBitmap;
+        if (src.copyTo(bitmap, src.config(), fDecoder->getAllocator())) {
+            return true;
+        }
+    }
+
     fDecoder->setSampleSize(sampleSize);
-    return fDecoder->decodeRegion(bitmap, rect, pref);
+    if (!fDecoder->decodeRegion(bitmap, rect, pref)) {
+        return false;
+    }
+    addCached(*bitmap, rect, pref, sampleSize);
+    return true;
+}
+
+SkBitmapRegionDecoder::CachedRegion* SkBitmapRegionDecoder::findCached(
+        const SkIRect& rect, SkBitmap::Config pref, int sampleSize) {
+    bool dither = fDecoder->getDitherImage();
+    bool preferQuality = fDecoder->getPreferQualityOverSpeed();
+
+    for (int i = 0; i < fCache.count(); i++) {
+        CachedRegion* entry = fCache[i];
+        if (entry->fRect == rect && entry->fPref == pref &&
+                entry->fSampleSize == sampleSize && entry->fDither == dither &&
+                entry->fPreferQuality == preferQuality) {
+            // move to the front
+            memmove(fCache.begin() + 1, fCache.begin(), i * sizeof(CachedRegion*));
+            fCache[0] = entry;
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+void SkBitmapRegionDecoder::addCached(const SkBitmap& bitmap,
+        const SkIRect& rect, SkBitmap::Config pref, int sampleSize) {
+    size_t size = bitmap.getSize();
+    // index8 would need its color table carried along, not worth it
+    if (size > kCacheLimit / 4 || bitmap.config() == SkBitmap::kIndex8_Config) {
+        return;
+    }
+
+    CachedRegion* entry = new CachedRegion;
+    if (!bitmap.copyTo(&entry->fBitmap, bitmap.config())) {
+        delete entry;
+        return;
+    }
+    entry->fRect = rect;
+    entry->fPref = pref;
+    entry->fSampleSize = sampleSize;
+    entry->fDither = fDecoder->getDitherImage();
+    entry->fPreferQuality = fDecoder->getPreferQualityOverSpeed();
+
+    purgeCache(kCacheLimit - size);
+    *fCache.insert(0) = entry;
+    fCacheBytes += size;
+}
+
+void SkBitmapRegionDecoder::purgeCache(size_t limit) {
+    while (fCacheBytes > limit && fCache.count() > 0) {
+        CachedRegion* entry = fCache[fCache.count() - 1];
+        fCacheBytes -= entry->fBitmap.getSize();
+        fCache.remove(fCache.count() - 1);
+        delete entry;
+    }
 }
@@ -282,6 +282,21 @@ bool SkJPEGImageDecoder::onDecode(SkStream* stream, SkBitmap* bm, Mode mode) {
         return true;
     }
 
+    /*  The scaled dimensions only depend on the header, so get them without
+        jpeg_start_decompress(), which reads in (and for progressive images
+        decodes) the whole file.
+     */
+    if (SkImageDecoder::kDecodeBounds_Mode == mode) {
+        jpeg_calc_output_dimensions(&cinfo);
+        if (valid_output_dimensions(cinfo)) {
+            SkScaledBitmapSampler smpl(cinfo.output_width, cinfo.output_height,
+                                       recompute_sampleSize(sampleSize, cinfo));
+            bm->setConfig(config, smpl.scaledWidth(), smpl.scaledHeight());
+            bm->setIsOpaque(true);
+            return true;
+        }
+    }
+
     /*  image_width and image_height are the original dimensions, available
         after jpeg_read_header(). To see the scaled dimensions, we have to call
         jpeg_start_decompress(), and then read output_width and output_height.
@@ -350,9 +365,22 @@ bool SkJPEGImageDecoder::onDecode(SkStream* stream, SkBitmap* bm, Mode mode) {
         SkAutoLockPixels alp(*bm);
         rowptr = (JSAMPLE*)bm->getPixels();
         INT32 const bpr =  bm->rowBytes();
-        
+
+        /*  Ask for rec_outbuf_height rows at a time: with fewer, the merged
+            upsampler produces the extra row into a spare buffer and copies
+            it out on the next call.
+         */
+        JSAMPROW rows[4];
+        int const maxRows = SkMin32(cinfo.rec_outbuf_height,
+                                    SK_ARRAY_COUNT(rows));
+
         while (cinfo.output_scanline < cinfo.output_height) {
-            int row_count = jpeg_read_scanlines(&cinfo, &rowptr, 1);
+            int rowsLeft = cinfo.output_height - cinfo.output_scanline;
+            int n = SkMin32(maxRows, rowsLeft);
+            for (int i = 0; i < n; i++) {
+                rows[i] = rowptr + i * bpr;
+            }
+            int row_count = jpeg_read_scanlines(&cinfo, rows, n);
             // if row_count == 0, then we didn't get a scanline, so abort.
             // if we supported partial images, we might return true in this case
             if (0 == row_count) {
@@ -361,7 +389,7 @@ bool SkJPEGImageDecoder::onDecode(SkStream* stream, SkBitmap* bm, Mode mode) {
             if (this->shouldCancelDecode()) {
                 return return_false(cinfo, *bm, "shouldCancelDecode");
             }
-            rowptr += bpr;
+            rowptr += row_count * bpr;
         }
         if (reuseBitmap) {
             bm->notifyPixelsChanged();
@@ -22,6 +22,7 @@
 #include "SkBlitRow.h"
 #include "SkColorPriv.h"
 #include "SkDither.h"
+#include "SkUtils.h"
 
 #if defined(__ARM_HAVE_NEON)
 #include <arm_neon.h>
@@ -656,6 +657,55 @@ static void S32A_Opaque_BlitRow32_arm(SkPMColor* SK_RESTRICT dst,
 #define	S32A_Opaque_BlitRow32_PROC	S32A_Opaque_BlitRow32_arm
 #endif
 
+#if defined(__ARM_HAVE_NEON) && defined(SK_CPU_LENDIAN)
+
+/* Neon version of S32A_Blend_BlitRow32()
+ * portable version is in src/core/SkBlitRow_D32.cpp
+ */
+static void S32A_Blend_BlitRow32_neon(SkPMColor* SK_RESTRICT dst,
+                                 const SkPMColor* SK_RESTRICT src,
+                                 int count, U8CPU alpha) {
+    SkASSERT(alpha <= 255);
+    if (count > 0) {
+        uint16_t src_scale = SkAlpha255To256(alpha);
+
+        /* picks the alpha byte of each of the two pixels in a d register */
+        static const uint8_t alpha_index[8] = { 3, 3, 3, 3, 7, 7, 7, 7 };
+        uint8x8_t alpha_mask = vld1_u8(alpha_index);
+
+        while (count >= 2) {
+            uint8x8_t src_raw, dst_raw, src_alpha;
+            uint16x8_t src_wide, dst_wide, dst_scale;
+
+            src_raw = vreinterpret_u8_u32(vld1_u32(src));
+            dst_raw = vreinterpret_u8_u32(vld1_u32(dst));
+
+            /* dst_scale = 256 - SkAlphaMul(srcA, src_scale), per pixel */
+            src_alpha = vtbl1_u8(src_raw, alpha_mask);
+            dst_scale = vmulq_u16(vmovl_u8(src_alpha), vdupq_n_u16(src_scale));
+            dst_scale = vsubq_u16(vdupq_n_u16(256), vshrq_n_u16(dst_scale, 8));
+
+            src_wide = vmulq_u16(vmovl_u8(src_raw), vdupq_n_u16(src_scale));
+            dst_wide = vmulq_u16(vmovl_u8(dst_raw), dst_scale);
+
+            /* both halves are truncated separately, as SkAlphaMulQ does */
+            dst_raw = vadd_u8(vshrn_n_u16(src_wide, 8), vshrn_n_u16(dst_wide, 8));
+            vst1_u32(dst, vreinterpret_u32_u8(dst_raw));
+
+            src += 2;
+            dst += 2;
+            count -= 2;
+        }
+
+        if (count == 1) {
+            *dst = SkBlendARGB32(*src, *dst, alpha);
+        }
+    }
+}
+#define	S32A_Blend_BlitRow32_PROC	S32A_Blend_BlitRow32_neon
+
+#else
+
 /*
  * ARM asm version of S32A_Blend_BlitRow32
  */
@@ -788,6 +838,7 @@ static void S32A_Blend_BlitRow32_arm(SkPMColor* SK_RESTRICT dst,
 
 }
 #define	S32A_Blend_BlitRow32_PROC	S32A_Blend_BlitRow32_arm
+#endif
 
 /* Neon version of S32_Blend_BlitRow32()
  * portable version is in src/core/SkBlitRow_D32.cpp
@@ -1266,6 +1317,55 @@ static void S32_D565_Opaque_Dither_neon(uint16_t* SK_RESTRICT dst,
 
 ///////////////////////////////////////////////////////////////////////////////
 
+#if defined(__ARM_HAVE_NEON) && defined(SK_CPU_LENDIAN)
+/* Neon version of SkBlitRow::Color32()
+ * portable version is in src/core/SkBlitRow_D32.cpp
+ */
+static void Color32_neon(SkPMColor* dst, const SkPMColor* src, int count,
+                         SkPMColor color) {
+    if (count <= 0) {
+        return;
+    }
+
+    unsigned colorA = SkGetPackedA32(color);
+    if (255 == colorA) {
+        sk_memset32(dst, color, count);
+        return;
+    }
+
+    unsigned scale = 256 - SkAlpha255To256(colorA);
+    uint16x8_t scale_wide = vdupq_n_u16(scale);
+    uint8x16_t color_raw = vreinterpretq_u8_u32(vdupq_n_u32(color));
+
+    while (count >= 4) {
+        uint8x16_t src_raw = vreinterpretq_u8_u32(vld1q_u32(src));
+        uint16x8_t lo = vmulq_u16(vmovl_u8(vget_low_u8(src_raw)), scale_wide);
+        uint16x8_t hi = vmulq_u16(vmovl_u8(vget_high_u8(src_raw)), scale_wide);
+
+        /* no channel can carry: src * scale + color stays <= 255 */
+        uint8x16_t res = vcombine_u8(vshrn_n_u16(lo, 8), vshrn_n_u16(hi, 8));
+        res = vaddq_u8(res, color_raw);
+        vst1q_u32(dst, vreinterpretq_u32_u8(res));
+
+        src += 4;
+        dst += 4;
+        count -= 4;
+    }
+
+    while (count > 0) {
+        *dst = color + SkAlphaMulQ(*src, scale);
+        src += 1;
+        dst += 1;
+        count -= 1;
+    }
+}
+#define	Color32_PROC	Color32_neon
+#else
+#define	Color32_PROC	NULL
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+
 static const SkBlitRow::Proc platform_565_procs[] = {
     // no dither
     S32_D565_Opaque_PROC,
@@ -1314,7 +1414,7 @@ SkBlitRow::Proc32 SkBlitRow::PlatformProcs32(unsigned flags) {
 }
 
 SkBlitRow::ColorProc SkBlitRow::PlatformColorProc() {
-    return NULL;
+    return Color32_PROC;
 }
 
 
@@ -327,10 +327,32 @@ public:
             path = fullpath.c_str();
         }
         fPath.set(path);
+        fMapping = NULL;
+    }
+    virtual ~FileTypeface() {
+        SkSafeUnref(fMapping);
     }
 
     // overrides
     virtual SkStream* openStream() {
+        // System fonts live as long as the process, so map them once and
+        // hand out streams over that mapping rather than mapping the file
+        // again for every scaler context. Called with gFamilyMutex held.
+        if (this->isSysFont()) {
+            if (NULL == fMapping) {
+                SkMMAPStream* mapping = SkNEW_ARGS(SkMMAPStream, (fPath.c_str()));
+                if (mapping->getLength() > 0) {
+                    fMapping = mapping;
+                } else {
+                    SkDELETE(mapping);
+                }
+            }
+            if (fMapping) {
+                return SkNEW_ARGS(SkMemoryStream, (fMapping->getMemoryBase(),
+                                                   fMapping->getLength()));
+            }
+        }
+
         SkStream* stream = SkNEW_ARGS(SkMMAPStream, (fPath.c_str()));
 
         // check for failure
@@ -357,7 +379,8 @@ public:
     }
 
 private:
-    SkString fPath;
+    SkString        fPath;
+    SkMMAPStream*   fMapping;
 
     typedef FamilyTypeface INHERITED;
 };
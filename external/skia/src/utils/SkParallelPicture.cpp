@@ -0,0 +1,112 @@
+/*
+** Copyright 2011, The Android Open Source Project
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+
+#include "SkParallelPicture.h"
+#include "SkBitmap.h"
+#include "SkCanvas.h"
+#include "SkPicture.h"
+#include "SkStream.h"
+
+#include <pthread.h>
+
+// Band tops are kept on a multiple of this, so that ordered dithering, which
+// keys off device y, lines up with a draw into the whole bitmap.
+static const int kBandAlign = 16;
+
+static const int kMaxThreads = 16;
+
+struct Band {
+    SkBitmap        fBitmap;    // the rows of dst this band covers
+    int             fTop;
+    const void*     fData;      // the serialized picture
+    size_t          fSize;
+    pthread_t       fThread;
+    bool            fStarted;
+};
+
+static void draw_band(SkPicture* picture, Band* band) {
+    SkCanvas canvas(band->fBitmap);
+    canvas.translate(0, -SkIntToScalar(band->fTop));
+    picture->draw(&canvas);
+}
+
+static void* band_thread_proc(void* arg) {
+    Band* band = (Band*)arg;
+    SkMemoryStream stream(band->fData, band->fSize);
+    SkPicture picture(&stream);
+    draw_band(&picture, band);
+    return NULL;
+}
+
+void SkParallelPicture::Draw(SkPicture* picture, const SkBitmap& dst,
+                             int threadCount) {
+    int height = dst.height();
+    if (threadCount > kMaxThreads) {
+        threadCount = kMaxThreads;
+    }
+
+    int bandHeight = 0;
+    if (threadCount > 1) {
+        bandHeight = (height + threadCount - 1) / threadCount;
+        bandHeight = (bandHeight + kBandAlign - 1) & ~(kBandAlign - 1);
+    }
+
+    Band bands[kMaxThreads];
+    int bandCount = 0;
+    if (bandHeight > 0 && bandHeight < height) {
+        for (int top = 0; top < height; top += bandHeight) {
+            Band& band = bands[bandCount++];
+            SkIRect r;
+            r.set(0, top, dst.width(), SkMin32(top + bandHeight, height));
+            if (!dst.extractSubset(&band.fBitmap, r)) {
+                bandCount = 0;
+                break;
+            }
+            band.fTop = top;
+            band.fStarted = false;
+        }
+    }
+
+    if (bandCount == 0) {
+        SkCanvas canvas(dst);
+        picture->draw(&canvas);
+        return;
+    }
+
+    picture->endRecording();
+    SkDynamicMemoryWStream stream;
+    picture->serialize(&stream);
+    for (int i = 1; i < bandCount; i++) {
+        bands[i].fData = stream.getStream();
+        bands[i].fSize = stream.getOffset();
+    }
+
+    for (int i = 1; i < bandCount; i++) {
+        bands[i].fStarted = pthread_create(&bands[i].fThread, NULL,
+                                           band_thread_proc, &bands[i]) == 0;
+    }
+
+    draw_band(picture, &bands[0]);
+
+    for (int i = 1; i < bandCount; i++) {
+        if (bands[i].fStarted) {
+            pthread_join(bands[i].fThread, NULL);
+        } else {
+            // no thread for this band, draw it here instead
+            draw_band(picture, &bands[i]);
+        }
+    }
+}
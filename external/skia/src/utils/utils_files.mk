@@ -8,6 +8,7 @@ SOURCE := \
 	SkNinePatch.cpp \
     SkNWayCanvas.cpp \
 	SkOSFile.cpp \
+	SkParallelPicture.cpp \
     SkParse.cpp \
     SkParseColor.cpp \
     SkParsePath.cpp \
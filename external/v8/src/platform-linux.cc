@@ -109,39 +109,50 @@ uint64_t OS::CpuFeaturesImpliedByPlatform() {
 
 
 #ifdef __arm__
-static bool CPUInfoContainsString(const char * search_string) {
-  const char* file_name = "/proc/cpuinfo";
-  // This is written as a straight shot one pass parser
-  // and not using STL string and ifstream because,
-  // on Linux, it's reading from a (non-mmap-able)
-  // character special device.
-  FILE* f = NULL;
-  const char* what = search_string;
-
-  if (NULL == (f = fopen(file_name, "r")))
-    return false;
-
-  int k;
-  while (EOF != (k = fgetc(f))) {
-    if (k == *what) {
-      ++what;
-      while ((*what != '\0') && (*what == fgetc(f))) {
-        ++what;
-      }
-      if (*what == '\0') {
-        fclose(f);
-        return true;
-      } else {
-        what = search_string;
-      }
+// Returns the contents of /proc/cpuinfo, read on first use. Probing looks
+// for up to four strings and the file is a character special device that
+// the kernel regenerates on every open, so it is only read once.
+// CpuFeatures::Probe() runs under the V8 init-once lock, so this needs no
+// locking of its own.
+static const char* CPUInfo() {
+  static char* cpu_info = NULL;
+  static bool read_done = false;
+  if (read_done) return cpu_info;
+  read_done = true;
+
+  FILE* f = fopen("/proc/cpuinfo", "r");
+  if (f == NULL) return NULL;
+
+  // The file reports a size of zero, so grow the buffer as we go.
+  size_t capacity = 1024;
+  size_t length = 0;
+  char* buffer = static_cast<char*>(malloc(capacity));
+  while (buffer != NULL) {
+    length += fread(buffer + length, 1, capacity - length - 1, f);
+    if (length < capacity - 1) break;
+    capacity *= 2;
+    char* grown = static_cast<char*>(realloc(buffer, capacity));
+    if (grown == NULL) {
+      free(buffer);
     }
+    buffer = grown;
   }
   fclose(f);
 
-  // Did not find string in the proc file.
-  return false;
+  if (buffer != NULL) {
+    buffer[length] = '\0';
+    cpu_info = buffer;
+  }
+  return cpu_info;
+}
+
+
+static bool CPUInfoContainsString(const char * search_string) {
+  const char* cpu_info = CPUInfo();
+  return cpu_info != NULL && strstr(cpu_info, search_string) != NULL;
 }
 
+
 bool OS::ArmCpuHasFeature(CpuFeature feature) {
   const char* search_string = NULL;
   // Simple detection of VFP at runtime for Linux.
@@ -99,9 +99,14 @@ int PaintTileOperation::priority()
     // for base tiles, prioritize based on position
     if (!m_tile->isLayerTile()) {
         bool goingDown = m_tile->page()->scrollingDown();
-        SkIRect *rect = m_tile->page()->expandedTileBounds();
         priority += m_tile->x();
 
+        // tiles in the viewport go before the prefetched border around it,
+        // otherwise the rows ahead of a fling get painted while the visible
+        // ones still checkerboard
+        if (!m_tile->page()->visibleTileBounds().contains(m_tile->x(), m_tile->y()))
+            priority += 25000;
+
         if (goingDown)
             priority += 100000 - (1 + m_tile->y()) * 1000;
         else
@@ -85,10 +85,17 @@ void RasterRenderer::setupCanvas(const TileRenderInfo& renderInfo, SkCanvas* can
         m_perfMon.start(TAG_CREATE_BITMAP);
 
 
-    SkBitmap bitmap;
-    bitmap.setConfig(SkBitmap::kARGB_8888_Config,
-            renderInfo.invalRect->width(), renderInfo.invalRect->height());
-    bitmap.allocPixels();
+    // Tiles are all painted on the TexturesGenerator thread, and the
+    // transfer queue copies the pixels out before the next tile starts, so
+    // one bitmap can be reused instead of allocating 256K for every tile.
+    static SkBitmap bitmap;
+    const int width = renderInfo.invalRect->width();
+    const int height = renderInfo.invalRect->height();
+    if (bitmap.width() != width || bitmap.height() != height) {
+        bitmap.reset();
+        bitmap.setConfig(SkBitmap::kARGB_8888_Config, width, height);
+        bitmap.allocPixels();
+    }
     if (renderInfo.baseTile->isLayerTile()) {
         bitmap.setIsOpaque(false);
         bitmap.eraseARGB(0, 0, 0, 0);
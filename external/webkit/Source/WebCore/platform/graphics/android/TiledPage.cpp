@@ -70,6 +70,7 @@ TiledPage::TiledPage(int id, GLWebViewState* state)
     , m_isPrefetchPage(false)
 {
     m_baseTiles = new BaseTile[TilesManager::getMaxTextureAllocation() + 1];
+    m_visibleTileBounds.setEmpty();
 #ifdef DEBUG_COUNT
     ClassTracker::instance()->increment("TiledPage");
 #endif
@@ -235,6 +236,7 @@ void TiledPage::prepare(bool goingDown, bool goingLeft, const SkIRect& tileBound
 
     TilesManager::instance()->gatherTextures();
     m_scrollingDown = goingDown;
+    m_visibleTileBounds = tileBounds;
 
     int firstTileX = tileBounds.fLeft;
     int firstTileY = tileBounds.fTop;
@@ -98,6 +98,7 @@ public:
     void updateBaseTileSize();
     bool scrollingDown() { return m_scrollingDown; }
     SkIRect* expandedTileBounds() { return &m_expandedTileBounds; }
+    const SkIRect& visibleTileBounds() { return m_visibleTileBounds; }
     bool isPrefetchPage() { return m_isPrefetchPage; }
     void setIsPrefetchPage(bool isPrefetch) { m_isPrefetchPage = isPrefetch; }
 
@@ -129,6 +130,8 @@ private:
     bool m_prepare;
     bool m_scrollingDown;
     SkIRect m_expandedTileBounds;
+    // tiles covering the viewport itself, without the prefetched border
+    SkIRect m_visibleTileBounds;
     bool m_isPrefetchPage;
 };
 
@@ -27,11 +27,13 @@
 #include "ResourceHandle.h"
 
 #include "CachedResourceLoader.h"
+#include "DNS.h"
 #include "DocumentLoader.h"
 #include "Frame.h"
 #include "FrameLoader.h"
 #include "MainResourceLoader.h"
 #include "NotImplemented.h"
+#include "PlatformBridge.h"
 #include "ResourceHandleClient.h"
 #include "ResourceHandleInternal.h"
 #include "ResourceLoaderAndroid.h"
@@ -160,4 +162,9 @@ void ResourceHandle::loadResourceSynchronously(NetworkingContext* context, const
     ResourceLoaderAndroid::start(h.get(), request, context->frameLoaderClient(), false, true);
 }
 
+void prefetchDNS(const String& hostname)
+{
+    PlatformBridge::prefetchDNS(hostname);
+}
+
 } // namespace WebCore
@@ -60,6 +60,7 @@
 #include <base/tuple.h>
 #include <base/utf_string_conversions.h>
 #include <chrome/browser/net/sqlite_persistent_cookie_store.h>
+#include <net/base/address_list.h>
 #include <net/base/auth.h>
 #include <net/base/cert_verifier.h>
 #include <net/base/cookie_monster.h>
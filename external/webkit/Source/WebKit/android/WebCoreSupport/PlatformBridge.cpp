@@ -36,6 +36,7 @@
 #include "MemoryUsage.h"
 #include "PluginView.h"
 #include "Settings.h"
+#include "WebCache.h"
 #include "WebCookieJar.h"
 #include "WebRequestContext.h"
 #include "WebViewCore.h"
@@ -116,6 +117,16 @@ bool PlatformBridge::cookiesEnabled(const Document* document)
 #endif
 }
 
+void PlatformBridge::prefetchDNS(const String& hostname)
+{
+#if USE(CHROME_NETWORK_STACK)
+    // WebCore does not tell us which document the link came from, so the
+    // lookup always goes to the regular cache's resolver.
+    if (!hostname.isEmpty())
+        WebCache::get(false)->preresolve(std::string(hostname.utf8().data()));
+#endif
+}
+
 NPObject* PlatformBridge::pluginScriptableObject(Widget* widget)
 {
 #if USE(V8)
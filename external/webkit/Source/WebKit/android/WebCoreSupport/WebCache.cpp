@@ -42,6 +42,43 @@ namespace android {
 
 static WTF::Mutex instanceMutex;
 
+// A page can link to many hosts; beyond this many outstanding lookups the
+// extra hosts are not worth competing with real requests for the resolver.
+static const size_t kMaxPreresolveRequests = 8;
+
+class WebCache::PreresolveRequest {
+public:
+    PreresolveRequest(WebCache* cache, const string& host)
+        : m_cache(cache)
+        , m_host(host)
+        , m_resolver(cache->hostResolver())
+        , m_callback(this, &PreresolveRequest::onDone)
+    {
+    }
+
+    const string& host() const { return m_host; }
+
+    int start()
+    {
+        HostResolver::RequestInfo info(HostPortPair(m_host, 80));
+        // Lets the resolver put this behind lookups for real requests.
+        info.set_is_speculative(true);
+        return m_resolver.Resolve(info, &m_addresses, &m_callback, BoundNetLog());
+    }
+
+private:
+    void onDone(int)
+    {
+        m_cache->onPreresolveDone(this);
+    }
+
+    WebCache* m_cache;
+    string m_host;
+    SingleRequestHostResolver m_resolver;
+    AddressList m_addresses;
+    CompletionCallbackImpl<PreresolveRequest> m_callback;
+};
+
 static const string& rootDirectory()
 {
     // This method may be called on any thread, as the Java method is
@@ -127,6 +164,15 @@ WebCache::WebCache(bool isPrivateBrowsing)
                                  backendFactory);
 }
 
+WebCache::~WebCache()
+{
+    // Deleting a request cancels its lookup, so this must happen while the
+    // resolver is still alive.
+    map<string, PreresolveRequest*>::iterator end = m_preresolveRequests.end();
+    for (map<string, PreresolveRequest*>::iterator it = m_preresolveRequests.begin(); it != end; ++it)
+        delete it->second;
+}
+
 void WebCache::clear()
 {
     base::Thread* thread = WebUrlLoaderClient::ioThread();
@@ -146,6 +192,34 @@ void WebCache::closeIdleImpl()
     m_cache->CloseIdleConnections();
 }
 
+void WebCache::preresolve(const string& host)
+{
+    base::Thread* thread = WebUrlLoaderClient::ioThread();
+    if (thread)
+        thread->message_loop()->PostTask(FROM_HERE, NewRunnableMethod(this, &WebCache::preresolveImpl, host));
+}
+
+void WebCache::preresolveImpl(string host)
+{
+    if (m_preresolveRequests.size() >= kMaxPreresolveRequests || m_preresolveRequests.count(host))
+        return;
+
+    PreresolveRequest* request = new PreresolveRequest(this, host);
+    // Anything but ERR_IO_PENDING means the lookup has already completed,
+    // most likely from the resolver cache.
+    if (request->start() != ERR_IO_PENDING) {
+        delete request;
+        return;
+    }
+    m_preresolveRequests[host] = request;
+}
+
+void WebCache::onPreresolveDone(PreresolveRequest* request)
+{
+    m_preresolveRequests.erase(request->host());
+    delete request;
+}
+
 void WebCache::clearImpl()
 {
     if (m_isClearInProgress)
@@ -30,6 +30,7 @@
 #include "ChromiumIncludes.h"
 
 #include <OwnPtr.h>
+#include <map>
 #include <platform/text/PlatformString.h>
 #include <wtf/ThreadingPrimitives.h>
 
@@ -48,10 +49,15 @@ public:
     net::HttpCache* cache() { return m_cache.get(); }
     net::ProxyConfigServiceAndroid* proxy() { return m_proxyConfigService; }
     void closeIdleConnections();
-
+    // Looks the host up in the background, so that the answer is already in
+    // the HostResolver cache when a request for it is made. Threadsafe.
+    void preresolve(const std::string& host);
 
 private:
+    friend class base::RefCountedThreadSafe<WebCache>;
+
     WebCache(bool isPrivateBrowsing);
+    ~WebCache();
 
     // For clear()
     void clearImpl();
@@ -66,6 +72,11 @@ private:
     void openEntry(int);
     void onGetEntryDone(int);
 
+    // For preresolve()
+    class PreresolveRequest;
+    void preresolveImpl(std::string host);
+    void onPreresolveDone(PreresolveRequest*);
+
     OwnPtr<net::HostResolver> m_hostResolver;
     OwnPtr<net::HttpCache> m_cache;
     // This is owned by the ProxyService, which is owned by the HttpNetworkLayer,
@@ -86,6 +97,9 @@ private:
     WTF::ThreadCondition m_getEntryCondition;
 
     disk_cache::Backend* m_cacheBackend;
+
+    // For preresolve(), keyed by host. Only used on the IO thread.
+    std::map<std::string, PreresolveRequest*> m_preresolveRequests;
 };
 
 } // namespace android
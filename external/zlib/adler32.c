@@ -11,6 +11,20 @@
 
 local uLong adler32_combine_(uLong adler1, uLong adler2, z_off64_t len2);
 
+/* sum 32-byte blocks with vector instructions where the compiler allows */
+#if defined(__ARM_NEON__)
+#  include <arm_neon.h>
+#  define ADLER32_SIMD
+#elif defined(__SSE2__)
+#  include <emmintrin.h>
+#  define ADLER32_SIMD
+#endif
+
+#ifdef ADLER32_SIMD
+local uLong adler32_simd_(uLong adler, uLong sum2, const Bytef *buf,
+                          uInt len);
+#endif
+
 #define BASE 65521UL    /* largest prime smaller than 65536 */
 #define NMAX 5552
 /* NMAX is the largest n such that 255n(n+1)/2 + (n+1)(BASE-1) <= 2^32-1 */
@@ -96,6 +110,11 @@ uLong ZEXPORT adler32(adler, buf, len)
         return adler | (sum2 << 16);
     }
 
+#ifdef ADLER32_SIMD
+    if (len >= 64)
+        return adler32_simd_(adler, sum2, buf, len);
+#endif
+
     /* do length NMAX blocks -- requires just one modulo operation */
     while (len >= NMAX) {
         len -= NMAX;
@@ -127,6 +146,138 @@ uLong ZEXPORT adler32(adler, buf, len)
     return adler | (sum2 << 16);
 }
 
+#ifdef ADLER32_SIMD
+/* ========================================================================= */
+/*
+ * Process the input 32 bytes at a time.  For n blocks starting from sums
+ * (adler, sum2), sum2 grows by 32 * n * adler, plus 32 times the adler
+ * value at the start of each block (kept in ps), plus each byte weighted
+ * by its distance from the end of its block (32 down to 1).  The byte
+ * sums and weighted sums are gathered in vector lanes and folded back
+ * with one modulo per NMAX bytes, as in the scalar loop.
+ */
+#define SIMD_BLOCK 32
+#define SIMD_NMAX (NMAX / SIMD_BLOCK)
+
+local uLong adler32_simd_(adler, sum2, buf, len)
+    uLong adler;
+    uLong sum2;
+    const Bytef *buf;
+    uInt len;
+{
+    while (len >= SIMD_BLOCK) {
+        unsigned n = len / SIMD_BLOCK;
+        if (n > SIMD_NMAX)
+            n = SIMD_NMAX;
+        len -= n * SIMD_BLOCK;
+
+        sum2 += adler * n * SIMD_BLOCK;
+
+#if defined(__ARM_NEON__)
+        {
+            static const unsigned short taps[SIMD_BLOCK] = {
+                32, 31, 30, 29, 28, 27, 26, 25, 24, 23, 22, 21, 20, 19, 18, 17,
+                16, 15, 14, 13, 12, 11, 10,  9,  8,  7,  6,  5,  4,  3,  2,  1
+            };
+            uint32x4_t v_s1 = vdupq_n_u32(0);
+            uint32x4_t v_ps = vdupq_n_u32(0);
+            uint32x4_t v_s2;
+            uint16x8_t v_col1 = vdupq_n_u16(0);
+            uint16x8_t v_col2 = vdupq_n_u16(0);
+            uint16x8_t v_col3 = vdupq_n_u16(0);
+            uint16x8_t v_col4 = vdupq_n_u16(0);
+            uint32x2_t v_sum;
+
+            do {
+                /* per-column byte sums fit in 16 bits for SIMD_NMAX blocks */
+                uint8x16_t bytes1 = vld1q_u8(buf);
+                uint8x16_t bytes2 = vld1q_u8(buf + 16);
+
+                v_ps = vaddq_u32(v_ps, v_s1);
+                v_s1 = vpadalq_u16(v_s1,
+                        vpadalq_u8(vpaddlq_u8(bytes1), bytes2));
+                v_col1 = vaddw_u8(v_col1, vget_low_u8(bytes1));
+                v_col2 = vaddw_u8(v_col2, vget_high_u8(bytes1));
+                v_col3 = vaddw_u8(v_col3, vget_low_u8(bytes2));
+                v_col4 = vaddw_u8(v_col4, vget_high_u8(bytes2));
+                buf += SIMD_BLOCK;
+            } while (--n);
+
+            v_s2 = vshlq_n_u32(v_ps, 5);
+            v_s2 = vmlal_u16(v_s2, vget_low_u16(v_col1), vld1_u16(taps));
+            v_s2 = vmlal_u16(v_s2, vget_high_u16(v_col1), vld1_u16(taps + 4));
+            v_s2 = vmlal_u16(v_s2, vget_low_u16(v_col2), vld1_u16(taps + 8));
+            v_s2 = vmlal_u16(v_s2, vget_high_u16(v_col2), vld1_u16(taps + 12));
+            v_s2 = vmlal_u16(v_s2, vget_low_u16(v_col3), vld1_u16(taps + 16));
+            v_s2 = vmlal_u16(v_s2, vget_high_u16(v_col3), vld1_u16(taps + 20));
+            v_s2 = vmlal_u16(v_s2, vget_low_u16(v_col4), vld1_u16(taps + 24));
+            v_s2 = vmlal_u16(v_s2, vget_high_u16(v_col4), vld1_u16(taps + 28));
+
+            v_sum = vpadd_u32(vget_low_u32(v_s1), vget_high_u32(v_s1));
+            adler += vget_lane_u32(vpadd_u32(v_sum, v_sum), 0);
+            v_sum = vpadd_u32(vget_low_u32(v_s2), vget_high_u32(v_s2));
+            sum2 += vget_lane_u32(vpadd_u32(v_sum, v_sum), 0);
+        }
+#else /* __SSE2__ */
+        {
+            const __m128i zero = _mm_setzero_si128();
+            const __m128i taps1 = _mm_setr_epi16(32, 31, 30, 29, 28, 27, 26, 25);
+            const __m128i taps2 = _mm_setr_epi16(24, 23, 22, 21, 20, 19, 18, 17);
+            const __m128i taps3 = _mm_setr_epi16(16, 15, 14, 13, 12, 11, 10, 9);
+            const __m128i taps4 = _mm_setr_epi16(8, 7, 6, 5, 4, 3, 2, 1);
+            __m128i v_s1 = zero;
+            __m128i v_ps = zero;
+            __m128i v_s2 = zero;
+            __m128i v_sum;
+
+            do {
+                __m128i bytes1 = _mm_loadu_si128((const __m128i *)buf);
+                __m128i bytes2 = _mm_loadu_si128((const __m128i *)(buf + 16));
+
+                v_ps = _mm_add_epi32(v_ps, v_s1);
+                v_s1 = _mm_add_epi32(v_s1, _mm_sad_epu8(bytes1, zero));
+                v_s1 = _mm_add_epi32(v_s1, _mm_sad_epu8(bytes2, zero));
+                v_s2 = _mm_add_epi32(v_s2, _mm_madd_epi16(
+                        _mm_unpacklo_epi8(bytes1, zero), taps1));
+                v_s2 = _mm_add_epi32(v_s2, _mm_madd_epi16(
+                        _mm_unpackhi_epi8(bytes1, zero), taps2));
+                v_s2 = _mm_add_epi32(v_s2, _mm_madd_epi16(
+                        _mm_unpacklo_epi8(bytes2, zero), taps3));
+                v_s2 = _mm_add_epi32(v_s2, _mm_madd_epi16(
+                        _mm_unpackhi_epi8(bytes2, zero), taps4));
+                buf += SIMD_BLOCK;
+            } while (--n);
+
+            v_s2 = _mm_add_epi32(v_s2, _mm_slli_epi32(v_ps, 5));
+
+            v_sum = _mm_add_epi32(v_s1, _mm_shuffle_epi32(v_s1, 0x4e));
+            v_sum = _mm_add_epi32(v_sum, _mm_shuffle_epi32(v_sum, 0xb1));
+            adler += (unsigned long)(unsigned)_mm_cvtsi128_si32(v_sum);
+            v_sum = _mm_add_epi32(v_s2, _mm_shuffle_epi32(v_s2, 0x4e));
+            v_sum = _mm_add_epi32(v_sum, _mm_shuffle_epi32(v_sum, 0xb1));
+            sum2 += (unsigned long)(unsigned)_mm_cvtsi128_si32(v_sum);
+        }
+#endif
+
+        MOD(adler);
+        MOD(sum2);
+    }
+
+    /* do remaining bytes (less than 32, still just one modulo) */
+    if (len) {
+        while (len--) {
+            adler += *buf++;
+            sum2 += adler;
+        }
+        MOD(adler);
+        MOD(sum2);
+    }
+
+    /* return recombined sums */
+    return adler | (sum2 << 16);
+}
+#endif /* ADLER32_SIMD */
+
 /* ========================================================================= */
 local uLong adler32_combine_(adler1, adler2, len2)
     uLong adler1;
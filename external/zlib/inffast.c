@@ -29,6 +29,14 @@
 #  define PUP(a) *++(a)
 #endif
 
+/* Matches at least this long, and at least this far back, are copied with
+   zmemcpy() a period at a time instead of byte by byte. Bionic's memcpy()
+   moves these with wide loads and stores.
+ */
+#ifndef MIN_MEMCPY
+#  define MIN_MEMCPY 16
+#endif
+
 /*
    Decode literal, length, and distance codes and write out the resulting
    literal and match bytes until either not enough input or output is
@@ -265,6 +273,17 @@ unsigned start;         /* inflate()'s starting value for strm->avail_out */
                             PUP(out) = PUP(from);
                     }
                 }
+                else if (len >= MIN_MEMCPY && dist >= MIN_MEMCPY) {
+                    from = out - dist;          /* copy direct from output */
+                    while (len > dist) {        /* whole periods never overlap */
+                        zmemcpy(out + OFF, from + OFF, dist);
+                        out += dist;
+                        from += dist;
+                        len -= dist;
+                    }
+                    zmemcpy(out + OFF, from + OFF, len);
+                    out += len;
+                }
                 else {
                     from = out - dist;          /* copy direct from output */
                     do {                        /* minimum length is three */
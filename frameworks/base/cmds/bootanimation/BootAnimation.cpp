@@ -58,7 +58,8 @@ namespace android {
 
 // ---------------------------------------------------------------------------
 
-BootAnimation::BootAnimation() : Thread(false)
+BootAnimation::BootAnimation() : Thread(false),
+    mTexWidth(0), mTexHeight(0), mTexType(0)
 {
     mSession = new SurfaceComposerClient();
 }
@@ -168,32 +169,33 @@ status_t BootAnimation::initTexture(void* buffer, size_t len)
     if (tw < w) tw <<= 1;
     if (th < h) th <<= 1;
 
+    GLenum format, type;
     switch (bitmap.getConfig()) {
         case SkBitmap::kARGB_8888_Config:
-            if (tw != w || th != h) {
-                glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, tw, th, 0, GL_RGBA,
-                        GL_UNSIGNED_BYTE, 0);
-                glTexSubImage2D(GL_TEXTURE_2D, 0,
-                        0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, p);
-            } else {
-                glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, tw, th, 0, GL_RGBA,
-                        GL_UNSIGNED_BYTE, p);
-            }
+            format = GL_RGBA;
+            type = GL_UNSIGNED_BYTE;
             break;
-
         case SkBitmap::kRGB_565_Config:
-            if (tw != w || th != h) {
-                glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, tw, th, 0, GL_RGB,
-                        GL_UNSIGNED_SHORT_5_6_5, 0);
-                glTexSubImage2D(GL_TEXTURE_2D, 0,
-                        0, 0, w, h, GL_RGB, GL_UNSIGNED_SHORT_5_6_5, p);
-            } else {
-                glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, tw, th, 0, GL_RGB,
-                        GL_UNSIGNED_SHORT_5_6_5, p);
-            }
+            format = GL_RGB;
+            type = GL_UNSIGNED_SHORT_5_6_5;
             break;
         default:
-            break;
+            return NO_ERROR;
+    }
+
+    if (tw == mTexWidth && th == mTexHeight && type == mTexType) {
+        // consecutive frames have the same size, only replace the pixels
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, w, h, format, type, p);
+    } else {
+        if (tw != w || th != h) {
+            glTexImage2D(GL_TEXTURE_2D, 0, format, tw, th, 0, format, type, 0);
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, w, h, format, type, p);
+        } else {
+            glTexImage2D(GL_TEXTURE_2D, 0, format, tw, th, 0, format, type, p);
+        }
+        mTexWidth = tw;
+        mTexHeight = th;
+        mTexType = type;
     }
 
     glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_CROP_RECT_OES, crop);
@@ -465,6 +467,7 @@ bool BootAnimation::movie()
         const Animation::Part& part(animation.parts[i]);
         const size_t fcount = part.frames.size();
         glBindTexture(GL_TEXTURE_2D, 0);
+        mTexWidth = mTexHeight = 0;
 
         for (int r=0 ; !part.count || r<part.count ; r++) {
             for (int j=0 ; j<fcount && !exitPending(); j++) {
@@ -476,6 +479,7 @@ bool BootAnimation::movie()
                     if (part.count != 1) {
                         glGenTextures(1, &frame.tid);
                         glBindTexture(GL_TEXTURE_2D, frame.tid);
+                        mTexWidth = mTexHeight = 0;
                         glTexParameterx(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
                         glTexParameterx(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
                     }
@@ -499,12 +503,15 @@ bool BootAnimation::movie()
                 glDrawTexiOES(xc, yc, 0, animation.width, animation.height);
                 eglSwapBuffers(mDisplay, mSurface);
 
+                // only sleep for what is left of the frame, the time spent
+                // decoding and drawing it is part of its duration
                 nsecs_t now = systemTime();
                 nsecs_t delay = frameDuration - (now - lastFrame);
+                if (delay > 0) {
+                    usleep(ns2us(delay));
+                    now += delay;
+                }
                 lastFrame = now;
-                long wait = ns2us(frameDuration);
-                if (wait > 0)
-                    usleep(wait);
             }
             usleep(part.pause * ns2us(frameDuration));
         }
@@ -95,6 +95,10 @@ private:
     sp<Surface> mFlingerSurface;
     bool        mAndroidAnimation;
     ZipFileRO   mZip;
+    // storage of the texture the movie frames are decoded into, 0 if unknown
+    GLint       mTexWidth;
+    GLint       mTexHeight;
+    GLenum      mTexType;
 };
 
 // ---------------------------------------------------------------------------
@@ -137,10 +137,17 @@ int dump_file(const char *title, const char* path) {
     return 0;
 }
 
+/* returns the monotonic wall clock time in seconds */
+static double uptime_seconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
 /* forks a command and waits for it to finish */
 int run_command(const char *title, int timeout_seconds, const char *command, ...) {
     fflush(stdout);
-    clock_t start = clock();
+    double start = uptime_seconds();
     pid_t pid = fork();
 
     /* handle error case */
@@ -172,10 +179,11 @@ int run_command(const char *title, int timeout_seconds, const char *command, ...
     }
 
     /* handle parent case */
+    useconds_t poll_us = 1000;
     for (;;) {
         int status;
         pid_t p = waitpid(pid, &status, WNOHANG);
-        float elapsed = (float) (clock() - start) / CLOCKS_PER_SEC;
+        float elapsed = (float) (uptime_seconds() - start);
         if (p == pid) {
             if (WIFSIGNALED(status)) {
                 printf("*** %s: Killed by signal %d\n", command, WTERMSIG(status));
@@ -192,7 +200,10 @@ int run_command(const char *title, int timeout_seconds, const char *command, ...
             return -1;
         }
 
-        usleep(100000);  // poll every 0.1 sec
+        // most commands finish within a few msec, so start polling often
+        // and back off to every 0.1 sec for the slow ones
+        usleep(poll_us);
+        poll_us = (poll_us * 2 < 100000) ? poll_us * 2 : 100000;
     }
 }
 
@@ -36,6 +36,27 @@ int main(int argc, char* const argv[])
         return 20;
     }
 
+    if (argc >= 3 && strcmp(argv[1], "--binder-stats") == 0) {
+        // dumpsys --binder-stats <service> [reset]
+        // Prints the binder transaction latency statistics of the process
+        // hosting the service.
+        sp<IBinder> service = sm->checkService(String16(argv[2]));
+        if (service == NULL) {
+            aerr << "Can't find service: " << argv[2] << endl;
+            return 20;
+        }
+        Parcel data, reply;
+        data.writeFileDescriptor(STDOUT_FILENO);
+        data.writeInt32(argc >= 4 && strcmp(argv[3], "reset") == 0);
+        status_t err = service->transact(IBinder::STATS_TRANSACTION, data, &reply);
+        if (err != NO_ERROR) {
+            aerr << "Error dumping binder stats: (" << strerror(-err)
+                    << ") " << argv[2] << endl;
+            return 20;
+        }
+        return 0;
+    }
+
     Vector<String16> services;
     Vector<String16> args;
     if (argc == 1) {
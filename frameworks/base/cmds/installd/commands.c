@@ -535,7 +535,13 @@ int dexopt(const char *apk_path, uid_t uid, int is_public)
     pid_t pid;
     pid = fork();
     if (pid == 0) {
-        /* child -- drop privileges before continuing */
+        /* child -- lower priority and drop privileges before continuing */
+        if (setpriority(PRIO_PROCESS, 0, DEXOPT_NICE) != 0) {
+            LOGW("setpriority failed during dexopt: %s\n", strerror(errno));
+        }
+        if (android_set_ioprio(0, IoSchedClass_BE, DEXOPT_IOPRIO) != 0) {
+            LOGW("ioprio failed during dexopt: %s\n", strerror(errno));
+        }
         if (setgid(uid) != 0) {
             LOGE("setgid(%d) failed during dexopt\n", uid);
             exit(64);
@@ -28,10 +28,12 @@
 #include <fcntl.h>
 #include <errno.h>
 #include <utime.h>
+#include <sys/resource.h>
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 
+#include <cutils/iosched_policy.h>
 #include <cutils/sockets.h>
 #include <cutils/log.h>
 #include <cutils/properties.h>
@@ -69,6 +71,12 @@
 
 #define UPDATE_COMMANDS_DIR_PREFIX  "/system/etc/updatecmds/"
 
+/* dexopt runs at background priority (ANDROID_PRIORITY_BACKGROUND) and
+ * the lowest best-effort I/O priority, so optimizing an app does not
+ * stall the foreground one */
+#define DEXOPT_NICE         10
+#define DEXOPT_IOPRIO       7
+
 #define PKG_NAME_MAX  128   /* largest allowed package name */
 #define PKG_PATH_MAX  256   /* max size of any path we use */
 
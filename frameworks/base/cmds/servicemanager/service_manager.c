@@ -91,20 +91,36 @@ int svc_can_register(unsigned uid, uint16_t *name)
 struct svcinfo 
 {
     struct svcinfo *next;
+    struct svcinfo *hash_next;
+    unsigned hash;
     void *ptr;
     struct binder_death death;
     unsigned len;
     uint16_t name[0];
 };
 
+/* svclist keeps registration order for SVC_MGR_LIST_SERVICES; lookups
+ * go through the hash table. */
 struct svcinfo *svclist = 0;
 
+#define SVC_HASH_SIZE 128   /* power of two */
+static struct svcinfo *svc_hash[SVC_HASH_SIZE];
+
+static unsigned svc_name_hash(uint16_t *s16, unsigned len)
+{
+    unsigned hash = 0;
+    while (len--)
+        hash = hash * 31 + *s16++;
+    return hash;
+}
+
 struct svcinfo *find_svc(uint16_t *s16, unsigned len)
 {
     struct svcinfo *si;
+    unsigned hash = svc_name_hash(s16, len);
 
-    for (si = svclist; si; si = si->next) {
-        if ((len == si->len) &&
+    for (si = svc_hash[hash & (SVC_HASH_SIZE - 1)]; si; si = si->hash_next) {
+        if ((hash == si->hash) && (len == si->len) &&
             !memcmp(s16, si->name, len * sizeof(uint16_t))) {
             return si;
         }
@@ -180,6 +196,9 @@ int do_add_service(struct binder_state *bs,
         si->death.ptr = si;
         si->next = svclist;
         svclist = si;
+        si->hash = svc_name_hash(s, len);
+        si->hash_next = svc_hash[si->hash & (SVC_HASH_SIZE - 1)];
+        svc_hash[si->hash & (SVC_HASH_SIZE - 1)] = si;
     }
 
     binder_acquire(bs, ptr);
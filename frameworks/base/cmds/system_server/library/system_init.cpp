@@ -101,6 +101,9 @@ extern "C" status_t system_init()
     env->CallStaticVoidMethod(clazz, methodId);
 
     LOGI("System server: entering thread pool.\n");
+    // Allow bursts well beyond the default of 15 threads, but let the
+    // extra loopers go once the burst is over.
+    ProcessState::self()->setThreadPoolConfiguration(2, 32, seconds(30));
     ProcessState::self()->startThreadPool();
     IPCThreadState::self()->joinThreadPool();
     LOGI("System server: exiting thread pool.\n");
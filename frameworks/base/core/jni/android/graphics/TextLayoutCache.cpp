@@ -19,6 +19,8 @@
 #include "TextLayoutCache.h"
 #include "TextLayout.h"
 
+#include <utils/KeyedVector.h>
+
 extern "C" {
   #include "harfbuzz-unicode.h"
 }
@@ -347,7 +349,7 @@ void TextLayoutCacheValue::initShaperItem(HB_ShaperItem& shaperItem, HB_FontRec*
     font->y_scale = 1;
 
     shaperItem.font = font;
-    shaperItem.face = HB_NewFace(shaperItem.font, harfbuzzSkiaGetTable);
+    shaperItem.face = acquireHBFace(shaperItem.font, SkTypeface::UniqueID(paint->getTypeface()));
 
     // Reset kerning
     shaperItem.kerning_applied = false;
@@ -379,7 +381,39 @@ void TextLayoutCacheValue::initShaperItem(HB_ShaperItem& shaperItem, HB_FontRec*
 void TextLayoutCacheValue::freeShaperItem(HB_ShaperItem& shaperItem) {
     deleteGlyphArrays(shaperItem);
     delete[] shaperItem.log_clusters;
-    HB_FreeFace(shaperItem.face);
+    FontData* fontData = reinterpret_cast<FontData*>(shaperItem.font->userData);
+    releaseHBFace(shaperItem.face, SkTypeface::UniqueID(fontData->typeFace));
+}
+
+static Mutex gHBFaceLock;
+static KeyedVector<SkFontID, HB_Face> gIdleHBFaces;
+
+HB_Face TextLayoutCacheValue::acquireHBFace(HB_FontRec* font, SkFontID fontID) {
+    {
+        AutoMutex _l(gHBFaceLock);
+        ssize_t index = gIdleHBFaces.indexOfKey(fontID);
+        if (index >= 0) {
+            HB_Face face = gIdleHBFaces.valueAt(index);
+            gIdleHBFaces.removeItemsAt(index);
+            return face;
+        }
+    }
+    return HB_NewFace(font, harfbuzzSkiaGetTable);
+}
+
+void TextLayoutCacheValue::releaseHBFace(HB_Face face, SkFontID fontID) {
+    if (face == NULL) {
+        return;
+    }
+    {
+        AutoMutex _l(gHBFaceLock);
+        if (gIdleHBFaces.indexOfKey(fontID) < 0) {
+            gIdleHBFaces.add(fontID, face);
+            return;
+        }
+    }
+    // Another thread already returned a face for this typeface
+    HB_FreeFace(face);
 }
 
 void TextLayoutCacheValue::shapeRun(HB_ShaperItem& shaperItem, size_t start, size_t count,
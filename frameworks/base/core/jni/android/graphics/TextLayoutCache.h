@@ -172,6 +172,13 @@ private:
 
     static void freeShaperItem(HB_ShaperItem& shaperItem);
 
+    /**
+     * Shaping faces are kept around per typeface instead of being built for
+     * every run. A face is owned by one shaper item at a time.
+     */
+    static HB_Face acquireHBFace(HB_FontRec* font, SkFontID fontID);
+    static void releaseHBFace(HB_Face face, SkFontID fontID);
+
     static void shapeRun(HB_ShaperItem& shaperItem, size_t start, size_t count, bool isRTL);
 
     static void deleteGlyphArrays(HB_ShaperItem& shaperItem);
@@ -30,6 +30,7 @@
 #include <string.h>
 #include <utils/Log.h>
 #include <utils/threads.h>
+#include <utils/KeyedVector.h>
 #include <utils/List.h>
 #include <utils/Errors.h>
 #include <ctype.h>
@@ -98,6 +99,87 @@ static void registerLoggingFunc(const char *path) {
     loggingFuncSet = true;
 }
 
+// Number of WAL pages after which a checkpoint is scheduled. Matches the
+// default of SQLITE_DEFAULT_WAL_AUTOCHECKPOINT.
+static const int WAL_CHECKPOINT_PAGES = 1000;
+
+// SQLite normally checkpoints the WAL from within the COMMIT that pushed it
+// past the threshold, so whichever thread commits (often the UI thread) pays
+// for copying the log back into the database. Checkpoints are handed to this
+// thread instead. It uses a connection of its own, so it never holds the
+// mutex of the connection the application is using.
+class WalCheckpointThread : public Thread {
+public:
+    WalCheckpointThread() : Thread(false) {}
+
+    void schedule(const String8& path) {
+        Mutex::Autolock _l(mLock);
+        for (List<String8>::iterator it = mPending.begin(); it != mPending.end(); ++it) {
+            if (*it == path) {
+                return;
+            }
+        }
+        mPending.push_back(path);
+        mCondition.signal();
+    }
+
+private:
+    virtual bool threadLoop() {
+        String8 path;
+        {
+            Mutex::Autolock _l(mLock);
+            while (mPending.empty()) {
+                mCondition.wait(mLock);
+            }
+            path = *mPending.begin();
+            mPending.erase(mPending.begin());
+        }
+
+        sqlite3 * handle = NULL;
+        int err = sqlite3_open_v2(path.string(), &handle, SQLITE_OPEN_READWRITE, NULL);
+        if (err == SQLITE_OK) {
+            sqlite3_busy_timeout(handle, 1000 /* ms */);
+            err = sqlite3_wal_checkpoint(handle, NULL);
+        }
+        if (err != SQLITE_OK) {
+            LOGW("background checkpoint of \"%s\" failed: %d\n", path.string(), err);
+        }
+        if (handle != NULL) sqlite3_close(handle);
+        return true;
+    }
+
+    Mutex mLock;
+    Condition mCondition;
+    List<String8> mPending;
+};
+
+static Mutex sWalLock;
+static sp<WalCheckpointThread> sWalCheckpointThread;
+static KeyedVector<sqlite3 *, String8> sWalPaths;
+
+static int walHook(void *, sqlite3 * handle, const char *dbName, int pages) {
+    if (pages < WAL_CHECKPOINT_PAGES) {
+        return SQLITE_OK;
+    }
+
+    if (strcmp(dbName, "main") == 0) {
+        Mutex::Autolock _l(sWalLock);
+        ssize_t index = sWalPaths.indexOfKey(handle);
+        if (index >= 0) {
+            if (sWalCheckpointThread == NULL) {
+                sWalCheckpointThread = new WalCheckpointThread();
+                sWalCheckpointThread->run("SQLiteCheckpoint", PRIORITY_BACKGROUND);
+            }
+            sWalCheckpointThread->schedule(sWalPaths.valueAt(index));
+            return SQLITE_OK;
+        }
+    }
+
+    // Attached databases are not tracked, checkpoint them inline as SQLite would.
+    sqlite3_wal_checkpoint(handle, dbName);
+    return SQLITE_OK;
+}
+
 /* public native void dbopen(String path, int flags, String locale); */
 static void dbopen(JNIEnv* env, jobject object, jstring pathString, jint flags)
 {
@@ -170,6 +252,14 @@ static void dbopen(JNIEnv* env, jobject object, jstring pathString, jint flags)
         goto done;
     }
 
+    // The hook only fires once the database is in WAL mode. It replaces the
+    // inline autocheckpoint with one on the background thread.
+    if (!(sqliteFlags & SQLITE_OPEN_READONLY)) {
+        Mutex::Autolock _l(sWalLock);
+        sWalPaths.add(handle, String8(path8));
+        sqlite3_wal_hook(handle, &walHook, NULL);
+    }
+
     LOGV("Opened '%s' - %p\n", path8, handle);
     env->SetIntField(object, offset_db_handle, (int) handle);
     handle = NULL;  // The caller owns the handle now.
@@ -236,6 +326,10 @@ static void dbclose(JNIEnv* env, jobject object)
         if (traceFuncArg != NULL) {
             free(traceFuncArg);
         }
+        {
+            Mutex::Autolock _l(sWalLock);
+            sWalPaths.removeItem(handle);
+        }
         LOGV("Closing database: handle=%p\n", handle);
         int result = sqlite3_close(handle);
         if (result == SQLITE_OK) {
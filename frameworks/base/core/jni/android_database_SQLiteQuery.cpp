@@ -35,6 +35,9 @@
 
 namespace android {
 
+// Number of rows filled between making them visible to readers of the window.
+static const int PUBLISH_ROWS_INTERVAL = 64;
+
 static jint nativeFillWindow(JNIEnv* env, jclass clazz, jint databasePtr,
         jint statementPtr, jint windowPtr, jint startPos, jint offsetParam) {
     sqlite3* database = reinterpret_cast<sqlite3*>(databasePtr);
@@ -68,6 +71,9 @@ static jint nativeFillWindow(JNIEnv* env, jclass clazz, jint databasePtr,
         return 0;
     }
 
+    // Held while a row is packed, see below.
+    sqlite3_mutex* databaseMutex = sqlite3_db_mutex(database);
+
     int retryCount = 0;
     int totalRows = 0;
     int addedRows = 0;
@@ -97,17 +103,22 @@ static jint nativeFillWindow(JNIEnv* env, jclass clazz, jint databasePtr,
                 continue;
             }
 
-            // Pack the row into the window.
+            // Pack the row into the window. Each sqlite3_column_*() call takes
+            // the connection mutex, and a field can take up to three of them.
+            // With the mutex held for the whole row, the column's value can be
+            // read through the sqlite3_value_*() calls, which don't lock.
+            sqlite3_mutex_enter(databaseMutex);
             for (int i = 0; i < numColumns; i++) {
-                int type = sqlite3_column_type(statement, i);
+                sqlite3_value* value = sqlite3_column_value(statement, i);
+                int type = sqlite3_value_type(value);
                 if (type == SQLITE_TEXT) {
                     // TEXT data
                     const char* text = reinterpret_cast<const char*>(
-                            sqlite3_column_text(statement, i));
+                            sqlite3_value_text(value));
                     // SQLite does not include the NULL terminator in size, but does
                     // ensure all strings are NULL terminated, so increase size by
                     // one to make sure we store the terminator.
-                    size_t sizeIncludingNull = sqlite3_column_bytes(statement, i) + 1;
+                    size_t sizeIncludingNull = sqlite3_value_bytes(value) + 1;
                     status = window->putString(addedRows, i, text, sizeIncludingNull);
                     if (status) {
                         LOG_WINDOW("Failed allocating %u bytes for text at %d,%d, error=%d",
@@ -119,30 +130,30 @@ static jint nativeFillWindow(JNIEnv* env, jclass clazz, jint databasePtr,
                             startPos + addedRows, i, sizeIncludingNull);
                 } else if (type == SQLITE_INTEGER) {
                     // INTEGER data
-                    int64_t value = sqlite3_column_int64(statement, i);
-                    status = window->putLong(addedRows, i, value);
+                    int64_t longValue = sqlite3_value_int64(value);
+                    status = window->putLong(addedRows, i, longValue);
                     if (status) {
                         LOG_WINDOW("Failed allocating space for a long in column %d, error=%d",
                                 i, status);
                         windowFull = true;
                         break;
                     }
-                    LOG_WINDOW("%d,%d is INTEGER 0x%016llx", startPos + addedRows, i, value);
+                    LOG_WINDOW("%d,%d is INTEGER 0x%016llx", startPos + addedRows, i, longValue);
                 } else if (type == SQLITE_FLOAT) {
                     // FLOAT data
-                    double value = sqlite3_column_double(statement, i);
-                    status = window->putDouble(addedRows, i, value);
+                    double doubleValue = sqlite3_value_double(value);
+                    status = window->putDouble(addedRows, i, doubleValue);
                     if (status) {
                         LOG_WINDOW("Failed allocating space for a double in column %d, error=%d",
                                 i, status);
                         windowFull = true;
                         break;
                     }
-                    LOG_WINDOW("%d,%d is FLOAT %lf", startPos + addedRows, i, value);
+                    LOG_WINDOW("%d,%d is FLOAT %lf", startPos + addedRows, i, doubleValue);
                 } else if (type == SQLITE_BLOB) {
                     // BLOB data
-                    const void* blob = sqlite3_column_blob(statement, i);
-                    size_t size = sqlite3_column_bytes(statement, i);
+                    const void* blob = sqlite3_value_blob(value);
+                    size_t size = sqlite3_value_bytes(value);
                     status = window->putBlob(addedRows, i, blob, size);
                     if (status) {
                         LOG_WINDOW("Failed allocating %u bytes for blob at %d,%d, error=%d",
@@ -171,12 +182,16 @@ static jint nativeFillWindow(JNIEnv* env, jclass clazz, jint databasePtr,
                     break;
                 }
             }
+            sqlite3_mutex_leave(databaseMutex);
 
             // Update the final row tally.
             if (windowFull || gotException) {
                 window->freeLastRow();
             } else {
                 addedRows += 1;
+                if (addedRows % PUBLISH_ROWS_INTERVAL == 0) {
+                    window->publishRows();
+                }
             }
         } else if (err == SQLITE_DONE) {
             // All rows processed, bail
@@ -203,6 +218,7 @@ static jint nativeFillWindow(JNIEnv* env, jclass clazz, jint databasePtr,
     LOG_WINDOW("Resetting statement %p after fetching %d rows and adding %d rows"
             "to the window in %d bytes",
             statement, totalRows, addedRows, window->size() - window->freeSpace());
+    window->publishRows();
     sqlite3_reset(statement);
 
     // Report the total number of rows on request.
@@ -28,11 +28,11 @@ public:
 };
 
 static JNINativeMethod gMathUtilsMethods[] = {
-    {"floor", "(F)F", (void*) MathUtilsGlue::FloorF},
-    {"ceil", "(F)F", (void*) MathUtilsGlue::CeilF},
-    {"sin", "(F)F", (void*) MathUtilsGlue::SinF},
-    {"cos", "(F)F", (void*) MathUtilsGlue::CosF},
-    {"sqrt", "(F)F", (void*) MathUtilsGlue::SqrtF}
+    {"floor", "!(F)F", (void*) MathUtilsGlue::FloorF},
+    {"ceil", "!(F)F", (void*) MathUtilsGlue::CeilF},
+    {"sin", "!(F)F", (void*) MathUtilsGlue::SinF},
+    {"cos", "!(F)F", (void*) MathUtilsGlue::CosF},
+    {"sqrt", "!(F)F", (void*) MathUtilsGlue::SqrtF}
 };
 
 int register_android_util_FloatMath(JNIEnv* env)
@@ -47,6 +47,11 @@ namespace android {
  * Note that the data types come from sqlite3.h.
  *
  * Strings are stored in UTF-8.
+ *
+ * A window can be read while it is still being filled: rows only become
+ * visible to getNumPublishedRows() once the producer calls publishRows(),
+ * and clear() bumps a generation count so readers can tell that the window
+ * has been recycled for a new range of rows.
  */
 class CursorWindow {
     CursorWindow(const String8& name, int ashmemFd,
@@ -92,6 +97,22 @@ public:
     inline uint32_t getNumRows() { return mHeader->numRows; }
     inline uint32_t getNumColumns() { return mHeader->numColumns; }
 
+    /**
+     * Makes all completely filled rows visible to concurrent readers.
+     */
+    status_t publishRows();
+
+    /**
+     * Gets the number of rows published so far; rows below this index can
+     * be read while the producer keeps filling the window.
+     */
+    uint32_t getNumPublishedRows();
+
+    /**
+     * Gets the number of times the window has been cleared for reuse.
+     */
+    uint32_t getGeneration();
+
     status_t clear();
     status_t setNumColumns(uint32_t numColumns);
 
@@ -149,6 +170,12 @@ private:
 
         uint32_t numRows;
         uint32_t numColumns;
+
+        // Number of rows readers may access; written with release semantics.
+        volatile int32_t numPublishedRows;
+
+        // Incremented by every clear().
+        volatile int32_t generation;
     };
 
     struct RowSlot {
@@ -167,6 +194,13 @@ private:
     bool mReadOnly;
     Header* mHeader;
 
+    // Last row slot chunk looked up, so sequential access doesn't walk the
+    // chunk list from the start for every row.  Only valid while the
+    // window's generation is mChunkCacheGeneration.
+    uint32_t mChunkCacheOffset;
+    uint32_t mChunkCacheFirstRow;
+    uint32_t mChunkCacheGeneration;
+
     inline void* offsetToPtr(uint32_t offset) {
         return static_cast<uint8_t*>(mData) + offset;
     }
@@ -184,6 +218,7 @@ private:
 
     RowSlot* getRowSlot(uint32_t row);
     RowSlot* allocRowSlot();
+    RowSlotChunk* findChunk(uint32_t row, uint32_t* outChunkPos);
 
     status_t putBlobOrString(uint32_t row, uint32_t column,
             const void* value, size_t size, int32_t type);
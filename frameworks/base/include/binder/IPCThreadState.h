@@ -20,6 +20,7 @@
 #include <utils/Errors.h>
 #include <binder/Parcel.h>
 #include <binder/ProcessState.h>
+#include <utils/String8.h>
 #include <utils/Vector.h>
 
 #ifdef HAVE_WIN32_PROC
@@ -62,6 +63,19 @@ public:
                                          uint32_t code, const Parcel& data,
                                          Parcel* reply, uint32_t flags);
 
+            // Queues a oneway transaction instead of sending it right away.
+            // Queued transactions are handed to the driver together, in
+            // order, by flushOnewayTransactions(), flushCommands() or the
+            // next transact() from this thread.  If coalesceKey is non-zero,
+            // a still-queued transaction with the same handle, code and key
+            // is replaced by this one, so only the newest update is sent.
+            // The data is copied; the caller may reuse it immediately.
+            status_t            queueOnewayTransaction(int32_t handle,
+                                                       uint32_t code,
+                                                       const Parcel& data,
+                                                       uint32_t coalesceKey = 0);
+            status_t            flushOnewayTransactions();
+
             void                incStrongHandle(int32_t handle);
             void                decStrongHandle(int32_t handle);
             void                incWeakHandle(int32_t handle);
@@ -81,8 +95,21 @@ public:
     // in to it but doesn't want to acquire locks in its services while in
     // the background.
     static  void                disableBackgroundScheduling(bool disable);
-    
+
+    // Transaction latency accounting.  When enabled (or when the
+    // "debug.binder.stats" property is set at startup), every thread keeps
+    // per-target, per-code latency histograms of its outgoing calls and of
+    // the incoming calls it services.  Recording is lock-free; the tables of
+    // all threads are only merged when dumped.
+    static  void                setTransactionStatsEnabled(bool enabled);
+    static  bool                isTransactionStatsEnabled();
+    static  void                dumpTransactionStats(String8& result);
+    static  void                resetTransactionStats();
+
+            class               TransactionStats;   // private to IPCThreadState.cpp
+
 private:
+
                                 IPCThreadState();
                                 ~IPCThreadState();
 
@@ -97,6 +124,14 @@ private:
                                                      const Parcel& data,
                                                      status_t* statusBuffer);
             status_t            executeCommand(int32_t command);
+            TransactionStats*   activeStats();
+
+            struct PendingOneway {
+                int32_t     handle;
+                uint32_t    code;
+                uint32_t    coalesceKey;
+                Parcel*     data;
+            };
             
             void                clearCaller();
             
@@ -110,6 +145,7 @@ private:
     const   pid_t               mMyThreadId;
             Vector<BBinder*>    mPendingStrongDerefs;
             Vector<RefBase::weakref_type*> mPendingWeakDerefs;
+            Vector<PendingOneway> mPendingOneway;
             
             Parcel              mIn;
             Parcel              mOut;
@@ -118,6 +154,7 @@ private:
             uid_t               mCallingUid;
             int32_t             mStrictModePolicy;
             int32_t             mLastTransactionBinderFlags;
+            TransactionStats*   mStats;
 };
 
 }; // namespace android
@@ -28,29 +28,48 @@ namespace android {
 // ----------------------------------------------------------------------------
 
 class SimpleBestFitAllocator;
+class SlabCache;
+class String8;
 
 // ----------------------------------------------------------------------------
 
 class MemoryDealer : public RefBase
 {
 public:
-    MemoryDealer(size_t size, const char* name = 0);
+    enum {
+        // Serve small allocations from per-size-class free lists.  Freed
+        // chunks are kept in their class and handed out again without
+        // taking the allocator lock; they only go back to the general
+        // allocator when it runs out of space.
+        SLAB_ALLOCATION = 0x00000001
+    };
+
+    MemoryDealer(size_t size, const char* name = 0, uint32_t flags = 0);
 
     virtual sp<IMemory> allocate(size_t size);
     virtual void        deallocate(size_t offset);
     virtual void        dump(const char* what) const;
 
+    // Appends the allocator state, including fragmentation and, in slab
+    // mode, the size class usage, to result.
+            void        dump(String8& result, const char* what) const;
+
     sp<IMemoryHeap> getMemoryHeap() const { return heap(); }
 
 protected:
     virtual ~MemoryDealer();
 
 private:
+    friend class Allocation;
+
     const sp<IMemoryHeap>&      heap() const;
     SimpleBestFitAllocator*     allocator() const;
 
+    void                        deallocate(size_t offset, ssize_t slabNode, size_t size);
+
     sp<IMemoryHeap>             mHeap;
     SimpleBestFitAllocator*     mAllocator;
+    SlabCache*                  mSlabs;
 };
 
 
@@ -17,6 +17,8 @@
 #ifndef ANDROID_PARCEL_H
 #define ANDROID_PARCEL_H
 
+#include <sys/uio.h>
+
 #include <cutils/native_handle.h>
 #include <utils/Errors.h>
 #include <utils/RefBase.h>
@@ -123,6 +125,13 @@ public:
     // The caller should call release() on the blob after writing its contents.
     status_t            writeBlob(size_t len, WritableBlob* outBlob);
 
+    // Writes a blob gathered from several caller-owned segments.  The
+    // segments are copied exactly once, straight into the destination
+    // (in-place for small blobs, an ashmem region otherwise), so large
+    // payloads never pass through the parcel's growable data buffer.
+    // Read it back with readBlob() using the sum of the segment lengths.
+    status_t            writeBlob(const struct iovec* segments, size_t count);
+
     status_t            writeObject(const flat_binder_object& val, bool nullMetaData);
 
     // Like Parcel.java's writeNoException().  Just writes a zero int32.
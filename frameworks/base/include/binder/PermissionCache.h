@@ -29,8 +29,9 @@ namespace android {
 /*
  * PermissionCache caches permission checks for a given uid.
  *
- * Currently the cache is not updated when there is a permission change,
- * for instance when an application is uninstalled.
+ * Both granted and denied results are cached. The cache is not updated
+ * automatically when there is a permission change, for instance when an
+ * application is uninstalled; invalidate() drops it.
  *
  * IMPORTANT: for the reason stated above, only system permissions are safe
  * to cache. This restriction may be lifted at a later time.
@@ -52,6 +53,9 @@ class PermissionCache : Singleton<PermissionCache> {
     SortedVector< String16 > mPermissionNamesPool;
     // this is our cache per say. it stores pooled names.
     SortedVector< Entry > mCache;
+    // lookups answered from / missing in mCache, since startup
+    mutable uint32_t mHits;
+    mutable uint32_t mMisses;
 
     // free the whole cache, but keep the permission name pool
     void purge();
@@ -71,6 +75,11 @@ public:
 
     static bool checkPermission(const String16& permission,
             pid_t pid, uid_t uid);
+
+    // drop all cached results, for instance after a permission change
+    static void invalidate();
+
+    static void getStatistics(uint32_t* outHits, uint32_t* outMisses);
 };
 
 // ---------------------------------------------------------------------------
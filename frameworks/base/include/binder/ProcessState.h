@@ -69,7 +69,19 @@ public:
             void                setArgV0(const char* txt);
 
             void                spawnPooledThread(bool isMain);
-            
+
+            // Thread pool policy.  startThreadPool() brings up minThreads
+            // looper threads that stay for the life of the process; beyond
+            // those the driver spawns threads on demand, up to maxThreads
+            // in total.  On-demand threads that have found no work for
+            // idleTimeout are retired (0 disables retirement).  Must be
+            // called before startThreadPool() to affect the initial threads.
+            status_t            setThreadPoolConfiguration(size_t minThreads,
+                                                           size_t maxThreads,
+                                                           nsecs_t idleTimeout);
+            size_t              getThreadPoolThreadCount() const;
+            size_t              getThreadPoolBusyThreadCount() const;
+
 private:
     friend class IPCThreadState;
     
@@ -86,6 +98,9 @@ private:
             
             handle_entry*       lookupHandleLocked(int32_t handle);
 
+            status_t            updateDriverMaxThreadsLocked();
+            bool                retirePooledThread();
+
             int                 mDriverFD;
             void*               mVMStart;
             
@@ -104,6 +119,16 @@ private:
             String8             mRootDir;
             bool                mThreadPoolStarted;
     volatile int32_t            mThreadPoolSeq;
+
+            size_t              mMinThreads;
+            size_t              mMaxThreads;
+            nsecs_t             mIdleTimeout;
+            // The driver never forgets the threads it asked for, so the
+            // maximum handed to it is raised by one for every retired
+            // thread to keep the effective ceiling at mMaxThreads.
+            size_t              mRetiredThreads;
+    volatile int32_t            mPooledThreads;     // threads in the pool
+    volatile int32_t            mBusyThreads;       // threads executing a transaction
 };
     
 }; // namespace android
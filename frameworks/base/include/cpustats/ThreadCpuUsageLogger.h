@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2011 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _THREAD_CPU_USAGE_LOGGER_H
+#define _THREAD_CPU_USAGE_LOGGER_H
+
+#include <cpustats/ThreadCpuUsage.h>
+
+// Periodically logs the CPU usage of a cyclic thread.  Construct it on the
+// thread to be measured, and call sample() once at the start of each cycle.
+// Every interval seconds of wall clock time, the CPU time per cycle (mean,
+// stddev, min and max) and its share of the wall time per cycle are logged,
+// tagged with the given name, and the statistics are reset.
+// Like ThreadCpuUsage, this class may only be used by the thread which
+// constructed the object.
+
+class ThreadCpuUsageLogger
+{
+
+public:
+    ThreadCpuUsageLogger(const char *name, unsigned interval) :
+        mName(name),
+        mIntervalNs(interval * 1000000000LL)
+        // mCpu
+        { }
+
+    ~ThreadCpuUsageLogger() { }
+
+    // Add a sample for the previous cycle, and log the statistics if the
+    // interval has elapsed.
+    void sample();
+
+    // Return the underlying statistics.
+    const ThreadCpuUsage& cpu() const { return mCpu; }
+
+private:
+    const char *mName;      // logged with each report
+    long long mIntervalNs;  // wall clock ns between reports
+    ThreadCpuUsage mCpu;
+};
+
+#endif //  _THREAD_CPU_USAGE_LOGGER_H
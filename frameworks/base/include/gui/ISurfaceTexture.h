@@ -79,10 +79,14 @@ protected:
     // must be monotonically increasing. Its other properties (zero point, etc)
     // are client-dependent, and should be documented by the client.
     //
+    // dirty is the area of the buffer, in buffer coordinates, that differs
+    // from the previously queued buffer. An invalid rectangle means that the
+    // whole buffer may have changed.
+    //
     // outWidth, outHeight and outTransform are filled with the default width
     // and height of the window and current transform applied to buffers,
     // respectively.
-    virtual status_t queueBuffer(int slot, int64_t timestamp,
+    virtual status_t queueBuffer(int slot, int64_t timestamp, const Rect& dirty,
             uint32_t* outWidth, uint32_t* outHeight, uint32_t* outTransform) = 0;
 
     // cancelBuffer indicates that the client does not wish to fill in the
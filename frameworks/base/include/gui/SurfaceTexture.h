@@ -62,8 +62,11 @@ public:
 
     // tex indicates the name OpenGL texture to which images are to be streamed.
     // This texture name cannot be changed once the SurfaceTexture is created.
+    // Buffers are allocated through allocator, or through a new allocator
+    // from SurfaceFlinger if it is NULL.
     SurfaceTexture(GLuint tex, bool allowSynchronousMode = true,
-            GLenum texTarget = GL_TEXTURE_EXTERNAL_OES);
+            GLenum texTarget = GL_TEXTURE_EXTERNAL_OES,
+            const sp<IGraphicBufferAlloc>& allocator = NULL);
 
     virtual ~SurfaceTexture();
 
@@ -87,7 +90,7 @@ public:
     // nanoseconds, and must be monotonically increasing. Its other semantics
     // (zero point, etc) are client-dependent and should be documented by the
     // client.
-    virtual status_t queueBuffer(int buf, int64_t timestamp,
+    virtual status_t queueBuffer(int buf, int64_t timestamp, const Rect& dirty,
             uint32_t* outWidth, uint32_t* outHeight, uint32_t* outTransform);
     virtual void cancelBuffer(int buf);
     virtual status_t setCrop(const Rect& reg);
@@ -188,6 +191,10 @@ public:
     // getCurrentCrop returns the cropping rectangle of the current buffer
     Rect getCurrentCrop() const;
 
+    // getCurrentDirty returns the area of the current buffer that changed
+    // since the previous one, or an invalid rectangle if all of it may have
+    Rect getCurrentDirty() const;
+
     // getCurrentTransform returns the transform of the current buffer
     uint32_t getCurrentTransform() const;
 
@@ -263,8 +270,10 @@ private:
               mRequestBufferCalled(false),
               mTransform(0),
               mScalingMode(NATIVE_WINDOW_SCALING_MODE_FREEZE),
-              mTimestamp(0) {
+              mTimestamp(0),
+              mFrameNumber(0) {
             mCrop.makeInvalid();
+            mDirty.makeInvalid();
         }
 
         // mGraphicBuffer points to the buffer allocated for this slot or is NULL
@@ -332,6 +341,15 @@ private:
         // mTimestamp is the current timestamp for this buffer slot. This gets
         // to set by queueBuffer each time this slot is queued.
         int64_t mTimestamp;
+
+        // mDirty is the damage rectangle given to queueBuffer for this slot,
+        // grown to cover any frame that got dropped in its favor.
+        Rect mDirty;
+
+        // mFrameNumber is the number of the frame this slot's buffer was last
+        // queued with, or 0 if the buffer holds no frame (e.g. it was just
+        // allocated).  It is used to compute the age of dequeued buffers.
+        uint64_t mFrameNumber;
     };
 
     // mSlots is the array of buffer slots that must be mirrored on the client
@@ -366,6 +384,14 @@ private:
     // mServerBufferCount buffer count requested by the server-side
     int mServerBufferCount;
 
+    // mFrameCounter is the number of the last frame queued.  It gets
+    // incremented each time queueBuffer is called.
+    uint64_t mFrameCounter;
+
+    // mBufferAge is the age, in frames, of the contents of the buffer most
+    // recently returned by dequeueBuffer; see NATIVE_WINDOW_BUFFER_AGE.
+    int mBufferAge;
+
     // mCurrentTexture is the buffer slot index of the buffer that is currently
     // bound to the OpenGL texture. It is initialized to INVALID_BUFFER_SLOT,
     // indicating that no buffer slot is currently bound to the texture. Note,
@@ -383,6 +409,10 @@ private:
     // It gets set each time updateTexImage is called.
     Rect mCurrentCrop;
 
+    // mCurrentDirty is the damage rectangle of the current texture. It gets
+    // set each time updateTexImage is called.
+    Rect mCurrentDirty;
+
     // mCurrentTransform is the transform identifier for the current texture. It
     // gets set each time updateTexImage is called.
     uint32_t mCurrentTransform;
@@ -147,6 +147,10 @@ private:
     // window. this is only a hint, actual transform may differ.
     uint32_t mTransformHint;
 
+    // mDirtyRect is the damage passed along with the next queued buffer. It
+    // is set by lock() and is otherwise invalid, meaning the whole buffer.
+    Rect mDirtyRect;
+
     // mMutex is the mutex used to prevent concurrent access to the member
     // variables of SurfaceTexture objects. It must be locked whenever the
     // member variables are accessed.
@@ -132,7 +132,9 @@ public:
      * channelMask:        Channel mask: see audio_channels_t.
      * frameCount:         Total size of track PCM buffer in frames. This defines the
      *                     latency of the track.
-     * flags:              Reserved for future use.
+     * flags:              audio_policy_output_flags_t. AUDIO_POLICY_OUTPUT_FLAG_FAST
+     *                     requests a low latency track: frameCount can then be 0 and
+     *                     the buffer is sized by AudioFlinger.
      * cbf:                Callback function. If not null, this function is called periodically
      *                     to request new PCM data.
      * notificationFrames: The callback function is called each time notificationFrames PCM
@@ -36,8 +36,12 @@ public:
         SEEK_COMPLETE
     };
 
+    // If allowOffload is true the source can output MPEG audio, which is
+    // then decoded by the audio hardware. start() fails if the audio sink
+    // does not accept it.
     AudioPlayer(const sp<MediaPlayerBase::AudioSink> &audioSink,
-                AwesomePlayer *audioObserver = NULL);
+                AwesomePlayer *audioObserver = NULL,
+                bool allowOffload = false);
 
     virtual ~AudioPlayer();
 
@@ -64,6 +68,8 @@ public:
     bool isSeeking();
     bool reachedEOS(status_t *finalStatus);
 
+    bool isOffloaded() const { return mOffload; }
+
 private:
     friend class VideoEditorAudioPlayer;
     sp<MediaSource> mSource;
@@ -82,12 +88,22 @@ private:
     int64_t mPositionTimeRealUs;
 
     bool mSeeking;
+    bool mNotifySeek;
     bool mReachedEOS;
     status_t mFinalStatus;
     int64_t mSeekTimeUs;
 
     bool mStarted;
 
+    // in offload mode mNumFramesPlayed counts the decoded frames of the
+    // compressed data written to the sink, which has taken
+    // mNumBytesPlayed bytes
+    bool mAllowOffload;
+    bool mOffload;
+    bool mPaused;
+    int64_t mNumBytesPlayed;
+    int64_t mPauseTimeUs;
+
     bool mIsFirstBuffer;
     status_t mFirstBufferResult;
     MediaBuffer *mFirstBuffer;
@@ -110,6 +126,9 @@ private:
 
     uint32_t getNumFramesPendingPlayout() const;
 
+    void seekTo_l(int64_t time_us, bool notify);
+    void flushOffload_l();
+
     AudioPlayer(const AudioPlayer &);
     AudioPlayer &operator=(const AudioPlayer &);
 };
@@ -64,8 +64,10 @@ protected:
 
 private:
     class Track;
+    class FileWriter;
 
     int  mFd;
+    FileWriter *mFileWriter;
     status_t mInitCheck;
     bool mUse4ByteNalLength;
     bool mUse32BitOffset;
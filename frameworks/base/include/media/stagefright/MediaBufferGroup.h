@@ -27,16 +27,33 @@ namespace android {
 class MediaBuffer;
 class MetaData;
 
+// Buffers are recycled through lock-free free lists, one per buffer size.
+// Returning a buffer only takes the lock if a thread is waiting for one.
 class MediaBufferGroup : public MediaBufferObserver {
 public:
     MediaBufferGroup();
     ~MediaBufferGroup();
 
+    // Buffers must be added before they are first acquired, at most
+    // kMaxBuffers of them.
     void add_buffer(MediaBuffer *buffer);
 
     // Blocks until a buffer is available and returns it to the caller,
     // the returned buffer will have a reference count of 1.
-    status_t acquire_buffer(MediaBuffer **buffer);
+    // If minSize is not 0 the smallest available buffer of at least that
+    // many bytes is returned, ERROR_BUFFER_TOO_SMALL if there are none
+    // in the group.
+    status_t acquire_buffer(MediaBuffer **buffer, size_t minSize = 0);
+
+    // Number of buffers acquired so far, how many of the acquisitions had
+    // to wait for a buffer to be returned and how long they waited.
+    void getStats(
+            uint32_t *acquireCount, uint32_t *waitCount,
+            int64_t *waitTimeUs);
+
+    enum {
+        kMaxBuffers = 64,
+    };
 
 protected:
     virtual void signalBufferReturned(MediaBuffer *buffer);
@@ -44,10 +61,40 @@ protected:
 private:
     friend class MediaBuffer;
 
+    enum {
+        kMaxSizeClasses = 8,
+    };
+
+    // The head of a free list holds the index + 1 of the first free
+    // buffer (0 if there is none) in its low bits, and a tag bumped by
+    // every change in the others so that a stale head never compares
+    // equal to the current one.
+    struct SizeClass {
+        size_t mSize;
+        volatile int32_t mFreeHead;
+    };
+
     Mutex mLock;
     Condition mCondition;
 
-    MediaBuffer *mFirstBuffer, *mLastBuffer;
+    MediaBuffer *mBuffers[kMaxBuffers];
+    int32_t mBufferClass[kMaxBuffers];
+    volatile int32_t mNextFree[kMaxBuffers];
+    int32_t mBufferCount;
+
+    // Size classes are sorted by increasing size.
+    SizeClass mClasses[kMaxSizeClasses];
+    int32_t mClassCount;
+
+    volatile int32_t mWaiterCount;
+
+    volatile int32_t mAcquireCount;
+    uint32_t mWaitCount;
+    int64_t mWaitTimeUs;
+
+    int32_t popFree(int32_t sizeClass);
+    void pushFree(int32_t index);
+    MediaBuffer *acquireFree(size_t minSize);
 
     MediaBufferGroup(const MediaBufferGroup &);
     MediaBufferGroup &operator=(const MediaBufferGroup &);
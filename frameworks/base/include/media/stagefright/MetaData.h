@@ -123,6 +123,10 @@ enum {
     kKeyTextFormatData    = 'text',  // raw data
 
     kKeyRequiresSecureBuffers = 'secu',  // bool (int32_t)
+
+    // Set by software decoders that write their frames into buffers of
+    // the native window they were given.
+    kKeyRendersToNativeWindow = 'natw',  // bool (int32_t)
 };
 
 enum {
@@ -19,9 +19,12 @@
 #define STAGEFRIGHT_MEDIA_SCANNER_H_
 
 #include <media/mediascanner.h>
+#include <utils/RefBase.h>
 
 namespace android {
 
+class MediaMetadataRetriever;
+
 struct StagefrightMediaScanner : public MediaScanner {
     StagefrightMediaScanner();
     virtual ~StagefrightMediaScanner();
@@ -36,9 +39,15 @@ private:
     StagefrightMediaScanner(const StagefrightMediaScanner &);
     StagefrightMediaScanner &operator=(const StagefrightMediaScanner &);
 
+    // One retriever serves all the files of a scan, each new one would
+    // be another round trip to the media server.
+    sp<MediaMetadataRetriever> mRetriever;
+
     MediaScanResult processFileInternal(
             const char *path, const char *mimeType,
             MediaScannerClient &client);
+
+    sp<MediaMetadataRetriever> getRetriever();
 };
 
 }  // namespace android
@@ -105,6 +105,16 @@ public:
             int32_t destStartX, int32_t destStartY,
             const YUVImage &srcImage, YUVImage &destImage);
 
+    // Fills destImage with every skipX-th pixel of every skipY-th row of
+    // srcImage, starting at (srcOffsetX, srcOffsetY), working a plane at a
+    // time instead of a pixel at a time. The result is the same as setting
+    // each destination pixel from its source pixel in raster order.
+    // Returns false if the formats differ or destImage has odd dimensions.
+    static bool fastDownsample(
+            int32_t srcOffsetX, int32_t srcOffsetY,
+            int32_t skipX, int32_t skipY,
+            const YUVImage &srcImage, YUVImage &destImage);
+
     // Convert the given YUV value to RGB.
     void yuv2rgb(uint8_t yValue, uint8_t uValue, uint8_t vValue,
         uint8_t *r, uint8_t *g, uint8_t *b) const;
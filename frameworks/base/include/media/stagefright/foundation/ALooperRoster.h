@@ -55,7 +55,7 @@ private:
 
     KeyedVector<uint32_t, sp<AMessage> > mReplies;
 
-    status_t postMessage_l(const sp<AMessage> &msg, int64_t delayUs);
+    sp<ALooper> findTargetLooper_l(const sp<AMessage> &msg);
 
     DISALLOW_EVIL_CONSTRUCTORS(ALooperRoster);
 };
@@ -54,6 +54,14 @@ namespace android {
 #define CBLK_RESTORED_ON        0x0040  // track has been restored after invalidation
 #define CBLK_RESTORED_OFF       0x0040  // by AudioFlinger
 
+// The client and the server exchange frames through a single producer single consumer ring:
+// user and server are only written by their owner and published with release semantics, so
+// that neither side needs the lock to step. The lock only protects the loop, which both
+// sides modify, and the restoration of an invalidated track.
+//
+// A client waiting for the server to step blocks in waitForStep_l() on the steps futex,
+// which the server increments for each step; the server only makes the wake system call
+// if a client is actually waiting.
 struct audio_track_cblk_t
 {
 
@@ -90,6 +98,9 @@ struct audio_track_cblk_t
 
                 // Cache line boundary (32 bytes)
 
+    volatile    int32_t     steps;           // futex, incremented by signalStep()
+    volatile    int32_t     waiters;         // number of threads in waitForStep_l()
+
                             audio_track_cblk_t();
                 uint32_t    stepUser(uint32_t frameCount);
                 bool        stepServer(uint32_t frameCount);
@@ -98,6 +109,13 @@ struct audio_track_cblk_t
                 uint32_t    framesAvailable_l();
                 uint32_t    framesReady();
                 bool        tryLock();
+
+                // wakes up the threads waiting in waitForStep_l()
+                void        signalStep();
+                // must be called with the lock held, which is released while waiting.
+                // step is the value of steps read before the condition was checked.
+                // Returns TIMED_OUT if nothing happened for waitTimeMs.
+                status_t    waitForStep_l(int32_t step, uint32_t waitTimeMs);
 };
 
 
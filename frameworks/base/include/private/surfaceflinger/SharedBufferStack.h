@@ -38,7 +38,12 @@ struct display_cblk_t
     float       density;
     float       xdpi;
     float       ydpi;
-    uint32_t    pad[2];
+    // lastVSyncTime is written by SurfaceFlinger while vsyncSequence is
+    // odd; readers retry until they see the same even value on both sides.
+    int32_t     vsyncSequence;
+    uint32_t    pad;
+    int64_t     lastVSyncTime;  // systemTime() of a recent vsync
+    int64_t     vsyncPeriod;    // in nanoseconds
 };
 
 struct surface_flinger_cblk_t   // 4KB max
@@ -132,6 +132,12 @@ public:
     static ssize_t getDisplayHeight(DisplayID dpy);
     static ssize_t getDisplayOrientation(DisplayID dpy);
 
+    // Returns the time of a recent vsync of the display and its refresh
+    // period, so rendering can be aligned with the composition. The time
+    // is 0 until SurfaceFlinger has seen a vsync.
+    static status_t getVSyncTiming(DisplayID dpy,
+            nsecs_t* lastVSyncTime, nsecs_t* period);
+
     status_t linkToComposerDeath(const sp<IBinder::DeathRecipient>& recipient,
             void* cookie = NULL, uint32_t flags = 0);
 
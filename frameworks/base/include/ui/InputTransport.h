@@ -110,6 +110,10 @@ struct InputMessage {
      */
     bool consumed;
 
+    /* Set by the consumer to the time when it consumed the message, for latency tracking.
+     */
+    nsecs_t consumeTime;
+
     int32_t type;
 
     struct SampleData {
@@ -260,6 +264,13 @@ public:
      */
     status_t receiveFinishedSignal(bool* outHandled);
 
+    /* Gets the time when the consumer consumed the current event.
+     * Must be called before the publisher is reset.
+     *
+     * Returns -1 if the event has not been consumed.
+     */
+    nsecs_t getConsumeTime() const;
+
 private:
     sp<InputChannel> mChannel;
 
@@ -301,11 +312,21 @@ public:
      * an InputEvent object created using the specified factory.
      * This operation will block if the publisher is updating the event.
      *
+     * Move samples that the publisher appended while the event was pending are
+     * all delivered together as the history of a single motion event.
+     *
+     * If frameTime is non-negative, a pointer move event is also resampled for
+     * the frame that will be drawn at that time: a sample predicted from the
+     * pointer velocities is appended to the event, so the latest position
+     * reflects where the pointer is expected to be rather than where it was
+     * when the last sample was taken.
+     *
      * Returns OK on success.
      * Returns INVALID_OPERATION if there is no currently published event.
      * Returns NO_MEMORY if the event could not be created.
      */
-    status_t consume(InputEventFactoryInterface* factory, InputEvent** outEvent);
+    status_t consume(InputEventFactoryInterface* factory, InputEvent** outEvent,
+            nsecs_t frameTime = -1);
 
     /* Sends a finished signal to the publisher to inform it that the current message is
      * finished processing and specifies whether the message was handled by the consumer.
@@ -329,8 +350,12 @@ private:
     size_t mAshmemSize;
     InputMessage* mSharedMessage;
 
+    // Tracks the velocity of the pointers seen so far, for resampling.
+    VelocityTracker mVelocityTracker;
+
     void populateKeyEvent(KeyEvent* keyEvent) const;
     void populateMotionEvent(MotionEvent* motionEvent) const;
+    void resampleMotionEvent(MotionEvent* motionEvent, nsecs_t frameTime) const;
 };
 
 } // namespace android
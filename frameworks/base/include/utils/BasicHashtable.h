@@ -0,0 +1,299 @@
+/*
+ * Copyright (C) 2011 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_BASIC_HASHTABLE_H
+#define ANDROID_BASIC_HASHTABLE_H
+
+#include <stdint.h>
+#include <sys/types.h>
+#include <utils/SharedBuffer.h>
+#include <utils/TypeHelpers.h>
+
+// ---------------------------------------------------------------------------
+// No user serviceable parts in here...
+// ---------------------------------------------------------------------------
+
+namespace android {
+
+/*!
+ * Implementation of the guts of the BasicHashtable<> class, shared by all
+ * instantiations to keep code size down.
+ *
+ * The table uses open addressing with linear probing over a power-of-two
+ * array of buckets, so a lookup touches consecutive memory instead of
+ * chasing pointers.  Each bucket starts with a cookie holding the entry's
+ * hash and its state (empty, present or deleted); removed entries leave a
+ * tombstone until the next rehash so probe sequences stay intact.
+ *
+ * Buckets live in a SharedBuffer and are copy-on-write, like VectorImpl.
+ */
+class BasicHashtableImpl {
+public:
+    struct Bucket {
+        // The top bits encode the bucket state, the rest holds the
+        // (trimmed) hash of the entry so most mismatches are rejected
+        // without comparing keys.
+        enum {
+            PRESENT = 0x80000000,
+            DELETED = 0x40000000,
+            HASH_MASK = ~(PRESENT | DELETED)
+        };
+        uint32_t cookie;
+        // The entry follows, at mEntryOffset from the start of the bucket.
+    };
+
+    inline  size_t          size() const { return mSize; }
+    inline  bool            isEmpty() const { return mSize == 0; }
+    inline  size_t          capacity() const { return mCapacity; }
+    inline  size_t          bucketCount() const { return mBucketCount; }
+    inline  float           loadFactor() const { return mLoadFactor; }
+
+            void            dispose();
+
+protected:
+    enum {
+        HAS_TRIVIAL_COPY    = 0x00000001,
+        HAS_TRIVIAL_DTOR    = 0x00000002,
+    };
+
+                            BasicHashtableImpl(size_t entrySize, size_t entryAlignment,
+                                    uint32_t flags, size_t minimumInitialCapacity,
+                                    float loadFactor);
+                            BasicHashtableImpl(const BasicHashtableImpl& other);
+    virtual                 ~BasicHashtableImpl();
+
+            void            edit();
+            void            setTo(const BasicHashtableImpl& other);
+            void            clear();
+
+            ssize_t         next(ssize_t index) const;
+            ssize_t         find(ssize_t index, hash_t hash, const void* __restrict__ key) const;
+            size_t          add(hash_t hash, const void* __restrict__ entry);
+            void            removeAt(size_t index);
+            void            rehash(size_t minimumCapacity, float loadFactor);
+
+    inline  const Bucket&   bucketAt(const void* __restrict__ buckets, size_t index) const {
+        return *reinterpret_cast<const Bucket*>(
+                static_cast<const uint8_t*>(buckets) + index * mBucketSize);
+    }
+    inline  Bucket&         bucketAt(void* __restrict__ buckets, size_t index) const {
+        return *reinterpret_cast<Bucket*>(static_cast<uint8_t*>(buckets) + index * mBucketSize);
+    }
+    inline  const void*     entryLocation(const Bucket& bucket) const {
+        return reinterpret_cast<const uint8_t*>(&bucket) + mEntryOffset;
+    }
+    inline  void*           entryLocation(Bucket& bucket) const {
+        return reinterpret_cast<uint8_t*>(&bucket) + mEntryOffset;
+    }
+
+    virtual bool            compareBucketKey(const Bucket& bucket, const void* __restrict__ key) const = 0;
+    virtual void            initializeBucketEntry(Bucket& bucket, const void* __restrict__ entry) const = 0;
+    virtual void            destroyBucketEntry(Bucket& bucket) const = 0;
+
+            const size_t    mEntryOffset;
+            const size_t    mBucketSize;
+            const uint32_t  mFlags;
+            void*           mBuckets;       // data of a SharedBuffer
+            size_t          mSize;          // present entries
+            size_t          mFilledBuckets; // present + deleted
+            size_t          mCapacity;      // entries before the next rehash
+            size_t          mBucketCount;   // always a power of two
+            float           mLoadFactor;
+
+private:
+            void            clone();
+            void*           allocateBuckets(size_t count) const;
+            void            releaseBuckets(void* __restrict__ buckets, size_t size) const;
+            void            destroyBuckets(void* __restrict__ buckets, size_t size) const;
+            void            copyBuckets(const void* __restrict__ fromBuckets,
+                                    void* __restrict__ toBuckets, size_t count) const;
+
+    static  void            determineCapacity(size_t minimumCapacity, float loadFactor,
+                                    size_t* __restrict__ outBucketCount,
+                                    size_t* __restrict__ outCapacity);
+
+    inline  size_t          chainStart(hash_t hash) const {
+        return hash & (mBucketCount - 1);
+    }
+    inline  size_t          chainIncrement(size_t index) const {
+        return (index + 1) & (mBucketCount - 1);
+    }
+    static inline uint32_t  trimHash(hash_t hash) {
+        // Spread weak hashes (sequential integers, aligned pointers) over
+        // the low bits used to pick the bucket.
+        hash ^= hash >> 16;
+        hash *= 0x85ebca6b;
+        hash ^= hash >> 13;
+        return hash & Bucket::HASH_MASK;
+    }
+};
+
+/*
+ * A BasicHashtable stores entries that are indexed by hash code in place
+ * within an array.  The basic operations are O(1) on average; the tradeoff
+ * against KeyedVector/SortedVector is the loss of key ordering.
+ *
+ * TKey must have a hash_type() function declared in the android namespace
+ * (see TypeHelpers.h) and an == operator.
+ *
+ * TEntry must provide a getKey() method returning the key of the entry.
+ *
+ * Entries are copied and destroyed with the TypeHelpers traits, so
+ * trivially copyable entries are moved around with memcpy.
+ *
+ * An index is a position within the bucket array.  It stays valid as long
+ * as the table is not modified; indices are not contiguous and must be
+ * enumerated with next().
+ */
+template <typename TKey, typename TEntry>
+class BasicHashtable : private BasicHashtableImpl {
+public:
+    /* Creates a hashtable with the specified minimum initial capacity.
+     * The underlying array will be created when the first entry is added.
+     *
+     * minimumInitialCapacity is the minimum number of entries the table
+     * can hold without rehashing; loadFactor is the fraction of buckets
+     * that may be filled, between 0.1 and 0.9.
+     */
+    explicit inline BasicHashtable(size_t minimumInitialCapacity = 0,
+            float loadFactor = 0.75f);
+
+    inline BasicHashtable(const BasicHashtable<TKey, TEntry>& other);
+
+    virtual ~BasicHashtable();
+
+    inline BasicHashtable<TKey, TEntry>& operator =(const BasicHashtable<TKey, TEntry>& other) {
+        setTo(other);
+        return *this;
+    }
+
+    inline size_t size() const { return mSize; }
+    inline bool isEmpty() const { return mSize == 0; }
+    inline size_t capacity() const { return mCapacity; }
+    inline size_t bucketCount() const { return mBucketCount; }
+    inline float loadFactor() const { return mLoadFactor; }
+
+    /* Returns a reference to the entry at the specified index. */
+    inline const TEntry& entryAt(size_t index) const {
+        return entryFor(bucketAt(mBuckets, index));
+    }
+
+    /* Returns a writable reference to the entry at the specified index.
+     * The key of the entry must not be changed.
+     */
+    inline TEntry& editEntryAt(size_t index) {
+        edit();
+        return entryFor(bucketAt(mBuckets, index));
+    }
+
+    /* Clears the table, destroying all entries. */
+    inline void clear() {
+        BasicHashtableImpl::clear();
+    }
+
+    /* Returns the index of the next entry after the given index, or -1.
+     * Start with -1.
+     */
+    inline ssize_t next(ssize_t index) const {
+        return BasicHashtableImpl::next(index);
+    }
+
+    /* Finds the index of an entry with the given key and hash, starting
+     * after the given index (-1 for the first match).  Returns -1 when not
+     * found.
+     */
+    inline ssize_t find(ssize_t index, hash_t hash, const TKey& key) const {
+        return BasicHashtableImpl::find(index, hash, &key);
+    }
+
+    /* Adds an entry, without checking whether one with the same key is
+     * already present.  Returns the index of the entry; previously
+     * returned indices may no longer be valid.
+     */
+    inline size_t add(hash_t hash, const TEntry& entry) {
+        return BasicHashtableImpl::add(hash, &entry);
+    }
+
+    /* Removes the entry at the specified index. */
+    inline void removeAt(size_t index) {
+        BasicHashtableImpl::removeAt(index);
+    }
+
+    /* Rehashes so that the table can hold at least minimumCapacity entries
+     * at the given load factor; also drops accumulated tombstones.
+     */
+    inline void rehash(size_t minimumCapacity, float loadFactor) {
+        BasicHashtableImpl::rehash(minimumCapacity, loadFactor);
+    }
+
+protected:
+    inline const TEntry& entryFor(const Bucket& bucket) const {
+        return *static_cast<const TEntry*>(entryLocation(bucket));
+    }
+
+    inline TEntry& entryFor(Bucket& bucket) const {
+        return *static_cast<TEntry*>(entryLocation(bucket));
+    }
+
+    virtual bool compareBucketKey(const Bucket& bucket, const void* __restrict__ key) const;
+    virtual void initializeBucketEntry(Bucket& bucket, const void* __restrict__ entry) const;
+    virtual void destroyBucketEntry(Bucket& bucket) const;
+};
+
+template <typename TKey, typename TEntry>
+BasicHashtable<TKey, TEntry>::BasicHashtable(size_t minimumInitialCapacity, float loadFactor) :
+        BasicHashtableImpl(sizeof(TEntry), __alignof__(TEntry),
+                (traits<TEntry>::has_trivial_copy ? HAS_TRIVIAL_COPY : 0)
+                | (traits<TEntry>::has_trivial_dtor ? HAS_TRIVIAL_DTOR : 0),
+                minimumInitialCapacity, loadFactor) {
+}
+
+template <typename TKey, typename TEntry>
+BasicHashtable<TKey, TEntry>::BasicHashtable(const BasicHashtable<TKey, TEntry>& other) :
+        BasicHashtableImpl(other) {
+}
+
+template <typename TKey, typename TEntry>
+BasicHashtable<TKey, TEntry>::~BasicHashtable() {
+    dispose();
+}
+
+template <typename TKey, typename TEntry>
+bool BasicHashtable<TKey, TEntry>::compareBucketKey(const Bucket& bucket,
+        const void* __restrict__ key) const {
+    return entryFor(bucket).getKey() == *static_cast<const TKey*>(key);
+}
+
+template <typename TKey, typename TEntry>
+void BasicHashtable<TKey, TEntry>::initializeBucketEntry(Bucket& bucket,
+        const void* __restrict__ entry) const {
+    if (!traits<TEntry>::has_trivial_copy) {
+        new (&entryFor(bucket)) TEntry(*(static_cast<const TEntry*>(entry)));
+    } else {
+        memcpy(&entryFor(bucket), entry, sizeof(TEntry));
+    }
+}
+
+template <typename TKey, typename TEntry>
+void BasicHashtable<TKey, TEntry>::destroyBucketEntry(Bucket& bucket) const {
+    if (!traits<TEntry>::has_trivial_dtor) {
+        entryFor(bucket).~TEntry();
+    }
+}
+
+}; // namespace android
+
+#endif // ANDROID_BASIC_HASHTABLE_H
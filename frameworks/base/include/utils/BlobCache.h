@@ -19,6 +19,7 @@
 
 #include <stddef.h>
 
+#include <utils/Flattenable.h>
 #include <utils/RefBase.h>
 #include <utils/SortedVector.h>
 #include <utils/threads.h>
@@ -31,7 +32,9 @@ namespace android {
 // The cache contents can be serialized to a file and reloaded in a subsequent
 // execution of the program. This serialization is non-portable and should only
 // be loaded by the device that generated it.
-class BlobCache : public RefBase {
+//
+// When the cache is full, the least recently used entries are evicted first.
+class BlobCache : public RefBase, public Flattenable {
 public:
 
     // Create an empty blob cache. The blob cache will cache key/value pairs
@@ -77,15 +80,43 @@ public:
     //   0 <= valueSize
     size_t get(const void* key, size_t keySize, void* value, size_t valueSize);
 
+    // getFlattenedSize returns the number of bytes needed to store the entire
+    // serialized cache.
+    virtual size_t getFlattenedSize() const;
+
+    // getFdCount returns the number of file descriptors that will result from
+    // flattening the cache.  This will always return 0 so as to allow the
+    // flattened cache to be saved to disk and then later restored.
+    virtual size_t getFdCount() const;
+
+    // flatten serializes the current contents of the cache into the memory
+    // pointed to by 'buffer'.  The serialized cache contents can later be
+    // loaded into a BlobCache object using the unflatten method.  The contents
+    // of the BlobCache object will not be modified.
+    //
+    // Preconditions:
+    //   size >= this.getFlattenedSize()
+    //   count == 0
+    virtual status_t flatten(void* buffer, size_t size, int fds[],
+            size_t count) const;
+
+    // unflatten replaces the contents of the cache with the serialized cache
+    // contents in the memory pointed to by 'buffer'.  The previous contents of
+    // the BlobCache will be evicted from the cache.  If an error occurs while
+    // unflattening the serialized cache contents then the BlobCache will be
+    // left in an empty state.
+    //
+    // Preconditions:
+    //   count == 0
+    virtual status_t unflatten(void const* buffer, size_t size, int fds[],
+            size_t count);
+
 private:
     // Copying is disallowed.
     BlobCache(const BlobCache&);
     void operator=(const BlobCache&);
 
-    // A random function helper to get around MinGW not having nrand48()
-    long int blob_random();
-
-    // clean evicts a randomly chosen set of entries from the cache such that
+    // clean evicts the least recently used entries from the cache such that
     // the total size of all remaining entries is less than mMaxTotalSize/2.
     void clean();
 
@@ -124,7 +155,7 @@ private:
     class CacheEntry {
     public:
         CacheEntry();
-        CacheEntry(const sp<Blob>& key, const sp<Blob>& value);
+        CacheEntry(const sp<Blob>& key, const sp<Blob>& value, uint32_t lastAccess);
         CacheEntry(const CacheEntry& ce);
 
         bool operator<(const CacheEntry& rhs) const;
@@ -132,8 +163,10 @@ private:
 
         sp<Blob> getKey() const;
         sp<Blob> getValue() const;
+        uint32_t getLastAccess() const;
 
         void setValue(const sp<Blob>& value);
+        void setLastAccess(uint32_t lastAccess);
 
     private:
 
@@ -142,8 +175,63 @@ private:
 
         // mValue is the cached data associated with the key.
         sp<Blob> mValue;
+
+        // mLastAccess is the value of mAccessClock when the entry was last
+        // set or retrieved.
+        uint32_t mLastAccess;
     };
 
+    // A Header is the header for the entire BlobCache serialization format. No
+    // need to make this portable, so we simply write the struct out.
+    struct Header {
+        // mMagicNumber is the magic number that identifies the data as
+        // serialized BlobCache contents.  It must always contain 'Blb$'.
+        uint32_t mMagicNumber;
+
+        // mBlobCacheVersion is the serialization format version.
+        uint32_t mBlobCacheVersion;
+
+        // mDeviceVersion is the device-specific version of the cache.  This can
+        // be used to invalidate the cache.
+        uint32_t mDeviceVersion;
+
+        // mNumEntries is number of cache entries following the header in the
+        // data.
+        size_t mNumEntries;
+    };
+
+    // An EntryHeader is the header for a serialized cache entry.  No need to
+    // make this portable, so we simply write the struct out.  Each EntryHeader
+    // is followed imediately by the key data and then the value data.
+    //
+    // The beginning of each serialized EntryHeader is 4-byte aligned, so the
+    // number of bytes that a serialized cache entry will occupy is:
+    //
+    //   ((sizeof(EntryHeader) + keySize + valueSize) + 3) & ~3
+    //
+    struct EntryHeader {
+        // mKeySize is the size of the entry key in bytes.
+        size_t mKeySize;
+
+        // mValueSize is the size of the entry value in bytes.
+        size_t mValueSize;
+
+        // mLastAccess orders the entries by recency of use.
+        uint32_t mLastAccess;
+
+        // mData contains both the key and value data for the cache entry.  The
+        // key comes first followed immediately by the value.
+        uint8_t mData[];
+    };
+
+    // findEntry returns the index of the entry for the given key, or
+    // a negative value.  mMutex must be held.
+    ssize_t findEntry(const void* key, size_t keySize) const;
+
+    // touch marks the entry at index as the most recently used one.  mMutex
+    // must be held.
+    void touch(size_t index);
+
     // mMaxKeySize is the maximum key size that will be cached. Calls to
     // BlobCache::set with a keySize parameter larger than mMaxKeySize will
     // simply not add the key/value pair to the cache.
@@ -165,10 +253,10 @@ private:
     // the cache.
     size_t mTotalSize;
 
-    // mRandState is the pseudo-random number generator state. It is passed to
-    // nrand48 to generate random numbers when needed. It must be protected by
-    // mMutex.
-    unsigned short mRandState[3];
+    // mAccessClock is incremented on every set and successful get, and
+    // stamped on the entry involved. Entries with the smallest stamps are
+    // evicted first.
+    uint32_t mAccessClock;
 
     // mCacheEntries stores all the cache entries that are resident in memory.
     // Cache entries are added to it by the 'set' method.
@@ -176,7 +264,7 @@ private:
 
     // mMutex is used to synchronize access to all member variables.  It must be
     // locked any time the member variables are written or read.
-    Mutex mMutex;
+    mutable Mutex mMutex;
 };
 
 }
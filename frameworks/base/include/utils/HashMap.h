@@ -0,0 +1,149 @@
+/*
+ * Copyright (C) 2011 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_HASH_MAP_H
+#define ANDROID_HASH_MAP_H
+
+#include <assert.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <utils/BasicHashtable.h>
+#include <utils/TypeHelpers.h>
+#include <utils/Errors.h>
+
+// ---------------------------------------------------------------------------
+
+namespace android {
+
+/*
+ * An unordered map from keys to values, with the same accessors as
+ * KeyedVector but O(1) average lookups instead of a binary search.
+ *
+ * KEY must have a hash_type() function (see TypeHelpers.h) and an ==
+ * operator.  Indices are not contiguous: iterate with next(), starting
+ * from -1, instead of counting up to size().
+ */
+template <typename KEY, typename VALUE>
+class HashMap
+{
+public:
+    typedef KEY    key_type;
+    typedef VALUE  value_type;
+
+    explicit inline         HashMap(size_t minimumInitialCapacity = 0)
+                                : mTable(minimumInitialCapacity) { }
+
+    /*
+     * empty the map
+     */
+
+    inline  void            clear()                     { mTable.clear(); }
+
+    /*!
+     * map stats
+     */
+
+    //! returns number of items in the map
+    inline  size_t          size() const                { return mTable.size(); }
+    //! returns wether or not the map is empty
+    inline  bool            isEmpty() const             { return mTable.isEmpty(); }
+    //! returns how many items can be stored without rehashing
+    inline  size_t          capacity() const            { return mTable.capacity(); }
+    //! sets the capacity. capacity can never be reduced less than size()
+    inline  void            setCapacity(size_t size)    { mTable.rehash(size, mTable.loadFactor()); }
+
+    /*!
+     * accessors
+     */
+            const VALUE&    valueFor(const KEY& key) const;
+    inline  const VALUE&    valueAt(size_t index) const { return mTable.entryAt(index).value; }
+    inline  const KEY&      keyAt(size_t index) const   { return mTable.entryAt(index).key; }
+    inline  ssize_t         indexOfKey(const KEY& key) const {
+                                ssize_t i = mTable.find(-1, hash_type(key), key);
+                                return i >= 0 ? i : ssize_t(NAME_NOT_FOUND);
+                            }
+    //! returns the index of the next item after index, or -1. start with -1.
+    inline  ssize_t         next(ssize_t index) const   { return mTable.next(index); }
+
+    /*!
+     * modifing the map
+     */
+
+            VALUE&          editValueFor(const KEY& key);
+    inline  VALUE&          editValueAt(size_t index)   { return mTable.editEntryAt(index).value; }
+
+            /*!
+             * add/replace items
+             */
+
+            //! adds or replaces the value for key, returns its index
+            ssize_t         add(const KEY& key, const VALUE& item);
+
+    /*!
+     * remove items
+     */
+
+            //! returns the index the item had, or NAME_NOT_FOUND
+            ssize_t         removeItem(const KEY& key);
+    inline  void            removeItemAt(size_t index)  { mTable.removeAt(index); }
+
+private:
+            BasicHashtable< KEY, key_value_pair_t<KEY, VALUE> >  mTable;
+};
+
+// ---------------------------------------------------------------------------
+
+template<typename KEY, typename VALUE> inline
+const VALUE& HashMap<KEY,VALUE>::valueFor(const KEY& key) const {
+    ssize_t i = indexOfKey(key);
+    assert(i>=0);
+    return mTable.entryAt(i).value;
+}
+
+template<typename KEY, typename VALUE> inline
+VALUE& HashMap<KEY,VALUE>::editValueFor(const KEY& key) {
+    ssize_t i = indexOfKey(key);
+    assert(i>=0);
+    return mTable.editEntryAt(i).value;
+}
+
+template<typename KEY, typename VALUE> inline
+ssize_t HashMap<KEY,VALUE>::add(const KEY& key, const VALUE& value) {
+    const hash_t hash = hash_type(key);
+    ssize_t i = mTable.find(-1, hash, key);
+    if (i >= 0) {
+        mTable.editEntryAt(i).value = value;
+        return i;
+    }
+    return mTable.add(hash, key_value_pair_t<KEY,VALUE>(key, value));
+}
+
+template<typename KEY, typename VALUE> inline
+ssize_t HashMap<KEY,VALUE>::removeItem(const KEY& key) {
+    ssize_t i = indexOfKey(key);
+    if (i < 0) {
+        return NAME_NOT_FOUND;
+    }
+    mTable.removeAt(i);
+    return i;
+}
+
+}; // namespace android
+
+// ---------------------------------------------------------------------------
+
+#endif // ANDROID_HASH_MAP_H
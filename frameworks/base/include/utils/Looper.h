@@ -19,7 +19,9 @@
 
 #include <utils/threads.h>
 #include <utils/RefBase.h>
-#include <utils/KeyedVector.h>
+#include <utils/HashMap.h>
+#include <utils/String8.h>
+#include <utils/Vector.h>
 #include <utils/Timers.h>
 
 #include <android/looper.h>
@@ -256,6 +258,24 @@ public:
      */
     void removeMessages(const sp<MessageHandler>& handler, int what);
 
+    /**
+     * Enables or disables the collection of dispatch statistics: how long each message
+     * handler and file descriptor callback ran, how late messages were delivered
+     * relative to their scheduled uptime and how deep the message queue has been.
+     * Collection is disabled by default.  Enabling it resets the statistics.
+     *
+     * This method can be called on any thread.
+     */
+    void setStatisticsEnabled(bool enabled);
+
+    /**
+     * Appends the dispatch statistics to the given string for use by dumpsys.
+     * Each line is prefixed with the given prefix.
+     *
+     * This method can be called on any thread.
+     */
+    void dump(String8& dump, const char* prefix = "");
+
     /**
      * Prepares a looper associated with the calling thread, and returns it.
      * If the thread already has a looper, it is returned.  Otherwise, a new
@@ -292,32 +312,71 @@ private:
         Request request;
     };
 
+    struct DispatchStats {
+        DispatchStats() : count(0), totalTime(0), maxTime(0) { }
+
+        inline void record(nsecs_t time) {
+            count += 1;
+            totalTime += time;
+            if (time > maxTime) {
+                maxTime = time;
+            }
+        }
+
+        uint32_t count;
+        nsecs_t totalTime;
+        nsecs_t maxTime;
+    };
+
     struct MessageEnvelope {
-        MessageEnvelope() : uptime(0) { }
+        MessageEnvelope() : uptime(0), sequence(0) { }
 
-        MessageEnvelope(nsecs_t uptime, const sp<MessageHandler> handler,
-                const Message& message) : uptime(uptime), handler(handler), message(message) {
+        MessageEnvelope(nsecs_t uptime, uint64_t sequence, const sp<MessageHandler> handler,
+                const Message& message) : uptime(uptime), sequence(sequence),
+                handler(handler), message(message) {
+        }
+
+        // Messages due at the same time are delivered in the order they were sent.
+        inline bool isBefore(const MessageEnvelope& other) const {
+            return uptime < other.uptime
+                    || (uptime == other.uptime && sequence < other.sequence);
         }
 
         nsecs_t uptime;
+        uint64_t sequence;
         sp<MessageHandler> handler;
         Message message;
     };
 
     const bool mAllowNonCallbacks; // immutable
 
-    int mWakeReadPipeFd;  // immutable
-    int mWakeWritePipeFd; // immutable
+    int mWakeEventFd;  // immutable
     Mutex mLock;
 
+    // Binary min-heap of pending messages ordered by MessageEnvelope::isBefore,
+    // so the next message due is always at index 0.
     Vector<MessageEnvelope> mMessageEnvelopes; // guarded by mLock
+    uint64_t mNextMessageSequence; // guarded by mLock
     bool mSendingMessage; // guarded by mLock
 
+    // Dispatch statistics, only collected while mStatisticsEnabled is true.
+    bool mStatisticsEnabled; // guarded by mLock
+    nsecs_t mStatisticsStartTime; // guarded by mLock
+    HashMap<const MessageHandler*, DispatchStats> mHandlerStats; // guarded by mLock
+    HashMap<int, DispatchStats> mCallbackStats; // guarded by mLock
+    DispatchStats mMessageLagStats; // guarded by mLock
+    size_t mMaxMessageQueueDepth; // guarded by mLock
+
 #ifdef LOOPER_USES_EPOLL
     int mEpollFd; // immutable
 
-    // Locked list of file descriptor monitoring requests.
-    KeyedVector<int, Request> mRequests;  // guarded by mLock
+    // Locked map of file descriptor monitoring requests.
+    HashMap<int, Request> mRequests;  // guarded by mLock
+
+    // Buffer for the results of epoll_wait(), grown when a poll fills it up.
+    // Only used by pollOnce.
+    struct epoll_event* mEventItems;
+    int mEventItemCapacity;
 #else
     // The lock guards state used to track whether there is a poll() in progress and whether
     // there are any other threads waiting in wakeAndLock().  The condition variables
@@ -366,6 +425,11 @@ private:
 
     int pollInner(int timeoutMillis);
     void awoken();
+    size_t pushMessageLocked(const MessageEnvelope& messageEnvelope);
+    void popMessageLocked();
+    void siftDownLocked(size_t index);
+    void rebuildMessageHeapLocked();
+    static void dumpDispatchStats(String8& dump, const DispatchStats& stats);
     void pushResponse(int events, const Request& request);
 
     static void initTLSKey();
@@ -187,12 +187,30 @@ private:
     inline static void moveReferences(void* d, void const* s, size_t n,
             const ReferenceConverterBase& caster) { }
 
+    // Lightweight objects cannot be weakly referenced: declaring this here
+    // turns any use of wp<> on them into a compile-time access error.
+    void createWeak(const void* id) const; // not implemented
+
 private:
     mutable volatile int32_t mCount;
 };
 
 // ---------------------------------------------------------------------------
 
+/*
+ * A LightRefBase with a virtual destructor, for class hierarchies that are
+ * only ever held through sp<> and never through wp<>.  Unlike RefBase it does
+ * not allocate a separate weak reference object and holding a reference costs
+ * a single atomic operation.  Subclasses give up onFirstRef() and friends.
+ */
+class VirtualLightRefBase : public LightRefBase<VirtualLightRefBase>
+{
+public:
+    virtual ~VirtualLightRefBase() { }
+};
+
+// ---------------------------------------------------------------------------
+
 template <typename T>
 class wp
 {
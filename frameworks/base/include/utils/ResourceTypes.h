@@ -23,6 +23,7 @@
 #include <utils/Asset.h>
 #include <utils/ByteOrder.h>
 #include <utils/Errors.h>
+#include <utils/HashMap.h>
 #include <utils/String16.h>
 #include <utils/Vector.h>
 
@@ -458,11 +459,25 @@ public:
 
     size_t size() const;
 
+    // Decode the UTF-8 strings [start, start+count) now rather than as
+    // they are first used, packing them together in the decode cache.
+    // Safe to call on one thread while others look strings up.
+    void prewarm(size_t start, size_t count) const;
+
+    // Decode all UTF-8 strings up front, e.g. so that a table set up
+    // before a fork() shares them with the children instead of each
+    // child filling in its own copies.
+    void cacheAllStrings() const;
+
 #ifndef HAVE_ANDROID_OS
     bool isUTF8() const;
 #endif
 
 private:
+    struct CacheChunk;
+
+    char16_t* allocCacheLocked(size_t count) const;
+
     status_t                    mError;
     void*                       mOwnedData;
     const ResStringPool_header* mHeader;
@@ -472,6 +487,7 @@ private:
     const uint32_t*             mEntryStyles;
     const void*                 mStrings;
     char16_t**                  mCache;
+    mutable CacheChunk*         mCacheChunks;       // storage for mCache
     uint32_t                    mStringPoolSize;    // number of uint16_t
     const uint32_t*             mStyles;
     uint32_t                    mStylePoolSize;    // number of uint32_t
@@ -2080,6 +2096,15 @@ public:
     static bool getIdmapInfo(const void* idmap, size_t size,
                              uint32_t* pOriginalCrc, uint32_t* pOverlayCrc);
 
+    // Decode the table's string pools up front; see
+    // ResStringPool::cacheAllStrings().
+    void cacheAllStrings() const;
+
+    // Decode the string values of the given resources, so that later
+    // lookups of them don't have to.  Meant to be run on a background
+    // thread while an activity is launching, with the ids it will need.
+    void prewarmStrings(const uint32_t* resIds, size_t count) const;
+
 #ifndef HAVE_ANDROID_OS
     void print(bool inclValues) const;
     static String8 normalizeForOutput(const char* input);
@@ -2101,6 +2126,8 @@ private:
         const ResTable_config* config,
         const ResTable_type** outType, const ResTable_entry** outEntry,
         const Type** outTypeClass) const;
+    const uint16_t* getConfigIndex(const Type* type) const;
+    void clearConfigIndex();
     status_t parsePackage(
         const ResTable_package* const pkg, const Header* const header, uint32_t idmap_id);
 
@@ -2121,6 +2148,12 @@ private:
     // Mapping from resource package IDs to indices into the internal
     // package array.
     uint8_t                     mPackageMap[256];
+
+    // For each type looked up so far, the index of the config getEntry()
+    // picks for every entry under mParams.  Guarded by mConfigIndexLock
+    // rather than mLock, since getEntry() is called with and without it.
+    mutable Mutex               mConfigIndexLock;
+    mutable HashMap<const Type*, uint16_t*> mConfigIndex;
 };
 
 }   // namespace android
@@ -19,6 +19,7 @@
 
 #include <utils/Errors.h>
 #include <utils/SharedBuffer.h>
+#include <utils/TypeHelpers.h>
 #include <utils/Unicode.h>
 
 // ---------------------------------------------------------------------------
@@ -57,6 +58,12 @@ public:
     inline  size_t              size() const;
     
     inline  const SharedBuffer* sharedBuffer() const;
+
+            //! Returns a copy of this string sharing its storage with every
+            //! other interned string of the same contents, so interned strings
+            //! can be compared by pointer.  Interned strings are kept until
+            //! the process exits.
+            String16            intern() const;
     
             void                setTo(const String16& other);
             status_t            setTo(const char16_t* other);
@@ -127,6 +134,11 @@ inline int strictly_order_type(const String16& lhs, const String16& rhs)
     return compare_type(lhs, rhs) < 0;
 }
 
+template <> inline hash_t hash_type(const String16& value)
+{
+    return hash_buffer(value.string(), value.size() * sizeof(char16_t));
+}
+
 inline const char16_t* String16::string() const
 {
     return mString;
@@ -178,12 +190,14 @@ inline bool String16::operator<=(const String16& other) const
 
 inline bool String16::operator==(const String16& other) const
 {
-    return strzcmp16(mString, size(), other.mString, other.size()) == 0;
+    return mString == other.mString
+            || strzcmp16(mString, size(), other.mString, other.size()) == 0;
 }
 
 inline bool String16::operator!=(const String16& other) const
 {
-    return strzcmp16(mString, size(), other.mString, other.size()) != 0;
+    return mString != other.mString
+            && strzcmp16(mString, size(), other.mString, other.size()) != 0;
 }
 
 inline bool String16::operator>=(const String16& other) const
@@ -19,6 +19,7 @@
 
 #include <utils/Errors.h>
 #include <utils/SharedBuffer.h>
+#include <utils/TypeHelpers.h>
 #include <utils/Unicode.h>
 
 #include <string.h> // for strcmp
@@ -60,6 +61,12 @@ public:
     inline  bool                isEmpty() const;
     
     inline  const SharedBuffer* sharedBuffer() const;
+
+            //! Returns a copy of this string sharing its storage with every
+            //! other interned string of the same contents, so interned strings
+            //! can be compared by pointer.  Interned strings are kept until
+            //! the process exits.
+            String8             intern() const;
     
             void                clear();
 
@@ -234,6 +241,11 @@ inline int strictly_order_type(const String8& lhs, const String8& rhs)
     return compare_type(lhs, rhs) < 0;
 }
 
+template <> inline hash_t hash_type(const String8& value)
+{
+    return hash_buffer(value.string(), value.bytes());
+}
+
 inline const String8 String8::empty() {
     return String8();
 }
@@ -323,12 +335,12 @@ inline bool String8::operator<=(const String8& other) const
 
 inline bool String8::operator==(const String8& other) const
 {
-    return strcmp(mString, other.mString) == 0;
+    return mString == other.mString || strcmp(mString, other.mString) == 0;
 }
 
 inline bool String8::operator!=(const String8& other) const
 {
-    return strcmp(mString, other.mString) != 0;
+    return mString != other.mString && strcmp(mString, other.mString) != 0;
 }
 
 inline bool String8::operator>=(const String8& other) const
@@ -23,6 +23,12 @@
 #include <sys/types.h>
 #include <stdlib.h>
 
+// Rvalue references, and with them move construction and assignment of sp<>,
+// are only available when compiling as C++11.
+#if __cplusplus >= 201103L || defined(__GXX_EXPERIMENTAL_CXX0X__)
+#define ANDROID_SP_HAS_MOVE 1
+#endif
+
 // ---------------------------------------------------------------------------
 namespace android {
 
@@ -68,6 +74,11 @@ public:
     sp(const sp<T>& other);
     template<typename U> sp(U* other);
     template<typename U> sp(const sp<U>& other);
+#ifdef ANDROID_SP_HAS_MOVE
+    // Moving steals the reference instead of touching the reference count.
+    inline sp(sp<T>&& other) : m_ptr(other.m_ptr) { other.m_ptr = 0; }
+    template<typename U> inline sp(sp<U>&& other) : m_ptr(other.m_ptr) { other.m_ptr = 0; }
+#endif
 
     ~sp();
 
@@ -78,6 +89,13 @@ public:
 
     template<typename U> sp& operator = (const sp<U>& other);
     template<typename U> sp& operator = (U* other);
+#ifdef ANDROID_SP_HAS_MOVE
+    sp& operator = (sp<T>&& other);
+    template<typename U> sp& operator = (sp<U>&& other);
+#endif
+
+    //! Exchanges the pointers held by two sp<> without touching the reference counts.
+    inline void swap(sp<T>& other) { T* tmp = m_ptr; m_ptr = other.m_ptr; other.m_ptr = tmp; }
 
     //! Special optimization for use by ProcessState (and nobody else).
     void force_set(T* other);
@@ -158,6 +176,26 @@ sp<T>& sp<T>::operator = (const sp<T>& other) {
     return *this;
 }
 
+#ifdef ANDROID_SP_HAS_MOVE
+template<typename T>
+sp<T>& sp<T>::operator = (sp<T>&& other) {
+    if (this != &other) {
+        if (m_ptr) m_ptr->decStrong(this);
+        m_ptr = other.m_ptr;
+        other.m_ptr = 0;
+    }
+    return *this;
+}
+
+template<typename T> template<typename U>
+sp<T>& sp<T>::operator = (sp<U>&& other) {
+    if (m_ptr) m_ptr->decStrong(this);
+    m_ptr = other.m_ptr;
+    other.m_ptr = 0;
+    return *this;
+}
+#endif
+
 template<typename T>
 sp<T>& sp<T>::operator = (T* other)
 {
@@ -0,0 +1,304 @@
+/*
+ * Copyright (C) 2011 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_UTILS_WEIGHTED_GENERATION_CACHE_H
+#define ANDROID_UTILS_WEIGHTED_GENERATION_CACHE_H
+
+#include <utils/GenerationCache.h>
+#include <utils/HashMap.h>
+
+namespace android {
+
+/**
+ * A LRU type cache bounded by the total weight (typically bytes) of its
+ * entries rather than by their count. Lookups are hashed, so K needs a
+ * hash_type() function (see TypeHelpers.h).
+ *
+ * With kSegmented the cache uses a segmented LRU: new entries go into a
+ * probationary segment and only move to the protected segment when they
+ * are hit again. Entries that are seen once, like the bitmaps of a long
+ * scrolling list, are then evicted before the ones in steady use.
+ */
+template<typename K, typename V>
+class WeightedGenerationCache {
+public:
+    enum Flags {
+        kSegmented = 0x1,
+    };
+
+    enum Weight {
+        kUnlimitedWeight,
+    };
+
+    struct Stats {
+        Stats(): hits(0), misses(0), evictions(0) { }
+
+        uint32_t hits;
+        uint32_t misses;
+        uint32_t evictions;
+    };
+
+    WeightedGenerationCache(uint32_t maxWeight, uint32_t flags = 0);
+    virtual ~WeightedGenerationCache();
+
+    void setOnEntryRemovedListener(OnEntryRemoved<K, V>* listener);
+
+    void clear();
+
+    bool contains(const K& key) const;
+    V get(const K& key);
+    /**
+     * Adds an entry, evicting the oldest entries until it fits. Returns
+     * false if the key is already present or the weight exceeds the
+     * maximum weight of the cache.
+     */
+    bool put(const K& key, const V& value, uint32_t weight);
+    V remove(const K& key);
+    V removeOldest();
+
+    uint32_t size() const { return mIndex.size(); }
+    bool isEmpty() const { return mIndex.isEmpty(); }
+    uint32_t getWeight() const { return mWeight; }
+    uint32_t getMaxWeight() const { return mMaxWeight; }
+    void setMaxWeight(uint32_t maxWeight);
+
+    const Stats& getStats() const { return mStats; }
+    void resetStats() { mStats = Stats(); }
+
+private:
+    // Share of the maximum weight the protected segment may hold
+    static const uint32_t kProtectedPercent = 80;
+
+    struct Node {
+        K key;
+        V value;
+        uint32_t weight;
+        bool isProtected;
+        Node* older;
+        Node* younger;
+    };
+
+    struct List {
+        List(): oldest(NULL), youngest(NULL), weight(0) { }
+
+        Node* oldest;
+        Node* youngest;
+        uint32_t weight;
+    };
+
+    bool fits(uint32_t weight) const;
+    List& listFor(Node* node) { return node->isProtected ? mProtected : mProbation; }
+    void attach(List& list, Node* node);
+    void detach(List& list, Node* node);
+    void balance();
+    V removeNode(Node* node);
+
+    HashMap<K, Node*> mIndex;
+    List mProbation; // the only list when not segmented
+    List mProtected;
+
+    uint32_t mMaxWeight;
+    uint32_t mWeight;
+    const uint32_t mFlags;
+
+    OnEntryRemoved<K, V>* mListener;
+    Stats mStats;
+}; // class WeightedGenerationCache
+
+template<typename K, typename V>
+WeightedGenerationCache<K, V>::WeightedGenerationCache(uint32_t maxWeight, uint32_t flags):
+        mMaxWeight(maxWeight), mWeight(0), mFlags(flags), mListener(NULL) {
+}
+
+template<typename K, typename V>
+WeightedGenerationCache<K, V>::~WeightedGenerationCache() {
+    clear();
+}
+
+/**
+ * Should be set by the user of the Cache so that the callback is called whenever an item is
+ * removed from the cache
+ */
+template<typename K, typename V>
+void WeightedGenerationCache<K, V>::setOnEntryRemovedListener(OnEntryRemoved<K, V>* listener) {
+    mListener = listener;
+}
+
+template<typename K, typename V>
+void WeightedGenerationCache<K, V>::clear() {
+    for (ssize_t i = mIndex.next(-1); i >= 0; i = mIndex.next(i)) {
+        Node* node = mIndex.valueAt(i);
+        if (mListener) {
+            (*mListener)(node->key, node->value);
+        }
+        delete node;
+    }
+    mIndex.clear();
+    mProbation = List();
+    mProtected = List();
+    mWeight = 0;
+}
+
+template<typename K, typename V>
+bool WeightedGenerationCache<K, V>::contains(const K& key) const {
+    return mIndex.indexOfKey(key) >= 0;
+}
+
+template<typename K, typename V>
+V WeightedGenerationCache<K, V>::get(const K& key) {
+    ssize_t index = mIndex.indexOfKey(key);
+    if (index < 0) {
+        mStats.misses++;
+        return NULL;
+    }
+
+    mStats.hits++;
+    Node* node = mIndex.valueAt(index);
+    detach(listFor(node), node);
+    if (mFlags & kSegmented) {
+        node->isProtected = true;
+    }
+    attach(listFor(node), node);
+    balance();
+
+    return node->value;
+}
+
+template<typename K, typename V>
+bool WeightedGenerationCache<K, V>::put(const K& key, const V& value, uint32_t weight) {
+    if (mMaxWeight != kUnlimitedWeight && weight > mMaxWeight) {
+        return false;
+    }
+    if (mIndex.indexOfKey(key) >= 0) {
+        return false;
+    }
+
+    while (!fits(weight) && !isEmpty()) {
+        removeOldest();
+    }
+
+    Node* node = new Node;
+    node->key = key;
+    node->value = value;
+    node->weight = weight;
+    node->isProtected = false;
+    mIndex.add(key, node);
+    attach(mProbation, node);
+    mWeight += weight;
+
+    return true;
+}
+
+template<typename K, typename V>
+V WeightedGenerationCache<K, V>::remove(const K& key) {
+    ssize_t index = mIndex.indexOfKey(key);
+    if (index >= 0) {
+        return removeNode(mIndex.valueAt(index));
+    }
+
+    return NULL;
+}
+
+template<typename K, typename V>
+V WeightedGenerationCache<K, V>::removeOldest() {
+    Node* node = mProbation.oldest ? mProbation.oldest : mProtected.oldest;
+    if (node) {
+        mStats.evictions++;
+        return removeNode(node);
+    }
+
+    return NULL;
+}
+
+template<typename K, typename V>
+void WeightedGenerationCache<K, V>::setMaxWeight(uint32_t maxWeight) {
+    mMaxWeight = maxWeight;
+    while (!fits(0) && !isEmpty()) {
+        removeOldest();
+    }
+    balance();
+}
+
+template<typename K, typename V>
+bool WeightedGenerationCache<K, V>::fits(uint32_t weight) const {
+    return mMaxWeight == kUnlimitedWeight || mWeight + weight <= mMaxWeight;
+}
+
+template<typename K, typename V>
+void WeightedGenerationCache<K, V>::attach(List& list, Node* node) {
+    node->older = list.youngest;
+    node->younger = NULL;
+    if (list.youngest) {
+        list.youngest->younger = node;
+    } else {
+        list.oldest = node;
+    }
+    list.youngest = node;
+    list.weight += node->weight;
+}
+
+template<typename K, typename V>
+void WeightedGenerationCache<K, V>::detach(List& list, Node* node) {
+    if (node->older) {
+        node->older->younger = node->younger;
+    } else {
+        list.oldest = node->younger;
+    }
+    if (node->younger) {
+        node->younger->older = node->older;
+    } else {
+        list.youngest = node->older;
+    }
+    node->older = node->younger = NULL;
+    list.weight -= node->weight;
+}
+
+/**
+ * Demotes the oldest protected entries back to the probationary segment
+ * so that the protected segment stays within its share of the cache.
+ */
+template<typename K, typename V>
+void WeightedGenerationCache<K, V>::balance() {
+    if (!(mFlags & kSegmented) || mMaxWeight == kUnlimitedWeight) {
+        return;
+    }
+
+    const uint32_t maxProtected = uint64_t(mMaxWeight) * kProtectedPercent / 100;
+    while (mProtected.weight > maxProtected && mProtected.oldest) {
+        Node* node = mProtected.oldest;
+        detach(mProtected, node);
+        node->isProtected = false;
+        attach(mProbation, node);
+    }
+}
+
+template<typename K, typename V>
+V WeightedGenerationCache<K, V>::removeNode(Node* node) {
+    if (mListener) {
+        (*mListener)(node->key, node->value);
+    }
+    mIndex.removeItem(node->key);
+    detach(listFor(node), node);
+    mWeight -= node->weight;
+
+    V value = node->value;
+    delete node;
+    return value;
+}
+
+}; // namespace android
+
+#endif // ANDROID_UTILS_WEIGHTED_GENERATION_CACHE_H
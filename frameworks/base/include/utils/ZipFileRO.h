@@ -35,6 +35,7 @@
 #include <utils/FileMap.h>
 #include <utils/threads.h>
 
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
@@ -64,6 +65,12 @@ typedef void* ZipEntryRO;
  * every page that the Central Directory touches.  Easier to tuck a copy
  * of the string length into the hash table entry.
  *
+ * Building the hash table means walking the whole Central Directory, which
+ * touches every page of it.  Callers that open the same archive over and
+ * over (e.g. framework-res.apk in every process) can pass an index file to
+ * open(): the table is then written there once and later opens just map it
+ * back read-only, so all processes share the same pages.
+ *
  * NOTE: If this is used on file descriptors inherited from a fork() operation,
  * you must be on a platform that implements pread() to guarantee correctness
  * on the shared file descriptors.
@@ -74,15 +81,20 @@ public:
         : mFd(-1), mFileName(NULL), mFileLength(-1),
           mDirectoryMap(NULL),
           mNumEntries(-1), mDirectoryOffset(-1),
-          mHashTableSize(-1), mHashTable(NULL)
+          mHashTableSize(-1), mHashTable(NULL), mIndexMap(NULL)
         {}
 
     ~ZipFileRO();
 
     /*
      * Open an archive.
+     *
+     * If "indexFileName" is non-NULL, the name hash table is loaded from
+     * that file when it matches the archive's size and modification time,
+     * and is (re)written there otherwise.  Failing to use the index file
+     * is not an error; the table is then built in memory as usual.
      */
-    status_t open(const char* zipFileName);
+    status_t open(const char* zipFileName, const char* indexFileName = NULL);
 
     /*
      * Find an entry, by name.  Returns the entry identifier, or NULL if
@@ -92,6 +104,14 @@ public:
      */
     ZipEntryRO findEntryByName(const char* fileName) const;
 
+    /*
+     * Find several entries at once.  "outEntries" must have room for
+     * "count" results; each one is set as findEntryByName() would set it.
+     * Returns the number of entries that were found.
+     */
+    size_t findEntriesByName(const char* const* fileNames, size_t count,
+        ZipEntryRO* outEntries) const;
+
     /*
      * Return the #of entries in the Zip archive.
      */
@@ -153,9 +173,31 @@ public:
 
     /*
      * Uncompress the data to an open file descriptor.
+     *
+     * If "fd" is a regular file opened read-write and positioned at its
+     * start, the data is inflated directly into a mapping of it.
      */
     bool uncompressEntry(ZipEntryRO entry, int fd) const;
 
+    /*
+     * One entry for uncompressEntries().  The data goes to "buffer" if it
+     * is non-NULL, and to "fd" otherwise.  "result" is set to the outcome.
+     */
+    typedef struct UncompressRequest {
+        ZipEntryRO  entry;
+        void*       buffer;
+        int         fd;
+        bool        result;
+    } UncompressRequest;
+
+    /*
+     * Uncompress several entries, spreading the work over up to
+     * "maxThreads" worker threads, and wait for all of them.  Returns
+     * "true" if all of them succeeded.
+     */
+    bool uncompressEntries(UncompressRequest* requests, size_t count,
+        int maxThreads) const;
+
     /* Zip compression methods we support */
     enum {
         kCompressStored     = 0,        // no compression
@@ -213,21 +255,42 @@ private:
     /* add a new entry to the hash table */
     void addToHash(const char* str, int strLen, unsigned int hash);
 
+    /* map a previously written hash table; returns false if it is stale */
+    bool mapIndex(const char* indexFileName);
+
+    /* write the hash table out for later opens */
+    bool writeIndex(const char* indexFileName) const;
+
+    /* find an entry given its name's length and hash */
+    ZipEntryRO findEntry(const char* fileName, int nameLen,
+        unsigned int hash) const;
+
     /* compute string hash code */
     static unsigned int computeHash(const char* str, int len);
 
+    /* map "fd" for writing "length" bytes; NULL if that's not possible */
+    static void* mapOutputFile(int fd, size_t length);
+
     /* convert a ZipEntryRO back to a hash table index */
     int entryToIndex(const ZipEntryRO entry) const;
 
     /*
-     * One entry in the hash table.
+     * One entry in the hash table.  The name is stored as an offset into
+     * the Central Directory rather than as a pointer so that the table can
+     * be written to disk and mapped back.  Names can't start at offset 0,
+     * so that marks an empty slot.
      */
     typedef struct HashEntry {
-        const char*     name;
-        unsigned short  nameLen;
-        //unsigned int    hash;
+        uint32_t        nameOffset;
+        uint16_t        nameLen;
+        uint16_t        reserved;
     } HashEntry;
 
+    /* return the (not null-terminated) name of a hash table entry */
+    const char* entryName(const HashEntry& entry) const {
+        return (const char*) mDirectoryMap->getDataPtr() + entry.nameOffset;
+    }
+
     /* open Zip archive */
     int         mFd;
 
@@ -255,6 +318,9 @@ private:
      */
     int         mHashTableSize;
     HashEntry*  mHashTable;
+
+    /* index file holding mHashTable, or NULL if the table is on the heap */
+    FileMap*    mIndexMap;
 };
 
 }; // namespace android
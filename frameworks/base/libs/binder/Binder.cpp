@@ -19,9 +19,11 @@
 #include <utils/Atomic.h>
 #include <binder/BpBinder.h>
 #include <binder/IInterface.h>
+#include <binder/IPCThreadState.h>
 #include <binder/Parcel.h>
 
 #include <stdio.h>
+#include <unistd.h>
 
 namespace android {
 
@@ -199,6 +201,20 @@ status_t BBinder::onTransact(
             }
             return dump(fd, args);
         }
+
+        case STATS_TRANSACTION: {
+            // Process-wide binder statistics; the same for every local
+            // object, so any service can be asked for them.
+            int fd = data.readFileDescriptor();
+            if (data.readInt32() != 0) {
+                IPCThreadState::resetTransactionStats();
+            }
+            String8 result;
+            IPCThreadState::dumpTransactionStats(result);
+            write(fd, result.string(), result.size());
+            return NO_ERROR;
+        }
+
         default:
             return UNKNOWN_TRANSACTION;
     }
@@ -21,6 +21,7 @@
 #include <binder/CursorWindow.h>
 
 #include <cutils/ashmem.h>
+#include <cutils/atomic.h>
 #include <sys/mman.h>
 
 #include <assert.h>
@@ -31,7 +32,8 @@ namespace android {
 
 CursorWindow::CursorWindow(const String8& name, int ashmemFd,
         void* data, size_t size, bool readOnly) :
-        mName(name), mAshmemFd(ashmemFd), mData(data), mSize(size), mReadOnly(readOnly) {
+        mName(name), mAshmemFd(ashmemFd), mData(data), mSize(size), mReadOnly(readOnly),
+        mChunkCacheOffset(0), mChunkCacheFirstRow(0), mChunkCacheGeneration(0) {
     mHeader = static_cast<Header*>(mData);
 }
 
@@ -139,12 +141,31 @@ status_t CursorWindow::clear() {
     mHeader->firstChunkOffset = sizeof(Header);
     mHeader->numRows = 0;
     mHeader->numColumns = 0;
+    android_atomic_release_store(0, &mHeader->numPublishedRows);
+    android_atomic_inc(&mHeader->generation);
 
     RowSlotChunk* firstChunk = static_cast<RowSlotChunk*>(offsetToPtr(mHeader->firstChunkOffset));
     firstChunk->nextChunkOffset = 0;
     return OK;
 }
 
+status_t CursorWindow::publishRows() {
+    if (mReadOnly) {
+        return INVALID_OPERATION;
+    }
+
+    android_atomic_release_store(int32_t(mHeader->numRows), &mHeader->numPublishedRows);
+    return OK;
+}
+
+uint32_t CursorWindow::getNumPublishedRows() {
+    return uint32_t(android_atomic_acquire_load(&mHeader->numPublishedRows));
+}
+
+uint32_t CursorWindow::getGeneration() {
+    return uint32_t(android_atomic_acquire_load(&mHeader->generation));
+}
+
 status_t CursorWindow::setNumColumns(uint32_t numColumns) {
     if (mReadOnly) {
         return INVALID_OPERATION;
@@ -195,6 +216,10 @@ status_t CursorWindow::freeLastRow() {
 
     if (mHeader->numRows > 0) {
         mHeader->numRows--;
+        if (uint32_t(mHeader->numPublishedRows) > mHeader->numRows) {
+            android_atomic_release_store(int32_t(mHeader->numRows),
+                    &mHeader->numPublishedRows);
+        }
     }
     return OK;
 }
@@ -221,25 +246,42 @@ uint32_t CursorWindow::alloc(size_t size, bool aligned) {
     return offset;
 }
 
+CursorWindow::RowSlotChunk* CursorWindow::findChunk(uint32_t row, uint32_t* outChunkPos) {
+    uint32_t chunkOffset = mHeader->firstChunkOffset;
+    uint32_t firstRow = 0;
+    uint32_t generation = uint32_t(mHeader->generation);
+    if (mChunkCacheOffset && mChunkCacheGeneration == generation
+            && mChunkCacheFirstRow <= row) {
+        chunkOffset = mChunkCacheOffset;
+        firstRow = mChunkCacheFirstRow;
+    }
+
+    RowSlotChunk* chunk = static_cast<RowSlotChunk*>(offsetToPtr(chunkOffset));
+    while (row - firstRow >= ROW_SLOT_CHUNK_NUM_ROWS && chunk->nextChunkOffset) {
+        chunkOffset = chunk->nextChunkOffset;
+        chunk = static_cast<RowSlotChunk*>(offsetToPtr(chunkOffset));
+        firstRow += ROW_SLOT_CHUNK_NUM_ROWS;
+    }
+
+    mChunkCacheOffset = chunkOffset;
+    mChunkCacheFirstRow = firstRow;
+    mChunkCacheGeneration = generation;
+    *outChunkPos = row - firstRow;
+    return chunk;
+}
+
 CursorWindow::RowSlot* CursorWindow::getRowSlot(uint32_t row) {
-    uint32_t chunkPos = row;
-    RowSlotChunk* chunk = static_cast<RowSlotChunk*>(
-            offsetToPtr(mHeader->firstChunkOffset));
-    while (chunkPos >= ROW_SLOT_CHUNK_NUM_ROWS) {
-        chunk = static_cast<RowSlotChunk*>(offsetToPtr(chunk->nextChunkOffset));
-        chunkPos -= ROW_SLOT_CHUNK_NUM_ROWS;
+    uint32_t chunkPos;
+    RowSlotChunk* chunk = findChunk(row, &chunkPos);
+    if (chunkPos >= ROW_SLOT_CHUNK_NUM_ROWS) {
+        return NULL;
     }
     return &chunk->slots[chunkPos];
 }
 
 CursorWindow::RowSlot* CursorWindow::allocRowSlot() {
-    uint32_t chunkPos = mHeader->numRows;
-    RowSlotChunk* chunk = static_cast<RowSlotChunk*>(
-            offsetToPtr(mHeader->firstChunkOffset));
-    while (chunkPos > ROW_SLOT_CHUNK_NUM_ROWS) {
-        chunk = static_cast<RowSlotChunk*>(offsetToPtr(chunk->nextChunkOffset));
-        chunkPos -= ROW_SLOT_CHUNK_NUM_ROWS;
-    }
+    uint32_t chunkPos;
+    RowSlotChunk* chunk = findChunk(mHeader->numRows, &chunkPos);
     if (chunkPos == ROW_SLOT_CHUNK_NUM_ROWS) {
         if (!chunk->nextChunkOffset) {
             chunk->nextChunkOffset = alloc(sizeof(RowSlotChunk), true /*aligned*/);
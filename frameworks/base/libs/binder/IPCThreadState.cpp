@@ -20,16 +20,20 @@
 
 #include <binder/Binder.h>
 #include <binder/BpBinder.h>
+#include <cutils/properties.h>
 #include <cutils/sched_policy.h>
+#include <utils/Atomic.h>
 #include <utils/Debug.h>
 #include <utils/Log.h>
 #include <utils/TextOutput.h>
+#include <utils/Timers.h>
 #include <utils/threads.h>
 
 #include <private/binder/binder_module.h>
 #include <private/binder/Static.h>
 
 #include <sys/ioctl.h>
+#include <poll.h>
 #include <signal.h>
 #include <errno.h>
 #include <stdio.h>
@@ -295,6 +299,168 @@ static pthread_key_t gTLS = 0;
 static bool gShutdown = false;
 static bool gDisableBackgroundScheduling = false;
 
+// ---------------------------------------------------------------------------
+// Transaction latency accounting.
+
+static volatile int32_t gStatsState = -1;   // -1: not read from property yet
+
+// Each thread owns a fixed-size open-addressed table which only it writes,
+// so recording needs no locking.  The list of live tables and the totals
+// of exited threads are protected by gStatsMutex, which is only taken
+// when a thread starts or exits and when the statistics are dumped.
+class IPCThreadState::TransactionStats
+{
+public:
+    enum {
+        // Time from sending BC_TRANSACTION until BR_REPLY (or
+        // BR_TRANSACTION_COMPLETE for oneway calls), as seen by the caller.
+        KIND_CLIENT = 0,
+        // Time spent in BBinder::transact() servicing an incoming call.
+        KIND_SERVER,
+        // Time spent handing the reply back to the driver.
+        KIND_REPLY,
+        KIND_COUNT
+    };
+
+    enum {
+        MAX_ENTRIES = 128,
+        // log2 buckets in microseconds: <1us, <2us, ... <16.384ms, overflow.
+        HISTOGRAM_BUCKETS = 16
+    };
+
+    struct Entry {
+        int32_t     kind;       // -1 if the slot is unused
+        uint32_t    code;
+        const void* target;     // handle for client entries, BBinder* otherwise
+        String16    descriptor; // only known for local objects
+        uint32_t    count;
+        nsecs_t     total;
+        nsecs_t     max;
+        uint32_t    histogram[HISTOGRAM_BUCKETS];
+    };
+
+    TransactionStats() : mDropped(0) {
+        reset();
+    }
+
+    void reset() {
+        for (size_t i=0 ; i<MAX_ENTRIES ; i++) {
+            mEntries[i].kind = -1;
+            mEntries[i].descriptor = String16();
+        }
+        mDropped = 0;
+    }
+
+    void record(int32_t kind, const void* target, uint32_t code,
+            const String16* descriptor, nsecs_t elapsed) {
+        Entry* e = find(kind, target, code, descriptor);
+        if (e == NULL) {
+            mDropped++;
+            return;
+        }
+        e->count++;
+        e->total += elapsed;
+        if (elapsed > e->max) e->max = elapsed;
+
+        uint32_t us = uint32_t(ns2us(elapsed));
+        size_t bucket = 0;
+        while (us && bucket < HISTOGRAM_BUCKETS-1) {
+            us >>= 1;
+            bucket++;
+        }
+        e->histogram[bucket]++;
+    }
+
+    void mergeInto(TransactionStats* dest) const {
+        for (size_t i=0 ; i<MAX_ENTRIES ; i++) {
+            const Entry& src(mEntries[i]);
+            if (src.kind < 0 || src.count == 0) continue;
+            Entry* e = dest->find(src.kind, src.target, src.code, &src.descriptor);
+            if (e == NULL) {
+                dest->mDropped += src.count;
+                continue;
+            }
+            e->count += src.count;
+            e->total += src.total;
+            if (src.max > e->max) e->max = src.max;
+            for (size_t b=0 ; b<HISTOGRAM_BUCKETS ; b++) {
+                e->histogram[b] += src.histogram[b];
+            }
+        }
+        dest->mDropped += mDropped;
+    }
+
+    Entry       mEntries[MAX_ENTRIES];
+    uint32_t    mDropped;
+
+private:
+    Entry* find(int32_t kind, const void* target, uint32_t code,
+            const String16* descriptor) {
+        size_t hash = (size_t(target) * 31 + code) * 31 + kind;
+        for (size_t probe=0 ; probe<MAX_ENTRIES ; probe++) {
+            Entry* e = &mEntries[(hash + probe) % MAX_ENTRIES];
+            if (e->kind < 0) {
+                e->kind = kind;
+                e->code = code;
+                e->target = target;
+                if (descriptor) e->descriptor = *descriptor;
+                e->count = 0;
+                e->total = 0;
+                e->max = 0;
+                memset(e->histogram, 0, sizeof(e->histogram));
+                return e;
+            }
+            if (e->kind == kind && e->target == target && e->code == code) {
+                return e;
+            }
+        }
+        return NULL;
+    }
+};
+
+static Mutex gStatsMutex;
+static Vector<IPCThreadState::TransactionStats*>* gLiveStats = NULL;
+static IPCThreadState::TransactionStats* gRetiredStats = NULL;
+
+static bool statsEnabled()
+{
+    int32_t state = gStatsState;
+    if (state < 0) {
+        char value[PROPERTY_VALUE_MAX];
+        property_get("debug.binder.stats", value, "0");
+        state = atoi(value) ? 1 : 0;
+        android_atomic_cmpxchg(-1, state, &gStatsState);
+        state = gStatsState;
+    }
+    return state > 0;
+}
+
+static void registerStats(IPCThreadState::TransactionStats* stats)
+{
+    AutoMutex _l(gStatsMutex);
+    if (gLiveStats == NULL) {
+        gLiveStats = new Vector<IPCThreadState::TransactionStats*>();
+    }
+    gLiveStats->add(stats);
+}
+
+static void unregisterStats(IPCThreadState::TransactionStats* stats)
+{
+    AutoMutex _l(gStatsMutex);
+    if (gRetiredStats == NULL) {
+        gRetiredStats = new IPCThreadState::TransactionStats();
+    }
+    stats->mergeInto(gRetiredStats);
+    if (gLiveStats != NULL) {
+        for (size_t i=0 ; i<gLiveStats->size() ; i++) {
+            if (gLiveStats->itemAt(i) == stats) {
+                gLiveStats->removeAt(i);
+                break;
+            }
+        }
+    }
+}
+
 IPCThreadState* IPCThreadState::self()
 {
     if (gHaveTLS) {
@@ -349,6 +515,103 @@ void IPCThreadState::disableBackgroundScheduling(bool disable)
     gDisableBackgroundScheduling = disable;
 }
 
+void IPCThreadState::setTransactionStatsEnabled(bool enabled)
+{
+    android_atomic_release_store(enabled ? 1 : 0, &gStatsState);
+}
+
+bool IPCThreadState::isTransactionStatsEnabled()
+{
+    return statsEnabled();
+}
+
+void IPCThreadState::resetTransactionStats()
+{
+    AutoMutex _l(gStatsMutex);
+    if (gRetiredStats != NULL) {
+        gRetiredStats->reset();
+    }
+    // Live tables belong to their threads; we can only clear the counters,
+    // not the slot assignments, without racing against the owner.
+    if (gLiveStats != NULL) {
+        for (size_t i=0 ; i<gLiveStats->size() ; i++) {
+            TransactionStats* stats = gLiveStats->itemAt(i);
+            for (size_t j=0 ; j<TransactionStats::MAX_ENTRIES ; j++) {
+                TransactionStats::Entry& e(stats->mEntries[j]);
+                e.count = 0;
+                e.total = 0;
+                e.max = 0;
+                memset(e.histogram, 0, sizeof(e.histogram));
+            }
+            stats->mDropped = 0;
+        }
+    }
+}
+
+void IPCThreadState::dumpTransactionStats(String8& result)
+{
+    static const char* const kKindNames[TransactionStats::KIND_COUNT] = {
+        "client", "server", "reply"
+    };
+
+    TransactionStats* merged = new TransactionStats();
+    size_t threads = 0;
+    {
+        AutoMutex _l(gStatsMutex);
+        if (gRetiredStats != NULL) {
+            gRetiredStats->mergeInto(merged);
+        }
+        if (gLiveStats != NULL) {
+            threads = gLiveStats->size();
+            for (size_t i=0 ; i<threads ; i++) {
+                gLiveStats->itemAt(i)->mergeInto(merged);
+            }
+        }
+    }
+
+    result.appendFormat("Binder transaction stats for pid %d (%s, %d threads):\n",
+            getpid(), statsEnabled() ? "enabled" : "disabled", threads);
+
+    sp<ProcessState> proc(ProcessState::self());
+    result.appendFormat("  thread pool: %d threads, %d busy\n",
+            proc->getThreadPoolThreadCount(), proc->getThreadPoolBusyThreadCount());
+    for (size_t i=0 ; i<TransactionStats::MAX_ENTRIES ; i++) {
+        const TransactionStats::Entry& e(merged->mEntries[i]);
+        if (e.kind < 0 || e.count == 0) continue;
+
+        String16 descriptor(e.descriptor);
+        if (e.kind == TransactionStats::KIND_CLIENT) {
+            // Resolved outside of the lock and after the fact: asking a
+            // remote object for its descriptor is itself a transaction.
+            sp<IBinder> binder = proc->getStrongProxyForHandle(int32_t(e.target));
+            if (binder != NULL) {
+                descriptor = binder->getInterfaceDescriptor();
+            }
+            result.appendFormat("  %-6s handle %-4d ", kKindNames[e.kind], int32_t(e.target));
+        } else {
+            result.appendFormat("  %-6s object %p ", kKindNames[e.kind], e.target);
+        }
+        result.appendFormat("%s code %u: count=%u avg=%lldus max=%lldus\n",
+                descriptor.size() ? String8(descriptor).string() : "<unknown>",
+                e.code, e.count, ns2us(e.total / e.count), ns2us(e.max));
+
+        result.append("         ");
+        for (size_t b=0 ; b<TransactionStats::HISTOGRAM_BUCKETS ; b++) {
+            if (e.histogram[b] == 0) continue;
+            if (b == TransactionStats::HISTOGRAM_BUCKETS-1) {
+                result.appendFormat(" >=%uus:%u", 1u << (b-1), e.histogram[b]);
+            } else {
+                result.appendFormat(" <%uus:%u", 1u << b, e.histogram[b]);
+            }
+        }
+        result.append("\n");
+    }
+    if (merged->mDropped) {
+        result.appendFormat("  %u samples dropped (tables full)\n", merged->mDropped);
+    }
+    delete merged;
+}
+
 sp<ProcessState> IPCThreadState::process()
 {
     return mProcess;
@@ -414,91 +677,92 @@ void IPCThreadState::flushCommands()
 {
     if (mProcess->mDriverFD <= 0)
         return;
+    if (!mPendingOneway.isEmpty()) {
+        flushOnewayTransactions();
+    }
     talkWithDriver(false);
 }
 
-void IPCThreadState::joinThreadPool(bool isMain)
+status_t IPCThreadState::queueOnewayTransaction(int32_t handle, uint32_t code,
+        const Parcel& data, uint32_t coalesceKey)
 {
-    LOG_THREADPOOL("**** THREAD %p (PID %d) IS JOINING THE THREAD POOL\n", (void*)pthread_self(), getpid());
+    status_t err = data.errorCheck();
+    if (err != NO_ERROR) {
+        return (mLastError = err);
+    }
 
-    mOut.writeInt32(isMain ? BC_ENTER_LOOPER : BC_REGISTER_LOOPER);
-    
-    // This thread may have been spawned by a thread that was in the background
-    // scheduling group, so first we will make sure it is in the default/foreground
-    // one to avoid performing an initial transaction in the background.
-    androidSetThreadSchedulingGroup(mMyThreadId, ANDROID_TGROUP_DEFAULT);
-        
-    status_t result;
-    do {
-        int32_t cmd;
-        
-        // When we've cleared the incoming command queue, process any pending derefs
-        if (mIn.dataPosition() >= mIn.dataSize()) {
-            size_t numPending = mPendingWeakDerefs.size();
-            if (numPending > 0) {
-                for (size_t i = 0; i < numPending; i++) {
-                    RefBase::weakref_type* refs = mPendingWeakDerefs[i];
-                    refs->decWeak(mProcess.get());
-                }
-                mPendingWeakDerefs.clear();
-            }
+    // The driver copies the data only once the batch is written, so keep
+    // a private copy of the parcel until then.
+    Parcel* copy = new Parcel();
+    err = copy->appendFrom(&data, 0, data.dataSize());
+    if (err != NO_ERROR) {
+        delete copy;
+        return (mLastError = err);
+    }
 
-            numPending = mPendingStrongDerefs.size();
-            if (numPending > 0) {
-                for (size_t i = 0; i < numPending; i++) {
-                    BBinder* obj = mPendingStrongDerefs[i];
-                    obj->decStrong(mProcess.get());
-                }
-                mPendingStrongDerefs.clear();
+    if (coalesceKey != 0) {
+        const size_t N = mPendingOneway.size();
+        for (size_t i=0 ; i<N ; i++) {
+            PendingOneway& pending(mPendingOneway.editItemAt(i));
+            if (pending.handle == handle && pending.code == code
+                    && pending.coalesceKey == coalesceKey) {
+                LOG_ONEWAY("Coalescing oneway transaction to handle %d code %u", handle, code);
+                delete pending.data;
+                // Moving it to the end keeps the batch in submission order
+                // relative to whatever was queued in between.
+                mPendingOneway.removeAt(i);
+                break;
             }
         }
+    }
 
-        // now get the next command to be processed, waiting if necessary
-        result = talkWithDriver();
-        if (result >= NO_ERROR) {
-            size_t IN = mIn.dataAvail();
-            if (IN < sizeof(int32_t)) continue;
-            cmd = mIn.readInt32();
-            IF_LOG_COMMANDS() {
-                alog << "Processing top-level Command: "
-                    << getReturnString(cmd) << endl;
-            }
+    PendingOneway pending;
+    pending.handle = handle;
+    pending.code = code;
+    pending.coalesceKey = coalesceKey;
+    pending.data = copy;
+    mPendingOneway.add(pending);
+    return NO_ERROR;
+}
 
+status_t IPCThreadState::flushOnewayTransactions()
+{
+    if (mPendingOneway.isEmpty()) {
+        return NO_ERROR;
+    }
+
+    // Take the batch first: incoming calls serviced while we wait for the
+    // driver may queue new transactions, which belong to the next batch.
+    Vector<PendingOneway> batch(mPendingOneway);
+    mPendingOneway.clear();
+    const size_t N = batch.size();
 
-            result = executeCommand(cmd);
+    // Write the whole batch into mOut so it goes to the driver in a single
+    // BINDER_WRITE_READ, then collect one BR_TRANSACTION_COMPLETE for each.
+    status_t result = NO_ERROR;
+    size_t written = 0;
+    for (size_t i=0 ; i<N ; i++) {
+        const PendingOneway& pending(batch[i]);
+        status_t err = writeTransactionData(BC_TRANSACTION, TF_ONE_WAY | TF_ACCEPT_FDS,
+                pending.handle, pending.code, *pending.data, NULL);
+        if (err == NO_ERROR) {
+            written++;
+        } else if (result == NO_ERROR) {
+            result = err;
         }
-        
-        // After executing the command, ensure that the thread is returned to the
-        // default cgroup before rejoining the pool.  The driver takes care of
-        // restoring the priority, but doesn't do anything with cgroups so we
-        // need to take care of that here in userspace.  Note that we do make
-        // sure to go in the foreground after executing a transaction, but
-        // there are other callbacks into user code that could have changed
-        // our group so we want to make absolutely sure it is put back.
-        androidSetThreadSchedulingGroup(mMyThreadId, ANDROID_TGROUP_DEFAULT);
-
-        // Let this thread exit the thread pool if it is no longer
-        // needed and it is not the main process thread.
-        if(result == TIMED_OUT && !isMain) {
-            break;
+    }
+    LOG_ONEWAY(">>>> SEND %d batched ONE WAY from pid %d uid %d", written, getpid(), getuid());
+    for (size_t i=0 ; i<written ; i++) {
+        status_t err = waitForResponse(NULL, NULL);
+        if (err != NO_ERROR && result == NO_ERROR) {
+            result = err;
         }
-    } while (result != -ECONNREFUSED && result != -EBADF);
-
-    LOG_THREADPOOL("**** THREAD %p (PID %d) IS LEAVING THE THREAD POOL err=%p\n",
-        (void*)pthread_self(), getpid(), (void*)result);
-    
-    mOut.writeInt32(BC_EXIT_LOOPER);
-    talkWithDriver(false);
-}
+    }
 
-void IPCThreadState::stopProcess(bool immediate)
-{
-    //LOGI("**** STOPPING PROCESS");
-    flushCommands();
-    int fd = mProcess->mDriverFD;
-    mProcess->mDriverFD = -1;
-    close(fd);
-    //kill(getpid(), SIGKILL);
+    for (size_t i=0 ; i<N ; i++) {
+        delete batch[i].data;
+    }
+    return result;
 }
 
 status_t IPCThreadState::transact(int32_t handle,
@@ -509,6 +773,11 @@ status_t IPCThreadState::transact(int32_t handle,
 
     flags |= TF_ACCEPT_FDS;
 
+    // Anything queued by this thread must reach the driver first.
+    if (!mPendingOneway.isEmpty()) {
+        flushOnewayTransactions();
+    }
+
     IF_LOG_TRANSACTIONS() {
         TextOutput::Bundle _b(alog);
         alog << "BC_TRANSACTION thr " << (void*)pthread_self() << " / hand "
@@ -526,7 +795,10 @@ status_t IPCThreadState::transact(int32_t handle,
         if (reply) reply->setError(err);
         return (mLastError = err);
     }
-    
+
+    TransactionStats* const stats = activeStats();
+    const nsecs_t startTime = stats ? systemTime(SYSTEM_TIME_MONOTONIC) : 0;
+
     if ((flags & TF_ONE_WAY) == 0) {
         #if 0
         if (code == 4) { // relayout
@@ -559,7 +831,12 @@ status_t IPCThreadState::transact(int32_t handle,
     } else {
         err = waitForResponse(NULL, NULL);
     }
-    
+
+    if (stats) {
+        stats->record(TransactionStats::KIND_CLIENT, (const void*)handle, code, NULL,
+                systemTime(SYSTEM_TIME_MONOTONIC) - startTime);
+    }
+
     return err;
 }
 
@@ -637,7 +914,8 @@ IPCThreadState::IPCThreadState()
     : mProcess(ProcessState::self()),
       mMyThreadId(androidGetTid()),
       mStrictModePolicy(0),
-      mLastTransactionBinderFlags(0)
+      mLastTransactionBinderFlags(0),
+      mStats(NULL)
 {
     pthread_setspecific(gTLS, this);
     clearCaller();
@@ -647,6 +925,13 @@ IPCThreadState::IPCThreadState()
 
 IPCThreadState::~IPCThreadState()
 {
+    for (size_t i=0 ; i<mPendingOneway.size() ; i++) {
+        delete mPendingOneway[i].data;
+    }
+    if (mStats) {
+        unregisterStats(mStats);
+        delete mStats;
+    }
 }
 
 status_t IPCThreadState::sendReply(const Parcel& reply, uint32_t flags)
@@ -880,6 +1165,18 @@ status_t IPCThreadState::writeTransactionData(int32_t cmd, uint32_t binderFlags,
     return NO_ERROR;
 }
 
+IPCThreadState::TransactionStats* IPCThreadState::activeStats()
+{
+    if (!statsEnabled()) {
+        return NULL;
+    }
+    if (mStats == NULL) {
+        mStats = new TransactionStats();
+        registerStats(mStats);
+    }
+    return mStats;
+}
+
 sp<BBinder> the_context_object;
 
 void setTheContextObject(sp<BBinder> obj)
@@ -1022,14 +1319,17 @@ status_t IPCThreadState::executeCommand(int32_t cmd)
                     << ", offsets addr="
                     << reinterpret_cast<const size_t*>(tr.data.ptr.offsets) << endl;
             }
-            if (tr.target.ptr) {
-                sp<BBinder> b((BBinder*)tr.cookie);
-                const status_t error = b->transact(tr.code, buffer, &reply, tr.flags);
-                if (error < NO_ERROR) reply.setError(error);
-
-            } else {
-                const status_t error = the_context_object->transact(tr.code, buffer, &reply, tr.flags);
-                if (error < NO_ERROR) reply.setError(error);
+            TransactionStats* const stats = activeStats();
+            const nsecs_t startTime = stats ? systemTime(SYSTEM_TIME_MONOTONIC) : 0;
+            android_atomic_inc(&mProcess->mBusyThreads);
+            sp<BBinder> b(tr.target.ptr ? (BBinder*)tr.cookie : the_context_object.get());
+            const status_t error = b->transact(tr.code, buffer, &reply, tr.flags);
+            if (error < NO_ERROR) reply.setError(error);
+            android_atomic_dec(&mProcess->mBusyThreads);
+            if (stats) {
+                stats->record(TransactionStats::KIND_SERVER, b.get(), tr.code,
+                        &b->getInterfaceDescriptor(),
+                        systemTime(SYSTEM_TIME_MONOTONIC) - startTime);
             }
             
             //LOGI("<<<< TRANSACT from pid %d restore pid %d uid %d\n",
@@ -1037,7 +1337,13 @@ status_t IPCThreadState::executeCommand(int32_t cmd)
             
             if ((tr.flags & TF_ONE_WAY) == 0) {
                 LOG_ONEWAY("Sending reply to %d!", mCallingPid);
+                const nsecs_t replyTime = stats ? systemTime(SYSTEM_TIME_MONOTONIC) : 0;
                 sendReply(reply, 0);
+                if (stats) {
+                    stats->record(TransactionStats::KIND_REPLY, b.get(), tr.code,
+                            &b->getInterfaceDescriptor(),
+                            systemTime(SYSTEM_TIME_MONOTONIC) - replyTime);
+                }
             } else {
                 LOG_ONEWAY("NOT sending reply to %d!", mCallingPid);
             }
@@ -19,11 +19,13 @@
 #include <binder/IServiceManager.h>
 
 #include <utils/Debug.h>
+#include <utils/KeyedVector.h>
 #include <utils/Log.h>
 #include <binder/IPCThreadState.h>
 #include <binder/Parcel.h>
 #include <utils/String8.h>
 #include <utils/SystemClock.h>
+#include <utils/threads.h>
 
 #include <private/binder/Static.h>
 
@@ -124,9 +126,69 @@ bool checkPermission(const String16& permission, pid_t pid, uid_t uid)
 
 class BpServiceManager : public BpInterface<IServiceManager>
 {
+    // Services found by name are remembered until they die, which turns
+    // the repeated getService() calls made during app startup into local
+    // lookups.  Liveness is re-checked on every hit; for a proxy that is
+    // a local flag, not a transaction.
+    class ServiceCache : public IBinder::DeathRecipient
+    {
+    public:
+        sp<IBinder> lookup(const String16& name) {
+            AutoMutex _l(mLock);
+            ssize_t index = mServices.indexOfKey(name);
+            if (index < 0) {
+                return NULL;
+            }
+            sp<IBinder> service = mServices.valueAt(index);
+            if (!service->isBinderAlive()) {
+                mServices.removeItemsAt(index);
+                return NULL;
+            }
+            return service;
+        }
+
+        void add(const String16& name, const sp<IBinder>& service) {
+            // Local binders have no death notifications and don't need
+            // the round-trip saved anyway.
+            if (service->remoteBinder() == NULL) {
+                return;
+            }
+            {
+                AutoMutex _l(mLock);
+                if (mServices.indexOfKey(name) >= 0) {
+                    return;
+                }
+                mServices.add(name, service);
+            }
+            if (service->linkToDeath(this) != NO_ERROR) {
+                AutoMutex _l(mLock);
+                mServices.removeItem(name);
+            }
+        }
+
+        void remove(const String16& name) {
+            AutoMutex _l(mLock);
+            mServices.removeItem(name);
+        }
+
+        virtual void binderDied(const wp<IBinder>& who) {
+            AutoMutex _l(mLock);
+            for (size_t i = mServices.size(); i > 0; i--) {
+                if (who == mServices.valueAt(i-1)) {
+                    mServices.removeItemsAt(i-1);
+                }
+            }
+        }
+
+    private:
+        Mutex mLock;
+        KeyedVector<String16, sp<IBinder> > mServices;
+    };
+
 public:
     BpServiceManager(const sp<IBinder>& impl)
-        : BpInterface<IServiceManager>(impl)
+        : BpInterface<IServiceManager>(impl),
+          mCache(new ServiceCache())
     {
     }
 
@@ -144,11 +206,16 @@ public:
 
     virtual sp<IBinder> checkService( const String16& name) const
     {
+        sp<IBinder> svc = mCache->lookup(name);
+        if (svc != NULL) return svc;
+
         Parcel data, reply;
         data.writeInterfaceToken(IServiceManager::getInterfaceDescriptor());
         data.writeString16(name);
         remote()->transact(CHECK_SERVICE_TRANSACTION, data, &reply);
-        return reply.readStrongBinder();
+        svc = reply.readStrongBinder();
+        if (svc != NULL) mCache->add(name, svc);
+        return svc;
     }
 
     virtual status_t addService(const String16& name, const sp<IBinder>& service)
@@ -158,6 +225,7 @@ public:
         data.writeString16(name);
         data.writeStrongBinder(service);
         status_t err = remote()->transact(ADD_SERVICE_TRANSACTION, data, &reply);
+        mCache->remove(name);
         return err == NO_ERROR ? reply.readExceptionCode() : err;
     }
 
@@ -177,6 +245,9 @@ public:
         }
         return res;
     }
+
+private:
+    const sp<ServiceCache> mCache;
 };
 
 IMPLEMENT_META_INTERFACE(ServiceManager, "android.os.IServiceManager");
@@ -20,6 +20,8 @@
 #include <binder/IPCThreadState.h>
 #include <binder/MemoryBase.h>
 
+#include <cutils/atomic.h>
+
 #include <utils/Log.h>
 #include <utils/SortedVector.h>
 #include <utils/String8.h>
@@ -112,10 +114,12 @@ public:
 class Allocation : public MemoryBase {
 public:
     Allocation(const sp<MemoryDealer>& dealer,
-            const sp<IMemoryHeap>& heap, ssize_t offset, size_t size);
+            const sp<IMemoryHeap>& heap, ssize_t offset, size_t size,
+            ssize_t slabNode = -1);
     virtual ~Allocation();
 private:
     sp<MemoryDealer> mDealer;
+    ssize_t mSlabNode;              // slab node backing this chunk, or -1
 };
 
 // ----------------------------------------------------------------------------
@@ -161,10 +165,182 @@ private:
 
 // ----------------------------------------------------------------------------
 
+/*
+ * Size-class front end for SimpleBestFitAllocator.
+ *
+ * Each class keeps the chunks it has ever carved out of the heap in a
+ * node table, and the free ones on a lock-free stack threaded through
+ * that table.  The stack head packs a 16-bit generation tag with the index
+ * of the top node (plus one, so that 0 means empty), which keeps a
+ * concurrent pop/push pair from being fooled by a recycled node.  The
+ * links live on our side rather than in the shared heap, so clients
+ * scribbling over freed memory can't corrupt the free lists.
+ */
+class SlabCache
+{
+public:
+    enum {
+        kMinSize        = 256,
+        kMaxSize        = 64*1024,
+        kStepsPerOctave = 4,        // at most 25% rounding waste
+        kNumOctaves     = 8,        // 256 .. 64K
+        kNumClasses     = kNumOctaves * kStepsPerOctave + 1,
+        kMaxNodes       = 256       // chunks per class
+    };
+
+    SlabCache();
+
+    // Returns the class serving allocations of the given size, or -1.
+    static ssize_t classFor(size_t size);
+    static size_t classSize(size_t index);
+
+    // Pops a free chunk off the class's stack; returns its node or -1.
+    ssize_t pop(size_t index, size_t* outOffset);
+    // Pushes a chunk back; node is what pop()/addNode() returned.
+    void push(size_t index, ssize_t node);
+    // Registers a chunk freshly carved out of the heap; returns its node
+    // or -1 if the class's table is full.
+    ssize_t addNode(size_t index, size_t offset);
+
+    // Removes every free chunk of every class, returning their offsets to
+    // the caller, so they can be given back to the general allocator.
+    void drain(Vector<size_t>* outOffsets);
+
+    void dump(String8& result) const;
+
+private:
+    struct SizeClass {
+        volatile int32_t head;
+        volatile int32_t numNodes;
+        volatile int32_t numFree;
+        uint32_t         offsets[kMaxNodes];
+        volatile int32_t next[kMaxNodes];
+        // Set once a drained chunk went back to the heap; the node stays
+        // retired so it can't be pushed twice.
+        volatile int32_t retired[kMaxNodes];
+    };
+
+    SizeClass mClasses[kNumClasses];
+};
+
+SlabCache::SlabCache()
+{
+    memset(mClasses, 0, sizeof(mClasses));
+}
+
+ssize_t SlabCache::classFor(size_t size)
+{
+    if (size > kMaxSize) {
+        return -1;
+    }
+    if (size <= kMinSize) {
+        return 0;
+    }
+    // Find the octave, then the quarter-step within it.
+    size_t octave = 0;
+    size_t base = kMinSize;
+    while (size > base * 2) {
+        base *= 2;
+        octave++;
+    }
+    const size_t step = base / kStepsPerOctave;
+    const size_t steps = (size - base + step - 1) / step;
+    return octave * kStepsPerOctave + steps;
+}
+
+size_t SlabCache::classSize(size_t index)
+{
+    const size_t octave = index / kStepsPerOctave;
+    const size_t steps = index % kStepsPerOctave;
+    const size_t base = size_t(kMinSize) << octave;
+    return base + steps * (base / kStepsPerOctave);
+}
+
+ssize_t SlabCache::pop(size_t index, size_t* outOffset)
+{
+    SizeClass& c(mClasses[index]);
+    int32_t head;
+    int32_t node;
+    do {
+        head = android_atomic_acquire_load(&c.head);
+        node = (head & 0xffff) - 1;
+        if (node < 0) {
+            return -1;
+        }
+        const int32_t newHead = ((head + 0x10000) & 0xffff0000) | c.next[node];
+        if (android_atomic_release_cas(head, newHead, &c.head) == 0) {
+            break;
+        }
+    } while (true);
+    android_atomic_dec(&c.numFree);
+    *outOffset = c.offsets[node];
+    return node;
+}
+
+void SlabCache::push(size_t index, ssize_t node)
+{
+    SizeClass& c(mClasses[index]);
+    int32_t head;
+    do {
+        head = android_atomic_acquire_load(&c.head);
+        c.next[node] = head & 0xffff;
+        const int32_t newHead = ((head + 0x10000) & 0xffff0000) | (node + 1);
+        if (android_atomic_release_cas(head, newHead, &c.head) == 0) {
+            break;
+        }
+    } while (true);
+    android_atomic_inc(&c.numFree);
+}
+
+ssize_t SlabCache::addNode(size_t index, size_t offset)
+{
+    SizeClass& c(mClasses[index]);
+    const int32_t node = android_atomic_inc(&c.numNodes);
+    if (node >= kMaxNodes) {
+        android_atomic_dec(&c.numNodes);
+        return -1;
+    }
+    c.offsets[node] = offset;
+    c.retired[node] = 0;
+    return node;
+}
+
+void SlabCache::drain(Vector<size_t>* outOffsets)
+{
+    for (size_t i=0 ; i<kNumClasses ; i++) {
+        size_t offset;
+        ssize_t node;
+        while ((node = pop(i, &offset)) >= 0) {
+            mClasses[i].retired[node] = 1;
+            outOffsets->add(offset);
+        }
+    }
+}
+
+void SlabCache::dump(String8& result) const
+{
+    const size_t SIZE = 256;
+    char buffer[SIZE];
+    for (size_t i=0 ; i<kNumClasses ; i++) {
+        const SizeClass& c(mClasses[i]);
+        size_t live = 0;
+        for (int32_t n=0 ; n<c.numNodes ; n++) {
+            if (!c.retired[n]) live++;
+        }
+        if (live == 0) continue;
+        snprintf(buffer, SIZE, "  slab class %6u: %3u chunks, %3d free\n",
+                (unsigned int)classSize(i), (unsigned int)live, int(c.numFree));
+        result.append(buffer);
+    }
+}
+
+// ----------------------------------------------------------------------------
+
 Allocation::Allocation(
         const sp<MemoryDealer>& dealer,
-        const sp<IMemoryHeap>& heap, ssize_t offset, size_t size)
-    : MemoryBase(heap, offset, size), mDealer(dealer)
+        const sp<IMemoryHeap>& heap, ssize_t offset, size_t size,
+        ssize_t slabNode)
+    : MemoryBase(heap, offset, size), mDealer(dealer), mSlabNode(slabNode)
 {
 #ifndef NDEBUG
     void* const start_ptr = (void*)(intptr_t(heap->base()) + offset);
@@ -176,7 +352,11 @@ Allocation::~Allocation()
 {
     size_t freedOffset = getOffset();
     size_t freedSize   = getSize();
-    if (freedSize) {
+    if (mSlabNode >= 0) {
+        // The chunk stays in its size class, ready to be handed out again;
+        // keep its pages too.
+        mDealer->deallocate(freedOffset, mSlabNode, freedSize);
+    } else if (freedSize) {
         /* NOTE: it's VERY important to not free allocations of size 0 because
          * they're special as they don't have any record in the allocator
          * and could alias some real allocation (their offset is zero). */
@@ -221,20 +401,59 @@ Allocation::~Allocation()
 
 // ----------------------------------------------------------------------------
 
-MemoryDealer::MemoryDealer(size_t size, const char* name)
+MemoryDealer::MemoryDealer(size_t size, const char* name, uint32_t flags)
     : mHeap(new MemoryHeapBase(size, 0, name)),
-    mAllocator(new SimpleBestFitAllocator(size))
+    mAllocator(new SimpleBestFitAllocator(size)),
+    mSlabs((flags & SLAB_ALLOCATION) ? new SlabCache() : NULL)
 {    
 }
 
 MemoryDealer::~MemoryDealer()
 {
+    delete mSlabs;
     delete mAllocator;
 }
 
 sp<IMemory> MemoryDealer::allocate(size_t size)
 {
     sp<IMemory> memory;
+    const ssize_t slabClass = (mSlabs && size) ? SlabCache::classFor(size) : -1;
+    if (slabClass >= 0) {
+        // Fast path: reuse a chunk of this class without locking.
+        size_t offset;
+        ssize_t node = mSlabs->pop(slabClass, &offset);
+        if (node < 0) {
+            ssize_t carved = allocator()->allocate(SlabCache::classSize(slabClass));
+            if (carved < 0) {
+                // Give the chunks parked in other classes back, and retry.
+                Vector<size_t> offsets;
+                mSlabs->drain(&offsets);
+                for (size_t i=0 ; i<offsets.size() ; i++) {
+                    allocator()->deallocate(offsets[i]);
+                }
+                carved = allocator()->allocate(SlabCache::classSize(slabClass));
+            }
+            if (carved >= 0) {
+                offset = carved;
+                node = mSlabs->addNode(slabClass, offset);
+                if (node < 0) {
+                    // Class table full: hand it out as a plain allocation.
+                    allocator()->deallocate(offset);
+                    carved = -1;
+                }
+            }
+            if (carved < 0 && node < 0) {
+                const ssize_t plain = allocator()->allocate(size);
+                if (plain >= 0) {
+                    memory = new Allocation(this, heap(), plain, size);
+                }
+                return memory;
+            }
+        }
+        memory = new Allocation(this, heap(), offset, size, node);
+        return memory;
+    }
+
     const ssize_t offset = allocator()->allocate(size);
     if (offset >= 0) {
         memory = new Allocation(this, heap(), offset, size);
@@ -247,9 +466,24 @@ void MemoryDealer::deallocate(size_t offset)
     allocator()->deallocate(offset);
 }
 
+void MemoryDealer::deallocate(size_t offset, ssize_t slabNode, size_t size)
+{
+    mSlabs->push(SlabCache::classFor(size), slabNode);
+}
+
 void MemoryDealer::dump(const char* what) const
 {
-    allocator()->dump(what);
+    String8 result;
+    dump(result, what);
+    LOGD("%s", result.string());
+}
+
+void MemoryDealer::dump(String8& result, const char* what) const
+{
+    allocator()->dump(result, what);
+    if (mSlabs) {
+        mSlabs->dump(result);
+    }
 }
 
 const sp<IMemoryHeap>& MemoryDealer::heap() const {
@@ -458,6 +692,24 @@ void SimpleBestFitAllocator::dump_l(String8& result,
     snprintf(buffer, SIZE,
             "  size allocated: %u (%u KB)\n", int(size), int(size/1024));
     result.append(buffer);
+
+    // Fragmentation: how much of the free space is unusable for a request
+    // as large as the total free space.
+    size_t freeChunks = 0;
+    size_t freeSize = 0;
+    size_t largestFree = 0;
+    for (cur = mList.head() ; cur ; cur = cur->next) {
+        if (!cur->free) continue;
+        const size_t chunkSize = cur->size*kMemoryAlign;
+        freeChunks++;
+        freeSize += chunkSize;
+        if (chunkSize > largestFree) largestFree = chunkSize;
+    }
+    snprintf(buffer, SIZE,
+            "  free: %u bytes in %u chunks, largest %u, fragmentation %u%%\n",
+            int(freeSize), int(freeChunks), int(largestFree),
+            freeSize ? int(100 - (largestFree * 100) / freeSize) : 0);
+    result.append(buffer);
 }
 
 
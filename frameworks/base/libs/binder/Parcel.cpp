@@ -500,12 +500,19 @@ bool Parcel::enforceInterface(const String16& interface,
     } else {
       threadState->setStrictModePolicy(strictPolicy);
     }
-    const String16 str(readString16());
-    if (str == interface) {
+    // Compare the token in place rather than copying it into a String16 first.
+    // A null token reads back as an empty string, as readString16() would.
+    size_t len = 0;
+    const char16_t* str = readString16Inplace(&len);
+    if (str == NULL) {
+        len = 0;
+    }
+    if (len == interface.size()
+            && (len == 0 || memcmp(str, interface.string(), len * sizeof(char16_t)) == 0)) {
         return true;
     } else {
         LOGW("**** enforceInterface() expected '%s' but read '%s'\n",
-                String8(interface).string(), String8(str).string());
+                String8(interface).string(), String8(str, len).string());
         return false;
     }
 }
@@ -773,6 +780,30 @@ status_t Parcel::writeBlob(size_t len, WritableBlob* outBlob)
     return status;
 }
 
+status_t Parcel::writeBlob(const struct iovec* segments, size_t count)
+{
+    size_t len = 0;
+    for (size_t i=0 ; i<count ; i++) {
+        if (len + segments[i].iov_len < len) {
+            // integer overflow
+            return BAD_VALUE;
+        }
+        len += segments[i].iov_len;
+    }
+
+    WritableBlob blob;
+    status_t status = writeBlob(len, &blob);
+    if (status) return status;
+
+    uint8_t* dest = reinterpret_cast<uint8_t*>(blob.data());
+    for (size_t i=0 ; i<count ; i++) {
+        memcpy(dest, segments[i].iov_base, segments[i].iov_len);
+        dest += segments[i].iov_len;
+    }
+    blob.release();
+    return NO_ERROR;
+}
+
 status_t Parcel::write(const Flattenable& val)
 {
     status_t err;
@@ -787,9 +818,11 @@ status_t Parcel::write(const Flattenable& val)
     err = this->writeInt32(fd_count);
     if (err) return err;
 
-    // payload
-    void* buf = this->writeInplace(PAD_SIZE(len));
-    if (buf == NULL)
+    // payload: flattened directly into a blob, so large objects go
+    // out-of-line through ashmem instead of growing mData.
+    WritableBlob blob;
+    err = this->writeBlob(PAD_SIZE(len), &blob);
+    if (err)
         return BAD_VALUE;
 
     int* fds = NULL;
@@ -797,7 +830,8 @@ status_t Parcel::write(const Flattenable& val)
         fds = new int[fd_count];
     }
 
-    err = val.flatten(buf, len, fds, fd_count);
+    err = val.flatten(blob.data(), len, fds, fd_count);
+    blob.release();
     for (size_t i=0 ; i<fd_count && err==NO_ERROR ; i++) {
         err = this->writeDupFileDescriptor( fds[i] );
     }
@@ -1115,7 +1149,7 @@ status_t Parcel::readBlob(size_t len, ReadableBlob* outBlob) const
     if (fd == int(BAD_TYPE)) return BAD_VALUE;
 
     void* ptr = ::mmap(NULL, len, PROT_READ, MAP_SHARED, fd, 0);
-    if (!ptr) return NO_MEMORY;
+    if (ptr == MAP_FAILED) return NO_MEMORY;
 
     outBlob->init(true /*mapped*/, ptr, len);
     return NO_ERROR;
@@ -1128,8 +1162,8 @@ status_t Parcel::read(Flattenable& val) const
     const size_t fd_count = this->readInt32();
 
     // payload
-    void const* buf = this->readInplace(PAD_SIZE(len));
-    if (buf == NULL)
+    ReadableBlob blob;
+    if (this->readBlob(PAD_SIZE(len), &blob) != NO_ERROR)
         return BAD_VALUE;
 
     int* fds = NULL;
@@ -1144,8 +1178,9 @@ status_t Parcel::read(Flattenable& val) const
     }
 
     if (err == NO_ERROR) {
-        err = val.unflatten(buf, len, fds, fd_count);
+        err = val.unflatten(blob.data(), len, fds, fd_count);
     }
+    blob.release();
 
     if (fd_count) {
         delete [] fds;
@@ -31,7 +31,8 @@ ANDROID_SINGLETON_STATIC_INSTANCE(PermissionCache) ;
 
 // ----------------------------------------------------------------------------
 
-PermissionCache::PermissionCache() {
+PermissionCache::PermissionCache()
+    : mHits(0), mMisses(0) {
 }
 
 status_t PermissionCache::check(bool* granted,
@@ -43,8 +44,10 @@ status_t PermissionCache::check(bool* granted,
     ssize_t index = mCache.indexOf(e);
     if (index >= 0) {
         *granted = mCache.itemAt(index).granted;
+        mHits++;
         return NO_ERROR;
     }
+    mMisses++;
     return NAME_NOT_FOUND;
 }
 
@@ -53,7 +56,7 @@ void PermissionCache::cache(const String16& permission,
     Mutex::Autolock _l(mLock);
     Entry e;
     ssize_t index = mPermissionNamesPool.indexOf(permission);
-    if (index > 0) {
+    if (index >= 0) {
         e.name = mPermissionNamesPool.itemAt(index);
     } else {
         mPermissionNamesPool.add(permission);
@@ -74,6 +77,17 @@ void PermissionCache::purge() {
     mCache.clear();
 }
 
+void PermissionCache::invalidate() {
+    PermissionCache::getInstance().purge();
+}
+
+void PermissionCache::getStatistics(uint32_t* outHits, uint32_t* outMisses) {
+    PermissionCache& pc(PermissionCache::getInstance());
+    Mutex::Autolock _l(pc.mLock);
+    *outHits = pc.mHits;
+    *outMisses = pc.mMisses;
+}
+
 bool PermissionCache::checkCallingPermission(const String16& permission) {
     return PermissionCache::checkCallingPermission(permission, NULL, NULL);
 }
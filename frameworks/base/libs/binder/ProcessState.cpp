@@ -42,6 +42,7 @@
 #include <sys/stat.h>
 
 #define BINDER_VM_SIZE ((1*1024*1024) - (4096 *2))
+#define DEFAULT_MAX_BINDER_THREADS 15
 
 
 // ---------------------------------------------------------------------------
@@ -137,8 +138,63 @@ void ProcessState::startThreadPool()
     AutoMutex _l(mLock);
     if (!mThreadPoolStarted) {
         mThreadPoolStarted = true;
-        spawnPooledThread(true);
+        // The minimum set is entered as "main" loopers: the driver accepts
+        // those without having requested them, and they never retire.
+        const size_t N = mMinThreads > 0 ? mMinThreads : 1;
+        for (size_t i=0 ; i<N ; i++) {
+            spawnPooledThread(true);
+        }
+    }
+}
+
+status_t ProcessState::setThreadPoolConfiguration(size_t minThreads,
+        size_t maxThreads, nsecs_t idleTimeout)
+{
+    if (minThreads > maxThreads) {
+        return BAD_VALUE;
+    }
+    AutoMutex _l(mLock);
+    mMinThreads = minThreads;
+    mMaxThreads = maxThreads;
+    mIdleTimeout = idleTimeout;
+    return updateDriverMaxThreadsLocked();
+}
+
+size_t ProcessState::getThreadPoolThreadCount() const
+{
+    return size_t(mPooledThreads);
+}
+
+size_t ProcessState::getThreadPoolBusyThreadCount() const
+{
+    return size_t(mBusyThreads);
+}
+
+status_t ProcessState::updateDriverMaxThreadsLocked()
+{
+    // The driver only counts the threads it requests itself, which
+    // excludes the ones entered by startThreadPool().
+    const size_t entered = mMinThreads > 0 ? mMinThreads : 1;
+    size_t maxThreads = mMaxThreads > entered ? mMaxThreads - entered : 0;
+    maxThreads += mRetiredThreads;
+    if (ioctl(mDriverFD, BINDER_SET_MAX_THREADS, &maxThreads) == -1) {
+        LOGE("Binder ioctl to set max threads failed: %s", strerror(errno));
+        return -errno;
+    }
+    return NO_ERROR;
+}
+
+bool ProcessState::retirePooledThread()
+{
+    AutoMutex _l(mLock);
+    const size_t entered = mMinThreads > 0 ? mMinThreads : 1;
+    if (mIdleTimeout <= 0 || size_t(mPooledThreads) <= entered) {
+        return false;
     }
+    android_atomic_dec(&mPooledThreads);
+    mRetiredThreads++;
+    updateDriverMaxThreadsLocked();
+    return true;
 }
 
 bool ProcessState::isContextManager(void) const
@@ -311,7 +367,7 @@ static int open_driver()
             close(fd);
             fd = -1;
         }
-        size_t maxThreads = 15;
+        size_t maxThreads = DEFAULT_MAX_BINDER_THREADS;
         result = ioctl(fd, BINDER_SET_MAX_THREADS, &maxThreads);
         if (result == -1) {
             LOGE("Binder ioctl to set max threads failed: %s", strerror(errno));
@@ -330,6 +386,12 @@ ProcessState::ProcessState()
     , mBinderContextUserData(NULL)
     , mThreadPoolStarted(false)
     , mThreadPoolSeq(1)
+    , mMinThreads(0)
+    , mMaxThreads(DEFAULT_MAX_BINDER_THREADS + 1)
+    , mIdleTimeout(0)
+    , mRetiredThreads(0)
+    , mPooledThreads(0)
+    , mBusyThreads(0)
 {
     if (mDriverFD >= 0) {
         // XXX Ideally, there should be a specific define for whether we
@@ -0,0 +1,15 @@
+# Build the micro-benchmarks.
+LOCAL_PATH := $(call my-dir)
+
+include $(CLEAR_VARS)
+LOCAL_SRC_FILES := Binder_benchmark.cpp
+LOCAL_C_INCLUDES := frameworks/base/libs/utils/benchmarks
+LOCAL_SHARED_LIBRARIES := \
+	liblog \
+	libcutils \
+	libutils \
+	libbinder
+LOCAL_STATIC_LIBRARIES := libbenchmark
+LOCAL_MODULE := libbinder_benchmark
+LOCAL_MODULE_TAGS := eng tests
+include $(BUILD_EXECUTABLE)
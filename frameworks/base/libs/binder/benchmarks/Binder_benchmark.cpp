@@ -0,0 +1,312 @@
+/*
+ * Copyright (C) 2011 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <Benchmark.h>
+
+#include <binder/Binder.h>
+#include <binder/IPCThreadState.h>
+#include <binder/IServiceManager.h>
+#include <binder/Parcel.h>
+#include <binder/ProcessState.h>
+#include <utils/String16.h>
+
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace android;
+using namespace android::benchmark;
+
+// The echo service is registered under this name.  Registering a service
+// requires running as root or system.
+static const char* kServiceName = "benchmark.binder.echo";
+
+// Each write benchmark rewinds its parcel after this many values, so that
+// it measures the writes rather than the growth of the parcel.
+static const int kValuesPerParcel = 1024;
+
+static volatile int sSink;
+
+enum {
+    ECHO_TRANSACTION = IBinder::FIRST_CALL_TRANSACTION,
+};
+
+// Replies with the payload it was sent.
+class EchoService : public BBinder {
+protected:
+    virtual status_t onTransact(uint32_t code, const Parcel& data, Parcel* reply,
+            uint32_t flags) {
+        if (code != ECHO_TRANSACTION) {
+            return BBinder::onTransact(code, data, reply, flags);
+        }
+
+        size_t size = data.readInt32();
+        if (size) {
+            const void* payload = data.readInplace(size);
+            if (!payload) {
+                return BAD_VALUE;
+            }
+            reply->write(payload, size);
+        }
+        return NO_ERROR;
+    }
+};
+
+static pid_t sServicePid = -1;
+static sp<IBinder> sService;
+
+// Runs the echo service in a child process.  This has to happen before this
+// process opens the binder driver, which it cannot share with a child.
+static void startService() {
+    sServicePid = fork();
+    if (sServicePid == 0) {
+        defaultServiceManager()->addService(String16(kServiceName), new EchoService());
+        ProcessState::self()->startThreadPool();
+        IPCThreadState::self()->joinThreadPool();
+        _exit(0);
+    }
+
+    if (sServicePid > 0) {
+        sService = defaultServiceManager()->getService(String16(kServiceName));
+    }
+}
+
+static void stopService() {
+    sService.clear();
+    if (sServicePid > 0) {
+        kill(sServicePid, SIGKILL);
+        waitpid(sServicePid, NULL, 0);
+    }
+}
+
+// --- Parcel ---
+
+static void Parcel_writeInt32(int iterations) {
+    Parcel p;
+    for (int i = 0; i < iterations; i++) {
+        if (i % kValuesPerParcel == 0) {
+            p.setDataPosition(0);
+        }
+        p.writeInt32(i);
+    }
+}
+BENCHMARK(Parcel_writeInt32);
+
+static void Parcel_writeInt64(int iterations) {
+    Parcel p;
+    for (int i = 0; i < iterations; i++) {
+        if (i % kValuesPerParcel == 0) {
+            p.setDataPosition(0);
+        }
+        p.writeInt64(i);
+    }
+}
+BENCHMARK(Parcel_writeInt64);
+
+static void Parcel_writeDouble(int iterations) {
+    Parcel p;
+    for (int i = 0; i < iterations; i++) {
+        if (i % kValuesPerParcel == 0) {
+            p.setDataPosition(0);
+        }
+        p.writeDouble(i);
+    }
+}
+BENCHMARK(Parcel_writeDouble);
+
+static void Parcel_writeCString(int iterations) {
+    Parcel p;
+    for (int i = 0; i < iterations; i++) {
+        if (i % kValuesPerParcel == 0) {
+            p.setDataPosition(0);
+        }
+        p.writeCString("android.permission.INTERNET");
+    }
+}
+BENCHMARK(Parcel_writeCString);
+
+static void Parcel_writeString16(int iterations) {
+    stopTiming();
+    String16 s("android.permission.INTERNET");
+    Parcel p;
+    startTiming();
+
+    for (int i = 0; i < iterations; i++) {
+        if (i % kValuesPerParcel == 0) {
+            p.setDataPosition(0);
+        }
+        p.writeString16(s);
+    }
+}
+BENCHMARK(Parcel_writeString16);
+
+static void Parcel_write1K(int iterations) {
+    stopTiming();
+    char buffer[1024];
+    memset(buffer, 0x5a, sizeof(buffer));
+    Parcel p;
+    startTiming();
+
+    for (int i = 0; i < iterations; i++) {
+        if (i % 64 == 0) {
+            p.setDataPosition(0);
+        }
+        p.write(buffer, sizeof(buffer));
+    }
+    setBytesPerIteration(sizeof(buffer));
+}
+BENCHMARK(Parcel_write1K);
+
+// Each iteration flattens a local binder into a new parcel and releases it.
+static void Parcel_writeStrongBinder(int iterations) {
+    sp<IBinder> binder = new BBinder();
+    for (int i = 0; i < iterations; i++) {
+        Parcel p;
+        p.writeStrongBinder(binder);
+    }
+}
+BENCHMARK(Parcel_writeStrongBinder);
+
+static void Parcel_readInt32(int iterations) {
+    stopTiming();
+    Parcel p;
+    for (int i = 0; i < kValuesPerParcel; i++) {
+        p.writeInt32(i);
+    }
+    startTiming();
+
+    int sum = 0;
+    for (int i = 0; i < iterations; i++) {
+        if (i % kValuesPerParcel == 0) {
+            p.setDataPosition(0);
+        }
+        sum += p.readInt32();
+    }
+    sSink = sum;
+}
+BENCHMARK(Parcel_readInt32);
+
+static void Parcel_readString16(int iterations) {
+    stopTiming();
+    Parcel p;
+    String16 s("android.permission.INTERNET");
+    for (int i = 0; i < kValuesPerParcel; i++) {
+        p.writeString16(s);
+    }
+    startTiming();
+
+    int length = 0;
+    for (int i = 0; i < iterations; i++) {
+        if (i % kValuesPerParcel == 0) {
+            p.setDataPosition(0);
+        }
+        length += p.readString16().size();
+    }
+    sSink = length;
+}
+BENCHMARK(Parcel_readString16);
+
+static void Parcel_readStrongBinder(int iterations) {
+    stopTiming();
+    sp<IBinder> binder = new BBinder();
+    Parcel p;
+    p.writeStrongBinder(binder);
+    startTiming();
+
+    int found = 0;
+    for (int i = 0; i < iterations; i++) {
+        p.setDataPosition(0);
+        found += p.readStrongBinder() != NULL;
+    }
+    sSink = found;
+}
+BENCHMARK(Parcel_readStrongBinder);
+
+// --- Binder transactions ---
+
+// A transaction on a binder in this process, which does not go through the
+// driver: the cost of the call around the parcels.
+static void Binder_transactLocal(int iterations) {
+    sp<IBinder> binder = new EchoService();
+    Parcel data;
+    data.writeInt32(0);
+    for (int i = 0; i < iterations; i++) {
+        Parcel reply;
+        binder->transact(ECHO_TRANSACTION, data, &reply);
+    }
+}
+BENCHMARK(Binder_transactLocal);
+
+// One iteration sends "size" bytes to the echo service and gets them back.
+static void roundTrip(int iterations, size_t size) {
+    if (sService == NULL) {
+        skip("the echo service is not running");
+        return;
+    }
+
+    stopTiming();
+    Parcel data;
+    data.writeInt32(size);
+    if (size) {
+        memset(data.writeInplace(size), 0x5a, size);
+    }
+    startTiming();
+
+    for (int i = 0; i < iterations; i++) {
+        Parcel reply;
+        if (sService->transact(ECHO_TRANSACTION, data, &reply) != NO_ERROR) {
+            skip("the echo transaction failed");
+            return;
+        }
+    }
+
+    // The payload crosses the driver in both directions.
+    setBytesPerIteration(2 * size);
+}
+
+static void Binder_roundTrip0(int iterations) {
+    roundTrip(iterations, 0);
+}
+BENCHMARK(Binder_roundTrip0);
+
+static void Binder_roundTrip64(int iterations) {
+    roundTrip(iterations, 64);
+}
+BENCHMARK(Binder_roundTrip64);
+
+static void Binder_roundTrip1K(int iterations) {
+    roundTrip(iterations, 1024);
+}
+BENCHMARK(Binder_roundTrip1K);
+
+static void Binder_roundTrip16K(int iterations) {
+    roundTrip(iterations, 16 * 1024);
+}
+BENCHMARK(Binder_roundTrip16K);
+
+static void Binder_roundTrip256K(int iterations) {
+    roundTrip(iterations, 256 * 1024);
+}
+BENCHMARK(Binder_roundTrip256K);
+
+int main(int argc, char** argv) {
+    startService();
+    int status = runBenchmarks(argc, argv);
+    stopService();
+    return status;
+}
@@ -4,7 +4,8 @@ include $(CLEAR_VARS)
 
 LOCAL_SRC_FILES :=     \
         CentralTendencyStatistics.cpp \
-        ThreadCpuUsage.cpp
+        ThreadCpuUsage.cpp \
+        ThreadCpuUsageLogger.cpp
 
 LOCAL_MODULE := libcpustats
 
@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2011 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "ThreadCpuUsage"
+
+#include <utils/Log.h>
+
+#include <cpustats/ThreadCpuUsageLogger.h>
+
+void ThreadCpuUsageLogger::sample()
+{
+    mCpu.sampleAndEnable();
+    const CentralTendencyStatistics& stats = mCpu.statistics();
+    unsigned n = stats.n();
+    // mCpu.elapsed() is expensive, so don't call it every cycle
+    if ((n & 127) != 1) {
+        return;
+    }
+    long long elapsed = mCpu.elapsed();
+    if (elapsed < mIntervalNs) {
+        return;
+    }
+    double perLoop = elapsed / (double) n;
+    double perLoop100 = perLoop * 0.01;
+    double mean = stats.mean();
+    double stddev = stats.stddev();
+    double minimum = stats.minimum();
+    double maximum = stats.maximum();
+    mCpu.resetStatistics();
+    LOGI("%s: CPU usage over past %.1f secs (%u loops at %.1f mean ms per loop):\n"
+            "  us per loop: mean=%.0f stddev=%.0f min=%.0f max=%.0f\n"
+            "  %% of wall: mean=%.1f stddev=%.1f min=%.1f max=%.1f",
+            mName, elapsed * .000000001, n, perLoop * .000001,
+            mean * .001,
+            stddev * .001,
+            minimum * .001,
+            maximum * .001,
+            mean / perLoop100,
+            stddev / perLoop100,
+            minimum / perLoop100,
+            maximum / perLoop100);
+}
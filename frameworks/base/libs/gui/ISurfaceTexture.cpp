@@ -101,12 +101,16 @@ public:
         return result;
     }
 
-    virtual status_t queueBuffer(int buf, int64_t timestamp,
+    virtual status_t queueBuffer(int buf, int64_t timestamp, const Rect& dirty,
             uint32_t* outWidth, uint32_t* outHeight, uint32_t* outTransform) {
         Parcel data, reply;
         data.writeInterfaceToken(ISurfaceTexture::getInterfaceDescriptor());
         data.writeInt32(buf);
         data.writeInt64(timestamp);
+        data.writeInt32(dirty.left);
+        data.writeInt32(dirty.top);
+        data.writeInt32(dirty.right);
+        data.writeInt32(dirty.bottom);
         status_t result = remote()->transact(QUEUE_BUFFER, data, &reply);
         if (result != NO_ERROR) {
             return result;
@@ -261,8 +265,13 @@ status_t BnSurfaceTexture::onTransact(
             CHECK_INTERFACE(ISurfaceTexture, data, reply);
             int buf = data.readInt32();
             int64_t timestamp = data.readInt64();
+            Rect dirty;
+            dirty.left = data.readInt32();
+            dirty.top = data.readInt32();
+            dirty.right = data.readInt32();
+            dirty.bottom = data.readInt32();
             uint32_t outWidth, outHeight, outTransform;
-            status_t result = queueBuffer(buf, timestamp,
+            status_t result = queueBuffer(buf, timestamp, dirty,
                     &outWidth, &outHeight, &outTransform);
             reply->writeInt32(outWidth);
             reply->writeInt32(outHeight);
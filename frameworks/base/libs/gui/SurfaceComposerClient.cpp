@@ -19,6 +19,8 @@
 #include <stdint.h>
 #include <sys/types.h>
 
+#include <cutils/atomic.h>
+
 #include <utils/Errors.h>
 #include <utils/Log.h>
 #include <utils/Singleton.h>
@@ -147,7 +149,14 @@ void Composer::closeGlobalTransactionImpl() {
         mOrientation = ISurfaceComposer::eOrientationUnchanged;
     }
 
-   sm->setTransactionState(transaction, orientation);
+    // Nothing was batched since the last close: don't bother SurfaceFlinger
+    // with an empty transaction.
+    if (transaction.isEmpty() &&
+            orientation == ISurfaceComposer::eOrientationUnchanged) {
+        return;
+    }
+
+    sm->setTransactionState(transaction, orientation);
 }
 
 layer_state_t* Composer::getLayerStateLocked(
@@ -494,6 +503,25 @@ ssize_t SurfaceComposerClient::getDisplayOrientation(DisplayID dpy)
     return dcblk->orientation;
 }
 
+status_t SurfaceComposerClient::getVSyncTiming(DisplayID dpy,
+        nsecs_t* lastVSyncTime, nsecs_t* period)
+{
+    if (uint32_t(dpy)>=NUM_DISPLAY_MAX)
+        return BAD_VALUE;
+    volatile surface_flinger_cblk_t const * cblk = get_cblk();
+    volatile display_cblk_t const * dcblk = cblk->displays + dpy;
+    int32_t seq;
+    nsecs_t when;
+    do {
+        seq = android_atomic_acquire_load(&dcblk->vsyncSequence);
+        when = dcblk->lastVSyncTime;
+    } while ((seq & 1) ||
+            seq != android_atomic_release_load(&dcblk->vsyncSequence));
+    *lastVSyncTime = when;
+    *period = dcblk->vsyncPeriod;
+    return NO_ERROR;
+}
+
 ssize_t SurfaceComposerClient::getNumberOfDisplays()
 {
     volatile surface_flinger_cblk_t const * cblk = get_cblk();
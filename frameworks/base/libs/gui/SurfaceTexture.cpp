@@ -95,19 +95,22 @@ static int32_t createProcessUniqueId() {
 }
 
 SurfaceTexture::SurfaceTexture(GLuint tex, bool allowSynchronousMode,
-        GLenum texTarget) :
+        GLenum texTarget, const sp<IGraphicBufferAlloc>& allocator) :
     mDefaultWidth(1),
     mDefaultHeight(1),
     mPixelFormat(PIXEL_FORMAT_RGBA_8888),
     mBufferCount(MIN_ASYNC_BUFFER_SLOTS),
     mClientBufferCount(0),
     mServerBufferCount(MIN_ASYNC_BUFFER_SLOTS),
+    mFrameCounter(0),
+    mBufferAge(0),
     mCurrentTexture(INVALID_BUFFER_SLOT),
     mCurrentTransform(0),
     mCurrentTimestamp(0),
     mNextTransform(0),
     mNextScalingMode(NATIVE_WINDOW_SCALING_MODE_FREEZE),
     mTexName(tex),
+    mGraphicBufferAlloc(allocator),
     mSynchronousMode(false),
     mAllowSynchronousMode(allowSynchronousMode),
     mConnectedApi(NO_CONNECTED_API),
@@ -117,8 +120,10 @@ SurfaceTexture::SurfaceTexture(GLuint tex, bool allowSynchronousMode,
     mName = String8::format("unnamed-%d-%d", getpid(), createProcessUniqueId());
 
     ST_LOGV("SurfaceTexture::SurfaceTexture");
-    sp<ISurfaceComposer> composer(ComposerService::getComposerService());
-    mGraphicBufferAlloc = composer->createGraphicBufferAlloc();
+    if (mGraphicBufferAlloc == 0) {
+        sp<ISurfaceComposer> composer(ComposerService::getComposerService());
+        mGraphicBufferAlloc = composer->createGraphicBufferAlloc();
+    }
     mNextCrop.makeInvalid();
     memcpy(mCurrentTransformMatrix, mtxIdentity,
             sizeof(mCurrentTransformMatrix));
@@ -420,6 +425,7 @@ status_t SurfaceTexture::dequeueBuffer(int *outBuf, uint32_t w, uint32_t h,
         }
         mSlots[buf].mGraphicBuffer = graphicBuffer;
         mSlots[buf].mRequestBufferCalled = false;
+        mSlots[buf].mFrameNumber = 0;
         if (mSlots[buf].mEglImage != EGL_NO_IMAGE_KHR) {
             eglDestroyImageKHR(mSlots[buf].mEglDisplay, mSlots[buf].mEglImage);
             mSlots[buf].mEglImage = EGL_NO_IMAGE_KHR;
@@ -427,6 +433,9 @@ status_t SurfaceTexture::dequeueBuffer(int *outBuf, uint32_t w, uint32_t h,
         }
         returnFlags |= ISurfaceTexture::BUFFER_NEEDS_REALLOCATION;
     }
+
+    const uint64_t frameNumber = mSlots[buf].mFrameNumber;
+    mBufferAge = frameNumber ? int(mFrameCounter + 1 - frameNumber) : 0;
     return returnFlags;
 }
 
@@ -460,7 +469,28 @@ status_t SurfaceTexture::setSynchronousMode(bool enabled) {
     return err;
 }
 
+// Returns the smallest rectangle covering both damage rectangles, where an
+// invalid rectangle stands for the whole buffer.
+static Rect unionDamage(const Rect& a, const Rect& b) {
+    if (!a.isValid() || !b.isValid()) {
+        Rect whole;
+        whole.makeInvalid();
+        return whole;
+    }
+    if (a.isEmpty()) {
+        return b;
+    }
+    if (b.isEmpty()) {
+        return a;
+    }
+    return Rect(a.left < b.left ? a.left : b.left,
+            a.top < b.top ? a.top : b.top,
+            a.right > b.right ? a.right : b.right,
+            a.bottom > b.bottom ? a.bottom : b.bottom);
+}
+
 status_t SurfaceTexture::queueBuffer(int buf, int64_t timestamp,
+        const Rect& dirty,
         uint32_t* outWidth, uint32_t* outHeight, uint32_t* outTransform) {
     ST_LOGV("SurfaceTexture::queueBuffer");
 
@@ -489,6 +519,7 @@ status_t SurfaceTexture::queueBuffer(int buf, int64_t timestamp,
             return -EINVAL;
         }
 
+        mSlots[buf].mDirty = dirty;
         if (mSynchronousMode) {
             // In synchronous mode we queue all buffers in a FIFO.
             mQueue.push_back(buf);
@@ -507,8 +538,10 @@ status_t SurfaceTexture::queueBuffer(int buf, int64_t timestamp,
                 listener = mFrameAvailableListener;
             } else {
                 Fifo::iterator front(mQueue.begin());
-                // buffer currently queued is freed
+                // buffer currently queued is freed, and what it changed
+                // must now be picked up from the new one
                 mSlots[*front].mBufferState = BufferSlot::FREE;
+                mSlots[buf].mDirty = unionDamage(mSlots[*front].mDirty, dirty);
                 // and we record the new buffer index in the queued list
                 *front = buf;
             }
@@ -519,6 +552,7 @@ status_t SurfaceTexture::queueBuffer(int buf, int64_t timestamp,
         mSlots[buf].mTransform = mNextTransform;
         mSlots[buf].mScalingMode = mNextScalingMode;
         mSlots[buf].mTimestamp = timestamp;
+        mSlots[buf].mFrameNumber = ++mFrameCounter;
         mDequeueCondition.signal();
 
         *outWidth = mDefaultWidth;
@@ -725,6 +759,7 @@ status_t SurfaceTexture::updateTexImage() {
         mCurrentTexture = buf;
         mCurrentTextureBuf = mSlots[buf].mGraphicBuffer;
         mCurrentCrop = mSlots[buf].mCrop;
+        mCurrentDirty = mSlots[buf].mDirty;
         mCurrentTransform = mSlots[buf].mTransform;
         mCurrentScalingMode = mSlots[buf].mScalingMode;
         mCurrentTimestamp = mSlots[buf].mTimestamp;
@@ -877,6 +912,7 @@ void SurfaceTexture::setFrameAvailableListener(
 void SurfaceTexture::freeBufferLocked(int i) {
     mSlots[i].mGraphicBuffer = 0;
     mSlots[i].mBufferState = BufferSlot::FREE;
+    mSlots[i].mFrameNumber = 0;
     if (mSlots[i].mEglImage != EGL_NO_IMAGE_KHR) {
         eglDestroyImageKHR(mSlots[i].mEglDisplay, mSlots[i].mEglImage);
         mSlots[i].mEglImage = EGL_NO_IMAGE_KHR;
@@ -962,6 +998,11 @@ Rect SurfaceTexture::getCurrentCrop() const {
     return mCurrentCrop;
 }
 
+Rect SurfaceTexture::getCurrentDirty() const {
+    Mutex::Autolock lock(mMutex);
+    return mCurrentDirty;
+}
+
 uint32_t SurfaceTexture::getCurrentTransform() const {
     Mutex::Autolock lock(mMutex);
     return mCurrentTransform;
@@ -996,6 +1037,9 @@ int SurfaceTexture::query(int what, int* outValue)
         value = mSynchronousMode ?
                 (MIN_UNDEQUEUED_BUFFERS-1) : MIN_UNDEQUEUED_BUFFERS;
         break;
+    case NATIVE_WINDOW_BUFFER_AGE:
+        value = mBufferAge;
+        break;
     default:
         return BAD_VALUE;
     }
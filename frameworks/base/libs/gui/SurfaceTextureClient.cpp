@@ -57,6 +57,7 @@ void SurfaceTextureClient::init() {
     mDefaultWidth = 0;
     mDefaultHeight = 0;
     mTransformHint = 0;
+    mDirtyRect.makeInvalid();
     mConnectedToCpu = false;
 }
 
@@ -219,8 +220,9 @@ int SurfaceTextureClient::queueBuffer(android_native_buffer_t* buffer) {
     if (i < 0) {
         return i;
     }
-    status_t err = mSurfaceTexture->queueBuffer(i, timestamp,
+    status_t err = mSurfaceTexture->queueBuffer(i, timestamp, mDirtyRect,
             &mDefaultWidth, &mDefaultHeight, &mTransformHint);
+    mDirtyRect.makeInvalid();
     if (err != OK)  {
         LOGE("queueBuffer: error queuing buffer to SurfaceTexture, %d", err);
     }
@@ -650,6 +652,12 @@ status_t SurfaceTextureClient::lock(
                 *inOutDirtyBounds = newDirtyRegion.getBounds();
             }
 
+            // everything else is the same as in the front buffer
+            {
+                Mutex::Autolock lock(mMutex);
+                mDirtyRect = newDirtyRegion.getBounds();
+            }
+
             void* vaddr;
             status_t res = backBuffer->lock(
                     GRALLOC_USAGE_SW_READ_OFTEN | GRALLOC_USAGE_SW_WRITE_OFTEN,
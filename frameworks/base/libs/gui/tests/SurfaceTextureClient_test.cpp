@@ -374,6 +374,40 @@ TEST_F(SurfaceTextureClientTest, SurfaceTextureSyncModeDQQR) {
     EXPECT_EQ(mST->getCurrentBuffer().get(), buf[2]);
 }
 
+TEST_F(SurfaceTextureClientTest, BufferAgeTracksQueuedFrames) {
+    android_native_buffer_t* buf[3];
+    int age;
+    ASSERT_EQ(OK, mST->setSynchronousMode(true));
+    ASSERT_EQ(OK, native_window_set_buffer_count(mANW.get(), 3));
+
+    // Freshly allocated buffers have no usable contents.
+    for (int i = 0; i < 3; i++) {
+        ASSERT_EQ(OK, mANW->dequeueBuffer(mANW.get(), &buf[i]));
+        ASSERT_EQ(OK, mANW->query(mANW.get(), NATIVE_WINDOW_BUFFER_AGE, &age));
+        EXPECT_EQ(0, age);
+    }
+    for (int i = 0; i < 3; i++) {
+        ASSERT_EQ(OK, mANW->queueBuffer(mANW.get(), buf[i]));
+        EXPECT_EQ(OK, mST->updateTexImage());
+    }
+
+    // buf[0] holds frame 1 of 3.
+    android_native_buffer_t* next;
+    ASSERT_EQ(OK, mANW->dequeueBuffer(mANW.get(), &next));
+    EXPECT_EQ(buf[0], next);
+    ASSERT_EQ(OK, mANW->query(mANW.get(), NATIVE_WINDOW_BUFFER_AGE, &age));
+    EXPECT_EQ(3, age);
+    ASSERT_EQ(OK, mANW->queueBuffer(mANW.get(), next));
+    EXPECT_EQ(OK, mST->updateTexImage());
+
+    // buf[1] holds frame 2 of 4.
+    ASSERT_EQ(OK, mANW->dequeueBuffer(mANW.get(), &next));
+    EXPECT_EQ(buf[1], next);
+    ASSERT_EQ(OK, mANW->query(mANW.get(), NATIVE_WINDOW_BUFFER_AGE, &age));
+    EXPECT_EQ(3, age);
+    ASSERT_EQ(OK, mANW->cancelBuffer(mANW.get(), next));
+}
+
 // XXX: We currently have no hardware that properly handles dequeuing the
 // buffer that is currently bound to the texture.
 TEST_F(SurfaceTextureClientTest, DISABLED_SurfaceTextureSyncModeDequeueCurrent) {
@@ -585,6 +619,33 @@ TEST_F(SurfaceTextureClientTest, GetTransformMatrixSucceedsAfterFreeingBuffersWi
 
 // This test verifies that the buffer format can be queried immediately after
 // it is set.
+TEST_F(SurfaceTextureClientTest, QueuedBufferDamageDefaultsToWholeBuffer) {
+    android_native_buffer_t* buf;
+    ASSERT_EQ(OK, mANW->dequeueBuffer(mANW.get(), &buf));
+    ASSERT_EQ(OK, mANW->queueBuffer(mANW.get(), buf));
+    ASSERT_EQ(OK, mST->updateTexImage());
+    EXPECT_FALSE(mST->getCurrentDirty().isValid());
+}
+
+TEST_F(SurfaceTextureClientTest, LockedDirtyBoundsAreQueuedAsDamage) {
+    ANativeWindow_Buffer buffer;
+    ASSERT_EQ(OK, native_window_set_buffers_geometry(mANW.get(), 16, 16,
+            PIXEL_FORMAT_RGBA_8888));
+
+    // nothing to copy back from yet, so the whole buffer is damaged
+    ARect dirty = { 2, 3, 5, 7 };
+    ASSERT_EQ(OK, mANW->perform(mANW.get(), NATIVE_WINDOW_LOCK, &buffer, &dirty));
+    ASSERT_EQ(OK, mANW->perform(mANW.get(), NATIVE_WINDOW_UNLOCK_AND_POST));
+    ASSERT_EQ(OK, mST->updateTexImage());
+    EXPECT_TRUE(Rect(16, 16) == mST->getCurrentDirty());
+
+    dirty.left = 2; dirty.top = 3; dirty.right = 5; dirty.bottom = 7;
+    ASSERT_EQ(OK, mANW->perform(mANW.get(), NATIVE_WINDOW_LOCK, &buffer, &dirty));
+    ASSERT_EQ(OK, mANW->perform(mANW.get(), NATIVE_WINDOW_UNLOCK_AND_POST));
+    ASSERT_EQ(OK, mST->updateTexImage());
+    EXPECT_TRUE(Rect(2, 3, 5, 7) == mST->getCurrentDirty());
+}
+
 TEST_F(SurfaceTextureClientTest, QueryFormatAfterSettingWorks) {
     sp<ANativeWindow> anw(mSTC);
     int fmts[] = {
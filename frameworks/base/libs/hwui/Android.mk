@@ -12,6 +12,7 @@ ifeq ($(USE_OPENGL_RENDERER),true)
 		DisplayListLogBuffer.cpp \
 		DisplayListRenderer.cpp \
 		FboCache.cpp \
+		FrameProfiler.cpp \
 		GradientCache.cpp \
 		LayerCache.cpp \
 		LayerRenderer.cpp \
@@ -20,13 +21,16 @@ ifeq ($(USE_OPENGL_RENDERER),true)
 		Patch.cpp \
 		PatchCache.cpp \
 		PathCache.cpp \
+		PathTessellator.cpp \
 		Program.cpp \
 		ProgramCache.cpp \
 		ResourceCache.cpp \
 		ShapeCache.cpp \
 		SkiaColorFilter.cpp \
 		SkiaShader.cpp \
+		TextureAtlas.cpp \
 		TextureCache.cpp \
+		TextureUploader.cpp \
 		TextDropShadowCache.cpp
 	
 	LOCAL_C_INCLUDES += \
@@ -40,7 +44,7 @@ ifeq ($(USE_OPENGL_RENDERER),true)
 
 	LOCAL_CFLAGS += -DUSE_OPENGL_RENDERER
 	LOCAL_MODULE_CLASS := SHARED_LIBRARIES
-	LOCAL_SHARED_LIBRARIES := libcutils libutils libGLESv2 libskia libui
+	LOCAL_SHARED_LIBRARIES := libcutils libutils libEGL libGLESv2 libskia libui
 	LOCAL_MODULE := libhwui
 	LOCAL_MODULE_TAGS := optional
 	
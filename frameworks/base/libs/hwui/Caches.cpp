@@ -47,7 +47,8 @@ namespace uirenderer {
 ///////////////////////////////////////////////////////////////////////////////
 
 Caches::Caches(): Singleton<Caches>(), blend(false), lastSrcMode(GL_ZERO),
-        lastDstMode(GL_ZERO), currentProgram(NULL) {
+        lastDstMode(GL_ZERO), currentProgram(NULL), stateChangesIssued(0),
+        stateChangesElided(0) {
     GLint maxTextureUnits;
     glGetIntegerv(GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS, &maxTextureUnits);
     if (maxTextureUnits < REQUIRED_TEXTURE_UNITS_COUNT) {
@@ -62,10 +63,21 @@ Caches::Caches(): Singleton<Caches>(), blend(false), lastSrcMode(GL_ZERO),
 
     mCurrentBuffer = meshBuffer;
     mRegionMesh = NULL;
+    resetState();
 
     mDebugLevel = readDebugLevel();
     LOGD("Enabling debug mode %d", mDebugLevel);
 
+    char property[PROPERTY_VALUE_MAX];
+    if (property_get(PROPERTY_TEXTURE_UPLOAD_THREAD, property, NULL) > 0 &&
+            !strcmp(property, "true")) {
+        sp<TextureUploader> uploader = new TextureUploader();
+        if (uploader->init()) {
+            INIT_LOGD("  Uploading large bitmaps on a background thread");
+            textureCache.setUploader(uploader);
+        }
+    }
+
 #if RENDER_LAYERS_AS_REGIONS
     INIT_LOGD("Layers will be composited as regions");
 #endif
@@ -89,8 +101,17 @@ void Caches::dumpMemoryUsage(String8 &log) {
     log.appendFormat("Current memory usage / total memory usage (bytes):\n");
     log.appendFormat("  TextureCache         %8d / %8d\n",
             textureCache.getSize(), textureCache.getMaxSize());
+    const WeightedGenerationCache<SkBitmap*, Texture*>::Stats& textureStats =
+            textureCache.getStats();
+    log.appendFormat("    hits %d, misses %d, evictions %d\n",
+            textureStats.hits, textureStats.misses, textureStats.evictions);
+    log.appendFormat("  TextureAtlas         %8d / %8d\n",
+            textureCache.getAtlasSize(), textureCache.getAtlasMaxSize());
     log.appendFormat("  LayerCache           %8d / %8d\n",
             layerCache.getSize(), layerCache.getMaxSize());
+    const LayerCache::Stats& layerStats = layerCache.getStats();
+    log.appendFormat("    hits %d, misses %d, evictions %d\n",
+            layerStats.hits, layerStats.misses, layerStats.evictions);
     log.appendFormat("  GradientCache        %8d / %8d\n",
             gradientCache.getSize(), gradientCache.getMaxSize());
     log.appendFormat("  PathCache            %8d / %8d\n",
@@ -117,8 +138,17 @@ void Caches::dumpMemoryUsage(String8 &log) {
     log.appendFormat("  PatchCache           %8d / %8d\n",
             patchCache.getSize(), patchCache.getMaxSize());
 
+    uint32_t uniformsIssued = 0;
+    uint32_t uniformsElided = 0;
+    programCache.getUniformStats(&uniformsIssued, &uniformsElided);
+    log.appendFormat("GL calls, issued / elided:\n");
+    log.appendFormat("  State                %8d / %8d\n",
+            stateChangesIssued, stateChangesElided);
+    log.appendFormat("  Uniforms             %8d / %8d\n", uniformsIssued, uniformsElided);
+
     uint32_t total = 0;
     total += textureCache.getSize();
+    total += textureCache.getAtlasSize();
     total += layerCache.getSize();
     total += gradientCache.getSize();
     total += pathCache.getSize();
@@ -207,6 +237,84 @@ void Caches::unbindMeshBuffer() {
     }
 }
 
+void Caches::bindIndicesBuffer(const GLuint buffer) {
+    if (!mIndicesBufferValid || mCurrentIndicesBuffer != buffer) {
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer);
+        mCurrentIndicesBuffer = buffer;
+        mIndicesBufferValid = true;
+        stateChangesIssued++;
+    } else {
+        stateChangesElided++;
+    }
+}
+
+void Caches::unbindIndicesBuffer() {
+    bindIndicesBuffer(0);
+}
+
+void Caches::bindAttribPointer(GLuint slot, GLint size, GLsizei stride,
+        const GLvoid* pointer) {
+    if (slot < TRACKED_ATTRIBS_COUNT) {
+        AttribPointer& attrib = mAttribPointers[slot];
+        // Pointers are relative to the bound VBO, only remember those into
+        // client memory or into the mesh buffer, which is never deleted
+        if (mCurrentBuffer == 0 || mCurrentBuffer == meshBuffer) {
+            if (attrib.valid && attrib.buffer == mCurrentBuffer && attrib.size == size &&
+                    attrib.stride == stride && attrib.pointer == pointer) {
+                stateChangesElided++;
+                return;
+            }
+            attrib.buffer = mCurrentBuffer;
+            attrib.size = size;
+            attrib.stride = stride;
+            attrib.pointer = pointer;
+            attrib.valid = true;
+        } else {
+            attrib.valid = false;
+        }
+    }
+
+    glVertexAttribPointer(slot, size, GL_FLOAT, GL_FALSE, stride, pointer);
+    stateChangesIssued++;
+}
+
+void Caches::activeTexture(GLuint textureUnit) {
+    if (!mTextureUnitValid || mTextureUnit != textureUnit) {
+        glActiveTexture(GL_TEXTURE0 + textureUnit);
+        mTextureUnit = textureUnit;
+        mTextureUnitValid = true;
+        stateChangesIssued++;
+    } else {
+        stateChangesElided++;
+    }
+}
+
+void Caches::setScissor(GLint x, GLint y, GLint width, GLint height) {
+    if (!mScissorValid || x != mScissorX || y != mScissorY ||
+            width != mScissorWidth || height != mScissorHeight) {
+        glScissor(x, y, width, height);
+        mScissorX = x;
+        mScissorY = y;
+        mScissorWidth = width;
+        mScissorHeight = height;
+        mScissorValid = true;
+        stateChangesIssued++;
+    } else {
+        stateChangesElided++;
+    }
+}
+
+void Caches::resetState() {
+    // The VBO binding is already reset by the renderer with unbindMeshBuffer()
+    // before GL calls happen outside of it
+    mIndicesBufferValid = false;
+    mTextureUnitValid = false;
+    mScissorValid = false;
+    for (int i = 0; i < TRACKED_ATTRIBS_COUNT; i++) {
+        mAttribPointers[i].valid = false;
+    }
+}
+
 TextureVertex* Caches::getRegionMesh() {
     // Create the mesh, 2 triangles and 4 vertices per rectangle in the region
     if (!mRegionMesh) {
@@ -225,13 +333,13 @@ TextureVertex* Caches::getRegionMesh() {
         }
 
         glGenBuffers(1, &mRegionMeshIndices);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mRegionMeshIndices);
+        bindIndicesBuffer(mRegionMeshIndices);
         glBufferData(GL_ELEMENT_ARRAY_BUFFER, REGION_MESH_QUAD_COUNT * 6 * sizeof(uint16_t),
                 regionIndices, GL_STATIC_DRAW);
 
         delete[] regionIndices;
     } else {
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mRegionMeshIndices);
+        bindIndicesBuffer(mRegionMeshIndices);
     }
 
     return mRegionMesh;
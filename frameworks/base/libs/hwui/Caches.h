@@ -46,6 +46,9 @@ namespace uirenderer {
 
 #define REQUIRED_TEXTURE_UNITS_COUNT 3
 
+// Number of vertex attributes whose pointers are tracked
+#define TRACKED_ATTRIBS_COUNT 8
+
 #define REGION_MESH_QUAD_COUNT 512
 
 // Generates simple and textured vertices
@@ -90,7 +93,25 @@ class Caches: public Singleton<Caches> {
 
     CacheLogger mLogger;
 
+    struct AttribPointer {
+        GLuint buffer;
+        GLint size;
+        GLsizei stride;
+        const GLvoid* pointer;
+        bool valid;
+    };
+
     GLuint mCurrentBuffer;
+    GLuint mCurrentIndicesBuffer;
+    GLuint mTextureUnit;
+    GLint mScissorX;
+    GLint mScissorY;
+    GLint mScissorWidth;
+    GLint mScissorHeight;
+    bool mIndicesBufferValid;
+    bool mTextureUnitValid;
+    bool mScissorValid;
+    AttribPointer mAttribPointers[TRACKED_ATTRIBS_COUNT];
 
     // Used to render layers
     TextureVertex* mRegionMesh;
@@ -147,6 +168,42 @@ public:
      */
     void unbindMeshBuffer();
 
+    /**
+     * Binds the specified GL_ELEMENT_ARRAY_BUFFER if needed.
+     */
+    void bindIndicesBuffer(const GLuint buffer);
+
+    /**
+     * Unbinds the GL_ELEMENT_ARRAY_BUFFER, to draw with indices in client memory.
+     */
+    void unbindIndicesBuffer();
+
+    /**
+     * Sets the pointer of the specified float vertex attribute if needed.
+     * The pointer is relative to the VBO currently bound by bindMeshBuffer(),
+     * if any. Pointers into VBOs other than the mesh buffer are always set
+     * since their names can be reused once deleted.
+     */
+    void bindAttribPointer(GLuint slot, GLint size, GLsizei stride, const GLvoid* pointer);
+
+    /**
+     * Makes the specified texture unit active if needed. The unit is an
+     * index, 0 for GL_TEXTURE0.
+     */
+    void activeTexture(GLuint textureUnit);
+
+    /**
+     * Sets the scissor box if needed.
+     */
+    void setScissor(GLint x, GLint y, GLint width, GLint height);
+
+    /**
+     * Forgets the tracked GL state: the next buffer bindings, attribute
+     * pointers, texture unit and scissor box are always set. Must be called
+     * when GL calls may have been issued outside of the renderer.
+     */
+    void resetState();
+
     /**
      * Returns the mesh used to draw regions. Calling this method will
      * bind a VBO of type GL_ELEMENT_ARRAY_BUFFER that contains the
@@ -165,6 +222,11 @@ public:
     GLenum lastDstMode;
     Program* currentProgram;
 
+    // Number of state changes sent to GL and skipped because the
+    // state was already set
+    uint32_t stateChangesIssued;
+    uint32_t stateChangesElided;
+
     // VBO to draw with
     GLuint meshBuffer;
 
@@ -19,6 +19,8 @@
 
 #include "DisplayListLogBuffer.h"
 #include "DisplayListRenderer.h"
+#include "FrameProfiler.h"
+#include <utils/misc.h>
 #include <utils/String8.h>
 #include "Caches.h"
 
@@ -83,56 +85,55 @@ void DisplayList::outputLogBuffer(int fd) {
     String8 cachesLog;
     Caches::getInstance().dumpMemoryUsage(cachesLog);
     fprintf(file, "\nCaches:\n%s", cachesLog.string());
+
+    FrameProfiler::getInstance().output(file, OP_NAMES, NELEM(OP_NAMES));
     fprintf(file, "\n");
 
     fflush(file);
 }
 
-DisplayList::DisplayList(const DisplayListRenderer& recorder) {
+DisplayList::DisplayList(const DisplayListRenderer& recorder): mBufferSize(0) {
     initFromDisplayListRenderer(recorder);
 }
 
 DisplayList::~DisplayList() {
     clearResources();
+    sk_free((void*) mReader.base());
 }
 
+/**
+ * Releases the resources used by the display list. The vectors that hold them
+ * are left as is, they are replaced when the display list is initialized again.
+ */
 void DisplayList::clearResources() {
-    sk_free((void*) mReader.base());
-
     Caches& caches = Caches::getInstance();
 
     for (size_t i = 0; i < mBitmapResources.size(); i++) {
         caches.resourceCache.decrementRefcount(mBitmapResources.itemAt(i));
     }
-    mBitmapResources.clear();
 
     for (size_t i = 0; i < mFilterResources.size(); i++) {
         caches.resourceCache.decrementRefcount(mFilterResources.itemAt(i));
     }
-    mFilterResources.clear();
 
     for (size_t i = 0; i < mShaders.size(); i++) {
         caches.resourceCache.decrementRefcount(mShaders.itemAt(i));
         caches.resourceCache.destructor(mShaders.itemAt(i));
     }
-    mShaders.clear();
 
     for (size_t i = 0; i < mPaints.size(); i++) {
         delete mPaints.itemAt(i);
     }
-    mPaints.clear();
 
     for (size_t i = 0; i < mPaths.size(); i++) {
         SkPath* path = mPaths.itemAt(i);
         caches.pathCache.remove(path);
         delete path;
     }
-    mPaths.clear();
 
     for (size_t i = 0; i < mMatrices.size(); i++) {
         delete mMatrices.itemAt(i);
     }
-    mMatrices.clear();
 }
 
 void DisplayList::initFromDisplayListRenderer(const DisplayListRenderer& recorder, bool reusing) {
@@ -149,47 +150,39 @@ void DisplayList::initFromDisplayListRenderer(const DisplayListRenderer& recorde
     }
 
     mSize = writer.size();
-    void* buffer = sk_malloc_throw(mSize);
+    // Keep the previous buffer if it is large enough, without holding on
+    // to much more memory than needed
+    void* buffer = (void*) mReader.base();
+    if (mSize > mBufferSize || mSize < mBufferSize / 2) {
+        sk_free(buffer);
+        buffer = sk_malloc_throw(mSize);
+        mBufferSize = mSize;
+    }
     writer.flatten(buffer);
     mReader.setMemory(buffer, mSize);
 
     Caches& caches = Caches::getInstance();
 
-    const Vector<SkBitmap*> &bitmapResources = recorder.getBitmapResources();
-    for (size_t i = 0; i < bitmapResources.size(); i++) {
-        SkBitmap* resource = bitmapResources.itemAt(i);
-        mBitmapResources.add(resource);
-        caches.resourceCache.incrementRefcount(resource);
-    }
-
-    const Vector<SkiaColorFilter*> &filterResources = recorder.getFilterResources();
-    for (size_t i = 0; i < filterResources.size(); i++) {
-        SkiaColorFilter* resource = filterResources.itemAt(i);
-        mFilterResources.add(resource);
-        caches.resourceCache.incrementRefcount(resource);
-    }
-
-    const Vector<SkiaShader*> &shaders = recorder.getShaders();
-    for (size_t i = 0; i < shaders.size(); i++) {
-        SkiaShader* resource = shaders.itemAt(i);
-        mShaders.add(resource);
-        caches.resourceCache.incrementRefcount(resource);
+    // The vectors share their storage with the recorder's until either
+    // of them is modified, no copy is made
+    mBitmapResources = recorder.getBitmapResources();
+    for (size_t i = 0; i < mBitmapResources.size(); i++) {
+        caches.resourceCache.incrementRefcount(mBitmapResources.itemAt(i));
     }
 
-    const Vector<SkPaint*> &paints = recorder.getPaints();
-    for (size_t i = 0; i < paints.size(); i++) {
-        mPaints.add(paints.itemAt(i));
+    mFilterResources = recorder.getFilterResources();
+    for (size_t i = 0; i < mFilterResources.size(); i++) {
+        caches.resourceCache.incrementRefcount(mFilterResources.itemAt(i));
     }
 
-    const Vector<SkPath*> &paths = recorder.getPaths();
-    for (size_t i = 0; i < paths.size(); i++) {
-        mPaths.add(paths.itemAt(i));
+    mShaders = recorder.getShaders();
+    for (size_t i = 0; i < mShaders.size(); i++) {
+        caches.resourceCache.incrementRefcount(mShaders.itemAt(i));
     }
 
-    const Vector<SkMatrix*> &matrices = recorder.getMatrices();
-    for (size_t i = 0; i < matrices.size(); i++) {
-        mMatrices.add(matrices.itemAt(i));
-    }
+    mPaints = recorder.getPaints();
+    mPaths = recorder.getPaths();
+    mMatrices = recorder.getMatrices();
 }
 
 void DisplayList::init() {
@@ -542,10 +535,17 @@ bool DisplayList::replay(OpenGLRenderer& renderer, Rect& dirty, uint32_t level)
 #endif
 
     DisplayListLogBuffer& logBuffer = DisplayListLogBuffer::getInstance();
+    FrameProfiler& profiler = FrameProfiler::getInstance();
+    const bool profile = profiler.isEnabled();
+    if (profile) {
+        profiler.addDisplayList(this, mSize);
+    }
+
     int saveCount = renderer.getSaveCount() - 1;
     while (!mReader.eof()) {
         int op = mReader.readInt();
         logBuffer.writeCommand(level, op);
+        nsecs_t opStart = profile ? systemTime(SYSTEM_TIME_MONOTONIC) : 0;
 
         switch (op) {
             case DrawGLFunction: {
@@ -883,6 +883,11 @@ bool DisplayList::replay(OpenGLRenderer& renderer, Rect& dirty, uint32_t level)
                     (char*) indent, OP_NAMES[op]);
                 break;
         }
+
+        // The time of children display lists is accounted for by their own ops
+        if (profile && op != DrawDisplayList) {
+            profiler.addOpTime(op, systemTime(SYSTEM_TIME_MONOTONIC) - opStart);
+        }
     }
 
     DISPLAY_LIST_LOGD("%sDone, returning %d", (char*) indent + 2, needsInvalidate);
@@ -893,40 +898,58 @@ bool DisplayList::replay(OpenGLRenderer& renderer, Rect& dirty, uint32_t level)
 // Base structure
 ///////////////////////////////////////////////////////////////////////////////
 
-DisplayListRenderer::DisplayListRenderer(): mWriter(MIN_WRITER_SIZE), mHasDrawOps(false) {
+DisplayListRenderer::DisplayListRenderer(): mWriter(MIN_WRITER_SIZE), mHasDrawOps(false),
+        mRecordStart(0) {
 }
 
 DisplayListRenderer::~DisplayListRenderer() {
     reset();
 }
 
+/**
+ * Empties the specified vector, dropping the storage it may share with a
+ * display list, and makes room for as many items as it had. Recordings are
+ * usually about as large as the previous ones.
+ */
+template<typename T>
+static void resetVector(T& vector) {
+    size_t count = vector.size();
+    vector = T();
+    vector.setCapacity(count);
+}
+
 void DisplayListRenderer::reset() {
-    mWriter.reset();
+    // Reuse the memory of the writer unless the recording was unusually large
+    if (mWriter.size() <= MAX_RETAINED_WRITER_SIZE) {
+        mWriter.rewind();
+    } else {
+        mWriter.reset();
+    }
 
     Caches& caches = Caches::getInstance();
     for (size_t i = 0; i < mBitmapResources.size(); i++) {
         caches.resourceCache.decrementRefcount(mBitmapResources.itemAt(i));
     }
-    mBitmapResources.clear();
+    resetVector(mBitmapResources);
 
     for (size_t i = 0; i < mFilterResources.size(); i++) {
         caches.resourceCache.decrementRefcount(mFilterResources.itemAt(i));
     }
-    mFilterResources.clear();
+    resetVector(mFilterResources);
 
     for (size_t i = 0; i < mShaders.size(); i++) {
         caches.resourceCache.decrementRefcount(mShaders.itemAt(i));
     }
-    mShaders.clear();
-    mShaderMap.clear();
+    resetVector(mShaders);
+    resetVector(mShaderMap);
 
-    mPaints.clear();
-    mPaintMap.clear();
+    resetVector(mPaints);
+    resetVector(mPaintMap);
 
-    mPaths.clear();
-    mPathMap.clear();
+    resetVector(mPaths);
+    resetVector(mPathMap);
 
-    mMatrices.clear();
+    resetVector(mMatrices);
 
     mHasDrawOps = false;
 }
@@ -959,11 +982,20 @@ void DisplayListRenderer::prepareDirty(float left, float top,
     mSaveCount = 1;
     mSnapshot->setClip(0.0f, 0.0f, mWidth, mHeight);
     mRestoreSaveCount = -1;
+
+    if (FrameProfiler::getInstance().isEnabled()) {
+        mRecordStart = systemTime(SYSTEM_TIME_MONOTONIC);
+    }
 }
 
 void DisplayListRenderer::finish() {
     insertRestoreToCount();
     OpenGLRenderer::finish();
+
+    FrameProfiler& profiler = FrameProfiler::getInstance();
+    if (profiler.isEnabled()) {
+        profiler.addRecordTime(systemTime(SYSTEM_TIME_MONOTONIC) - mRecordStart);
+    }
 }
 
 void DisplayListRenderer::interrupt() {
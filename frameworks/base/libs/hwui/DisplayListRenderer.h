@@ -38,6 +38,8 @@ namespace uirenderer {
 ///////////////////////////////////////////////////////////////////////////////
 
 #define MIN_WRITER_SIZE 4096
+// The recorder keeps the memory of recordings up to this size to reuse it
+#define MAX_RETAINED_WRITER_SIZE (64 * 1024)
 
 // Debug
 #if DEBUG_DISPLAY_LIST
@@ -217,6 +219,8 @@ private:
     mutable SkFlattenableReadBuffer mReader;
 
     size_t mSize;
+    // Size of the buffer read by mReader, kept when the display list is reused
+    size_t mBufferSize;
 
     bool mIsRenderable;
 };
@@ -494,6 +498,8 @@ private:
     int mRestoreSaveCount;
     bool mHasDrawOps;
 
+    nsecs_t mRecordStart;
+
     friend class DisplayList;
 
 }; // class DisplayListRenderer
@@ -22,6 +22,7 @@
 
 #include <utils/Log.h>
 
+#include "Caches.h"
 #include "Debug.h"
 #include "FontRenderer.h"
 
@@ -39,6 +40,42 @@ namespace uirenderer {
 #define MAX_TEXT_CACHE_WIDTH 2048
 #define MAX_TEXT_CACHE_HEIGHT 2048
 
+// Number of textures of the default size the glyph cache can grow to
+// before it starts evicting glyphs
+#define MAX_SMALL_CACHE_TEXTURES 2
+
+// Number of glyphs cached by other sizes of a typeface that are
+// precached for a new size of that typeface
+#define MAX_PRECACHE_USED_GLYPHS 128
+
+///////////////////////////////////////////////////////////////////////////////
+// CacheTexture
+///////////////////////////////////////////////////////////////////////////////
+
+CacheTexture::CacheTexture(uint32_t width, uint32_t height, bool largeFonts):
+        mWidth(width), mHeight(height), mLinearFiltering(false), mLargeFonts(largeFonts) {
+    mTexture = new uint8_t[width * height];
+    memset(mTexture, 0, width * height * sizeof(uint8_t));
+
+    glGenTextures(1, &mTextureId);
+    glBindTexture(GL_TEXTURE_2D, mTextureId);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    // Initialize texture dimensions
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_ALPHA, mWidth, mHeight, 0,
+            GL_ALPHA, GL_UNSIGNED_BYTE, 0);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+}
+
+CacheTexture::~CacheTexture() {
+    delete[] mTexture;
+    glDeleteTextures(1, &mTextureId);
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // Font
 ///////////////////////////////////////////////////////////////////////////////
@@ -65,9 +102,12 @@ Font::~Font() {
     }
 }
 
-void Font::invalidateTextureCache() {
+void Font::invalidateTextureCache(CacheTextureLine* line) {
     for (uint32_t i = 0; i < mCachedGlyphs.size(); i++) {
-        mCachedGlyphs.valueAt(i)->mIsValid = false;
+        CachedGlyphInfo* cachedGlyph = mCachedGlyphs.valueAt(i);
+        if (!line || cachedGlyph->mCacheLine == line) {
+            cachedGlyph->mIsValid = false;
+        }
     }
 }
 
@@ -107,7 +147,7 @@ void Font::drawCachedGlyph(CachedGlyphInfo* glyph, int x, int y) {
     mState->appendMeshQuad(nPenX, nPenY, 0, u1, v2,
             nPenX + width, nPenY, 0, u2, v2,
             nPenX + width, nPenY - height, 0, u2, v1,
-            nPenX, nPenY - height, 0, u1, v1);
+            nPenX, nPenY - height, 0, u1, v1, glyph->mCacheLine->mCacheTexture);
 }
 
 void Font::drawCachedGlyph(CachedGlyphInfo* glyph, int x, int y,
@@ -118,8 +158,9 @@ void Font::drawCachedGlyph(CachedGlyphInfo* glyph, int x, int y,
     uint32_t endX = glyph->mStartX + glyph->mBitmapWidth;
     uint32_t endY = glyph->mStartY + glyph->mBitmapHeight;
 
-    uint32_t cacheWidth = mState->getCacheWidth();
-    const uint8_t* cacheBuffer = mState->getTextTextureData();
+    CacheTexture* cacheTexture = glyph->mCacheLine->mCacheTexture;
+    uint32_t cacheWidth = cacheTexture->mWidth;
+    const uint8_t* cacheBuffer = cacheTexture->mTexture;
 
     uint32_t cacheX = 0, cacheY = 0;
     int32_t bX = 0, bY = 0;
@@ -151,6 +192,10 @@ Font::CachedGlyphInfo* Font::getCachedGlyph(SkPaint* paint, glyph_t textUnit) {
         updateGlyphCache(paint, skiaGlyph, cachedGlyph);
     }
 
+    if (cachedGlyph->mIsValid) {
+        cachedGlyph->mCacheLine->mLastUsed = mState->mUseCount;
+    }
+
     return cachedGlyph;
 }
 
@@ -246,7 +291,7 @@ void Font::updateGlyphCache(SkPaint* paint, const SkGlyph& skiaGlyph, CachedGlyp
 
     // Get the bitmap for the glyph
     paint->findImage(skiaGlyph);
-    glyph->mIsValid = mState->cacheBitmap(skiaGlyph, &startX, &startY);
+    glyph->mIsValid = mState->cacheBitmap(skiaGlyph, &glyph->mCacheLine, &startX, &startY);
 
     if (!glyph->mIsValid) {
         return;
@@ -260,8 +305,8 @@ void Font::updateGlyphCache(SkPaint* paint, const SkGlyph& skiaGlyph, CachedGlyp
     glyph->mBitmapWidth = skiaGlyph.fWidth;
     glyph->mBitmapHeight = skiaGlyph.fHeight;
 
-    uint32_t cacheWidth = mState->getCacheWidth();
-    uint32_t cacheHeight = mState->getCacheHeight();
+    uint32_t cacheWidth = glyph->mCacheLine->mCacheTexture->mWidth;
+    uint32_t cacheHeight = glyph->mCacheLine->mCacheTexture->mHeight;
 
     glyph->mBitmapMinU = (float) startX / (float) cacheWidth;
     glyph->mBitmapMinV = (float) startY / (float) cacheHeight;
@@ -278,6 +323,7 @@ Font::CachedGlyphInfo* Font::cacheGlyph(SkPaint* paint, glyph_t glyph) {
     const SkGlyph& skiaGlyph = GET_METRICS(paint, glyph);
     newGlyph->mGlyphIndex = skiaGlyph.fID;
     newGlyph->mIsValid = false;
+    newGlyph->mCacheLine = NULL;
 
     updateGlyphCache(paint, skiaGlyph, newGlyph);
 
@@ -320,10 +366,15 @@ FontRenderer::FontRenderer() {
     mInitialized = false;
     mMaxNumberOfQuads = 1024;
     mCurrentQuadIndex = 0;
-    mTextureId = 0;
+    mCurrentCacheTexture = NULL;
+    mSmallCacheTextureCount = 0;
+    mMaxSmallLineHeight = 0;
+    mUseCount = 0;
+    mPrecaching = false;
+    mLinearFiltering = false;
+    mUploadTexture = false;
 
     mTextMeshPtr = NULL;
-    mTextTexture = NULL;
 
     mIndexBufferID = 0;
     mPositionAttrSlot = -1;
@@ -364,13 +415,13 @@ FontRenderer::~FontRenderer() {
     }
     mCacheLines.clear();
 
-    if (mInitialized) {
-        delete[] mTextMeshPtr;
-        delete[] mTextTexture;
+    for (uint32_t i = 0; i < mCacheTextures.size(); i++) {
+        delete mCacheTextures[i];
     }
+    mCacheTextures.clear();
 
-    if (mTextureId) {
-        glDeleteTextures(1, &mTextureId);
+    if (mInitialized) {
+        delete[] mTextMeshPtr;
     }
 
     Vector<Font*> fontsToDereference = mActiveFonts;
@@ -379,76 +430,98 @@ FontRenderer::~FontRenderer() {
     }
 }
 
-void FontRenderer::flushAllAndInvalidate() {
-    if (mCurrentQuadIndex != 0) {
-        issueDrawCommand();
-        mCurrentQuadIndex = 0;
-    }
-    for (uint32_t i = 0; i < mActiveFonts.size(); i++) {
-        mActiveFonts[i]->invalidateTextureCache();
-    }
+bool FontRenderer::fitBitmap(const SkGlyph& glyph, bool largeFonts, CacheTextureLine** retLine,
+        uint32_t* retOriginX, uint32_t* retOriginY) {
     for (uint32_t i = 0; i < mCacheLines.size(); i++) {
-        mCacheLines[i]->mCurrentCol = 0;
+        CacheTextureLine* line = mCacheLines[i];
+        if (line->mCacheTexture->mLargeFonts == largeFonts &&
+                line->fitBitmap(glyph, retOriginX, retOriginY)) {
+            *retLine = line;
+            return true;
+        }
     }
+    return false;
 }
 
-bool FontRenderer::cacheBitmap(const SkGlyph& glyph, uint32_t* retOriginX, uint32_t* retOriginY) {
-    // If the glyph is too tall, don't cache it
-    if (glyph.fHeight + 2 > mCacheLines[mCacheLines.size() - 1]->mMaxHeight) {
-        if (mCacheHeight < MAX_TEXT_CACHE_HEIGHT) {
-            // Default cache not large enough for large glyphs - resize cache to
-            // max size and try again
-            flushAllAndInvalidate();
-            initTextTexture(true);
+bool FontRenderer::evictLine(const SkGlyph& glyph, bool largeFonts) {
+    // Pick the least recently used line that can hold the glyph, and
+    // the shortest one among those last used at the same time
+    CacheTextureLine* victim = NULL;
+    for (uint32_t i = 0; i < mCacheLines.size(); i++) {
+        CacheTextureLine* line = mCacheLines[i];
+        if (line->mCacheTexture->mLargeFonts != largeFonts ||
+                glyph.fHeight + 2 > line->mMaxHeight || glyph.fWidth + 2 >= line->mMaxWidth) {
+            continue;
         }
-        if (glyph.fHeight + 2 > mCacheLines[mCacheLines.size() - 1]->mMaxHeight) {
-            LOGE("Font size to large to fit in cache. width, height = %i, %i",
-                    (int) glyph.fWidth, (int) glyph.fHeight);
-            return false;
+        if (!victim || line->mLastUsed < victim->mLastUsed ||
+                (line->mLastUsed == victim->mLastUsed && line->mMaxHeight < victim->mMaxHeight)) {
+            victim = line;
         }
     }
 
+    if (!victim) {
+        return false;
+    }
+
+    // The batch may use glyphs of that line
+    flushBatch();
+
+    for (uint32_t i = 0; i < mActiveFonts.size(); i++) {
+        mActiveFonts[i]->invalidateTextureCache(victim);
+    }
+    victim->mCurrentCol = 0;
+
+    return true;
+}
+
+bool FontRenderer::cacheBitmap(const SkGlyph& glyph, CacheTextureLine** retLine,
+        uint32_t* retOriginX, uint32_t* retOriginY) {
+    // Glyphs too tall for the lines of the default textures go
+    // in a texture of their own
+    const bool largeFonts = glyph.fHeight + 2 > mMaxSmallLineHeight;
+
     // Now copy the bitmap into the cache texture
     uint32_t startX = 0;
     uint32_t startY = 0;
+    CacheTextureLine* line = NULL;
 
-    bool bitmapFit = false;
-    for (uint32_t i = 0; i < mCacheLines.size(); i++) {
-        bitmapFit = mCacheLines[i]->fitBitmap(glyph, &startX, &startY);
-        if (bitmapFit) {
-            break;
-        }
+    bool bitmapFit = fitBitmap(glyph, largeFonts, &line, &startX, &startY);
+    if (!bitmapFit && mPrecaching) {
+        return false;
     }
 
-    // If the new glyph didn't fit, flush the state so far and invalidate everything
+    // Grow the cache before evicting glyphs that may still be in use
     if (!bitmapFit) {
-        flushAllAndInvalidate();
-
-        // Try to fit it again
-        for (uint32_t i = 0; i < mCacheLines.size(); i++) {
-            bitmapFit = mCacheLines[i]->fitBitmap(glyph, &startX, &startY);
-            if (bitmapFit) {
-                break;
-            }
+        bool hasLargeTexture = mCacheTextures.size() > mSmallCacheTextureCount;
+        if (largeFonts ? !hasLargeTexture : mSmallCacheTextureCount < MAX_SMALL_CACHE_TEXTURES) {
+            createCacheTexture(largeFonts);
+            bitmapFit = fitBitmap(glyph, largeFonts, &line, &startX, &startY);
         }
+    }
 
-        // if we still don't fit, something is wrong and we shouldn't draw
-        if (!bitmapFit) {
-            LOGE("Bitmap doesn't fit in cache. width, height = %i, %i",
-                    (int) glyph.fWidth, (int) glyph.fHeight);
-            return false;
-        }
+    // If the new glyph didn't fit, empty the least recently used line
+    // that can hold it
+    if (!bitmapFit && evictLine(glyph, largeFonts)) {
+        bitmapFit = fitBitmap(glyph, largeFonts, &line, &startX, &startY);
     }
 
+    // if we still don't fit, something is wrong and we shouldn't draw
+    if (!bitmapFit) {
+        LOGE("Bitmap doesn't fit in cache. width, height = %i, %i",
+                (int) glyph.fWidth, (int) glyph.fHeight);
+        return false;
+    }
+
+    *retLine = line;
     *retOriginX = startX;
     *retOriginY = startY;
 
     uint32_t endX = startX + glyph.fWidth;
     uint32_t endY = startY + glyph.fHeight;
 
-    uint32_t cacheWidth = mCacheWidth;
+    uint32_t cacheWidth = line->mCacheTexture->mWidth;
 
-    uint8_t* cacheBuffer = mTextTexture;
+    uint8_t* cacheBuffer = line->mCacheTexture->mTexture;
     uint8_t* bitmapBuffer = (uint8_t*) glyph.fImage;
     unsigned int stride = glyph.rowBytes();
 
@@ -463,59 +536,57 @@ bool FontRenderer::cacheBitmap(const SkGlyph& glyph, uint32_t* retOriginX, uint3
     return true;
 }
 
-void FontRenderer::initTextTexture(bool largeFonts) {
-    mCacheLines.clear();
-    if (largeFonts) {
-        mCacheWidth = MAX_TEXT_CACHE_WIDTH;
-        mCacheHeight = MAX_TEXT_CACHE_HEIGHT;
-    }
-
-    mTextTexture = new uint8_t[mCacheWidth * mCacheHeight];
-    memset(mTextTexture, 0, mCacheWidth * mCacheHeight * sizeof(uint8_t));
+void FontRenderer::createCacheTexture(bool largeFonts) {
+    const uint32_t width = mCacheWidth;
+    const uint32_t height = largeFonts ? MAX_TEXT_CACHE_HEIGHT : mCacheHeight;
 
-    mUploadTexture = false;
+    CacheTexture* cacheTexture = new CacheTexture(width, height, largeFonts);
 
-    if (mTextureId != 0) {
-        glDeleteTextures(1, &mTextureId);
+    // Keep the textures for large glyphs last
+    if (largeFonts) {
+        mCacheTextures.push(cacheTexture);
+    } else {
+        mCacheTextures.insertAt(cacheTexture, mSmallCacheTextureCount);
+        mSmallCacheTextureCount++;
     }
-    glGenTextures(1, &mTextureId);
-    glBindTexture(GL_TEXTURE_2D, mTextureId);
-    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-    // Initialize texture dimensions
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_ALPHA, mCacheWidth, mCacheHeight, 0,
-            GL_ALPHA, GL_UNSIGNED_BYTE, 0);
-
-    mLinearFiltering = false;
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 
     // Split up our cache texture into lines of certain widths
     int nextLine = 0;
-    mCacheLines.push(new CacheTextureLine(mCacheWidth, 18, nextLine, 0));
-    nextLine += mCacheLines.top()->mMaxHeight;
-    mCacheLines.push(new CacheTextureLine(mCacheWidth, 26, nextLine, 0));
-    nextLine += mCacheLines.top()->mMaxHeight;
-    mCacheLines.push(new CacheTextureLine(mCacheWidth, 26, nextLine, 0));
-    nextLine += mCacheLines.top()->mMaxHeight;
-    mCacheLines.push(new CacheTextureLine(mCacheWidth, 34, nextLine, 0));
-    nextLine += mCacheLines.top()->mMaxHeight;
-    mCacheLines.push(new CacheTextureLine(mCacheWidth, 34, nextLine, 0));
-    nextLine += mCacheLines.top()->mMaxHeight;
-    mCacheLines.push(new CacheTextureLine(mCacheWidth, 42, nextLine, 0));
-    nextLine += mCacheLines.top()->mMaxHeight;
     if (largeFonts) {
         int nextSize = 76;
         // Make several new lines with increasing font sizes
-        while (nextSize < (int)(mCacheHeight - nextLine - (2 * nextSize))) {
-            mCacheLines.push(new CacheTextureLine(mCacheWidth, nextSize, nextLine, 0));
+        while (nextSize < (int)(height - nextLine - (2 * nextSize))) {
+            mCacheLines.push(new CacheTextureLine(width, nextSize, nextLine, 0, cacheTexture));
             nextLine += mCacheLines.top()->mMaxHeight;
             nextSize += 50;
         }
+    } else {
+        mCacheLines.push(new CacheTextureLine(width, 18, nextLine, 0, cacheTexture));
+        nextLine += mCacheLines.top()->mMaxHeight;
+        mCacheLines.push(new CacheTextureLine(width, 26, nextLine, 0, cacheTexture));
+        nextLine += mCacheLines.top()->mMaxHeight;
+        mCacheLines.push(new CacheTextureLine(width, 26, nextLine, 0, cacheTexture));
+        nextLine += mCacheLines.top()->mMaxHeight;
+        mCacheLines.push(new CacheTextureLine(width, 34, nextLine, 0, cacheTexture));
+        nextLine += mCacheLines.top()->mMaxHeight;
+        mCacheLines.push(new CacheTextureLine(width, 34, nextLine, 0, cacheTexture));
+        nextLine += mCacheLines.top()->mMaxHeight;
+        mCacheLines.push(new CacheTextureLine(width, 42, nextLine, 0, cacheTexture));
+        nextLine += mCacheLines.top()->mMaxHeight;
+    }
+    mCacheLines.push(new CacheTextureLine(width, height - nextLine, nextLine, 0, cacheTexture));
+
+    if (!largeFonts) {
+        mMaxSmallLineHeight = mCacheLines.top()->mMaxHeight;
+    }
+}
+
+uint32_t FontRenderer::getCacheSize() const {
+    uint32_t size = 0;
+    for (uint32_t i = 0; i < mCacheTextures.size(); i++) {
+        size += mCacheTextures[i]->mWidth * mCacheTextures[i]->mHeight;
     }
-    mCacheLines.push(new CacheTextureLine(mCacheWidth, mCacheHeight - nextLine, nextLine, 0));
+    return size;
 }
 
 // Avoid having to reallocate memory and render quad by quad
@@ -538,10 +609,11 @@ void FontRenderer::initVertexArrayBuffers() {
         indexBufferData[i6 + 5] = i4 + 3;
     }
 
+    Caches& caches = Caches::getInstance();
     glGenBuffers(1, &mIndexBufferID);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mIndexBufferID);
+    caches.bindIndicesBuffer(mIndexBufferID);
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexBufferSizeBytes, indexBufferData, GL_STATIC_DRAW);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    caches.unbindIndicesBuffer();
 
     free(indexBufferData);
 
@@ -558,7 +630,7 @@ void FontRenderer::checkInit() {
         return;
     }
 
-    initTextTexture();
+    createCacheTexture(false);
     initVertexArrayBuffers();
 
     // We store a string with letters in a rough frequency of occurrence
@@ -575,17 +647,24 @@ void FontRenderer::checkTextureUpdate() {
         return;
     }
 
-    glBindTexture(GL_TEXTURE_2D, mTextureId);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
 
     // Iterate over all the cache lines and see which ones need to be updated
+    GLuint boundTexture = 0;
     for (uint32_t i = 0; i < mCacheLines.size(); i++) {
         CacheTextureLine* cl = mCacheLines[i];
         if(cl->mDirty) {
+            CacheTexture* cacheTexture = cl->mCacheTexture;
+            if (cacheTexture->mTextureId != boundTexture) {
+                boundTexture = cacheTexture->mTextureId;
+                glBindTexture(GL_TEXTURE_2D, boundTexture);
+            }
+
             uint32_t xOffset = 0;
             uint32_t yOffset = cl->mCurrentRow;
-            uint32_t width   = mCacheWidth;
+            uint32_t width   = cacheTexture->mWidth;
             uint32_t height  = cl->mMaxHeight;
-            void* textureData = mTextTexture + yOffset*width;
+            void* textureData = cacheTexture->mTexture + yOffset*width;
 
             glTexSubImage2D(GL_TEXTURE_2D, 0, xOffset, yOffset, width, height,
                     GL_ALPHA, GL_UNSIGNED_BYTE, textureData);
@@ -600,25 +679,40 @@ void FontRenderer::checkTextureUpdate() {
 void FontRenderer::issueDrawCommand() {
     checkTextureUpdate();
 
+    // Other textures may have been bound since the batch was started
+    CacheTexture* cacheTexture = mCurrentCacheTexture;
+    glBindTexture(GL_TEXTURE_2D, cacheTexture->mTextureId);
+    if (cacheTexture->mLinearFiltering != mLinearFiltering) {
+        cacheTexture->mLinearFiltering = mLinearFiltering;
+        const GLenum filtering = mLinearFiltering ? GL_LINEAR : GL_NEAREST;
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filtering);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filtering);
+    }
+
     float* vtx = mTextMeshPtr;
     float* tex = vtx + 3;
 
-    glVertexAttribPointer(mPositionAttrSlot, 3, GL_FLOAT, false, 20, vtx);
-    glVertexAttribPointer(mTexcoordAttrSlot, 2, GL_FLOAT, false, 20, tex);
+    Caches& caches = Caches::getInstance();
+    caches.bindAttribPointer(mPositionAttrSlot, 3, 20, vtx);
+    caches.bindAttribPointer(mTexcoordAttrSlot, 2, 20, tex);
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mIndexBufferID);
+    caches.bindIndicesBuffer(mIndexBufferID);
     glDrawElements(GL_TRIANGLES, mCurrentQuadIndex * 6, GL_UNSIGNED_SHORT, NULL);
-
-    mDrawn = true;
 }
 
 void FontRenderer::appendMeshQuad(float x1, float y1, float z1, float u1, float v1, float x2,
         float y2, float z2, float u2, float v2, float x3, float y3, float z3, float u3, float v3,
-        float x4, float y4, float z4, float u4, float v4) {
+        float x4, float y4, float z4, float u4, float v4, CacheTexture* texture) {
     if (x1 > mClip->right || y1 < mClip->top || x2 < mClip->left || y4 > mClip->bottom) {
         return;
     }
 
+    // A draw call can only sample one cache texture
+    if (texture != mCurrentCacheTexture) {
+        flushBatch();
+        mCurrentCacheTexture = texture;
+    }
+
     const uint32_t vertsPerQuad = 4;
     const uint32_t floatsPerVert = 5;
     float* currentPos = mTextMeshPtr + mCurrentQuadIndex * vertsPerQuad * floatsPerVert;
@@ -648,6 +742,7 @@ void FontRenderer::appendMeshQuad(float x1, float y1, float z1, float u1, float
     (*currentPos++) = v4;
 
     mCurrentQuadIndex++;
+    mDrawn = true;
 
     if (mBounds) {
         mBounds->left = fmin(mBounds->left, x1);
@@ -684,6 +779,28 @@ void FontRenderer::precacheLatin(SkPaint* paint) {
     }
 }
 
+void FontRenderer::precacheUsedGlyphs(SkPaint* paint) {
+    // The glyphs still cached for other sizes of the same typeface are the
+    // ones the application recently used, for instance CJK characters
+    uint32_t precached = 0;
+    for (uint32_t i = 0; i < mActiveFonts.size(); i++) {
+        Font* font = mActiveFonts[i];
+        if (font == mCurrentFont || font->mFontId != mCurrentFont->mFontId) {
+            continue;
+        }
+
+        for (uint32_t j = 0; j < font->mCachedGlyphs.size(); j++) {
+            if (precached >= MAX_PRECACHE_USED_GLYPHS || getRemainingCacheCapacity() <= 25) {
+                return;
+            }
+            if (font->mCachedGlyphs.valueAt(j)->mIsValid) {
+                mCurrentFont->getCachedGlyph(paint, font->mCachedGlyphs.keyAt(j));
+                precached++;
+            }
+        }
+    }
+}
+
 void FontRenderer::setFont(SkPaint* paint, uint32_t fontId, float fontSize) {
     uint32_t currentNumFonts = mActiveFonts.size();
     int flags = 0;
@@ -705,12 +822,15 @@ void FontRenderer::setFont(SkPaint* paint, uint32_t fontId, float fontSize) {
     bool isNewFont = currentNumFonts != mActiveFonts.size();
 
     if (isNewFont && fontSize <= maxPrecacheFontSize) {
+        mPrecaching = true;
         precacheLatin(paint);
+        precacheUsedGlyphs(paint);
+        mPrecaching = false;
     }
 }
 
 FontRenderer::DropShadow FontRenderer::renderDropShadow(SkPaint* paint, const char *text,
-        uint32_t startIndex, uint32_t len, int numGlyphs, uint32_t radius) {
+        uint32_t startIndex, uint32_t len, int numGlyphs, uint32_t radius, bool blur) {
     checkInit();
 
     if (!mCurrentFont) {
@@ -723,6 +843,8 @@ FontRenderer::DropShadow FontRenderer::renderDropShadow(SkPaint* paint, const ch
         return image;
     }
 
+    mUseCount++;
+
     Rect bounds;
     mCurrentFont->measure(paint, text, startIndex, len, numGlyphs, &bounds);
     uint32_t paddedWidth = (uint32_t) (bounds.right - bounds.left) + 2 * radius;
@@ -737,7 +859,9 @@ FontRenderer::DropShadow FontRenderer::renderDropShadow(SkPaint* paint, const ch
 
     mCurrentFont->render(paint, text, startIndex, len, numGlyphs, penX, penY,
             dataBuffer, paddedWidth, paddedHeight);
-    blurImage(dataBuffer, paddedWidth, paddedHeight, radius);
+    if (blur) {
+        blurImage(dataBuffer, paddedWidth, paddedHeight, radius);
+    }
 
     DropShadow image;
     image.width = paddedWidth;
@@ -762,18 +886,22 @@ bool FontRenderer::renderText(SkPaint* paint, const Rect* clip, const char *text
         return false;
     }
 
+    mUseCount++;
     mDrawn = false;
     mBounds = bounds;
     mClip = clip;
     mCurrentFont->render(paint, text, startIndex, len, numGlyphs, x, y);
     mBounds = NULL;
+    mClip = NULL;
 
+    return mDrawn;
+}
+
+void FontRenderer::flushBatch() {
     if (mCurrentQuadIndex != 0) {
         issueDrawCommand();
         mCurrentQuadIndex = 0;
     }
-
-    return mDrawn;
 }
 
 void FontRenderer::computeGaussianWeights(float* weights, int32_t radius) {
@@ -813,103 +941,89 @@ void FontRenderer::computeGaussianWeights(float* weights, int32_t radius) {
     }
 }
 
-void FontRenderer::horizontalBlur(float* weights, int32_t radius,
+void FontRenderer::horizontalBlur(const int32_t* weights, int32_t radius,
         const uint8_t* source, uint8_t* dest, int32_t width, int32_t height) {
-    float blurredPixel = 0.0f;
-    float currentPixel = 0.0f;
-
-    for (int32_t y = 0; y < height; y ++) {
-
+    for (int32_t y = 0; y < height; y++) {
         const uint8_t* input = source + y * width;
         uint8_t* output = dest + y * width;
 
-        for (int32_t x = 0; x < width; x ++) {
-            blurredPixel = 0.0f;
-            const float* gPtr = weights;
+        for (int32_t x = 0; x < width; x++) {
+            int32_t blurredPixel = 0;
             // Optimization for non-border pixels
-            if (x > radius && x < (width - radius)) {
-                const uint8_t *i = input + (x - radius);
-                for (int r = -radius; r <= radius; r ++) {
-                    currentPixel = (float) (*i);
-                    blurredPixel += currentPixel * gPtr[0];
-                    gPtr++;
-                    i++;
+            if (x >= radius && x < (width - radius)) {
+                const uint8_t* i = input + (x - radius);
+                for (int32_t r = 0; r <= 2 * radius; r++) {
+                    blurredPixel += i[r] * weights[r];
                 }
             } else {
-                for (int32_t r = -radius; r <= radius; r ++) {
+                for (int32_t r = -radius; r <= radius; r++) {
                     // Stepping left and right away from the pixel
-                    int validW = x + r;
+                    int32_t validW = x + r;
                     if (validW < 0) {
                         validW = 0;
                     }
                     if (validW > width - 1) {
                         validW = width - 1;
                     }
-
-                    currentPixel = (float) input[validW];
-                    blurredPixel += currentPixel * gPtr[0];
-                    gPtr++;
+                    blurredPixel += input[validW] * weights[r + radius];
                 }
             }
-            *output = (uint8_t)blurredPixel;
-            output ++;
+            output[x] = (uint8_t) (blurredPixel >> 16);
         }
     }
 }
 
-void FontRenderer::verticalBlur(float* weights, int32_t radius,
+void FontRenderer::verticalBlur(const int32_t* weights, int32_t radius,
         const uint8_t* source, uint8_t* dest, int32_t width, int32_t height) {
-    float blurredPixel = 0.0f;
-    float currentPixel = 0.0f;
+    // Accumulate whole rows rather than walking down the columns so that
+    // the image is read sequentially
+    int32_t* accumulator = new int32_t[width];
+
+    for (int32_t y = 0; y < height; y++) {
+        memset(accumulator, 0, width * sizeof(int32_t));
+
+        for (int32_t r = -radius; r <= radius; r++) {
+            int32_t validH = y + r;
+            // Clamp to zero and height
+            if (validH < 0) {
+                validH = 0;
+            }
+            if (validH > height - 1) {
+                validH = height - 1;
+            }
 
-    for (int32_t y = 0; y < height; y ++) {
+            const uint8_t* input = source + validH * width;
+            const int32_t weight = weights[r + radius];
+            for (int32_t x = 0; x < width; x++) {
+                accumulator[x] += input[x] * weight;
+            }
+        }
 
         uint8_t* output = dest + y * width;
-
-        for (int32_t x = 0; x < width; x ++) {
-            blurredPixel = 0.0f;
-            const float* gPtr = weights;
-            const uint8_t* input = source + x;
-            // Optimization for non-border pixels
-            if (y > radius && y < (height - radius)) {
-                const uint8_t *i = input + ((y - radius) * width);
-                for (int32_t r = -radius; r <= radius; r ++) {
-                    currentPixel = (float)(*i);
-                    blurredPixel += currentPixel * gPtr[0];
-                    gPtr++;
-                    i += width;
-                }
-            } else {
-                for (int32_t r = -radius; r <= radius; r ++) {
-                    int validH = y + r;
-                    // Clamp to zero and width
-                    if (validH < 0) {
-                        validH = 0;
-                    }
-                    if (validH > height - 1) {
-                        validH = height - 1;
-                    }
-
-                    const uint8_t *i = input + validH * width;
-                    currentPixel = (float) (*i);
-                    blurredPixel += currentPixel * gPtr[0];
-                    gPtr++;
-                }
-            }
-            *output = (uint8_t) blurredPixel;
-            output ++;
+        for (int32_t x = 0; x < width; x++) {
+            output[x] = (uint8_t) (accumulator[x] >> 16);
         }
     }
-}
 
+    delete[] accumulator;
+}
 
 void FontRenderer::blurImage(uint8_t *image, int32_t width, int32_t height, int32_t radius) {
     float *gaussian = new float[2 * radius + 1];
     computeGaussianWeights(gaussian, radius);
+
+    // Rounding the weights down keeps their sum, and the blurred pixels,
+    // within range
+    int32_t* weights = new int32_t[2 * radius + 1];
+    for (int32_t r = 0; r <= 2 * radius; r++) {
+        weights[r] = (int32_t) (gaussian[r] * 65536.0f);
+    }
+
     uint8_t* scratch = new uint8_t[width * height];
-    horizontalBlur(gaussian, radius, image, scratch, width, height);
-    verticalBlur(gaussian, radius, scratch, image, width, height);
+    horizontalBlur(weights, radius, image, scratch, width, height);
+    verticalBlur(weights, radius, scratch, image, width, height);
     delete[] gaussian;
+    delete[] weights;
     delete[] scratch;
 }
 
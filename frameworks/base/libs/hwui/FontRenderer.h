@@ -55,6 +55,69 @@ namespace uirenderer {
 
 class FontRenderer;
 
+///////////////////////////////////////////////////////////////////////////////
+// Glyph cache
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * A texture used to cache glyphs. The glyphs are also kept in memory to
+ * update the texture and to render drop shadows.
+ */
+struct CacheTexture {
+    CacheTexture(uint32_t width, uint32_t height, bool largeFonts);
+    ~CacheTexture();
+
+    uint8_t* mTexture;
+    GLuint mTextureId;
+    uint32_t mWidth;
+    uint32_t mHeight;
+    bool mLinearFiltering;
+    // True if the lines of this texture are sized for large glyphs only
+    bool mLargeFonts;
+};
+
+/**
+ * A line of a cache texture, filled from left to right with glyphs up to
+ * mMaxHeight - 2 pixels tall. A line is only ever emptied as a whole.
+ */
+struct CacheTextureLine {
+    uint16_t mMaxHeight;
+    uint16_t mMaxWidth;
+    uint32_t mCurrentRow;
+    uint32_t mCurrentCol;
+    bool mDirty;
+    // Value of FontRenderer::mUseCount the last time a glyph of this line was used
+    uint32_t mLastUsed;
+    CacheTexture* mCacheTexture;
+
+    CacheTextureLine(uint16_t maxWidth, uint16_t maxHeight, uint32_t currentRow,
+            uint32_t currentCol, CacheTexture* cacheTexture):
+                mMaxHeight(maxHeight),
+                mMaxWidth(maxWidth),
+                mCurrentRow(currentRow),
+                mCurrentCol(currentCol),
+                mDirty(false),
+                mLastUsed(0),
+                mCacheTexture(cacheTexture) {
+    }
+
+    bool fitBitmap(const SkGlyph& glyph, uint32_t *retOriginX, uint32_t *retOriginY) {
+        if (glyph.fHeight + 2 > mMaxHeight) {
+            return false;
+        }
+
+        if (mCurrentCol + glyph.fWidth + 2 < mMaxWidth) {
+            *retOriginX = mCurrentCol + 1;
+            *retOriginY = mCurrentRow + 1;
+            mCurrentCol += glyph.fWidth + 2;
+            mDirty = true;
+            return true;
+        }
+
+        return false;
+    }
+};
+
 ///////////////////////////////////////////////////////////////////////////////
 // Font
 ///////////////////////////////////////////////////////////////////////////////
@@ -104,6 +167,8 @@ protected:
     struct CachedGlyphInfo {
         // Has the cache been invalidated?
         bool mIsValid;
+        // Line of the cache texture that holds the glyph
+        CacheTextureLine* mCacheLine;
         // Location of the cached glyph in the bitmap
         // in case we need to resize the texture or
         // render to bitmap
@@ -134,7 +199,7 @@ protected:
     // Cache of glyphs
     DefaultKeyedVector<glyph_t, CachedGlyphInfo*> mCachedGlyphs;
 
-    void invalidateTextureCache();
+    void invalidateTextureCache(CacheTextureLine* line);
 
     CachedGlyphInfo* cacheGlyph(SkPaint* paint, glyph_t glyph);
     void updateGlyphCache(SkPaint* paint, const SkGlyph& skiaGlyph, CachedGlyphInfo *glyph);
@@ -184,8 +249,15 @@ public:
     }
 
     void setFont(SkPaint* paint, uint32_t fontId, float fontSize);
+    // Adds the glyphs of the specified text to the current batch and returns true
+    // if any of them is visible. The batch is only drawn when it is full, when the
+    // glyph cache must be flushed or when flushBatch() is called, which lets
+    // consecutive texts drawn with the same GL state share a single draw call.
     bool renderText(SkPaint* paint, const Rect* clip, const char *text, uint32_t startIndex,
             uint32_t len, int numGlyphs, int x, int y, Rect* bounds);
+    // Draws the batched glyphs, if any. The GL state the batch was set up with
+    // must still be current.
+    void flushBatch();
 
     struct DropShadow {
         DropShadow() { };
@@ -204,100 +276,84 @@ public:
     };
 
     // After renderDropShadow returns, the called owns the memory in DropShadow.image
-    // and is responsible for releasing it when it's done with it
+    // and is responsible for releasing it when it's done with it. If blur is false
+    // the image is left sharp, padded by the radius, for the caller to blur
     DropShadow renderDropShadow(SkPaint* paint, const char *text, uint32_t startIndex,
-            uint32_t len, int numGlyphs, uint32_t radius);
+            uint32_t len, int numGlyphs, uint32_t radius, bool blur = true);
 
+    /**
+     * Computes the 2 * radius + 1 weights of the Gaussian blur of the
+     * specified radius. The weights add up to 1.
+     */
+    static void computeGaussianWeights(float* weights, int32_t radius);
+    /**
+     * Blurs the specified alpha image in place.
+     */
+    static void blurImage(uint8_t* image, int32_t width, int32_t height, int32_t radius);
+
+    /**
+     * Returns the first texture of the glyph cache and selects the filtering
+     * used to draw text. The batch binds the texture that holds its glyphs
+     * when it is drawn, which may be another cache texture.
+     */
     GLuint getTexture(bool linearFiltering = false) {
         checkInit();
-        if (linearFiltering != mLinearFiltering) {
-            mLinearFiltering = linearFiltering;
-            const GLenum filtering = linearFiltering ? GL_LINEAR : GL_NEAREST;
-
-            glBindTexture(GL_TEXTURE_2D, mTextureId);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filtering);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filtering);
-        }
-        return mTextureId;
-    }
-
-    uint32_t getCacheWidth() const {
-        return mCacheWidth;
+        mLinearFiltering = linearFiltering;
+        return mCacheTextures[0]->mTextureId;
     }
 
-    uint32_t getCacheHeight() const {
-        return mCacheHeight;
-    }
+    /**
+     * Returns the size in bytes of the cache textures allocated so far.
+     */
+    uint32_t getCacheSize() const;
 
 protected:
     friend class Font;
 
     const uint8_t* mGammaTable;
 
-    struct CacheTextureLine {
-        uint16_t mMaxHeight;
-        uint16_t mMaxWidth;
-        uint32_t mCurrentRow;
-        uint32_t mCurrentCol;
-        bool mDirty;
-
-        CacheTextureLine(uint16_t maxWidth, uint16_t maxHeight, uint32_t currentRow,
-                uint32_t currentCol):
-                    mMaxHeight(maxHeight),
-                    mMaxWidth(maxWidth),
-                    mCurrentRow(currentRow),
-                    mCurrentCol(currentCol),
-                    mDirty(false) {
-        }
-
-        bool fitBitmap(const SkGlyph& glyph, uint32_t *retOriginX, uint32_t *retOriginY) {
-            if (glyph.fHeight + 2 > mMaxHeight) {
-                return false;
-            }
-
-            if (mCurrentCol + glyph.fWidth + 2 < mMaxWidth) {
-                *retOriginX = mCurrentCol + 1;
-                *retOriginY = mCurrentRow + 1;
-                mCurrentCol += glyph.fWidth + 2;
-                mDirty = true;
-                return true;
-            }
+    void createCacheTexture(bool largeFonts);
+    bool cacheBitmap(const SkGlyph& glyph, CacheTextureLine** retLine,
+            uint32_t *retOriginX, uint32_t *retOriginY);
+    bool fitBitmap(const SkGlyph& glyph, bool largeFonts, CacheTextureLine** retLine,
+            uint32_t *retOriginX, uint32_t *retOriginY);
+    bool evictLine(const SkGlyph& glyph, bool largeFonts);
 
-            return false;
-        }
-    };
-
-    void initTextTexture(bool largeFonts = false);
-    bool cacheBitmap(const SkGlyph& glyph, uint32_t *retOriginX, uint32_t *retOriginY);
-
-    void flushAllAndInvalidate();
     void initVertexArrayBuffers();
 
     void checkInit();
 
     String16 mLatinPrecache;
     void precacheLatin(SkPaint* paint);
+    void precacheUsedGlyphs(SkPaint* paint);
 
     void issueDrawCommand();
     void appendMeshQuad(float x1, float y1, float z1, float u1, float v1, float x2, float y2,
             float z2, float u2, float v2, float x3, float y3, float z3, float u3, float v3,
-            float x4, float y4, float z4, float u4, float v4);
+            float x4, float y4, float z4, float u4, float v4, CacheTexture* texture);
 
     uint32_t mCacheWidth;
     uint32_t mCacheHeight;
 
+    // The textures that cache glyph bitmaps; the textures sized for large
+    // glyphs, if any, are last
+    Vector<CacheTexture*> mCacheTextures;
+    uint32_t mSmallCacheTextureCount;
     Vector<CacheTextureLine*> mCacheLines;
+    // Tallest line of the textures sized for regular glyphs
+    uint32_t mMaxSmallLineHeight;
     uint32_t getRemainingCacheCapacity();
 
+    // Incremented for every text, used to find the least recently used line
+    uint32_t mUseCount;
+    // Precaching only uses free space, it never evicts glyphs
+    bool mPrecaching;
+
     Font* mCurrentFont;
     Vector<Font*> mActiveFonts;
 
-    // Texture to cache glyph bitmaps
-    uint8_t* mTextTexture;
-    const uint8_t* getTextTextureData() const {
-        return mTextTexture;
-    }
-    GLuint mTextureId;
+    // Cache texture the batched glyphs come from
+    CacheTexture* mCurrentCacheTexture;
     void checkTextureUpdate();
     bool mUploadTexture;
 
@@ -319,12 +375,11 @@ protected:
 
     bool mLinearFiltering;
 
-    void computeGaussianWeights(float* weights, int32_t radius);
-    void horizontalBlur(float* weights, int32_t radius, const uint8_t *source, uint8_t *dest,
-            int32_t width, int32_t height);
-    void verticalBlur(float* weights, int32_t radius, const uint8_t *source, uint8_t *dest,
-            int32_t width, int32_t height);
-    void blurImage(uint8_t* image, int32_t width, int32_t height, int32_t radius);
+    // The weights are 16.16 fixed point
+    static void horizontalBlur(const int32_t* weights, int32_t radius, const uint8_t *source,
+            uint8_t *dest, int32_t width, int32_t height);
+    static void verticalBlur(const int32_t* weights, int32_t radius, const uint8_t *source,
+            uint8_t *dest, int32_t width, int32_t height);
 };
 
 }; // namespace uirenderer
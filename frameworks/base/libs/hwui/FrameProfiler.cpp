@@ -0,0 +1,143 @@
+/*
+ * Copyright (C) 2011 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "OpenGLRenderer"
+
+#include <string.h>
+
+#include "FrameProfiler.h"
+#include "Properties.h"
+
+namespace android {
+
+#ifdef USE_OPENGL_RENDERER
+using namespace uirenderer;
+ANDROID_SINGLETON_STATIC_INSTANCE(FrameProfiler);
+#endif
+
+namespace uirenderer {
+
+///////////////////////////////////////////////////////////////////////////////
+// Constructors/destructor
+///////////////////////////////////////////////////////////////////////////////
+
+FrameProfiler::FrameProfiler(): mEnabled(false), mRenderer(NULL), mFrameStart(0),
+        mFrameCount(0) {
+    char property[PROPERTY_VALUE_MAX];
+    if (property_get(PROPERTY_PROFILE, property, NULL) > 0 && !strcmp(property, "true")) {
+        mEnabled = true;
+    }
+}
+
+FrameProfiler::~FrameProfiler() {
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Recording
+///////////////////////////////////////////////////////////////////////////////
+
+void FrameProfiler::startFrame(const void* renderer) {
+    if (mRenderer) {
+        return;
+    }
+
+    mRenderer = renderer;
+    mFrameStart = systemTime(SYSTEM_TIME_MONOTONIC);
+}
+
+void FrameProfiler::endFrame(const void* renderer) {
+    if (!mRenderer || mRenderer != renderer) {
+        return;
+    }
+
+    mRenderer = NULL;
+    mCurrent.frameTime = systemTime(SYSTEM_TIME_MONOTONIC) - mFrameStart;
+
+    {
+        Mutex::Autolock _l(mLock);
+
+        mFrames[mFrameCount % PROFILE_FRAME_COUNT] = mCurrent;
+        mFrameCount++;
+
+        for (int i = 0; i < PROFILE_MAX_OP_COUNT; i++) {
+            mOps[i].count += mCurrentOps[i].count;
+            mOps[i].time += mCurrentOps[i].time;
+        }
+
+        mDisplayLists = mCurrentDisplayLists;
+    }
+
+    mCurrent.clear();
+    for (int i = 0; i < PROFILE_MAX_OP_COUNT; i++) {
+        mCurrentOps[i] = OpProfile();
+    }
+    mCurrentDisplayLists.clear();
+}
+
+void FrameProfiler::addDisplayList(const void* displayList, size_t size) {
+    DisplayListProfile profile;
+    profile.displayList = displayList;
+    profile.size = size;
+    mCurrentDisplayLists.add(profile);
+
+    mCurrent.displayListCount++;
+    mCurrent.displayListSize += size;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Output
+///////////////////////////////////////////////////////////////////////////////
+
+static inline float toMs(nsecs_t time) {
+    return time / 1000000.0f;
+}
+
+void FrameProfiler::output(FILE* file, const char* opNames[], int opCount) {
+    if (!mEnabled) {
+        return;
+    }
+
+    Mutex::Autolock _l(mLock);
+
+    uint32_t count = mFrameCount < PROFILE_FRAME_COUNT ? mFrameCount : PROFILE_FRAME_COUNT;
+    fprintf(file, "\nProfile of the last %d frames (ms)\n", count);
+    fprintf(file, "     Frame    Record    Replay  Lists     Bytes\n");
+    for (uint32_t i = mFrameCount - count; i < mFrameCount; i++) {
+        const Frame& frame = mFrames[i % PROFILE_FRAME_COUNT];
+        fprintf(file, "  %8.2f  %8.2f  %8.2f  %5d  %8d\n", toMs(frame.frameTime),
+                toMs(frame.recordTime), toMs(frame.replayTime),
+                frame.displayListCount, frame.displayListSize);
+    }
+
+    fprintf(file, "\nDisplay list operations in %d frames\n", mFrameCount);
+    fprintf(file, "  Operation               Count  Total (ms)  Average (us)\n");
+    for (int i = 0; i < opCount && i < PROFILE_MAX_OP_COUNT; i++) {
+        const OpProfile& op = mOps[i];
+        if (op.count > 0) {
+            fprintf(file, "  %-20s %8d  %10.2f  %12.2f\n", opNames[i], op.count,
+                    toMs(op.time), op.time / 1000.0f / op.count);
+        }
+    }
+
+    fprintf(file, "\nDisplay lists drawn in the last frame\n");
+    for (size_t i = 0; i < mDisplayLists.size(); i++) {
+        const DisplayListProfile& profile = mDisplayLists.itemAt(i);
+        fprintf(file, "  %p  %8d bytes\n", profile.displayList, profile.size);
+    }
+}
+
+}; // namespace uirenderer
+}; // namespace android
@@ -0,0 +1,169 @@
+/*
+ * Copyright (C) 2011 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_HWUI_FRAME_PROFILER_H
+#define ANDROID_HWUI_FRAME_PROFILER_H
+
+#include <stdio.h>
+
+#include <utils/Singleton.h>
+#include <utils/threads.h>
+#include <utils/Timers.h>
+#include <utils/Vector.h>
+
+namespace android {
+namespace uirenderer {
+
+///////////////////////////////////////////////////////////////////////////////
+// Defines
+///////////////////////////////////////////////////////////////////////////////
+
+// Number of frames kept by the profiler
+#define PROFILE_FRAME_COUNT 64
+
+// Must be larger than the number of display list operations
+#define PROFILE_MAX_OP_COUNT 64
+
+///////////////////////////////////////////////////////////////////////////////
+// Classes
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Records where the time of the most recent frames goes: recording display
+ * lists, replaying them and executing each type of display list operation.
+ * The sizes of the display lists drawn in the last frame are kept as well.
+ *
+ * A frame goes from the prepare() to the finish() of the renderer that
+ * started it; the layers and display lists rendered in the meantime are
+ * part of the frame. The swap happens after finish() and is not included.
+ *
+ * Like DisplayListLogBuffer the profile is process-wide, and it is output
+ * with it by dumpsys gfxinfo. The profiler is only enabled if the
+ * PROPERTY_PROFILE property is set to "true" when the process starts.
+ * Everything but the output happens on the thread of the renderer.
+ */
+class FrameProfiler: public Singleton<FrameProfiler> {
+    FrameProfiler();
+    ~FrameProfiler();
+
+    friend class Singleton<FrameProfiler>;
+
+public:
+    inline bool isEnabled() const {
+        return mEnabled;
+    }
+
+    /**
+     * Starts a frame unless the specified renderer is drawing inside a
+     * frame started by another renderer.
+     */
+    void startFrame(const void* renderer);
+    /**
+     * Ends the current frame if it was started by the specified renderer.
+     */
+    void endFrame(const void* renderer);
+
+    /**
+     * Adds the time spent recording a display list.
+     */
+    void addRecordTime(nsecs_t time) {
+        mCurrent.recordTime += time;
+    }
+
+    /**
+     * Adds the time spent replaying a top-level display list.
+     */
+    void addReplayTime(nsecs_t time) {
+        mCurrent.replayTime += time;
+    }
+
+    /**
+     * Adds the time spent executing a display list operation.
+     */
+    void addOpTime(int op, nsecs_t time) {
+        if (op >= 0 && op < PROFILE_MAX_OP_COUNT) {
+            mCurrentOps[op].count++;
+            mCurrentOps[op].time += time;
+        }
+    }
+
+    /**
+     * Records a display list replayed in the current frame.
+     */
+    void addDisplayList(const void* displayList, size_t size);
+
+    /**
+     * Prints the profile to the specified file. The names of the display
+     * list operations are indexed by operation.
+     */
+    void output(FILE* file, const char* opNames[], int opCount);
+
+private:
+    struct Frame {
+        Frame() {
+            clear();
+        }
+
+        void clear() {
+            frameTime = 0;
+            recordTime = 0;
+            replayTime = 0;
+            displayListCount = 0;
+            displayListSize = 0;
+        }
+
+        nsecs_t frameTime;
+        nsecs_t recordTime;
+        nsecs_t replayTime;
+        uint32_t displayListCount;
+        uint32_t displayListSize;
+    };
+
+    struct OpProfile {
+        OpProfile(): count(0), time(0) {
+        }
+
+        uint32_t count;
+        nsecs_t time;
+    };
+
+    struct DisplayListProfile {
+        const void* displayList;
+        size_t size;
+    };
+
+    bool mEnabled;
+
+    // Written by the renderer only
+    const void* mRenderer;
+    nsecs_t mFrameStart;
+    Frame mCurrent;
+    OpProfile mCurrentOps[PROFILE_MAX_OP_COUNT];
+    Vector<DisplayListProfile> mCurrentDisplayLists;
+
+    // Guards what follows, read by output()
+    Mutex mLock;
+
+    Frame mFrames[PROFILE_FRAME_COUNT];
+    uint32_t mFrameCount;
+    OpProfile mOps[PROFILE_MAX_OP_COUNT];
+    Vector<DisplayListProfile> mDisplayLists;
+}; // class FrameProfiler
+
+}; // namespace uirenderer
+}; // namespace android
+
+#endif // ANDROID_HWUI_FRAME_PROFILER_H
@@ -36,11 +36,11 @@ struct GammaFontRenderer {
     uint32_t getFontRendererSize(uint32_t fontRenderer) const {
         switch (fontRenderer) {
             case 0:
-                return mDefaultRenderer.getCacheHeight() * mDefaultRenderer.getCacheWidth();
+                return mDefaultRenderer.getCacheSize();
             case 1:
-                return mBlackGammaRenderer.getCacheHeight() * mBlackGammaRenderer.getCacheWidth();
+                return mBlackGammaRenderer.getCacheSize();
             case 2:
-                return mWhiteGammaRenderer.getCacheHeight() * mWhiteGammaRenderer.getCacheWidth();
+                return mWhiteGammaRenderer.getCacheSize();
         }
         return 0;
     }
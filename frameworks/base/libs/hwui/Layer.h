@@ -199,6 +199,19 @@ struct Layer {
         glTexImage2D(renderTarget, 0, format, getWidth(), getHeight(), 0, format, storage, NULL);
     }
 
+    /**
+     * Exchanges the textures backing this layer and the specified layer.
+     */
+    inline void swapTexture(Layer* other) {
+        Texture t = texture;
+        texture = other->texture;
+        other->texture = t;
+
+        bool e = empty;
+        empty = other->empty;
+        other->empty = e;
+    }
+
     inline mat4& getTexTransform() {
         return texTransform;
     }
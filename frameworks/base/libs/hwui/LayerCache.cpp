@@ -20,6 +20,7 @@
 
 #include <utils/Log.h>
 
+#include "Caches.h"
 #include "Debug.h"
 #include "LayerCache.h"
 #include "Properties.h"
@@ -84,11 +85,36 @@ void LayerCache::clear() {
     mCache.clear();
 }
 
+ssize_t LayerCache::findLayer(const LayerEntry& entry) {
+    ssize_t index = mCache.indexOf(entry);
+    if (index >= 0) return index;
+
+    // Fall back to a slightly larger layer; the cache is sorted by width
+    // so the search can stop past the largest acceptable width
+    uint32_t bestArea = 0;
+    const size_t count = mCache.size();
+    for (size_t i = 0; i < count; i++) {
+        const LayerEntry& candidate = mCache.itemAt(i);
+        if (candidate.mWidth > entry.mWidth + LAYER_SIZE) break;
+
+        if (candidate.mWidth >= entry.mWidth && candidate.mHeight >= entry.mHeight &&
+                candidate.mHeight <= entry.mHeight + LAYER_SIZE) {
+            const uint32_t area = candidate.mWidth * candidate.mHeight;
+            if (index < 0 || area < bestArea) {
+                index = i;
+                bestArea = area;
+            }
+        }
+    }
+
+    return index;
+}
+
 Layer* LayerCache::get(const uint32_t width, const uint32_t height) {
     Layer* layer = NULL;
 
     LayerEntry entry(width, height);
-    ssize_t index = mCache.indexOf(entry);
+    ssize_t index = findLayer(entry);
 
     if (index >= 0) {
         entry = mCache.itemAt(index);
@@ -96,10 +122,12 @@ Layer* LayerCache::get(const uint32_t width, const uint32_t height) {
 
         layer = entry.mLayer;
         mSize -= layer->getWidth() * layer->getHeight() * 4;
+        mStats.hits++;
 
         LAYER_LOGD("Reusing layer %dx%d", layer->getWidth(), layer->getHeight());
     } else {
         LAYER_LOGD("Creating new layer %dx%d", entry.mWidth, entry.mHeight);
+        mStats.misses++;
 
         layer = new Layer(entry.mWidth, entry.mHeight);
         layer->setBlend(true);
@@ -129,18 +157,47 @@ void LayerCache::dump() {
 }
 
 bool LayerCache::resize(Layer* layer, const uint32_t width, const uint32_t height) {
-    // TODO: We should be smarter and see if we have a texture of the appropriate
-    //       size already in the cache, and reuse it instead of creating a new one
-
     LayerEntry entry(width, height);
     if (entry.mWidth <= layer->getWidth() && entry.mHeight <= layer->getHeight()) {
         return true;
     }
 
+    // Take the texture of a cached layer of the appropriate size if there
+    // is one and give the cache the current texture instead
+    ssize_t index = findLayer(entry);
+    if (index >= 0) {
+        Layer* cached = mCache.itemAt(index).mLayer;
+        mCache.removeAt(index);
+        mSize -= cached->getWidth() * cached->getHeight() * 4;
+        mStats.hits++;
+
+        LAYER_LOGD("Resizing layer %dx%d with cached texture %dx%d",
+                layer->getWidth(), layer->getHeight(), cached->getWidth(), cached->getHeight());
+
+        cached->swapTexture(layer);
+        if (!put(cached)) {
+            cached->deleteTexture();
+            delete cached;
+        }
+
+        if (layer->getFbo()) {
+            GLuint previousFbo;
+            glGetIntegerv(GL_FRAMEBUFFER_BINDING, (GLint*) &previousFbo);
+            glBindFramebuffer(GL_FRAMEBUFFER, layer->getFbo());
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+                    layer->getTexture(), 0);
+            glBindFramebuffer(GL_FRAMEBUFFER, previousFbo);
+        }
+
+        return true;
+    }
+
+    mStats.misses++;
+
     uint32_t oldWidth = layer->getWidth();
     uint32_t oldHeight = layer->getHeight();
 
-    glActiveTexture(GL_TEXTURE0);
+    Caches::getInstance().activeTexture(0);
     layer->bindTexture();
     layer->setSize(entry.mWidth, entry.mHeight);
     layer->allocateTexture(GL_RGBA, GL_UNSIGNED_BYTE);
@@ -168,6 +225,7 @@ bool LayerCache::put(Layer* layer) {
             Layer* victim = mCache.itemAt(position).mLayer;
             deleteLayer(victim);
             mCache.removeAt(position);
+            mStats.evictions++;
 
             LAYER_LOGD("  Deleting layer %.2fx%.2f", victim->layer.getWidth(),
                     victim->layer.getHeight());
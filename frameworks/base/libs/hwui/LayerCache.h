@@ -97,6 +97,25 @@ public:
      */
     uint32_t getSize();
 
+    struct Stats {
+        Stats(): hits(0), misses(0), evictions(0) {
+        }
+
+        // Layers or textures reused from the cache
+        uint32_t hits;
+        // Layers or textures that had to be allocated
+        uint32_t misses;
+        // Layers deleted to make room in the cache
+        uint32_t evictions;
+    };
+
+    /**
+     * Returns the statistics of the cache since it was created.
+     */
+    const Stats& getStats() const {
+        return mStats;
+    }
+
     /**
      * Prints out the content of the cache.
      */
@@ -135,10 +154,19 @@ private:
         uint32_t mHeight;
     }; // struct LayerEntry
 
+    /**
+     * Returns the index of the smallest cached layer that can hold the
+     * specified entry and is at most one LAYER_SIZE larger in each
+     * dimension, -1 if there is none.
+     */
+    ssize_t findLayer(const LayerEntry& entry);
+
     SortedList<LayerEntry> mCache;
 
     uint32_t mSize;
     uint32_t mMaxSize;
+
+    Stats mStats;
 }; // class LayerCache
 
 }; // namespace uirenderer
@@ -182,7 +182,7 @@ Layer* LayerRenderer::createLayer(uint32_t width, uint32_t height, bool isOpaque
         return NULL;
     }
 
-    glActiveTexture(GL_TEXTURE0);
+    Caches::getInstance().activeTexture(0);
     Layer* layer = Caches::getInstance().layerCache.get(width, height);
     if (!layer) {
         LOGW("Could not obtain a layer");
@@ -225,10 +225,21 @@ Layer* LayerRenderer::createLayer(uint32_t width, uint32_t height, bool isOpaque
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
             layer->getTexture(), 0);
 
-    glDisable(GL_SCISSOR_TEST);
-    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
-    glClear(GL_COLOR_BUFFER_BIT);
-    glEnable(GL_SCISSOR_TEST);
+    // Opaque layers are entirely covered by their first frame, only
+    // translucent layers need to start out transparent. The texture can
+    // be larger than the layer when it comes from the cache, only the
+    // part used by the layer is cleared
+    if (!isOpaque) {
+        GLint scissor[4];
+        glGetIntegerv(GL_SCISSOR_BOX, scissor);
+        glEnable(GL_SCISSOR_TEST);
+        glScissor(0, 0, width, height);
+
+        glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
+
+        glScissor(scissor[0], scissor[1], scissor[2], scissor[3]);
+    }
 
     glBindFramebuffer(GL_FRAMEBUFFER, previousFbo);
 
@@ -268,7 +279,7 @@ Layer* LayerRenderer::createTextureLayer(bool isOpaque) {
     layer->region.clear();
     layer->setRenderTarget(GL_NONE); // see ::updateTextureLayer()
 
-    glActiveTexture(GL_TEXTURE0);
+    Caches::getInstance().activeTexture(0);
     layer->generateTexture();
 
     return layer;
@@ -378,7 +389,7 @@ bool LayerRenderer::copyLayer(Layer* layer, SkBitmap* bitmap) {
         glGenTextures(1, &texture);
         if ((error = glGetError()) != GL_NO_ERROR) goto error;
 
-        glActiveTexture(GL_TEXTURE0);
+        caches.activeTexture(0);
         glBindTexture(GL_TEXTURE_2D, texture);
 
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
@@ -32,6 +32,8 @@
 
 #include "OpenGLRenderer.h"
 #include "DisplayListRenderer.h"
+#include "FrameProfiler.h"
+#include "PathTessellator.h"
 #include "Vector.h"
 
 namespace android {
@@ -101,12 +103,6 @@ static const Blender gBlendsSwap[] = {
     { SkXfermode::kScreen_Mode,   GL_ONE_MINUS_DST_COLOR, GL_ONE }
 };
 
-static const GLenum gTextureUnits[] = {
-    GL_TEXTURE0,
-    GL_TEXTURE1,
-    GL_TEXTURE2
-};
-
 ///////////////////////////////////////////////////////////////////////////////
 // Constructors/destructor
 ///////////////////////////////////////////////////////////////////////////////
@@ -115,6 +111,7 @@ OpenGLRenderer::OpenGLRenderer(): mCaches(Caches::getInstance()) {
     mShader = NULL;
     mColorFilter = NULL;
     mHasShadow = false;
+    mTextBatchRenderer = NULL;
 
     memcpy(mMeshVertices, gMeshVertices, sizeof(gMeshVertices));
 
@@ -150,6 +147,13 @@ void OpenGLRenderer::prepare(bool opaque) {
 
 void OpenGLRenderer::prepareDirty(float left, float top, float right, float bottom, bool opaque) {
     mCaches.clearGarbage();
+    // The GL context may have been used by others since the last frame
+    mCaches.resetState();
+
+    FrameProfiler& profiler = FrameProfiler::getInstance();
+    if (profiler.isEnabled()) {
+        profiler.startFrame(this);
+    }
 
     mSnapshot = new Snapshot(mFirstSnapshot,
             SkCanvas::kMatrix_SaveFlag | SkCanvas::kClip_SaveFlag);
@@ -160,7 +164,7 @@ void OpenGLRenderer::prepareDirty(float left, float top, float right, float bott
     glViewport(0, 0, mWidth, mHeight);
 
     glEnable(GL_SCISSOR_TEST);
-    glScissor(left, mSnapshot->height - bottom, right - left, bottom - top);
+    mCaches.setScissor(left, mSnapshot->height - bottom, right - left, bottom - top);
     mSnapshot->setClip(left, top, right, bottom);
 
     if (!opaque) {
@@ -170,6 +174,8 @@ void OpenGLRenderer::prepareDirty(float left, float top, float right, float bott
 }
 
 void OpenGLRenderer::finish() {
+    flushTextBatch();
+
 #if DEBUG_OPENGL
     GLenum status = GL_NO_ERROR;
     while ((status = glGetError()) != GL_NO_ERROR) {
@@ -188,9 +194,16 @@ void OpenGLRenderer::finish() {
         mCaches.dumpMemoryUsage();
     }
 #endif
+
+    FrameProfiler& profiler = FrameProfiler::getInstance();
+    if (profiler.isEnabled()) {
+        profiler.endFrame(this);
+    }
 }
 
 void OpenGLRenderer::interrupt() {
+    flushTextBatch();
+
     if (mCaches.currentProgram) {
         if (mCaches.currentProgram->isInUse()) {
             mCaches.currentProgram->remove();
@@ -209,7 +222,10 @@ void OpenGLRenderer::resume() {
     glDisable(GL_DITHER);
 
     glBindFramebuffer(GL_FRAMEBUFFER, getTargetFbo());
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+    // GL calls were issued outside of the renderer
+    mCaches.resetState();
+    mCaches.unbindIndicesBuffer();
 
     mCaches.blend = true;
     glEnable(GL_BLEND);
@@ -414,6 +430,8 @@ bool OpenGLRenderer::createLayer(sp<Snapshot> snapshot, float left, float top,
     LAYER_LOGD("Requesting layer %.2fx%.2f", right - left, bottom - top);
     LAYER_LOGD("Layer cache size = %d", mCaches.layerCache.getSize());
 
+    flushTextBatch();
+
     const bool fboLayer = flags & SkCanvas::kClipToLayer_SaveFlag;
 
     // Window coordinates of the layer
@@ -449,7 +467,7 @@ bool OpenGLRenderer::createLayer(sp<Snapshot> snapshot, float left, float top,
         return false;
     }
 
-    glActiveTexture(gTextureUnits[0]);
+    mCaches.activeTexture(0);
     Layer* layer = mCaches.layerCache.get(bounds.getWidth(), bounds.getHeight());
     if (!layer) {
         return false;
@@ -550,7 +568,7 @@ bool OpenGLRenderer::createFboLayer(Layer* layer, Rect& bounds, sp<Snapshot> sna
 #endif
 
     // Clear the FBO, expand the clear region by 1 to get nice bilinear filtering
-    glScissor(clip.left - 1.0f, bounds.getHeight() - clip.bottom - 1.0f,
+    mCaches.setScissor(clip.left - 1.0f, bounds.getHeight() - clip.bottom - 1.0f,
             clip.getWidth() + 2.0f, clip.getHeight() + 2.0f);
     glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
     glClear(GL_COLOR_BUFFER_BIT);
@@ -573,6 +591,8 @@ void OpenGLRenderer::composeLayer(sp<Snapshot> current, sp<Snapshot> previous) {
         return;
     }
 
+    flushTextBatch();
+
     const bool fboLayer = current->flags & Snapshot::kFlagIsFboLayer;
 
     if (fboLayer) {
@@ -592,7 +612,7 @@ void OpenGLRenderer::composeLayer(sp<Snapshot> current, sp<Snapshot> previous) {
 
     mCaches.unbindMeshBuffer();
 
-    glActiveTexture(gTextureUnits[0]);
+    mCaches.activeTexture(0);
 
     // When the layer is stored in an FBO, we can save a bit of fillrate by
     // drawing only the dirty region
@@ -793,7 +813,7 @@ void OpenGLRenderer::composeLayerRegion(Layer* layer, const Rect& rect) {
             glDrawElements(GL_TRIANGLES, numQuads * 6, GL_UNSIGNED_SHORT, NULL);
         }
 
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+        mCaches.unbindIndicesBuffer();
         finishDrawTexture();
 
 #if DEBUG_LAYERS_AS_REGIONS
@@ -904,7 +924,7 @@ void OpenGLRenderer::clearLayerRegions() {
         setupDrawModelViewTranslate(0.0f, 0.0f, 0.0f, 0.0f, true);
 
         mCaches.unbindMeshBuffer();
-        glVertexAttribPointer(mCaches.currentProgram->position, 2, GL_FLOAT, GL_FALSE,
+        mCaches.bindAttribPointer(mCaches.currentProgram->position, 2,
                 gVertexStride, &mesh[0].position[0]);
         glDrawArrays(GL_TRIANGLES, 0, count * 6);
 
@@ -960,7 +980,8 @@ void OpenGLRenderer::concatMatrix(SkMatrix* matrix) {
 void OpenGLRenderer::setScissorFromClip() {
     Rect clip(*mSnapshot->clipRect);
     clip.snapToPixelBoundaries();
-    glScissor(clip.left, mSnapshot->height - clip.bottom, clip.getWidth(), clip.getHeight());
+    mCaches.setScissor(clip.left, mSnapshot->height - clip.bottom,
+            clip.getWidth(), clip.getHeight());
     mDirtyClip = false;
 }
 
@@ -996,6 +1017,7 @@ bool OpenGLRenderer::clipRect(float left, float top, float right, float bottom,
 ///////////////////////////////////////////////////////////////////////////////
 
 void OpenGLRenderer::setupDraw(bool clear) {
+    flushTextBatch();
     if (clear) clearLayerRegions();
     if (mDirtyClip) {
         setScissorFromClip();
@@ -1193,8 +1215,7 @@ void OpenGLRenderer::setupDrawColorFilterUniforms() {
 
 void OpenGLRenderer::setupDrawSimpleMesh() {
     mCaches.bindMeshBuffer();
-    glVertexAttribPointer(mCaches.currentProgram->position, 2, GL_FLOAT, GL_FALSE,
-            gMeshStride, 0);
+    mCaches.bindAttribPointer(mCaches.currentProgram->position, 2, gMeshStride, 0);
 }
 
 void OpenGLRenderer::setupDrawTexture(GLuint texture) {
@@ -1217,7 +1238,7 @@ void OpenGLRenderer::setupDrawTextureTransform() {
     mDescription.hasTextureTransform = true;
 }
 
-void OpenGLRenderer::setupDrawTextureTransformUniforms(mat4& transform) {
+void OpenGLRenderer::setupDrawTextureTransformUniforms(const mat4& transform) {
     glUniformMatrix4fv(mCaches.currentProgram->getUniform("mainTextureTransform"), 1,
             GL_FALSE, &transform.data[0]);
 }
@@ -1228,17 +1249,15 @@ void OpenGLRenderer::setupDrawMesh(GLvoid* vertices, GLvoid* texCoords, GLuint v
     } else {
         mCaches.unbindMeshBuffer();
     }
-    glVertexAttribPointer(mCaches.currentProgram->position, 2, GL_FLOAT, GL_FALSE,
-            gMeshStride, vertices);
+    mCaches.bindAttribPointer(mCaches.currentProgram->position, 2, gMeshStride, vertices);
     if (mTexCoordsSlot >= 0) {
-        glVertexAttribPointer(mTexCoordsSlot, 2, GL_FLOAT, GL_FALSE, gMeshStride, texCoords);
+        mCaches.bindAttribPointer(mTexCoordsSlot, 2, gMeshStride, texCoords);
     }
 }
 
 void OpenGLRenderer::setupDrawVertices(GLvoid* vertices) {
     mCaches.unbindMeshBuffer();
-    glVertexAttribPointer(mCaches.currentProgram->position, 2, GL_FLOAT, GL_FALSE,
-            gVertexStride, vertices);
+    mCaches.bindAttribPointer(mCaches.currentProgram->position, 2, gVertexStride, vertices);
 }
 
 /**
@@ -1255,14 +1274,13 @@ void OpenGLRenderer::setupDrawVertices(GLvoid* vertices) {
 void OpenGLRenderer::setupDrawAALine(GLvoid* vertices, GLvoid* widthCoords,
         GLvoid* lengthCoords, float boundaryWidthProportion) {
     mCaches.unbindMeshBuffer();
-    glVertexAttribPointer(mCaches.currentProgram->position, 2, GL_FLOAT, GL_FALSE,
-            gAAVertexStride, vertices);
+    mCaches.bindAttribPointer(mCaches.currentProgram->position, 2, gAAVertexStride, vertices);
     int widthSlot = mCaches.currentProgram->getAttrib("vtxWidth");
     glEnableVertexAttribArray(widthSlot);
-    glVertexAttribPointer(widthSlot, 1, GL_FLOAT, GL_FALSE, gAAVertexStride, widthCoords);
+    mCaches.bindAttribPointer(widthSlot, 1, gAAVertexStride, widthCoords);
     int lengthSlot = mCaches.currentProgram->getAttrib("vtxLength");
     glEnableVertexAttribArray(lengthSlot);
-    glVertexAttribPointer(lengthSlot, 1, GL_FLOAT, GL_FALSE, gAAVertexStride, lengthCoords);
+    mCaches.bindAttribPointer(lengthSlot, 1, gAAVertexStride, lengthCoords);
     int boundaryWidthSlot = mCaches.currentProgram->getUniform("boundaryWidth");
     glUniform1f(boundaryWidthSlot, boundaryWidthProportion);
     // Setting the inverse value saves computations per-fragment in the shader
@@ -1270,6 +1288,19 @@ void OpenGLRenderer::setupDrawAALine(GLvoid* vertices, GLvoid* widthCoords,
     glUniform1f(inverseBoundaryWidthSlot, (1 / boundaryWidthProportion));
 }
 
+void OpenGLRenderer::flushTextBatch() {
+    if (mTextBatchRenderer) {
+        mCaches.activeTexture(0);
+        mCaches.unbindMeshBuffer();
+        mTextBatchRenderer->flushBatch();
+
+        mCaches.unbindIndicesBuffer();
+        glDisableVertexAttribArray(mTextBatchTexCoordsSlot);
+
+        mTextBatchRenderer = NULL;
+    }
+}
+
 void OpenGLRenderer::finishDrawTexture() {
     glDisableVertexAttribArray(mTexCoordsSlot);
 }
@@ -1287,7 +1318,24 @@ bool OpenGLRenderer::drawDisplayList(DisplayList* displayList, uint32_t width, u
     // All the usual checks and setup operations (quickReject, setupDraw, etc.)
     // will be performed by the display list itself
     if (displayList && displayList->isRenderable()) {
-        return displayList->replay(*this, dirty, level);
+        FrameProfiler& profiler = FrameProfiler::getInstance();
+        const bool profile = level == 0 && profiler.isEnabled();
+        nsecs_t replayStart = profile ? systemTime(SYSTEM_TIME_MONOTONIC) : 0;
+
+        bool needsInvalidate = displayList->replay(*this, dirty, level);
+
+        if (profile) {
+            profiler.addReplayTime(systemTime(SYSTEM_TIME_MONOTONIC) - replayStart);
+        }
+
+        // Bitmaps whose textures are still being uploaded were skipped,
+        // ask for the whole display list to be drawn again
+        if (level == 0 && mCaches.textureCache.hasPendingUploads()) {
+            dirty.setEmpty();
+            needsInvalidate = true;
+        }
+
+        return needsInvalidate;
     }
 
     return false;
@@ -1349,8 +1397,8 @@ void OpenGLRenderer::drawBitmap(SkBitmap* bitmap, float left, float top, SkPaint
         return;
     }
 
-    glActiveTexture(gTextureUnits[0]);
-    Texture* texture = mCaches.textureCache.get(bitmap);
+    mCaches.activeTexture(0);
+    Texture* texture = mCaches.textureCache.getPacked(bitmap);
     if (!texture) return;
     const AutoTexture autoCleanup(texture);
 
@@ -1370,8 +1418,8 @@ void OpenGLRenderer::drawBitmap(SkBitmap* bitmap, SkMatrix* matrix, SkPaint* pai
         return;
     }
 
-    glActiveTexture(gTextureUnits[0]);
-    Texture* texture = mCaches.textureCache.get(bitmap);
+    mCaches.activeTexture(0);
+    Texture* texture = mCaches.textureCache.getDeferred(bitmap);
     if (!texture) return;
     const AutoTexture autoCleanup(texture);
 
@@ -1390,8 +1438,8 @@ void OpenGLRenderer::drawBitmapMesh(SkBitmap* bitmap, int meshWidth, int meshHei
         return;
     }
 
-    glActiveTexture(gTextureUnits[0]);
-    Texture* texture = mCaches.textureCache.get(bitmap);
+    mCaches.activeTexture(0);
+    Texture* texture = mCaches.textureCache.getDeferred(bitmap);
     if (!texture) return;
     const AutoTexture autoCleanup(texture);
 
@@ -1475,8 +1523,8 @@ void OpenGLRenderer::drawBitmap(SkBitmap* bitmap,
         return;
     }
 
-    glActiveTexture(gTextureUnits[0]);
-    Texture* texture = mCaches.textureCache.get(bitmap);
+    mCaches.activeTexture(0);
+    Texture* texture = mCaches.textureCache.getPacked(bitmap);
     if (!texture) return;
     const AutoTexture autoCleanup(texture);
     texture->setWrap(GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE, true);
@@ -1510,13 +1558,15 @@ void OpenGLRenderer::drawBitmap(SkBitmap* bitmap,
         drawTextureMesh(x, y, x + (dstRight - dstLeft), y + (dstBottom - dstTop),
                 texture->id, alpha / 255.0f, mode, texture->blend,
                 &mMeshVertices[0].position[0], &mMeshVertices[0].texture[0],
-                GL_TRIANGLE_STRIP, gMeshCount, false, true);
+                GL_TRIANGLE_STRIP, gMeshCount, false, true, 0, false, true,
+                texture->getTexTransform());
     } else {
         texture->setFilter(GL_LINEAR, GL_LINEAR, true);
 
         drawTextureMesh(dstLeft, dstTop, dstRight, dstBottom, texture->id, alpha / 255.0f,
                 mode, texture->blend, &mMeshVertices[0].position[0], &mMeshVertices[0].texture[0],
-                GL_TRIANGLE_STRIP, gMeshCount);
+                GL_TRIANGLE_STRIP, gMeshCount, false, false, 0, false, true,
+                texture->getTexTransform());
     }
 
     resetDrawTextureTexCoords(0.0f, 0.0f, 1.0f, 1.0f);
@@ -1529,8 +1579,8 @@ void OpenGLRenderer::drawPatch(SkBitmap* bitmap, const int32_t* xDivs, const int
         return;
     }
 
-    glActiveTexture(gTextureUnits[0]);
-    Texture* texture = mCaches.textureCache.get(bitmap);
+    mCaches.activeTexture(0);
+    Texture* texture = mCaches.textureCache.getPacked(bitmap);
     if (!texture) return;
     const AutoTexture autoCleanup(texture);
     texture->setWrap(GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE, true);
@@ -1572,12 +1622,12 @@ void OpenGLRenderer::drawPatch(SkBitmap* bitmap, const int32_t* xDivs, const int
             drawTextureMesh(x, y, x + right - left, y + bottom - top, texture->id, alpha / 255.0f,
                     mode, texture->blend, (GLvoid*) 0, (GLvoid*) gMeshTextureOffset,
                     GL_TRIANGLES, mesh->verticesCount, false, true, mesh->meshBuffer,
-                    true, !mesh->hasEmptyQuads);
+                    true, !mesh->hasEmptyQuads, texture->getTexTransform());
         } else {
             drawTextureMesh(left, top, right, bottom, texture->id, alpha / 255.0f,
                     mode, texture->blend, (GLvoid*) 0, (GLvoid*) gMeshTextureOffset,
                     GL_TRIANGLES, mesh->verticesCount, false, false, mesh->meshBuffer,
-                    true, !mesh->hasEmptyQuads);
+                    true, !mesh->hasEmptyQuads, texture->getTexTransform());
         }
     }
 }
@@ -1973,11 +2023,96 @@ void OpenGLRenderer::drawShape(float left, float top, const PathTexture* texture
     drawPathTexture(texture, x, y, paint);
 }
 
+bool OpenGLRenderer::drawTessellatedPath(const SkPath& path, SkPaint* paint) {
+    if (!PathTessellator::canTessellate(paint)) return false;
+
+    // Curves and the anti-aliasing fringe are sized in pixels
+    float scale = 1.0f;
+    if (!mSnapshot->transform->isPureTranslate()) {
+        const Matrix4& mat = *mSnapshot->transform;
+        const float m00 = mat.data[Matrix4::kScaleX];
+        const float m01 = mat.data[Matrix4::kSkewY];
+        const float m10 = mat.data[Matrix4::kSkewX];
+        const float m11 = mat.data[Matrix4::kScaleY];
+        scale = fmaxf(sqrtf(m00 * m00 + m01 * m01), sqrtf(m10 * m10 + m11 * m11));
+    }
+
+    Vector<AAVertex> vertices;
+    float boundaryWidth;
+    if (!PathTessellator::tessellate(path, paint, scale, vertices, &boundaryWidth)) {
+        return false;
+    }
+
+    const size_t count = vertices.size();
+    AAVertex* aaVertices = vertices.editArray();
+
+    float left = aaVertices[0].position[0];
+    float top = aaVertices[0].position[1];
+    float right = left;
+    float bottom = top;
+    for (size_t i = 1; i < count; i++) {
+        const float x = aaVertices[i].position[0];
+        const float y = aaVertices[i].position[1];
+        left = fminf(left, x);
+        top = fminf(top, y);
+        right = fmaxf(right, x);
+        bottom = fmaxf(bottom, y);
+    }
+    if (quickReject(left, top, right, bottom)) return true;
+
+    const bool isAA = paint->isAntiAlias();
+    int alpha;
+    SkXfermode::Mode mode;
+    getAlphaAndMode(paint, &alpha, &mode);
+
+    setupDraw();
+    if (isAA) {
+        setupDrawAALine();
+    }
+    setupDrawColor(paint->getColor(), alpha);
+    setupDrawColorFilter();
+    setupDrawShader();
+    if (isAA) {
+        setupDrawBlending(true, mode);
+    } else {
+        setupDrawBlending(mode);
+    }
+    setupDrawProgram();
+    setupDrawModelViewIdentity(true);
+    setupDrawColorUniforms();
+    setupDrawColorFilterUniforms();
+    setupDrawShaderIdentityUniforms();
+
+    if (isAA) {
+        void* widthCoords = ((GLbyte*) aaVertices) + gVertexAAWidthOffset;
+        void* lengthCoords = ((GLbyte*) aaVertices) + gVertexAALengthOffset;
+        setupDrawAALine((void*) aaVertices, widthCoords, lengthCoords, boundaryWidth);
+        int boundaryLengthSlot = mCaches.currentProgram->getUniform("boundaryLength");
+        int inverseBoundaryLengthSlot = mCaches.currentProgram->getUniform("inverseBoundaryLength");
+        glUniform1f(boundaryLengthSlot, PATH_BOUNDARY_LENGTH);
+        glUniform1f(inverseBoundaryLengthSlot, 1.0f / PATH_BOUNDARY_LENGTH);
+    } else {
+        mCaches.unbindMeshBuffer();
+        mCaches.bindAttribPointer(mCaches.currentProgram->position, 2, gAAVertexStride, aaVertices);
+    }
+
+    dirtyLayer(left, top, right, bottom, *mSnapshot->transform);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, count);
+
+    return true;
+}
+
 void OpenGLRenderer::drawRoundRect(float left, float top, float right, float bottom,
         float rx, float ry, SkPaint* paint) {
     if (mSnapshot->isIgnored()) return;
 
-    glActiveTexture(gTextureUnits[0]);
+    SkPath path;
+    SkRect rect;
+    rect.set(left, top, right, bottom);
+    path.addRoundRect(rect, rx, ry, SkPath::kCW_Direction);
+    if (drawTessellatedPath(path, paint)) return;
+
+    mCaches.activeTexture(0);
     const PathTexture* texture = mCaches.roundRectShapeCache.getRoundRect(
             right - left, bottom - top, rx, ry, paint);
     drawShape(left, top, texture, paint);
@@ -1986,7 +2121,11 @@ void OpenGLRenderer::drawRoundRect(float left, float top, float right, float bot
 void OpenGLRenderer::drawCircle(float x, float y, float radius, SkPaint* paint) {
     if (mSnapshot->isIgnored()) return;
 
-    glActiveTexture(gTextureUnits[0]);
+    SkPath path;
+    path.addCircle(x, y, radius);
+    if (drawTessellatedPath(path, paint)) return;
+
+    mCaches.activeTexture(0);
     const PathTexture* texture = mCaches.circleShapeCache.getCircle(radius, paint);
     drawShape(x - radius, y - radius, texture, paint);
 }
@@ -1994,7 +2133,13 @@ void OpenGLRenderer::drawCircle(float x, float y, float radius, SkPaint* paint)
 void OpenGLRenderer::drawOval(float left, float top, float right, float bottom, SkPaint* paint) {
     if (mSnapshot->isIgnored()) return;
 
-    glActiveTexture(gTextureUnits[0]);
+    SkPath path;
+    SkRect rect;
+    rect.set(left, top, right, bottom);
+    path.addOval(rect);
+    if (drawTessellatedPath(path, paint)) return;
+
+    mCaches.activeTexture(0);
     const PathTexture* texture = mCaches.ovalShapeCache.getOval(right - left, bottom - top, paint);
     drawShape(left, top, texture, paint);
 }
@@ -2008,7 +2153,19 @@ void OpenGLRenderer::drawArc(float left, float top, float right, float bottom,
         return;
     }
 
-    glActiveTexture(gTextureUnits[0]);
+    SkPath path;
+    SkRect rect;
+    rect.set(left, top, right, bottom);
+    if (useCenter) {
+        path.moveTo(rect.centerX(), rect.centerY());
+    }
+    path.arcTo(rect, startAngle, sweepAngle, !useCenter);
+    if (useCenter) {
+        path.close();
+    }
+    if (drawTessellatedPath(path, paint)) return;
+
+    mCaches.activeTexture(0);
     const PathTexture* texture = mCaches.arcShapeCache.getArc(right - left, bottom - top,
             startAngle, sweepAngle, useCenter, paint);
     drawShape(left, top, texture, paint);
@@ -2018,7 +2175,11 @@ void OpenGLRenderer::drawRectAsShape(float left, float top, float right, float b
         SkPaint* paint) {
     if (mSnapshot->isIgnored()) return;
 
-    glActiveTexture(gTextureUnits[0]);
+    SkPath path;
+    path.addRect(left, top, right, bottom);
+    if (drawTessellatedPath(path, paint)) return;
+
+    mCaches.activeTexture(0);
     const PathTexture* texture = mCaches.rectShapeCache.getRect(right - left, bottom - top, paint);
     drawShape(left, top, texture, paint);
 }
@@ -2101,6 +2262,9 @@ void OpenGLRenderer::drawText(const char* text, int bytesCount, int count,
     getAlphaAndMode(paint, &alpha, &mode);
 
     if (mHasShadow) {
+        // Generating the shadow may render into an FBO
+        flushTextBatch();
+
         mCaches.dropShadowCache.setFontRenderer(fontRenderer);
         const ShadowTexture* shadow = mCaches.dropShadowCache.get(
                 paint, text, bytesCount, count, mShadowRadius);
@@ -2115,7 +2279,7 @@ void OpenGLRenderer::drawText(const char* text, int bytesCount, int count,
             shadowColor = 0xffffffff;
         }
 
-        glActiveTexture(gTextureUnits[0]);
+        mCaches.activeTexture(0);
         setupDraw();
         setupDrawWithTexture(true);
         setupDrawAlpha8Color(shadowColor, shadowAlpha < 255 ? shadowAlpha : alpha);
@@ -2145,20 +2309,31 @@ void OpenGLRenderer::drawText(const char* text, int bytesCount, int count,
         linearFilter = fabs(y - (int) y) > 0.0f || fabs(x - (int) x) > 0.0f;
     }
 
-    glActiveTexture(gTextureUnits[0]);
-    setupDraw();
-    setupDrawDirtyRegionsDisabled();
-    setupDrawWithTexture(true);
-    setupDrawAlpha8Color(paint->getColor(), alpha);
-    setupDrawColorFilter();
-    setupDrawShader();
-    setupDrawBlending(true, mode);
-    setupDrawProgram();
-    setupDrawModelView(x, y, x, y, pureTranslate, true);
-    setupDrawTexture(fontRenderer.getTexture(linearFilter));
-    setupDrawPureColorUniforms();
-    setupDrawColorFilterUniforms();
-    setupDrawShaderUniforms(pureTranslate);
+    // With a pure translation the glyphs are positioned in window coordinates,
+    // so if nothing else changed since the previous text the GL state it set up
+    // can be reused as is and both texts drawn at once
+    const bool batched = mTextBatchRenderer == &fontRenderer && pureTranslate &&
+            !mShader && mTextBatchColorFilter == mColorFilter &&
+            mTextBatchColor == paint->getColor() && mTextBatchAlpha == alpha &&
+            mTextBatchMode == mode && mTextBatchLinearFilter == linearFilter &&
+            mTextBatchClip == *mSnapshot->clipRect;
+
+    if (!batched) {
+        mCaches.activeTexture(0);
+        setupDraw();
+        setupDrawDirtyRegionsDisabled();
+        setupDrawWithTexture(true);
+        setupDrawAlpha8Color(paint->getColor(), alpha);
+        setupDrawColorFilter();
+        setupDrawShader();
+        setupDrawBlending(true, mode);
+        setupDrawProgram();
+        setupDrawModelView(x, y, x, y, pureTranslate, true);
+        setupDrawTexture(fontRenderer.getTexture(linearFilter));
+        setupDrawPureColorUniforms();
+        setupDrawColorFilterUniforms();
+        setupDrawShaderUniforms(pureTranslate);
+    }
 
     const Rect* clip = pureTranslate ? mSnapshot->clipRect : &mSnapshot->getLocalClip();
     Rect bounds(FLT_MAX / 2.0f, FLT_MAX / 2.0f, FLT_MIN / 2.0f, FLT_MIN / 2.0f);
@@ -2168,12 +2343,25 @@ void OpenGLRenderer::drawText(const char* text, int bytesCount, int count,
 #else
     bool hasActiveLayer = false;
 #endif
-    mCaches.unbindMeshBuffer();
 
-    // Tell font renderer the locations of position and texture coord
-    // attributes so it can bind its data properly
-    int positionSlot = mCaches.currentProgram->position;
-    fontRenderer.setAttributeBindingSlots(positionSlot, mTexCoordsSlot);
+    if (!batched) {
+        mCaches.unbindMeshBuffer();
+
+        // Tell font renderer the locations of position and texture coord
+        // attributes so it can bind its data properly
+        int positionSlot = mCaches.currentProgram->position;
+        fontRenderer.setAttributeBindingSlots(positionSlot, mTexCoordsSlot);
+
+        mTextBatchRenderer = &fontRenderer;
+        mTextBatchColor = paint->getColor();
+        mTextBatchAlpha = alpha;
+        mTextBatchMode = mode;
+        mTextBatchColorFilter = mColorFilter;
+        mTextBatchLinearFilter = linearFilter;
+        mTextBatchClip.set(*mSnapshot->clipRect);
+        mTextBatchTexCoordsSlot = mTexCoordsSlot;
+    }
+
     if (fontRenderer.renderText(paint, clip, text, 0, bytesCount, count, x, y,
             hasActiveLayer ? &bounds : NULL)) {
 #if RENDER_LAYERS_AS_REGIONS
@@ -2186,8 +2374,10 @@ void OpenGLRenderer::drawText(const char* text, int bytesCount, int count,
 #endif
     }
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-    glDisableVertexAttribArray(mCaches.currentProgram->getAttrib("texCoords"));
+    // The transform and the shader are set up per text
+    if (!pureTranslate || mShader) {
+        flushTextBatch();
+    }
 
     drawTextDecorations(text, bytesCount, length, oldX, oldY, paint);
 }
@@ -2195,7 +2385,9 @@ void OpenGLRenderer::drawText(const char* text, int bytesCount, int count,
 void OpenGLRenderer::drawPath(SkPath* path, SkPaint* paint) {
     if (mSnapshot->isIgnored()) return;
 
-    glActiveTexture(gTextureUnits[0]);
+    if (drawTessellatedPath(*path, paint)) return;
+
+    mCaches.activeTexture(0);
 
     const PathTexture* texture = mCaches.pathCache.get(path, paint);
     if (!texture) return;
@@ -2212,7 +2404,7 @@ void OpenGLRenderer::drawLayer(Layer* layer, float x, float y, SkPaint* paint) {
         return;
     }
 
-    glActiveTexture(gTextureUnits[0]);
+    mCaches.activeTexture(0);
 
     int alpha;
     SkXfermode::Mode mode;
@@ -2251,6 +2443,7 @@ void OpenGLRenderer::drawLayer(Layer* layer, float x, float y, SkPaint* paint) {
             }
             setupDrawMesh(&layer->mesh[0].position[0], &layer->mesh[0].texture[0]);
 
+            mCaches.unbindIndicesBuffer();
             glDrawElements(GL_TRIANGLES, layer->meshElementCount,
                     GL_UNSIGNED_SHORT, layer->meshIndices);
 
@@ -2447,12 +2640,14 @@ void OpenGLRenderer::drawTextureRect(float left, float top, float right, float b
         texture->setFilter(GL_NEAREST, GL_NEAREST, true);
         drawTextureMesh(x, y, x + texture->width, y + texture->height, texture->id,
                 alpha / 255.0f, mode, texture->blend, (GLvoid*) NULL,
-                (GLvoid*) gMeshTextureOffset, GL_TRIANGLE_STRIP, gMeshCount, false, true);
+                (GLvoid*) gMeshTextureOffset, GL_TRIANGLE_STRIP, gMeshCount, false, true,
+                0, false, true, texture->getTexTransform());
     } else {
         texture->setFilter(GL_LINEAR, GL_LINEAR, true);
         drawTextureMesh(left, top, right, bottom, texture->id, alpha / 255.0f, mode,
                 texture->blend, (GLvoid*) NULL, (GLvoid*) gMeshTextureOffset,
-                GL_TRIANGLE_STRIP, gMeshCount);
+                GL_TRIANGLE_STRIP, gMeshCount, false, false, 0, false, true,
+                texture->getTexTransform());
     }
 }
 
@@ -2465,10 +2660,14 @@ void OpenGLRenderer::drawTextureRect(float left, float top, float right, float b
 void OpenGLRenderer::drawTextureMesh(float left, float top, float right, float bottom,
         GLuint texture, float alpha, SkXfermode::Mode mode, bool blend,
         GLvoid* vertices, GLvoid* texCoords, GLenum drawMode, GLsizei elementsCount,
-        bool swapSrcDst, bool ignoreTransform, GLuint vbo, bool ignoreScale, bool dirty) {
+        bool swapSrcDst, bool ignoreTransform, GLuint vbo, bool ignoreScale, bool dirty,
+        const mat4* texTransform) {
 
     setupDraw();
     setupDrawWithTexture();
+    if (texTransform) {
+        setupDrawTextureTransform();
+    }
     setupDrawColor(alpha, alpha, alpha, alpha);
     setupDrawColorFilter();
     setupDrawBlending(blend, mode, swapSrcDst);
@@ -2484,6 +2683,9 @@ void OpenGLRenderer::drawTextureMesh(float left, float top, float right, float b
     setupDrawPureColorUniforms();
     setupDrawColorFilterUniforms();
     setupDrawTexture(texture);
+    if (texTransform) {
+        setupDrawTextureTransformUniforms(*texTransform);
+    }
     setupDrawMesh(vertices, texCoords, vbo);
 
     glDrawArrays(drawMode, 0, elementsCount);
@@ -304,6 +304,19 @@ private:
      */
     void drawShape(float left, float top, const PathTexture* texture, SkPaint* paint);
 
+    /**
+     * Draws the specified path with triangles, without going through a path
+     * texture. Only convex fills and simple strokes can be drawn this way,
+     * see PathTessellator.
+     *
+     * @param path The path to render
+     * @param paint The paint to draw the path with
+     *
+     * @return False if the path cannot be tessellated and must be drawn
+     *         with a path texture instead
+     */
+    bool drawTessellatedPath(const SkPath& path, SkPaint* paint);
+
     /**
      * Renders the rect defined by the specified bounds as a shape.
      * This will render the rect using a path texture, which is used to render
@@ -397,7 +410,7 @@ private:
             float alpha, SkXfermode::Mode mode, bool blend,
             GLvoid* vertices, GLvoid* texCoords, GLenum drawMode, GLsizei elementsCount,
             bool swapSrcDst = false, bool ignoreTransform = false, GLuint vbo = 0,
-            bool ignoreScale = false, bool dirty = true);
+            bool ignoreScale = false, bool dirty = true, const mat4* texTransform = NULL);
 
     /**
      * Draws text underline and strike-through if needed.
@@ -526,7 +539,7 @@ private:
     void setupDrawTexture(GLuint texture);
     void setupDrawExternalTexture(GLuint texture);
     void setupDrawTextureTransform();
-    void setupDrawTextureTransformUniforms(mat4& transform);
+    void setupDrawTextureTransformUniforms(const mat4& transform);
     void setupDrawMesh(GLvoid* vertices, GLvoid* texCoords = NULL, GLuint vbo = 0);
     void setupDrawVertices(GLvoid* vertices);
     void setupDrawAALine(GLvoid* vertices, GLvoid* distanceCoords, GLvoid* lengthCoords,
@@ -534,6 +547,12 @@ private:
     void finishDrawTexture();
     void accountForClear(SkXfermode::Mode mode);
 
+    /**
+     * Draws the text left pending by drawText(), if any. This must be invoked
+     * before anything changes the GL state the pending text was set up with.
+     */
+    void flushTextBatch();
+
     void drawRegionRects(const Region& region);
 
     /**
@@ -568,6 +587,18 @@ private:
     // Used to draw textured quads
     TextureVertex mMeshVertices[4];
 
+    // Text drawn with a pure translation is not drawn right away, so that the
+    // next drawText() can add its glyphs to the same draw call when it uses the
+    // same font renderer, paint color, xfermode, filtering and clip
+    FontRenderer* mTextBatchRenderer;
+    int mTextBatchColor;
+    int mTextBatchAlpha;
+    SkXfermode::Mode mTextBatchMode;
+    SkiaColorFilter* mTextBatchColorFilter;
+    bool mTextBatchLinearFilter;
+    Rect mTextBatchClip;
+    int mTextBatchTexCoordsSlot;
+
     // Drop shadow
     bool mHasShadow;
     float mShadowRadius;
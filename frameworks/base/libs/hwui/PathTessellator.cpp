@@ -0,0 +1,432 @@
+/*
+ * Copyright (C) 2011 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "OpenGLRenderer"
+
+#include <math.h>
+
+#include <utils/Log.h>
+
+#include "PathTessellator.h"
+#include "Vector.h"
+
+namespace android {
+namespace uirenderer {
+
+///////////////////////////////////////////////////////////////////////////////
+// Defines
+///////////////////////////////////////////////////////////////////////////////
+
+// Maximum distance in pixels between a curve and the segments approximating it
+#define CURVE_TOLERANCE 0.25f
+#define MAX_CURVE_SEGMENTS 64
+
+// Corners whose miter is shorter than this, relatively to the stroke width,
+// look the same with any join
+#define MAX_IMPLICIT_JOIN_MITER 1.02f
+
+// Limits how far the fringe of a sharp corner of a fill extends
+#define MIN_FRINGE_MITER_DENOMINATOR 0.125f
+
+#define TWO_PI 6.2831853f
+
+///////////////////////////////////////////////////////////////////////////////
+// Contours
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Adds a point to a contour, dropping it if it is the same as the previous.
+ * Corners are the points where the segments of the path meet, as opposed to
+ * the points inside curves.
+ */
+static void addPoint(Vector<vec2>& points, Vector<bool>& corners, float x, float y,
+        bool corner, float epsilon) {
+    if (!points.isEmpty()) {
+        const vec2& last = points.top();
+        if (fabs(last.x - x) <= epsilon && fabs(last.y - y) <= epsilon) {
+            if (corner) corners.editTop() = true;
+            return;
+        }
+    }
+    points.add(vec2(x, y));
+    corners.add(corner);
+}
+
+static int computeSegments(float deviation, float tolerance) {
+    int segments = (int) ceilf(sqrtf(deviation / tolerance));
+    if (segments < 1) return 1;
+    if (segments > MAX_CURVE_SEGMENTS) return MAX_CURVE_SEGMENTS;
+    return segments;
+}
+
+/**
+ * Approximates the only contour of the specified path with segments. Returns
+ * false if the path is empty or has several contours.
+ */
+static bool approximateContour(const SkPath& path, float tolerance, bool forceClose,
+        Vector<vec2>& points, Vector<bool>& corners, bool* closed) {
+    const float epsilon = tolerance * 0.05f;
+
+    SkPath::Iter iter(path, false);
+    SkPoint pts[4];
+    SkPath::Verb verb;
+    bool hasContour = false;
+    *closed = false;
+
+    while ((verb = iter.next(pts)) != SkPath::kDone_Verb) {
+        switch (verb) {
+            case SkPath::kMove_Verb:
+                if (hasContour) return false;
+                hasContour = true;
+                addPoint(points, corners, pts[0].fX, pts[0].fY, true, epsilon);
+                break;
+            case SkPath::kLine_Verb:
+                addPoint(points, corners, pts[1].fX, pts[1].fY, true, epsilon);
+                break;
+            case SkPath::kQuad_Verb: {
+                // The distance between the curve and its chords is bounded
+                // by |p0 - 2p1 + p2| / (4 * segments^2)
+                const float dx = pts[0].fX - 2 * pts[1].fX + pts[2].fX;
+                const float dy = pts[0].fY - 2 * pts[1].fY + pts[2].fY;
+                const int segments = computeSegments(sqrtf(dx * dx + dy * dy) * 0.25f,
+                        tolerance);
+                for (int i = 1; i <= segments; i++) {
+                    const float t = float(i) / segments;
+                    const float u = 1.0f - t;
+                    const float a = u * u, b = 2 * u * t, c = t * t;
+                    addPoint(points, corners,
+                            a * pts[0].fX + b * pts[1].fX + c * pts[2].fX,
+                            a * pts[0].fY + b * pts[1].fY + c * pts[2].fY,
+                            i == segments, epsilon);
+                }
+                break;
+            }
+            case SkPath::kCubic_Verb: {
+                // Same bound, using the largest second difference of the
+                // control points
+                const float dx0 = pts[0].fX - 2 * pts[1].fX + pts[2].fX;
+                const float dy0 = pts[0].fY - 2 * pts[1].fY + pts[2].fY;
+                const float dx1 = pts[1].fX - 2 * pts[2].fX + pts[3].fX;
+                const float dy1 = pts[1].fY - 2 * pts[2].fY + pts[3].fY;
+                const float d = sqrtf(fmax(dx0 * dx0 + dy0 * dy0, dx1 * dx1 + dy1 * dy1));
+                const int segments = computeSegments(d * 0.75f, tolerance);
+                for (int i = 1; i <= segments; i++) {
+                    const float t = float(i) / segments;
+                    const float u = 1.0f - t;
+                    const float a = u * u * u, b = 3 * u * u * t, c = 3 * u * t * t, e = t * t * t;
+                    addPoint(points, corners,
+                            a * pts[0].fX + b * pts[1].fX + c * pts[2].fX + e * pts[3].fX,
+                            a * pts[0].fY + b * pts[1].fY + c * pts[2].fY + e * pts[3].fY,
+                            i == segments, epsilon);
+                }
+                break;
+            }
+            case SkPath::kClose_Verb:
+                *closed = true;
+                break;
+            default:
+                break;
+        }
+    }
+
+    if (forceClose) {
+        *closed = true;
+    }
+
+    // The closing segment is implicit
+    if (*closed && points.size() > 1) {
+        const vec2& first = points.itemAt(0);
+        const vec2& last = points.top();
+        if (fabs(last.x - first.x) <= epsilon && fabs(last.y - first.y) <= epsilon) {
+            points.pop();
+            corners.pop();
+        }
+    }
+
+    return hasContour;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Fills
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Adds the inside of a convex polygon to a triangle strip, by zigzagging
+ * between both sides of the polygon.
+ */
+static void addConvexPolygon(const Vector<vec2>& points, Vector<AAVertex>& vertices) {
+    const size_t count = points.size();
+    AAVertex vertex;
+
+    size_t first = 0;
+    size_t last = count - 1;
+    AAVertex::set(&vertex, points[first].x, points[first].y, 0.5f, 0.5f);
+    vertices.add(vertex);
+    first++;
+
+    while (first <= last) {
+        AAVertex::set(&vertex, points[first].x, points[first].y, 0.5f, 0.5f);
+        vertices.add(vertex);
+        first++;
+        if (first > last) break;
+        AAVertex::set(&vertex, points[last].x, points[last].y, 0.5f, 0.5f);
+        vertices.add(vertex);
+        last--;
+    }
+}
+
+static bool tessellateFill(const Vector<vec2>& points, float fringe,
+        Vector<AAVertex>& vertices) {
+    const size_t count = points.size();
+    if (count < 3) return false;
+
+    // The polygon is convex if it always turns the same way, and only
+    // turns once around
+    float area = 0.0f;
+    float turning = 0.0f;
+    int direction = 0;
+    for (size_t i = 0; i < count; i++) {
+        const vec2& a = points[i];
+        const vec2& b = points[(i + 1) % count];
+        const vec2& c = points[(i + 2) % count];
+
+        area += a.x * b.y - b.x * a.y;
+
+        const vec2 ab = b - a;
+        const vec2 bc = c - b;
+        const float cross = ab.x * bc.y - ab.y * bc.x;
+        turning += atan2f(cross, ab.dot(bc));
+
+        if (fabs(cross) > 1e-4f * ab.length() * bc.length()) {
+            const int turn = cross > 0.0f ? 1 : -1;
+            if (direction != 0 && turn != direction) return false;
+            direction = turn;
+        }
+    }
+    if (fabs(fabs(turning) - TWO_PI) > 0.01f) return false;
+
+    if (fringe == 0.0f) {
+        vertices.setCapacity(count);
+        addConvexPolygon(points, vertices);
+        return true;
+    }
+
+    // Moves the vertices by half a pixel, out for the outer edge of the
+    // fringe and in for the inner edge
+    const float orientation = area > 0.0f ? 1.0f : -1.0f;
+    Vector<vec2> normals;
+    normals.setCapacity(count);
+    for (size_t i = 0; i < count; i++) {
+        const vec2 d = points[(i + 1) % count] - points[i];
+        normals.add(vec2(d.y, -d.x).copyNormalized() * orientation);
+    }
+
+    Vector<vec2> inner;
+    inner.setCapacity(count);
+    vertices.setCapacity(2 * count + 2 + count);
+
+    AAVertex vertex;
+    for (size_t i = 0; i <= count; i++) {
+        const size_t index = i % count;
+        const vec2& p = points[index];
+        const vec2& n0 = normals[(index + count - 1) % count];
+        const vec2& n1 = normals[index];
+
+        const float denominator = fmax(1.0f + n0.dot(n1), MIN_FRINGE_MITER_DENOMINATOR);
+        const vec2 offset = (n0 + n1) * (fringe / denominator);
+
+        AAVertex::set(&vertex, p.x + offset.x, p.y + offset.y, 0.0f, 0.5f);
+        vertices.add(vertex);
+        AAVertex::set(&vertex, p.x - offset.x, p.y - offset.y, 0.5f, 0.5f);
+        vertices.add(vertex);
+
+        if (i < count) inner.add(p - offset);
+    }
+
+    // The strip continues from the first inner vertex, the degenerate
+    // triangles in between are not drawn
+    addConvexPolygon(inner, vertices);
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Strokes
+///////////////////////////////////////////////////////////////////////////////
+
+static void addStrokePair(Vector<AAVertex>& vertices, const vec2& p, const vec2& offset,
+        float length) {
+    AAVertex vertex;
+    AAVertex::set(&vertex, p.x + offset.x, p.y + offset.y, 0.0f, length);
+    vertices.add(vertex);
+    AAVertex::set(&vertex, p.x - offset.x, p.y - offset.y, 1.0f, length);
+    vertices.add(vertex);
+}
+
+static bool tessellateStroke(const Vector<vec2>& points, const Vector<bool>& corners,
+        bool closed, const SkPaint* paint, float halfWidth, float fringe,
+        Vector<AAVertex>& vertices) {
+    const size_t count = points.size();
+    if (count < 2 || (closed && count < 3)) return false;
+    if (!closed && paint->getStrokeCap() == SkPaint::kRound_Cap) return false;
+
+    const bool isMiter = paint->getStrokeJoin() == SkPaint::kMiter_Join;
+    const float miterLimit = paint->getStrokeMiter();
+
+    const size_t segments = closed ? count : count - 1;
+    Vector<vec2> normals;
+    Vector<float> lengths;
+    normals.setCapacity(segments);
+    lengths.setCapacity(segments);
+    for (size_t i = 0; i < segments; i++) {
+        const vec2 d = points[(i + 1) % count] - points[i];
+        const float length = d.length();
+        normals.add(vec2(-d.y / length, d.x / length));
+        lengths.add(length);
+    }
+
+    Vector<vec2> offsets;
+    offsets.setCapacity(count);
+    for (size_t i = 0; i < count; i++) {
+        if (!closed && (i == 0 || i == count - 1)) {
+            offsets.add(normals[i == 0 ? 0 : segments - 1] * halfWidth);
+            continue;
+        }
+
+        const size_t previous = (i + segments - 1) % segments;
+        const vec2& n0 = normals[previous];
+        const vec2& n1 = normals[i];
+        const float cosine = n0.dot(n1);
+        const float denominator = 1.0f + cosine;
+        // The contour turns back on itself
+        if (denominator < 0.01f) return false;
+
+        // Sharp corners need the join of the paint, which the strip can only
+        // draw as a miter
+        const float miter = sqrtf(2.0f / denominator);
+        if (corners[i] && miter > MAX_IMPLICIT_JOIN_MITER && (!isMiter || miter > miterLimit)) {
+            return false;
+        }
+
+        // The inner side of the stroke folds over itself when the corner is
+        // wider than the segments around it
+        const float tangent = sqrtf((1.0f - cosine) / denominator);
+        if (halfWidth * tangent > fmin(lengths[previous], lengths[i])) return false;
+
+        offsets.add((n0 + n1) * (halfWidth / denominator));
+    }
+
+    if (closed) {
+        vertices.setCapacity(2 * count + 2);
+        for (size_t i = 0; i <= count; i++) {
+            const size_t index = i % count;
+            addStrokePair(vertices, points[index], offsets[index], 0.5f);
+        }
+        return true;
+    }
+
+    // Moves the ends of square caps by half the stroke width
+    const vec2 startTangent = (points[1] - points[0]) / lengths[0];
+    const vec2 endTangent = (points[count - 1] - points[count - 2]) / lengths[segments - 1];
+    const float extension = paint->getStrokeCap() == SkPaint::kSquare_Cap ?
+            halfWidth - fringe : 0.0f;
+    const vec2 start = points[0] - startTangent * extension;
+    const vec2 end = points[count - 1] + endTangent * extension;
+
+    if (fringe == 0.0f) {
+        vertices.setCapacity(2 * count);
+        addStrokePair(vertices, start, offsets[0], 0.5f);
+        for (size_t i = 1; i < count - 1; i++) {
+            addStrokePair(vertices, points[i], offsets[i], 0.5f);
+        }
+        addStrokePair(vertices, end, offsets[count - 1], 0.5f);
+        return true;
+    }
+
+    // The ends fade out over a pixel centered on the ends of the stroke
+    if (lengths[0] + extension <= 2 * fringe ||
+            lengths[segments - 1] + extension <= 2 * fringe) {
+        return false;
+    }
+
+    vertices.setCapacity(2 * count + 4);
+    addStrokePair(vertices, start - startTangent * fringe, offsets[0], 0.0f);
+    addStrokePair(vertices, start + startTangent * fringe, offsets[0], PATH_BOUNDARY_LENGTH);
+    for (size_t i = 1; i < count - 1; i++) {
+        addStrokePair(vertices, points[i], offsets[i], 0.5f);
+    }
+    addStrokePair(vertices, end - endTangent * fringe, offsets[count - 1],
+            1.0f - PATH_BOUNDARY_LENGTH);
+    addStrokePair(vertices, end + endTangent * fringe, offsets[count - 1], 1.0f);
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Tessellation
+///////////////////////////////////////////////////////////////////////////////
+
+bool PathTessellator::canTessellate(const SkPaint* paint) {
+    return paint->canComputeFastBounds() &&
+            paint->getStyle() != SkPaint::kStrokeAndFill_Style;
+}
+
+bool PathTessellator::tessellate(const SkPath& path, const SkPaint* paint, float scale,
+        Vector<AAVertex>& vertices, float* boundaryWidth) {
+    vertices.clear();
+
+    if (!canTessellate(paint) || path.isInverseFillType() || scale <= 0.0f) {
+        return false;
+    }
+
+    const bool isFill = paint->getStyle() == SkPaint::kFill_Style;
+    const float inverseScale = 1.0f / scale;
+
+    Vector<vec2> points;
+    Vector<bool> corners;
+    bool closed;
+    if (!approximateContour(path, CURVE_TOLERANCE * inverseScale, isFill,
+            points, corners, &closed)) {
+        return false;
+    }
+
+    // Half a pixel on each side of the edges
+    const float fringe = paint->isAntiAlias() ? 0.5f * inverseScale : 0.0f;
+
+    bool result;
+    if (isFill) {
+        *boundaryWidth = 0.5f;
+        result = tessellateFill(points, fringe, vertices);
+    } else {
+        // Hairlines, and strokes thinner than a pixel, are drawn 1 pixel wide
+        float halfWidth = paint->getStrokeWidth() * 0.5f;
+        if (halfWidth < 0.5f * inverseScale) {
+            halfWidth = 0.5f * inverseScale;
+        }
+        halfWidth += fringe;
+
+        *boundaryWidth = fringe / halfWidth;
+        result = tessellateStroke(points, corners, closed, paint, halfWidth, fringe, vertices);
+    }
+
+    if (!result) {
+        vertices.clear();
+    }
+    return result;
+}
+
+}; // namespace uirenderer
+}; // namespace android
@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2011 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_HWUI_PATH_TESSELLATOR_H
+#define ANDROID_HWUI_PATH_TESSELLATOR_H
+
+#include <SkPaint.h>
+#include <SkPath.h>
+
+#include <utils/Vector.h>
+
+#include "Vertex.h"
+
+namespace android {
+namespace uirenderer {
+
+///////////////////////////////////////////////////////////////////////////////
+// Defines
+///////////////////////////////////////////////////////////////////////////////
+
+// Proportion of the length coordinate covered by the anti-aliased ends of
+// open strokes
+#define PATH_BOUNDARY_LENGTH 0.25f
+
+///////////////////////////////////////////////////////////////////////////////
+// Classes
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Converts paths into triangle strips that can be drawn directly, instead of
+ * rasterizing them into a texture. Only the geometry that is simple to
+ * tessellate is handled:
+ *  - fills of a single convex contour
+ *  - strokes of a single contour with butt or square caps and joins that
+ *    the stroke can approximate, as in the curves of arcs, ovals, etc.
+ *
+ * The vertices are AAVertex and can be drawn with the anti-aliased line
+ * shader. Their width coordinate is 0 on the outer edge of the 1 pixel wide
+ * anti-aliasing fringe and reaches 0.5 in the middle of the shape, or 1 on
+ * the other side of strokes; their length coordinate goes from 0 to 1 along
+ * open strokes and is 0.5 everywhere else.
+ * The anti-aliased ends of open strokes cover PATH_BOUNDARY_LENGTH of the
+ * length coordinate at each end.
+ */
+class PathTessellator {
+public:
+    /**
+     * Returns true if the specified paint only relies on the geometry of a
+     * path, as opposed to path effects, mask filters, etc.
+     */
+    static bool canTessellate(const SkPaint* paint);
+
+    /**
+     * Tessellates the specified path into a triangle strip. The vertices are
+     * in the coordinates of the path.
+     *
+     * @param scale The largest scale factor of the transform the path is drawn
+     *        with; curves are approximated and the fringe sized in pixels
+     * @param vertices Receives the triangle strip
+     * @param boundaryWidth Receives the proportion of the width coordinate
+     *        covered by the fringe, to set up the anti-aliased line shader
+     *
+     * @return False if the path cannot be tessellated, for instance because
+     *         it is concave; nothing must be drawn in that case
+     */
+    static bool tessellate(const SkPath& path, const SkPaint* paint, float scale,
+            Vector<AAVertex>& vertices, float* boundaryWidth);
+
+}; // class PathTessellator
+
+}; // namespace uirenderer
+}; // namespace android
+
+#endif // ANDROID_HWUI_PATH_TESSELLATOR_H
@@ -16,6 +16,8 @@
 
 #define LOG_TAG "OpenGLRenderer"
 
+#include <string.h>
+
 #include "Program.h"
 
 namespace android {
@@ -27,6 +29,10 @@ namespace uirenderer {
 
 Program::Program(const char* vertex, const char* fragment) {
     mInitialized = false;
+    mHasTransform = false;
+    mHasColor = false;
+    mUniformsIssued = 0;
+    mUniformsElided = 0;
 
     vertexShader = buildShader(vertex, GL_VERTEX_SHADER);
     if (vertexShader) {
@@ -136,11 +142,34 @@ void Program::set(const mat4& projectionMatrix, const mat4& modelViewMatrix,
     t.multiply(transformMatrix);
     t.multiply(modelViewMatrix);
 
+    // Uniforms belong to the program, they keep their value when other
+    // programs are used
+    if (mHasTransform && !memcmp(&t.data[0], &mTransform.data[0], sizeof(t.data))) {
+        mUniformsElided++;
+        return;
+    }
+
     glUniformMatrix4fv(transform, 1, GL_FALSE, &t.data[0]);
+    mTransform.load(t);
+    mHasTransform = true;
+    mUniformsIssued++;
 }
 
 void Program::setColor(const float r, const float g, const float b, const float a) {
-    glUniform4f(getUniform("color"), r, g, b, a);
+    if (!mHasColor) {
+        mColorSlot = getUniform("color");
+    } else if (mColor[0] == r && mColor[1] == g && mColor[2] == b && mColor[3] == a) {
+        mUniformsElided++;
+        return;
+    }
+
+    glUniform4f(mColorSlot, r, g, b, a);
+    mColor[0] = r;
+    mColor[1] = g;
+    mColor[2] = b;
+    mColor[3] = a;
+    mHasColor = true;
+    mUniformsIssued++;
 }
 
 void Program::use() {
@@ -78,16 +78,29 @@ public:
 
     /**
      * Binds the program with the specified projection, modelView and
-     * transform matrices.
+     * transform matrices. The uniform is only set if the resulting
+     * matrix changed.
      */
     void set(const mat4& projectionMatrix, const mat4& modelViewMatrix,
              const mat4& transformMatrix, bool offset = false);
 
     /**
-     * Sets the color associated with this shader.
+     * Sets the color associated with this shader, if it changed.
      */
     void setColor(const float r, const float g, const float b, const float a);
 
+    /**
+     * Returns the number of uniforms set with set() and setColor() and
+     * the number skipped because they were unchanged.
+     */
+    inline uint32_t getUniformsIssued() const {
+        return mUniformsIssued;
+    }
+
+    inline uint32_t getUniformsElided() const {
+        return mUniformsElided;
+    }
+
     /**
      * Name of the position attribute.
      */
@@ -134,6 +147,16 @@ private:
 
     bool mUse;
     bool mInitialized;
+
+    // Last values of the transform and color uniforms
+    mat4 mTransform;
+    bool mHasTransform;
+    int mColorSlot;
+    float mColor[4];
+    bool mHasColor;
+
+    uint32_t mUniformsIssued;
+    uint32_t mUniformsElided;
 }; // class Program
 
 }; // namespace uirenderer
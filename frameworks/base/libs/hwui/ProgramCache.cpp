@@ -291,6 +291,23 @@ const char* gFS_Main_ApplyColorOp[4] = {
 const char* gFS_Footer =
         "}\n\n";
 
+///////////////////////////////////////////////////////////////////////////////
+// Blur snippets
+///////////////////////////////////////////////////////////////////////////////
+
+const char* gFS_Header_Blur =
+        "varying vec2 outTexCoords;\n"
+        "uniform sampler2D sampler;\n"
+        "uniform vec2 offset;\n";
+const char* gFS_Main_Blur =
+        "\nvoid main(void) {\n"
+        "    float blur = %f * texture2D(sampler, outTexCoords).a;\n";
+const char* gFS_Main_Blur_Tap =
+        "    blur += %f * (texture2D(sampler, outTexCoords + offset * %d.0).a +\n"
+        "            texture2D(sampler, outTexCoords - offset * %d.0).a);\n";
+const char* gFS_Main_FragColor_Blur =
+        "    gl_FragColor = vec4(blur);\n";
+
 ///////////////////////////////////////////////////////////////////////////////
 // PorterDuff snippets
 ///////////////////////////////////////////////////////////////////////////////
@@ -364,6 +381,35 @@ void ProgramCache::clear() {
         delete mCache.valueAt(i);
     }
     mCache.clear();
+
+    count = mBlurCache.size();
+    for (size_t i = 0; i < count; i++) {
+        delete mBlurCache.valueAt(i);
+    }
+    mBlurCache.clear();
+}
+
+void ProgramCache::getUniformStats(uint32_t* issued, uint32_t* elided) const {
+    *issued = 0;
+    *elided = 0;
+    for (size_t i = 0; i < mCache.size(); i++) {
+        const Program* program = mCache.valueAt(i);
+        *issued += program->getUniformsIssued();
+        *elided += program->getUniformsElided();
+    }
+}
+
+Program* ProgramCache::getBlur(uint32_t radius) {
+    ssize_t index = mBlurCache.indexOfKey(radius);
+    Program* program = NULL;
+    if (index < 0) {
+        PROGRAM_LOGD("Could not find blur program of radius %d", radius);
+        program = generateBlurProgram(radius);
+        mBlurCache.add(radius, program);
+    } else {
+        program = mBlurCache.valueAt(index);
+    }
+    return program;
 }
 
 Program* ProgramCache::get(const ProgramDescription& description) {
@@ -392,6 +438,37 @@ Program* ProgramCache::generateProgram(const ProgramDescription& description, pr
     return program;
 }
 
+Program* ProgramCache::generateBlurProgram(uint32_t radius) {
+    String8 vertexShader(gVS_Header_Attributes);
+    vertexShader.append(gVS_Header_Attributes_TexCoords);
+    vertexShader.append(gVS_Header_Uniforms);
+    vertexShader.append(gVS_Header_Varyings_HasTexture);
+    vertexShader.append(gVS_Main);
+    vertexShader.append(gVS_Main_OutTexCoords);
+    vertexShader.append(gVS_Main_Position);
+    vertexShader.append(gVS_Footer);
+
+    // The weights are symmetric, each tap past the center samples both sides
+    float weights[2 * radius + 1];
+    FontRenderer::computeGaussianWeights(weights, radius);
+
+    String8 fragmentShader(gFS_Header);
+    fragmentShader.append(gFS_Header_Blur);
+    fragmentShader.appendFormat(gFS_Main_Blur, weights[radius]);
+    for (uint32_t r = 1; r <= radius; r++) {
+        fragmentShader.appendFormat(gFS_Main_Blur_Tap, weights[radius + r], r, r);
+    }
+    fragmentShader.append(gFS_Main_FragColor_Blur);
+    fragmentShader.append(gFS_Footer);
+
+#if DEBUG_PROGRAMS
+    PROGRAM_LOGD("*** Generated blur fragment shader:\n\n");
+    printLongString(fragmentShader);
+#endif
+
+    return new Program(vertexShader.string(), fragmentShader.string());
+}
+
 String8 ProgramCache::generateVertexShader(const ProgramDescription& description) {
     // Add attributes
     String8 shader(gVS_Header_Attributes);
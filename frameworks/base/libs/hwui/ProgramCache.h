@@ -289,9 +289,23 @@ public:
 
     Program* get(const ProgramDescription& description);
 
+    /**
+     * Returns the program of one pass of a separable Gaussian blur of the
+     * specified radius. The program reads the alpha channel of the texture
+     * bound to the "sampler" uniform, at the texel steps set in the "offset"
+     * uniform, and writes the blurred value to all the channels.
+     */
+    Program* getBlur(uint32_t radius);
+
     void clear();
 
+    /**
+     * Returns the number of uniforms set and skipped by the cached programs.
+     */
+    void getUniformStats(uint32_t* issued, uint32_t* elided) const;
+
 private:
+    Program* generateBlurProgram(uint32_t radius);
     Program* generateProgram(const ProgramDescription& description, programid key);
     String8 generateVertexShader(const ProgramDescription& description);
     String8 generateFragmentShader(const ProgramDescription& description);
@@ -301,6 +315,7 @@ private:
     void printLongString(const String8& shader) const;
 
     KeyedVector<programid, Program*> mCache;
+    KeyedVector<uint32_t, Program*> mBlurCache;
 }; // class ProgramCache
 
 }; // namespace uirenderer
@@ -42,6 +42,12 @@
  */
 #define PROPERTY_DEBUG "hwui.debug_level"
 
+/**
+ * Used to enable/disable the frame profiler, "true" to enable.
+ * Read when the process starts, the profile is output by dumpsys gfxinfo.
+ */
+#define PROPERTY_PROFILE "hwui.profile"
+
 /**
  * Debug levels. Debug levels are used as flags.
  */
@@ -65,6 +71,15 @@ enum DebugLevel {
 #define PROPERTY_TEXT_CACHE_WIDTH "ro.hwui.text_cache_width"
 #define PROPERTY_TEXT_CACHE_HEIGHT "ro.hwui.text_cache_height"
 
+// Size of the texture atlas used for small bitmaps, 0 to disable it
+#define PROPERTY_TEXTURE_ATLAS_SIZE "ro.hwui.texture_atlas_size"
+
+// Set to "true" to upload large bitmaps on a background thread
+#define PROPERTY_TEXTURE_UPLOAD_THREAD "ro.hwui.texture_upload_thread"
+
+// Set to "true" to blur text drop shadows with the GPU
+#define PROPERTY_TEXT_SHADOW_GPU_BLUR "ro.hwui.text_shadow_gpu_blur"
+
 // Gamma (>= 1.0, <= 10.0)
 #define PROPERTY_TEXT_GAMMA "ro.text_gamma"
 #define PROPERTY_TEXT_BLACK_GAMMA_THRESHOLD "ro.text_gamma.black_threshold"
@@ -82,6 +97,16 @@ enum DebugLevel {
 #define DEFAULT_DROP_SHADOW_CACHE_SIZE 2.0f
 #define DEFAULT_FBO_CACHE_SIZE 16
 
+#define DEFAULT_TEXTURE_ATLAS_SIZE 1024
+// Bitmaps larger than this in either dimension are not packed in the atlas
+#define TEXTURE_ATLAS_MAX_BITMAP_SIZE 128
+
+// Bitmaps smaller than this many bytes are always uploaded by the renderer
+#define TEXTURE_UPLOAD_MIN_BITMAP_SIZE (64 * 1024)
+
+// Larger drop shadow radiuses are always blurred on the CPU
+#define TEXT_SHADOW_MAX_GPU_BLUR_RADIUS 16
+
 #define DEFAULT_TEXT_GAMMA 1.4f
 #define DEFAULT_TEXT_BLACK_GAMMA_THRESHOLD 64
 #define DEFAULT_TEXT_WHITE_GAMMA_THRESHOLD 192
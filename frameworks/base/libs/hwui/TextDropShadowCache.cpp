@@ -16,6 +16,7 @@
 
 #define LOG_TAG "OpenGLRenderer"
 
+#include "Caches.h"
 #include "Debug.h"
 #include "TextDropShadowCache.h"
 #include "Properties.h"
@@ -55,6 +56,13 @@ TextDropShadowCache::~TextDropShadowCache() {
 void TextDropShadowCache::init() {
     mCache.setOnEntryRemovedListener(this);
     mDebugEnabled = readDebugLevel() & kDebugMoreCaches;
+
+    char property[PROPERTY_VALUE_MAX];
+    mGpuBlur = property_get(PROPERTY_TEXT_SHADOW_GPU_BLUR, property, "false") > 0 &&
+            !strcmp(property, "true");
+    if (mGpuBlur) {
+        INIT_LOGD("  Blurring text shadows with the GPU");
+    }
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -107,8 +115,9 @@ ShadowTexture* TextDropShadowCache::get(SkPaint* paint, const char* text, uint32
     ShadowTexture* texture = mCache.get(entry);
 
     if (!texture) {
+        const bool gpuBlur = mGpuBlur && radius > 0 && radius <= TEXT_SHADOW_MAX_GPU_BLUR_RADIUS;
         FontRenderer::DropShadow shadow = mRenderer->renderDropShadow(paint, text, 0,
-                len, numGlyphs, radius);
+                len, numGlyphs, radius, !gpuBlur);
 
         texture = new ShadowTexture;
         texture->left = shadow.penX;
@@ -118,28 +127,36 @@ ShadowTexture* TextDropShadowCache::get(SkPaint* paint, const char* text, uint32
         texture->generation = 0;
         texture->blend = true;
 
-        const uint32_t size = shadow.width * shadow.height;
-        texture->bitmapSize = size;
+        uint32_t size = shadow.width * shadow.height;
 
-        // Don't even try to cache a bitmap that's bigger than the cache
-        if (size < mMaxSize) {
-            while (mSize + size > mMaxSize) {
-                mCache.removeOldest();
+        if (gpuBlur && shadow.image && blurTexture(texture, shadow.image, radius)) {
+            size *= 4;
+        } else {
+            if (gpuBlur && shadow.image) {
+                FontRenderer::blurImage(shadow.image, shadow.width, shadow.height, radius);
             }
-        }
 
-        glGenTextures(1, &texture->id);
+            glGenTextures(1, &texture->id);
 
-        glBindTexture(GL_TEXTURE_2D, texture->id);
-        // Textures are Alpha8
-        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+            glBindTexture(GL_TEXTURE_2D, texture->id);
+            // Textures are Alpha8
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
 
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_ALPHA, texture->width, texture->height, 0,
-                GL_ALPHA, GL_UNSIGNED_BYTE, shadow.image);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_ALPHA, texture->width, texture->height, 0,
+                    GL_ALPHA, GL_UNSIGNED_BYTE, shadow.image);
+        }
 
+        texture->bitmapSize = size;
         texture->setFilter(GL_LINEAR, GL_LINEAR);
         texture->setWrap(GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE);
 
+        // Don't even try to cache a bitmap that's bigger than the cache
+        if (size < mMaxSize) {
+            while (mSize + size > mMaxSize) {
+                mCache.removeOldest();
+            }
+        }
+
         if (size < mMaxSize) {
             if (mDebugEnabled) {
                 LOGD("Shadow texture created, size = %d", texture->bitmapSize);
@@ -160,5 +177,126 @@ ShadowTexture* TextDropShadowCache::get(SkPaint* paint, const char* text, uint32
     return texture;
 }
 
+bool TextDropShadowCache::blurTexture(ShadowTexture* texture, const uint8_t* image,
+        uint32_t radius) {
+    Caches& caches = Caches::getInstance();
+
+    const uint32_t width = texture->width;
+    const uint32_t height = texture->height;
+    if (width == 0 || height == 0 || width > (uint32_t) caches.maxTextureSize ||
+            height > (uint32_t) caches.maxTextureSize) {
+        return false;
+    }
+
+    Program* program = caches.programCache.getBlur(radius);
+    if (!program->isInitialized()) {
+        return false;
+    }
+
+    GLuint fbo = caches.fboCache.get();
+    if (!fbo) {
+        return false;
+    }
+
+    // The sharp image, the horizontal pass and the final shadow
+    GLuint textures[3];
+    glGenTextures(3, textures);
+
+    caches.activeTexture(0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (int i = 0; i < 3; i++) {
+        glBindTexture(GL_TEXTURE_2D, textures[i]);
+        if (i == 0) {
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_ALPHA, width, height, 0,
+                    GL_ALPHA, GL_UNSIGNED_BYTE, image);
+        } else {
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0,
+                    GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        }
+        // Each fragment reads exact texels, the edges are repeated like
+        // the CPU blur does
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    }
+
+    // Save the state of the renderer, this happens in the middle of a frame
+    GLint previousFbo;
+    GLint viewport[4];
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFbo);
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    const bool scissor = glIsEnabled(GL_SCISSOR_TEST);
+    const bool blend = glIsEnabled(GL_BLEND);
+
+    glDisable(GL_SCISSOR_TEST);
+    glDisable(GL_BLEND);
+
+    // The renderer picks its program again on its next draw
+    if (caches.currentProgram) {
+        caches.currentProgram->remove();
+        caches.currentProgram = NULL;
+    }
+    program->use();
+
+    // Maps the unit mesh to the whole viewport
+    mat4 transform;
+    transform.loadOrtho(0.0f, 1.0f, 0.0f, 1.0f, -1.0f, 1.0f);
+    glUniformMatrix4fv(program->transform, 1, GL_FALSE, &transform.data[0]);
+    glUniform1i(program->getUniform("sampler"), 0);
+    const int offsetSlot = program->getUniform("offset");
+
+    const int texCoordsSlot = program->getAttrib("texCoords");
+    caches.bindMeshBuffer();
+    caches.bindAttribPointer(program->position, 2, gMeshStride, 0);
+    glEnableVertexAttribArray(texCoordsSlot);
+    caches.bindAttribPointer(texCoordsSlot, 2, gMeshStride, (GLvoid*) gMeshTextureOffset);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glViewport(0, 0, width, height);
+
+    bool complete = true;
+    for (int pass = 0; pass < 2; pass++) {
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+                textures[pass + 1], 0);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            complete = false;
+            break;
+        }
+
+        glBindTexture(GL_TEXTURE_2D, textures[pass]);
+        if (pass == 0) {
+            glUniform2f(offsetSlot, 1.0f / width, 0.0f);
+        } else {
+            glUniform2f(offsetSlot, 0.0f, 1.0f / height);
+        }
+        glDrawArrays(GL_TRIANGLE_STRIP, 0, gMeshCount);
+    }
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, 0, 0);
+
+    // Restore the state of the renderer
+    glDisableVertexAttribArray(texCoordsSlot);
+    program->remove();
+
+    glBindFramebuffer(GL_FRAMEBUFFER, previousFbo);
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    if (scissor) glEnable(GL_SCISSOR_TEST);
+    if (blend) glEnable(GL_BLEND);
+
+    caches.fboCache.put(fbo);
+
+    glDeleteTextures(2, textures);
+    if (!complete) {
+        LOGW("Could not blur text shadow with the GPU");
+        glDeleteTextures(1, &textures[2]);
+        return false;
+    }
+
+    texture->id = textures[2];
+    glBindTexture(GL_TEXTURE_2D, texture->id);
+
+    return true;
+}
+
 }; // namespace uirenderer
 }; // namespace android
@@ -144,12 +144,21 @@ public:
 private:
     void init();
 
+    /**
+     * Generates the texture of the specified shadow by blurring its sharp
+     * image with the GPU, in two passes rendered in an FBO. The texture is
+     * RGBA since alpha textures cannot be rendered into. Returns false if
+     * the shadow must be blurred on the CPU instead.
+     */
+    bool blurTexture(ShadowTexture* texture, const uint8_t* image, uint32_t radius);
+
     GenerationCache<ShadowText, ShadowTexture*> mCache;
 
     uint32_t mSize;
     uint32_t mMaxSize;
     FontRenderer* mRenderer;
     bool mDebugEnabled;
+    bool mGpuBlur;
 }; // class TextDropShadowCache
 
 }; // namespace uirenderer
@@ -19,6 +19,8 @@
 
 #include <GLES2/gl2.h>
 
+#include "Matrix.h"
+
 namespace android {
 namespace uirenderer {
 
@@ -38,11 +40,18 @@ struct Texture {
 
         firstFilter = true;
         firstWrap = true;
+
+        atlas = NULL;
     }
 
     void setWrap(GLenum wrapS, GLenum wrapT, bool bindTexture = false, bool force = false,
             GLenum renderTarget = GL_TEXTURE_2D) {
 
+        if (atlas) {
+            atlas->setWrap(wrapS, wrapT, bindTexture, force, renderTarget);
+            return;
+        }
+
         if (firstWrap || force || wrapS != this->wrapS || wrapT != this->wrapT) {
             firstWrap = true;
 
@@ -61,6 +70,11 @@ struct Texture {
     void setFilter(GLenum min, GLenum mag, bool bindTexture = false, bool force = false,
             GLenum renderTarget = GL_TEXTURE_2D) {
 
+        if (atlas) {
+            atlas->setFilter(min, mag, bindTexture, force, renderTarget);
+            return;
+        }
+
         if (firstFilter || force || min != minFilter || mag != magFilter) {
             firstFilter = false;
 
@@ -117,6 +131,27 @@ struct Texture {
     GLenum minFilter;
     GLenum magFilter;
 
+    /**
+     * If the bitmap was packed into a texture atlas, the texture of the atlas.
+     * Its wrap modes and filters are shared by all the bitmaps it contains.
+     * This texture then only describes the bitmap and its name is that of
+     * the atlas.
+     */
+    Texture* atlas;
+    /**
+     * Maps the texture coordinates of the bitmap, from 0 to 1, to its location
+     * in the atlas. Only valid if atlas is not NULL.
+     */
+    mat4 atlasTransform;
+
+    /**
+     * Returns the transform to apply to the texture coordinates when drawing
+     * this texture, or NULL if none is needed.
+     */
+    const mat4* getTexTransform() const {
+        return atlas ? &atlasTransform : NULL;
+    }
+
 private:
     bool firstFilter;
     bool firstWrap;
@@ -0,0 +1,251 @@
+/*
+ * Copyright (C) 2011 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "OpenGLRenderer"
+
+#include <string.h>
+
+#include <utils/Log.h>
+
+#include "Properties.h"
+#include "TextureAtlas.h"
+
+namespace android {
+namespace uirenderer {
+
+///////////////////////////////////////////////////////////////////////////////
+// Defines
+///////////////////////////////////////////////////////////////////////////////
+
+// Number of edge pixels repeated around each bitmap
+#define ATLAS_BORDER 1
+
+// Shelves heights are rounded up to this many pixels so that bitmaps of
+// similar sizes can share them
+#define ATLAS_SHELF_ALIGNMENT 4
+
+///////////////////////////////////////////////////////////////////////////////
+// Constructors/destructor
+///////////////////////////////////////////////////////////////////////////////
+
+TextureAtlas::TextureAtlas(uint32_t width, uint32_t height):
+        mWidth(width), mHeight(height), mShelvesBottom(0), mFrame(1), mEmptiedFrame(0) {
+    mTexture.id = 0;
+
+    const uint32_t size = TEXTURE_ATLAS_MAX_BITMAP_SIZE + 2 * ATLAS_BORDER;
+    mUploadBuffer = new uint32_t[size * size];
+}
+
+TextureAtlas::~TextureAtlas() {
+    clear();
+    delete[] mUploadBuffer;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Packing
+///////////////////////////////////////////////////////////////////////////////
+
+bool TextureAtlas::canPack(SkBitmap* bitmap) const {
+    const uint32_t width = bitmap->width();
+    const uint32_t height = bitmap->height();
+    return bitmap->getConfig() == SkBitmap::kARGB_8888_Config &&
+            width > 0 && width <= TEXTURE_ATLAS_MAX_BITMAP_SIZE &&
+            height > 0 && height <= TEXTURE_ATLAS_MAX_BITMAP_SIZE &&
+            width + 2 * ATLAS_BORDER <= mWidth && height + 2 * ATLAS_BORDER <= mHeight;
+}
+
+Texture* TextureAtlas::get(SkBitmap* bitmap) {
+    if (!canPack(bitmap)) {
+        return NULL;
+    }
+
+    ssize_t index = mEntries.indexOfKey(bitmap);
+    if (index >= 0) {
+        Entry* entry = mEntries.valueAt(index);
+        if (bitmap->getGenerationID() == entry->generation) {
+            return entry;
+        }
+        if (bitmap->width() == int(entry->width) && bitmap->height() == int(entry->height)) {
+            return upload(bitmap, entry) ? entry : NULL;
+        }
+        remove(bitmap);
+    }
+
+    const uint32_t width = bitmap->width();
+    const uint32_t height = bitmap->height();
+
+    uint32_t x, y;
+    if (!findSpace(width + 2 * ATLAS_BORDER, height + 2 * ATLAS_BORDER, &x, &y)) {
+        // The bitmaps drawn in this frame don't all fit, let the rest
+        // use their own textures rather than emptying the atlas again
+        if (mEmptiedFrame == mFrame) {
+            return NULL;
+        }
+        empty();
+        mEmptiedFrame = mFrame;
+
+        if (!findSpace(width + 2 * ATLAS_BORDER, height + 2 * ATLAS_BORDER, &x, &y)) {
+            return NULL;
+        }
+    }
+
+    if (!mTexture.id) {
+        glGenTextures(1, &mTexture.id);
+        glBindTexture(GL_TEXTURE_2D, mTexture.id);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, mWidth, mHeight, 0,
+                GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+
+        mTexture.width = mWidth;
+        mTexture.height = mHeight;
+        mTexture.setFilter(GL_LINEAR, GL_LINEAR, false, true);
+        mTexture.setWrap(GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE, false, true);
+    }
+
+    Entry* entry = new Entry;
+    entry->id = mTexture.id;
+    entry->atlas = &mTexture;
+    entry->width = width;
+    entry->height = height;
+    entry->bitmapSize = bitmap->rowBytes() * height;
+    entry->x = x;
+    entry->y = y;
+
+    entry->atlasTransform.loadTranslate(float(x + ATLAS_BORDER) / mWidth,
+            float(y + ATLAS_BORDER) / mHeight, 0.0f);
+    entry->atlasTransform.scale(float(width) / mWidth, float(height) / mHeight, 1.0f);
+
+    if (!upload(bitmap, entry)) {
+        delete entry;
+        return NULL;
+    }
+
+    mEntries.add(bitmap, entry);
+    return entry;
+}
+
+bool TextureAtlas::findSpace(uint32_t width, uint32_t height, uint32_t* x, uint32_t* y) {
+    // Pick the lowest shelf that can hold the bitmap without wasting
+    // more than a quarter of its height
+    Shelf* best = NULL;
+    const size_t count = mShelves.size();
+    for (size_t i = 0; i < count; i++) {
+        Shelf& shelf = mShelves.editItemAt(i);
+        if (shelf.height >= height && (shelf.height - height) * 4 <= shelf.height &&
+                mWidth - shelf.used >= width) {
+            if (!best || shelf.height < best->height) {
+                best = &shelf;
+            }
+        }
+    }
+
+    if (!best) {
+        const uint32_t shelfHeight = (height + ATLAS_SHELF_ALIGNMENT - 1) &
+                ~(ATLAS_SHELF_ALIGNMENT - 1);
+        if (mShelvesBottom + shelfHeight > mHeight) {
+            return false;
+        }
+
+        Shelf shelf;
+        shelf.top = mShelvesBottom;
+        shelf.height = shelfHeight;
+        shelf.used = 0;
+        mShelves.add(shelf);
+        mShelvesBottom += shelfHeight;
+
+        best = &mShelves.editTop();
+    }
+
+    *x = best->used;
+    *y = best->top;
+    best->used += width;
+
+    return true;
+}
+
+bool TextureAtlas::upload(SkBitmap* bitmap, Entry* entry) {
+    SkAutoLockPixels alp(*bitmap);
+
+    if (!bitmap->readyToDraw()) {
+        LOGE("Cannot pack bitmap into the texture atlas");
+        return false;
+    }
+
+    const int32_t width = entry->width;
+    const int32_t height = entry->height;
+    const uint32_t stride = bitmap->rowBytesAsPixels();
+    const uint32_t* pixels = (const uint32_t*) bitmap->getPixels();
+
+    // Copy the bitmap surrounded by its edge pixels, so that filtering
+    // never reads from the bitmaps around it
+    const uint32_t uploadWidth = width + 2 * ATLAS_BORDER;
+    uint32_t* dst = mUploadBuffer;
+    for (int32_t y = -ATLAS_BORDER; y < height + ATLAS_BORDER; y++) {
+        const uint32_t* src = pixels + (y < 0 ? 0 : (y < height ? y : height - 1)) * stride;
+        for (int32_t x = 0; x < ATLAS_BORDER; x++) {
+            dst[x] = src[0];
+            dst[ATLAS_BORDER + width + x] = src[width - 1];
+        }
+        memcpy(dst + ATLAS_BORDER, src, width * sizeof(uint32_t));
+        dst += uploadWidth;
+    }
+
+    glBindTexture(GL_TEXTURE_2D, mTexture.id);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, entry->x, entry->y, uploadWidth,
+            height + 2 * ATLAS_BORDER, GL_RGBA, GL_UNSIGNED_BYTE, mUploadBuffer);
+
+    entry->generation = bitmap->getGenerationID();
+    // Do this after calling getPixels() to make sure Skia's deferred
+    // decoding happened
+    entry->blend = !bitmap->isOpaque();
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Removal
+///////////////////////////////////////////////////////////////////////////////
+
+void TextureAtlas::remove(SkBitmap* bitmap) {
+    ssize_t index = mEntries.indexOfKey(bitmap);
+    if (index >= 0) {
+        delete mEntries.valueAt(index);
+        mEntries.removeItemsAt(index);
+    }
+}
+
+void TextureAtlas::empty() {
+    const size_t count = mEntries.size();
+    for (size_t i = 0; i < count; i++) {
+        delete mEntries.valueAt(i);
+    }
+    mEntries.clear();
+
+    mShelves.clear();
+    mShelvesBottom = 0;
+}
+
+void TextureAtlas::clear() {
+    empty();
+
+    if (mTexture.id) {
+        glDeleteTextures(1, &mTexture.id);
+        mTexture.id = 0;
+    }
+}
+
+}; // namespace uirenderer
+}; // namespace android
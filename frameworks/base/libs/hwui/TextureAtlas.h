@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) 2011 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_HWUI_TEXTURE_ATLAS_H
+#define ANDROID_HWUI_TEXTURE_ATLAS_H
+
+#include <GLES2/gl2.h>
+
+#include <SkBitmap.h>
+
+#include <utils/KeyedVector.h>
+#include <utils/Vector.h>
+
+#include "Texture.h"
+
+namespace android {
+namespace uirenderer {
+
+/**
+ * Packs small bitmaps (icons, nine-patches, etc.) into a single texture so
+ * that drawing them does not require binding a different texture each time.
+ *
+ * Bitmaps are packed in shelves, rows as tall as the first bitmap placed in
+ * them. Each bitmap is surrounded by a copy of its edge pixels so that
+ * filtering never samples its neighbours. Space is only reclaimed by emptying
+ * the whole atlas when a bitmap does not fit anymore; the bitmaps still in
+ * use are then packed again, without holes, as they get drawn. To prevent
+ * thrashing when they do not all fit, this happens at most once per frame.
+ */
+class TextureAtlas {
+public:
+    TextureAtlas(uint32_t width, uint32_t height);
+    ~TextureAtlas();
+
+    /**
+     * Returns the texture for the specified bitmap in the atlas, packing
+     * it if needed. Returns NULL if the bitmap cannot be packed, either
+     * because of its size or format or because the atlas is full.
+     */
+    Texture* get(SkBitmap* bitmap);
+    /**
+     * Removes the specified bitmap from the atlas. Its space is reclaimed
+     * the next time the atlas is emptied.
+     */
+    void remove(SkBitmap* bitmap);
+    /**
+     * Removes all the bitmaps and deletes the texture of the atlas.
+     */
+    void clear();
+
+    /**
+     * Must be invoked at the beginning of each frame.
+     */
+    void startFrame() {
+        mFrame++;
+    }
+
+    /**
+     * Returns the size in bytes of the texture of the atlas, 0 if it
+     * was not created.
+     */
+    uint32_t getSize() const {
+        return mTexture.id ? mWidth * mHeight * 4 : 0;
+    }
+    /**
+     * Returns the size in bytes the texture of the atlas can use.
+     */
+    uint32_t getMaxSize() const {
+        return mWidth * mHeight * 4;
+    }
+
+private:
+    struct Entry: public Texture {
+        uint32_t x;
+        uint32_t y;
+    };
+
+    struct Shelf {
+        uint32_t top;
+        uint32_t height;
+        uint32_t used;
+    };
+
+    bool canPack(SkBitmap* bitmap) const;
+    bool findSpace(uint32_t width, uint32_t height, uint32_t* x, uint32_t* y);
+    bool upload(SkBitmap* bitmap, Entry* entry);
+    void empty();
+
+    const uint32_t mWidth;
+    const uint32_t mHeight;
+
+    Texture mTexture;
+    uint32_t* mUploadBuffer;
+
+    KeyedVector<SkBitmap*, Entry*> mEntries;
+    Vector<Shelf> mShelves;
+    uint32_t mShelvesBottom;
+
+    uint32_t mFrame;
+    uint32_t mEmptiedFrame;
+}; // class TextureAtlas
+
+}; // namespace uirenderer
+}; // namespace android
+
+#endif // ANDROID_HWUI_TEXTURE_ATLAS_H
@@ -33,8 +33,8 @@ namespace uirenderer {
 ///////////////////////////////////////////////////////////////////////////////
 
 TextureCache::TextureCache():
-        mCache(GenerationCache<SkBitmap*, Texture*>::kUnlimitedCapacity),
-        mSize(0), mMaxSize(MB(DEFAULT_TEXTURE_CACHE_SIZE)) {
+        mCache(MB(DEFAULT_TEXTURE_CACHE_SIZE),
+                WeightedGenerationCache<SkBitmap*, Texture*>::kSegmented) {
     char property[PROPERTY_VALUE_MAX];
     if (property_get(PROPERTY_TEXTURE_CACHE_SIZE, property, NULL) > 0) {
         INIT_LOGD("  Setting texture cache size to %sMB", property);
@@ -47,13 +47,14 @@ TextureCache::TextureCache():
 }
 
 TextureCache::TextureCache(uint32_t maxByteSize):
-        mCache(GenerationCache<SkBitmap*, Texture*>::kUnlimitedCapacity),
-        mSize(0), mMaxSize(maxByteSize) {
+        mCache(maxByteSize, WeightedGenerationCache<SkBitmap*, Texture*>::kSegmented) {
     init();
 }
 
 TextureCache::~TextureCache() {
+    setUploader(NULL);
     mCache.clear();
+    delete mAtlas;
 }
 
 void TextureCache::init() {
@@ -62,6 +63,19 @@ void TextureCache::init() {
     glGetIntegerv(GL_MAX_TEXTURE_SIZE, &mMaxTextureSize);
     INIT_LOGD("    Maximum texture dimension is %d pixels", mMaxTextureSize);
 
+    int atlasSize = DEFAULT_TEXTURE_ATLAS_SIZE;
+    char property[PROPERTY_VALUE_MAX];
+    if (property_get(PROPERTY_TEXTURE_ATLAS_SIZE, property, NULL) > 0) {
+        INIT_LOGD("  Setting texture atlas size to %s pixels", property);
+        atlasSize = atoi(property);
+    }
+    if (atlasSize > mMaxTextureSize) {
+        atlasSize = mMaxTextureSize;
+    } else if (atlasSize < 0) {
+        atlasSize = 0;
+    }
+    mAtlas = new TextureAtlas(atlasSize, atlasSize);
+
     mDebugEnabled = readDebugLevel() & kDebugCaches;
 }
 
@@ -70,18 +84,34 @@ void TextureCache::init() {
 ///////////////////////////////////////////////////////////////////////////////
 
 uint32_t TextureCache::getSize() {
-    return mSize;
+    return mCache.getWeight();
 }
 
 uint32_t TextureCache::getMaxSize() {
-    return mMaxSize;
+    return mCache.getMaxWeight();
 }
 
 void TextureCache::setMaxSize(uint32_t maxSize) {
-    mMaxSize = maxSize;
-    while (mSize > mMaxSize) {
-        mCache.removeOldest();
+    mCache.setMaxWeight(maxSize);
+}
+
+void TextureCache::setUploader(const sp<TextureUploader>& uploader) {
+    if (mUploader != NULL) {
+        mUploader->clear();
     }
+    mUploader = uploader;
+}
+
+uint32_t TextureCache::getAtlasSize() {
+    return mAtlas->getSize();
+}
+
+uint32_t TextureCache::getAtlasMaxSize() {
+    return mAtlas->getMaxSize();
+}
+
+const WeightedGenerationCache<SkBitmap*, Texture*>::Stats& TextureCache::getStats() const {
+    return mCache.getStats();
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -91,9 +121,8 @@ void TextureCache::setMaxSize(uint32_t maxSize) {
 void TextureCache::operator()(SkBitmap*& bitmap, Texture*& texture) {
     // This will be called already locked
     if (texture) {
-        mSize -= texture->bitmapSize;
-        TEXTURE_LOGD("TextureCache::callback: name, removed size, mSize = %d, %d, %d",
-                texture->id, texture->bitmapSize, mSize);
+        TEXTURE_LOGD("TextureCache::callback: name, removed size = %d, %d",
+                texture->id, texture->bitmapSize);
         if (mDebugEnabled) {
             LOGD("Texture deleted, size = %d", texture->bitmapSize);
         }
@@ -116,28 +145,11 @@ Texture* TextureCache::get(SkBitmap* bitmap) {
         }
 
         const uint32_t size = bitmap->rowBytes() * bitmap->height();
-        // Don't even try to cache a bitmap that's bigger than the cache
-        if (size < mMaxSize) {
-            while (mSize + size > mMaxSize) {
-                mCache.removeOldest();
-            }
-        }
 
         texture = new Texture;
         texture->bitmapSize = size;
         generateTexture(bitmap, texture, false);
-
-        if (size < mMaxSize) {
-            mSize += size;
-            TEXTURE_LOGD("TextureCache::get: create texture(%p): name, size, mSize = %d, %d, %d",
-                     bitmap, texture->id, size, mSize);
-            if (mDebugEnabled) {
-                LOGD("Texture created, size = %d", size);
-            }
-            mCache.put(bitmap, texture);
-        } else {
-            texture->cleanup = true;
-        }
+        addTexture(bitmap, texture);
     } else if (bitmap->getGenerationID() != texture->generation) {
         generateTexture(bitmap, texture, true);
     }
@@ -145,8 +157,77 @@ Texture* TextureCache::get(SkBitmap* bitmap) {
     return texture;
 }
 
+Texture* TextureCache::getPacked(SkBitmap* bitmap) {
+    Texture* texture = mAtlas->get(bitmap);
+    if (!texture) {
+        texture = getDeferred(bitmap);
+    }
+    return texture;
+}
+
+Texture* TextureCache::getDeferred(SkBitmap* bitmap) {
+    if (mUploader != NULL && !mCache.contains(bitmap)) {
+        if (mUploader->isPending(bitmap)) {
+            return NULL;
+        }
+
+        // The upload thread keeps a reference to the pixels, which
+        // bitmaps without a pixel ref cannot provide
+        const uint32_t size = bitmap->rowBytes() * bitmap->height();
+        if (size >= TEXTURE_UPLOAD_MIN_BITMAP_SIZE && size < mCache.getMaxWeight() &&
+                bitmap->pixelRef() &&
+                bitmap->width() <= mMaxTextureSize && bitmap->height() <= mMaxTextureSize &&
+                mUploader->upload(bitmap)) {
+            return NULL;
+        }
+    }
+    return get(bitmap);
+}
+
+bool TextureCache::hasPendingUploads() {
+    return mUploader != NULL && mUploader->hasPendingUploads();
+}
+
+void TextureCache::addTexture(SkBitmap* bitmap, Texture* texture) {
+    const uint32_t size = texture->bitmapSize;
+
+    // Don't even try to cache a bitmap that's bigger than the cache;
+    // otherwise the cache evicts the oldest textures to make room
+    if (size < mCache.getMaxWeight()) {
+        mCache.put(bitmap, texture, size);
+        TEXTURE_LOGD("TextureCache::get: create texture(%p): name, size, mSize = %d, %d, %d",
+                 bitmap, texture->id, size, mCache.getWeight());
+        if (mDebugEnabled) {
+            LOGD("Texture created, size = %d", size);
+        }
+    } else {
+        texture->cleanup = true;
+    }
+}
+
+void TextureCache::collectUploads() {
+    Vector<SkBitmap*> bitmaps;
+    Vector<Texture*> textures;
+    mUploader->collect(bitmaps, textures);
+
+    for (size_t i = 0; i < bitmaps.size(); i++) {
+        Texture* texture = textures.itemAt(i);
+        // The renderer may have generated the texture itself in the meantime
+        if (!mCache.contains(bitmaps.itemAt(i))) {
+            addTexture(bitmaps.itemAt(i), texture);
+        } else {
+            glDeleteTextures(1, &texture->id);
+            delete texture;
+        }
+    }
+}
+
 void TextureCache::remove(SkBitmap* bitmap) {
     mCache.remove(bitmap);
+    mAtlas->remove(bitmap);
+    if (mUploader != NULL) {
+        mUploader->cancel(bitmap);
+    }
 }
 
 void TextureCache::removeDeferred(SkBitmap* bitmap) {
@@ -159,13 +240,30 @@ void TextureCache::clearGarbage() {
     size_t count = mGarbage.size();
     for (size_t i = 0; i < count; i++) {
         mCache.remove(mGarbage.itemAt(i));
+        mAtlas->remove(mGarbage.itemAt(i));
+        if (mUploader != NULL) {
+            mUploader->cancel(mGarbage.itemAt(i));
+        }
     }
     mGarbage.clear();
+
+    // Collect the uploads after the removals above so that the
+    // textures of deleted bitmaps are never added to the cache
+    if (mUploader != NULL) {
+        collectUploads();
+    }
+
+    // Invoked at the beginning of every frame
+    mAtlas->startFrame();
 }
 
 void TextureCache::clear() {
     mCache.clear();
-    TEXTURE_LOGD("TextureCache:clear(), mSize = %d", mSize);
+    mAtlas->clear();
+    if (mUploader != NULL) {
+        mUploader->clear();
+    }
+    TEXTURE_LOGD("TextureCache:clear(), mSize = %d", mCache.getWeight());
 }
 
 void TextureCache::generateTexture(SkBitmap* bitmap, Texture* texture, bool regenerate) {
@@ -23,7 +23,9 @@
 
 #include "Debug.h"
 #include "Texture.h"
-#include "utils/GenerationCache.h"
+#include "TextureAtlas.h"
+#include "TextureUploader.h"
+#include "utils/WeightedGenerationCache.h"
 
 namespace android {
 namespace uirenderer {
@@ -46,7 +48,8 @@ namespace uirenderer {
 /**
  * A simple LRU texture cache. The cache has a maximum size expressed in bytes.
  * Any texture added to the cache causing the cache to grow beyond the maximum
- * allowed size will also cause the oldest texture to be kicked out.
+ * allowed size will also cause the oldest texture to be kicked out. Textures
+ * drawn only once are kicked out before textures that are drawn repeatedly.
  */
 class TextureCache: public OnEntryRemoved<SkBitmap*, Texture*> {
 public:
@@ -65,6 +68,26 @@ public:
      * cannot be found in the cache, a new texture is generated.
      */
     Texture* get(SkBitmap* bitmap);
+    /**
+     * Same as get() but small bitmaps are packed into a texture atlas shared
+     * with other bitmaps, so that drawing them does not require switching
+     * textures. A texture returned by this method must be drawn with its
+     * texture coordinates transformed by Texture::getTexTransform() and can
+     * only be used with GL_CLAMP_TO_EDGE wrap modes.
+     */
+    Texture* getPacked(SkBitmap* bitmap);
+    /**
+     * Same as get() but if a texture upload thread was set, textures for
+     * large bitmaps are generated on that thread. In that case this method
+     * returns NULL until the texture is ready, and hasPendingUploads()
+     * returns true until the texture can be drawn.
+     */
+    Texture* getDeferred(SkBitmap* bitmap);
+    /**
+     * Returns true if textures are being generated by the upload thread.
+     * The frame must then be drawn again once they are ready.
+     */
+    bool hasPendingUploads();
     /**
      * Removes the texture associated with the specified bitmap.
      * Upon remove the texture is freed.
@@ -85,6 +108,12 @@ public:
      */
     void clear();
 
+    /**
+     * Sets the thread used to generate the textures of large bitmaps, or NULL
+     * to generate all the textures synchronously.
+     */
+    void setUploader(const sp<TextureUploader>& uploader);
+
     /**
      * Sets the maximum size of the cache in bytes.
      */
@@ -97,32 +126,54 @@ public:
      * Returns the current size of the cache in bytes.
      */
     uint32_t getSize();
+    /**
+     * Returns the current and maximum size of the texture atlas in bytes.
+     */
+    uint32_t getAtlasSize();
+    uint32_t getAtlasMaxSize();
+    /**
+     * Returns the hit, miss and eviction counts of the cache.
+     */
+    const WeightedGenerationCache<SkBitmap*, Texture*>::Stats& getStats() const;
 
 private:
     /**
      * Generates the texture from a bitmap into the specified texture structure.
+     * This only uses the current GL context and can be invoked from the
+     * texture upload thread.
      *
      * @param regenerate If true, the bitmap data is reuploaded into the texture, but
      *        no new texture is generated.
      */
-    void generateTexture(SkBitmap* bitmap, Texture* texture, bool regenerate = false);
+    static void generateTexture(SkBitmap* bitmap, Texture* texture, bool regenerate = false);
 
-    void uploadLoFiTexture(bool resize, SkBitmap* bitmap, uint32_t width, uint32_t height);
-    void uploadToTexture(bool resize, GLenum format, GLsizei width, GLsizei height,
+    static void uploadLoFiTexture(bool resize, SkBitmap* bitmap, uint32_t width, uint32_t height);
+    static void uploadToTexture(bool resize, GLenum format, GLsizei width, GLsizei height,
             GLenum type, const GLvoid * data);
 
+    /**
+     * Adds a newly generated texture to the cache.
+     */
+    void addTexture(SkBitmap* bitmap, Texture* texture);
+    /**
+     * Adds the textures generated by the upload thread to the cache.
+     */
+    void collectUploads();
+
     void init();
 
-    GenerationCache<SkBitmap*, Texture*> mCache;
+    WeightedGenerationCache<SkBitmap*, Texture*> mCache;
+    TextureAtlas* mAtlas;
+    sp<TextureUploader> mUploader;
 
-    uint32_t mSize;
-    uint32_t mMaxSize;
     GLint mMaxTextureSize;
 
     bool mDebugEnabled;
 
     Vector<SkBitmap*> mGarbage;
     mutable Mutex mLock;
+
+    friend class TextureUploader;
 }; // class TextureCache
 
 }; // namespace uirenderer
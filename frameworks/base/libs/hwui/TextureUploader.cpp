@@ -0,0 +1,307 @@
+/*
+ * Copyright (C) 2011 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "OpenGLRenderer"
+
+#include <GLES2/gl2.h>
+
+#include <utils/Log.h>
+
+#include "TextureCache.h"
+#include "TextureUploader.h"
+
+namespace android {
+namespace uirenderer {
+
+///////////////////////////////////////////////////////////////////////////////
+// Constructors/destructor
+///////////////////////////////////////////////////////////////////////////////
+
+TextureUploader::TextureUploader(): Thread(false),
+        mDisplay(EGL_NO_DISPLAY), mContext(EGL_NO_CONTEXT), mSurface(EGL_NO_SURFACE),
+        mFailed(true) {
+}
+
+TextureUploader::~TextureUploader() {
+    terminate();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Lifecycle
+///////////////////////////////////////////////////////////////////////////////
+
+bool TextureUploader::init() {
+    EGLDisplay display = eglGetCurrentDisplay();
+    EGLContext sharedContext = eglGetCurrentContext();
+    if (display == EGL_NO_DISPLAY || sharedContext == EGL_NO_CONTEXT) {
+        LOGW("Cannot start the texture upload thread without an EGL context");
+        return false;
+    }
+
+    // Use the config of the renderer's context if it can be used to create
+    // the pbuffer the upload thread needs to make its context current
+    EGLint configId = 0;
+    EGLint configCount = 0;
+    EGLConfig config = NULL;
+    eglQueryContext(display, sharedContext, EGL_CONFIG_ID, &configId);
+    EGLint configAttribs[] = { EGL_CONFIG_ID, configId, EGL_NONE };
+    eglChooseConfig(display, configAttribs, &config, 1, &configCount);
+
+    EGLint surfaceType = 0;
+    if (configCount > 0) {
+        eglGetConfigAttrib(display, config, EGL_SURFACE_TYPE, &surfaceType);
+    }
+    if (!(surfaceType & EGL_PBUFFER_BIT)) {
+        EGLint pbufferAttribs[] = {
+                EGL_RENDERABLE_TYPE, EGL_OPENGL_ES2_BIT,
+                EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+                EGL_NONE
+        };
+        if (!eglChooseConfig(display, pbufferAttribs, &config, 1, &configCount) ||
+                configCount == 0) {
+            LOGW("Cannot find an EGL config for the texture upload thread");
+            return false;
+        }
+    }
+
+    EGLint surfaceAttribs[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+    EGLSurface surface = eglCreatePbufferSurface(display, config, surfaceAttribs);
+    if (surface == EGL_NO_SURFACE) {
+        LOGW("Cannot create the surface of the texture upload thread (0x%x)", eglGetError());
+        return false;
+    }
+
+    EGLint contextAttribs[] = { EGL_CONTEXT_CLIENT_VERSION, 2, EGL_NONE };
+    EGLContext context = eglCreateContext(display, config, sharedContext, contextAttribs);
+    if (context == EGL_NO_CONTEXT) {
+        LOGW("Cannot create the context of the texture upload thread (0x%x)", eglGetError());
+        eglDestroySurface(display, surface);
+        return false;
+    }
+
+    mDisplay = display;
+    mContext = context;
+    mSurface = surface;
+    mFailed = false;
+
+    if (run("hwuiTextureUpload", PRIORITY_DISPLAY) != NO_ERROR) {
+        terminate();
+        return false;
+    }
+
+    return true;
+}
+
+void TextureUploader::terminate() {
+    {
+        Mutex::Autolock _l(mLock);
+        mFailed = true;
+        requestExit();
+        mCondition.signal();
+    }
+    requestExitAndWait();
+
+    // The upload thread is gone, nothing is in progress anymore
+    for (size_t i = 0; i < mUploads.size(); i++) {
+        deleteUpload(mUploads.valueAt(i));
+    }
+    mUploads.clear();
+    mQueue.clear();
+    mDone.clear();
+
+    if (mContext != EGL_NO_CONTEXT) {
+        eglDestroyContext(mDisplay, mContext);
+        mContext = EGL_NO_CONTEXT;
+    }
+    if (mSurface != EGL_NO_SURFACE) {
+        eglDestroySurface(mDisplay, mSurface);
+        mSurface = EGL_NO_SURFACE;
+    }
+}
+
+status_t TextureUploader::readyToRun() {
+    if (!eglMakeCurrent(mDisplay, mSurface, mSurface, mContext)) {
+        LOGW("Cannot make the context of the texture upload thread current (0x%x)",
+                eglGetError());
+
+        // Let the renderer upload the queued bitmaps itself
+        Mutex::Autolock _l(mLock);
+        mFailed = true;
+        mDone.appendVector(mQueue);
+        mQueue.clear();
+        return UNKNOWN_ERROR;
+    }
+    return NO_ERROR;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Uploads
+///////////////////////////////////////////////////////////////////////////////
+
+bool TextureUploader::upload(SkBitmap* bitmap) {
+    Mutex::Autolock _l(mLock);
+
+    if (mFailed || mUploads.indexOfKey(bitmap) >= 0) {
+        return false;
+    }
+
+    Upload* upload = new Upload(bitmap);
+    mUploads.add(bitmap, upload);
+    mQueue.add(upload);
+    mCondition.signal();
+
+    return true;
+}
+
+bool TextureUploader::isPending(SkBitmap* bitmap) {
+    Mutex::Autolock _l(mLock);
+    return mUploads.indexOfKey(bitmap) >= 0;
+}
+
+bool TextureUploader::hasPendingUploads() {
+    Mutex::Autolock _l(mLock);
+    return !mUploads.isEmpty();
+}
+
+void TextureUploader::cancel(SkBitmap* bitmap) {
+    Mutex::Autolock _l(mLock);
+
+    ssize_t index = mUploads.indexOfKey(bitmap);
+    if (index < 0) {
+        return;
+    }
+
+    Upload* upload = mUploads.valueAt(index);
+    mUploads.removeItemsAt(index);
+
+    for (size_t i = 0; i < mQueue.size(); i++) {
+        if (mQueue.itemAt(i) == upload) {
+            mQueue.removeAt(i);
+            deleteUpload(upload);
+            return;
+        }
+    }
+
+    for (size_t i = 0; i < mDone.size(); i++) {
+        if (mDone.itemAt(i) == upload) {
+            mDone.removeAt(i);
+            deleteUpload(upload);
+            return;
+        }
+    }
+
+    // The upload thread owns the upload until it is done with it
+    upload->cancelled = true;
+}
+
+void TextureUploader::clear() {
+    Mutex::Autolock _l(mLock);
+
+    for (size_t i = 0; i < mUploads.size(); i++) {
+        mUploads.valueAt(i)->cancelled = true;
+    }
+    mUploads.clear();
+
+    for (size_t i = 0; i < mQueue.size(); i++) {
+        deleteUpload(mQueue.itemAt(i));
+    }
+    mQueue.clear();
+
+    for (size_t i = 0; i < mDone.size(); i++) {
+        deleteUpload(mDone.itemAt(i));
+    }
+    mDone.clear();
+}
+
+void TextureUploader::collect(Vector<SkBitmap*>& bitmaps, Vector<Texture*>& textures) {
+    Mutex::Autolock _l(mLock);
+
+    for (size_t i = 0; i < mDone.size(); i++) {
+        Upload* upload = mDone.itemAt(i);
+        if (upload->texture) {
+            bitmaps.add(upload->key);
+            textures.add(upload->texture);
+            upload->texture = NULL;
+        }
+        mUploads.removeItem(upload->key);
+        delete upload;
+    }
+    mDone.clear();
+}
+
+void TextureUploader::deleteUpload(Upload* upload) {
+    if (upload->texture) {
+        glDeleteTextures(1, &upload->texture->id);
+        delete upload->texture;
+    }
+    delete upload;
+}
+
+bool TextureUploader::threadLoop() {
+    Vector<Upload*> uploads;
+    {
+        Mutex::Autolock _l(mLock);
+        while (mQueue.isEmpty() && !exitPending()) {
+            mCondition.wait(mLock);
+        }
+        if (exitPending()) {
+            eglMakeCurrent(mDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+            return false;
+        }
+
+        uploads = mQueue;
+        mQueue.clear();
+    }
+
+    for (size_t i = 0; i < uploads.size(); i++) {
+        Upload* upload = uploads.itemAt(i);
+        SkBitmap* bitmap = &upload->bitmap;
+
+        Texture* texture = new Texture;
+        texture->id = 0;
+        texture->bitmapSize = bitmap->rowBytes() * bitmap->height();
+        TextureCache::generateTexture(bitmap, texture, false);
+
+        if (texture->id) {
+            upload->texture = texture;
+        } else {
+            delete texture;
+        }
+    }
+
+    // The renderer may only use the textures once they are complete
+    glFinish();
+
+    {
+        Mutex::Autolock _l(mLock);
+        for (size_t i = 0; i < uploads.size(); i++) {
+            Upload* upload = uploads.itemAt(i);
+            if (upload->cancelled) {
+                deleteUpload(upload);
+            } else {
+                // Let go of the pixels now rather than when the
+                // upload is collected
+                upload->bitmap.reset();
+                mDone.add(upload);
+            }
+        }
+    }
+
+    return true;
+}
+
+}; // namespace uirenderer
+}; // namespace android
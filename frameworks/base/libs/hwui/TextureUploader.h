@@ -0,0 +1,129 @@
+/*
+ * Copyright (C) 2011 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_HWUI_TEXTURE_UPLOADER_H
+#define ANDROID_HWUI_TEXTURE_UPLOADER_H
+
+#include <EGL/egl.h>
+
+#include <SkBitmap.h>
+
+#include <utils/KeyedVector.h>
+#include <utils/threads.h>
+#include <utils/Vector.h>
+
+#include "Texture.h"
+
+namespace android {
+namespace uirenderer {
+
+/**
+ * Generates textures from bitmaps on a background thread, using an EGL
+ * context that shares its objects with the context of the renderer. This
+ * moves the decoding, conversion and upload of large bitmaps out of the
+ * drawing thread.
+ *
+ * Uploads are requested with upload() and their textures picked up with
+ * collect(), both from the thread of the renderer.
+ */
+class TextureUploader: public Thread {
+public:
+    TextureUploader();
+    ~TextureUploader();
+
+    /**
+     * Creates the EGL context of the upload thread and starts the thread.
+     * Must be called from the thread that owns the current EGL context.
+     * Returns false if the context cannot be created, in which case
+     * uploads cannot be requested.
+     */
+    bool init();
+    /**
+     * Stops the upload thread and deletes the textures that were not
+     * collected. Must be called from the thread of the renderer.
+     */
+    void terminate();
+
+    /**
+     * Queues the upload of the specified bitmap. The bitmap's pixels are
+     * kept alive until the upload is done. Returns false if the upload
+     * cannot be queued, for instance because the upload thread failed,
+     * or if an upload is already pending for that bitmap.
+     */
+    bool upload(SkBitmap* bitmap);
+    /**
+     * Returns true if the upload of the specified bitmap was requested but
+     * its texture was not collected yet.
+     */
+    bool isPending(SkBitmap* bitmap);
+    /**
+     * Returns true if uploads are queued or in progress.
+     */
+    bool hasPendingUploads();
+    /**
+     * Cancels the upload of the specified bitmap. If the upload is already
+     * done its texture is deleted.
+     */
+    void cancel(SkBitmap* bitmap);
+    /**
+     * Cancels all the uploads.
+     */
+    void clear();
+
+    /**
+     * Returns the textures uploaded since the last call. The caller becomes
+     * the owner of the textures.
+     */
+    void collect(Vector<SkBitmap*>& bitmaps, Vector<Texture*>& textures);
+
+private:
+    struct Upload {
+        Upload(SkBitmap* bitmap): key(bitmap), bitmap(*bitmap), texture(NULL),
+                cancelled(false) {
+        }
+
+        SkBitmap* key;
+        // Shares the pixels of the original bitmap, keeping them alive
+        SkBitmap bitmap;
+        Texture* texture;
+        bool cancelled;
+    };
+
+    virtual status_t readyToRun();
+    virtual bool threadLoop();
+
+    void deleteUpload(Upload* upload);
+
+    EGLDisplay mDisplay;
+    EGLContext mContext;
+    EGLSurface mSurface;
+
+    Mutex mLock;
+    Condition mCondition;
+
+    // All the uploads, by bitmap, until they are collected or cancelled
+    KeyedVector<SkBitmap*, Upload*> mUploads;
+    Vector<Upload*> mQueue;
+    // Uploads taken from the queue by the upload thread are in neither
+    // of these and are cancelled by setting their cancelled flag
+    Vector<Upload*> mDone;
+    bool mFailed;
+}; // class TextureUploader
+
+}; // namespace uirenderer
+}; // namespace android
+
+#endif // ANDROID_HWUI_TEXTURE_UPLOADER_H
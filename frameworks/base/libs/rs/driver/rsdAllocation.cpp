@@ -351,6 +351,15 @@ void rsdAllocationSyncAll(const Context *rsc, const Allocation *alloc,
 
     rsAssert(src == RS_ALLOCATION_USAGE_SCRIPT);
 
+    // Every GL consumer checks uploadDeferred when the allocation is bound,
+    // so just flag it here. An allocation that is synced every frame but
+    // only drawn some of the time then only pays for the uploads it uses.
+    drv->uploadDeferred = true;
+}
+
+void rsdAllocationUpload(const Context *rsc, const Allocation *alloc) {
+    DrvAllocation *drv = (DrvAllocation *)alloc->mHal.drv;
+
     if (alloc->mHal.state.usageFlags & RS_ALLOCATION_USAGE_GRAPHICS_TEXTURE) {
         UploadToTexture(rsc, alloc);
     } else {
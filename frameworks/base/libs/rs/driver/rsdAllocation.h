@@ -68,6 +68,11 @@ void rsdAllocationSyncAll(const android::renderscript::Context *rsc,
 void rsdAllocationMarkDirty(const android::renderscript::Context *rsc,
                             const android::renderscript::Allocation *alloc);
 
+// Pushes script side changes to the GL objects backing the allocation.
+// Called when the allocation is bound with uploadDeferred set.
+void rsdAllocationUpload(const android::renderscript::Context *rsc,
+                         const android::renderscript::Allocation *alloc);
+
 void rsdAllocationData1D(const android::renderscript::Context *rsc,
                          const android::renderscript::Allocation *alloc,
                          uint32_t xoff, uint32_t lod, uint32_t count,
@@ -359,7 +359,6 @@ void rsdScriptInvokeForEach(const Context *rsc,
     mtls.script = s;
     mtls.usr = usr;
     mtls.usrLen = usrLen;
-    mtls.mSliceSize = 10;
     mtls.mSliceNum = 0;
 
     mtls.ptrIn = NULL;
@@ -377,9 +376,18 @@ void rsdScriptInvokeForEach(const Context *rsc,
     }
 
     if ((dc->mWorkers.mCount > 1) && s->mHal.info.isThreadable) {
+        // Workers pull slices off a shared counter, so a worker that
+        // finishes cheap rows early just takes more of them. Size the
+        // slices so each worker gets several, which keeps uneven rows
+        // balanced without paying an atomic per handful of elements.
+        uint32_t slices = dc->mWorkers.mCount * 8;
         if (mtls.dimY > 1) {
+            mtls.mSliceSize = rsMax((uint32_t)1,
+                                    (mtls.yEnd - mtls.yStart) / slices);
             rsdLaunchThreads(mrsc, wc_xy, &mtls);
         } else {
+            mtls.mSliceSize = rsMax((uint32_t)16,
+                                    (mtls.xEnd - mtls.xStart) / slices);
             rsdLaunchThreads(mrsc, wc_x, &mtls);
         }
 
@@ -37,8 +37,7 @@ void setDepthAttachment(const Context *rsc, const FBOCache *fb) {
         depth = (DrvAllocation *)fb->mHal.state.depthTarget->mHal.drv;
 
         if (depth->uploadDeferred) {
-            rsdAllocationSyncAll(rsc, fb->mHal.state.depthTarget.get(),
-                                 RS_ALLOCATION_USAGE_SCRIPT);
+            rsdAllocationUpload(rsc, fb->mHal.state.depthTarget.get());
         }
     }
     fbo->setDepthTarget(depth);
@@ -53,8 +52,7 @@ void setColorAttachment(const Context *rsc, const FBOCache *fb) {
             color = (DrvAllocation *)fb->mHal.state.colorTargets[i]->mHal.drv;
 
             if (color->uploadDeferred) {
-                rsdAllocationSyncAll(rsc, fb->mHal.state.colorTargets[i].get(),
-                                     RS_ALLOCATION_USAGE_SCRIPT);
+                rsdAllocationUpload(rsc, fb->mHal.state.colorTargets[i].get());
             }
         }
         fbo->setColorTarget(color, i);
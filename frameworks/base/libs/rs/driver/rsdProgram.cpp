@@ -49,7 +49,7 @@ static void SyncProgramConstants(const Context *rsc, const Program *p) {
         }
         DrvAllocation *drvAlloc = (DrvAllocation *)a->mHal.drv;
         if (drvAlloc->uploadDeferred) {
-            rsdAllocationSyncAll(rsc, a, RS_ALLOCATION_USAGE_SCRIPT);
+            rsdAllocationUpload(rsc, a);
         }
     }
 }
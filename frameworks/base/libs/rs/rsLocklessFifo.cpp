@@ -108,9 +108,17 @@ void LocklessCommandFifo::commit(uint32_t command, uint32_t sizeInBytes) {
     reinterpret_cast<uint16_t *>(mPut)[1] = sizeInBytes;
 
     int32_t s = ((sizeInBytes + 3) & ~3) + 4;
-    android_atomic_add(s, (int32_t *)&mPut);
+    int32_t oldPut = android_atomic_add(s, (int32_t *)&mPut);
     //dumpState("commit 2");
-    mSignalToWorker.set();
+
+    // The worker only blocks once it has drained the fifo, so it only
+    // needs waking if this command went into an empty one. Both sides
+    // advance their pointer with a full barrier before checking the
+    // other's, so one of them always sees the new state. Skipping the
+    // signal keeps a burst of small commands off the mutex and condition.
+    if (android_atomic_acquire_load((int32_t *)&mGet) == oldPut) {
+        mSignalToWorker.set();
+    }
 }
 
 void LocklessCommandFifo::commitSync(uint32_t command, uint32_t sizeInBytes) {
@@ -169,8 +177,9 @@ const void * LocklessCommandFifo::get(uint32_t *command, uint32_t *bytesData, ui
             return mGet+4;
         }
 
-        // zero command means reset to beginning.
-        mGet = mBuffer;
+        // zero command means reset to beginning. This needs a full barrier
+        // like next(), see commit().
+        android_atomic_add((int32_t)(mBuffer - mGet), (int32_t *)&mGet);
     }
 }
 
@@ -36,6 +36,14 @@ static const int DEFAULT_MESSAGE_BUFFER_SIZE = ROUND_UP(
                 * (sizeof(InputMessage::SampleData) + MAX_POINTERS * sizeof(PointerCoords)),
         4096);
 
+// Latency added when resampling: samples are predicted for slightly before the
+// frame time since the frame is composited and shown some time after that.
+static const nsecs_t RESAMPLE_LATENCY = 5 * 1000000; // 5 ms
+
+// Maximum time to predict forward from the last real sample.  Beyond this,
+// extrapolation tends to overshoot when the pointer changes direction.
+static const nsecs_t RESAMPLE_MAX_PREDICTION = 8 * 1000000; // 8 ms
+
 // Signal sent by the producer to the consumer to inform it that a new message is
 // available to be consumed in the shared memory buffer.
 static const char INPUT_SIGNAL_DISPATCH = 'D';
@@ -319,6 +327,7 @@ status_t InputPublisher::publishInputEvent(
     mSemaphoreInitialized = true;
 
     mSharedMessage->consumed = false;
+    mSharedMessage->consumeTime = -1;
     mSharedMessage->type = type;
     mSharedMessage->deviceId = deviceId;
     mSharedMessage->source = source;
@@ -538,6 +547,13 @@ status_t InputPublisher::receiveFinishedSignal(bool* outHandled) {
     return OK;
 }
 
+nsecs_t InputPublisher::getConsumeTime() const {
+    if (!mPinned || !mSharedMessage->consumed) {
+        return -1;
+    }
+    return mSharedMessage->consumeTime;
+}
+
 // --- InputConsumer ---
 
 InputConsumer::InputConsumer(const sp<InputChannel>& channel) :
@@ -577,7 +593,8 @@ status_t InputConsumer::initialize() {
     return OK;
 }
 
-status_t InputConsumer::consume(InputEventFactoryInterface* factory, InputEvent** outEvent) {
+status_t InputConsumer::consume(InputEventFactoryInterface* factory, InputEvent** outEvent,
+        nsecs_t frameTime) {
 #if DEBUG_TRANSPORT_ACTIONS
     LOGD("channel '%s' consumer ~ consume",
             mChannel->getName().string());
@@ -616,6 +633,7 @@ status_t InputConsumer::consume(InputEventFactoryInterface* factory, InputEvent*
         return UNKNOWN_ERROR;
     }
 
+    mSharedMessage->consumeTime = systemTime(SYSTEM_TIME_MONOTONIC);
     mSharedMessage->consumed = true;
 
     switch (mSharedMessage->type) {
@@ -635,6 +653,13 @@ status_t InputConsumer::consume(InputEventFactoryInterface* factory, InputEvent*
 
         populateMotionEvent(motionEvent);
 
+        if (motionEvent->getSource() & AINPUT_SOURCE_CLASS_POINTER) {
+            mVelocityTracker.addMovement(motionEvent);
+            if (frameTime >= 0) {
+                resampleMotionEvent(motionEvent, frameTime);
+            }
+        }
+
         *outEvent = motionEvent;
         break;
     }
@@ -724,4 +749,40 @@ void InputConsumer::populateMotionEvent(MotionEvent* motionEvent) const {
     }
 }
 
+void InputConsumer::resampleMotionEvent(MotionEvent* motionEvent, nsecs_t frameTime) const {
+    if (motionEvent->getAction() != AMOTION_EVENT_ACTION_MOVE) {
+        return;
+    }
+
+    nsecs_t eventTime = motionEvent->getEventTime();
+    nsecs_t sampleTime = frameTime - RESAMPLE_LATENCY;
+    if (sampleTime <= eventTime) {
+        return; // the last sample is recent enough already
+    }
+    if (sampleTime - eventTime > RESAMPLE_MAX_PREDICTION) {
+        sampleTime = eventTime + RESAMPLE_MAX_PREDICTION;
+    }
+    float dt = (sampleTime - eventTime) * 0.000000001f;
+
+    size_t pointerCount = motionEvent->getPointerCount();
+    PointerCoords coords[MAX_POINTERS];
+    for (size_t i = 0; i < pointerCount; i++) {
+        float vx, vy;
+        if (!mVelocityTracker.getVelocity(motionEvent->getPointerId(i), &vx, &vy)) {
+            return; // not enough movement to predict from
+        }
+
+        const PointerCoords* last = motionEvent->getRawPointerCoords(i);
+        coords[i].copyFrom(*last);
+        coords[i].setAxisValue(AMOTION_EVENT_AXIS_X, last->getX() + vx * dt);
+        coords[i].setAxisValue(AMOTION_EVENT_AXIS_Y, last->getY() + vy * dt);
+    }
+
+#if DEBUG_TRANSPORT_ACTIONS
+    LOGD("channel '%s' consumer ~ resampled motion event to %lld, %0.3fms ahead",
+            mChannel->getName().string(), sampleTime, dt * 1000);
+#endif
+    motionEvent->addSample(sampleTime, coords);
+}
+
 } // namespace android
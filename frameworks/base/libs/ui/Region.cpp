@@ -238,17 +238,18 @@ const Region Region::operation(const Region& rhs, int dx, int dy, int op) const
 
 // This is our region rasterizer, which merges rects and spans together
 // to obtain an optimal region.
+// Spans are built directly at the end of the destination's storage and
+// dropped again if they merge with the span above, so that no temporary
+// vector needs to be allocated and copied for every span.
 class Region::rasterizer : public region_operator<Rect>::region_rasterizer 
 {
     Rect& bounds;
     Vector<Rect>& storage;
-    Rect* head;
-    Rect* tail;
-    Vector<Rect> span;
-    Rect* cur;
+    ssize_t head;   // index of the last span flushed, or -1
+    size_t tail;    // index of the span being built
 public:
     rasterizer(Region& reg) 
-        : bounds(reg.mBounds), storage(reg.mStorage), head(), tail(), cur() {
+        : bounds(reg.mBounds), storage(reg.mStorage), head(-1), tail(0) {
         bounds.top = bounds.bottom = 0;
         bounds.left   = INT_MAX;
         bounds.right  = INT_MIN;
@@ -256,7 +257,7 @@ public:
     }
 
     ~rasterizer() {
-        if (span.size()) {
+        if (storage.size() > tail) {
             flushSpan();
         }
         if (storage.size()) {
@@ -274,16 +275,17 @@ public:
     virtual void operator()(const Rect& rect) {
         //LOGD(">>> %3d, %3d, %3d, %3d", 
         //        rect.left, rect.top, rect.right, rect.bottom);
-        if (span.size()) {
-            if (cur->top != rect.top) {
+        const size_t count = storage.size();
+        if (count > tail) {
+            Rect& cur(storage.editItemAt(count - 1));
+            if (cur.top != rect.top) {
                 flushSpan();
-            } else if (cur->right == rect.left) {
-                cur->right = rect.right;
+            } else if (cur.right == rect.left) {
+                cur.right = rect.right;
                 return;
             }
         }
-        span.add(rect);
-        cur = span.editArray() + (span.size() - 1);
+        storage.add(rect);
     }
 private:
     template<typename T> 
@@ -291,39 +293,121 @@ private:
     template<typename T> 
     static inline T max(T rhs, T lhs) { return rhs > lhs ? rhs : lhs; }
     void flushSpan() {
+        const size_t count = storage.size();
+        const size_t spanSize = count - tail;
         bool merge = false;
-        if (tail-head == ssize_t(span.size())) {
-            Rect const* p = span.editArray();
-            Rect const* q = head;
+        if (head >= 0 && tail - size_t(head) == spanSize) {
+            Rect const* p = storage.array() + tail;
+            Rect const* q = storage.array() + head;
             if (p->top == q->bottom) {
                 merge = true;
-                while (q != tail) {
-                    if ((p->left != q->left) || (p->right != q->right)) {
+                for (size_t i=0 ; i<spanSize ; i++) {
+                    if ((p[i].left != q[i].left) || (p[i].right != q[i].right)) {
                         merge = false;
                         break;
                     }
-                    p++, q++;
                 }
             }
         }
         if (merge) {
-            const int bottom = span[0].bottom;
-            Rect* r = head;
-            while (r != tail) {
-                r->bottom = bottom;
-                r++;
+            const int bottom = storage.itemAt(tail).bottom;
+            Rect* r = storage.editArray() + head;
+            for (size_t i=0 ; i<spanSize ; i++) {
+                r[i].bottom = bottom;
             }
+            storage.removeItemsAt(tail, spanSize);
         } else {
-            bounds.left = min(span.itemAt(0).left, bounds.left);
-            bounds.right = max(span.top().right, bounds.right);
-            storage.appendVector(span);
-            tail = storage.editArray() + storage.size();
-            head = tail - span.size();
+            bounds.left = min(storage.itemAt(tail).left, bounds.left);
+            bounds.right = max(storage.itemAt(count - 1).right, bounds.right);
+            head = tail;
+            tail = count;
         }
-        span.clear();
     }
 };
 
+// ----------------------------------------------------------------------------
+
+static inline bool contains(const Rect& outer, const Rect& inner) {
+    return outer.left <= inner.left && outer.top <= inner.top &&
+            outer.right >= inner.right && outer.bottom >= inner.bottom;
+}
+
+// Handles the operations whose result is one of the operands or a single
+// rectangle, which are by far the most common ones, without running the
+// rasterizer. 'rb' is the bounds of rhs, already translated by dx,dy; rhs
+// is NULL when it is a plain rectangle. Returns false if the general case
+// must be used.
+static bool trivial_operation(int op, Region& dst,
+        const Region& lhs, const Region* rhs, const Rect& rb, int dx, int dy)
+{
+    const Rect lb(lhs.getBounds());
+    const bool lhsIsRect = lhs.isRect();
+    const bool rhsIsRect = !rhs || rhs->isRect();
+    Rect common;
+    const bool overlap = !lb.isEmpty() && !rb.isEmpty() &&
+            lb.intersect(rb, &common);
+
+    switch (op) {
+    case op_and:
+        if (!overlap) {
+            dst.clear();
+        } else if (lhsIsRect && rhsIsRect) {
+            dst.set(common);
+        } else if (rhsIsRect && contains(rb, lb)) {
+            dst = lhs;
+        } else if (lhsIsRect && contains(lb, rb)) {
+            dst = *rhs;
+            dst.translateSelf(dx, dy);
+        } else {
+            return false;
+        }
+        return true;
+
+    case op_or:
+        if (rb.isEmpty()) {
+            if (lb.isEmpty()) {
+                dst.clear();
+            } else {
+                dst = lhs;
+            }
+        } else if (lb.isEmpty() || (rhsIsRect && contains(rb, lb))) {
+            if (rhs) {
+                dst = *rhs;
+                dst.translateSelf(dx, dy);
+            } else {
+                dst.set(rb);
+            }
+        } else if (lhsIsRect && contains(lb, rb)) {
+            dst = lhs;
+        } else if (lhsIsRect && rhsIsRect &&
+                (((lb.left == rb.left && lb.right == rb.right) &&
+                  (lb.top <= rb.bottom && rb.top <= lb.bottom)) ||
+                 ((lb.top == rb.top && lb.bottom == rb.bottom) &&
+                  (lb.left <= rb.right && rb.left <= lb.right)))) {
+            // the two rectangles stack up into a single one
+            dst.set(Rect(
+                    lb.left   < rb.left   ? lb.left   : rb.left,
+                    lb.top    < rb.top    ? lb.top    : rb.top,
+                    lb.right  > rb.right  ? lb.right  : rb.right,
+                    lb.bottom > rb.bottom ? lb.bottom : rb.bottom));
+        } else {
+            return false;
+        }
+        return true;
+
+    case op_nand:
+        if (lb.isEmpty() || (rhsIsRect && contains(rb, lb))) {
+            dst.clear();
+        } else if (!overlap) {
+            dst = lhs;
+        } else {
+            return false;
+        }
+        return true;
+    }
+    return false;
+}
+
 bool Region::validate(const Region& reg, const char* name)
 {
     bool result = true;
@@ -376,6 +460,14 @@ void Region::boolean_operation(int op, Region& dst,
     validate(dst, "boolean_operation (before): dst");
 #endif
 
+#if !VALIDATE_WITH_CORECG
+    Rect rb(rhs.getBounds());
+    rb.offsetBy(dx, dy);
+    if (trivial_operation(op, dst, lhs, &rhs, rb, dx, dy)) {
+        return;
+    }
+#endif
+
     size_t lhs_count;
     Rect const * const lhs_rects = lhs.getArray(&lhs_count);
 
@@ -488,6 +580,12 @@ void Region::boolean_operation(int op, Region& dst,
 #if VALIDATE_WITH_CORECG || VALIDATE_REGIONS
     boolean_operation(op, dst, lhs, Region(rhs), dx, dy);
 #else
+    Rect rb(rhs);
+    rb.offsetBy(dx, dy);
+    if (trivial_operation(op, dst, lhs, NULL, rb, dx, dy)) {
+        return;
+    }
+
     size_t lhs_count;
     Rect const * const lhs_rects = lhs.getArray(&lhs_count);
 
@@ -62,6 +62,7 @@ protected:
     void PublishAndConsumeMotionEvent(
             size_t samplesToAppendBeforeDispatch = 0,
             size_t samplesToAppendAfterDispatch = 0);
+    void PublishAndConsumeMovingPointer(nsecs_t frameTime, MotionEvent** outEvent);
 };
 
 TEST_F(InputPublisherAndConsumerTest, GetChannel_ReturnsTheChannel) {
@@ -95,10 +96,13 @@ void InputPublisherAndConsumerTest::PublishAndConsumeKeyEvent() {
     const nsecs_t downTime = 3;
     const nsecs_t eventTime = 4;
 
+    nsecs_t publishTime = systemTime(SYSTEM_TIME_MONOTONIC);
     status = mPublisher->publishKeyEvent(deviceId, source, action, flags,
             keyCode, scanCode, metaState, repeatCount, downTime, eventTime);
     ASSERT_EQ(OK, status)
             << "publisher publishKeyEvent should return OK";
+    EXPECT_EQ(-1, mPublisher->getConsumeTime())
+            << "publisher getConsumeTime should return -1 before the event is consumed";
 
     status = mPublisher->sendDispatchSignal();
     ASSERT_EQ(OK, status)
@@ -129,6 +133,8 @@ void InputPublisherAndConsumerTest::PublishAndConsumeKeyEvent() {
     EXPECT_EQ(repeatCount, keyEvent->getRepeatCount());
     EXPECT_EQ(downTime, keyEvent->getDownTime());
     EXPECT_EQ(eventTime, keyEvent->getEventTime());
+    EXPECT_LE(publishTime, mPublisher->getConsumeTime())
+            << "publisher getConsumeTime should return the time the consumer consumed the event";
 
     status = mConsumer->sendFinishedSignal(true);
     ASSERT_EQ(OK, status)
@@ -332,6 +338,55 @@ void InputPublisherAndConsumerTest::PublishAndConsumeMotionEvent(
             << "publisher reset should return OK";
 }
 
+// Publishes a pointer moving right at 1000 pixels per second, sampled every 10ms
+// up to t = 20ms, then consumes it for a frame at the specified time.
+void InputPublisherAndConsumerTest::PublishAndConsumeMovingPointer(nsecs_t frameTime,
+        MotionEvent** outEvent) {
+    status_t status;
+
+    PointerProperties pointerProperties[1];
+    pointerProperties[0].clear();
+    pointerProperties[0].id = 0;
+    pointerProperties[0].toolType = AMOTION_EVENT_TOOL_TYPE_FINGER;
+
+    PointerCoords pointerCoords[1];
+    pointerCoords[0].clear();
+    pointerCoords[0].setAxisValue(AMOTION_EVENT_AXIS_X, 0);
+    pointerCoords[0].setAxisValue(AMOTION_EVENT_AXIS_Y, 50);
+    pointerCoords[0].setAxisValue(AMOTION_EVENT_AXIS_PRESSURE, 1);
+
+    status = mPublisher->publishMotionEvent(1, AINPUT_SOURCE_TOUCHSCREEN,
+            AMOTION_EVENT_ACTION_MOVE, 0, 0, 0, 0, 0, 0, 1, 1,
+            0, milliseconds_to_nanoseconds(0), 1, pointerProperties, pointerCoords);
+    ASSERT_EQ(OK, status)
+            << "publisher publishMotionEvent should return OK";
+
+    for (int i = 1; i <= 2; i++) {
+        pointerCoords[0].setAxisValue(AMOTION_EVENT_AXIS_X, 10 * i);
+        status = mPublisher->appendMotionSample(milliseconds_to_nanoseconds(10 * i),
+                pointerCoords);
+        ASSERT_EQ(OK, status)
+                << "publisher appendMotionSample should return OK";
+    }
+
+    status = mPublisher->sendDispatchSignal();
+    ASSERT_EQ(OK, status)
+            << "publisher sendDispatchSignal should return OK";
+
+    status = mConsumer->receiveDispatchSignal();
+    ASSERT_EQ(OK, status)
+            << "consumer receiveDispatchSignal should return OK";
+
+    InputEvent* event;
+    status = mConsumer->consume(& mEventFactory, & event, frameTime);
+    ASSERT_EQ(OK, status)
+            << "consumer consume should return OK";
+    ASSERT_TRUE(event != NULL && event->getType() == AINPUT_EVENT_TYPE_MOTION)
+            << "consumer should have returned a motion event";
+
+    *outEvent = static_cast<MotionEvent*>(event);
+}
+
 TEST_F(InputPublisherAndConsumerTest, PublishKeyEvent_EndToEnd) {
     ASSERT_NO_FATAL_FAILURE(Initialize());
     ASSERT_NO_FATAL_FAILURE(PublishAndConsumeKeyEvent());
@@ -528,4 +583,50 @@ TEST_F(InputPublisherAndConsumerTest, AppendMotionSample_WhenBufferFull_ReturnsE
             << "publisher appendMotionSample should return NO_MEMORY persistently until reset";
 }
 
+TEST_F(InputPublisherAndConsumerTest, Consume_WithoutFrameTime_DoesNotResample) {
+    MotionEvent* motionEvent;
+    ASSERT_NO_FATAL_FAILURE(Initialize());
+    ASSERT_NO_FATAL_FAILURE(PublishAndConsumeMovingPointer(-1, &motionEvent));
+
+    EXPECT_EQ(2U, motionEvent->getHistorySize());
+    EXPECT_EQ(milliseconds_to_nanoseconds(20), motionEvent->getEventTime());
+    EXPECT_EQ(20, motionEvent->getX(0));
+}
+
+TEST_F(InputPublisherAndConsumerTest, Consume_WithFrameTime_AppendsPredictedSample) {
+    MotionEvent* motionEvent;
+    ASSERT_NO_FATAL_FAILURE(Initialize());
+    // Resampled for 5ms before the frame, so 4ms after the last sample.
+    ASSERT_NO_FATAL_FAILURE(PublishAndConsumeMovingPointer(
+            milliseconds_to_nanoseconds(29), &motionEvent));
+
+    ASSERT_EQ(3U, motionEvent->getHistorySize());
+    EXPECT_EQ(20, motionEvent->getHistoricalX(0, 2));
+    EXPECT_EQ(milliseconds_to_nanoseconds(24), motionEvent->getEventTime());
+    EXPECT_NEAR(24, motionEvent->getX(0), 0.01);
+    EXPECT_NEAR(50, motionEvent->getY(0), 0.01);
+    EXPECT_EQ(1, motionEvent->getPressure(0));
+}
+
+TEST_F(InputPublisherAndConsumerTest, Consume_WithDistantFrameTime_LimitsPrediction) {
+    MotionEvent* motionEvent;
+    ASSERT_NO_FATAL_FAILURE(Initialize());
+    ASSERT_NO_FATAL_FAILURE(PublishAndConsumeMovingPointer(
+            milliseconds_to_nanoseconds(100), &motionEvent));
+
+    ASSERT_EQ(3U, motionEvent->getHistorySize());
+    EXPECT_EQ(milliseconds_to_nanoseconds(28), motionEvent->getEventTime());
+    EXPECT_NEAR(28, motionEvent->getX(0), 0.01);
+}
+
+TEST_F(InputPublisherAndConsumerTest, Consume_WithPastFrameTime_DoesNotResample) {
+    MotionEvent* motionEvent;
+    ASSERT_NO_FATAL_FAILURE(Initialize());
+    ASSERT_NO_FATAL_FAILURE(PublishAndConsumeMovingPointer(
+            milliseconds_to_nanoseconds(22), &motionEvent));
+
+    EXPECT_EQ(2U, motionEvent->getHistorySize());
+    EXPECT_EQ(milliseconds_to_nanoseconds(20), motionEvent->getEventTime());
+}
+
 } // namespace android
@@ -0,0 +1,137 @@
+/*
+ * Copyright (C) 2011 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <ui/Rect.h>
+#include <ui/Region.h>
+#include <gtest/gtest.h>
+
+namespace android {
+
+class RegionTest : public testing::Test {
+protected:
+    virtual void SetUp() { }
+    virtual void TearDown() { }
+
+    static void checkRects(const Region& reg, const Rect* expected, size_t count) {
+        size_t n;
+        Rect const* rects = reg.getArray(&n);
+        ASSERT_EQ(count, n);
+        for (size_t i = 0; i < count; i++) {
+            EXPECT_EQ(expected[i], rects[i]) << "rect " << i;
+        }
+    }
+
+    // An L shape: a 100x50 band above a 50x50 square.
+    static Region lShape() {
+        Region reg(Rect(0, 0, 100, 50));
+        reg.orSelf(Rect(0, 50, 50, 100));
+        return reg;
+    }
+};
+
+TEST_F(RegionTest, IntersectingRectsGiveRect) {
+    Region reg(Rect(0, 0, 100, 100));
+    reg.andSelf(Rect(50, 50, 150, 150));
+    EXPECT_TRUE(reg.isRect());
+    EXPECT_EQ(Rect(50, 50, 100, 100), reg.getBounds());
+
+    reg.andSelf(Rect(200, 200, 300, 300));
+    EXPECT_TRUE(reg.isEmpty());
+}
+
+TEST_F(RegionTest, StackedRectsMergeIntoRect) {
+    Region reg(Rect(0, 0, 100, 50));
+    reg.orSelf(Rect(0, 50, 100, 100));
+    EXPECT_TRUE(reg.isRect());
+    EXPECT_EQ(Rect(0, 0, 100, 100), reg.getBounds());
+
+    reg.orSelf(Rect(100, 0, 120, 100));
+    EXPECT_TRUE(reg.isRect());
+    EXPECT_EQ(Rect(0, 0, 120, 100), reg.getBounds());
+}
+
+TEST_F(RegionTest, UnionBuildsSpans) {
+    const Region reg(lShape());
+    const Rect expected[] = { Rect(0, 0, 100, 50), Rect(0, 50, 50, 100) };
+    checkRects(reg, expected, 2);
+    EXPECT_EQ(Rect(0, 0, 100, 100), reg.getBounds());
+}
+
+TEST_F(RegionTest, UnionCoalescesIdenticalSpans) {
+    // Two columns, cut in three bands that all end up identical.
+    Region reg(Rect(0, 0, 10, 10));
+    reg.orSelf(Rect(20, 0, 30, 10));
+    reg.orSelf(Rect(0, 10, 10, 20));
+    reg.orSelf(Rect(20, 10, 30, 20));
+    const Rect expected[] = { Rect(0, 0, 10, 20), Rect(20, 0, 30, 20) };
+    checkRects(reg, expected, 2);
+}
+
+TEST_F(RegionTest, SubtractCoveringRectIsEmpty) {
+    Region reg(lShape());
+    reg.subtractSelf(Rect(-10, -10, 200, 200));
+    EXPECT_TRUE(reg.isEmpty());
+}
+
+TEST_F(RegionTest, SubtractDisjointLeavesRegion) {
+    Region reg(lShape());
+    reg.subtractSelf(Rect(200, 200, 300, 300));
+    const Rect expected[] = { Rect(0, 0, 100, 50), Rect(0, 50, 50, 100) };
+    checkRects(reg, expected, 2);
+}
+
+TEST_F(RegionTest, SubtractHole) {
+    Region reg(Rect(0, 0, 30, 30));
+    reg.subtractSelf(Rect(10, 10, 20, 20));
+    const Rect expected[] = {
+        Rect(0, 0, 30, 10),
+        Rect(0, 10, 10, 20), Rect(20, 10, 30, 20),
+        Rect(0, 20, 30, 30)
+    };
+    checkRects(reg, expected, 4);
+    EXPECT_EQ(Rect(0, 0, 30, 30), reg.getBounds());
+}
+
+TEST_F(RegionTest, IntersectWithCoveringRectKeepsRegion) {
+    const Region reg(lShape().intersect(Rect(0, 0, 100, 100)));
+    const Rect expected[] = { Rect(0, 0, 100, 50), Rect(0, 50, 50, 100) };
+    checkRects(reg, expected, 2);
+}
+
+TEST_F(RegionTest, RectIntersectWithContainedRegion) {
+    const Region reg(Region(Rect(-10, -10, 200, 200)).intersect(lShape(), 10, 10));
+    const Rect expected[] = { Rect(10, 10, 110, 60), Rect(10, 60, 60, 110) };
+    checkRects(reg, expected, 2);
+}
+
+TEST_F(RegionTest, UnionWithEmptyRegion) {
+    const Region empty;
+    const Region reg(empty.merge(lShape(), 5, 0));
+    const Rect expected[] = { Rect(5, 0, 105, 50), Rect(5, 50, 55, 100) };
+    checkRects(reg, expected, 2);
+    EXPECT_EQ(Rect(5, 0, 105, 100), reg.getBounds());
+
+    EXPECT_TRUE(empty.merge(empty).isEmpty());
+}
+
+TEST_F(RegionTest, UnionWithSelf) {
+    Region reg(lShape());
+    reg.orSelf(reg);
+    const Rect expected[] = { Rect(0, 0, 100, 50), Rect(0, 50, 50, 100) };
+    checkRects(reg, expected, 2);
+}
+
+} // namespace android
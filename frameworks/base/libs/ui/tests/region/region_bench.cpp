@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2011 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "RegionBench"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <utils/Timers.h>
+#include <ui/Rect.h>
+#include <ui/Region.h>
+
+using namespace android;
+
+static const int LOOPS = 100000;
+
+// A typical set of windows: status bar, a full-screen app, a dialog and
+// a few small overlapping popups.
+static const Rect sWindows[] = {
+    Rect(  0,   0, 480,  38),
+    Rect(  0,  38, 480, 800),
+    Rect( 40, 200, 440, 600),
+    Rect(100, 250, 300, 330),
+    Rect(250, 300, 420, 380),
+    Rect( 60, 520, 200, 580),
+};
+static const size_t NUM_WINDOWS = sizeof(sWindows) / sizeof(sWindows[0]);
+
+static void report(const char* name, nsecs_t start, int checksum)
+{
+    nsecs_t elapsed = systemTime() - start;
+    printf("%-28s %8.1f ns/iteration (%d)\n", name,
+            double(elapsed) / LOOPS, checksum);
+}
+
+int main()
+{
+    int checksum;
+    nsecs_t start;
+
+    // what SurfaceFlinger does for opaque windows: accumulate the covered
+    // region and subtract it from each window below
+    checksum = 0;
+    start = systemTime();
+    for (int i = 0; i < LOOPS; i++) {
+        Region above;
+        for (ssize_t j = NUM_WINDOWS - 1; j >= 0; j--) {
+            Region visible(sWindows[j]);
+            visible.subtractSelf(above);
+            above.orSelf(sWindows[j]);
+            checksum += visible.isEmpty();
+        }
+    }
+    report("visible regions", start, checksum);
+
+    // rectangle intersections, e.g. clipping dirty rects to the screen
+    checksum = 0;
+    start = systemTime();
+    const Rect screen(480, 800);
+    for (int i = 0; i < LOOPS; i++) {
+        for (size_t j = 0; j < NUM_WINDOWS; j++) {
+            Region dirty(sWindows[j]);
+            dirty.andSelf(screen);
+            checksum += dirty.isRect();
+        }
+    }
+    report("rect intersect", start, checksum);
+
+    // unions of non-trivial regions, e.g. accumulating dirty regions
+    checksum = 0;
+    start = systemTime();
+    for (int i = 0; i < LOOPS; i++) {
+        Region dirty;
+        for (size_t j = 3; j < NUM_WINDOWS; j++) {
+            dirty.orSelf(sWindows[j]);
+        }
+        size_t count;
+        dirty.getArray(&count);
+        checksum += count;
+    }
+    report("region union", start, checksum);
+
+    return 0;
+}
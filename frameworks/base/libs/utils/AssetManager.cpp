@@ -651,6 +651,12 @@ const ResTable* AssetManager::getResTable(bool required) const
                     LOGV("Creating shared resources for %s", ap.path.string());
                     sharedRes = new ResTable();
                     sharedRes->add(ass, (void*)(i+1), false, idmap);
+#ifdef HAVE_ANDROID_OS
+                    // This table is normally built in the zygote and then
+                    // shared by every app.  Decode its strings now so that
+                    // the children don't each decode (and dirty) their own.
+                    sharedRes->cacheAllStrings();
+#endif
                     sharedRes = const_cast<AssetManager*>(this)->
                         mZipSet.setZipResourceTable(ap.path, sharedRes);
                 }
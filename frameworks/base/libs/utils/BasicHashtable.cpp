@@ -0,0 +1,310 @@
+/*
+ * Copyright (C) 2011 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "BasicHashtable"
+
+#include <string.h>
+
+#include <utils/Log.h>
+#include <utils/BasicHashtable.h>
+
+namespace android {
+
+static const size_t kMinBucketCount = 4;
+
+static inline size_t roundUp(size_t value, size_t alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+BasicHashtableImpl::BasicHashtableImpl(size_t entrySize, size_t entryAlignment,
+        uint32_t flags, size_t minimumInitialCapacity, float loadFactor) :
+        mEntryOffset(entryAlignment > sizeof(Bucket) ? entryAlignment : sizeof(Bucket)),
+        mBucketSize(roundUp(mEntryOffset + entrySize, mEntryOffset)),
+        mFlags(flags), mBuckets(NULL), mSize(0), mFilledBuckets(0),
+        mLoadFactor(loadFactor) {
+    determineCapacity(minimumInitialCapacity, loadFactor, &mBucketCount, &mCapacity);
+}
+
+BasicHashtableImpl::BasicHashtableImpl(const BasicHashtableImpl& other) :
+        mEntryOffset(other.mEntryOffset), mBucketSize(other.mBucketSize),
+        mFlags(other.mFlags), mBuckets(other.mBuckets), mSize(other.mSize),
+        mFilledBuckets(other.mFilledBuckets), mCapacity(other.mCapacity),
+        mBucketCount(other.mBucketCount), mLoadFactor(other.mLoadFactor) {
+    if (mBuckets) {
+        SharedBuffer::bufferFromData(mBuckets)->acquire();
+    }
+}
+
+BasicHashtableImpl::~BasicHashtableImpl()
+{
+    // entries are destroyed by dispose(), called from the subclass destructor
+    // while the virtual destroyBucketEntry() is still reachable
+}
+
+void BasicHashtableImpl::dispose() {
+    if (mBuckets) {
+        releaseBuckets(mBuckets, mBucketCount);
+        mBuckets = NULL;
+    }
+}
+
+void BasicHashtableImpl::clone() {
+    if (mBuckets) {
+        void* newBuckets = allocateBuckets(mBucketCount);
+        copyBuckets(mBuckets, newBuckets, mBucketCount);
+        releaseBuckets(mBuckets, mBucketCount);
+        mBuckets = newBuckets;
+    }
+}
+
+void BasicHashtableImpl::edit() {
+    if (mBuckets && !SharedBuffer::bufferFromData(mBuckets)->onlyOwner()) {
+        clone();
+    }
+}
+
+void BasicHashtableImpl::setTo(const BasicHashtableImpl& other) {
+    if (other.mBuckets) {
+        SharedBuffer::bufferFromData(other.mBuckets)->acquire();
+    }
+    if (mBuckets) {
+        releaseBuckets(mBuckets, mBucketCount);
+    }
+
+    mBuckets = other.mBuckets;
+    mSize = other.mSize;
+    mFilledBuckets = other.mFilledBuckets;
+    mCapacity = other.mCapacity;
+    mBucketCount = other.mBucketCount;
+    mLoadFactor = other.mLoadFactor;
+}
+
+void BasicHashtableImpl::clear() {
+    if (mBuckets) {
+        if (mFilledBuckets) {
+            SharedBuffer* sb = SharedBuffer::bufferFromData(mBuckets);
+            if (sb->onlyOwner()) {
+                destroyBuckets(mBuckets, mBucketCount);
+                for (size_t i = 0; i < mBucketCount; i++) {
+                    bucketAt(mBuckets, i).cookie = 0;
+                }
+            } else {
+                releaseBuckets(mBuckets, mBucketCount);
+                mBuckets = NULL;
+            }
+            mFilledBuckets = 0;
+        }
+        mSize = 0;
+    }
+}
+
+ssize_t BasicHashtableImpl::next(ssize_t index) const {
+    if (mSize) {
+        while (size_t(++index) < mBucketCount) {
+            const Bucket& bucket = bucketAt(mBuckets, index);
+            if (bucket.cookie & Bucket::PRESENT) {
+                return index;
+            }
+        }
+    }
+    return -1;
+}
+
+ssize_t BasicHashtableImpl::find(ssize_t index, hash_t hash,
+        const void* __restrict__ key) const {
+    if (!mSize) {
+        return -1;
+    }
+
+    hash = trimHash(hash);
+    size_t probe = index < 0 ? chainStart(hash) : chainIncrement(index);
+    // The load factor guarantees at least one empty bucket, which ends
+    // every probe sequence.
+    for (;;) {
+        const Bucket& bucket = bucketAt(mBuckets, probe);
+        if (!bucket.cookie) {
+            return -1;
+        }
+        if ((bucket.cookie & Bucket::PRESENT)
+                && (bucket.cookie & Bucket::HASH_MASK) == hash
+                && compareBucketKey(bucket, key)) {
+            return probe;
+        }
+        probe = chainIncrement(probe);
+    }
+}
+
+size_t BasicHashtableImpl::add(hash_t hash, const void* entry) {
+    if (mFilledBuckets >= mCapacity) {
+        // Grow when the table is mostly live entries, otherwise rehashing
+        // at the same size is enough to reclaim the tombstones.
+        rehash(mSize > mCapacity / 2 ? mCapacity * 2 : mCapacity, mLoadFactor);
+    }
+
+    if (!mBuckets) {
+        mBuckets = allocateBuckets(mBucketCount);
+    } else {
+        edit();
+    }
+
+    hash = trimHash(hash);
+    size_t index = chainStart(hash);
+    for (;;) {
+        Bucket& bucket = bucketAt(mBuckets, index);
+        if (!(bucket.cookie & Bucket::PRESENT)) {
+            if (!(bucket.cookie & Bucket::DELETED)) {
+                mFilledBuckets += 1;
+            }
+            initializeBucketEntry(bucket, entry);
+            bucket.cookie = Bucket::PRESENT | hash;
+            break;
+        }
+        index = chainIncrement(index);
+    }
+    mSize += 1;
+    return index;
+}
+
+void BasicHashtableImpl::removeAt(size_t index) {
+    edit();
+
+    Bucket& bucket = bucketAt(mBuckets, index);
+    destroyBucketEntry(bucket);
+    mSize -= 1;
+
+    // A bucket followed by an empty one ends no other probe sequence, so it
+    // can be emptied rather than left as a tombstone.
+    if (!bucketAt(mBuckets, chainIncrement(index)).cookie) {
+        bucket.cookie = 0;
+        mFilledBuckets -= 1;
+    } else {
+        bucket.cookie = Bucket::DELETED;
+    }
+}
+
+void BasicHashtableImpl::rehash(size_t minimumCapacity, float loadFactor) {
+    if (minimumCapacity < mSize) {
+        minimumCapacity = mSize;
+    }
+    size_t newBucketCount, newCapacity;
+    determineCapacity(minimumCapacity, loadFactor, &newBucketCount, &newCapacity);
+
+    if (newBucketCount != mBucketCount || mFilledBuckets != mSize) {
+        if (mBuckets) {
+            void* newBuckets;
+            if (mSize) {
+                newBuckets = allocateBuckets(newBucketCount);
+                const size_t mask = newBucketCount - 1;
+                for (size_t i = 0; i < mBucketCount; i++) {
+                    const Bucket& fromBucket = bucketAt(mBuckets, i);
+                    if (fromBucket.cookie & Bucket::PRESENT) {
+                        size_t index = (fromBucket.cookie & Bucket::HASH_MASK) & mask;
+                        while (bucketAt(newBuckets, index).cookie) {
+                            index = (index + 1) & mask;
+                        }
+                        Bucket& toBucket = bucketAt(newBuckets, index);
+                        if (mFlags & HAS_TRIVIAL_COPY) {
+                            memcpy(entryLocation(toBucket), entryLocation(fromBucket),
+                                    mBucketSize - mEntryOffset);
+                        } else {
+                            initializeBucketEntry(toBucket, entryLocation(fromBucket));
+                        }
+                        toBucket.cookie = fromBucket.cookie;
+                    }
+                }
+            } else {
+                newBuckets = NULL;
+            }
+            releaseBuckets(mBuckets, mBucketCount);
+            mBuckets = newBuckets;
+            mFilledBuckets = mSize;
+        }
+        mBucketCount = newBucketCount;
+    }
+    mCapacity = newCapacity;
+    mLoadFactor = loadFactor;
+}
+
+void* BasicHashtableImpl::allocateBuckets(size_t count) const {
+    SharedBuffer* sb = SharedBuffer::alloc(count * mBucketSize);
+    LOG_ALWAYS_FATAL_IF(!sb, "Could not allocate %u bytes for %u buckets.",
+            count * mBucketSize, count);
+
+    void* buckets = sb->data();
+    for (size_t i = 0; i < count; i++) {
+        bucketAt(buckets, i).cookie = 0;
+    }
+    return buckets;
+}
+
+void BasicHashtableImpl::releaseBuckets(void* __restrict__ buckets, size_t count) const {
+    SharedBuffer* sb = SharedBuffer::bufferFromData(buckets);
+    if (sb->release(SharedBuffer::eKeepStorage) == 1) {
+        destroyBuckets(buckets, count);
+        SharedBuffer::dealloc(sb);
+    }
+}
+
+void BasicHashtableImpl::destroyBuckets(void* __restrict__ buckets, size_t count) const {
+    if (!(mFlags & HAS_TRIVIAL_DTOR)) {
+        for (size_t i = 0; i < count; i++) {
+            Bucket& bucket = bucketAt(buckets, i);
+            if (bucket.cookie & Bucket::PRESENT) {
+                destroyBucketEntry(bucket);
+            }
+        }
+    }
+}
+
+void BasicHashtableImpl::copyBuckets(const void* __restrict__ fromBuckets,
+        void* __restrict__ toBuckets, size_t count) const {
+    if (mFlags & HAS_TRIVIAL_COPY) {
+        memcpy(toBuckets, fromBuckets, count * mBucketSize);
+    } else {
+        for (size_t i = 0; i < count; i++) {
+            const Bucket& fromBucket = bucketAt(fromBuckets, i);
+            Bucket& toBucket = bucketAt(toBuckets, i);
+            toBucket.cookie = fromBucket.cookie;
+            if (fromBucket.cookie & Bucket::PRESENT) {
+                initializeBucketEntry(toBucket, entryLocation(fromBucket));
+            }
+        }
+    }
+}
+
+void BasicHashtableImpl::determineCapacity(size_t minimumCapacity, float loadFactor,
+        size_t* __restrict__ outBucketCount, size_t* __restrict__ outCapacity) {
+    LOG_ALWAYS_FATAL_IF(loadFactor < 0.1f || loadFactor > 0.9f,
+            "Invalid load factor %0.3f.  Must be in the range [0.1, 0.9].", loadFactor);
+
+    // The load factor is below 1, so the capacity always leaves at least one
+    // empty bucket to terminate probing.
+    size_t bucketCount = kMinBucketCount;
+    size_t capacity = size_t(bucketCount * loadFactor);
+    while (capacity < minimumCapacity) {
+        bucketCount <<= 1;
+        LOG_ALWAYS_FATAL_IF(!bucketCount, "Could not determine capacity for %u entries.",
+                minimumCapacity);
+        capacity = size_t(bucketCount * loadFactor);
+    }
+    if (capacity < 1) {
+        capacity = 1;
+    }
+    *outBucketCount = bucketCount;
+    *outCapacity = capacity;
+}
+
+}; // namespace android
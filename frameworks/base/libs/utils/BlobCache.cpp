@@ -21,24 +21,31 @@
 #include <string.h>
 
 #include <utils/BlobCache.h>
+#include <utils/Errors.h>
 #include <utils/Log.h>
+#include <utils/Vector.h>
 
 namespace android {
 
+// BlobCache::Header::mMagicNumber value
+static const uint32_t blobCacheMagic = 'Blb$';
+
+// BlobCache::Header::mBlobCacheVersion value
+static const uint32_t blobCacheVersion = 1;
+
+// BlobCache::Header::mDeviceVersion value
+static const uint32_t blobCacheDeviceVersion = 1;
+
+static inline size_t align4(size_t size) {
+    return (size + 3) & ~3;
+}
+
 BlobCache::BlobCache(size_t maxKeySize, size_t maxValueSize, size_t maxTotalSize):
         mMaxKeySize(maxKeySize),
         mMaxValueSize(maxValueSize),
         mMaxTotalSize(maxTotalSize),
-        mTotalSize(0) {
-    nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
-#ifdef _WIN32
-    srand(now);
-#else
-    mRandState[0] = (now >> 0) & 0xFFFF;
-    mRandState[1] = (now >> 16) & 0xFFFF;
-    mRandState[2] = (now >> 32) & 0xFFFF;
-#endif
-    LOGV("initializing random seed using %lld", now);
+        mTotalSize(0),
+        mAccessClock(0) {
 }
 
 void BlobCache::set(const void* key, size_t keySize, const void* value,
@@ -68,12 +75,10 @@ void BlobCache::set(const void* key, size_t keySize, const void* value,
     }
 
     Mutex::Autolock lock(mMutex);
-    sp<Blob> dummyKey(new Blob(key, keySize, false));
-    CacheEntry dummyEntry(dummyKey, NULL);
 
     while (true) {
 
-        ssize_t index = mCacheEntries.indexOf(dummyEntry);
+        ssize_t index = findEntry(key, keySize);
         if (index < 0) {
             // Create a new cache entry.
             sp<Blob> keyBlob(new Blob(key, keySize, true));
@@ -92,7 +97,7 @@ void BlobCache::set(const void* key, size_t keySize, const void* value,
                     break;
                 }
             }
-            mCacheEntries.add(CacheEntry(keyBlob, valueBlob));
+            mCacheEntries.add(CacheEntry(keyBlob, valueBlob, ++mAccessClock));
             mTotalSize = newTotalSize;
             LOGV("set: created new cache entry with %d byte key and %d byte value",
                     keySize, valueSize);
@@ -114,6 +119,7 @@ void BlobCache::set(const void* key, size_t keySize, const void* value,
                 }
             }
             mCacheEntries.editItemAt(index).setValue(valueBlob);
+            touch(index);
             mTotalSize = newTotalSize;
             LOGV("set: updated existing cache entry with %d byte key and %d byte "
                     "value", keySize, valueSize);
@@ -130,13 +136,12 @@ size_t BlobCache::get(const void* key, size_t keySize, void* value,
         return 0;
     }
     Mutex::Autolock lock(mMutex);
-    sp<Blob> dummyKey(new Blob(key, keySize, false));
-    CacheEntry dummyEntry(dummyKey, NULL);
-    ssize_t index = mCacheEntries.indexOf(dummyEntry);
+    ssize_t index = findEntry(key, keySize);
     if (index < 0) {
         LOGV("get: no cache entry found for key of size %d", keySize);
         return 0;
     }
+    touch(index);
 
     // The key was found. Return the value if the caller's buffer is large
     // enough.
@@ -152,22 +157,60 @@ size_t BlobCache::get(const void* key, size_t keySize, void* value,
     return valueBlobSize;
 }
 
-long int BlobCache::blob_random() {
-#ifdef _WIN32
-    return rand();
-#else
-    return nrand48(mRandState);
-#endif
+ssize_t BlobCache::findEntry(const void* key, size_t keySize) const {
+    sp<Blob> dummyKey(new Blob(key, keySize, false));
+    CacheEntry dummyEntry(dummyKey, NULL, 0);
+    return mCacheEntries.indexOf(dummyEntry);
+}
+
+void BlobCache::touch(size_t index) {
+    // The access stamp doesn't take part in the ordering, so this doesn't
+    // move the entry.
+    mCacheEntries.editItemAt(index).setLastAccess(++mAccessClock);
+}
+
+namespace {
+struct StampedSize {
+    uint32_t lastAccess;
+    size_t size;
+};
+}
+
+static int compareLastAccess(const void* lhs, const void* rhs) {
+    uint32_t l = static_cast<const StampedSize*>(lhs)->lastAccess;
+    uint32_t r = static_cast<const StampedSize*>(rhs)->lastAccess;
+    return l < r ? -1 : (l > r ? 1 : 0);
 }
 
 void BlobCache::clean() {
-    // Remove a random cache entry until the total cache size gets below half
-    // the maximum total cache size.
-    while (mTotalSize > mMaxTotalSize / 2) {
-        size_t i = size_t(blob_random() % (mCacheEntries.size()));
+    // Find the access stamp up to which the least recently used entries have
+    // to go for the total cache size to get below half the maximum total
+    // cache size, then remove them in a single pass.
+    const size_t count = mCacheEntries.size();
+    Vector<StampedSize> stamps;
+    stamps.setCapacity(count);
+    for (size_t i = 0; i < count; i++) {
         const CacheEntry& entry(mCacheEntries[i]);
-        mTotalSize -= entry.getKey()->getSize() + entry.getValue()->getSize();
-        mCacheEntries.removeAt(i);
+        StampedSize stamp;
+        stamp.lastAccess = entry.getLastAccess();
+        stamp.size = entry.getKey()->getSize() + entry.getValue()->getSize();
+        stamps.add(stamp);
+    }
+    qsort(stamps.editArray(), count, sizeof(StampedSize), compareLastAccess);
+
+    size_t remaining = mTotalSize;
+    uint32_t cutoff = 0;
+    for (size_t i = 0; i < count && remaining > mMaxTotalSize / 2; i++) {
+        cutoff = stamps[i].lastAccess;
+        remaining -= stamps[i].size;
+    }
+
+    for (size_t i = count; i > 0; i--) {
+        const CacheEntry& entry(mCacheEntries[i - 1]);
+        if (entry.getLastAccess() <= cutoff) {
+            mTotalSize -= entry.getKey()->getSize() + entry.getValue()->getSize();
+            mCacheEntries.removeAt(i - 1);
+        }
     }
 }
 
@@ -175,6 +218,150 @@ bool BlobCache::isCleanable() const {
     return mTotalSize > mMaxTotalSize / 2;
 }
 
+size_t BlobCache::getFlattenedSize() const {
+    Mutex::Autolock lock(mMutex);
+    size_t size = sizeof(Header);
+    for (size_t i = 0; i < mCacheEntries.size(); i++) {
+        const CacheEntry& e(mCacheEntries[i]);
+        sp<Blob> keyBlob = e.getKey();
+        sp<Blob> valueBlob = e.getValue();
+        size = align4(size);
+        size += sizeof(EntryHeader) + keyBlob->getSize() +
+                valueBlob->getSize();
+    }
+    return size;
+}
+
+size_t BlobCache::getFdCount() const {
+    return 0;
+}
+
+status_t BlobCache::flatten(void* buffer, size_t size, int fds[], size_t count)
+        const {
+    if (count != 0) {
+        LOGE("flatten: nonzero fd count: %d", count);
+        return BAD_VALUE;
+    }
+
+    Mutex::Autolock lock(mMutex);
+
+    // Write the cache header
+    if (size < sizeof(Header)) {
+        LOGE("flatten: not enough room for cache header");
+        return BAD_VALUE;
+    }
+    Header* header = reinterpret_cast<Header*>(buffer);
+    header->mMagicNumber = blobCacheMagic;
+    header->mBlobCacheVersion = blobCacheVersion;
+    header->mDeviceVersion = blobCacheDeviceVersion;
+    header->mNumEntries = mCacheEntries.size();
+
+    // Write cache entries
+    uint8_t* byteBuffer = reinterpret_cast<uint8_t*>(buffer);
+    off_t byteOffset = align4(sizeof(Header));
+    for (size_t i = 0; i < mCacheEntries.size(); i++) {
+        const CacheEntry& e(mCacheEntries[i]);
+        sp<Blob> keyBlob = e.getKey();
+        sp<Blob> valueBlob = e.getValue();
+        size_t keySize = keyBlob->getSize();
+        size_t valueSize = valueBlob->getSize();
+
+        size_t entrySize = sizeof(EntryHeader) + keySize + valueSize;
+        if (byteOffset + entrySize > size) {
+            LOGE("flatten: not enough room for cache entries");
+            return BAD_VALUE;
+        }
+
+        EntryHeader* eheader = reinterpret_cast<EntryHeader*>(
+            &byteBuffer[byteOffset]);
+        eheader->mKeySize = keySize;
+        eheader->mValueSize = valueSize;
+        eheader->mLastAccess = e.getLastAccess();
+
+        memcpy(eheader->mData, keyBlob->getData(), keySize);
+        memcpy(eheader->mData + keySize, valueBlob->getData(), valueSize);
+
+        byteOffset += align4(entrySize);
+    }
+
+    return OK;
+}
+
+status_t BlobCache::unflatten(void const* buffer, size_t size, int fds[],
+        size_t count) {
+    // All errors should result in the BlobCache being in an empty state.
+    Mutex::Autolock lock(mMutex);
+    mCacheEntries.clear();
+    mTotalSize = 0;
+    mAccessClock = 0;
+
+    if (count != 0) {
+        LOGE("unflatten: nonzero fd count: %d", count);
+        return BAD_VALUE;
+    }
+
+    // Read the cache header
+    if (size < sizeof(Header)) {
+        LOGE("unflatten: not enough room for cache header");
+        return BAD_VALUE;
+    }
+    const Header* header = reinterpret_cast<const Header*>(buffer);
+    if (header->mMagicNumber != blobCacheMagic) {
+        LOGE("unflatten: bad magic number: %d", header->mMagicNumber);
+        return BAD_VALUE;
+    }
+    if (header->mBlobCacheVersion != blobCacheVersion ||
+            header->mDeviceVersion != blobCacheDeviceVersion) {
+        // We treat version mismatches as an empty cache.
+        return OK;
+    }
+
+    // Read cache entries
+    const uint8_t* byteBuffer = reinterpret_cast<const uint8_t*>(buffer);
+    off_t byteOffset = align4(sizeof(Header));
+    size_t numEntries = header->mNumEntries;
+    for (size_t i = 0; i < numEntries; i++) {
+        if (byteOffset + sizeof(EntryHeader) > size) {
+            mCacheEntries.clear();
+            mTotalSize = 0;
+            mAccessClock = 0;
+            LOGE("unflatten: not enough room for cache entry headers");
+            return BAD_VALUE;
+        }
+
+        const EntryHeader* eheader = reinterpret_cast<const EntryHeader*>(
+                &byteBuffer[byteOffset]);
+        size_t keySize = eheader->mKeySize;
+        size_t valueSize = eheader->mValueSize;
+        size_t entrySize = sizeof(EntryHeader) + keySize + valueSize;
+
+        if (keySize > size || valueSize > size || byteOffset + entrySize > size) {
+            mCacheEntries.clear();
+            mTotalSize = 0;
+            mAccessClock = 0;
+            LOGE("unflatten: not enough room for cache entry");
+            return BAD_VALUE;
+        }
+
+        const uint8_t* data = eheader->mData;
+        if (keySize <= mMaxKeySize && valueSize <= mMaxValueSize &&
+                mTotalSize + keySize + valueSize <= mMaxTotalSize &&
+                keySize > 0 && valueSize > 0) {
+            sp<Blob> keyBlob(new Blob(data, keySize, true));
+            sp<Blob> valueBlob(new Blob(data + keySize, valueSize, true));
+            mCacheEntries.add(CacheEntry(keyBlob, valueBlob, eheader->mLastAccess));
+            mTotalSize += keySize + valueSize;
+            if (eheader->mLastAccess > mAccessClock) {
+                mAccessClock = eheader->mLastAccess;
+            }
+        }
+
+        byteOffset += align4(entrySize);
+    }
+
+    return OK;
+}
+
 BlobCache::Blob::Blob(const void* data, size_t size, bool copyData):
         mData(copyData ? malloc(size) : data),
         mSize(size),
@@ -206,17 +393,21 @@ size_t BlobCache::Blob::getSize() const {
     return mSize;
 }
 
-BlobCache::CacheEntry::CacheEntry() {
+BlobCache::CacheEntry::CacheEntry():
+        mLastAccess(0) {
 }
 
-BlobCache::CacheEntry::CacheEntry(const sp<Blob>& key, const sp<Blob>& value):
+BlobCache::CacheEntry::CacheEntry(const sp<Blob>& key, const sp<Blob>& value,
+        uint32_t lastAccess):
         mKey(key),
-        mValue(value) {
+        mValue(value),
+        mLastAccess(lastAccess) {
 }
 
 BlobCache::CacheEntry::CacheEntry(const CacheEntry& ce):
         mKey(ce.mKey),
-        mValue(ce.mValue) {
+        mValue(ce.mValue),
+        mLastAccess(ce.mLastAccess) {
 }
 
 bool BlobCache::CacheEntry::operator<(const CacheEntry& rhs) const {
@@ -226,6 +417,7 @@ bool BlobCache::CacheEntry::operator<(const CacheEntry& rhs) const {
 const BlobCache::CacheEntry& BlobCache::CacheEntry::operator=(const CacheEntry& rhs) {
     mKey = rhs.mKey;
     mValue = rhs.mValue;
+    mLastAccess = rhs.mLastAccess;
     return *this;
 }
 
@@ -237,8 +429,16 @@ sp<BlobCache::Blob> BlobCache::CacheEntry::getValue() const {
     return mValue;
 }
 
+uint32_t BlobCache::CacheEntry::getLastAccess() const {
+    return mLastAccess;
+}
+
 void BlobCache::CacheEntry::setValue(const sp<Blob>& value) {
     mValue = value;
 }
 
+void BlobCache::CacheEntry::setLastAccess(uint32_t lastAccess) {
+    mLastAccess = lastAccess;
+}
+
 } // namespace android
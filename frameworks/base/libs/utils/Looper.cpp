@@ -20,6 +20,8 @@
 #include <unistd.h>
 #include <fcntl.h>
 #include <limits.h>
+#include <stdlib.h>
+#include <sys/eventfd.h>
 
 
 namespace android {
@@ -44,52 +46,51 @@ void WeakMessageHandler::handleMessage(const Message& message) {
 // Hint for number of file descriptors to be associated with the epoll instance.
 static const int EPOLL_SIZE_HINT = 8;
 
-// Maximum number of file descriptors for which to retrieve poll events each iteration.
-static const int EPOLL_MAX_EVENTS = 16;
+// Initial and maximum number of file descriptors for which to retrieve poll events
+// each iteration.  The buffer grows whenever a poll fills it so that a busy looper
+// handles all of its ready file descriptors in a single iteration.
+static const int EPOLL_MIN_EVENTS = 16;
+static const int EPOLL_MAX_EVENTS = 256;
 #endif
 
 static pthread_once_t gTLSOnce = PTHREAD_ONCE_INIT;
 static pthread_key_t gTLSKey = 0;
 
 Looper::Looper(bool allowNonCallbacks) :
-        mAllowNonCallbacks(allowNonCallbacks), mSendingMessage(false),
+        mAllowNonCallbacks(allowNonCallbacks), mNextMessageSequence(0), mSendingMessage(false),
+        mStatisticsEnabled(false), mStatisticsStartTime(0), mMaxMessageQueueDepth(0),
         mResponseIndex(0), mNextMessageUptime(LLONG_MAX) {
-    int wakeFds[2];
-    int result = pipe(wakeFds);
-    LOG_ALWAYS_FATAL_IF(result != 0, "Could not create wake pipe.  errno=%d", errno);
-
-    mWakeReadPipeFd = wakeFds[0];
-    mWakeWritePipeFd = wakeFds[1];
-
-    result = fcntl(mWakeReadPipeFd, F_SETFL, O_NONBLOCK);
-    LOG_ALWAYS_FATAL_IF(result != 0, "Could not make wake read pipe non-blocking.  errno=%d",
-            errno);
-
-    result = fcntl(mWakeWritePipeFd, F_SETFL, O_NONBLOCK);
-    LOG_ALWAYS_FATAL_IF(result != 0, "Could not make wake write pipe non-blocking.  errno=%d",
-            errno);
+    // An eventfd is a single counter so, unlike a pipe, repeated wakes can
+    // never fill it up and awoken() drains it with one read.
+    mWakeEventFd = eventfd(0, EFD_NONBLOCK);
+    LOG_ALWAYS_FATAL_IF(mWakeEventFd < 0, "Could not create wake event fd.  errno=%d", errno);
 
 #ifdef LOOPER_USES_EPOLL
-    // Allocate the epoll instance and register the wake pipe.
+    mEventItemCapacity = EPOLL_MIN_EVENTS;
+    mEventItems = static_cast<struct epoll_event*>(
+            malloc(mEventItemCapacity * sizeof(struct epoll_event)));
+    LOG_ALWAYS_FATAL_IF(mEventItems == NULL, "Could not allocate epoll event buffer.");
+
+    // Allocate the epoll instance and register the wake event fd.
     mEpollFd = epoll_create(EPOLL_SIZE_HINT);
     LOG_ALWAYS_FATAL_IF(mEpollFd < 0, "Could not create epoll instance.  errno=%d", errno);
 
     struct epoll_event eventItem;
     memset(& eventItem, 0, sizeof(epoll_event)); // zero out unused members of data field union
     eventItem.events = EPOLLIN;
-    eventItem.data.fd = mWakeReadPipeFd;
-    result = epoll_ctl(mEpollFd, EPOLL_CTL_ADD, mWakeReadPipeFd, & eventItem);
-    LOG_ALWAYS_FATAL_IF(result != 0, "Could not add wake read pipe to epoll instance.  errno=%d",
+    eventItem.data.fd = mWakeEventFd;
+    int result = epoll_ctl(mEpollFd, EPOLL_CTL_ADD, mWakeEventFd, & eventItem);
+    LOG_ALWAYS_FATAL_IF(result != 0, "Could not add wake event fd to epoll instance.  errno=%d",
             errno);
 #else
-    // Add the wake pipe to the head of the request list with a null callback.
+    // Add the wake event fd to the head of the request list with a null callback.
     struct pollfd requestedFd;
-    requestedFd.fd = mWakeReadPipeFd;
+    requestedFd.fd = mWakeEventFd;
     requestedFd.events = POLLIN;
     mRequestedFds.push(requestedFd);
 
     Request request;
-    request.fd = mWakeReadPipeFd;
+    request.fd = mWakeEventFd;
     request.callback = NULL;
     request.ident = 0;
     request.data = NULL;
@@ -115,10 +116,10 @@ Looper::Looper(bool allowNonCallbacks) :
 }
 
 Looper::~Looper() {
-    close(mWakeReadPipeFd);
-    close(mWakeWritePipeFd);
+    close(mWakeEventFd);
 #ifdef LOOPER_USES_EPOLL
     close(mEpollFd);
+    free(mEventItems);
 #endif
 }
 
@@ -239,8 +240,8 @@ int Looper::pollInner(int timeoutMillis) {
 #endif
 
 #ifdef LOOPER_USES_EPOLL
-    struct epoll_event eventItems[EPOLL_MAX_EVENTS];
-    int eventCount = epoll_wait(mEpollFd, eventItems, EPOLL_MAX_EVENTS, timeoutMillis);
+    struct epoll_event* eventItems = mEventItems;
+    int eventCount = epoll_wait(mEpollFd, eventItems, mEventItemCapacity, timeoutMillis);
 #else
     // Wait for wakeAndLock() waiters to run then set mPolling to true.
     mLock.lock();
@@ -282,14 +283,27 @@ int Looper::pollInner(int timeoutMillis) {
 #endif
 
 #ifdef LOOPER_USES_EPOLL
+    // A full buffer means more file descriptors may have been ready, so make room
+    // for them in the next iteration.  The events already retrieved are still valid.
+    if (eventCount == mEventItemCapacity && mEventItemCapacity < EPOLL_MAX_EVENTS) {
+        struct epoll_event* newEventItems = static_cast<struct epoll_event*>(
+                malloc(mEventItemCapacity * 2 * sizeof(struct epoll_event)));
+        if (newEventItems != NULL) {
+            memcpy(newEventItems, eventItems, eventCount * sizeof(struct epoll_event));
+            free(mEventItems);
+            mEventItems = eventItems = newEventItems;
+            mEventItemCapacity *= 2;
+        }
+    }
+
     for (int i = 0; i < eventCount; i++) {
         int fd = eventItems[i].data.fd;
         uint32_t epollEvents = eventItems[i].events;
-        if (fd == mWakeReadPipeFd) {
+        if (fd == mWakeEventFd) {
             if (epollEvents & EPOLLIN) {
                 awoken();
             } else {
-                LOGW("Ignoring unexpected epoll events 0x%x on wake read pipe.", epollEvents);
+                LOGW("Ignoring unexpected epoll events 0x%x on wake event fd.", epollEvents);
             }
         } else {
             ssize_t requestIndex = mRequests.indexOfKey(fd);
@@ -313,11 +327,11 @@ Done: ;
 
         short pollEvents = requestedFd.revents;
         if (pollEvents) {
-            if (requestedFd.fd == mWakeReadPipeFd) {
+            if (requestedFd.fd == mWakeEventFd) {
                 if (pollEvents & POLLIN) {
                     awoken();
                 } else {
-                    LOGW("Ignoring unexpected poll events 0x%x on wake read pipe.", pollEvents);
+                    LOGW("Ignoring unexpected poll events 0x%x on wake event fd.", pollEvents);
                 }
             } else {
                 int events = 0;
@@ -374,10 +388,14 @@ Done:
             // We keep a strong reference to the handler until the call to handleMessage
             // finishes.  Then we drop it so that the handler can be deleted *before*
             // we reacquire our lock.
+            const MessageHandler* handlerId = messageEnvelope.handler.get();
+            nsecs_t lag = now - messageEnvelope.uptime;
+            bool collectStatistics = mStatisticsEnabled;
+            nsecs_t dispatchTime = 0;
             { // obtain handler
                 sp<MessageHandler> handler = messageEnvelope.handler;
                 Message message = messageEnvelope.message;
-                mMessageEnvelopes.removeAt(0);
+                popMessageLocked();
                 mSendingMessage = true;
                 mLock.unlock();
 
@@ -386,10 +404,21 @@ Done:
                         this, handler.get(), message.what);
 #endif
                 handler->handleMessage(message);
+                if (collectStatistics) {
+                    dispatchTime = systemTime(SYSTEM_TIME_MONOTONIC) - now;
+                }
             } // release handler
 
             mLock.lock();
             mSendingMessage = false;
+            if (collectStatistics && mStatisticsEnabled) {
+                mMessageLagStats.record(lag);
+                ssize_t index = mHandlerStats.indexOfKey(handlerId);
+                if (index < 0) {
+                    index = mHandlerStats.add(handlerId, DispatchStats());
+                }
+                mHandlerStats.editValueAt(index).record(dispatchTime);
+            }
             result = ALOOPER_POLL_CALLBACK;
         } else {
             // The last message left at the head of the queue determines the next wakeup time.
@@ -399,6 +428,7 @@ Done:
     }
 
     // Release lock.
+    bool collectStatistics = mStatisticsEnabled;
     mLock.unlock();
 
     // Invoke all response callbacks.
@@ -413,7 +443,19 @@ Done:
             LOGD("%p ~ pollOnce - invoking fd event callback %p: fd=%d, events=0x%x, data=%p",
                     this, callback, fd, events, data);
 #endif
+            nsecs_t startTime = collectStatistics ? systemTime(SYSTEM_TIME_MONOTONIC) : 0;
             int callbackResult = callback(fd, events, data);
+            if (collectStatistics) {
+                nsecs_t callbackTime = systemTime(SYSTEM_TIME_MONOTONIC) - startTime;
+                AutoMutex _l(mLock);
+                if (mStatisticsEnabled) {
+                    ssize_t index = mCallbackStats.indexOfKey(fd);
+                    if (index < 0) {
+                        index = mCallbackStats.add(fd, DispatchStats());
+                    }
+                    mCallbackStats.editValueAt(index).record(callbackTime);
+                }
+            }
             if (callbackResult == 0) {
                 removeFd(fd);
             }
@@ -461,12 +503,13 @@ void Looper::wake() {
     }
 #endif
 
+    uint64_t inc = 1;
     ssize_t nWrite;
     do {
-        nWrite = write(mWakeWritePipeFd, "W", 1);
+        nWrite = write(mWakeEventFd, &inc, sizeof(uint64_t));
     } while (nWrite == -1 && errno == EINTR);
 
-    if (nWrite != 1) {
+    if (nWrite != sizeof(uint64_t)) {
         if (errno != EAGAIN) {
             LOGW("Could not write wake signal, errno=%d", errno);
         }
@@ -498,11 +541,11 @@ void Looper::awoken() {
     }
 #endif
 
-    char buffer[16];
+    uint64_t counter;
     ssize_t nRead;
     do {
-        nRead = read(mWakeReadPipeFd, buffer, sizeof(buffer));
-    } while ((nRead == -1 && errno == EINTR) || nRead == sizeof(buffer));
+        nRead = read(mWakeEventFd, &counter, sizeof(uint64_t));
+    } while (nRead == -1 && errno == EINTR);
 }
 
 void Looper::pushResponse(int events, const Request& request) {
@@ -563,7 +606,7 @@ int Looper::addFd(int fd, int ident, int events, ALooper_callbackFunc callback,
                 LOGE("Error modifying epoll events for fd %d, errno=%d", fd, errno);
                 return -1;
             }
-            mRequests.replaceValueAt(requestIndex, request);
+            mRequests.editValueAt(requestIndex) = request;
         }
     } // release lock
 #else
@@ -615,7 +658,7 @@ int Looper::removeFd(int fd) {
             return -1;
         }
 
-        mRequests.removeItemsAt(requestIndex);
+        mRequests.removeItemAt(requestIndex);
     } // release lock
     return 1;
 #else
@@ -679,17 +722,16 @@ void Looper::sendMessageAtTime(nsecs_t uptime, const sp<MessageHandler>& handler
             this, uptime, handler.get(), message.what);
 #endif
 
-    size_t i = 0;
+    size_t i;
     { // acquire lock
         AutoMutex _l(mLock);
 
-        size_t messageCount = mMessageEnvelopes.size();
-        while (i < messageCount && uptime >= mMessageEnvelopes.itemAt(i).uptime) {
-            i += 1;
-        }
+        MessageEnvelope messageEnvelope(uptime, mNextMessageSequence++, handler, message);
+        i = pushMessageLocked(messageEnvelope);
 
-        MessageEnvelope messageEnvelope(uptime, handler, message);
-        mMessageEnvelopes.insertAt(messageEnvelope, i, 1);
+        if (mStatisticsEnabled && mMessageEnvelopes.size() > mMaxMessageQueueDepth) {
+            mMaxMessageQueueDepth = mMessageEnvelopes.size();
+        }
 
         // Optimization: If the Looper is currently sending a message, then we can skip
         // the call to wake() because the next thing the Looper will do after processing
@@ -714,12 +756,20 @@ void Looper::removeMessages(const sp<MessageHandler>& handler) {
     { // acquire lock
         AutoMutex _l(mLock);
 
-        for (size_t i = mMessageEnvelopes.size(); i != 0; ) {
-            const MessageEnvelope& messageEnvelope = mMessageEnvelopes.itemAt(--i);
-            if (messageEnvelope.handler == handler) {
-                mMessageEnvelopes.removeAt(i);
+        size_t count = 0;
+        for (size_t i = 0; i < mMessageEnvelopes.size(); i++) {
+            const MessageEnvelope& messageEnvelope = mMessageEnvelopes.itemAt(i);
+            if (messageEnvelope.handler != handler) {
+                if (count != i) {
+                    mMessageEnvelopes.editItemAt(count) = messageEnvelope;
+                }
+                count += 1;
             }
         }
+        if (count != mMessageEnvelopes.size()) {
+            mMessageEnvelopes.removeItemsAt(count, mMessageEnvelopes.size() - count);
+            rebuildMessageHeapLocked();
+        }
     } // release lock
 }
 
@@ -731,14 +781,120 @@ void Looper::removeMessages(const sp<MessageHandler>& handler, int what) {
     { // acquire lock
         AutoMutex _l(mLock);
 
-        for (size_t i = mMessageEnvelopes.size(); i != 0; ) {
-            const MessageEnvelope& messageEnvelope = mMessageEnvelopes.itemAt(--i);
-            if (messageEnvelope.handler == handler
-                    && messageEnvelope.message.what == what) {
-                mMessageEnvelopes.removeAt(i);
+        size_t count = 0;
+        for (size_t i = 0; i < mMessageEnvelopes.size(); i++) {
+            const MessageEnvelope& messageEnvelope = mMessageEnvelopes.itemAt(i);
+            if (messageEnvelope.handler != handler
+                    || messageEnvelope.message.what != what) {
+                if (count != i) {
+                    mMessageEnvelopes.editItemAt(count) = messageEnvelope;
+                }
+                count += 1;
             }
         }
+        if (count != mMessageEnvelopes.size()) {
+            mMessageEnvelopes.removeItemsAt(count, mMessageEnvelopes.size() - count);
+            rebuildMessageHeapLocked();
+        }
     } // release lock
 }
 
+size_t Looper::pushMessageLocked(const MessageEnvelope& messageEnvelope) {
+    // Sift the hole left at the end of the heap up to where the new message belongs.
+    size_t index = mMessageEnvelopes.add(messageEnvelope);
+    while (index > 0) {
+        size_t parent = (index - 1) / 2;
+        const MessageEnvelope& parentEnvelope = mMessageEnvelopes.itemAt(parent);
+        if (!messageEnvelope.isBefore(parentEnvelope)) {
+            break;
+        }
+        mMessageEnvelopes.editItemAt(index) = parentEnvelope;
+        index = parent;
+    }
+    mMessageEnvelopes.editItemAt(index) = messageEnvelope;
+    return index;
+}
+
+void Looper::popMessageLocked() {
+    size_t last = mMessageEnvelopes.size() - 1;
+    if (last != 0) {
+        mMessageEnvelopes.editItemAt(0) = mMessageEnvelopes.itemAt(last);
+    }
+    mMessageEnvelopes.removeAt(last);
+    siftDownLocked(0);
+}
+
+void Looper::siftDownLocked(size_t index) {
+    const size_t size = mMessageEnvelopes.size();
+    if (index >= size) {
+        return;
+    }
+
+    MessageEnvelope messageEnvelope = mMessageEnvelopes.itemAt(index);
+    for (;;) {
+        size_t child = index * 2 + 1;
+        if (child >= size) {
+            break;
+        }
+        if (child + 1 < size && mMessageEnvelopes.itemAt(child + 1).isBefore(
+                mMessageEnvelopes.itemAt(child))) {
+            child += 1;
+        }
+        const MessageEnvelope& childEnvelope = mMessageEnvelopes.itemAt(child);
+        if (!childEnvelope.isBefore(messageEnvelope)) {
+            break;
+        }
+        mMessageEnvelopes.editItemAt(index) = childEnvelope;
+        index = child;
+    }
+    mMessageEnvelopes.editItemAt(index) = messageEnvelope;
+}
+
+void Looper::rebuildMessageHeapLocked() {
+    for (size_t i = mMessageEnvelopes.size() / 2; i != 0; ) {
+        siftDownLocked(--i);
+    }
+}
+
+void Looper::setStatisticsEnabled(bool enabled) {
+    AutoMutex _l(mLock);
+    if (enabled && !mStatisticsEnabled) {
+        mStatisticsStartTime = systemTime(SYSTEM_TIME_MONOTONIC);
+        mHandlerStats.clear();
+        mCallbackStats.clear();
+        mMessageLagStats = DispatchStats();
+        mMaxMessageQueueDepth = mMessageEnvelopes.size();
+    }
+    mStatisticsEnabled = enabled;
+}
+
+void Looper::dump(String8& dump, const char* prefix) {
+    AutoMutex _l(mLock);
+    if (!mStatisticsEnabled) {
+        dump.appendFormat("%sDispatch statistics: disabled\n", prefix);
+        return;
+    }
+
+    dump.appendFormat("%sDispatch statistics (last %0.1fs):\n", prefix,
+            (systemTime(SYSTEM_TIME_MONOTONIC) - mStatisticsStartTime) * 0.000000001f);
+    dump.appendFormat("%s  MessageQueueDepth: current=%d, max=%d\n", prefix,
+            mMessageEnvelopes.size(), mMaxMessageQueueDepth);
+    dump.appendFormat("%s  MessageLag: ", prefix);
+    dumpDispatchStats(dump, mMessageLagStats);
+    for (ssize_t i = mHandlerStats.next(-1); i >= 0; i = mHandlerStats.next(i)) {
+        dump.appendFormat("%s  Handler %p: ", prefix, mHandlerStats.keyAt(i));
+        dumpDispatchStats(dump, mHandlerStats.valueAt(i));
+    }
+    for (ssize_t i = mCallbackStats.next(-1); i >= 0; i = mCallbackStats.next(i)) {
+        dump.appendFormat("%s  Fd %d: ", prefix, mCallbackStats.keyAt(i));
+        dumpDispatchStats(dump, mCallbackStats.valueAt(i));
+    }
+}
+
+void Looper::dumpDispatchStats(String8& dump, const DispatchStats& stats) {
+    dump.appendFormat("count=%u, average=%0.3fms, max=%0.3fms\n", stats.count,
+            stats.count ? stats.totalTime * 0.000001f / stats.count : 0.0f,
+            stats.maxTime * 0.000001f);
+}
+
 } // namespace android
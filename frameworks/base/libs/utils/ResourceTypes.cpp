@@ -67,6 +67,9 @@ namespace android {
 // size measured in sizeof(uint32_t)
 #define IDMAP_HEADER_SIZE (ResTable::IDMAP_HEADER_SIZE_BYTES / sizeof(uint32_t))
 
+// Entry in a ResTable config index for resources with no matching config.
+#define NO_CONFIG 0xffff
+
 static void printToLogFunc(void* cookie, const char* txt)
 {
     LOGV("%s", txt);
@@ -308,12 +311,14 @@ Res_png_9patch* Res_png_9patch::deserialize(const void* inData)
 // --------------------------------------------------------------------
 
 ResStringPool::ResStringPool()
-    : mError(NO_INIT), mOwnedData(NULL), mHeader(NULL), mCache(NULL)
+    : mError(NO_INIT), mOwnedData(NULL), mHeader(NULL), mCache(NULL),
+      mCacheChunks(NULL)
 {
 }
 
 ResStringPool::ResStringPool(const void* data, size_t size, bool copyData)
-    : mError(NO_INIT), mOwnedData(NULL), mHeader(NULL), mCache(NULL)
+    : mError(NO_INIT), mOwnedData(NULL), mHeader(NULL), mCache(NULL),
+      mCacheChunks(NULL)
 {
     setTo(data, size, copyData);
 }
@@ -504,6 +509,21 @@ status_t ResStringPool::getError() const
     return mError;
 }
 
+/*
+ * Decoded UTF-8 strings are carved out of large chunks rather than each
+ * getting its own allocation.  They live until uninit().
+ */
+struct ResStringPool::CacheChunk
+{
+    CacheChunk* next;
+    size_t      size;   // number of char16_t
+    size_t      used;
+    // Followed by 'size' char16_t.
+};
+
+// Chunk size, in char16_t, for strings decoded on demand.
+#define CACHE_CHUNK_SIZE 2048
+
 void ResStringPool::uninit()
 {
     mError = NO_INIT;
@@ -511,16 +531,42 @@ void ResStringPool::uninit()
         free(mOwnedData);
         mOwnedData = NULL;
     }
-    if (mHeader != NULL && mCache != NULL) {
-        for (size_t x = 0; x < mHeader->stringCount; x++) {
-            if (mCache[x] != NULL) {
-                free(mCache[x]);
-                mCache[x] = NULL;
-            }
-        }
+    if (mCache != NULL) {
         free(mCache);
         mCache = NULL;
     }
+    while (mCacheChunks != NULL) {
+        CacheChunk* next = mCacheChunks->next;
+        free(mCacheChunks);
+        mCacheChunks = next;
+    }
+}
+
+char16_t* ResStringPool::allocCacheLocked(size_t count) const
+{
+    CacheChunk* chunk = mCacheChunks;
+    if (chunk == NULL || chunk->size - chunk->used < count) {
+        const size_t size = count > CACHE_CHUNK_SIZE ? count : CACHE_CHUNK_SIZE;
+        CacheChunk* newChunk = (CacheChunk*)malloc(sizeof(CacheChunk) + size*sizeof(char16_t));
+        if (newChunk == NULL) {
+            return NULL;
+        }
+        newChunk->size = size;
+        newChunk->used = 0;
+        if (chunk != NULL && size > CACHE_CHUNK_SIZE) {
+            // Keep filling the current chunk; this one is used up at once.
+            newChunk->next = chunk->next;
+            chunk->next = newChunk;
+        } else {
+            newChunk->next = chunk;
+            mCacheChunks = newChunk;
+        }
+        chunk = newChunk;
+    }
+
+    char16_t* result = (char16_t*)(chunk+1) + chunk->used;
+    chunk->used += count;
+    return result;
 }
 
 /**
@@ -593,6 +639,13 @@ const uint16_t* ResStringPool::stringAt(size_t idx, size_t* u16len) const
 
                 // encLen must be less than 0x7FFF due to encoding.
                 if ((uint32_t)(u8str+u8len-strings) < mStringPoolSize) {
+                    // Decoded strings never change once published, so a
+                    // cache hit doesn't need the lock.
+                    const char16_t* cached = ((char16_t* volatile*)mCache)[idx];
+                    if (cached != NULL) {
+                        return cached;
+                    }
+
                     AutoMutex lock(mDecodeLock);
 
                     if (mCache[idx] != NULL) {
@@ -607,7 +660,7 @@ const uint16_t* ResStringPool::stringAt(size_t idx, size_t* u16len) const
                         return NULL;
                     }
 
-                    char16_t *u16str = (char16_t *)calloc(*u16len+1, sizeof(char16_t));
+                    char16_t *u16str = allocCacheLocked(*u16len+1);
                     if (!u16str) {
                         LOGW("No memory when trying to allocate decode cache for string #%d\n",
                                 (int)idx);
@@ -615,6 +668,8 @@ const uint16_t* ResStringPool::stringAt(size_t idx, size_t* u16len) const
                     }
 
                     utf8_to_utf16(u8str, u8len, u16str);
+                    // The string must be visible before the pointer to it.
+                    __sync_synchronize();
                     mCache[idx] = u16str;
                     return u16str;
                 } else {
@@ -632,6 +687,86 @@ const uint16_t* ResStringPool::stringAt(size_t idx, size_t* u16len) const
     return NULL;
 }
 
+/*
+ * Decode a range of strings in one go, into a single allocation.  The
+ * pointers are only published once all of the strings are written, so
+ * readers on other threads either see a complete string or decode it
+ * themselves (taking mDecodeLock, and so waiting for us).
+ */
+void ResStringPool::prewarm(size_t start, size_t count) const
+{
+    if (mError != NO_ERROR || mCache == NULL || start >= mHeader->stringCount) {
+        return;
+    }
+    const size_t end = count < mHeader->stringCount-start ? start+count : mHeader->stringCount;
+
+    AutoMutex lock(mDecodeLock);
+    const uint8_t* strings = (const uint8_t*)mStrings;
+
+    // First work out how much room the strings need, skipping any that
+    // are malformed; stringAt() will complain about those when asked.
+    size_t total = 0;
+    for (size_t idx = start; idx < end; idx++) {
+        const uint32_t off = mEntries[idx];
+        if (mCache[idx] != NULL || off >= (mStringPoolSize-1)) {
+            continue;
+        }
+        const uint8_t* u8str = strings+off;
+        const size_t u16len = decodeLength(&u8str);
+        const size_t u8len = decodeLength(&u8str);
+        if ((uint32_t)(u8str+u8len-strings) < mStringPoolSize) {
+            total += u16len+1;
+        }
+    }
+    if (total == 0) {
+        return;
+    }
+
+    char16_t** decoded = (char16_t**)calloc(end-start, sizeof(char16_t*));
+    char16_t* u16str = decoded != NULL ? allocCacheLocked(total) : NULL;
+    if (u16str == NULL) {
+        LOGW("No memory when trying to allocate decode cache for %d strings\n",
+                (int)(end-start));
+        free(decoded);
+        return;
+    }
+
+    for (size_t idx = start; idx < end; idx++) {
+        const uint32_t off = mEntries[idx];
+        if (mCache[idx] != NULL || off >= (mStringPoolSize-1)) {
+            continue;
+        }
+        const uint8_t* u8str = strings+off;
+        const size_t u16len = decodeLength(&u8str);
+        const size_t u8len = decodeLength(&u8str);
+        if ((uint32_t)(u8str+u8len-strings) >= mStringPoolSize) {
+            continue;
+        }
+        const ssize_t actualLen = utf8_to_utf16_length(u8str, u8len);
+        if (actualLen >= 0 && (size_t)actualLen == u16len) {
+            utf8_to_utf16(u8str, u8len, u16str);
+            decoded[idx-start] = u16str;
+        }
+        u16str += u16len+1;
+    }
+
+    // The strings must be visible before the pointers to them.
+    __sync_synchronize();
+    for (size_t idx = start; idx < end; idx++) {
+        if (decoded[idx-start] != NULL) {
+            mCache[idx] = decoded[idx-start];
+        }
+    }
+    free(decoded);
+}
+
+void ResStringPool::cacheAllStrings() const
+{
+    if (mError == NO_ERROR) {
+        prewarm(0, mHeader->stringCount);
+    }
+}
+
 const char* ResStringPool::string8At(size_t idx, size_t* outLen) const
 {
     if (mError == NO_ERROR && idx < mHeader->stringCount) {
@@ -1822,6 +1957,7 @@ status_t ResTable::add(Asset* asset, void* cookie, bool copyData, const void* id
 
 status_t ResTable::add(ResTable* src)
 {
+    clearConfigIndex();
     mError = src->mError;
     
     for (size_t i=0; i<src->mHeaders.size(); i++) {
@@ -1848,6 +1984,7 @@ status_t ResTable::add(const void* data, size_t size, void* cookie,
                        Asset* asset, bool copyData, const Asset* idmap)
 {
     if (!data) return NO_ERROR;
+    clearConfigIndex();
     Header* header = new Header(this);
     header->index = mHeaders.size();
     header->cookie = cookie;
@@ -1979,6 +2116,7 @@ status_t ResTable::getError() const
 void ResTable::uninit()
 {
     mError = NO_INIT;
+    clearConfigIndex();
     size_t N = mPackageGroups.size();
     for (size_t i=0; i<N; i++) {
         PackageGroup* g = mPackageGroups[i];
@@ -1999,6 +2137,32 @@ void ResTable::uninit()
     mHeaders.clear();
 }
 
+void ResTable::cacheAllStrings() const
+{
+    for (size_t i=0; i<mHeaders.size(); i++) {
+        mHeaders[i]->values.cacheAllStrings();
+    }
+    for (size_t i=0; i<mPackageGroups.size(); i++) {
+        const PackageGroup* grp = mPackageGroups[i];
+        for (size_t j=0; j<grp->packages.size(); j++) {
+            grp->packages[j]->typeStrings.cacheAllStrings();
+            grp->packages[j]->keyStrings.cacheAllStrings();
+        }
+    }
+}
+
+void ResTable::prewarmStrings(const uint32_t* resIds, size_t count) const
+{
+    Res_value value;
+    for (size_t i=0; i<count; i++) {
+        const ssize_t block = getResource(resIds[i], &value, true);
+        if (block >= 0 && value.dataType == Res_value::TYPE_STRING) {
+            size_t len;
+            getTableStringBlock(block)->stringAt(value.data, &len);
+        }
+    }
+}
+
 bool ResTable::getResourceName(uint32_t resID, resource_name* outName) const
 {
     if (mError != NO_ERROR) {
@@ -2610,6 +2774,7 @@ void ResTable::setParameters(const ResTable_config* params)
         TABLE_NOISY(LOGI("CLEARING BAGS FOR GROUP %d!", i));
         mPackageGroups[i]->clearBagCache();
     }
+    clearConfigIndex();
     mLock.unlock();
 }
 
@@ -3944,8 +4109,18 @@ ssize_t ResTable::getEntry(
     uint32_t offset = ResTable_type::NO_ENTRY;
     ResTable_config bestConfig;
     memset(&bestConfig, 0, sizeof(bestConfig)); // make the compiler shut up
-    
-    const size_t NT = allTypes->configs.size();
+
+    // Lookups against the current parameters use the precomputed index
+    // instead of matching every config below.
+    const uint16_t* configIndex = config == &mParams ? getConfigIndex(allTypes) : NULL;
+    if (configIndex != NULL && configIndex[entryIndex] != NO_CONFIG) {
+        type = allTypes->configs[configIndex[entryIndex]];
+        const uint32_t* const eindex = (const uint32_t*)
+            (((const uint8_t*)type) + dtohs(type->header.headerSize));
+        offset = dtohl(eindex[entryIndex]);
+    }
+
+    const size_t NT = configIndex != NULL ? 0 : allTypes->configs.size();
     for (size_t i=0; i<NT; i++) {
         const ResTable_type* const thisType = allTypes->configs[i];
         if (thisType == NULL) continue;
@@ -4064,6 +4239,79 @@ ssize_t ResTable::getEntry(
     return offset + dtohs(entry->size);
 }
 
+/*
+ * Which config getEntry() settles on for an entry only depends on the
+ * type's configs and on mParams.  So rather than matching and comparing
+ * every config on each lookup, we resolve all the entries of a type in one
+ * pass the first time it is asked for, and keep the result until the
+ * parameters or the set of loaded packages change.  The pass visits the
+ * configs in the same order as getEntry(), so it picks the same ones.
+ *
+ * Returns NULL if the index couldn't be built; callers then fall back to
+ * the linear search.
+ */
+const uint16_t* ResTable::getConfigIndex(const Type* allTypes) const
+{
+    AutoMutex _l(mConfigIndexLock);
+
+    ssize_t i = mConfigIndex.indexOfKey(allTypes);
+    if (i >= 0) {
+        return mConfigIndex.valueAt(i);
+    }
+
+    const size_t NT = allTypes->configs.size();
+    const size_t NE = allTypes->entryCount;
+    if (NT >= NO_CONFIG) {
+        return NULL;
+    }
+
+    uint16_t* index = (uint16_t*)malloc(NE * sizeof(uint16_t));
+    ResTable_config* configs = (ResTable_config*)malloc(NT * sizeof(ResTable_config));
+    if (index == NULL || configs == NULL) {
+        free(index);
+        free(configs);
+        return NULL;
+    }
+    memset(index, 0xff, NE * sizeof(uint16_t));
+
+    for (size_t c=0; c<NT; c++) {
+        const ResTable_type* const thisType = allTypes->configs[c];
+        if (thisType == NULL) continue;
+
+        ResTable_config& thisConfig = configs[c];
+        thisConfig.copyFromDtoH(thisType->config);
+        if (!thisConfig.match(mParams)) {
+            continue;
+        }
+
+        const uint32_t* const eindex = (const uint32_t*)
+            (((const uint8_t*)thisType) + dtohs(thisType->header.headerSize));
+        for (size_t e=0; e<NE; e++) {
+            if (dtohl(eindex[e]) == ResTable_type::NO_ENTRY) {
+                continue;
+            }
+            if (index[e] != NO_CONFIG
+                    && !thisConfig.isBetterThan(configs[index[e]], &mParams)) {
+                continue;
+            }
+            index[e] = c;
+        }
+    }
+
+    free(configs);
+    mConfigIndex.add(allTypes, index);
+    return index;
+}
+
+void ResTable::clearConfigIndex()
+{
+    AutoMutex _l(mConfigIndexLock);
+    for (ssize_t i = mConfigIndex.next(-1); i >= 0; i = mConfigIndex.next(i)) {
+        free(mConfigIndex.valueAt(i));
+    }
+    mConfigIndex.clear();
+}
+
 status_t ResTable::parsePackage(const ResTable_package* const pkg,
                                 const Header* const header, uint32_t idmap_id)
 {
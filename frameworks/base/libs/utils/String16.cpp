@@ -16,6 +16,7 @@
 
 #include <utils/String16.h>
 
+#include <utils/BasicHashtable.h>
 #include <utils/Debug.h>
 #include <utils/Log.h>
 #include <utils/Unicode.h>
@@ -35,6 +36,16 @@ namespace android {
 static SharedBuffer* gEmptyStringBuf = NULL;
 static char16_t* gEmptyString = NULL;
 
+// Process-wide table of interned strings, see intern().
+struct InternedString16 {
+    InternedString16(const String16& string) : string(string) { }
+    inline const String16& getKey() const { return string; }
+    String16 string;
+};
+
+static pthread_mutex_t gInternLock = PTHREAD_MUTEX_INITIALIZER;
+static BasicHashtable<String16, InternedString16>* gInternTable = NULL;
+
 static inline char16_t* getEmptyString()
 {
     gEmptyStringBuf->acquire();
@@ -52,6 +63,11 @@ void initialize_string16()
 
 void terminate_string16()
 {
+    pthread_mutex_lock(&gInternLock);
+    delete gInternTable;
+    gInternTable = NULL;
+    pthread_mutex_unlock(&gInternLock);
+
     SharedBuffer::bufferFromData(gEmptyString)->release();
     gEmptyStringBuf = NULL;
     gEmptyString = NULL;
@@ -158,6 +174,24 @@ String16::~String16()
     SharedBuffer::bufferFromData(mString)->release();
 }
 
+String16 String16::intern() const
+{
+    const hash_t hash = hash_type(*this);
+
+    pthread_mutex_lock(&gInternLock);
+    if (gInternTable == NULL) {
+        gInternTable = new BasicHashtable<String16, InternedString16>();
+    }
+    ssize_t index = gInternTable->find(-1, hash, *this);
+    if (index < 0) {
+        index = gInternTable->add(hash, InternedString16(*this));
+    }
+    String16 result(gInternTable->entryAt(index).string);
+    pthread_mutex_unlock(&gInternLock);
+
+    return result;
+}
+
 void String16::setTo(const String16& other)
 {
     SharedBuffer::bufferFromData(other.mString)->acquire();
@@ -16,6 +16,7 @@
 
 #include <utils/String8.h>
 
+#include <utils/BasicHashtable.h>
 #include <utils/Log.h>
 #include <utils/Unicode.h>
 #include <utils/SharedBuffer.h>
@@ -43,6 +44,16 @@ namespace android {
 static SharedBuffer* gEmptyStringBuf = NULL;
 static char* gEmptyString = NULL;
 
+// Process-wide table of interned strings, see intern().
+struct InternedString8 {
+    InternedString8(const String8& string) : string(string) { }
+    inline const String8& getKey() const { return string; }
+    String8 string;
+};
+
+static pthread_mutex_t gInternLock = PTHREAD_MUTEX_INITIALIZER;
+static BasicHashtable<String8, InternedString8>* gInternTable = NULL;
+
 extern int gDarwinCantLoadAllObjects;
 int gDarwinIsReallyAnnoying;
 
@@ -69,6 +80,11 @@ void initialize_string8()
 
 void terminate_string8()
 {
+    pthread_mutex_lock(&gInternLock);
+    delete gInternTable;
+    gInternTable = NULL;
+    pthread_mutex_unlock(&gInternLock);
+
     SharedBuffer::bufferFromData(gEmptyString)->release();
     gEmptyStringBuf = NULL;
     gEmptyString = NULL;
@@ -218,6 +234,24 @@ void String8::clear() {
     mString = getEmptyString();
 }
 
+String8 String8::intern() const
+{
+    const hash_t hash = hash_type(*this);
+
+    pthread_mutex_lock(&gInternLock);
+    if (gInternTable == NULL) {
+        gInternTable = new BasicHashtable<String8, InternedString8>();
+    }
+    ssize_t index = gInternTable->find(-1, hash, *this);
+    if (index < 0) {
+        index = gInternTable->add(hash, InternedString8(*this));
+    }
+    String8 result(gInternTable->entryAt(index).string);
+    pthread_mutex_unlock(&gInternLock);
+
+    return result;
+}
+
 void String8::setTo(const String8& other)
 {
     SharedBuffer::bufferFromData(other.mString)->acquire();
@@ -17,6 +17,8 @@
 #include <utils/Unicode.h>
 
 #include <stddef.h>
+#include <stdint.h>
+#include <string.h>
 
 #ifdef HAVE_WINSOCK
 # undef  nhtol
@@ -68,6 +70,36 @@ static const char32_t kFirstByteMark[] = {
     0x00000000, 0x00000000, 0x000000C0, 0x000000E0, 0x000000F0
 };
 
+/**
+ * Returns the number of leading ASCII bytes in src.  Most strings that go
+ * through the conversions below (interface descriptors, property names,
+ * resource names) are pure ASCII, so once src is aligned the bytes are
+ * checked a word at a time.
+ */
+static inline size_t utf8_ascii_prefix_length(const uint8_t* src, size_t len)
+{
+    const uint8_t* cur = src;
+    const uint8_t* const end = src + len;
+    while (cur < end && (reinterpret_cast<uintptr_t>(cur) & (sizeof(uint32_t) - 1)) != 0) {
+        if (*cur & 0x80) {
+            return cur - src;
+        }
+        cur++;
+    }
+    while (size_t(end - cur) >= sizeof(uint32_t)) {
+        uint32_t word;
+        memcpy(&word, cur, sizeof(word));
+        if (word & 0x80808080) {
+            break;
+        }
+        cur += sizeof(uint32_t);
+    }
+    while (cur < end && (*cur & 0x80) == 0) {
+        cur++;
+    }
+    return cur - src;
+}
+
 // --------------------------------------------------------------------------
 // UTF-32
 // --------------------------------------------------------------------------
@@ -340,6 +372,10 @@ void utf16_to_utf8(const char16_t* src, size_t src_len, char* dst)
     const char16_t* const end_utf16 = src + src_len;
     char *cur = dst;
     while (cur_utf16 < end_utf16) {
+        if (*cur_utf16 < 0x80) { // ASCII
+            *cur++ = (char) *cur_utf16++;
+            continue;
+        }
         char32_t utf32;
         // surrogate pairs
         if ((*cur_utf16 & 0xFC00) == 0xD800) {
@@ -412,7 +448,10 @@ ssize_t utf16_to_utf8_length(const char16_t *src, size_t src_len)
     size_t ret = 0;
     const char16_t* const end = src + src_len;
     while (src < end) {
-        if ((*src & 0xFC00) == 0xD800 && (src + 1) < end
+        if (*src < 0x80) { // ASCII
+            ret += 1;
+            src++;
+        } else if ((*src & 0xFC00) == 0xD800 && (src + 1) < end
                 && (*++src & 0xFC00) == 0xDC00) {
             // surrogate pairs are always 4 bytes.
             ret += 4;
@@ -524,6 +563,13 @@ ssize_t utf8_to_utf16_length(const uint8_t* u8str, size_t u8len)
     /* Validate that the UTF-8 is the correct len */
     size_t u16measuredLen = 0;
     while (u8cur < u8end) {
+        const size_t asciiLen = utf8_ascii_prefix_length(u8cur, u8end - u8cur);
+        u16measuredLen += asciiLen;
+        u8cur += asciiLen;
+        if (u8cur == u8end) {
+            break;
+        }
+
         u16measuredLen++;
         int u8charLen = utf8_codepoint_len(*u8cur);
         uint32_t codepoint = utf8_to_utf32_codepoint(u8cur, u8charLen);
@@ -549,6 +595,15 @@ char16_t* utf8_to_utf16_no_null_terminator(const uint8_t* u8str, size_t u8len, c
     char16_t* u16cur = u16str;
 
     while (u8cur < u8end) {
+        const size_t asciiLen = utf8_ascii_prefix_length(u8cur, u8end - u8cur);
+        for (size_t i = 0; i < asciiLen; i++) {
+            *u16cur++ = (char16_t) u8cur[i];
+        }
+        u8cur += asciiLen;
+        if (u8cur == u8end) {
+            break;
+        }
+
         size_t u8len = utf8_codepoint_len(*u8cur);
         uint32_t codepoint = utf8_to_utf32_codepoint(u8cur, u8len);
 
@@ -23,6 +23,7 @@
 #include <utils/Log.h>
 #include <utils/misc.h>
 #include <utils/threads.h>
+#include <utils/WorkQueue.h>
 
 #include <zlib.h>
 
@@ -31,6 +32,12 @@
 #include <errno.h>
 #include <assert.h>
 #include <unistd.h>
+#include <limits.h>
+#include <sys/stat.h>
+
+#ifdef HAVE_POSIX_FILEMAP
+#include <sys/mman.h>
+#endif
 
 #if HAVE_PRINTF_ZD
 #  define ZD "%zd"
@@ -102,8 +109,64 @@ using namespace android;
  */
 #define kZipEntryAdj        10000
 
+/*
+ * Index file constants.  The file holds an IndexHeader identifying the
+ * archive it was built from, followed by the hash table.  It is only ever
+ * read back on the machine that wrote it, so fields are in host order.
+ */
+#define kIndexMagic         0x5849505a      // "ZPIX"
+#define kIndexVersion       1
+
+typedef struct IndexHeader {
+    uint32_t    magic;
+    uint32_t    version;
+    uint64_t    fileLength;
+    int64_t     modTime;
+    uint32_t    dirOffset;
+    uint32_t    dirSize;
+    uint32_t    numEntries;
+    uint32_t    hashTableSize;
+} IndexHeader;
+
+/*
+ * Fill in the header an index file for the archive open on "fd" must
+ * have.  Returns "false" if the archive can't be stat'ed.
+ */
+static bool initIndexHeader(IndexHeader* header, int fd, off64_t dirOffset,
+    size_t dirSize, int numEntries, int hashTableSize)
+{
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        LOGW("fstat failed: %s\n", strerror(errno));
+        return false;
+    }
+
+    memset(header, 0, sizeof(*header));
+    header->magic = kIndexMagic;
+    header->version = kIndexVersion;
+    header->fileLength = st.st_size;
+    header->modTime = st.st_mtime;
+    header->dirOffset = dirOffset;
+    header->dirSize = dirSize;
+    header->numEntries = numEntries;
+    header->hashTableSize = hashTableSize;
+    return true;
+}
+
+/*
+ * We have a minimum 75% load factor, possibly as low as 50% after we round
+ * off to a power of 2.
+ */
+static int hashTableSizeFor(int numEntries)
+{
+    return roundUpPower2(1 + (numEntries * 4) / 3);
+}
+
 ZipFileRO::~ZipFileRO() {
-    free(mHashTable);
+    if (mIndexMap)
+        mIndexMap->release();
+    else
+        free(mHashTable);
     if (mDirectoryMap)
         mDirectoryMap->release();
     if (mFd >= 0)
@@ -119,7 +182,7 @@ ZipFileRO::~ZipFileRO() {
 int ZipFileRO::entryToIndex(const ZipEntryRO entry) const
 {
     long ent = ((long) entry) - kZipEntryAdj;
-    if (ent < 0 || ent >= mHashTableSize || mHashTable[ent].name == NULL) {
+    if (ent < 0 || ent >= mHashTableSize || mHashTable[ent].nameOffset == 0) {
         LOGW("Invalid ZipEntryRO %p (%ld)\n", entry, ent);
         return -1;
     }
@@ -131,7 +194,7 @@ int ZipFileRO::entryToIndex(const ZipEntryRO entry) const
  * Open the specified file read-only.  We memory-map the entire thing and
  * close the file before returning.
  */
-status_t ZipFileRO::open(const char* zipFileName)
+status_t ZipFileRO::open(const char* zipFileName, const char* indexFileName)
 {
     int fd = -1;
 
@@ -166,6 +229,13 @@ status_t ZipFileRO::open(const char* zipFileName)
         goto bail;
     }
 
+    /*
+     * Reuse the hash table from an earlier open if we can.
+     */
+    if (indexFileName != NULL && mapIndex(indexFileName)) {
+        return OK;
+    }
+
     /*
      * Verify Central Directory and create data structures for fast access.
      */
@@ -173,6 +243,10 @@ status_t ZipFileRO::open(const char* zipFileName)
         goto bail;
     }
 
+    if (indexFileName != NULL) {
+        writeIndex(indexFileName);
+    }
+
     return OK;
 
 bail:
@@ -328,10 +402,9 @@ bool ZipFileRO::parseZipArchive(void)
     int numEntries = mNumEntries;
 
     /*
-     * Create hash table.  We have a minimum 75% load factor, possibly as
-     * low as 50% after we round off to a power of 2.
+     * Create hash table.
      */
-    mHashTableSize = roundUpPower2(1 + (numEntries * 4) / 3);
+    mHashTableSize = hashTableSizeFor(numEntries);
     mHashTable = (HashEntry*) calloc(mHashTableSize, sizeof(HashEntry));
 
     /*
@@ -402,13 +475,133 @@ void ZipFileRO::addToHash(const char* str, int strLen, unsigned int hash)
     /*
      * We over-allocate the table, so we're guaranteed to find an empty slot.
      */
-    while (mHashTable[ent].name != NULL)
+    while (mHashTable[ent].nameOffset != 0)
         ent = (ent + 1) & (mHashTableSize-1);
 
-    mHashTable[ent].name = str;
+    mHashTable[ent].nameOffset = str - (const char*) mDirectoryMap->getDataPtr();
     mHashTable[ent].nameLen = strLen;
 }
 
+/*
+ * Map the hash table written by an earlier writeIndex().
+ *
+ * Returns "false" if there is no index file, or if it was built from a
+ * different version of the archive.
+ */
+bool ZipFileRO::mapIndex(const char* indexFileName)
+{
+    IndexHeader expected;
+    const int hashTableSize = hashTableSizeFor(mNumEntries);
+    if (!initIndexHeader(&expected, mFd, mDirectoryOffset,
+            mDirectoryMap->getDataLength(), mNumEntries, hashTableSize)) {
+        return false;
+    }
+
+    int fd = ::open(indexFileName, O_RDONLY | O_BINARY);
+    if (fd < 0) {
+        LOGV("No zip index '%s': %s\n", indexFileName, strerror(errno));
+        return false;
+    }
+
+    const off64_t indexLength = lseek64(fd, 0, SEEK_END);
+    if (indexLength != (off64_t) (sizeof(IndexHeader) + hashTableSize * sizeof(HashEntry))) {
+        LOGV("Zip index '%s' has the wrong size\n", indexFileName);
+        TEMP_FAILURE_RETRY(close(fd));
+        return false;
+    }
+
+    FileMap* indexMap = new FileMap();
+    if (!indexMap->create(indexFileName, fd, 0, indexLength, true)) {
+        LOGW("Unable to map zip index '%s'\n", indexFileName);
+        indexMap->release();
+        TEMP_FAILURE_RETRY(close(fd));
+        return false;
+    }
+    TEMP_FAILURE_RETRY(close(fd));
+
+    const IndexHeader* header = (const IndexHeader*) indexMap->getDataPtr();
+    if (memcmp(header, &expected, sizeof(expected)) != 0) {
+        LOGV("Zip index '%s' is stale\n", indexFileName);
+        indexMap->release();
+        return false;
+    }
+
+    /*
+     * Don't trust the contents blindly: a damaged entry would have us read
+     * outside of the Central Directory.
+     */
+    HashEntry* hashTable = (HashEntry*) (header + 1);
+    const size_t cdLength = mDirectoryMap->getDataLength();
+    int numEntries = 0;
+    for (int ent = 0; ent < hashTableSize; ent++) {
+        const HashEntry& entry = hashTable[ent];
+        if (entry.nameOffset == 0)
+            continue;
+        if (entry.nameOffset < kCDELen ||
+            (size_t) entry.nameOffset + entry.nameLen > cdLength) {
+            LOGW("Zip index '%s' has a bad entry at %d\n", indexFileName, ent);
+            indexMap->release();
+            return false;
+        }
+        numEntries++;
+    }
+    if (numEntries != mNumEntries) {
+        LOGW("Zip index '%s' has %d entries, expected %d\n", indexFileName,
+            numEntries, mNumEntries);
+        indexMap->release();
+        return false;
+    }
+
+    mIndexMap = indexMap;
+    mHashTable = hashTable;
+    mHashTableSize = hashTableSize;
+    LOGV("+++ mapped zip index '%s'\n", indexFileName);
+    return true;
+}
+
+/*
+ * Write the hash table to "indexFileName" so that later opens of the same
+ * archive can map it instead of walking the Central Directory.
+ *
+ * The table goes to a temporary file first and is then renamed into
+ * place, so processes racing to create the index never see a partial one.
+ */
+bool ZipFileRO::writeIndex(const char* indexFileName) const
+{
+    IndexHeader header;
+    if (!initIndexHeader(&header, mFd, mDirectoryOffset,
+            mDirectoryMap->getDataLength(), mNumEntries, mHashTableSize)) {
+        return false;
+    }
+
+    char tmpFileName[PATH_MAX];
+    if (snprintf(tmpFileName, sizeof(tmpFileName), "%s.%d", indexFileName,
+            (int) getpid()) >= (int) sizeof(tmpFileName)) {
+        return false;
+    }
+
+    int fd = ::open(tmpFileName, O_WRONLY | O_CREAT | O_TRUNC | O_BINARY, 0644);
+    if (fd < 0) {
+        LOGV("Unable to create zip index '%s': %s\n", tmpFileName, strerror(errno));
+        return false;
+    }
+
+    const size_t tableLength = mHashTableSize * sizeof(HashEntry);
+    bool result =
+        TEMP_FAILURE_RETRY(write(fd, &header, sizeof(header))) == (ssize_t) sizeof(header) &&
+        TEMP_FAILURE_RETRY(write(fd, mHashTable, tableLength)) == (ssize_t) tableLength;
+    if (TEMP_FAILURE_RETRY(close(fd)) != 0)
+        result = false;
+
+    if (!result || rename(tmpFileName, indexFileName) != 0) {
+        LOGW("Unable to write zip index '%s': %s\n", indexFileName, strerror(errno));
+        unlink(tmpFileName);
+        return false;
+    }
+
+    return true;
+}
+
 /*
  * Find a matching entry.
  *
@@ -425,12 +618,61 @@ ZipEntryRO ZipFileRO::findEntryByName(const char* fileName) const
     }
 
     int nameLen = strlen(fileName);
-    unsigned int hash = computeHash(fileName, nameLen);
+    return findEntry(fileName, nameLen, computeHash(fileName, nameLen));
+}
+
+/*
+ * Find several entries in one go.
+ *
+ * The names are handled in small batches: every name in the batch is
+ * hashed and its first hash table slot prefetched before any of them is
+ * compared, so the probes don't each stall on a cold table line in turn.
+ */
+size_t ZipFileRO::findEntriesByName(const char* const* fileNames, size_t count,
+    ZipEntryRO* outEntries) const
+{
+    static const size_t kBatchSize = 16;
+    int nameLens[kBatchSize];
+    unsigned int hashes[kBatchSize];
+    size_t found = 0;
+
+    if (mHashTableSize <= 0) {
+        memset(outEntries, 0, count * sizeof(ZipEntryRO));
+        return 0;
+    }
+
+    for (size_t start = 0; start < count; start += kBatchSize) {
+        const size_t n = (count - start < kBatchSize) ? count - start : kBatchSize;
+
+        for (size_t i = 0; i < n; i++) {
+            const char* fileName = fileNames[start + i];
+            nameLens[i] = strlen(fileName);
+            hashes[i] = computeHash(fileName, nameLens[i]);
+            __builtin_prefetch(&mHashTable[hashes[i] & (mHashTableSize-1)]);
+        }
+
+        for (size_t i = 0; i < n; i++) {
+            ZipEntryRO entry = findEntry(fileNames[start + i], nameLens[i], hashes[i]);
+            outEntries[start + i] = entry;
+            if (entry != NULL)
+                found++;
+        }
+    }
+
+    return found;
+}
+
+/*
+ * Probe the hash table for a name whose length and hash are known.
+ */
+ZipEntryRO ZipFileRO::findEntry(const char* fileName, int nameLen,
+    unsigned int hash) const
+{
     int ent = hash & (mHashTableSize-1);
 
-    while (mHashTable[ent].name != NULL) {
+    while (mHashTable[ent].nameOffset != 0) {
         if (mHashTable[ent].nameLen == nameLen &&
-            memcmp(mHashTable[ent].name, fileName, nameLen) == 0)
+            memcmp(entryName(mHashTable[ent]), fileName, nameLen) == 0)
         {
             /* match */
             return (ZipEntryRO)(long)(ent + kZipEntryAdj);
@@ -457,7 +699,7 @@ ZipEntryRO ZipFileRO::findEntryByIndex(int idx) const
     }
 
     for (int ent = 0; ent < mHashTableSize; ent++) {
-        if (mHashTable[ent].name != NULL) {
+        if (mHashTable[ent].nameOffset != 0) {
             if (idx-- == 0)
                 return (ZipEntryRO) (ent + kZipEntryAdj);
         }
@@ -488,7 +730,7 @@ bool ZipFileRO::getEntryInfo(ZipEntryRO entry, int* pMethod, size_t* pUncompLen,
      * pointer.  The filename is the first entry past the fixed-size data,
      * so we can just subtract back from that.
      */
-    const unsigned char* ptr = (const unsigned char*) hashEntry.name;
+    const unsigned char* ptr = (const unsigned char*) entryName(hashEntry);
     off64_t cdOffset = mDirectoryOffset;
 
     ptr -= kCDELen;
@@ -630,7 +872,7 @@ int ZipFileRO::getEntryFileName(ZipEntryRO entry, char* buffer, int bufLen)
     if (bufLen < nameLen+1)
         return nameLen+1;
 
-    memcpy(buffer, mHashTable[ent].name, nameLen);
+    memcpy(buffer, entryName(mHashTable[ent]), nameLen);
     buffer[nameLen] = '\0';
     return 0;
 }
@@ -675,7 +917,7 @@ bool ZipFileRO::uncompressEntry(ZipEntryRO entry, void* buffer) const
     bool result = false;
     int ent = entryToIndex(entry);
     if (ent < 0)
-        return -1;
+        return false;
 
     int method;
     size_t uncompLen, compLen;
@@ -735,7 +977,7 @@ bool ZipFileRO::uncompressEntry(ZipEntryRO entry, int fd) const
     bool result = false;
     int ent = entryToIndex(entry);
     if (ent < 0)
-        return -1;
+        return false;
 
     int method;
     size_t uncompLen, compLen;
@@ -776,6 +1018,61 @@ bail:
     return result;
 }
 
+/*
+ * Work unit for uncompressEntries(): handles a single request.
+ */
+namespace {
+
+class UncompressWorkUnit : public WorkQueue::WorkUnit {
+public:
+    UncompressWorkUnit(const ZipFileRO* zip, ZipFileRO::UncompressRequest* request)
+        : mZip(zip), mRequest(request) {}
+
+    virtual bool run() {
+        if (mRequest->buffer != NULL)
+            mRequest->result = mZip->uncompressEntry(mRequest->entry, mRequest->buffer);
+        else
+            mRequest->result = mZip->uncompressEntry(mRequest->entry, mRequest->fd);
+        return true;
+    }
+
+private:
+    const ZipFileRO* mZip;
+    ZipFileRO::UncompressRequest* mRequest;
+};
+
+} // namespace
+
+/*
+ * Uncompress a set of entries on up to "maxThreads" worker threads.
+ *
+ * Entries are independent deflate streams and each uncompressEntry() call
+ * maps its own input, so the requests can run in any order.  If the queue
+ * won't take a request (no thread could be started) we do it ourselves.
+ */
+bool ZipFileRO::uncompressEntries(UncompressRequest* requests, size_t count,
+    int maxThreads) const
+{
+    WorkQueue queue(maxThreads > 0 ? maxThreads : 1, false);
+
+    for (size_t i = 0; i < count; i++) {
+        requests[i].result = false;
+        WorkQueue::WorkUnit* workUnit = new UncompressWorkUnit(this, &requests[i]);
+        if (queue.schedule(workUnit) != OK) {
+            workUnit->run();
+            delete workUnit;
+        }
+    }
+    queue.finish();
+
+    bool result = true;
+    for (size_t i = 0; i < count; i++) {
+        if (!requests[i].result)
+            result = false;
+    }
+    return result;
+}
+
 /*
  * Uncompress "deflate" data from one buffer to another.
  */
@@ -853,6 +1150,27 @@ bail:
     z_stream zstream;
     int zerr;
 
+#ifdef HAVE_POSIX_FILEMAP
+    /*
+     * When we're writing a regular file from the start, which is what
+     * extracting an entry to a fresh file looks like, map the output and
+     * inflate straight into it.  That saves copying everything through
+     * writeBuf and a write() per 32KB.
+     */
+    if (uncompLen > kWriteBufSize) {
+        void* outBuf = mapOutputFile(fd, uncompLen);
+        if (outBuf != NULL) {
+            result = inflateBuffer(outBuf, inBuf, uncompLen, compLen);
+            munmap(outBuf, uncompLen);
+            if (result && lseek64(fd, uncompLen, SEEK_SET) != (off64_t) uncompLen) {
+                LOGW("seek after inflate failed: %s\n", strerror(errno));
+                result = false;
+            }
+            return result;
+        }
+    }
+#endif
+
     /*
      * Initialize the zlib stream struct.
      */
@@ -929,3 +1247,35 @@ z_bail:
 bail:
     return result;
 }
+
+#ifdef HAVE_POSIX_FILEMAP
+/*
+ * Size "fd" to "length" bytes and map it for writing, if it is a regular
+ * file opened read-write and positioned at its start.  Returns NULL if the
+ * output can't be handled this way.
+ */
+/*static*/ void* ZipFileRO::mapOutputFile(int fd, size_t length)
+{
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) ||
+        (size_t) st.st_size > length) {
+        return NULL;
+    }
+    if ((fcntl(fd, F_GETFL) & O_ACCMODE) != O_RDWR ||
+        lseek64(fd, 0, SEEK_CUR) != 0) {
+        return NULL;
+    }
+
+    if (ftruncate(fd, length) != 0) {
+        LOGV("ftruncate failed: %s\n", strerror(errno));
+        return NULL;
+    }
+
+    void* ptr = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (ptr == MAP_FAILED) {
+        LOGV("mmap of output failed: %s\n", strerror(errno));
+        return NULL;
+    }
+    return ptr;
+}
+#endif
@@ -0,0 +1,20 @@
+# Build the micro-benchmarks.
+LOCAL_PATH := $(call my-dir)
+
+# The harness, shared with the benchmarks of other libraries.
+include $(CLEAR_VARS)
+LOCAL_SRC_FILES := Benchmark.cpp
+LOCAL_MODULE := libbenchmark
+LOCAL_MODULE_TAGS := eng tests
+include $(BUILD_STATIC_LIBRARY)
+
+include $(CLEAR_VARS)
+LOCAL_SRC_FILES := Utils_benchmark.cpp
+LOCAL_SHARED_LIBRARIES := \
+	liblog \
+	libcutils \
+	libutils
+LOCAL_STATIC_LIBRARIES := libbenchmark
+LOCAL_MODULE := libutils_benchmark
+LOCAL_MODULE_TAGS := eng tests
+include $(BUILD_EXECUTABLE)
@@ -0,0 +1,228 @@
+/*
+ * Copyright (C) 2011 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Benchmark.h"
+
+#include <utils/KeyedVector.h>
+#include <utils/String8.h>
+#include <utils/Timers.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+namespace android {
+namespace benchmark {
+
+// A run must take at least this long for its result to be reported.
+static const nsecs_t kMinRunTimeNs = 200000000LL;
+
+static const int kMaxIterations = 1 << 30;
+
+static const double kDefaultTolerancePercent = 10.0;
+
+// Benchmarks register themselves from static constructors, so the list must
+// not need constructing itself.
+static Benchmark* sFirst = NULL;
+static Benchmark* sLast = NULL;
+
+// State of the running benchmark.
+static bool sTiming;
+static nsecs_t sStartTime;
+static nsecs_t sElapsed;
+static int64_t sBytesPerIteration;
+static const char* sSkipReason;
+
+Benchmark::Benchmark(const char* name, BenchmarkFunction function)
+    : name(name), function(function), next(NULL) {
+    if (sLast) {
+        sLast->next = this;
+    } else {
+        sFirst = this;
+    }
+    sLast = this;
+}
+
+void stopTiming() {
+    if (sTiming) {
+        sElapsed += systemTime(SYSTEM_TIME_MONOTONIC) - sStartTime;
+        sTiming = false;
+    }
+}
+
+void startTiming() {
+    if (!sTiming) {
+        sStartTime = systemTime(SYSTEM_TIME_MONOTONIC);
+        sTiming = true;
+    }
+}
+
+void setBytesPerIteration(int64_t bytes) {
+    sBytesPerIteration = bytes;
+}
+
+void skip(const char* reason) {
+    sSkipReason = reason;
+}
+
+static nsecs_t run(const Benchmark* b, int iterations) {
+    sElapsed = 0;
+    sTiming = false;
+    startTiming();
+    b->function(iterations);
+    stopTiming();
+    return sElapsed;
+}
+
+static void usage(const char* program) {
+    fprintf(stderr,
+            "usage: %s [-f substring] [-b baseline.csv] [-p percent]\n"
+            "  -f  only run the benchmarks whose name contains substring\n"
+            "  -b  compare against the output of an earlier run\n"
+            "  -p  percentage a benchmark may be slower than its baseline\n"
+            "      before it counts as a regression (default %.0f)\n",
+            program, kDefaultTolerancePercent);
+}
+
+static bool loadBaseline(const char* path, KeyedVector<String8, double>* baseline) {
+    FILE* f = fopen(path, "r");
+    if (!f) {
+        fprintf(stderr, "cannot open %s\n", path);
+        return false;
+    }
+
+    char line[256];
+    while (fgets(line, sizeof(line), f)) {
+        char* comma = strchr(line, ',');
+        if (!comma) {
+            continue;
+        }
+        *comma = '\0';
+
+        int iterations;
+        double nsPerOp;
+        if (sscanf(comma + 1, "%d,%lf", &iterations, &nsPerOp) == 2) {
+            baseline->add(String8(line), nsPerOp);
+        }
+    }
+    fclose(f);
+    return true;
+}
+
+int runBenchmarks(int argc, char** argv) {
+    const char* filter = NULL;
+    const char* baselinePath = NULL;
+    double tolerancePercent = kDefaultTolerancePercent;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "f:b:p:")) != -1) {
+        switch (opt) {
+            case 'f':
+                filter = optarg;
+                break;
+            case 'b':
+                baselinePath = optarg;
+                break;
+            case 'p':
+                tolerancePercent = atof(optarg);
+                break;
+            default:
+                usage(argv[0]);
+                return 2;
+        }
+    }
+
+    KeyedVector<String8, double> baseline;
+    if (baselinePath && !loadBaseline(baselinePath, &baseline)) {
+        return 2;
+    }
+
+    printf("name,iterations,ns_per_op,mb_per_s,baseline_ns_per_op,result\n");
+
+    int regressions = 0;
+    for (const Benchmark* b = sFirst; b; b = b->next) {
+        if (filter && !strstr(b->name, filter)) {
+            continue;
+        }
+
+        sBytesPerIteration = 0;
+        sSkipReason = NULL;
+
+        // Grow the iteration count until a run is long enough to measure,
+        // aiming a little past the minimum so that the last step gets there.
+        int iterations = 1;
+        nsecs_t elapsed;
+        for (;;) {
+            elapsed = run(b, iterations);
+            if (sSkipReason || elapsed >= kMinRunTimeNs || iterations >= kMaxIterations) {
+                break;
+            }
+
+            int64_t next = elapsed > 0
+                    ? int64_t(iterations) * (kMinRunTimeNs + kMinRunTimeNs / 4) / elapsed
+                    : int64_t(iterations) * 10;
+            if (next > int64_t(iterations) * 10) {
+                next = int64_t(iterations) * 10;
+            }
+            if (next <= iterations) {
+                next = iterations + 1;
+            }
+            if (next > kMaxIterations) {
+                next = kMaxIterations;
+            }
+            iterations = int(next);
+        }
+
+        if (sSkipReason) {
+            printf("%s,0,0,0,0,skipped\n", b->name);
+            fprintf(stderr, "%s: skipped, %s\n", b->name, sSkipReason);
+            fflush(stdout);
+            continue;
+        }
+
+        double nsPerOp = double(elapsed) / iterations;
+        double mbPerSec = nsPerOp > 0
+                ? sBytesPerIteration * 1000.0 / nsPerOp / (1024 * 1024) : 0;
+
+        const char* result = "-";
+        double baselineNsPerOp = 0;
+        ssize_t index = baseline.indexOfKey(String8(b->name));
+        if (index >= 0) {
+            baselineNsPerOp = baseline.valueAt(index);
+            if (nsPerOp > baselineNsPerOp * (1 + tolerancePercent / 100)) {
+                result = "regressed";
+                regressions++;
+            } else {
+                result = "ok";
+            }
+        }
+
+        printf("%s,%d,%.1f,%.2f,%.1f,%s\n", b->name, iterations, nsPerOp,
+                mbPerSec, baselineNsPerOp, result);
+        fflush(stdout);
+    }
+
+    if (regressions) {
+        fprintf(stderr, "%d benchmark(s) regressed by more than %.0f%%\n",
+                regressions, tolerancePercent);
+        return 1;
+    }
+    return 0;
+}
+
+} // namespace benchmark
+} // namespace android
@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2011 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_BENCHMARK_H
+#define ANDROID_BENCHMARK_H
+
+#include <stdint.h>
+
+/*
+ * A minimal harness for native micro-benchmarks.
+ *
+ * A benchmark is a function that performs its operation "iterations" times:
+ *
+ *     static void String8_append(int iterations) {
+ *         ...
+ *     }
+ *     BENCHMARK(String8_append);
+ *
+ * The harness calls it with a growing iteration count until one run takes
+ * long enough to be measured reliably, and reports the time per iteration.
+ * Setup that should not be measured goes between stopTiming() and
+ * startTiming().
+ *
+ * Results are written to stdout as CSV, one line per benchmark:
+ *
+ *     name,iterations,ns_per_op,mb_per_s,baseline_ns_per_op,result
+ *
+ * The output of an earlier run can be passed back with -b to serve as a
+ * baseline; a benchmark that got slower than its baseline by more than the
+ * tolerance given with -p (10% by default) is reported as "regressed" and
+ * makes the run exit with a non-zero status.
+ */
+
+namespace android {
+namespace benchmark {
+
+typedef void (*BenchmarkFunction)(int iterations);
+
+struct Benchmark {
+    Benchmark(const char* name, BenchmarkFunction function);
+
+    const char* name;
+    BenchmarkFunction function;
+    Benchmark* next;
+};
+
+// Pauses and resumes the clock of the running benchmark.
+void stopTiming();
+void startTiming();
+
+// Declares how many bytes one iteration processes, so that a throughput
+// can be reported along with the time per iteration.
+void setBytesPerIteration(int64_t bytes);
+
+// Marks the running benchmark as not applicable on this device, e.g. when
+// a file it needs does not exist.  It is reported as "skipped".
+void skip(const char* reason);
+
+// Runs the benchmarks selected on the command line, see usage().
+// Returns the exit status for main().
+int runBenchmarks(int argc, char** argv);
+
+} // namespace benchmark
+} // namespace android
+
+#define BENCHMARK(f) \
+    static ::android::benchmark::Benchmark sBenchmark_##f(#f, f)
+
+#endif // ANDROID_BENCHMARK_H
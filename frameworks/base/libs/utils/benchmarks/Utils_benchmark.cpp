@@ -0,0 +1,430 @@
+/*
+ * Copyright (C) 2011 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Benchmark.h"
+
+#include <utils/KeyedVector.h>
+#include <utils/Looper.h>
+#include <utils/RefBase.h>
+#include <utils/SortedVector.h>
+#include <utils/String16.h>
+#include <utils/String8.h>
+#include <utils/Vector.h>
+#include <utils/ZipFileRO.h>
+#include <utils/threads.h>
+
+#include <limits.h>
+
+using namespace android;
+using namespace android::benchmark;
+
+// Number of elements in the containers the lookups are made on.
+static const int kContainerSize = 1000;
+
+// An archive that is on every device and has a realistic number of entries.
+static const char* kZipFileName = "/system/framework/framework-res.apk";
+
+// The results of the benchmarked calls go here so that they are not
+// optimized away.
+static volatile int sSink;
+
+// Spreads the keys over the key space, so that sorted inserts do not all
+// happen at one end.
+static inline int32_t keyAt(int i) {
+    return int32_t(uint32_t(i) * 2654435761u);
+}
+
+// --- Vector, SortedVector, KeyedVector ---
+
+static void Vector_push1000(int iterations) {
+    for (int i = 0; i < iterations; i++) {
+        Vector<int32_t> v;
+        for (int j = 0; j < kContainerSize; j++) {
+            v.push(j);
+        }
+        sSink = v.size();
+    }
+}
+BENCHMARK(Vector_push1000);
+
+static void Vector_insertAtFront100(int iterations) {
+    for (int i = 0; i < iterations; i++) {
+        Vector<int32_t> v;
+        for (int j = 0; j < 100; j++) {
+            v.insertAt(j, 0);
+        }
+        sSink = v.size();
+    }
+}
+BENCHMARK(Vector_insertAtFront100);
+
+static void SortedVector_add1000(int iterations) {
+    for (int i = 0; i < iterations; i++) {
+        SortedVector<int32_t> v;
+        for (int j = 0; j < kContainerSize; j++) {
+            v.add(keyAt(j));
+        }
+        sSink = v.size();
+    }
+}
+BENCHMARK(SortedVector_add1000);
+
+static void SortedVector_indexOf(int iterations) {
+    stopTiming();
+    SortedVector<int32_t> v;
+    for (int j = 0; j < kContainerSize; j++) {
+        v.add(keyAt(j));
+    }
+    startTiming();
+
+    int found = 0;
+    for (int i = 0; i < iterations; i++) {
+        found += v.indexOf(keyAt(i % kContainerSize)) >= 0;
+    }
+    sSink = found;
+}
+BENCHMARK(SortedVector_indexOf);
+
+static void KeyedVector_add1000(int iterations) {
+    for (int i = 0; i < iterations; i++) {
+        KeyedVector<int32_t, int32_t> v;
+        for (int j = 0; j < kContainerSize; j++) {
+            v.add(keyAt(j), j);
+        }
+        sSink = v.size();
+    }
+}
+BENCHMARK(KeyedVector_add1000);
+
+static void KeyedVector_indexOfKey(int iterations) {
+    stopTiming();
+    KeyedVector<int32_t, int32_t> v;
+    for (int j = 0; j < kContainerSize; j++) {
+        v.add(keyAt(j), j);
+    }
+    startTiming();
+
+    int found = 0;
+    for (int i = 0; i < iterations; i++) {
+        found += v.indexOfKey(keyAt(i % kContainerSize)) >= 0;
+    }
+    sSink = found;
+}
+BENCHMARK(KeyedVector_indexOfKey);
+
+static void KeyedVector_indexOfString8Key(int iterations) {
+    stopTiming();
+    KeyedVector<String8, int32_t> v;
+    Vector<String8> keys;
+    for (int j = 0; j < kContainerSize; j++) {
+        String8 key = String8::format("com.android.key.%d", keyAt(j));
+        v.add(key, j);
+        keys.push(key);
+    }
+    startTiming();
+
+    int found = 0;
+    for (int i = 0; i < iterations; i++) {
+        found += v.indexOfKey(keys[i % kContainerSize]) >= 0;
+    }
+    sSink = found;
+}
+BENCHMARK(KeyedVector_indexOfString8Key);
+
+// --- String8, String16 ---
+
+static const char* kAsciiText =
+        "android.permission.ACCESS_NETWORK_STATE/com.android.providers.a";
+
+// Japanese text, three UTF-8 bytes per character.
+static const char* kUnicodeText =
+        "\xe3\x81\x93\xe3\x82\x93\xe3\x81\xab\xe3\x81\xa1\xe3\x81\xaf"
+        "\xe3\x80\x81\xe4\xb8\x96\xe7\x95\x8c\xe3\x81\x93\xe3\x82\x93"
+        "\xe3\x81\xab\xe3\x81\xa1\xe3\x81\xaf\xe3\x80\x81\xe4\xb8\x96";
+
+static void String16_fromAsciiString8(int iterations) {
+    stopTiming();
+    String8 s(kAsciiText);
+    startTiming();
+
+    for (int i = 0; i < iterations; i++) {
+        String16 converted(s);
+        sSink = converted.size();
+    }
+}
+BENCHMARK(String16_fromAsciiString8);
+
+static void String16_fromUnicodeString8(int iterations) {
+    stopTiming();
+    String8 s(kUnicodeText);
+    startTiming();
+
+    for (int i = 0; i < iterations; i++) {
+        String16 converted(s);
+        sSink = converted.size();
+    }
+}
+BENCHMARK(String16_fromUnicodeString8);
+
+static void String8_fromAsciiString16(int iterations) {
+    stopTiming();
+    String16 s(kAsciiText);
+    startTiming();
+
+    for (int i = 0; i < iterations; i++) {
+        String8 converted(s);
+        sSink = converted.size();
+    }
+}
+BENCHMARK(String8_fromAsciiString16);
+
+static void String8_fromUnicodeString16(int iterations) {
+    stopTiming();
+    String16 s(kUnicodeText);
+    startTiming();
+
+    for (int i = 0; i < iterations; i++) {
+        String8 converted(s);
+        sSink = converted.size();
+    }
+}
+BENCHMARK(String8_fromUnicodeString16);
+
+static void String8_append100(int iterations) {
+    for (int i = 0; i < iterations; i++) {
+        String8 s;
+        for (int j = 0; j < 100; j++) {
+            s.append("item,");
+        }
+        sSink = s.size();
+    }
+}
+BENCHMARK(String8_append100);
+
+// --- RefBase ---
+
+class Counted : public RefBase {
+public:
+    int value;
+
+    Counted() : value(0) { }
+};
+
+static void RefBase_createDestroy(int iterations) {
+    for (int i = 0; i < iterations; i++) {
+        sp<Counted> object = new Counted();
+        sSink = object->value;
+    }
+}
+BENCHMARK(RefBase_createDestroy);
+
+static void RefBase_copyStrong(int iterations) {
+    sp<Counted> object = new Counted();
+    for (int i = 0; i < iterations; i++) {
+        sp<Counted> copy(object);
+        sSink = copy->value;
+    }
+}
+BENCHMARK(RefBase_copyStrong);
+
+static void RefBase_promoteWeak(int iterations) {
+    sp<Counted> object = new Counted();
+    wp<Counted> weak(object);
+    for (int i = 0; i < iterations; i++) {
+        sp<Counted> promoted = weak.promote();
+        sSink = promoted->value;
+    }
+}
+BENCHMARK(RefBase_promoteWeak);
+
+// --- Looper ---
+
+class CountingHandler : public MessageHandler {
+public:
+    int count;
+
+    CountingHandler() : count(0) { }
+
+    virtual void handleMessage(const Message& message) {
+        count++;
+    }
+};
+
+// Answers every message by sending one to "mReplyHandler" on "mReplyLooper".
+class EchoHandler : public MessageHandler {
+public:
+    EchoHandler(const sp<Looper>& replyLooper, const sp<MessageHandler>& replyHandler)
+        : mReplyLooper(replyLooper), mReplyHandler(replyHandler) { }
+
+    virtual void handleMessage(const Message& message) {
+        mReplyLooper->sendMessage(mReplyHandler, message);
+    }
+
+private:
+    sp<Looper> mReplyLooper;
+    sp<MessageHandler> mReplyHandler;
+};
+
+class LooperThread : public Thread {
+public:
+    LooperThread(const sp<Looper>& looper) : Thread(false), mLooper(looper) { }
+
+    void stop() {
+        requestExit();
+        mLooper->wake();
+        requestExitAndWait();
+    }
+
+private:
+    virtual bool threadLoop() {
+        mLooper->pollOnce(-1);
+        return true;
+    }
+
+    sp<Looper> mLooper;
+};
+
+static void Looper_sendMessage(int iterations) {
+    sp<Looper> looper = new Looper(false);
+    sp<CountingHandler> handler = new CountingHandler();
+
+    // Messages are sent in batches, so that this measures the queue rather
+    // than one wake up per message.
+    int sent = 0;
+    while (sent < iterations) {
+        for (int i = 0; i < 64 && sent < iterations; i++, sent++) {
+            looper->sendMessage(handler, Message(i));
+        }
+        while (handler->count < sent) {
+            looper->pollOnce(0);
+        }
+    }
+}
+BENCHMARK(Looper_sendMessage);
+
+static void Looper_wake(int iterations) {
+    sp<Looper> looper = new Looper(false);
+    for (int i = 0; i < iterations; i++) {
+        looper->wake();
+        looper->pollOnce(-1);
+    }
+}
+BENCHMARK(Looper_wake);
+
+// One iteration is a message to another thread and its answer, so two
+// cross thread wake ups.
+static void Looper_roundTrip(int iterations) {
+    stopTiming();
+    sp<Looper> looper = new Looper(false);
+    sp<Looper> threadLooper = new Looper(false);
+    sp<CountingHandler> replies = new CountingHandler();
+    sp<EchoHandler> echo = new EchoHandler(looper, replies);
+    sp<LooperThread> thread = new LooperThread(threadLooper);
+    thread->run("LooperBenchmark");
+    startTiming();
+
+    for (int i = 0; i < iterations; i++) {
+        threadLooper->sendMessage(echo, Message(i));
+        while (replies->count <= i) {
+            looper->pollOnce(-1);
+        }
+    }
+
+    stopTiming();
+    thread->stop();
+}
+BENCHMARK(Looper_roundTrip);
+
+// --- ZipFileRO ---
+
+static void ZipFileRO_open(int iterations) {
+    for (int i = 0; i < iterations; i++) {
+        ZipFileRO zip;
+        if (zip.open(kZipFileName) != NO_ERROR) {
+            skip("cannot open the test archive");
+            return;
+        }
+        sSink = zip.getNumEntries();
+    }
+}
+BENCHMARK(ZipFileRO_open);
+
+// findEntryByIndex() is linear, so only the names of this many entries are
+// collected to look up.
+static const int kMaxZipNames = 256;
+
+static bool collectEntryNames(const ZipFileRO& zip, Vector<String8>* names) {
+    int count = zip.getNumEntries();
+    if (count > kMaxZipNames) {
+        count = kMaxZipNames;
+    }
+    for (int i = 0; i < count; i++) {
+        char name[PATH_MAX];
+        ZipEntryRO entry = zip.findEntryByIndex(i);
+        if (entry && zip.getEntryFileName(entry, name, sizeof(name)) == 0) {
+            names->push(String8(name));
+        }
+    }
+    return !names->isEmpty();
+}
+
+static void ZipFileRO_findEntryByName(int iterations) {
+    stopTiming();
+    ZipFileRO zip;
+    Vector<String8> names;
+    if (zip.open(kZipFileName) != NO_ERROR || !collectEntryNames(zip, &names)) {
+        skip("cannot read the test archive");
+        return;
+    }
+    startTiming();
+
+    int found = 0;
+    for (int i = 0; i < iterations; i++) {
+        found += zip.findEntryByName(names[i % names.size()].string()) != NULL;
+    }
+    sSink = found;
+}
+BENCHMARK(ZipFileRO_findEntryByName);
+
+// One iteration looks up 16 entries at once.
+static void ZipFileRO_findEntriesByName16(int iterations) {
+    static const size_t kBatch = 16;
+
+    stopTiming();
+    ZipFileRO zip;
+    Vector<String8> names;
+    if (zip.open(kZipFileName) != NO_ERROR || !collectEntryNames(zip, &names)) {
+        skip("cannot read the test archive");
+        return;
+    }
+    const char* batch[kBatch];
+    for (size_t j = 0; j < kBatch; j++) {
+        batch[j] = names[j % names.size()].string();
+    }
+    startTiming();
+
+    ZipEntryRO entries[kBatch];
+    size_t found = 0;
+    for (int i = 0; i < iterations; i++) {
+        found += zip.findEntriesByName(batch, kBatch, entries);
+    }
+    sSink = found;
+}
+BENCHMARK(ZipFileRO_findEntriesByName16);
+
+int main(int argc, char** argv) {
+    return runBenchmarks(argc, argv);
+}
@@ -4,11 +4,15 @@ include $(CLEAR_VARS)
 
 # Build the unit tests.
 test_src_files := \
+	BasicHashtable_test.cpp \
 	BlobCache_test.cpp \
 	ObbFile_test.cpp \
+	RefBase_test.cpp \
 	Looper_test.cpp \
 	String8_test.cpp \
 	Unicode_test.cpp \
+	WeightedGenerationCache_test.cpp \
+	WorkQueue_test.cpp \
 	ZipFileRO_test.cpp \
 
 shared_libraries := \
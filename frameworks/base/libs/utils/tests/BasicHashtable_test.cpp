@@ -0,0 +1,295 @@
+/*
+ * Copyright (C) 2011 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "BasicHashtable_test"
+
+#include <utils/BasicHashtable.h>
+#include <utils/HashMap.h>
+#include <utils/KeyedVector.h>
+#include <utils/Log.h>
+#include <utils/String8.h>
+#include <utils/Timers.h>
+
+#include <gtest/gtest.h>
+
+namespace android {
+
+typedef key_value_pair_t<int, int> SimpleEntry;
+
+struct ComplexKey {
+    int k;
+
+    explicit ComplexKey(int k) : k(k) {
+        instanceCount += 1;
+    }
+
+    ComplexKey(const ComplexKey& other) : k(other.k) {
+        instanceCount += 1;
+    }
+
+    ~ComplexKey() {
+        instanceCount -= 1;
+    }
+
+    bool operator ==(const ComplexKey& other) const {
+        return k == other.k;
+    }
+
+    static ssize_t instanceCount;
+};
+
+ssize_t ComplexKey::instanceCount = 0;
+
+template <> inline hash_t hash_type(const ComplexKey& value) {
+    return hash_type(value.k);
+}
+
+typedef key_value_pair_t<ComplexKey, int> ComplexEntry;
+
+class BasicHashtableTest : public testing::Test {
+protected:
+    virtual void SetUp() {
+        ComplexKey::instanceCount = 0;
+    }
+
+    virtual void TearDown() {
+        EXPECT_EQ(0, ComplexKey::instanceCount);
+    }
+
+    template <typename TKey, typename TEntry>
+    static const TEntry* find(const BasicHashtable<TKey, TEntry>& h, const TKey& key) {
+        ssize_t index = h.find(-1, hash_type(key), key);
+        return index < 0 ? NULL : &h.entryAt(index);
+    }
+
+    template <typename TKey, typename TEntry>
+    static void add(BasicHashtable<TKey, TEntry>& h, const TKey& key, int value) {
+        h.add(hash_type(key), TEntry(key, value));
+    }
+
+    template <typename TKey, typename TEntry>
+    static bool remove(BasicHashtable<TKey, TEntry>& h, const TKey& key) {
+        ssize_t index = h.find(-1, hash_type(key), key);
+        if (index < 0) {
+            return false;
+        }
+        h.removeAt(index);
+        return true;
+    }
+};
+
+TEST_F(BasicHashtableTest, DefaultConstructor_IsEmpty) {
+    BasicHashtable<int, SimpleEntry> h;
+
+    EXPECT_EQ(0U, h.size());
+    EXPECT_TRUE(h.isEmpty());
+    EXPECT_EQ(-1, h.next(-1));
+    EXPECT_TRUE(find(h, 0) == NULL);
+}
+
+TEST_F(BasicHashtableTest, Add_FindsEachEntry) {
+    BasicHashtable<int, SimpleEntry> h;
+
+    for (int i = 0; i < 1000; i++) {
+        add(h, i * 7, i);
+    }
+
+    EXPECT_EQ(1000U, h.size());
+    EXPECT_GE(h.capacity(), h.size());
+    for (int i = 0; i < 1000; i++) {
+        const SimpleEntry* entry = find(h, i * 7);
+        ASSERT_TRUE(entry != NULL);
+        EXPECT_EQ(i, entry->value);
+    }
+    EXPECT_TRUE(find(h, 3) == NULL);
+}
+
+TEST_F(BasicHashtableTest, Next_VisitsEachEntryOnce) {
+    BasicHashtable<int, SimpleEntry> h;
+    for (int i = 0; i < 100; i++) {
+        add(h, i, i);
+    }
+
+    int sum = 0;
+    size_t count = 0;
+    for (ssize_t index = h.next(-1); index >= 0; index = h.next(index)) {
+        sum += h.entryAt(index).key;
+        count += 1;
+    }
+    EXPECT_EQ(100U, count);
+    EXPECT_EQ(99 * 100 / 2, sum);
+}
+
+TEST_F(BasicHashtableTest, RemoveAt_KeepsOtherEntriesReachable) {
+    BasicHashtable<int, SimpleEntry> h;
+    for (int i = 0; i < 256; i++) {
+        add(h, i, i);
+    }
+
+    for (int i = 0; i < 256; i += 2) {
+        EXPECT_TRUE(remove(h, i));
+    }
+
+    EXPECT_EQ(128U, h.size());
+    for (int i = 0; i < 256; i++) {
+        EXPECT_EQ(bool(i & 1), find(h, i) != NULL) << "key " << i;
+    }
+}
+
+TEST_F(BasicHashtableTest, AddRemoveChurn_DoesNotGrow) {
+    BasicHashtable<int, SimpleEntry> h(16);
+    const size_t bucketCount = h.bucketCount();
+
+    for (int i = 0; i < 10000; i++) {
+        add(h, i, i);
+        if (i >= 8) {
+            EXPECT_TRUE(remove(h, i - 8));
+        }
+    }
+
+    EXPECT_EQ(8U, h.size());
+    EXPECT_EQ(bucketCount, h.bucketCount());
+}
+
+TEST_F(BasicHashtableTest, RemoveAll_ThenAdd_Reuses) {
+    BasicHashtable<int, SimpleEntry> h;
+    for (int round = 0; round < 10; round++) {
+        for (int i = 0; i < 100; i++) {
+            add(h, round * 1000 + i, i);
+        }
+        for (int i = 0; i < 100; i++) {
+            EXPECT_TRUE(remove(h, round * 1000 + i));
+        }
+        EXPECT_TRUE(h.isEmpty());
+    }
+}
+
+TEST_F(BasicHashtableTest, Copy_IsCopyOnWrite) {
+    BasicHashtable<ComplexKey, ComplexEntry> h1;
+    add(h1, ComplexKey(1), 10);
+    add(h1, ComplexKey(2), 20);
+
+    BasicHashtable<ComplexKey, ComplexEntry> h2(h1);
+    EXPECT_EQ(2, ComplexKey::instanceCount); // shared storage
+
+    add(h2, ComplexKey(3), 30);
+    EXPECT_EQ(5, ComplexKey::instanceCount);
+
+    EXPECT_EQ(2U, h1.size());
+    EXPECT_TRUE(find(h1, ComplexKey(3)) == NULL);
+    EXPECT_EQ(3U, h2.size());
+    ASSERT_TRUE(find(h2, ComplexKey(1)) != NULL);
+    EXPECT_EQ(10, find(h2, ComplexKey(1))->value);
+}
+
+TEST_F(BasicHashtableTest, Clear_DestroysEntries) {
+    BasicHashtable<ComplexKey, ComplexEntry> h;
+    for (int i = 0; i < 50; i++) {
+        add(h, ComplexKey(i), i);
+    }
+    EXPECT_EQ(50, ComplexKey::instanceCount);
+
+    h.clear();
+    EXPECT_EQ(0U, h.size());
+    EXPECT_EQ(0, ComplexKey::instanceCount);
+
+    add(h, ComplexKey(7), 7);
+    EXPECT_EQ(1U, h.size());
+}
+
+TEST_F(BasicHashtableTest, Rehash_PreservesEntries) {
+    BasicHashtable<ComplexKey, ComplexEntry> h;
+    for (int i = 0; i < 20; i++) {
+        add(h, ComplexKey(i), i);
+    }
+
+    h.rehash(1000, 0.5f);
+    EXPECT_GE(h.capacity(), 1000U);
+    EXPECT_EQ(20, ComplexKey::instanceCount);
+    for (int i = 0; i < 20; i++) {
+        ASSERT_TRUE(find(h, ComplexKey(i)) != NULL);
+    }
+}
+
+TEST_F(BasicHashtableTest, AlignedEntries_AreAligned) {
+    BasicHashtable<int64_t, key_value_pair_t<int64_t, double> > h;
+    for (int64_t i = 0; i < 32; i++) {
+        h.add(hash_type(i), key_value_pair_t<int64_t, double>(i, 0.5));
+    }
+    for (ssize_t index = h.next(-1); index >= 0; index = h.next(index)) {
+        EXPECT_EQ(0U, uintptr_t(&h.entryAt(index)) % __alignof__(int64_t));
+    }
+}
+
+TEST_F(BasicHashtableTest, HashMap_BehavesLikeKeyedVector) {
+    HashMap<String8, int> map;
+
+    EXPECT_EQ(NAME_NOT_FOUND, map.indexOfKey(String8("a")));
+    map.add(String8("a"), 1);
+    map.add(String8("b"), 2);
+    map.add(String8("a"), 3);
+
+    EXPECT_EQ(2U, map.size());
+    EXPECT_EQ(3, map.valueFor(String8("a")));
+    EXPECT_EQ(2, map.valueFor(String8("b")));
+
+    map.editValueFor(String8("b")) = 4;
+    EXPECT_EQ(4, map.valueFor(String8("b")));
+
+    EXPECT_GE(map.removeItem(String8("a")), 0);
+    EXPECT_EQ(NAME_NOT_FOUND, map.removeItem(String8("a")));
+    EXPECT_EQ(1U, map.size());
+}
+
+// Not a correctness test: reports lookup cost against KeyedVector.
+TEST_F(BasicHashtableTest, Benchmark_LookupVersusKeyedVector) {
+    static const size_t kSizes[] = { 10, 100, 1000, 10000, 100000 };
+    static const size_t kLookups = 1000000;
+
+    for (size_t s = 0; s < sizeof(kSizes) / sizeof(kSizes[0]); s++) {
+        const size_t n = kSizes[s];
+        KeyedVector<int, int> vector;
+        HashMap<int, int> map;
+        vector.setCapacity(n);
+        for (size_t i = 0; i < n; i++) {
+            vector.add(int(i), int(i)); // ascending keys append, KeyedVector's best case
+            map.add(int(i), int(i));
+        }
+
+        int sum = 0;
+        uint32_t seed = 1;
+        nsecs_t start = systemTime(SYSTEM_TIME_MONOTONIC);
+        for (size_t i = 0; i < kLookups; i++) {
+            seed = seed * 1103515245 + 12345;
+            sum += vector.valueAt(vector.indexOfKey(int(seed % n)));
+        }
+        nsecs_t vectorTime = systemTime(SYSTEM_TIME_MONOTONIC) - start;
+
+        seed = 1;
+        start = systemTime(SYSTEM_TIME_MONOTONIC);
+        for (size_t i = 0; i < kLookups; i++) {
+            seed = seed * 1103515245 + 12345;
+            sum -= map.valueAt(map.indexOfKey(int(seed % n)));
+        }
+        nsecs_t mapTime = systemTime(SYSTEM_TIME_MONOTONIC) - start;
+
+        EXPECT_EQ(0, sum);
+        printf("%6u entries: KeyedVector %4lld ns/lookup, HashMap %4lld ns/lookup\n",
+                n, vectorTime / kLookups, mapTime / kLookups);
+    }
+}
+
+} // namespace android
@@ -690,4 +690,108 @@ TEST_F(LooperTest, RemoveMessage_WhenRemovingSomeMessagesForHandler_ShouldRemove
             << "no more messages to handle";
 }
 
+TEST_F(LooperTest, SendMessageAtTime_WhenSentOutOfOrder_ShouldInvokeHandlersInUptimeOrder) {
+    sp<StubMessageHandler> handler = new StubMessageHandler();
+    nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
+    static const int delays[] = { 7, 3, 9, 0, 3, 5, 1, 8, 2, 6, 4, 3 };
+    const int count = sizeof(delays) / sizeof(delays[0]);
+    for (int i = 0; i < count; i++) {
+        mLooper->sendMessageAtTime(now - ms2ns(100) + delays[i], handler, Message(i));
+    }
+
+    int result = mLooper->pollOnce(0);
+
+    EXPECT_EQ(ALOOPER_POLL_CALLBACK, result)
+            << "pollOnce result should be ALOOPER_POLL_CALLBACK because messages were sent";
+    ASSERT_EQ(size_t(count), handler->messages.size())
+            << "handled all messages";
+    for (int i = 1; i < count; i++) {
+        int previous = handler->messages[i - 1].what;
+        int current = handler->messages[i].what;
+        EXPECT_TRUE(delays[previous] < delays[current]
+                || (delays[previous] == delays[current] && previous < current))
+                << "message " << current << " handled out of order after " << previous;
+    }
+}
+
+TEST_F(LooperTest, RemoveMessage_WhenRemovingFromManyMessages_ShouldKeepRemainingOrder) {
+    sp<StubMessageHandler> handler1 = new StubMessageHandler();
+    sp<StubMessageHandler> handler2 = new StubMessageHandler();
+    nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
+    for (int i = 0; i < 20; i++) {
+        nsecs_t uptime = now - ms2ns(100) + (i * 7) % 20;
+        mLooper->sendMessageAtTime(uptime, i % 3 ? handler1 : handler2, Message(i));
+    }
+    mLooper->removeMessages(handler2);
+
+    int result = mLooper->pollOnce(0);
+
+    EXPECT_EQ(ALOOPER_POLL_CALLBACK, result)
+            << "pollOnce result should be ALOOPER_POLL_CALLBACK because messages were sent";
+    EXPECT_EQ(size_t(0), handler2->messages.size())
+            << "removed messages should not be handled";
+    ASSERT_EQ(size_t(13), handler1->messages.size())
+            << "remaining messages should be handled";
+    for (size_t i = 1; i < handler1->messages.size(); i++) {
+        EXPECT_LT((handler1->messages[i - 1].what * 7) % 20, (handler1->messages[i].what * 7) % 20)
+                << "messages handled out of order";
+    }
+}
+
+TEST_F(LooperTest, PollAll_WhenManyFdsAreSignalled_InvokesAllCallbacks) {
+    static const int count = 40;
+    Pipe pipes[count];
+    StubCallbackHandler* handlers[count];
+    for (int i = 0; i < count; i++) {
+        handlers[i] = new StubCallbackHandler(0);
+        handlers[i]->setCallback(mLooper, pipes[i].receiveFd, ALOOPER_EVENT_INPUT);
+        pipes[i].writeSignal();
+    }
+
+    int result = mLooper->pollAll(0);
+
+    EXPECT_EQ(ALOOPER_POLL_TIMEOUT, result)
+            << "pollAll result should be ALOOPER_POLL_TIMEOUT once all callbacks were invoked";
+    for (int i = 0; i < count; i++) {
+        EXPECT_EQ(1, handlers[i]->callbackCount)
+                << "callback " << i << " should be invoked once";
+        delete handlers[i];
+    }
+}
+
+TEST_F(LooperTest, Dump_WhenStatisticsEnabled_ShouldReportHandlersAndCallbacks) {
+    mLooper->setStatisticsEnabled(true);
+
+    Pipe pipe;
+    StubCallbackHandler handler(true);
+    handler.setCallback(mLooper, pipe.receiveFd, ALOOPER_EVENT_INPUT);
+    pipe.writeSignal();
+
+    sp<StubMessageHandler> messageHandler = new StubMessageHandler();
+    mLooper->sendMessage(messageHandler, Message(MSG_TEST1));
+    mLooper->sendMessage(messageHandler, Message(MSG_TEST2));
+
+    mLooper->pollOnce(0);
+
+    String8 dump;
+    mLooper->dump(dump);
+
+    String8 expected;
+    expected.appendFormat("Handler %p: count=2,", messageHandler.get());
+    EXPECT_TRUE(strstr(dump.string(), expected.string()) != NULL)
+            << "dump should report the message handler: " << dump.string();
+    expected.setTo("");
+    expected.appendFormat("Fd %d: count=1,", pipe.receiveFd);
+    EXPECT_TRUE(strstr(dump.string(), expected.string()) != NULL)
+            << "dump should report the fd callback: " << dump.string();
+    EXPECT_TRUE(strstr(dump.string(), "MessageQueueDepth: current=0, max=2") != NULL)
+            << "dump should report the queue depth: " << dump.string();
+
+    mLooper->setStatisticsEnabled(false);
+    dump.setTo("");
+    mLooper->dump(dump);
+    EXPECT_TRUE(strstr(dump.string(), "disabled") != NULL)
+            << "dump should report that statistics are disabled: " << dump.string();
+}
+
 } // namespace android
@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2011 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "RefBase_test"
+
+#include <utils/RefBase.h>
+
+#include <gtest/gtest.h>
+
+namespace android {
+
+class Foo : public VirtualLightRefBase {
+public:
+    Foo(bool* deleted) : mDeleted(deleted) { }
+    virtual ~Foo() { *mDeleted = true; }
+
+private:
+    bool* mDeleted;
+};
+
+class Bar : public Foo {
+public:
+    Bar(bool* deleted, bool* barDeleted) : Foo(deleted), mBarDeleted(barDeleted) { }
+    virtual ~Bar() { *mBarDeleted = true; }
+
+private:
+    bool* mBarDeleted;
+};
+
+TEST(RefBaseTest, VirtualLightRefBase_DeletesThroughBaseClass) {
+    bool deleted = false;
+    bool barDeleted = false;
+    {
+        sp<Foo> foo = new Bar(&deleted, &barDeleted);
+        sp<Foo> copy = foo;
+        EXPECT_EQ(2, foo->getStrongCount());
+        copy.clear();
+        EXPECT_EQ(1, foo->getStrongCount());
+        EXPECT_FALSE(deleted);
+    }
+    EXPECT_TRUE(deleted);
+    EXPECT_TRUE(barDeleted);
+}
+
+TEST(RefBaseTest, Swap_KeepsReferenceCounts) {
+    bool deleted1 = false;
+    bool deleted2 = false;
+    sp<Foo> foo1 = new Foo(&deleted1);
+    sp<Foo> foo2 = new Foo(&deleted2);
+    Foo* raw1 = foo1.get();
+
+    foo1.swap(foo2);
+    EXPECT_EQ(raw1, foo2.get());
+    EXPECT_EQ(1, foo1->getStrongCount());
+    EXPECT_EQ(1, foo2->getStrongCount());
+
+    foo2.clear();
+    EXPECT_TRUE(deleted1);
+    EXPECT_FALSE(deleted2);
+}
+
+#ifdef ANDROID_SP_HAS_MOVE
+TEST(RefBaseTest, Move_TransfersReference) {
+    bool deleted = false;
+    sp<Foo> foo = new Foo(&deleted);
+    Foo* raw = foo.get();
+
+    sp<Foo> moved(static_cast<sp<Foo>&&>(foo));
+    EXPECT_TRUE(foo == NULL);
+    EXPECT_EQ(raw, moved.get());
+    EXPECT_EQ(1, moved->getStrongCount());
+
+    sp<Foo> assigned;
+    assigned = static_cast<sp<Foo>&&>(moved);
+    EXPECT_TRUE(moved == NULL);
+    EXPECT_EQ(1, assigned->getStrongCount());
+
+    assigned.clear();
+    EXPECT_TRUE(deleted);
+}
+#endif
+
+} // namespace android
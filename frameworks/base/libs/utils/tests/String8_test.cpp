@@ -72,4 +72,28 @@ TEST_F(String8Test, OperatorPlusEquals) {
     EXPECT_STREQ(src3, " Verify me.");
 }
 
+TEST_F(String8Test, InternSharesStorage) {
+    String8 a("android.os.IServiceManager");
+    String8 b("android.os.IServiceManager");
+    EXPECT_NE(a.string(), b.string());
+
+    String8 internedA = a.intern();
+    String8 internedB = b.intern();
+    EXPECT_EQ(internedA.string(), internedB.string());
+    EXPECT_TRUE(internedA == internedB);
+    EXPECT_STREQ("android.os.IServiceManager", internedA.string());
+
+    String8 other = String8("android.os.IPermissionController").intern();
+    EXPECT_NE(internedA.string(), other.string());
+}
+
+TEST_F(String8Test, InternedStringIsImmutable) {
+    String8 interned = String8("ro.hw").intern();
+    String8 copy = interned;
+    copy.append(".vendor");
+
+    EXPECT_STREQ("ro.hw", String8("ro.hw").intern().string());
+    EXPECT_STREQ("ro.hw.vendor", copy.string());
+}
+
 }
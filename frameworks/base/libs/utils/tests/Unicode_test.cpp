@@ -112,4 +112,38 @@ TEST_F(UnicodeTest, UTF8toUTF16Normal) {
             << "should be NULL terminated";
 }
 
+TEST_F(UnicodeTest, UTF8toUTF16MixedASCIIRuns) {
+    // Long ASCII runs at every alignment around a multi-byte character.
+    for (size_t offset = 0; offset < 8; offset++) {
+        uint8_t str[32];
+        memset(str, 'a', sizeof(str));
+        str[offset + 9] = 0xC4; // U+0100
+        str[offset + 10] = 0x80;
+
+        const size_t u8len = sizeof(str) - offset;
+        EXPECT_EQ(ssize_t(u8len - 1), utf8_to_utf16_length(str + offset, u8len))
+                << "offset " << offset;
+
+        char16_t output[32];
+        utf8_to_utf16(str + offset, u8len, output);
+        for (size_t i = 0; i < u8len - 1; i++) {
+            EXPECT_EQ(i == 9 ? 0x0100 : 'a', output[i])
+                    << "offset " << offset << ", index " << i;
+        }
+        EXPECT_EQ(0, output[u8len - 1])
+                << "should be NULL terminated";
+    }
+}
+
+TEST_F(UnicodeTest, UTF16toUTF8MixedASCII) {
+    const char16_t str[] = { 'a', 0x0100, 'b', 0xD800, 0xDC00, 'c' };
+    const size_t u16len = sizeof(str) / sizeof(str[0]);
+
+    EXPECT_EQ(1 + 2 + 1 + 4 + 1, utf16_to_utf8_length(str, u16len));
+
+    char output[1 + 2 + 1 + 4 + 1 + 1];
+    utf16_to_utf8(str, u16len, output);
+    EXPECT_STREQ("a\xC4\x80" "b\xF0\x90\x80\x80" "c", output);
+}
+
 }
@@ -0,0 +1,133 @@
+/*
+ * Copyright (C) 2011 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "WeightedGenerationCache_test"
+
+#include <utils/WeightedGenerationCache.h>
+
+#include <gtest/gtest.h>
+
+namespace android {
+
+typedef WeightedGenerationCache<int, int*> Cache;
+
+static int gValues[64];
+
+class RemovalCounter : public OnEntryRemoved<int, int*> {
+public:
+    RemovalCounter() : count(0) { }
+
+    virtual void operator()(int& key, int*& value) {
+        count++;
+    }
+
+    int count;
+};
+
+TEST(WeightedGenerationCacheTest, Put_EvictsByWeight) {
+    Cache cache(100);
+    RemovalCounter removed;
+    cache.setOnEntryRemovedListener(&removed);
+
+    EXPECT_TRUE(cache.put(1, &gValues[1], 40));
+    EXPECT_TRUE(cache.put(2, &gValues[2], 40));
+    EXPECT_FALSE(cache.put(2, &gValues[2], 40));
+    EXPECT_EQ(80U, cache.getWeight());
+
+    EXPECT_TRUE(cache.put(3, &gValues[3], 40));
+    EXPECT_EQ(2U, cache.size());
+    EXPECT_EQ(80U, cache.getWeight());
+    EXPECT_FALSE(cache.contains(1));
+    EXPECT_EQ(1, removed.count);
+    EXPECT_EQ(1U, cache.getStats().evictions);
+
+    EXPECT_FALSE(cache.put(4, &gValues[4], 101));
+}
+
+TEST(WeightedGenerationCacheTest, Get_CountsHitsAndMisses) {
+    Cache cache(Cache::kUnlimitedWeight);
+    cache.put(1, &gValues[1], 1);
+
+    EXPECT_EQ(&gValues[1], cache.get(1));
+    EXPECT_TRUE(cache.get(2) == NULL);
+    EXPECT_EQ(1U, cache.getStats().hits);
+    EXPECT_EQ(1U, cache.getStats().misses);
+
+    cache.resetStats();
+    EXPECT_EQ(0U, cache.getStats().hits);
+}
+
+TEST(WeightedGenerationCacheTest, Get_RefreshesEntry) {
+    Cache cache(30);
+    cache.put(1, &gValues[1], 10);
+    cache.put(2, &gValues[2], 10);
+    cache.put(3, &gValues[3], 10);
+
+    cache.get(1);
+    cache.put(4, &gValues[4], 10);
+
+    EXPECT_TRUE(cache.contains(1));
+    EXPECT_FALSE(cache.contains(2));
+}
+
+TEST(WeightedGenerationCacheTest, Segmented_ResistsScans) {
+    Cache cache(100, Cache::kSegmented);
+    for (int i = 0; i < 4; i++) {
+        cache.put(i, &gValues[i], 10);
+        cache.get(i);
+    }
+
+    // A scan of entries used once only cycles through the probationary segment
+    for (int i = 10; i < 60; i++) {
+        EXPECT_TRUE(cache.get(i) == NULL);
+        cache.put(i, &gValues[i], 10);
+    }
+
+    for (int i = 0; i < 4; i++) {
+        EXPECT_TRUE(cache.contains(i)) << "key " << i;
+    }
+    EXPECT_LE(cache.getWeight(), 100U);
+}
+
+TEST(WeightedGenerationCacheTest, SetMaxWeight_Evicts) {
+    Cache cache(100);
+    for (int i = 0; i < 10; i++) {
+        cache.put(i, &gValues[i], 10);
+    }
+
+    cache.setMaxWeight(35);
+    EXPECT_EQ(3U, cache.size());
+    EXPECT_EQ(30U, cache.getWeight());
+    EXPECT_TRUE(cache.contains(9));
+}
+
+TEST(WeightedGenerationCacheTest, Clear_NotifiesListener) {
+    Cache cache(100);
+    RemovalCounter removed;
+    cache.setOnEntryRemovedListener(&removed);
+    cache.put(1, &gValues[1], 10);
+    cache.put(2, &gValues[2], 10);
+
+    EXPECT_EQ(&gValues[1], cache.remove(1));
+    cache.clear();
+
+    EXPECT_EQ(2, removed.count);
+    EXPECT_EQ(0U, cache.size());
+    EXPECT_EQ(0U, cache.getWeight());
+    EXPECT_EQ(0U, cache.getStats().evictions);
+}
+
+} // namespace android
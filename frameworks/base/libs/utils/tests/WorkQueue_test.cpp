@@ -0,0 +1,129 @@
+/*
+ * Copyright (C) 2011 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "WorkQueue_test"
+
+#include <utils/WorkQueue.h>
+#include <cutils/atomic.h>
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+namespace android {
+
+class CountingWorkUnit : public WorkQueue::WorkUnit {
+public:
+    CountingWorkUnit(volatile int32_t* counter, bool result = true) :
+            mCounter(counter), mResult(result) { }
+
+    virtual bool run() {
+        android_atomic_inc(mCounter);
+        return mResult;
+    }
+
+private:
+    volatile int32_t* mCounter;
+    bool mResult;
+};
+
+TEST(WorkQueueTest, Finish_RunsAllWork) {
+    volatile int32_t counter = 0;
+    WorkQueue queue(4, false);
+
+    for (int i = 0; i < 100; i++) {
+        EXPECT_EQ(OK, queue.schedule(new CountingWorkUnit(&counter)));
+    }
+    EXPECT_EQ(OK, queue.finish());
+    EXPECT_EQ(100, counter);
+
+    CountingWorkUnit late(&counter);
+    EXPECT_EQ(INVALID_OPERATION, queue.schedule(&late));
+    EXPECT_EQ(INVALID_OPERATION, queue.finish());
+}
+
+class Gate {
+public:
+    Gate() : mOpen(false) { }
+
+    void open() {
+        AutoMutex _l(mLock);
+        mOpen = true;
+        mCondition.broadcast();
+    }
+
+    void wait() {
+        AutoMutex _l(mLock);
+        while (!mOpen) {
+            mCondition.wait(mLock);
+        }
+    }
+
+private:
+    Mutex mLock;
+    Condition mCondition;
+    bool mOpen;
+};
+
+class GatedWorkUnit : public WorkQueue::WorkUnit {
+public:
+    GatedWorkUnit(Gate* gate) : mGate(gate) { }
+
+    virtual bool run() {
+        mGate->wait();
+        return true;
+    }
+
+private:
+    Gate* mGate;
+};
+
+TEST(WorkQueueTest, Cancel_DropsPendingWork) {
+    volatile int32_t counter = 0;
+    Gate gate;
+    WorkQueue queue(1, false, PRIORITY_BACKGROUND);
+
+    // Keep the only thread busy so that everything else stays pending.
+    EXPECT_EQ(OK, queue.schedule(new GatedWorkUnit(&gate), 0));
+    for (int i = 0; i < 10; i++) {
+        EXPECT_EQ(OK, queue.schedule(new CountingWorkUnit(&counter), 0));
+    }
+    EXPECT_EQ(OK, queue.cancel());
+    gate.open();
+    EXPECT_EQ(OK, queue.finish());
+
+    EXPECT_EQ(0, counter);
+    CountingWorkUnit late(&counter);
+    EXPECT_EQ(INVALID_OPERATION, queue.schedule(&late));
+}
+
+TEST(WorkQueueTest, FailingWorkUnit_CancelsQueue) {
+    volatile int32_t counter = 0;
+    WorkQueue queue(1, false);
+
+    EXPECT_EQ(OK, queue.schedule(new CountingWorkUnit(&counter, false), 0));
+    // Wait for the failing unit to run and cancel the queue.
+    while (android_atomic_acquire_load(&counter) == 0) {
+        usleep(1000);
+    }
+    usleep(10000);
+
+    CountingWorkUnit late(&counter);
+    EXPECT_EQ(INVALID_OPERATION, queue.schedule(&late));
+    EXPECT_EQ(OK, queue.finish());
+    EXPECT_EQ(1, counter);
+}
+
+} // namespace android
@@ -19,18 +19,153 @@
 #include <utils/ZipFileRO.h>
 
 #include <gtest/gtest.h>
+#include <zlib.h>
 
 #include <fcntl.h>
+#include <stdio.h>
 #include <string.h>
+#include <unistd.h>
 
 namespace android {
 
+#define TEST_ZIP_FILENAME "/ZipFileRO_test.zip"
+#define TEST_INDEX_FILENAME "/ZipFileRO_test.zip.idx"
+#define TEST_ENTRY_COUNT 50
+#define TEST_DATA_LENGTH (100 * 1024)
+
 class ZipFileROTest : public testing::Test {
 protected:
+    char mZipFileName[256];
+    char mIndexFileName[256];
+
     virtual void SetUp() {
+        const char* dir = getenv("EXTERNAL_STORAGE");
+        if (dir == NULL) {
+            dir = "/data/local/tmp";
+        }
+        snprintf(mZipFileName, sizeof(mZipFileName), "%s%s", dir, TEST_ZIP_FILENAME);
+        snprintf(mIndexFileName, sizeof(mIndexFileName), "%s%s", dir, TEST_INDEX_FILENAME);
+        unlink(mIndexFileName);
     }
 
     virtual void TearDown() {
+        unlink(mZipFileName);
+        unlink(mIndexFileName);
+    }
+
+    static unsigned char* put2LE(unsigned char* buf, unsigned int val) {
+        buf[0] = val;
+        buf[1] = val >> 8;
+        return buf + 2;
+    }
+
+    static unsigned char* put4LE(unsigned char* buf, unsigned long val) {
+        buf = put2LE(buf, val & 0xffff);
+        return put2LE(buf, val >> 16);
+    }
+
+    static void entryName(int i, char* name, size_t len) {
+        snprintf(name, len, "res/raw/entry%d.bin", i);
+    }
+
+    static unsigned char dataByte(int entry, size_t offset) {
+        return (offset * (entry + 1)) ^ (offset >> 10);
+    }
+
+    // Writes an archive of TEST_ENTRY_COUNT entries. With "deflated" set
+    // each holds TEST_DATA_LENGTH bytes of deflated data; otherwise they
+    // are empty and stored.
+    void writeZip(bool deflated = false) {
+        static unsigned char buf[1024 * 1024];
+        static unsigned char data[TEST_DATA_LENGTH];
+        unsigned char* p = buf;
+        unsigned long offsets[TEST_ENTRY_COUNT];
+        unsigned long compLens[TEST_ENTRY_COUNT];
+        char name[64];
+
+        for (int i = 0; i < TEST_ENTRY_COUNT; i++) {
+            entryName(i, name, sizeof(name));
+            offsets[i] = p - buf;
+            p = put4LE(p, 0x04034b50);
+            memset(p, 0, 22);
+            p = put2LE(p + 22, strlen(name));
+            p = put2LE(p, 0);
+            memcpy(p, name, strlen(name));
+            p += strlen(name);
+
+            compLens[i] = 0;
+            if (deflated) {
+                for (size_t j = 0; j < TEST_DATA_LENGTH; j++) {
+                    data[j] = dataByte(i, j);
+                }
+                z_stream zstream;
+                memset(&zstream, 0, sizeof(zstream));
+                ASSERT_EQ(Z_OK, deflateInit2(&zstream, Z_DEFAULT_COMPRESSION,
+                        Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY));
+                zstream.next_in = data;
+                zstream.avail_in = TEST_DATA_LENGTH;
+                zstream.next_out = p;
+                zstream.avail_out = buf + sizeof(buf) - p;
+                ASSERT_EQ(Z_STREAM_END, deflate(&zstream, Z_FINISH));
+                compLens[i] = zstream.total_out;
+                deflateEnd(&zstream);
+                p += compLens[i];
+            }
+        }
+
+        unsigned char* cd = p;
+        for (int i = 0; i < TEST_ENTRY_COUNT; i++) {
+            entryName(i, name, sizeof(name));
+            p = put4LE(p, 0x02014b50);
+            memset(p, 0, 6);
+            p = put2LE(p + 6, deflated ? ZipFileRO::kCompressDeflated : 0);
+            memset(p, 0, 8);
+            p = put4LE(p + 8, compLens[i]);
+            p = put4LE(p, deflated ? TEST_DATA_LENGTH : 0);
+            p = put2LE(p, strlen(name));
+            memset(p, 0, 12);
+            p = put4LE(p + 12, offsets[i]);
+            memcpy(p, name, strlen(name));
+            p += strlen(name);
+        }
+
+        unsigned char* eocd = p;
+        p = put4LE(p, 0x06054b50);
+        p = put4LE(p, 0);
+        p = put2LE(p, TEST_ENTRY_COUNT);
+        p = put2LE(p, TEST_ENTRY_COUNT);
+        p = put4LE(p, eocd - cd);
+        p = put4LE(p, cd - buf);
+        p = put2LE(p, 0);
+
+        int fd = ::open(mZipFileName, O_CREAT | O_TRUNC | O_WRONLY, 0644);
+        ASSERT_GE(fd, 0) << "Couldn't create " << mZipFileName;
+        ASSERT_EQ(p - buf, write(fd, buf, p - buf));
+        close(fd);
+    }
+
+    void expectAllEntries(const ZipFileRO& zip) {
+        char name[64];
+        char found[64];
+
+        EXPECT_EQ(TEST_ENTRY_COUNT, zip.getNumEntries());
+        for (int i = 0; i < TEST_ENTRY_COUNT; i++) {
+            entryName(i, name, sizeof(name));
+            ZipEntryRO entry = zip.findEntryByName(name);
+            ASSERT_TRUE(entry != NULL) << "Missing " << name;
+            EXPECT_EQ(0, zip.getEntryFileName(entry, found, sizeof(found)));
+            EXPECT_STREQ(name, found);
+        }
+        EXPECT_TRUE(zip.findEntryByName("res/raw/missing.bin") == NULL);
+    }
+
+    static void expectData(int entry, const unsigned char* data) {
+        for (size_t j = 0; j < TEST_DATA_LENGTH; j++) {
+            if (data[j] != dataByte(entry, j)) {
+                ADD_FAILURE() << "Entry " << entry << " differs at " << j;
+                return;
+            }
+        }
     }
 };
 
@@ -61,4 +196,123 @@ TEST_F(ZipFileROTest, ZipTimeConvertSuccess) {
             << "Second was improperly converted.";
 }
 
+TEST_F(ZipFileROTest, OpenWithIndex) {
+    writeZip();
+
+    // The first open builds the table and writes the index...
+    {
+        ZipFileRO zip;
+        ASSERT_EQ(OK, zip.open(mZipFileName, mIndexFileName));
+        expectAllEntries(zip);
+    }
+    EXPECT_EQ(0, access(mIndexFileName, R_OK))
+            << "Index file should have been written";
+
+    // ...and the next one maps it back.
+    ZipFileRO zip;
+    ASSERT_EQ(OK, zip.open(mZipFileName, mIndexFileName));
+    expectAllEntries(zip);
+}
+
+TEST_F(ZipFileROTest, OpenWithDamagedIndex) {
+    writeZip();
+    {
+        ZipFileRO zip;
+        ASSERT_EQ(OK, zip.open(mZipFileName, mIndexFileName));
+    }
+
+    // Point the first used slot far past the end of the Central Directory.
+    int fd = ::open(mIndexFileName, O_RDWR);
+    ASSERT_GE(fd, 0);
+    uint32_t slot[2];
+    off_t offset = 40;
+    while (pread(fd, slot, sizeof(slot), offset) == sizeof(slot) && slot[0] == 0) {
+        offset += sizeof(slot);
+    }
+    slot[0] = 0x7fffffff;
+    ASSERT_EQ((ssize_t) sizeof(slot), pwrite(fd, slot, sizeof(slot), offset));
+    close(fd);
+
+    ZipFileRO zip;
+    ASSERT_EQ(OK, zip.open(mZipFileName, mIndexFileName));
+    expectAllEntries(zip);
+}
+
+TEST_F(ZipFileROTest, FindEntriesByName) {
+    writeZip();
+
+    ZipFileRO zip;
+    ASSERT_EQ(OK, zip.open(mZipFileName));
+
+    char names[TEST_ENTRY_COUNT + 1][64];
+    const char* namePtrs[TEST_ENTRY_COUNT + 1];
+    for (int i = 0; i < TEST_ENTRY_COUNT; i++) {
+        entryName(TEST_ENTRY_COUNT - 1 - i, names[i], sizeof(names[i]));
+        namePtrs[i] = names[i];
+    }
+    strcpy(names[TEST_ENTRY_COUNT], "missing");
+    namePtrs[TEST_ENTRY_COUNT] = names[TEST_ENTRY_COUNT];
+
+    ZipEntryRO entries[TEST_ENTRY_COUNT + 1];
+    EXPECT_EQ((size_t) TEST_ENTRY_COUNT,
+            zip.findEntriesByName(namePtrs, TEST_ENTRY_COUNT + 1, entries));
+    for (int i = 0; i < TEST_ENTRY_COUNT; i++) {
+        EXPECT_EQ(zip.findEntryByName(names[i]), entries[i]);
+    }
+    EXPECT_TRUE(entries[TEST_ENTRY_COUNT] == NULL);
+}
+
+TEST_F(ZipFileROTest, UncompressEntryToFile) {
+    writeZip(true);
+
+    ZipFileRO zip;
+    ASSERT_EQ(OK, zip.open(mZipFileName));
+
+    char name[64];
+    entryName(3, name, sizeof(name));
+    ZipEntryRO entry = zip.findEntryByName(name);
+    ASSERT_TRUE(entry != NULL);
+
+    int fd = ::open(mIndexFileName, O_CREAT | O_TRUNC | O_RDWR, 0644);
+    ASSERT_GE(fd, 0);
+    ASSERT_TRUE(zip.uncompressEntry(entry, fd));
+    EXPECT_EQ(TEST_DATA_LENGTH, lseek(fd, 0, SEEK_CUR))
+            << "File position should be past the data";
+
+    static unsigned char data[TEST_DATA_LENGTH];
+    ASSERT_EQ(TEST_DATA_LENGTH, pread(fd, data, sizeof(data), 0));
+    close(fd);
+    expectData(3, data);
+}
+
+TEST_F(ZipFileROTest, UncompressEntriesConcurrently) {
+    writeZip(true);
+
+    ZipFileRO zip;
+    ASSERT_EQ(OK, zip.open(mZipFileName));
+
+    static unsigned char buffers[TEST_ENTRY_COUNT][TEST_DATA_LENGTH];
+    ZipFileRO::UncompressRequest requests[TEST_ENTRY_COUNT];
+    char name[64];
+    for (int i = 0; i < TEST_ENTRY_COUNT; i++) {
+        entryName(i, name, sizeof(name));
+        requests[i].entry = zip.findEntryByName(name);
+        requests[i].buffer = buffers[i];
+        requests[i].fd = -1;
+        ASSERT_TRUE(requests[i].entry != NULL);
+    }
+
+    EXPECT_TRUE(zip.uncompressEntries(requests, TEST_ENTRY_COUNT, 4));
+    for (int i = 0; i < TEST_ENTRY_COUNT; i++) {
+        EXPECT_TRUE(requests[i].result);
+        expectData(i, buffers[i]);
+    }
+
+    // A bad entry fails on its own without affecting the others.
+    requests[0].entry = NULL;
+    EXPECT_FALSE(zip.uncompressEntries(requests, 2, 2));
+    EXPECT_FALSE(requests[0].result);
+    EXPECT_TRUE(requests[1].result);
+}
+
 }
@@ -547,9 +547,10 @@ void SoundChannel::init(SoundPool* soundPool)
 void SoundChannel::play(const sp<Sample>& sample, int nextChannelID, float leftVolume,
         float rightVolume, int priority, int loop, float rate)
 {
-    AudioTrack* oldTrack;
-    AudioTrack* newTrack;
-    status_t status;
+    AudioTrack* oldTrack = NULL;
+    AudioTrack* newTrack = NULL;
+    status_t status = NO_ERROR;
+    bool reuseTrack = false;
 
     { // scope for the lock
         Mutex::Autolock lock(&mLock);
@@ -595,39 +596,54 @@ void SoundChannel::play(const sp<Sample>& sample, int nextChannelID, float leftV
         }
 #endif
 
-        // mToggle toggles each time a track is started on a given channel.
-        // The toggle is concatenated with the SoundChannel address and passed to AudioTrack
-        // as callback user data. This enables the detection of callbacks received from the old
-        // audio track while the new one is being started and avoids processing them with
-        // wrong audio audio buffer size  (mAudioBufferSize)
-        unsigned long toggle = mToggle ^ 1;
-        void *userData = (void *)((unsigned long)this | toggle);
         uint32_t channels = (numChannels == 2) ?
                 AUDIO_CHANNEL_OUT_STEREO : AUDIO_CHANNEL_OUT_MONO;
 
-        // do not create a new audio track if current track is compatible with sample parameters
+        // do not create a new audio track if current track is compatible with sample parameters.
+        // Same sample, rate and looping means the new track would be created with exactly the
+        // same parameters, and setting one up is most of the start latency.
+        if (mAudioTrack != NULL && mPrevSampleID == sample->sampleID() &&
+                mAudioTrack->getSampleRate() == sampleRate && (mLoop == 0) == (loop == 0)) {
+            LOGV("reusing track %p for sample %d", mAudioTrack, sample->sampleID());
+            // drop whatever the previous play left in the buffer
+            mAudioTrack->flush();
+            mAudioTrack->setVolume(leftVolume, rightVolume);
+            mAudioTrack->setLoop(0, frameCount, loop);
+            reuseTrack = true;
+        } else {
+            // mToggle toggles each time a track is started on a given channel.
+            // The toggle is concatenated with the SoundChannel address and passed to AudioTrack
+            // as callback user data. This enables the detection of callbacks received from the old
+            // audio track while the new one is being started and avoids processing them with
+            // wrong audio audio buffer size  (mAudioBufferSize)
+            unsigned long toggle = mToggle ^ 1;
+            void *userData = (void *)((unsigned long)this | toggle);
+
 #ifdef USE_SHARED_MEM_BUFFER
-        newTrack = new AudioTrack(streamType, sampleRate, sample->format(),
-                channels, sample->getIMemory(), 0, callback, userData);
+            newTrack = new AudioTrack(streamType, sampleRate, sample->format(),
+                    channels, sample->getIMemory(), 0, callback, userData);
 #else
-        newTrack = new AudioTrack(streamType, sampleRate, sample->format(),
-                channels, frameCount, 0, callback, userData, bufferFrames);
+            newTrack = new AudioTrack(streamType, sampleRate, sample->format(),
+                    channels, frameCount, 0, callback, userData, bufferFrames);
 #endif
-        oldTrack = mAudioTrack;
-        status = newTrack->initCheck();
-        if (status != NO_ERROR) {
-            LOGE("Error creating AudioTrack");
-            goto exit;
+            oldTrack = mAudioTrack;
+            status = newTrack->initCheck();
+            if (status != NO_ERROR) {
+                LOGE("Error creating AudioTrack");
+                goto exit;
+            }
+            LOGV("setVolume %p", newTrack);
+            newTrack->setVolume(leftVolume, rightVolume);
+            newTrack->setLoop(0, frameCount, loop);
+
+            // From now on, AudioTrack callbacks recevieved with previous toggle value will be
+            // ignored.
+            mToggle = toggle;
+            mAudioTrack = newTrack;
         }
-        LOGV("setVolume %p", newTrack);
-        newTrack->setVolume(leftVolume, rightVolume);
-        newTrack->setLoop(0, frameCount, loop);
-
-        // From now on, AudioTrack callbacks recevieved with previous toggle value will be ignored.
-        mToggle = toggle;
-        mAudioTrack = newTrack;
         mPos = 0;
         mSample = sample;
+        mPrevSampleID = sample->sampleID();
         mChannelID = nextChannelID;
         mPriority = priority;
         mLoop = loop;
@@ -637,8 +653,17 @@ void SoundChannel::play(const sp<Sample>& sample, int nextChannelID, float leftV
         mRate = rate;
         clearNextEvent();
         mState = PLAYING;
+        if (!reuseTrack) {
+            mAudioTrack->start();
+        }
+        mAudioBufferSize = mAudioTrack->frameCount()*mAudioTrack->frameSize();
+    }
+
+    // A stopped track waits for its callback thread to exit when restarted, and that thread
+    // may be blocked on mLock in process(), so the reused track is started without it. The
+    // sound pool lock held by our caller keeps stop() from running in between.
+    if (reuseTrack) {
         mAudioTrack->start();
-        mAudioBufferSize = newTrack->frameCount()*newTrack->frameSize();
     }
 
 exit:
@@ -63,4 +63,8 @@ LOCAL_C_INCLUDES := \
     external/expat/lib \
     system/media/audio_effects/include
 
+ifeq ($(ARCH_ARM_HAVE_NEON),true)
+    LOCAL_CFLAGS += -D__ARM_HAVE_NEON
+endif
+
 include $(BUILD_SHARED_LIBRARY)
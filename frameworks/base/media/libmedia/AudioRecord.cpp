@@ -355,7 +355,7 @@ status_t AudioRecord::stop()
     AutoMutex lock(mLock);
     if (mActive == 1) {
         mActive = 0;
-        mCblk->cv.signal();
+        mCblk->signalStep();
         mAudioRecord->stop();
         // the record head position will reset to 0, so if a marker is set, we need
         // to activate it again
@@ -497,6 +497,7 @@ status_t AudioRecord::obtainBuffer(Buffer* audioBuffer, int32_t waitCount)
     audio_track_cblk_t* cblk = mCblk;
     uint32_t framesReq = audioBuffer->frameCount;
     uint32_t waitTimeMs = (waitCount < 0) ? cblk->bufferTimeoutMs : WAIT_PERIOD_MS;
+    int32_t step;
 
     audioBuffer->frameCount  = 0;
     audioBuffer->size        = 0;
@@ -518,7 +519,7 @@ status_t AudioRecord::obtainBuffer(Buffer* audioBuffer, int32_t waitCount)
             }
             if (!(cblk->flags & CBLK_INVALID_MSK)) {
                 mLock.unlock();
-                result = cblk->cv.waitRelative(cblk->lock, milliseconds(waitTimeMs));
+                result = cblk->waitForStep_l(step, waitTimeMs);
                 cblk->lock.unlock();
                 mLock.lock();
                 if (mActive == 0) {
@@ -556,6 +557,7 @@ create_new_record:
             }
             // read the server count again
         start_loop_here:
+            step = android_atomic_acquire_load(&cblk->steps);
             framesReady = cblk->framesReady();
         }
         cblk->lock.unlock();
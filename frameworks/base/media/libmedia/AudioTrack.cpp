@@ -22,9 +22,12 @@
 #include <stdint.h>
 #include <sys/types.h>
 #include <limits.h>
+#include <time.h>
+#include <errno.h>
 
 #include <sched.h>
 #include <sys/resource.h>
+#include <sys/atomics.h>
 
 #include <private/media/AudioTrackShared.h>
 
@@ -392,7 +395,7 @@ void AudioTrack::stop()
     AutoMutex lock(mLock);
     if (mActive == 1) {
         mActive = 0;
-        mCblk->cv.signal();
+        mCblk->signalStep();
         mAudioTrack->stop();
         // Cancel loops (If we are in the middle of a loop, playback
         // would not stop until loopCount reaches 0).
@@ -443,7 +446,7 @@ void AudioTrack::flush_l()
         mAudioTrack->flush();
         // Release AudioTrack callback thread in case it was waiting for new buffers
         // in AudioTrack::obtainBuffer()
-        mCblk->cv.signal();
+        mCblk->signalStep();
     }
 }
 
@@ -750,7 +753,11 @@ status_t AudioTrack::createTrack_l(
 
         int minFrameCount = (afFrameCount*sampleRate*minBufCount)/afSampleRate;
 
-        if (sharedBuffer == 0) {
+        if (sharedBuffer == 0 && (flags & AUDIO_POLICY_OUTPUT_FLAG_FAST)) {
+            // the buffer of a fast track is sized by AudioFlinger from the mixer
+            // period, 0 lets it choose; the notification period is adjusted
+            // to the actual buffer size once the track is created
+        } else if (sharedBuffer == 0) {
             if (frameCount == 0) {
                 frameCount = minFrameCount;
             }
@@ -815,6 +822,11 @@ status_t AudioTrack::createTrack_l(
          // Force buffer full condition as data is already present in shared memory
         mCblk->stepUser(mCblk->frameCount);
     }
+    if (sharedBuffer == 0 && (flags & AUDIO_POLICY_OUTPUT_FLAG_FAST)) {
+        if (mNotificationFramesAct == 0 || mNotificationFramesAct > mCblk->frameCount/2) {
+            mNotificationFramesAct = mCblk->frameCount/2;
+        }
+    }
 
     mCblk->volumeLR = (uint32_t(uint16_t(mVolume[RIGHT] * 0x1000)) << 16) | uint16_t(mVolume[LEFT] * 0x1000);
     mCblk->sendLevel = uint16_t(mSendLevel * 0x1000);
@@ -834,6 +846,7 @@ status_t AudioTrack::obtainBuffer(Buffer* audioBuffer, int32_t waitCount)
     audio_track_cblk_t* cblk = mCblk;
     uint32_t framesReq = audioBuffer->frameCount;
     uint32_t waitTimeMs = (waitCount < 0) ? cblk->bufferTimeoutMs : WAIT_PERIOD_MS;
+    int32_t step;
 
     audioBuffer->frameCount  = 0;
     audioBuffer->size = 0;
@@ -862,7 +875,7 @@ status_t AudioTrack::obtainBuffer(Buffer* audioBuffer, int32_t waitCount)
             }
             if (!(cblk->flags & CBLK_INVALID_MSK)) {
                 mLock.unlock();
-                result = cblk->cv.waitRelative(cblk->lock, milliseconds(waitTimeMs));
+                result = cblk->waitForStep_l(step, waitTimeMs);
                 cblk->lock.unlock();
                 mLock.lock();
                 if (mActive == 0) {
@@ -907,6 +920,7 @@ create_new_track:
             }
             // read the server count again
         start_loop_here:
+            step = android_atomic_acquire_load(&cblk->steps);
             framesAvail = cblk->framesAvailable_l();
         }
         cblk->lock.unlock();
@@ -1309,7 +1323,7 @@ audio_track_cblk_t::audio_track_cblk_t()
     : lock(Mutex::SHARED), cv(Condition::SHARED), user(0), server(0),
     userBase(0), serverBase(0), buffers(0), frameCount(0),
     loopStart(UINT_MAX), loopEnd(UINT_MAX), loopCount(0), volumeLR(0),
-    sendLevel(0), flags(0)
+    sendLevel(0), flags(0), steps(0), waiters(0)
 {
 }
 
@@ -1333,7 +1347,9 @@ uint32_t audio_track_cblk_t::stepUser(uint32_t frameCount)
         userBase += this->frameCount;
     }
 
-    this->user = u;
+    // the frames written (AudioTrack) or read (AudioRecord) must be visible to the server
+    // before the new position
+    android_atomic_release_store(u, (volatile int32_t *)&this->user);
 
     // Clear flow control error condition as new data has been written/read to/from buffer.
     if (flags & CBLK_UNDERRUN_MSK) {
@@ -1345,9 +1361,15 @@ uint32_t audio_track_cblk_t::stepUser(uint32_t frameCount)
 
 bool audio_track_cblk_t::stepServer(uint32_t frameCount)
 {
-    if (!tryLock()) {
-        LOGW("stepServer() could not lock cblk");
-        return false;
+    // the loop is the only state written by both sides, and the client only sets it with
+    // the lock held: only lock when a loop is set
+    bool locked = false;
+    if (loopEnd != UINT_MAX) {
+        if (!tryLock()) {
+            LOGW("stepServer() could not lock cblk");
+            return false;
+        }
+        locked = true;
     }
 
     uint32_t s = this->server;
@@ -1381,12 +1403,12 @@ bool audio_track_cblk_t::stepServer(uint32_t frameCount)
         serverBase += this->frameCount;
     }
 
-    this->server = s;
+    android_atomic_release_store(s, (volatile int32_t *)&this->server);
 
-    if (!(flags & CBLK_INVALID_MSK)) {
-        cv.signal();
+    if (locked) {
+        lock.unlock();
     }
-    lock.unlock();
+    signalStep();
     return true;
 }
 
@@ -1404,7 +1426,7 @@ uint32_t audio_track_cblk_t::framesAvailable()
 uint32_t audio_track_cblk_t::framesAvailable_l()
 {
     uint32_t u = this->user;
-    uint32_t s = this->server;
+    uint32_t s = android_atomic_acquire_load((volatile int32_t *)&this->server);
 
     if (flags & CBLK_DIRECTION_MSK) {
         uint32_t limit = (s < loopStart) ? s : loopStart;
@@ -1416,10 +1438,12 @@ uint32_t audio_track_cblk_t::framesAvailable_l()
 
 uint32_t audio_track_cblk_t::framesReady()
 {
-    uint32_t u = this->user;
-    uint32_t s = this->server;
+    uint32_t u;
+    uint32_t s;
 
     if (flags & CBLK_DIRECTION_MSK) {
+        u = android_atomic_acquire_load((volatile int32_t *)&this->user);
+        s = this->server;
         if (u < loopEnd) {
             return u - s;
         } else {
@@ -1436,6 +1460,8 @@ uint32_t audio_track_cblk_t::framesReady()
             return frames;
         }
     } else {
+        u = this->user;
+        s = android_atomic_acquire_load((volatile int32_t *)&this->server);
         return s - u;
     }
 }
@@ -1459,6 +1485,32 @@ bool audio_track_cblk_t::tryLock()
     return true;
 }
 
+void audio_track_cblk_t::signalStep()
+{
+    // the barrier of the increment orders it with the read of waiters, as is the
+    // increment of waiters with the read of steps in waitForStep_l(): either the
+    // waiter sees the new step or it is woken up
+    android_atomic_inc(&steps);
+    if (waiters != 0) {
+        __futex_wake(&steps, INT_MAX);
+    }
+}
+
+status_t audio_track_cblk_t::waitForStep_l(int32_t step, uint32_t waitTimeMs)
+{
+    struct timespec ts;
+    ts.tv_sec = waitTimeMs / 1000;
+    ts.tv_nsec = (waitTimeMs % 1000) * 1000000;
+
+    android_atomic_inc(&waiters);
+    lock.unlock();
+    int ret = __futex_wait(&steps, step, &ts);
+    lock.lock();
+    android_atomic_dec(&waiters);
+
+    return ret == -ETIMEDOUT ? TIMED_OUT : NO_ERROR;
+}
+
 // -------------------------------------------------------------------------
 
 }; // namespace android
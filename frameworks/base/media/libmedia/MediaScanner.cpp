@@ -187,12 +187,17 @@ MediaScanResult MediaScanner::doProcessDirectoryEntry(
     }
     strcpy(fileSpot, name);
 
+    // Files and directories are stat()ed at most once, large volumes hold
+    // tens of thousands of them.
+    bool haveStat = false;
+
     int type = entry->d_type;
     if (type == DT_UNKNOWN) {
         // If the type is unknown, stat() the file instead.
         // This is sometimes necessary when accessing NFS mounted filesystems, but
         // could be needed in other cases well.
         if (stat(path, &statbuf) == 0) {
+            haveStat = true;
             if (S_ISREG(statbuf.st_mode)) {
                 type = DT_REG;
             } else if (S_ISDIR(statbuf.st_mode)) {
@@ -210,7 +215,7 @@ MediaScanResult MediaScanner::doProcessDirectoryEntry(
             childNoMedia = true;
 
         // report the directory to the client
-        if (stat(path, &statbuf) == 0) {
+        if (haveStat || stat(path, &statbuf) == 0) {
             status_t status = client.scanFile(path, statbuf.st_mtime, 0,
                     true /*isDirectory*/, childNoMedia);
             if (status) {
@@ -226,7 +231,10 @@ MediaScanResult MediaScanner::doProcessDirectoryEntry(
             return MEDIA_SCAN_RESULT_ERROR;
         }
     } else if (type == DT_REG) {
-        stat(path, &statbuf);
+        if (!haveStat && stat(path, &statbuf) != 0) {
+            LOGD("stat() failed for %s: %s", path, strerror(errno));
+            return MEDIA_SCAN_RESULT_SKIPPED;
+        }
         status_t status = client.scanFile(path, statbuf.st_mtime, statbuf.st_size,
                 false /*isDirectory*/, noMedia);
         if (status) {
@@ -29,6 +29,9 @@
 #ifdef __arm__
 #include <machine/cpu-features.h>
 #endif
+#if defined(__ARM_HAVE_NEON)
+#include <arm_neon.h>
+#endif
 
 #define LOG_FFT_SIZE 10
 #define MAX_FFT_SIZE (1 << LOG_FFT_SIZE)
@@ -104,9 +107,41 @@ static inline int32_t half(int32_t a)
 #endif
 }
 
+#if defined(__ARM_HAVE_NEON)
+/* Does the butterflies of one stage for r in [4, p), four at a time, with w
+ * holding the twiddle factor of each r. The results are identical to those of
+ * mult() and half(). There is no carry between the halves of a complex number
+ * in mult(), and none in half() either, so the 16-bit parts are computed lane
+ * by lane, while the final sums stay 32-bit as in the scalar code. */
+static void butterflies_neon(int n, int p, int32_t *v, const int32_t *w)
+{
+    for (int i = 0; i < n; i += p << 1) {
+        for (int r = 4; r < p; r += 4) {
+            int16x4x2_t a = vld2_s16((const int16_t *)&w[r]);
+            int16x4x2_t b = vld2_s16((const int16_t *)&v[i + r + p]);
+            /* val[0] are the imaginary parts, val[1] the real ones. */
+            int32x4_t re = vmull_s16(a.val[1], b.val[1]);
+            re = vmlal_s16(re, a.val[0], b.val[0]);
+            int32x4_t im = vmull_s16(a.val[1], b.val[0]);
+            im = vmlsl_s16(im, a.val[0], b.val[1]);
+            int16x4x2_t yz = vzip_s16(vshrn_n_s32(im, 16), vshrn_n_s32(re, 16));
+            int32x4_t y = vcombine_s32(vreinterpret_s32_s16(yz.val[0]),
+                    vreinterpret_s32_s16(yz.val[1]));
+            int32x4_t x = vreinterpretq_s32_s16(
+                    vshrq_n_s16(vreinterpretq_s16_s32(vld1q_s32(&v[i + r])), 1));
+            vst1q_s32(&v[i + r], vsubq_s32(x, y));
+            vst1q_s32(&v[i + r + p], vaddq_s32(x, y));
+        }
+    }
+}
+#endif
+
 void fixed_fft(int n, int32_t *v)
 {
     int scale = LOG_FFT_SIZE, i, p, r;
+#if defined(__ARM_HAVE_NEON)
+    int32_t w_neon[MAX_FFT_SIZE / 2];
+#endif
 
     for (r = 0, i = 1; i < n; ++i) {
         for (p = n; !(p & r); p >>= 1, r ^= p);
@@ -131,6 +166,12 @@ void fixed_fft(int n, int32_t *v)
             int32_t w = MAX_FFT_SIZE / 4 - (r << scale);
             i = w >> 31;
             w = twiddle[(w ^ i) - i] ^ (i << 16);
+#if defined(__ARM_HAVE_NEON)
+            if (r >= 4) {
+                w_neon[r] = w;
+                continue;
+            }
+#endif
             for (i = r; i < n; i += p << 1) {
                 int32_t x = half(v[i]);
                 int32_t y = mult(w, v[i + p]);
@@ -138,6 +179,11 @@ void fixed_fft(int n, int32_t *v)
                 v[i + p] = x + y;
             }
         }
+#if defined(__ARM_HAVE_NEON)
+        if (p > 4) {
+            butterflies_neon(n, p, v, w_neon);
+        }
+#endif
     }
 }
 
@@ -81,6 +81,10 @@ using android::Parcel;
 // Max number of entries in the filter.
 const int kMaxFilterSize = 64;  // I pulled that out of thin air.
 
+// Size in bytes of the track buffer of compressed audio, decoded by the audio
+// hardware: about 4 seconds of 128kbps MP3.
+const int kCompressedBufferSize = 64 * 1024;
+
 // FIXME: Move all the metadata related function in the Metadata.cpp
 
 
@@ -535,6 +539,12 @@ void MediaPlayerService::Client::disconnect()
 }
 
 static player_type getDefaultPlayerType() {
+    char value[PROPERTY_VALUE_MAX];
+    if (property_get("media.stagefright.use-nuplayer", value, NULL)
+            && (!strcmp("1", value) || !strcasecmp("true", value))) {
+        return NU_PLAYER;
+    }
+
     return STAGEFRIGHT_PLAYER;
 }
 
@@ -1368,7 +1378,12 @@ status_t MediaPlayerService::AudioOutput::open(
         return NO_INIT;
     }
 
-    frameCount = (sampleRate*afFrameCount*bufferCount)/afSampleRate;
+    if (audio_is_linear_pcm(format)) {
+        frameCount = (sampleRate*afFrameCount*bufferCount)/afSampleRate;
+    } else {
+        // the frames of a compressed track are bytes
+        frameCount = kCompressedBufferSize;
+    }
 
     AudioTrack *t;
     if (mCallback != NULL) {
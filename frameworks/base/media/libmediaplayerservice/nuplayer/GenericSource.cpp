@@ -0,0 +1,408 @@
+/*
+ * Copyright (C) 2011 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "GenericSource"
+#include <utils/Log.h>
+
+#include "GenericSource.h"
+
+#include "AnotherPacketSource.h"
+
+#include <media/stagefright/foundation/ABuffer.h>
+#include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/foundation/AHandler.h>
+#include <media/stagefright/foundation/ALooper.h>
+#include <media/stagefright/foundation/AMessage.h>
+#include <media/stagefright/DataSource.h>
+#include <media/stagefright/FileSource.h>
+#include <media/stagefright/MediaBuffer.h>
+#include <media/stagefright/MediaDefs.h>
+#include <media/stagefright/MediaErrors.h>
+#include <media/stagefright/MediaExtractor.h>
+#include <media/stagefright/MediaSource.h>
+#include <media/stagefright/MetaData.h>
+
+namespace android {
+
+// Number of access units read ahead per track.
+static const size_t kMaxQueuedBuffers = 64;
+
+// How long the reader waits before looking again once all queues are full.
+static const int64_t kReadRetryDelayUs = 10000ll;
+
+struct NuPlayer::GenericSource::Reader : public AHandler {
+    enum {
+        kWhatRead,
+        kWhatSeek,
+    };
+
+    Reader(GenericSource *source)
+        : mSource(source),
+          mReading(false) {
+    }
+
+    void start() {
+        (new AMessage(kWhatRead, id()))->post();
+    }
+
+    void seekTo(int64_t seekTimeUs) {
+        sp<AMessage> msg = new AMessage(kWhatSeek, id());
+        msg->setInt64("seekTimeUs", seekTimeUs);
+
+        sp<AMessage> response;
+        msg->postAndAwaitResponse(&response);
+    }
+
+protected:
+    virtual void onMessageReceived(const sp<AMessage> &msg) {
+        switch (msg->what()) {
+            case kWhatRead:
+            {
+                mReading = false;
+
+                status_t err = mSource->readMore();
+
+                if (err == OK) {
+                    mReading = true;
+                    msg->post();
+                } else if (err == -EWOULDBLOCK) {
+                    mReading = true;
+                    msg->post(kReadRetryDelayUs);
+                }
+                break;
+            }
+
+            case kWhatSeek:
+            {
+                int64_t seekTimeUs;
+                CHECK(msg->findInt64("seekTimeUs", &seekTimeUs));
+
+                mSource->onSeek(seekTimeUs);
+
+                if (!mReading) {
+                    // All tracks had reached the end, the seek rewound them.
+                    mReading = true;
+                    (new AMessage(kWhatRead, id()))->post();
+                }
+
+                uint32_t replyID;
+                CHECK(msg->senderAwaitsResponse(&replyID));
+
+                (new AMessage)->postReply(replyID);
+                break;
+            }
+
+            default:
+                TRESPASS();
+        }
+    }
+
+private:
+    GenericSource *mSource;
+
+    // true while a kWhatRead is pending.
+    bool mReading;
+
+    DISALLOW_EVIL_CONSTRUCTORS(Reader);
+};
+
+NuPlayer::GenericSource::GenericSource(
+        const char *url,
+        const KeyedVector<String8, String8> *headers)
+    : mDurationUs(0ll),
+      mAudioIsVorbis(false) {
+    DataSource::RegisterDefaultSniffers();
+
+    sp<DataSource> dataSource =
+        DataSource::CreateFromURI(url, headers);
+    CHECK(dataSource != NULL);
+
+    initFromDataSource(dataSource);
+}
+
+NuPlayer::GenericSource::GenericSource(
+        int fd, int64_t offset, int64_t length)
+    : mDurationUs(0ll),
+      mAudioIsVorbis(false) {
+    DataSource::RegisterDefaultSniffers();
+
+    sp<DataSource> dataSource = new FileSource(dup(fd), offset, length);
+
+    initFromDataSource(dataSource);
+}
+
+void NuPlayer::GenericSource::initFromDataSource(
+        const sp<DataSource> &dataSource) {
+    sp<MediaExtractor> extractor = MediaExtractor::Create(dataSource);
+
+    CHECK(extractor != NULL);
+
+    for (size_t i = 0; i < extractor->countTracks(); ++i) {
+        sp<MetaData> meta = extractor->getTrackMetaData(i);
+
+        const char *mime;
+        CHECK(meta->findCString(kKeyMIMEType, &mime));
+
+        sp<MediaSource> track;
+
+        if (!strncasecmp(mime, "audio/", 6)) {
+            if (mAudioTrack.mSource == NULL) {
+                mAudioTrack.mSource = track = extractor->getTrack(i);
+
+                if (!strcasecmp(mime, MEDIA_MIMETYPE_AUDIO_VORBIS)) {
+                    mAudioIsVorbis = true;
+                } else {
+                    mAudioIsVorbis = false;
+                }
+            }
+        } else if (!strncasecmp(mime, "video/", 6)) {
+            if (mVideoTrack.mSource == NULL) {
+                mVideoTrack.mSource = track = extractor->getTrack(i);
+            }
+        }
+
+        if (track != NULL) {
+            int64_t durationUs;
+            if (meta->findInt64(kKeyDuration, &durationUs)) {
+                if (durationUs > mDurationUs) {
+                    mDurationUs = durationUs;
+                }
+            }
+        }
+    }
+}
+
+NuPlayer::GenericSource::~GenericSource() {
+    if (mReaderLooper != NULL) {
+        mReaderLooper->unregisterHandler(mReader->id());
+        mReaderLooper->stop();
+    }
+
+    if (mAudioTrack.mSource != NULL) {
+        mAudioTrack.mSource->stop();
+    }
+
+    if (mVideoTrack.mSource != NULL) {
+        mVideoTrack.mSource->stop();
+    }
+}
+
+void NuPlayer::GenericSource::start() {
+    LOGI("start");
+
+    if (mAudioTrack.mSource != NULL) {
+        CHECK_EQ(mAudioTrack.mSource->start(), (status_t)OK);
+
+        mAudioTrack.mPackets =
+            new AnotherPacketSource(mAudioTrack.mSource->getFormat());
+    }
+
+    if (mVideoTrack.mSource != NULL) {
+        CHECK_EQ(mVideoTrack.mSource->start(), (status_t)OK);
+
+        mVideoTrack.mPackets =
+            new AnotherPacketSource(mVideoTrack.mSource->getFormat());
+    }
+
+    // Extraction runs on a looper of its own so that the next access units
+    // are already parsed when the decoders ask for them.
+    mReaderLooper = new ALooper;
+    mReaderLooper->setName("NuPlayerSource");
+    mReaderLooper->start();
+
+    mReader = new Reader(this);
+    mReaderLooper->registerHandler(mReader);
+
+    mReader->start();
+}
+
+status_t NuPlayer::GenericSource::feedMoreTSData() {
+    return OK;
+}
+
+sp<MetaData> NuPlayer::GenericSource::getFormat(bool audio) {
+    sp<MediaSource> source = audio ? mAudioTrack.mSource : mVideoTrack.mSource;
+
+    if (source == NULL) {
+        return NULL;
+    }
+
+    return source->getFormat();
+}
+
+status_t NuPlayer::GenericSource::dequeueAccessUnit(
+        bool audio, sp<ABuffer> *accessUnit) {
+    Track *track = audio ? &mAudioTrack : &mVideoTrack;
+
+    if (track->mPackets == NULL) {
+        return -EWOULDBLOCK;
+    }
+
+    status_t finalResult;
+    if (!track->mPackets->hasBufferAvailable(&finalResult)) {
+        return finalResult == OK ? -EWOULDBLOCK : finalResult;
+    }
+
+    return track->mPackets->dequeueAccessUnit(accessUnit);
+}
+
+status_t NuPlayer::GenericSource::getDuration(int64_t *durationUs) {
+    *durationUs = mDurationUs;
+    return OK;
+}
+
+status_t NuPlayer::GenericSource::seekTo(int64_t seekTimeUs) {
+    if (mReader == NULL) {
+        return INVALID_OPERATION;
+    }
+
+    mReader->seekTo(seekTimeUs);
+
+    return OK;
+}
+
+bool NuPlayer::GenericSource::isSeekable() {
+    return true;
+}
+
+status_t NuPlayer::GenericSource::readMore() {
+    bool readAny = false;
+    bool allDone = true;
+
+    for (int i = 0; i < 2; ++i) {
+        bool audio = (i == 0);
+        Track *track = audio ? &mAudioTrack : &mVideoTrack;
+
+        if (track->mPackets == NULL) {
+            continue;
+        }
+
+        status_t finalResult;
+        size_t count = track->mPackets->getAvailableBufferCount(&finalResult);
+
+        if (finalResult != OK) {
+            continue;
+        }
+
+        allDone = false;
+
+        if (count < kMaxQueuedBuffers) {
+            readBuffer(audio);
+            readAny = true;
+        }
+    }
+
+    if (allDone) {
+        return ERROR_END_OF_STREAM;
+    }
+
+    return readAny ? OK : -EWOULDBLOCK;
+}
+
+void NuPlayer::GenericSource::readBuffer(
+        bool audio, int64_t seekTimeUs, int64_t *actualTimeUs) {
+    Track *track = audio ? &mAudioTrack : &mVideoTrack;
+    CHECK(track->mSource != NULL);
+
+    if (actualTimeUs) {
+        *actualTimeUs = seekTimeUs;
+    }
+
+    MediaSource::ReadOptions options;
+
+    bool seeking = false;
+
+    if (seekTimeUs >= 0) {
+        options.setSeekTo(seekTimeUs);
+        seeking = true;
+    }
+
+    for (;;) {
+        MediaBuffer *mbuf;
+        status_t err = track->mSource->read(&mbuf, &options);
+
+        options.clearSeekTo();
+
+        if (err == OK) {
+            size_t outLength = mbuf->range_length();
+
+            if (audio && mAudioIsVorbis) {
+                outLength += sizeof(int32_t);
+            }
+
+            sp<ABuffer> buffer = new ABuffer(outLength);
+
+            memcpy(buffer->data(),
+                   (const uint8_t *)mbuf->data() + mbuf->range_offset(),
+                   mbuf->range_length());
+
+            if (audio && mAudioIsVorbis) {
+                int32_t numPageSamples;
+                if (!mbuf->meta_data()->findInt32(
+                            kKeyValidSamples, &numPageSamples)) {
+                    numPageSamples = -1;
+                }
+
+                memcpy(buffer->data() + mbuf->range_length(),
+                       &numPageSamples,
+                       sizeof(numPageSamples));
+            }
+
+            int64_t timeUs;
+            CHECK(mbuf->meta_data()->findInt64(kKeyTime, &timeUs));
+
+            buffer->meta()->setInt64("timeUs", timeUs);
+
+            if (actualTimeUs) {
+                *actualTimeUs = timeUs;
+            }
+
+            mbuf->release();
+            mbuf = NULL;
+
+            if (seeking) {
+                track->mPackets->queueDiscontinuity(
+                        ATSParser::DISCONTINUITY_SEEK, NULL);
+            }
+
+            track->mPackets->queueAccessUnit(buffer);
+            break;
+        } else if (err == INFO_FORMAT_CHANGED) {
+            // The decoder picks the new format up from the stream itself.
+            continue;
+        } else {
+            track->mPackets->signalEOS(err);
+            break;
+        }
+    }
+}
+
+void NuPlayer::GenericSource::onSeek(int64_t seekTimeUs) {
+    // Video is seeked first, audio then starts at the sync frame it landed on.
+    if (mVideoTrack.mSource != NULL) {
+        int64_t actualTimeUs;
+        readBuffer(false /* audio */, seekTimeUs, &actualTimeUs);
+
+        seekTimeUs = actualTimeUs;
+    }
+
+    if (mAudioTrack.mSource != NULL) {
+        readBuffer(true /* audio */, seekTimeUs);
+    }
+}
+
+}  // namespace android
@@ -20,6 +20,7 @@
 
 #include "NuPlayer.h"
 
+#include "GenericSource.h"
 #include "HTTPLiveSource.h"
 #include "NuPlayerDecoder.h"
 #include "NuPlayerDriver.h"
@@ -83,11 +84,40 @@ void NuPlayer::setDataSource(const sp<IStreamSource> &source) {
     msg->post();
 }
 
+static bool IsHTTPLiveURL(const char *url) {
+    if (!strncasecmp("http://", url, 7)
+            || !strncasecmp("https://", url, 8)) {
+        size_t len = strlen(url);
+        if (len >= 5 && !strcasecmp(".m3u8", &url[len - 5])) {
+            return true;
+        }
+
+        if (strstr(url,"m3u8")) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
 void NuPlayer::setDataSource(
         const char *url, const KeyedVector<String8, String8> *headers) {
     sp<AMessage> msg = new AMessage(kWhatSetDataSource, id());
 
-    msg->setObject("source", new HTTPLiveSource(url, headers, mUIDValid, mUID));
+    if (IsHTTPLiveURL(url)) {
+        msg->setObject(
+                "source", new HTTPLiveSource(url, headers, mUIDValid, mUID));
+    } else {
+        msg->setObject("source", new GenericSource(url, headers));
+    }
+
+    msg->post();
+}
+
+void NuPlayer::setDataSource(int fd, int64_t offset, int64_t length) {
+    sp<AMessage> msg = new AMessage(kWhatSetDataSource, id());
+
+    msg->setObject("source", new GenericSource(fd, offset, length));
     msg->post();
 }
 
@@ -26,14 +26,17 @@
 #include <media/stagefright/MediaErrors.h>
 #include <media/stagefright/MediaSource.h>
 #include <media/stagefright/MetaData.h>
+#include <media/stagefright/Utils.h>
 
 #include "include/AwesomePlayer.h"
+#include "include/avc_utils.h"
 
 namespace android {
 
 AudioPlayer::AudioPlayer(
         const sp<MediaPlayerBase::AudioSink> &audioSink,
-        AwesomePlayer *observer)
+        AwesomePlayer *observer,
+        bool allowOffload)
     : mAudioTrack(NULL),
       mInputBuffer(NULL),
       mSampleRate(0),
@@ -43,9 +46,15 @@ AudioPlayer::AudioPlayer(
       mPositionTimeMediaUs(-1),
       mPositionTimeRealUs(-1),
       mSeeking(false),
+      mNotifySeek(false),
       mReachedEOS(false),
       mFinalStatus(OK),
       mStarted(false),
+      mAllowOffload(allowOffload),
+      mOffload(false),
+      mPaused(false),
+      mNumBytesPlayed(0),
+      mPauseTimeUs(0),
       mIsFirstBuffer(false),
       mFirstBufferResult(OK),
       mFirstBuffer(NULL),
@@ -105,7 +114,8 @@ status_t AudioPlayer::start(bool sourceAlreadyStarted) {
     const char *mime;
     bool success = format->findCString(kKeyMIMEType, &mime);
     CHECK(success);
-    CHECK(!strcasecmp(mime, MEDIA_MIMETYPE_AUDIO_RAW));
+    mOffload = mAllowOffload && !strcasecmp(mime, MEDIA_MIMETYPE_AUDIO_MPEG);
+    CHECK(mOffload || !strcasecmp(mime, MEDIA_MIMETYPE_AUDIO_RAW));
 
     success = format->findInt32(kKeySampleRate, &mSampleRate);
     CHECK(success);
@@ -114,9 +124,25 @@ status_t AudioPlayer::start(bool sourceAlreadyStarted) {
     success = format->findInt32(kKeyChannelCount, &numChannels);
     CHECK(success);
 
+    if (mOffload && mAudioSink.get() == NULL) {
+        // only the audio sink of the media server can open compressed outputs
+        if (mFirstBuffer != NULL) {
+            mFirstBuffer->release();
+            mFirstBuffer = NULL;
+        }
+
+        if (!sourceAlreadyStarted) {
+            mSource->stop();
+        }
+
+        mOffload = false;
+        return ERROR_UNSUPPORTED;
+    }
+
     if (mAudioSink.get() != NULL) {
         status_t err = mAudioSink->open(
-                mSampleRate, numChannels, AUDIO_FORMAT_PCM_16_BIT,
+                mSampleRate, numChannels,
+                mOffload ? AUDIO_FORMAT_MP3 : AUDIO_FORMAT_PCM_16_BIT,
                 DEFAULT_AUDIOSINK_BUFFERCOUNT,
                 &AudioPlayer::AudioSinkCallback, this);
         if (err != OK) {
@@ -129,6 +155,7 @@ status_t AudioPlayer::start(bool sourceAlreadyStarted) {
                 mSource->stop();
             }
 
+            mOffload = false;
             return err;
         }
 
@@ -174,6 +201,11 @@ status_t AudioPlayer::start(bool sourceAlreadyStarted) {
 void AudioPlayer::pause(bool playPendingSamples) {
     CHECK(mStarted);
 
+    if (mOffload) {
+        mPauseTimeUs = getMediaTimeUs();
+    }
+    mPaused = true;
+
     if (playPendingSamples) {
         if (mAudioSink.get() != NULL) {
             mAudioSink->stop();
@@ -194,6 +226,17 @@ void AudioPlayer::pause(bool playPendingSamples) {
 void AudioPlayer::resume() {
     CHECK(mStarted);
 
+    if (mOffload) {
+        // the audio hardware drops what it has buffered when its output
+        // goes to standby during the pause: play again from the position
+        // at which it was paused
+        Mutex::Autolock autoLock(mLock);
+        if (!mSeeking) {
+            seekTo_l(mPauseTimeUs, false /* notify */);
+        }
+    }
+    mPaused = false;
+
     if (mAudioSink.get() != NULL) {
         mAudioSink->start();
     } else {
@@ -242,12 +285,15 @@ void AudioPlayer::reset() {
     IPCThreadState::self()->flushCommands();
 
     mNumFramesPlayed = 0;
+    mNumBytesPlayed = 0;
     mPositionTimeMediaUs = -1;
     mPositionTimeRealUs = -1;
     mSeeking = false;
     mReachedEOS = false;
     mFinalStatus = OK;
     mStarted = false;
+    mOffload = false;
+    mPaused = false;
 }
 
 // static
@@ -298,6 +344,17 @@ uint32_t AudioPlayer::getNumFramesPendingPlayout() const {
         err = mAudioTrack->getPosition(&numFramesPlayedOut);
     }
 
+    if (mOffload) {
+        // the position of the sink is in bytes of compressed data, which
+        // are converted to frames at the average rate of the stream
+        if (err != OK || mNumBytesPlayed <= numFramesPlayedOut) {
+            return 0;
+        }
+
+        return ((mNumBytesPlayed - numFramesPlayedOut) * mNumFramesPlayed)
+                / mNumBytesPlayed;
+    }
+
     if (err != OK || mNumFramesPlayed < numFramesPlayedOut) {
         return 0;
     }
@@ -346,7 +403,7 @@ size_t AudioPlayer::fillBuffer(void *data, size_t size) {
                 }
 
                 mSeeking = false;
-                if (mObserver) {
+                if (mObserver && mNotifySeek) {
                     postSeekComplete = true;
                 }
             }
@@ -383,7 +440,8 @@ size_t AudioPlayer::fillBuffer(void *data, size_t size) {
                     // These are the number of frames we're going to
                     // submit to the AudioTrack by returning from this
                     // callback.
-                    uint32_t numAdditionalFrames = size_done / mFrameSize;
+                    uint32_t numAdditionalFrames =
+                        mOffload ? 0 : size_done / mFrameSize;
 
                     numFramesPendingPlayout += numAdditionalFrames;
 
@@ -411,9 +469,25 @@ size_t AudioPlayer::fillBuffer(void *data, size_t size) {
             CHECK(mInputBuffer->meta_data()->findInt64(
                         kKeyTime, &mPositionTimeMediaUs));
 
-            mPositionTimeRealUs =
-                ((mNumFramesPlayed + size_done / mFrameSize) * 1000000)
-                    / mSampleRate;
+            if (mOffload) {
+                mPositionTimeRealUs = (mNumFramesPlayed * 1000000) / mSampleRate;
+
+                // the extractor outputs one MPEG audio frame per buffer
+                const uint8_t *frame = (const uint8_t *)mInputBuffer->data()
+                        + mInputBuffer->range_offset();
+                size_t frameSize;
+                int numSamples;
+                if (mInputBuffer->range_length() >= 4
+                        && GetMPEGAudioFrameSize(
+                            U32_AT(frame), &frameSize, NULL, NULL, NULL,
+                            &numSamples)) {
+                    mNumFramesPlayed += numSamples;
+                }
+            } else {
+                mPositionTimeRealUs =
+                    ((mNumFramesPlayed + size_done / mFrameSize) * 1000000)
+                        / mSampleRate;
+            }
 
             LOGV("buffer->size() = %d, "
                  "mPositionTimeMediaUs=%.2f mPositionTimeRealUs=%.2f",
@@ -446,7 +520,11 @@ size_t AudioPlayer::fillBuffer(void *data, size_t size) {
 
     {
         Mutex::Autolock autoLock(mLock);
-        mNumFramesPlayed += size_done / mFrameSize;
+        if (mOffload) {
+            mNumBytesPlayed += size_done;
+        } else {
+            mNumFramesPlayed += size_done / mFrameSize;
+        }
     }
 
     if (postEOS) {
@@ -468,6 +546,12 @@ int64_t AudioPlayer::getRealTimeUs() {
 int64_t AudioPlayer::getRealTimeUsLocked() const {
     CHECK(mStarted);
     CHECK_NE(mSampleRate, 0);
+    if (mOffload) {
+        // the sink buffers seconds of compressed audio
+        return -mLatencyUs
+            + ((mNumFramesPlayed - getNumFramesPendingPlayout()) * 1000000)
+                / mSampleRate;
+    }
     return -mLatencyUs + (mNumFramesPlayed * 1000000) / mSampleRate;
 }
 
@@ -483,7 +567,9 @@ int64_t AudioPlayer::getMediaTimeUs() {
     }
 
     int64_t realTimeOffset = getRealTimeUsLocked() - mPositionTimeRealUs;
-    if (realTimeOffset < 0) {
+    if (realTimeOffset < 0 && !mOffload) {
+        // in offload mode the last buffer read is far ahead of what is
+        // heard and the offset is negative
         realTimeOffset = 0;
     }
 
@@ -503,21 +589,40 @@ bool AudioPlayer::getMediaTimeMapping(
 status_t AudioPlayer::seekTo(int64_t time_us) {
     Mutex::Autolock autoLock(mLock);
 
+    seekTo_l(time_us, true /* notify */);
+
+    return OK;
+}
+
+void AudioPlayer::seekTo_l(int64_t time_us, bool notify) {
     mSeeking = true;
+    mNotifySeek = notify;
     mPositionTimeRealUs = mPositionTimeMediaUs = -1;
     mReachedEOS = false;
     mSeekTimeUs = time_us;
+    mPauseTimeUs = time_us;
 
     // Flush resets the number of played frames
     mNumFramesPlayed = 0;
+    mNumBytesPlayed = 0;
 
-    if (mAudioSink != NULL) {
+    if (mOffload) {
+        flushOffload_l();
+    } else if (mAudioSink != NULL) {
         mAudioSink->flush();
     } else {
         mAudioTrack->flush();
     }
+}
 
-    return OK;
+void AudioPlayer::flushOffload_l() {
+    // the sink only flushes a paused track, and the compressed audio it
+    // holds is too long to be played out before the seek
+    mAudioSink->pause();
+    mAudioSink->flush();
+    if (!mPaused) {
+        mAudioSink->start();
+    }
 }
 
 }
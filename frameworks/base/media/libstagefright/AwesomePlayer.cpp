@@ -69,6 +69,10 @@ static int64_t kHighWaterMarkRTSPUs = 4000000ll;  // 4secs
 static const size_t kLowWaterMarkBytes = 40000;
 static const size_t kHighWaterMarkBytes = 200000;
 
+// The periodic buffering and video lag checks don't need to be punctual,
+// they may be delayed to fire along with another event.
+static const int64_t kPeriodicCheckSlackUs = 250000ll;
+
 struct AwesomeEvent : public TimedEventQueue::Event {
     AwesomeEvent(
             AwesomePlayer *player,
@@ -879,7 +883,8 @@ status_t AwesomePlayer::play_l() {
     if (mAudioSource != NULL) {
         if (mAudioPlayer == NULL) {
             if (mAudioSink != NULL) {
-                mAudioPlayer = new AudioPlayer(mAudioSink, this);
+                mAudioPlayer = new AudioPlayer(
+                        mAudioSink, this, (mFlags & AUDIO_OFFLOAD) != 0);
                 mAudioPlayer->setSource(mAudioSource);
 
                 mTimeSource = mAudioPlayer;
@@ -966,6 +971,15 @@ status_t AwesomePlayer::startAudioPlayer_l(bool sendErrorNotification) {
         status_t err = mAudioPlayer->start(
                 true /* sourceAlreadyStarted */);
 
+        if (err != OK && (mFlags & AUDIO_OFFLOAD)) {
+            err = fallBackFromAudioOffload_l();
+            if (err == OK) {
+                modifyFlags(AUDIOPLAYER_STARTED, SET);
+                wasSeeking = mAudioPlayer->isSeeking();
+                err = mAudioPlayer->start(true /* sourceAlreadyStarted */);
+            }
+        }
+
         if (err != OK) {
             if (sendErrorNotification) {
                 notifyListener_l(MEDIA_ERROR, MEDIA_ERROR_UNKNOWN, err);
@@ -1079,12 +1093,20 @@ void AwesomePlayer::initRenderer_l() {
     // before creating a new one.
     IPCThreadState::self()->flushCommands();
 
+    int32_t rendersToNativeWindow;
+    if (!meta->findInt32(kKeyRendersToNativeWindow, &rendersToNativeWindow)) {
+        rendersToNativeWindow = false;
+    }
+
     if (USE_SURFACE_ALLOC
-            && !strncmp(component, "OMX.", 4)
-            && strncmp(component, "OMX.google.", 11)) {
+            && ((!strncmp(component, "OMX.", 4)
+                    && strncmp(component, "OMX.google.", 11))
+                || rendersToNativeWindow)) {
         // Hardware decoders avoid the CPU color conversion by decoding
         // directly to ANativeBuffers, so we must use a renderer that
-        // just pushes those buffers to the ANativeWindow.
+        // just pushes those buffers to the ANativeWindow. Software
+        // decoders supporting it write their output into those buffers
+        // as well, saving the copy of the local renderer.
         mVideoRenderer =
             new AwesomeNativeWindowRenderer(mNativeWindow, rotationDegrees);
     } else {
@@ -1375,6 +1397,57 @@ status_t AwesomePlayer::seekTo_l(int64_t timeUs) {
     return OK;
 }
 
+// Long audio only playback of MP3 is the case worth keeping the application
+// processor asleep for; the audio hardware may still refuse the stream, see
+// fallBackFromAudioOffload_l().
+bool AwesomePlayer::shouldOffloadAudio(const char *mime) const {
+    if (mVideoTrack != NULL || mAudioSink == NULL
+            || strcasecmp(mime, MEDIA_MIMETYPE_AUDIO_MPEG)) {
+        return false;
+    }
+
+    char value[PROPERTY_VALUE_MAX];
+    return property_get("media.stagefright.audio-offload", value, NULL)
+        && (!strcmp(value, "1") || !strcasecmp(value, "true"));
+}
+
+// The audio hardware did not accept the compressed stream: decode it.
+status_t AwesomePlayer::fallBackFromAudioOffload_l() {
+    LOGI("audio offload not supported, decoding audio");
+
+    modifyFlags(AUDIO_OFFLOAD | AUDIOPLAYER_STARTED, CLEAR);
+
+    bool timeSourceIsAudioPlayer = (mTimeSource == mAudioPlayer);
+    delete mAudioPlayer;
+    mAudioPlayer = NULL;
+
+    // the decoder starts the track again
+    mAudioSource->stop();
+    mAudioSource = OMXCodec::Create(
+            mClient.interface(), mAudioTrack->getFormat(),
+            false, // createEncoder
+            mAudioTrack);
+
+    status_t err = mAudioSource != NULL ? mAudioSource->start() : UNKNOWN_ERROR;
+    if (err != OK) {
+        mAudioSource.clear();
+        if (timeSourceIsAudioPlayer) {
+            mTimeSource = NULL;
+        }
+        return err;
+    }
+
+    mAudioPlayer = new AudioPlayer(mAudioSink, this);
+    mAudioPlayer->setSource(mAudioSource);
+    if (timeSourceIsAudioPlayer) {
+        mTimeSource = mAudioPlayer;
+    }
+
+    seekAudioIfNecessary_l();
+
+    return OK;
+}
+
 void AwesomePlayer::seekAudioIfNecessary_l() {
     if (mSeeking != NO_SEEK && mVideoSource == NULL && mAudioPlayer != NULL) {
         mAudioPlayer->seekTo(mSeekTimeUs);
@@ -1416,6 +1489,9 @@ status_t AwesomePlayer::initAudioDecoder() {
 
     if (!strcasecmp(mime, MEDIA_MIMETYPE_AUDIO_RAW)) {
         mAudioSource = mAudioTrack;
+    } else if (shouldOffloadAudio(mime)) {
+        modifyFlags(AUDIO_OFFLOAD, SET);
+        mAudioSource = mAudioTrack;
     } else {
         mAudioSource = OMXCodec::Create(
                 mClient.interface(), mAudioTrack->getFormat(),
@@ -1868,7 +1944,8 @@ void AwesomePlayer::postBufferingEvent_l() {
         return;
     }
     mBufferingEventPending = true;
-    mQueue.postEventWithDelay(mBufferingEvent, 1000000ll);
+    mQueue.postEventWithDelay(
+            mBufferingEvent, 1000000ll, kPeriodicCheckSlackUs);
 }
 
 void AwesomePlayer::postVideoLagEvent_l() {
@@ -1876,7 +1953,8 @@ void AwesomePlayer::postVideoLagEvent_l() {
         return;
     }
     mVideoLagEventPending = true;
-    mQueue.postEventWithDelay(mVideoLagEvent, 1000000ll);
+    mQueue.postEventWithDelay(
+            mVideoLagEvent, 1000000ll, kPeriodicCheckSlackUs);
 }
 
 void AwesomePlayer::postCheckAudioStatusEvent(int64_t delayUs) {
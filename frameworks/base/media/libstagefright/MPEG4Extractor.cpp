@@ -44,10 +44,14 @@ namespace android {
 class MPEG4Source : public MediaSource {
 public:
     // Caller retains ownership of both "dataSource" and "sampleTable".
+    // The samples of a fragmented track are read from the movie fragments
+    // starting at "firstMoofOffset" instead of from its sample table.
     MPEG4Source(const sp<MetaData> &format,
                 const sp<DataSource> &dataSource,
                 int32_t timeScale,
-                const sp<SampleTable> &sampleTable);
+                const sp<SampleTable> &sampleTable,
+                const MPEG4Extractor::TrackExtends *trackExtends = NULL,
+                off64_t firstMoofOffset = -1);
 
     virtual status_t start(MetaData *params = NULL);
     virtual status_t stop();
@@ -82,6 +86,84 @@ private:
 
     uint8_t *mSrcBuffer;
 
+    // Fragmented tracks: only the samples of the movie fragment being read
+    // are known, mCurrentSampleIndex is the index of the next one in
+    // mFragmentSamples. The fragments are parsed as they are reached so
+    // that playback starts as soon as the first one is available.
+    enum {
+        kBaseDataOffsetPresent          = 0x01,
+        kSampleDescriptionIndexPresent  = 0x02,
+        kDefaultSampleDurationPresent   = 0x08,
+        kDefaultSampleSizePresent       = 0x10,
+        kDefaultSampleFlagsPresent      = 0x20,
+    };
+
+    enum {
+        kDataOffsetPresent              = 0x01,
+        kFirstSampleFlagsPresent        = 0x04,
+        kSampleDurationPresent          = 0x100,
+        kSampleSizePresent              = 0x200,
+        kSampleFlagsPresent             = 0x400,
+        kSampleCompositionOffsetPresent = 0x800,
+    };
+
+    enum {
+        kSampleIsNonSyncSample          = 0x10000,
+    };
+
+    struct FragmentSample {
+        off64_t offset;
+        size_t size;
+        uint64_t decodingTime;
+        int32_t compositionOffset;
+        bool isSyncSample;
+    };
+
+    // Decoding time of the first sample of a movie fragment.
+    struct FragmentEntry {
+        uint64_t time;
+        off64_t moofOffset;
+    };
+
+    struct TrackFragmentHeader {
+        off64_t baseDataOffset;
+        uint32_t defaultSampleDuration;
+        uint32_t defaultSampleSize;
+        uint32_t defaultSampleFlags;
+    };
+
+    bool mIsFragmented;
+    uint32_t mTrackID;
+    MPEG4Extractor::TrackExtends mTrackExtends;
+    size_t mMaxSampleSize;
+    off64_t mFirstMoofOffset;
+    off64_t mNextMoofOffset;
+    uint64_t mNextFragmentTime;
+    Vector<FragmentSample> mFragmentSamples;
+
+    // Where the fragments start, from the movie fragment random access box
+    // when the file ends with one, or else the fragments parsed so far.
+    Vector<FragmentEntry> mFragments;
+    bool mRandomAccessChecked;
+    bool mHasRandomAccess;
+
+    status_t parseNextFragment();
+    status_t parseMovieFragment(
+            off64_t moofOffset, off64_t data_offset, off64_t data_size);
+    status_t parseTrackFragment(
+            const uint8_t *data, size_t size, off64_t moofOffset);
+    status_t parseTrackRun(
+            const uint8_t *data, size_t size,
+            const TrackFragmentHeader &header,
+            off64_t *dataOffset, uint64_t *time);
+    void parseRandomAccess();
+    status_t getFragmentSample(
+            off64_t *offset, size_t *size, int64_t *timeUs,
+            bool *isSyncSample);
+    status_t seekFragment(
+            int64_t seekTimeUs, ReadOptions::SeekMode mode,
+            int64_t *targetSampleTimeUs);
+
     size_t parseNALSize(const uint8_t *data) const;
 
     MPEG4Source(const MPEG4Source &);
@@ -268,6 +350,9 @@ MPEG4Extractor::MPEG4Extractor(const sp<DataSource> &source)
       mFirstTrack(NULL),
       mLastTrack(NULL),
       mFileMetaData(new MetaData),
+      mMovieTimescale(0),
+      mFragmentDuration(-1),
+      mFirstMoofOffset(-1),
       mFirstSINF(NULL),
       mIsDrm(false) {
 }
@@ -714,6 +799,8 @@ status_t MPEG4Extractor::parseChunk(off64_t *offset, int depth) {
                 track->meta = new MetaData;
                 track->includes_expensive_metadata = false;
                 track->skipTrack = false;
+                track->hasTrackExtends = false;
+                track->isFragmented = false;
                 track->timescale = 0;
                 track->meta->setCString(kKeyMIMEType, "application/octet-stream");
             }
@@ -756,6 +843,10 @@ status_t MPEG4Extractor::parseChunk(off64_t *offset, int depth) {
                     return err;
                 }
             } else if (chunk_type == FOURCC('m', 'o', 'o', 'v')) {
+                // The movie fragments, if any, follow the movie box.
+                mFirstMoofOffset = *offset;
+                setupFragmentedTracks();
+
                 mInitCheck = OK;
 
                 if (!mIsDrm) {
@@ -778,6 +869,43 @@ status_t MPEG4Extractor::parseChunk(off64_t *offset, int depth) {
             break;
         }
 
+        case FOURCC('m', 'e', 'h', 'd'):
+        {
+            uint8_t header[12];
+            if (chunk_data_size < 8) {
+                return ERROR_MALFORMED;
+            }
+
+            size_t size = chunk_data_size < 12 ? 8 : 12;
+            if (mDataSource->readAt(data_offset, header, size)
+                    < (ssize_t)size) {
+                return ERROR_IO;
+            }
+
+            if (header[0] == 1) {
+                if (size < 12) {
+                    return ERROR_MALFORMED;
+                }
+                mFragmentDuration = U64_AT(&header[4]);
+            } else {
+                mFragmentDuration = U32_AT(&header[4]);
+            }
+
+            *offset += chunk_size;
+            break;
+        }
+
+        case FOURCC('t', 'r', 'e', 'x'):
+        {
+            status_t err;
+            if ((err = parseTrackExtends(data_offset, chunk_data_size)) != OK) {
+                return err;
+            }
+
+            *offset += chunk_size;
+            break;
+        }
+
         case FOURCC('m', 'd', 'h', 'd'):
         {
             if (chunk_data_size < 4) {
@@ -1283,24 +1411,29 @@ status_t MPEG4Extractor::parseChunk(off64_t *offset, int depth) {
 
         case FOURCC('m', 'v', 'h', 'd'):
         {
-            if (chunk_data_size < 12) {
+            if (chunk_data_size < 16) {
                 return ERROR_MALFORMED;
             }
 
-            uint8_t header[12];
-            if (mDataSource->readAt(
-                        data_offset, header, sizeof(header))
-                    < (ssize_t)sizeof(header)) {
+            uint8_t header[24];
+            size_t size = chunk_data_size < 24 ? 16 : 24;
+            if (mDataSource->readAt(data_offset, header, size)
+                    < (ssize_t)size) {
                 return ERROR_IO;
             }
 
             int64_t creationTime;
             if (header[0] == 1) {
+                if (size < 24) {
+                    return ERROR_MALFORMED;
+                }
                 creationTime = U64_AT(&header[4]);
+                mMovieTimescale = U32_AT(&header[20]);
             } else if (header[0] != 0) {
                 return ERROR_MALFORMED;
             } else {
                 creationTime = U32_AT(&header[4]);
+                mMovieTimescale = U32_AT(&header[12]);
             }
 
             String8 s;
@@ -1642,6 +1775,85 @@ status_t MPEG4Extractor::parseMetaData(off64_t offset, size_t size) {
     return OK;
 }
 
+status_t MPEG4Extractor::parseTrackExtends(
+        off64_t data_offset, off64_t data_size) {
+    uint8_t buffer[24];
+    if (data_size < (off64_t)sizeof(buffer)) {
+        return ERROR_MALFORMED;
+    }
+
+    if (mDataSource->readAt(
+                data_offset, buffer, sizeof(buffer)) < (ssize_t)sizeof(buffer)) {
+        return ERROR_IO;
+    }
+
+    uint32_t id = U32_AT(&buffer[4]);
+
+    for (Track *track = mFirstTrack; track != NULL; track = track->next) {
+        int32_t trackID;
+        if (track->meta->findInt32(kKeyTrackID, &trackID)
+                && (uint32_t)trackID == id) {
+            track->hasTrackExtends = true;
+            track->trackExtends.defaultSampleDuration = U32_AT(&buffer[12]);
+            track->trackExtends.defaultSampleSize = U32_AT(&buffer[16]);
+            track->trackExtends.defaultSampleFlags = U32_AT(&buffer[20]);
+            break;
+        }
+    }
+
+    return OK;
+}
+
+// The sample sizes of a fragmented track are only known one fragment at a
+// time, so its buffers are made large enough for an uncompressed video
+// frame, or for these if the frame size is not known.
+static const int32_t kFragmentedAudioMaxSampleSize = 16 * 1024;
+static const int32_t kFragmentedVideoMaxSampleSize = 1024 * 1024;
+static const int32_t kFragmentedVideoMinSampleSize = 64 * 1024;
+
+void MPEG4Extractor::setupFragmentedTracks() {
+    for (Track *track = mFirstTrack; track != NULL; track = track->next) {
+        if (!track->hasTrackExtends || track->sampleTable == NULL
+                || track->sampleTable->countSamples() > 0) {
+            continue;
+        }
+
+        track->isFragmented = true;
+
+        int64_t durationUs;
+        if ((!track->meta->findInt64(kKeyDuration, &durationUs)
+                    || durationUs <= 0)
+                && mFragmentDuration > 0 && mMovieTimescale > 0) {
+            track->meta->setInt64(
+                    kKeyDuration,
+                    (mFragmentDuration * 1000000) / mMovieTimescale);
+        }
+
+        const char *mime;
+        CHECK(track->meta->findCString(kKeyMIMEType, &mime));
+
+        int32_t max_size = kFragmentedAudioMaxSampleSize;
+        if (!strncasecmp("video/", mime, 6)) {
+            int32_t width, height;
+            if (track->meta->findInt32(kKeyWidth, &width)
+                    && track->meta->findInt32(kKeyHeight, &height)
+                    && width > 0 && height > 0
+                    && width <= 8192 && height <= 8192) {
+                max_size = width * height * 3 / 2;
+                if (max_size < kFragmentedVideoMinSampleSize) {
+                    max_size = kFragmentedVideoMinSampleSize;
+                }
+            } else {
+                max_size = kFragmentedVideoMaxSampleSize;
+            }
+        }
+
+        // Same allowance for the NAL length to start code conversion as
+        // for the regular tracks.
+        track->meta->setInt32(kKeyMaxInputSize, max_size + 10 * 2);
+    }
+}
+
 sp<MediaSource> MPEG4Extractor::getTrack(size_t index) {
     status_t err;
     if ((err = readMetaData()) != OK) {
@@ -1662,6 +1874,12 @@ sp<MediaSource> MPEG4Extractor::getTrack(size_t index) {
         return NULL;
     }
 
+    if (track->isFragmented) {
+        return new MPEG4Source(
+                track->meta, mDataSource, track->timescale, track->sampleTable,
+                &track->trackExtends, mFirstMoofOffset);
+    }
+
     return new MPEG4Source(
             track->meta, mDataSource, track->timescale, track->sampleTable);
 }
@@ -1809,7 +2027,9 @@ MPEG4Source::MPEG4Source(
         const sp<MetaData> &format,
         const sp<DataSource> &dataSource,
         int32_t timeScale,
-        const sp<SampleTable> &sampleTable)
+        const sp<SampleTable> &sampleTable,
+        const MPEG4Extractor::TrackExtends *trackExtends,
+        off64_t firstMoofOffset)
     : mFormat(format),
       mDataSource(dataSource),
       mTimescale(timeScale),
@@ -1821,11 +2041,27 @@ MPEG4Source::MPEG4Source(
       mGroup(NULL),
       mBuffer(NULL),
       mWantsNALFragments(false),
-      mSrcBuffer(NULL) {
+      mSrcBuffer(NULL),
+      mIsFragmented(trackExtends != NULL),
+      mTrackID(0),
+      mMaxSampleSize(0),
+      mFirstMoofOffset(firstMoofOffset),
+      mNextMoofOffset(firstMoofOffset),
+      mNextFragmentTime(0),
+      mRandomAccessChecked(false),
+      mHasRandomAccess(false) {
     const char *mime;
     bool success = mFormat->findCString(kKeyMIMEType, &mime);
     CHECK(success);
 
+    if (mIsFragmented) {
+        mTrackExtends = *trackExtends;
+
+        int32_t trackID;
+        CHECK(mFormat->findInt32(kKeyTrackID, &trackID));
+        mTrackID = trackID;
+    }
+
     mIsAVC = !strcasecmp(mime, MEDIA_MIMETYPE_VIDEO_AVC);
 
     if (mIsAVC) {
@@ -1871,6 +2107,7 @@ status_t MPEG4Source::start(MetaData *params) {
     mGroup->add_buffer(new MediaBuffer(max_size));
 
     mSrcBuffer = new uint8_t[max_size];
+    mMaxSampleSize = max_size;
 
     mStarted = true;
 
@@ -1896,6 +2133,10 @@ status_t MPEG4Source::stop() {
     mStarted = false;
     mCurrentSampleIndex = 0;
 
+    mNextMoofOffset = mFirstMoofOffset;
+    mNextFragmentTime = 0;
+    mFragmentSamples.clear();
+
     return OK;
 }
 
@@ -1936,7 +2177,19 @@ status_t MPEG4Source::read(
 
     int64_t seekTimeUs;
     ReadOptions::SeekMode mode;
-    if (options && options->getSeekTo(&seekTimeUs, &mode)) {
+    bool seeking = options && options->getSeekTo(&seekTimeUs, &mode);
+    if (seeking && mIsFragmented) {
+        status_t err = seekFragment(seekTimeUs, mode, &targetSampleTimeUs);
+
+        if (mBuffer != NULL) {
+            mBuffer->release();
+            mBuffer = NULL;
+        }
+
+        if (err != OK) {
+            return err;
+        }
+    } else if (seeking) {
         uint32_t findFlags = 0;
         switch (mode) {
             case ReadOptions::SEEK_PREVIOUS_SYNC:
@@ -2017,15 +2270,21 @@ status_t MPEG4Source::read(
 
     off64_t offset;
     size_t size;
-    uint32_t cts;
+    int64_t timeUs;
     bool isSyncSample;
     bool newBuffer = false;
     if (mBuffer == NULL) {
         newBuffer = true;
 
-        status_t err =
-            mSampleTable->getMetaDataForSample(
+        status_t err;
+        if (mIsFragmented) {
+            err = getFragmentSample(&offset, &size, &timeUs, &isSyncSample);
+        } else {
+            uint32_t cts;
+            err = mSampleTable->getMetaDataForSample(
                     mCurrentSampleIndex, &offset, &size, &cts, &isSyncSample);
+            timeUs = ((int64_t)cts * 1000000) / mTimescale;
+        }
 
         if (err != OK) {
             return err;
@@ -2054,8 +2313,7 @@ status_t MPEG4Source::read(
             CHECK(mBuffer != NULL);
             mBuffer->set_range(0, size);
             mBuffer->meta_data()->clear();
-            mBuffer->meta_data()->setInt64(
-                    kKeyTime, ((int64_t)cts * 1000000) / mTimescale);
+            mBuffer->meta_data()->setInt64(kKeyTime, timeUs);
 
             if (targetSampleTimeUs >= 0) {
                 mBuffer->meta_data()->setInt64(
@@ -2176,8 +2434,7 @@ status_t MPEG4Source::read(
         }
 
         mBuffer->meta_data()->clear();
-        mBuffer->meta_data()->setInt64(
-                kKeyTime, ((int64_t)cts * 1000000) / mTimescale);
+        mBuffer->meta_data()->setInt64(kKeyTime, timeUs);
 
         if (targetSampleTimeUs >= 0) {
             mBuffer->meta_data()->setInt64(
@@ -2197,6 +2454,567 @@ status_t MPEG4Source::read(
     }
 }
 
+////////////////////////////////////////////////////////////////////////////////
+
+// A movie fragment box only describes samples, anything larger is taken for
+// a corrupt file rather than read in memory.
+static const off64_t kMaxMovieFragmentSize = 4 * 1024 * 1024;
+static const size_t kMaxFragmentSamples = 256 * 1024;
+static const uint32_t kMaxRandomAccessSize = 4 * 1024 * 1024;
+
+// Steps through the boxes held in "data", returns false at the end of the
+// data or on a box that does not fit in it.
+static bool nextBox(
+        const uint8_t *data, size_t size, size_t *offset,
+        uint32_t *type, const uint8_t **boxData, size_t *boxSize) {
+    if (*offset > size || size - *offset < 8) {
+        return false;
+    }
+
+    const uint8_t *ptr = &data[*offset];
+    uint64_t chunk_size = U32_AT(ptr);
+    size_t header_size = 8;
+
+    if (chunk_size == 1) {
+        if (size - *offset < 16) {
+            return false;
+        }
+        chunk_size = U64_AT(&ptr[8]);
+        header_size = 16;
+    } else if (chunk_size == 0) {
+        chunk_size = size - *offset;
+    }
+
+    if (chunk_size < header_size || chunk_size > size - *offset) {
+        return false;
+    }
+
+    *type = U32_AT(&ptr[4]);
+    *boxData = &ptr[header_size];
+    *boxSize = chunk_size - header_size;
+    *offset += chunk_size;
+
+    return true;
+}
+
+status_t MPEG4Source::parseNextFragment() {
+    mFragmentSamples.clear();
+    mCurrentSampleIndex = 0;
+
+    while (mFragmentSamples.isEmpty()) {
+        uint8_t header[16];
+        ssize_t n = mDataSource->readAt(mNextMoofOffset, header, 8);
+        if (n < 8) {
+            return (n < 0 && n != ERROR_END_OF_STREAM)
+                ? ERROR_IO : ERROR_END_OF_STREAM;
+        }
+
+        uint64_t chunk_size = U32_AT(header);
+        uint32_t chunk_type = U32_AT(&header[4]);
+        off64_t moofOffset = mNextMoofOffset;
+        off64_t data_offset = moofOffset + 8;
+
+        if (chunk_size == 1) {
+            if (mDataSource->readAt(moofOffset + 8, &header[8], 8) < 8) {
+                return ERROR_IO;
+            }
+            chunk_size = U64_AT(&header[8]);
+            data_offset += 8;
+        } else if (chunk_size == 0) {
+            // The box extends to the end of the file, no fragment follows.
+            return ERROR_END_OF_STREAM;
+        }
+
+        if (chunk_size < (uint64_t)(data_offset - moofOffset)) {
+            return ERROR_MALFORMED;
+        }
+
+        mNextMoofOffset += chunk_size;
+
+        // Skip the media data and whatever else lies between the fragments.
+        if (chunk_type != FOURCC('m', 'o', 'o', 'f')) {
+            continue;
+        }
+
+        status_t err = parseMovieFragment(
+                moofOffset, data_offset, mNextMoofOffset - data_offset);
+
+        if (err != OK) {
+            return err;
+        }
+
+        if (!mHasRandomAccess && !mFragmentSamples.isEmpty()
+                && (mFragments.isEmpty()
+                    || mFragments.top().moofOffset < moofOffset)) {
+            FragmentEntry entry;
+            entry.time = mFragmentSamples.itemAt(0).decodingTime;
+            entry.moofOffset = moofOffset;
+            mFragments.push(entry);
+        }
+    }
+
+    return OK;
+}
+
+status_t MPEG4Source::parseMovieFragment(
+        off64_t moofOffset, off64_t data_offset, off64_t data_size) {
+    if (data_size > kMaxMovieFragmentSize) {
+        LOGE("movie fragment of %lld bytes is too large.", data_size);
+        return ERROR_MALFORMED;
+    }
+
+    uint8_t *data = new uint8_t[data_size];
+    if (mDataSource->readAt(data_offset, data, data_size)
+            < (ssize_t)data_size) {
+        delete[] data;
+        return ERROR_IO;
+    }
+
+    status_t err = OK;
+
+    size_t offset = 0;
+    uint32_t type;
+    const uint8_t *box;
+    size_t box_size;
+    while (err == OK
+            && nextBox(data, data_size, &offset, &type, &box, &box_size)) {
+        if (type == FOURCC('t', 'r', 'a', 'f')) {
+            err = parseTrackFragment(box, box_size, moofOffset);
+        }
+    }
+
+    delete[] data;
+    data = NULL;
+
+    return err;
+}
+
+status_t MPEG4Source::parseTrackFragment(
+        const uint8_t *data, size_t size, off64_t moofOffset) {
+    TrackFragmentHeader header;
+    bool foundHeader = false;
+    off64_t dataOffset = moofOffset;
+    uint64_t time = mNextFragmentTime;
+
+    size_t offset = 0;
+    uint32_t type;
+    const uint8_t *box;
+    size_t box_size;
+    while (nextBox(data, size, &offset, &type, &box, &box_size)) {
+        switch (type) {
+            case FOURCC('t', 'f', 'h', 'd'):
+            {
+                if (box_size < 8) {
+                    return ERROR_MALFORMED;
+                }
+
+                if (U32_AT(&box[4]) != mTrackID) {
+                    // The fragment of another track.
+                    return OK;
+                }
+
+                uint32_t flags = U32_AT(box) & 0xffffff;
+
+                size_t required = 8;
+                if (flags & kBaseDataOffsetPresent) {
+                    required += 8;
+                }
+                if (flags & kSampleDescriptionIndexPresent) {
+                    required += 4;
+                }
+                if (flags & kDefaultSampleDurationPresent) {
+                    required += 4;
+                }
+                if (flags & kDefaultSampleSizePresent) {
+                    required += 4;
+                }
+                if (flags & kDefaultSampleFlagsPresent) {
+                    required += 4;
+                }
+
+                if (box_size < required) {
+                    return ERROR_MALFORMED;
+                }
+
+                // Without an explicit base the data offsets are taken to be
+                // relative to the movie fragment box, which is what the
+                // default-base-is-moof flag and the usual writers do.
+                header.baseDataOffset = moofOffset;
+                header.defaultSampleDuration =
+                    mTrackExtends.defaultSampleDuration;
+                header.defaultSampleSize = mTrackExtends.defaultSampleSize;
+                header.defaultSampleFlags = mTrackExtends.defaultSampleFlags;
+
+                size_t pos = 8;
+                if (flags & kBaseDataOffsetPresent) {
+                    header.baseDataOffset = U64_AT(&box[pos]);
+                    pos += 8;
+                }
+                if (flags & kSampleDescriptionIndexPresent) {
+                    pos += 4;
+                }
+                if (flags & kDefaultSampleDurationPresent) {
+                    header.defaultSampleDuration = U32_AT(&box[pos]);
+                    pos += 4;
+                }
+                if (flags & kDefaultSampleSizePresent) {
+                    header.defaultSampleSize = U32_AT(&box[pos]);
+                    pos += 4;
+                }
+                if (flags & kDefaultSampleFlagsPresent) {
+                    header.defaultSampleFlags = U32_AT(&box[pos]);
+                    pos += 4;
+                }
+
+                dataOffset = header.baseDataOffset;
+                foundHeader = true;
+                break;
+            }
+
+            case FOURCC('t', 'f', 'd', 't'):
+            {
+                if (box_size < 8) {
+                    return ERROR_MALFORMED;
+                }
+
+                if (box[0] == 1) {
+                    if (box_size < 12) {
+                        return ERROR_MALFORMED;
+                    }
+                    time = U64_AT(&box[4]);
+                } else {
+                    time = U32_AT(&box[4]);
+                }
+                break;
+            }
+
+            case FOURCC('t', 'r', 'u', 'n'):
+            {
+                if (!foundHeader) {
+                    return ERROR_MALFORMED;
+                }
+
+                status_t err = parseTrackRun(
+                        box, box_size, header, &dataOffset, &time);
+
+                if (err != OK) {
+                    return err;
+                }
+                break;
+            }
+
+            default:
+                break;
+        }
+    }
+
+    if (foundHeader) {
+        mNextFragmentTime = time;
+    }
+
+    return OK;
+}
+
+status_t MPEG4Source::parseTrackRun(
+        const uint8_t *data, size_t size,
+        const TrackFragmentHeader &header,
+        off64_t *dataOffset, uint64_t *time) {
+    if (size < 8) {
+        return ERROR_MALFORMED;
+    }
+
+    uint32_t flags = U32_AT(data) & 0xffffff;
+    uint32_t sampleCount = U32_AT(&data[4]);
+    size_t pos = 8;
+
+    if (flags & kDataOffsetPresent) {
+        if (size < pos + 4) {
+            return ERROR_MALFORMED;
+        }
+        *dataOffset = header.baseDataOffset + (int32_t)U32_AT(&data[pos]);
+        pos += 4;
+    }
+
+    uint32_t firstSampleFlags = header.defaultSampleFlags;
+    if (flags & kFirstSampleFlagsPresent) {
+        if (size < pos + 4) {
+            return ERROR_MALFORMED;
+        }
+        firstSampleFlags = U32_AT(&data[pos]);
+        pos += 4;
+    }
+
+    size_t entrySize = 0;
+    if (flags & kSampleDurationPresent) {
+        entrySize += 4;
+    }
+    if (flags & kSampleSizePresent) {
+        entrySize += 4;
+    }
+    if (flags & kSampleFlagsPresent) {
+        entrySize += 4;
+    }
+    if (flags & kSampleCompositionOffsetPresent) {
+        entrySize += 4;
+    }
+
+    if (sampleCount > kMaxFragmentSamples - mFragmentSamples.size()
+            || (entrySize > 0 && sampleCount > (size - pos) / entrySize)) {
+        return ERROR_MALFORMED;
+    }
+
+    mFragmentSamples.setCapacity(mFragmentSamples.size() + sampleCount);
+
+    for (uint32_t i = 0; i < sampleCount; ++i) {
+        uint32_t duration = header.defaultSampleDuration;
+        uint32_t sampleSize = header.defaultSampleSize;
+        uint32_t sampleFlags =
+            (i == 0) ? firstSampleFlags : header.defaultSampleFlags;
+        int32_t compositionOffset = 0;
+
+        if (flags & kSampleDurationPresent) {
+            duration = U32_AT(&data[pos]);
+            pos += 4;
+        }
+        if (flags & kSampleSizePresent) {
+            sampleSize = U32_AT(&data[pos]);
+            pos += 4;
+        }
+        if (flags & kSampleFlagsPresent) {
+            sampleFlags = U32_AT(&data[pos]);
+            pos += 4;
+        }
+        if (flags & kSampleCompositionOffsetPresent) {
+            // Signed in version 1, and never that large in version 0.
+            compositionOffset = (int32_t)U32_AT(&data[pos]);
+            pos += 4;
+        }
+
+        if (sampleSize > 0) {
+            FragmentSample sample;
+            sample.offset = *dataOffset;
+            sample.size = sampleSize;
+            sample.decodingTime = *time;
+            sample.compositionOffset = compositionOffset;
+            sample.isSyncSample = !(sampleFlags & kSampleIsNonSyncSample);
+            mFragmentSamples.push(sample);
+        }
+
+        *dataOffset += sampleSize;
+        *time += duration;
+    }
+
+    return OK;
+}
+
+void MPEG4Source::parseRandomAccess() {
+    off64_t fileSize;
+    if (mDataSource->getSize(&fileSize) != OK || fileSize < 16) {
+        return;
+    }
+
+    // The movie fragment random access offset box ends the file and gives
+    // the size of the random access box it closes.
+    uint8_t mfro[16];
+    if (mDataSource->readAt(fileSize - 16, mfro, sizeof(mfro))
+            < (ssize_t)sizeof(mfro)
+            || U32_AT(&mfro[4]) != FOURCC('m', 'f', 'r', 'o')) {
+        return;
+    }
+
+    uint32_t mfraSize = U32_AT(&mfro[12]);
+    if (mfraSize < 16 || mfraSize > fileSize
+            || mfraSize > kMaxRandomAccessSize) {
+        return;
+    }
+
+    uint8_t *data = new uint8_t[mfraSize];
+    if (mDataSource->readAt(fileSize - mfraSize, data, mfraSize)
+            < (ssize_t)mfraSize
+            || U32_AT(&data[4]) != FOURCC('m', 'f', 'r', 'a')) {
+        delete[] data;
+        return;
+    }
+
+    Vector<FragmentEntry> fragments;
+
+    size_t offset = 0;
+    uint32_t type;
+    const uint8_t *box;
+    size_t box_size;
+    while (nextBox(&data[8], mfraSize - 8, &offset, &type, &box, &box_size)) {
+        if (type != FOURCC('t', 'f', 'r', 'a') || box_size < 16
+                || U32_AT(&box[4]) != mTrackID) {
+            continue;
+        }
+
+        uint8_t version = box[0];
+        uint32_t lengths = U32_AT(&box[8]);
+        size_t entrySize = (version == 1 ? 16 : 8)
+            + ((lengths >> 4) & 3) + ((lengths >> 2) & 3) + (lengths & 3) + 3;
+
+        uint32_t count = U32_AT(&box[12]);
+        if (count > (box_size - 16) / entrySize) {
+            break;
+        }
+
+        // There is an entry per sync sample, the first one of each
+        // fragment is enough to find it. Its presentation time stands for
+        // the decoding time of the fragment if the fragment does not have
+        // its own.
+        const uint8_t *ptr = &box[16];
+        for (uint32_t i = 0; i < count; ++i, ptr += entrySize) {
+            FragmentEntry entry;
+            if (version == 1) {
+                entry.time = U64_AT(ptr);
+                entry.moofOffset = U64_AT(&ptr[8]);
+            } else {
+                entry.time = U32_AT(ptr);
+                entry.moofOffset = U32_AT(&ptr[4]);
+            }
+
+            if (fragments.isEmpty()
+                    || (entry.moofOffset > fragments.top().moofOffset
+                        && entry.time >= fragments.top().time)) {
+                fragments.push(entry);
+            }
+        }
+        break;
+    }
+
+    delete[] data;
+    data = NULL;
+
+    if (!fragments.isEmpty()) {
+        mFragments = fragments;
+        mHasRandomAccess = true;
+    }
+}
+
+status_t MPEG4Source::getFragmentSample(
+        off64_t *offset, size_t *size, int64_t *timeUs, bool *isSyncSample) {
+    while (mCurrentSampleIndex >= mFragmentSamples.size()) {
+        status_t err = parseNextFragment();
+
+        if (err != OK) {
+            return err;
+        }
+    }
+
+    const FragmentSample &sample = mFragmentSamples.itemAt(mCurrentSampleIndex);
+
+    if (sample.size > mMaxSampleSize) {
+        LOGE("sample of %d bytes does not fit in a %d bytes buffer.",
+             sample.size, mMaxSampleSize);
+        return ERROR_MALFORMED;
+    }
+
+    int64_t cts = (int64_t)sample.decodingTime + sample.compositionOffset;
+
+    *offset = sample.offset;
+    *size = sample.size;
+    *timeUs = cts > 0 ? (cts * 1000000) / mTimescale : 0;
+    *isSyncSample = sample.isSyncSample;
+
+    return OK;
+}
+
+status_t MPEG4Source::seekFragment(
+        int64_t seekTimeUs, ReadOptions::SeekMode mode,
+        int64_t *targetSampleTimeUs) {
+    if (!mRandomAccessChecked) {
+        mRandomAccessChecked = true;
+        parseRandomAccess();
+    }
+
+    int64_t seekTime = seekTimeUs > 0 ? seekTimeUs * mTimescale / 1000000 : 0;
+
+    // Start with the last fragment known to begin at or before the seek
+    // time.
+    size_t lo = 0;
+    size_t hi = mFragments.size();
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if ((int64_t)mFragments.itemAt(mid).time <= seekTime) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    if (lo > 0) {
+        mNextMoofOffset = mFragments.itemAt(lo - 1).moofOffset;
+        mNextFragmentTime = mFragments.itemAt(lo - 1).time;
+    } else {
+        mNextMoofOffset = mFirstMoofOffset;
+        mNextFragmentTime = 0;
+    }
+
+    status_t err = parseNextFragment();
+
+    // Without random access information the fragments past the ones seen
+    // so far can only be found by going through them.
+    while (err == OK && !mHasRandomAccess
+            && (int64_t)mNextFragmentTime <= seekTime) {
+        err = parseNextFragment();
+    }
+
+    if (err != OK) {
+        return err;
+    }
+
+    ssize_t before = -1;
+    ssize_t after = -1;
+    int64_t beforeTime = 0;
+    int64_t afterTime = 0;
+    int64_t closestTime = 0;
+    uint64_t closestDiff = 0;
+    for (size_t i = 0; i < mFragmentSamples.size(); ++i) {
+        const FragmentSample &sample = mFragmentSamples.itemAt(i);
+        int64_t time = (int64_t)sample.decodingTime + sample.compositionOffset;
+
+        if (sample.isSyncSample) {
+            if (time <= seekTime) {
+                before = i;
+                beforeTime = time;
+            }
+            if (time >= seekTime && after < 0) {
+                after = i;
+                afterTime = time;
+            }
+        }
+
+        uint64_t diff = time > seekTime ? time - seekTime : seekTime - time;
+        if (i == 0 || diff < closestDiff) {
+            closestDiff = diff;
+            closestTime = time;
+        }
+    }
+
+    size_t index;
+    if (mode == ReadOptions::SEEK_NEXT_SYNC) {
+        // Fragments begin with a sync sample, so carry on with the next one
+        // if none is left in this one.
+        index = after >= 0 ? after : mFragmentSamples.size();
+    } else if (before < 0) {
+        index = after >= 0 ? after : 0;
+    } else if (mode == ReadOptions::SEEK_CLOSEST_SYNC && after >= 0
+            && afterTime - seekTime < seekTime - beforeTime) {
+        index = after;
+    } else {
+        index = before;
+    }
+
+    mCurrentSampleIndex = index;
+
+    if (mode == ReadOptions::SEEK_CLOSEST) {
+        *targetSampleTimeUs =
+            closestTime > 0 ? (closestTime * 1000000) / mTimescale : 0;
+    }
+
+    return OK;
+}
+
 MPEG4Extractor::Track *MPEG4Extractor::findTrackByMimePrefix(
         const char *mimePrefix) {
     for (Track *track = mFirstTrack; track != NULL; track = track->next) {
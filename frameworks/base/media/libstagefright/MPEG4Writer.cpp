@@ -35,6 +35,7 @@
 #include <cutils/properties.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <errno.h>
 #include <fcntl.h>
 #include <unistd.h>
 
@@ -238,8 +239,277 @@ private:
     Track &operator=(const Track &);
 };
 
+// Writes the file from a thread of its own, so that slow storage does not
+// stall the writer and track threads. Data is appended to fixed size
+// buffers; full buffers are queued for the I/O thread, the producer only
+// blocks when all of them are queued. The first buffer after a seek ends
+// at a multiple of kBufferSize in the file, the following writes are then
+// all aligned and kBufferSize long.
+class MPEG4Writer::FileWriter {
+public:
+    FileWriter(int fd);
+    ~FileWriter();
+
+    status_t start();
+
+    // Writes out the buffered data and stops the I/O thread.
+    status_t stop();
+
+    // Appends to the file at the current position.
+    void write(const void *data, size_t size);
+
+    // Writes out the buffered data, then moves the file position.
+    status_t seek(off64_t offset);
+
+private:
+    enum {
+        kBufferSize = 256 * 1024,
+        kNumBuffers = 8,
+    };
+
+    struct Buffer {
+        uint8_t *mData;
+        size_t mCapacity;
+        size_t mLength;
+    };
+
+    int mFd;
+    off64_t mPosition;
+    Buffer mBuffers[kNumBuffers];
+
+    // Filled by the producer, not in any list.
+    Buffer *mCurrent;
+
+    Mutex mLock;
+    Condition mCondition;
+    List<Buffer *> mFreeBuffers;
+    List<Buffer *> mQueuedBuffers;
+    bool mWriting;
+    bool mStarted;
+    bool mDone;
+    status_t mError;
+    pthread_t mThread;
+
+    status_t flush();
+    void queueCurrentBuffer();
+    static void *ThreadWrapper(void *me);
+    void threadFunc();
+
+    FileWriter(const FileWriter &);
+    FileWriter &operator=(const FileWriter &);
+};
+
+MPEG4Writer::FileWriter::FileWriter(int fd)
+    : mFd(fd),
+      mPosition(0),
+      mCurrent(NULL),
+      mWriting(false),
+      mStarted(false),
+      mDone(false),
+      mError(OK) {
+    for (size_t i = 0; i < kNumBuffers; ++i) {
+        mBuffers[i].mData = NULL;
+        mBuffers[i].mCapacity = 0;
+        mBuffers[i].mLength = 0;
+    }
+}
+
+MPEG4Writer::FileWriter::~FileWriter() {
+    stop();
+
+    for (size_t i = 0; i < kNumBuffers; ++i) {
+        free(mBuffers[i].mData);
+        mBuffers[i].mData = NULL;
+    }
+}
+
+status_t MPEG4Writer::FileWriter::start() {
+    CHECK(!mStarted);
+
+    mFreeBuffers.clear();
+    for (size_t i = 0; i < kNumBuffers; ++i) {
+        if (mBuffers[i].mData == NULL) {
+            mBuffers[i].mData = (uint8_t *)malloc(kBufferSize);
+            if (mBuffers[i].mData == NULL) {
+                return NO_MEMORY;
+            }
+        }
+        mFreeBuffers.push_back(&mBuffers[i]);
+    }
+
+    mPosition = lseek64(mFd, 0, SEEK_CUR);
+    mDone = false;
+    mError = OK;
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
+    int res = pthread_create(&mThread, &attr, ThreadWrapper, this);
+    pthread_attr_destroy(&attr);
+
+    if (res != 0) {
+        return UNKNOWN_ERROR;
+    }
+
+    mStarted = true;
+    return OK;
+}
+
+status_t MPEG4Writer::FileWriter::stop() {
+    if (!mStarted) {
+        return OK;
+    }
+
+    flush();
+
+    {
+        Mutex::Autolock autoLock(mLock);
+        mDone = true;
+        mCondition.broadcast();
+    }
+
+    void *dummy;
+    pthread_join(mThread, &dummy);
+    mStarted = false;
+
+    return mError;
+}
+
+void MPEG4Writer::FileWriter::write(const void *data, size_t size) {
+    CHECK(mStarted);
+
+    const uint8_t *ptr = (const uint8_t *)data;
+    while (size > 0) {
+        if (mCurrent == NULL) {
+            Mutex::Autolock autoLock(mLock);
+            while (mFreeBuffers.empty()) {
+                mCondition.wait(mLock);
+            }
+            mCurrent = *mFreeBuffers.begin();
+            mFreeBuffers.erase(mFreeBuffers.begin());
+
+            mCurrent->mCapacity = kBufferSize - mPosition % kBufferSize;
+            mCurrent->mLength = 0;
+        }
+
+        size_t n = mCurrent->mCapacity - mCurrent->mLength;
+        if (n > size) {
+            n = size;
+        }
+
+        memcpy(mCurrent->mData + mCurrent->mLength, ptr, n);
+        mCurrent->mLength += n;
+        mPosition += n;
+        ptr += n;
+        size -= n;
+
+        if (mCurrent->mLength == mCurrent->mCapacity) {
+            queueCurrentBuffer();
+        }
+    }
+}
+
+void MPEG4Writer::FileWriter::queueCurrentBuffer() {
+    Mutex::Autolock autoLock(mLock);
+
+    if (mCurrent->mLength > 0) {
+        mQueuedBuffers.push_back(mCurrent);
+    } else {
+        mFreeBuffers.push_back(mCurrent);
+    }
+    mCurrent = NULL;
+
+    mCondition.broadcast();
+}
+
+status_t MPEG4Writer::FileWriter::flush() {
+    if (mCurrent != NULL) {
+        queueCurrentBuffer();
+    }
+
+    Mutex::Autolock autoLock(mLock);
+    while (!mQueuedBuffers.empty() || mWriting) {
+        mCondition.wait(mLock);
+    }
+
+    return mError;
+}
+
+status_t MPEG4Writer::FileWriter::seek(off64_t offset) {
+    CHECK(mStarted);
+
+    status_t err = flush();
+
+    if (lseek64(mFd, offset, SEEK_SET) < 0) {
+        LOGE("seek to %lld failed: %s", offset, strerror(errno));
+        if (err == OK) {
+            err = -errno;
+        }
+    }
+    mPosition = offset;
+
+    return err;
+}
+
+// static
+void *MPEG4Writer::FileWriter::ThreadWrapper(void *me) {
+    static_cast<FileWriter *>(me)->threadFunc();
+    return NULL;
+}
+
+void MPEG4Writer::FileWriter::threadFunc() {
+    prctl(PR_SET_NAME, (unsigned long)"MPEG4WriterIO", 0, 0, 0);
+
+    Mutex::Autolock autoLock(mLock);
+    for (;;) {
+        while (!mDone && mQueuedBuffers.empty()) {
+            mCondition.wait(mLock);
+        }
+
+        if (mQueuedBuffers.empty()) {
+            break;
+        }
+
+        Buffer *buffer = *mQueuedBuffers.begin();
+        mQueuedBuffers.erase(mQueuedBuffers.begin());
+        mWriting = true;
+
+        // mData is not touched by anybody else until the buffer is free.
+        mLock.unlock();
+
+        status_t err = OK;
+        const uint8_t *ptr = buffer->mData;
+        size_t remaining = buffer->mLength;
+        while (remaining > 0) {
+            ssize_t n = ::write(mFd, ptr, remaining);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                LOGE("write failed: %s", strerror(errno));
+                err = -errno;
+                break;
+            }
+            ptr += n;
+            remaining -= n;
+        }
+
+        mLock.lock();
+
+        if (err != OK && mError == OK) {
+            mError = err;
+        }
+        mWriting = false;
+        mFreeBuffers.push_back(buffer);
+        mCondition.broadcast();
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
 MPEG4Writer::MPEG4Writer(const char *filename)
     : mFd(-1),
+      mFileWriter(NULL),
       mInitCheck(NO_INIT),
       mUse4ByteNalLength(true),
       mUse32BitOffset(true),
@@ -259,11 +529,13 @@ MPEG4Writer::MPEG4Writer(const char *filename)
     mFd = open(filename, O_CREAT | O_LARGEFILE | O_TRUNC | O_RDWR);
     if (mFd >= 0) {
         mInitCheck = OK;
+        mFileWriter = new FileWriter(mFd);
     }
 }
 
 MPEG4Writer::MPEG4Writer(int fd)
     : mFd(dup(fd)),
+      mFileWriter(NULL),
       mInitCheck(mFd < 0? NO_INIT: OK),
       mUse4ByteNalLength(true),
       mUse32BitOffset(true),
@@ -279,11 +551,17 @@ MPEG4Writer::MPEG4Writer(int fd)
       mLongitudex10000(0),
       mAreGeoTagsAvailable(false),
       mStartTimeOffsetMs(-1) {
+    if (mFd >= 0) {
+        mFileWriter = new FileWriter(mFd);
+    }
 }
 
 MPEG4Writer::~MPEG4Writer() {
     stop();
 
+    delete mFileWriter;
+    mFileWriter = NULL;
+
     while (!mTracks.empty()) {
         List<Track *>::iterator it = mTracks.begin();
         delete *it;
@@ -474,6 +752,11 @@ status_t MPEG4Writer::start(MetaData *param) {
     CHECK(mTimeScale > 0);
     LOGV("movie time scale: %d", mTimeScale);
 
+    status_t err = mFileWriter->start();
+    if (err != OK) {
+        return err;
+    }
+
     mStreamableFile = true;
     mWriteMoovBoxToMemory = false;
     mMoovBoxBuffer = NULL;
@@ -491,20 +774,20 @@ status_t MPEG4Writer::start(MetaData *param) {
         mEstimatedMoovBoxSize = estimateMoovBoxSize(bitRate);
     }
     CHECK(mEstimatedMoovBoxSize >= 8);
-    lseek64(mFd, mFreeBoxOffset, SEEK_SET);
+    mFileWriter->seek(mFreeBoxOffset);
     writeInt32(mEstimatedMoovBoxSize);
     write("free", 4);
 
     mMdatOffset = mFreeBoxOffset + mEstimatedMoovBoxSize;
     mOffset = mMdatOffset;
-    lseek64(mFd, mMdatOffset, SEEK_SET);
+    mFileWriter->seek(mMdatOffset);
     if (mUse32BitOffset) {
         write("????mdat", 8);
     } else {
         write("\x00\x00\x00\x01mdat????????", 16);
     }
 
-    status_t err = startWriterThread();
+    err = startWriterThread();
     if (err != OK) {
         return err;
     }
@@ -610,6 +893,7 @@ void MPEG4Writer::writeCompositionMatrix(int degrees) {
 }
 
 void MPEG4Writer::release() {
+    mFileWriter->stop();
     close(mFd);
     mFd = -1;
     mInitCheck = NO_INIT;
@@ -664,16 +948,16 @@ status_t MPEG4Writer::stop() {
 
     // Fix up the size of the 'mdat' chunk.
     if (mUse32BitOffset) {
-        lseek64(mFd, mMdatOffset, SEEK_SET);
+        mFileWriter->seek(mMdatOffset);
         int32_t size = htonl(static_cast<int32_t>(mOffset - mMdatOffset));
-        ::write(mFd, &size, 4);
+        mFileWriter->write(&size, 4);
     } else {
-        lseek64(mFd, mMdatOffset + 8, SEEK_SET);
+        mFileWriter->seek(mMdatOffset + 8);
         int64_t size = mOffset - mMdatOffset;
         size = hton64(size);
-        ::write(mFd, &size, 8);
+        mFileWriter->write(&size, 8);
     }
-    lseek64(mFd, mOffset, SEEK_SET);
+    mFileWriter->seek(mOffset);
 
     const off64_t moovOffset = mOffset;
     mWriteMoovBoxToMemory = true;
@@ -687,12 +971,11 @@ status_t MPEG4Writer::stop() {
         CHECK(mMoovBoxBufferOffset + 8 <= mEstimatedMoovBoxSize);
 
         // Moov box
-        lseek64(mFd, mFreeBoxOffset, SEEK_SET);
+        mFileWriter->seek(mFreeBoxOffset);
         mOffset = mFreeBoxOffset;
         write(mMoovBoxBuffer, 1, mMoovBoxBufferOffset);
 
         // Free box
-        lseek64(mFd, mOffset, SEEK_SET);
         writeInt32(mEstimatedMoovBoxSize - mMoovBoxBufferOffset);
         write("free", 4);
 
@@ -706,6 +989,11 @@ status_t MPEG4Writer::stop() {
 
     CHECK(mBoxes.empty());
 
+    status_t writeErr = mFileWriter->stop();
+    if (err == OK) {
+        err = writeErr;
+    }
+
     release();
     return err;
 }
@@ -812,7 +1100,7 @@ void MPEG4Writer::unlock() {
 off64_t MPEG4Writer::addSample_l(MediaBuffer *buffer) {
     off64_t old_offset = mOffset;
 
-    ::write(mFd,
+    mFileWriter->write(
           (const uint8_t *)buffer->data() + buffer->range_offset(),
           buffer->range_length());
 
@@ -840,32 +1128,27 @@ off64_t MPEG4Writer::addLengthPrefixedSample_l(MediaBuffer *buffer) {
 
     size_t length = buffer->range_length();
 
+    uint8_t prefix[4];
+    size_t prefixSize;
     if (mUse4ByteNalLength) {
-        uint8_t x = length >> 24;
-        ::write(mFd, &x, 1);
-        x = (length >> 16) & 0xff;
-        ::write(mFd, &x, 1);
-        x = (length >> 8) & 0xff;
-        ::write(mFd, &x, 1);
-        x = length & 0xff;
-        ::write(mFd, &x, 1);
-
-        ::write(mFd,
-              (const uint8_t *)buffer->data() + buffer->range_offset(),
-              length);
-
-        mOffset += length + 4;
+        prefix[0] = length >> 24;
+        prefix[1] = (length >> 16) & 0xff;
+        prefix[2] = (length >> 8) & 0xff;
+        prefix[3] = length & 0xff;
+        prefixSize = 4;
     } else {
         CHECK(length < 65536);
 
-        uint8_t x = length >> 8;
-        ::write(mFd, &x, 1);
-        x = length & 0xff;
-        ::write(mFd, &x, 1);
-        ::write(mFd, (const uint8_t *)buffer->data() + buffer->range_offset(), length);
-        mOffset += length + 2;
+        prefix[0] = length >> 8;
+        prefix[1] = length & 0xff;
+        prefixSize = 2;
     }
 
+    mFileWriter->write(prefix, prefixSize);
+    mFileWriter->write(
+            (const uint8_t *)buffer->data() + buffer->range_offset(), length);
+    mOffset += length + prefixSize;
+
     return old_offset;
 }
 
@@ -882,9 +1165,9 @@ size_t MPEG4Writer::write(
                  it != mBoxes.end(); ++it) {
                 (*it) += mOffset;
             }
-            lseek64(mFd, mOffset, SEEK_SET);
-            ::write(mFd, mMoovBoxBuffer, mMoovBoxBufferOffset);
-            ::write(mFd, ptr, size * nmemb);
+            mFileWriter->seek(mOffset);
+            mFileWriter->write(mMoovBoxBuffer, mMoovBoxBufferOffset);
+            mFileWriter->write(ptr, size * nmemb);
             mOffset += (bytes + mMoovBoxBufferOffset);
             free(mMoovBoxBuffer);
             mMoovBoxBuffer = NULL;
@@ -896,7 +1179,7 @@ size_t MPEG4Writer::write(
             mMoovBoxBufferOffset += bytes;
         }
     } else {
-        ::write(mFd, ptr, size * nmemb);
+        mFileWriter->write(ptr, size * nmemb);
         mOffset += bytes;
     }
     return bytes;
@@ -922,10 +1205,10 @@ void MPEG4Writer::endBox() {
        int32_t x = htonl(mMoovBoxBufferOffset - offset);
        memcpy(mMoovBoxBuffer + offset, &x, 4);
     } else {
-        lseek64(mFd, offset, SEEK_SET);
+        mFileWriter->seek(offset);
         writeInt32(mOffset - offset);
         mOffset -= 4;
-        lseek64(mFd, mOffset, SEEK_SET);
+        mFileWriter->seek(mOffset);
     }
 }
 
@@ -14,25 +14,40 @@
  * limitations under the License.
  */
 
+//#define LOG_NDEBUG 0
 #define LOG_TAG "MediaBufferGroup"
 #include <utils/Log.h>
 
+#include <cutils/atomic.h>
+#include <media/stagefright/foundation/ADebug.h>
 #include <media/stagefright/MediaBuffer.h>
 #include <media/stagefright/MediaBufferGroup.h>
-#include <media/stagefright/MediaDebug.h>
+#include <media/stagefright/MediaErrors.h>
+#include <utils/Timers.h>
 
 namespace android {
 
+// Free list heads, see MediaBufferGroup::SizeClass. kMaxBuffers + 1 must
+// fit in the index bits.
+static const int32_t kIndexBits = 7;
+static const int32_t kIndexMask = (1 << kIndexBits) - 1;
+static const int32_t kTagIncrement = 1 << kIndexBits;
+
 MediaBufferGroup::MediaBufferGroup()
-    : mFirstBuffer(NULL),
-      mLastBuffer(NULL) {
+    : mBufferCount(0),
+      mClassCount(0),
+      mWaiterCount(0),
+      mAcquireCount(0),
+      mWaitCount(0),
+      mWaitTimeUs(0) {
 }
 
 MediaBufferGroup::~MediaBufferGroup() {
-    MediaBuffer *next;
-    for (MediaBuffer *buffer = mFirstBuffer; buffer != NULL;
-         buffer = next) {
-        next = buffer->nextBuffer();
+    LOGV("%d buffers acquired, %d waits for %lld us",
+         mAcquireCount, mWaitCount, mWaitTimeUs);
+
+    for (int32_t i = 0; i < mBufferCount; ++i) {
+        MediaBuffer *buffer = mBuffers[i];
 
         CHECK_EQ(buffer->refcount(), 0);
 
@@ -44,43 +59,163 @@ MediaBufferGroup::~MediaBufferGroup() {
 void MediaBufferGroup::add_buffer(MediaBuffer *buffer) {
     Mutex::Autolock autoLock(mLock);
 
-    buffer->setObserver(this);
+    CHECK_LT(mBufferCount, (int32_t)kMaxBuffers);
+    CHECK_EQ(buffer->refcount(), 0);
+
+    size_t size = buffer->mSize;
 
-    if (mLastBuffer) {
-        mLastBuffer->setNextBuffer(buffer);
-    } else {
-        mFirstBuffer = buffer;
+    int32_t sizeClass = 0;
+    while (sizeClass < mClassCount && mClasses[sizeClass].mSize < size) {
+        ++sizeClass;
     }
 
-    mLastBuffer = buffer;
+    if (sizeClass == mClassCount || mClasses[sizeClass].mSize != size) {
+        CHECK_LT(mClassCount, (int32_t)kMaxSizeClasses);
+
+        for (int32_t i = mClassCount; i > sizeClass; --i) {
+            mClasses[i] = mClasses[i - 1];
+        }
+        for (int32_t i = 0; i < mBufferCount; ++i) {
+            if (mBufferClass[i] >= sizeClass) {
+                ++mBufferClass[i];
+            }
+        }
+
+        mClasses[sizeClass].mSize = size;
+        mClasses[sizeClass].mFreeHead = 0;
+        ++mClassCount;
+    }
+
+    buffer->setObserver(this);
+
+    int32_t index = mBufferCount++;
+    mBuffers[index] = buffer;
+    mBufferClass[index] = sizeClass;
+
+    pushFree(index);
 }
 
-status_t MediaBufferGroup::acquire_buffer(MediaBuffer **out) {
-    Mutex::Autolock autoLock(mLock);
+int32_t MediaBufferGroup::popFree(int32_t sizeClass) {
+    volatile int32_t *head = &mClasses[sizeClass].mFreeHead;
 
     for (;;) {
-        for (MediaBuffer *buffer = mFirstBuffer;
-             buffer != NULL; buffer = buffer->nextBuffer()) {
-            if (buffer->refcount() == 0) {
-                buffer->add_ref();
-                buffer->reset();
-
-                *out = buffer;
-                goto exit;
-            }
+        int32_t oldHead = android_atomic_acquire_load(head);
+        int32_t first = oldHead & kIndexMask;
+
+        if (first == 0) {
+            return -1;
         }
 
-        // All buffers are in use. Block until one of them is returned to us.
-        mCondition.wait(mLock);
+        // mNextFree may already be stale if another thread popped the
+        // buffer in the meantime, the tag makes the exchange fail then.
+        int32_t newHead = ((oldHead + kTagIncrement) & ~kIndexMask)
+            | mNextFree[first - 1];
+
+        if (android_atomic_acquire_cas(oldHead, newHead, head) == 0) {
+            return first - 1;
+        }
     }
+}
+
+void MediaBufferGroup::pushFree(int32_t index) {
+    volatile int32_t *head = &mClasses[mBufferClass[index]].mFreeHead;
+
+    for (;;) {
+        int32_t oldHead = android_atomic_acquire_load(head);
+
+        mNextFree[index] = oldHead & kIndexMask;
+
+        int32_t newHead = ((oldHead + kTagIncrement) & ~kIndexMask)
+            | (index + 1);
+
+        if (android_atomic_release_cas(oldHead, newHead, head) == 0) {
+            return;
+        }
+    }
+}
+
+MediaBuffer *MediaBufferGroup::acquireFree(size_t minSize) {
+    for (int32_t i = 0; i < mClassCount; ++i) {
+        if (mClasses[i].mSize < minSize) {
+            continue;
+        }
+
+        int32_t index = popFree(i);
+        if (index >= 0) {
+            MediaBuffer *buffer = mBuffers[index];
+            CHECK_EQ(buffer->refcount(), 0);
+
+            buffer->add_ref();
+            buffer->reset();
+
+            return buffer;
+        }
+    }
+
+    return NULL;
+}
+
+status_t MediaBufferGroup::acquire_buffer(MediaBuffer **out, size_t minSize) {
+    if (mClassCount == 0 || mClasses[mClassCount - 1].mSize < minSize) {
+        return ERROR_BUFFER_TOO_SMALL;
+    }
+
+    android_atomic_inc(&mAcquireCount);
+
+    MediaBuffer *buffer = acquireFree(minSize);
+
+    if (buffer == NULL) {
+        Mutex::Autolock autoLock(mLock);
+
+        // A buffer returned once mWaiterCount is raised signals us, one
+        // returned before is found by the second attempt.
+        android_atomic_inc(&mWaiterCount);
+
+        nsecs_t startTime = systemTime(SYSTEM_TIME_MONOTONIC);
+        bool waited = false;
+
+        while ((buffer = acquireFree(minSize)) == NULL) {
+            // All buffers are in use. Block until one of them is returned
+            // to us.
+            mCondition.wait(mLock);
+            waited = true;
+        }
+
+        android_atomic_dec(&mWaiterCount);
+
+        if (waited) {
+            ++mWaitCount;
+            mWaitTimeUs += (systemTime(SYSTEM_TIME_MONOTONIC) - startTime) / 1000;
+        }
+    }
+
+    *out = buffer;
 
-exit:
     return OK;
 }
 
-void MediaBufferGroup::signalBufferReturned(MediaBuffer *) {
+void MediaBufferGroup::getStats(
+        uint32_t *acquireCount, uint32_t *waitCount, int64_t *waitTimeUs) {
     Mutex::Autolock autoLock(mLock);
-    mCondition.signal();
+
+    *acquireCount = android_atomic_acquire_load(&mAcquireCount);
+    *waitCount = mWaitCount;
+    *waitTimeUs = mWaitTimeUs;
+}
+
+void MediaBufferGroup::signalBufferReturned(MediaBuffer *buffer) {
+    int32_t index = 0;
+    while (index < mBufferCount && mBuffers[index] != buffer) {
+        ++index;
+    }
+    CHECK_LT(index, mBufferCount);
+
+    pushFree(index);
+
+    if (android_atomic_acquire_load(&mWaiterCount) > 0) {
+        Mutex::Autolock autoLock(mLock);
+        mCondition.broadcast();
+    }
 }
 
 }  // namespace android
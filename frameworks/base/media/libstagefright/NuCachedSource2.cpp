@@ -41,6 +41,7 @@ struct PageCache {
     void releasePage(Page *page);
 
     void appendPage(Page *page);
+    void appendPages(PageCache *other);
     size_t releaseFromStart(size_t maxBytes);
 
     size_t totalSize() const {
@@ -110,6 +111,20 @@ void PageCache::appendPage(Page *page) {
     mActivePages.push_back(page);
 }
 
+// Moves all the pages of "other" to the end of this cache.
+void PageCache::appendPages(PageCache *other) {
+    List<Page *>::iterator it = other->mActivePages.begin();
+    while (it != other->mActivePages.end()) {
+        mActivePages.push_back(*it);
+        ++it;
+    }
+
+    mTotalSize += other->mTotalSize;
+
+    other->mActivePages.clear();
+    other->mTotalSize = 0;
+}
+
 size_t PageCache::releaseFromStart(size_t maxBytes) {
     size_t bytesReleased = 0;
 
@@ -186,6 +201,7 @@ NuCachedSource2::NuCachedSource2(
       mLooper(new ALooper),
       mCache(new PageCache(kPageSize)),
       mCacheOffset(0),
+      mRetainedBytes(0),
       mFinalStatus(OK),
       mLastAccessPos(0),
       mFetching(true),
@@ -225,6 +241,11 @@ NuCachedSource2::~NuCachedSource2() {
 
     delete mCache;
     mCache = NULL;
+
+    for (size_t i = 0; i < mRetainedRanges.size(); ++i) {
+        delete mRetainedRanges.itemAt(i).mCache;
+    }
+    mRetainedRanges.clear();
 }
 
 status_t NuCachedSource2::getEstimatedBandwidthKbps(int32_t *kbps) {
@@ -280,6 +301,7 @@ void NuCachedSource2::fetchInternal() {
     LOGV("fetchInternal");
 
     bool reconnect = false;
+    size_t maxBytes;
 
     {
         Mutex::Autolock autoLock(mLock);
@@ -290,6 +312,8 @@ void NuCachedSource2::fetchInternal() {
 
             reconnect = true;
         }
+
+        maxBytes = prepareFetch_l();
     }
 
     if (reconnect) {
@@ -312,7 +336,7 @@ void NuCachedSource2::fetchInternal() {
     PageCache::Page *page = mCache->acquirePage();
 
     ssize_t n = mSource->readAt(
-            mCacheOffset + mCache->totalSize(), page->mData, kPageSize);
+            mCacheOffset + mCache->totalSize(), page->mData, maxBytes);
 
     Mutex::Autolock autoLock(mLock);
 
@@ -471,6 +495,10 @@ ssize_t NuCachedSource2::readAt(off64_t offset, void *data, size_t size) {
         return size;
     }
 
+    if (readFromRetainedRange_l(offset, data, size)) {
+        return size;
+    }
+
     sp<AMessage> msg = new AMessage(kWhatRead, mReflector->id());
     msg->setInt64("offset", offset);
     msg->setPointer("data", data);
@@ -544,6 +572,12 @@ ssize_t NuCachedSource2::readInternal(off64_t offset, void *data, size_t size) {
         // does not trigger another seek.
         off64_t seekOffset = (offset > kPadding) ? offset - kPadding : 0;
 
+        // Unless that data is cached already, in which case fetching goes
+        // on from the end of it.
+        if (findRetainedRange_l(offset) >= 0) {
+            seekOffset = offset;
+        }
+
         seekInternal_l(seekOffset);
     }
 
@@ -586,10 +620,26 @@ status_t NuCachedSource2::seekInternal_l(off64_t offset) {
 
     LOGI("new range: offset= %lld", offset);
 
-    mCacheOffset = offset;
+    retainCache_l();
 
-    size_t totalSize = mCache->totalSize();
-    CHECK_EQ(mCache->releaseFromStart(totalSize), totalSize);
+    ssize_t index = findRetainedRange_l(offset);
+    if (index >= 0) {
+        const RetainedRange &range = mRetainedRanges.itemAt(index);
+
+        LOGI("resuming cached range: offset= %lld, size= %d",
+             range.mOffset, range.mCache->totalSize());
+
+        delete mCache;
+        mCache = range.mCache;
+        mCacheOffset = range.mOffset;
+
+        mRetainedBytes -= mCache->totalSize();
+        mRetainedRanges.removeAt(index);
+    } else {
+        mCacheOffset = offset;
+    }
+
+    trimRetainedRanges_l();
 
     mFinalStatus = OK;
     mFetching = true;
@@ -597,6 +647,133 @@ status_t NuCachedSource2::seekInternal_l(off64_t offset) {
     return OK;
 }
 
+// Sets the current range of the cache aside, keeping its end if it is
+// larger than what may be retained.
+void NuCachedSource2::retainCache_l() {
+    size_t totalSize = mCache->totalSize();
+    if (totalSize == 0) {
+        return;
+    }
+
+    if (totalSize > kMaxRetainedBytes) {
+        mCacheOffset += mCache->releaseFromStart(totalSize - kMaxRetainedBytes);
+    }
+
+    RetainedRange range;
+    range.mOffset = mCacheOffset;
+    range.mCache = mCache;
+
+    size_t i = 0;
+    while (i < mRetainedRanges.size()
+            && mRetainedRanges.itemAt(i).mOffset < mCacheOffset) {
+        ++i;
+    }
+    mRetainedRanges.insertAt(range, i);
+    mRetainedBytes += mCache->totalSize();
+
+    mCache = new PageCache(kPageSize);
+    mCacheOffset = 0;
+}
+
+// Returns the index of the retained range containing or ending at "offset".
+ssize_t NuCachedSource2::findRetainedRange_l(off64_t offset) const {
+    for (size_t i = 0; i < mRetainedRanges.size(); ++i) {
+        const RetainedRange &range = mRetainedRanges.itemAt(i);
+
+        if (offset >= range.mOffset
+                && offset <= range.mOffset + (off64_t)range.mCache->totalSize()) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+bool NuCachedSource2::readFromRetainedRange_l(
+        off64_t offset, void *data, size_t size) {
+    ssize_t index = findRetainedRange_l(offset);
+    if (index < 0) {
+        return false;
+    }
+
+    const RetainedRange &range = mRetainedRanges.itemAt(index);
+    if (offset + size > range.mOffset + range.mCache->totalSize()) {
+        return false;
+    }
+
+    range.mCache->copy(offset - range.mOffset, data, size);
+
+    return true;
+}
+
+// Drops the retained ranges farthest from the read position until they fit.
+void NuCachedSource2::trimRetainedRanges_l() {
+    while (mRetainedBytes > kMaxRetainedBytes) {
+        size_t farthest = 0;
+        off64_t maxDistance = -1;
+
+        for (size_t i = 0; i < mRetainedRanges.size(); ++i) {
+            const RetainedRange &range = mRetainedRanges.itemAt(i);
+            off64_t end = range.mOffset + range.mCache->totalSize();
+
+            off64_t distance;
+            if (mLastAccessPos < range.mOffset) {
+                distance = range.mOffset - mLastAccessPos;
+            } else if (mLastAccessPos > end) {
+                distance = mLastAccessPos - end;
+            } else {
+                distance = 0;
+            }
+
+            if (distance > maxDistance) {
+                maxDistance = distance;
+                farthest = i;
+            }
+        }
+
+        PageCache *cache = mRetainedRanges.itemAt(farthest).mCache;
+        mRetainedBytes -= cache->totalSize();
+        delete cache;
+
+        mRetainedRanges.removeAt(farthest);
+    }
+}
+
+// Merges the retained range the current one has reached, and returns how
+// much may be fetched before running into the next one.
+size_t NuCachedSource2::prepareFetch_l() {
+    off64_t end = mCacheOffset + mCache->totalSize();
+
+    size_t i = 0;
+    while (i < mRetainedRanges.size()) {
+        const RetainedRange &range = mRetainedRanges.itemAt(i);
+
+        if (range.mOffset < end) {
+            ++i;
+            continue;
+        }
+
+        if (range.mOffset > end) {
+            off64_t avail = range.mOffset - end;
+            return avail < kPageSize ? (size_t)avail : (size_t)kPageSize;
+        }
+
+        LOGV("merging cached range: offset= %lld, size= %d",
+             range.mOffset, range.mCache->totalSize());
+
+        PageCache *cache = range.mCache;
+        mRetainedBytes -= cache->totalSize();
+        end += cache->totalSize();
+
+        mCache->appendPages(cache);
+        delete cache;
+
+        mRetainedRanges.removeAt(i);
+    }
+
+    return kPageSize;
+}
+
 void NuCachedSource2::resumeFetchingIfNecessary() {
     Mutex::Autolock autoLock(mLock);
 
@@ -700,6 +700,16 @@ status_t OMXCodec::configureCodec(const sp<MetaData> &meta) {
         setMinBufferSize(kPortIndexOutput, 8192);  // XXX
     }
 
+    if (mNativeWindow != NULL
+        && !mIsEncoder
+        && !strncasecmp(mMIME, "video/", 6)
+        && !strncmp(mComponentName, "OMX.google.", 11)
+        && initNativeWindow() != OK) {
+        // Software decoders that cannot write into the native window's
+        // buffers are rendered from local memory.
+        mNativeWindow.clear();
+    }
+
     initOutputFormat(meta);
 
     if ((mFlags & kClientNeedsFramebuffer)
@@ -732,7 +742,8 @@ status_t OMXCodec::configureCodec(const sp<MetaData> &meta) {
     if (mNativeWindow != NULL
         && !mIsEncoder
         && !strncasecmp(mMIME, "video/", 6)
-        && !strncmp(mComponentName, "OMX.", 4)) {
+        && !strncmp(mComponentName, "OMX.", 4)
+        && strncmp(mComponentName, "OMX.google.", 11)) {
         status_t err = initNativeWindow();
         if (err != OK) {
             return err;
@@ -1471,8 +1482,7 @@ OMXCodec::OMXCodec(
       mOutputPortSettingsChangedPending(false),
       mLeftOverBuffer(NULL),
       mPaused(false),
-      mNativeWindow(!strncmp(componentName, "OMX.google.", 11)
-                        ? NULL : nativeWindow) {
+      mNativeWindow(nativeWindow) {
     mPortStatus[kPortIndexInput] = ENABLED;
     mPortStatus[kPortIndexOutput] = ENABLED;
 
@@ -4518,6 +4528,11 @@ void OMXCodec::initOutputFormat(const sp<MetaData> &inputFormat) {
             mOutputFormat->setInt32(kKeyHeight, video_def->nFrameHeight);
             mOutputFormat->setInt32(kKeyColorFormat, video_def->eColorFormat);
 
+            if (!mIsEncoder && mNativeWindow != NULL
+                    && !strncmp(mComponentName, "OMX.google.", 11)) {
+                mOutputFormat->setInt32(kKeyRendersToNativeWindow, true);
+            }
+
             if (!mIsEncoder) {
                 OMX_CONFIG_RECTTYPE rect;
                 InitOMXParams(&rect);
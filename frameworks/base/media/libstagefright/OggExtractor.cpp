@@ -96,7 +96,17 @@ private:
         int64_t mTimeUs;
     };
 
+    enum {
+        // Page headers, lacing values and packets are all small, so local
+        // sources are read through a buffer this large.
+        kReadBufferSize = 65536,
+    };
+
     sp<DataSource> mSource;
+    uint8_t *mReadBuffer;
+    off64_t mReadBufferOffset;
+    size_t mReadBufferSize;
+
     off64_t mOffset;
     Page mCurrentPage;
     uint64_t mPrevGranulePosition;
@@ -115,6 +125,11 @@ private:
 
     Vector<TOCEntry> mTableOfContents;
 
+    // Scanning every page of the file is only worth it once we're asked
+    // to seek, so that short sounds start playing right away.
+    bool mTableOfContentsPending;
+
+    ssize_t readAt(off64_t offset, void *data, size_t size);
     ssize_t readPage(off64_t offset, Page *page);
     status_t findNextPage(off64_t startOffset, off64_t *pageOffset);
 
@@ -206,15 +221,24 @@ status_t OggSource::read(
 
 MyVorbisExtractor::MyVorbisExtractor(const sp<DataSource> &source)
     : mSource(source),
+      mReadBuffer(NULL),
+      mReadBufferOffset(0),
+      mReadBufferSize(0),
       mOffset(0),
       mPrevGranulePosition(0),
       mCurrentPageSize(0),
       mFirstPacketInPage(true),
       mCurrentPageSamples(0),
       mNextLaceIndex(0),
-      mFirstDataOffset(-1) {
+      mFirstDataOffset(-1),
+      mTableOfContentsPending(false) {
     mCurrentPage.mNumSegments = 0;
 
+    if (!(mSource->flags() & DataSource::kIsCachingDataSource)) {
+        // Caching sources already serve small reads from memory.
+        mReadBuffer = (uint8_t *)malloc(kReadBufferSize);
+    }
+
     vorbis_info_init(&mVi);
     vorbis_comment_init(&mVc);
 }
@@ -222,6 +246,41 @@ MyVorbisExtractor::MyVorbisExtractor(const sp<DataSource> &source)
 MyVorbisExtractor::~MyVorbisExtractor() {
     vorbis_comment_clear(&mVc);
     vorbis_info_clear(&mVi);
+
+    free(mReadBuffer);
+    mReadBuffer = NULL;
+}
+
+ssize_t MyVorbisExtractor::readAt(off64_t offset, void *data, size_t size) {
+    if (mReadBuffer == NULL || size > kReadBufferSize) {
+        return mSource->readAt(offset, data, size);
+    }
+
+    if (offset < mReadBufferOffset
+            || offset + (off64_t)size
+                > mReadBufferOffset + (off64_t)mReadBufferSize) {
+        ssize_t n = mSource->readAt(offset, mReadBuffer, kReadBufferSize);
+
+        if (n < 0) {
+            mReadBufferSize = 0;
+            return n;
+        }
+
+        mReadBufferOffset = offset;
+        mReadBufferSize = n;
+    }
+
+    size_t available =
+        (size_t)(mReadBufferOffset + mReadBufferSize - offset);
+
+    if (size > available) {
+        // short read at the end of the stream.
+        size = available;
+    }
+
+    memcpy(data, &mReadBuffer[offset - mReadBufferOffset], size);
+
+    return size;
 }
 
 sp<MetaData> MyVorbisExtractor::getFormat() const {
@@ -234,7 +293,7 @@ status_t MyVorbisExtractor::findNextPage(
 
     for (;;) {
         char signature[4];
-        ssize_t n = mSource->readAt(*pageOffset, &signature, 4);
+        ssize_t n = readAt(*pageOffset, &signature, 4);
 
         if (n < 4) {
             *pageOffset = 0;
@@ -310,6 +369,11 @@ status_t MyVorbisExtractor::findPrevGranulePosition(
 }
 
 status_t MyVorbisExtractor::seekToTime(int64_t timeUs) {
+    if (mTableOfContentsPending) {
+        mTableOfContentsPending = false;
+        buildTableOfContents();
+    }
+
     if (mTableOfContents.isEmpty()) {
         // Perform approximate seeking based on avg. bitrate.
 
@@ -336,6 +400,11 @@ status_t MyVorbisExtractor::seekToTime(int64_t timeUs) {
         }
     }
 
+    if (left == mTableOfContents.size()) {
+        // past the last page.
+        --left;
+    }
+
     const TOCEntry &entry = mTableOfContents.itemAt(left);
 
     LOGV("seeking to entry %d / %d at offset %lld",
@@ -379,7 +448,7 @@ status_t MyVorbisExtractor::seekToOffset(off64_t offset) {
 ssize_t MyVorbisExtractor::readPage(off64_t offset, Page *page) {
     uint8_t header[27];
     ssize_t n;
-    if ((n = mSource->readAt(offset, header, sizeof(header)))
+    if ((n = readAt(offset, header, sizeof(header)))
             < (ssize_t)sizeof(header)) {
         LOGV("failed to read %d bytes at offset 0x%016llx, got %ld bytes",
              sizeof(header), offset, n);
@@ -421,7 +490,7 @@ ssize_t MyVorbisExtractor::readPage(off64_t offset, Page *page) {
     page->mPageNo = U32LE_AT(&header[18]);
 
     page->mNumSegments = header[26];
-    if (mSource->readAt(
+    if (readAt(
                 offset + sizeof(header), page->mLace, page->mNumSegments)
             < (ssize_t)page->mNumSegments) {
         return ERROR_IO;
@@ -499,7 +568,7 @@ status_t MyVorbisExtractor::readNextPacket(MediaBuffer **out) {
             }
             buffer = tmp;
 
-            ssize_t n = mSource->readAt(
+            ssize_t n = readAt(
                     dataOffset,
                     (uint8_t *)buffer->data() + buffer->range_length(),
                     packetSize);
@@ -637,7 +706,7 @@ status_t MyVorbisExtractor::init() {
 
         mMeta->setInt64(kKeyDuration, durationUs);
 
-        buildTableOfContents();
+        mTableOfContentsPending = true;
     }
 
     return OK;
@@ -118,6 +118,7 @@ SampleTable::SampleTable(const sp<DataSource> &source)
       mNumSampleSizes(0),
       mTimeToSampleCount(0),
       mTimeToSample(NULL),
+      mTimeToSampleStart(NULL),
       mSampleTimeEntries(NULL),
       mCompositionTimeDeltaEntries(NULL),
       mNumCompositionTimeDeltaEntries(0),
@@ -126,11 +127,17 @@ SampleTable::SampleTable(const sp<DataSource> &source)
       mNumSyncSamples(0),
       mSyncSamples(NULL),
       mLastSyncSampleIndex(0),
-      mSampleToChunkEntries(NULL) {
+      mSampleToChunkEntries(NULL),
+      mSampleSizeBlock(NULL),
+      mSampleSizeBlockStart(0),
+      mSampleSizeBlockCount(0) {
     mSampleIterator = new SampleIterator(this);
 }
 
 SampleTable::~SampleTable() {
+    delete[] mSampleSizeBlock;
+    mSampleSizeBlock = NULL;
+
     delete[] mSampleToChunkEntries;
     mSampleToChunkEntries = NULL;
 
@@ -146,6 +153,9 @@ SampleTable::~SampleTable() {
     delete[] mSampleTimeEntries;
     mSampleTimeEntries = NULL;
 
+    delete[] mTimeToSampleStart;
+    mTimeToSampleStart = NULL;
+
     delete[] mTimeToSample;
     mTimeToSample = NULL;
 
@@ -233,20 +243,26 @@ status_t SampleTable::setSampleToChunkParams(
     mSampleToChunkEntries =
         new SampleToChunkEntry[mNumSampleToChunkOffsets];
 
+    // The entries are as large as ours, read them all in one go and
+    // convert them in place.
+    CHECK_EQ(sizeof(SampleToChunkEntry), 12u);
+    size_t size = mNumSampleToChunkOffsets * 12;
+    if (mDataSource->readAt(
+                mSampleToChunkOffset + 8, mSampleToChunkEntries, size)
+            != (ssize_t)size) {
+        return ERROR_IO;
+    }
+
     for (uint32_t i = 0; i < mNumSampleToChunkOffsets; ++i) {
-        uint8_t buffer[12];
-        if (mDataSource->readAt(
-                    mSampleToChunkOffset + 8 + i * 12, buffer, sizeof(buffer))
-                != (ssize_t)sizeof(buffer)) {
-            return ERROR_IO;
-        }
+        SampleToChunkEntry *entry = &mSampleToChunkEntries[i];
+        uint32_t firstChunk = ntohl(entry->startChunk);
 
-        CHECK(U32_AT(buffer) >= 1);  // chunk index is 1 based in the spec.
+        CHECK(firstChunk >= 1);  // chunk index is 1 based in the spec.
 
         // We want the chunk index to be 0-based.
-        mSampleToChunkEntries[i].startChunk = U32_AT(buffer) - 1;
-        mSampleToChunkEntries[i].samplesPerChunk = U32_AT(&buffer[4]);
-        mSampleToChunkEntries[i].chunkDesc = U32_AT(&buffer[8]);
+        entry->startChunk = firstChunk - 1;
+        entry->samplesPerChunk = ntohl(entry->samplesPerChunk);
+        entry->chunkDesc = ntohl(entry->chunkDesc);
     }
 
     return OK;
@@ -342,6 +358,18 @@ status_t SampleTable::setTimeToSampleParams(
         mTimeToSample[i] = ntohl(mTimeToSample[i]);
     }
 
+    mTimeToSampleStart = new uint32_t[mTimeToSampleCount * 2];
+
+    uint32_t sampleIndex = 0;
+    uint32_t sampleTime = 0;
+    for (uint32_t i = 0; i < mTimeToSampleCount; ++i) {
+        mTimeToSampleStart[2 * i] = sampleIndex;
+        mTimeToSampleStart[2 * i + 1] = sampleTime;
+
+        sampleIndex += mTimeToSample[2 * i];
+        sampleTime += mTimeToSample[2 * i] * mTimeToSample[2 * i + 1];
+    }
+
     return OK;
 }
 
@@ -519,19 +547,71 @@ void SampleTable::buildSampleEntriesTable() {
           CompareIncreasingTime);
 }
 
+uint32_t SampleTable::getSampleDecodingTime(uint32_t sampleIndex) const {
+    if (mTimeToSampleCount == 0) {
+        return 0;
+    }
+
+    // Find the last entry starting at or before the sample.
+    uint32_t left = 0;
+    uint32_t right = mTimeToSampleCount;
+    while (right - left > 1) {
+        uint32_t center = (left + right) / 2;
+
+        if (sampleIndex < mTimeToSampleStart[2 * center]) {
+            right = center;
+        } else {
+            left = center;
+        }
+    }
+
+    uint32_t n = mTimeToSample[2 * left];
+    uint32_t delta = mTimeToSample[2 * left + 1];
+    uint32_t offset = sampleIndex - mTimeToSampleStart[2 * left];
+    if (offset > n) {
+        // Past the samples covered by the table.
+        offset = n;
+    }
+
+    return mTimeToSampleStart[2 * left + 1] + offset * delta;
+}
+
+void SampleTable::getSortedSampleEntry(
+        uint32_t i, uint32_t *sampleIndex, uint32_t *compositionTime) const {
+    if (mSampleTimeEntries != NULL) {
+        *sampleIndex = mSampleTimeEntries[i].mSampleIndex;
+        *compositionTime = mSampleTimeEntries[i].mCompositionTime;
+        return;
+    }
+
+    // Without composition offsets the samples are in presentation order.
+    *sampleIndex = i;
+    *compositionTime = getSampleDecodingTime(i);
+}
+
 status_t SampleTable::findSampleAtTime(
         uint32_t req_time, uint32_t *sample_index, uint32_t flags) {
-    buildSampleEntriesTable();
+    if (mCompositionTimeDeltaEntries != NULL) {
+        // The samples are reordered, sort them by presentation time.
+        buildSampleEntriesTable();
+    }
+
+    if (mNumSampleSizes == 0) {
+        return ERROR_OUT_OF_RANGE;
+    }
+
+    uint32_t index;
+    uint32_t time;
 
     uint32_t left = 0;
     uint32_t right = mNumSampleSizes;
     while (left < right) {
         uint32_t center = (left + right) / 2;
-        uint32_t centerTime = mSampleTimeEntries[center].mCompositionTime;
+        getSortedSampleEntry(center, &index, &time);
 
-        if (req_time < centerTime) {
+        if (req_time < time) {
             right = center;
-        } else if (req_time > centerTime) {
+        } else if (req_time > time) {
             left = center + 1;
         } else {
             left = center;
@@ -548,24 +628,23 @@ status_t SampleTable::findSampleAtTime(
     }
 
     uint32_t closestIndex = left;
+    getSortedSampleEntry(closestIndex, &index, &time);
 
     switch (flags) {
         case kFlagBefore:
         {
-            while (closestIndex > 0
-                    && mSampleTimeEntries[closestIndex].mCompositionTime
-                            > req_time) {
+            while (closestIndex > 0 && time > req_time) {
                 --closestIndex;
+                getSortedSampleEntry(closestIndex, &index, &time);
             }
             break;
         }
 
         case kFlagAfter:
         {
-            while (closestIndex + 1 < mNumSampleSizes
-                    && mSampleTimeEntries[closestIndex].mCompositionTime
-                            < req_time) {
+            while (closestIndex + 1 < mNumSampleSizes && time < req_time) {
                 ++closestIndex;
+                getSortedSampleEntry(closestIndex, &index, &time);
             }
             break;
         }
@@ -576,18 +655,15 @@ status_t SampleTable::findSampleAtTime(
 
             if (closestIndex > 0) {
                 // Check left neighbour and pick closest.
-                uint32_t absdiff1 =
-                    abs_difference(
-                            mSampleTimeEntries[closestIndex].mCompositionTime,
-                            req_time);
+                uint32_t prevIndex;
+                uint32_t prevTime;
+                getSortedSampleEntry(closestIndex - 1, &prevIndex, &prevTime);
 
-                uint32_t absdiff2 =
-                    abs_difference(
-                            mSampleTimeEntries[closestIndex - 1].mCompositionTime,
-                            req_time);
+                uint32_t absdiff1 = abs_difference(time, req_time);
+                uint32_t absdiff2 = abs_difference(prevTime, req_time);
 
                 if (absdiff1 > absdiff2) {
-                    closestIndex = closestIndex - 1;
+                    index = prevIndex;
                 }
             }
 
@@ -595,11 +671,28 @@ status_t SampleTable::findSampleAtTime(
         }
     }
 
-    *sample_index = mSampleTimeEntries[closestIndex].mSampleIndex;
+    *sample_index = index;
 
     return OK;
 }
 
+uint32_t SampleTable::findSyncSampleEntry(uint32_t sampleIndex) const {
+    // Returns the first entry of the sync sample table at or after the sample.
+    uint32_t left = 0;
+    uint32_t right = mNumSyncSamples;
+    while (left < right) {
+        uint32_t center = (left + right) / 2;
+
+        if (mSyncSamples[center] < sampleIndex) {
+            left = center + 1;
+        } else {
+            right = center;
+        }
+    }
+
+    return left;
+}
+
 status_t SampleTable::findSyncSampleNear(
         uint32_t start_sample_index, uint32_t *sample_index, uint32_t flags) {
     Mutex::Autolock autoLock(mLock);
@@ -617,28 +710,12 @@ status_t SampleTable::findSyncSampleNear(
         return OK;
     }
 
-    uint32_t left = 0;
-    while (left < mNumSyncSamples) {
-        uint32_t x = mSyncSamples[left];
-
-        if (x >= start_sample_index) {
-            break;
-        }
-
-        ++left;
-    }
+    uint32_t left = findSyncSampleEntry(start_sample_index);
     if (left > 0) {
         --left;
     }
 
-    uint32_t x;
-    if (mDataSource->readAt(
-                mSyncSampleOffset + 8 + left * 4, &x, 4) != 4) {
-        return ERROR_IO;
-    }
-
-    x = ntohl(x);
-    --x;
+    uint32_t x = mSyncSamples[left];
 
     if (left + 1 < mNumSyncSamples) {
         uint32_t y = mSyncSamples[left + 1];
@@ -679,13 +756,7 @@ status_t SampleTable::findSyncSampleNear(
             if (x > start_sample_index) {
                 CHECK(left > 0);
 
-                if (mDataSource->readAt(
-                            mSyncSampleOffset + 8 + (left - 1) * 4, &x, 4) != 4) {
-                    return ERROR_IO;
-                }
-
-                x = ntohl(x);
-                --x;
+                x = mSyncSamples[left - 1];
 
                 CHECK(x <= start_sample_index);
             }
@@ -761,8 +832,93 @@ status_t SampleTable::findThumbnailSample(uint32_t *sample_index) {
 
 status_t SampleTable::getSampleSize_l(
         uint32_t sampleIndex, size_t *sampleSize) {
-    return mSampleIterator->getSampleSizeDirect(
-            sampleIndex, sampleSize);
+    *sampleSize = 0;
+
+    if (sampleIndex >= mNumSampleSizes) {
+        return ERROR_OUT_OF_RANGE;
+    }
+
+    if (mDefaultSampleSize > 0) {
+        *sampleSize = mDefaultSampleSize;
+        return OK;
+    }
+
+    if (mSampleSizeBlock == NULL
+            || sampleIndex < mSampleSizeBlockStart
+            || sampleIndex >= mSampleSizeBlockStart + kSampleSizeBlockSize) {
+        status_t err = loadSampleSizeBlock_l(
+                sampleIndex - sampleIndex % kSampleSizeBlockSize);
+        if (err != OK) {
+            return err;
+        }
+    }
+
+    if (sampleIndex >= mSampleSizeBlockStart + mSampleSizeBlockCount) {
+        // The table is truncated.
+        return ERROR_IO;
+    }
+
+    *sampleSize = mSampleSizeBlock[sampleIndex - mSampleSizeBlockStart];
+
+    return OK;
+}
+
+status_t SampleTable::loadSampleSizeBlock_l(uint32_t blockStart) {
+    if (mSampleSizeBlock == NULL) {
+        mSampleSizeBlock = new uint32_t[kSampleSizeBlockSize];
+    }
+
+    mSampleSizeBlockStart = blockStart;
+    mSampleSizeBlockCount = 0;
+
+    uint32_t count = mNumSampleSizes - blockStart;
+    if (count > kSampleSizeBlockSize) {
+        count = kSampleSizeBlockSize;
+    }
+
+    // The block starts at an even sample, so that 4 bit sizes start on a
+    // byte boundary.  The raw sizes are read at the start of the block and
+    // expanded in place from the end.
+    size_t fieldSize = mSampleSizeFieldSize;
+    off64_t offset = mSampleSizeOffset + 12 + (off64_t)blockStart * fieldSize / 8;
+    size_t size = (count * fieldSize + 7) / 8;
+
+    ssize_t n = mDataSource->readAt(offset, mSampleSizeBlock, size);
+    if (n <= 0) {
+        return ERROR_IO;
+    }
+    if ((size_t)n < size) {
+        // Only keep the complete entries of a truncated table.
+        count = n * 8 / fieldSize;
+    }
+
+    const uint8_t *raw = (const uint8_t *)mSampleSizeBlock;
+    for (uint32_t i = count; i-- > 0;) {
+        uint32_t sampleSize;
+        switch (fieldSize) {
+            case 32:
+                sampleSize = U32_AT(&raw[4 * i]);
+                break;
+
+            case 16:
+                sampleSize = U16_AT(&raw[2 * i]);
+                break;
+
+            case 8:
+                sampleSize = raw[i];
+                break;
+
+            default:
+                CHECK_EQ(fieldSize, 4u);
+                sampleSize = (i & 1) ? raw[i / 2] & 0x0f : raw[i / 2] >> 4;
+                break;
+        }
+        mSampleSizeBlock[i] = sampleSize;
+    }
+
+    mSampleSizeBlockCount = count;
+
+    return OK;
 }
 
 status_t SampleTable::getMetaDataForSample(
@@ -796,11 +952,14 @@ status_t SampleTable::getMetaDataForSample(
             // Every sample is a sync sample.
             *isSyncSample = true;
         } else {
-            size_t i = (mLastSyncSampleIndex < mNumSyncSamples)
-                    && (mSyncSamples[mLastSyncSampleIndex] <= sampleIndex)
-                ? mLastSyncSampleIndex : 0;
-
-            while (i < mNumSyncSamples && mSyncSamples[i] < sampleIndex) {
+            // Samples are mostly read in order, so step from the last
+            // lookup if we can and search the table otherwise.
+            size_t i = mLastSyncSampleIndex;
+            if (i >= mNumSyncSamples || mSyncSamples[i] > sampleIndex
+                    || (i + 1 < mNumSyncSamples
+                        && mSyncSamples[i + 1] < sampleIndex)) {
+                i = findSyncSampleEntry(sampleIndex);
+            } else if (mSyncSamples[i] < sampleIndex) {
                 ++i;
             }
 
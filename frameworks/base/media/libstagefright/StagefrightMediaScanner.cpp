@@ -137,15 +137,23 @@ MediaScanResult StagefrightMediaScanner::processFileInternal(
         return HandleMIDI(path, &client);
     }
 
-    sp<MediaMetadataRetriever> mRetriever(new MediaMetadataRetriever);
+    sp<MediaMetadataRetriever> retriever = getRetriever();
 
-    status_t status = mRetriever->setDataSource(path);
+    status_t status = retriever->setDataSource(path);
+    if (status == DEAD_OBJECT || status == INVALID_OPERATION) {
+        // The media server died since the last file or wasn't reachable
+        // when the retriever was created, start over with a new one.
+        mRetriever.clear();
+
+        retriever = getRetriever();
+        status = retriever->setDataSource(path);
+    }
     if (status) {
         return MEDIA_SCAN_RESULT_ERROR;
     }
 
     const char *value;
-    if ((value = mRetriever->extractMetadata(
+    if ((value = retriever->extractMetadata(
                     METADATA_KEY_MIMETYPE)) != NULL) {
         status = client.setMimeType(value);
         if (status) {
@@ -176,7 +184,7 @@ MediaScanResult StagefrightMediaScanner::processFileInternal(
 
     for (size_t i = 0; i < kNumEntries; ++i) {
         const char *value;
-        if ((value = mRetriever->extractMetadata(kKeyMap[i].key)) != NULL) {
+        if ((value = retriever->extractMetadata(kKeyMap[i].key)) != NULL) {
             status = client.addStringTag(kKeyMap[i].tag, value);
             if (status) {
                 return MEDIA_SCAN_RESULT_ERROR;
@@ -187,6 +195,14 @@ MediaScanResult StagefrightMediaScanner::processFileInternal(
     return MEDIA_SCAN_RESULT_OK;
 }
 
+sp<MediaMetadataRetriever> StagefrightMediaScanner::getRetriever() {
+    if (mRetriever == NULL) {
+        mRetriever = new MediaMetadataRetriever;
+    }
+
+    return mRetriever;
+}
+
 char *StagefrightMediaScanner::extractAlbumArt(int fd) {
     LOGV("extractAlbumArt %d", fd);
 
@@ -196,9 +212,9 @@ char *StagefrightMediaScanner::extractAlbumArt(int fd) {
     }
     lseek64(fd, 0, SEEK_SET);
 
-    sp<MediaMetadataRetriever> mRetriever(new MediaMetadataRetriever);
-    if (mRetriever->setDataSource(fd, 0, size) == OK) {
-        sp<IMemory> mem = mRetriever->extractAlbumArt();
+    sp<MediaMetadataRetriever> retriever = getRetriever();
+    if (retriever->setDataSource(fd, 0, size) == OK) {
+        sp<IMemory> mem = retriever->extractAlbumArt();
 
         if (mem != NULL) {
             MediaAlbumArt *art = static_cast<MediaAlbumArt *>(mem->pointer());
@@ -33,7 +33,8 @@ namespace android {
 
 StagefrightMetadataRetriever::StagefrightMetadataRetriever()
     : mParsedMetaData(false),
-      mAlbumArt(NULL) {
+      mAlbumArt(NULL),
+      mVideoDecoderFlags(0) {
     LOGV("StagefrightMetadataRetriever()");
 
     DataSource::RegisterDefaultSniffers();
@@ -43,6 +44,8 @@ StagefrightMetadataRetriever::StagefrightMetadataRetriever()
 StagefrightMetadataRetriever::~StagefrightMetadataRetriever() {
     LOGV("~StagefrightMetadataRetriever()");
 
+    releaseVideoDecoder();
+
     delete mAlbumArt;
     mAlbumArt = NULL;
 
@@ -53,6 +56,8 @@ status_t StagefrightMetadataRetriever::setDataSource(
         const char *uri, const KeyedVector<String8, String8> *headers) {
     LOGV("setDataSource(%s)", uri);
 
+    releaseVideoDecoder();
+
     mParsedMetaData = false;
     mMetaData.clear();
     delete mAlbumArt;
@@ -82,6 +87,8 @@ status_t StagefrightMetadataRetriever::setDataSource(
 
     LOGV("setDataSource(%d, %lld, %lld)", fd, offset, length);
 
+    releaseVideoDecoder();
+
     mParsedMetaData = false;
     mMetaData.clear();
     delete mAlbumArt;
@@ -107,40 +114,72 @@ status_t StagefrightMetadataRetriever::setDataSource(
     return OK;
 }
 
-static VideoFrame *extractVideoFrameWithCodecFlags(
-        OMXClient *client,
+void StagefrightMetadataRetriever::releaseVideoDecoder() {
+    if (mVideoDecoder != NULL) {
+        mVideoDecoder->stop();
+        mVideoDecoder.clear();
+    }
+}
+
+VideoFrame *StagefrightMetadataRetriever::extractVideoFrameWithCodecFlags(
         const sp<MetaData> &trackMeta,
-        const sp<MediaSource> &source,
+        size_t trackIndex,
         uint32_t flags,
         int64_t frameTimeUs,
         int seekMode) {
-    sp<MediaSource> decoder =
-        OMXCodec::Create(
-                client->interface(), source->getFormat(), false, source,
-                NULL, flags | OMXCodec::kClientNeedsFramebuffer);
-
-    if (decoder.get() == NULL) {
-        LOGV("unable to instantiate video decoder.");
+    if (seekMode < MediaSource::ReadOptions::SEEK_PREVIOUS_SYNC ||
+        seekMode > MediaSource::ReadOptions::SEEK_CLOSEST) {
 
+        LOGE("Unknown seek mode: %d", seekMode);
         return NULL;
     }
 
-    status_t err = decoder->start();
-    if (err != OK) {
-        LOGW("OMXCodec::start returned error %d (0x%08x)\n", err, err);
-        return NULL;
+    if (mVideoDecoder != NULL && mVideoDecoderFlags != flags) {
+        releaseVideoDecoder();
     }
 
+    sp<MediaSource> decoder = mVideoDecoder;
+    status_t err;
+
+    if (decoder == NULL) {
+        sp<MediaSource> source = mExtractor->getTrack(trackIndex);
+
+        if (source.get() == NULL) {
+            LOGV("unable to instantiate video track.");
+            return NULL;
+        }
+
+        decoder = OMXCodec::Create(
+                mClient.interface(), source->getFormat(), false, source,
+                NULL, flags | OMXCodec::kClientNeedsFramebuffer);
+
+        if (decoder.get() == NULL) {
+            LOGV("unable to instantiate video decoder.");
+
+            return NULL;
+        }
+
+        err = decoder->start();
+        if (err != OK) {
+            LOGW("OMXCodec::start returned error %d (0x%08x)\n", err, err);
+            return NULL;
+        }
+    } else {
+        LOGV("reusing the video decoder of the previous frame.");
+    }
+
+    // Only software decoders are kept around, hardware ones may be
+    // needed for playback.
+    const char *componentName;
+    bool keepDecoder =
+        decoder->getFormat()->findCString(
+                kKeyDecoderComponent, &componentName)
+        && !strncmp(componentName, "OMX.google.", 11);
+
     // Read one output buffer, ignore format change notifications
     // and spurious empty buffers.
 
     MediaSource::ReadOptions options;
-    if (seekMode < MediaSource::ReadOptions::SEEK_PREVIOUS_SYNC ||
-        seekMode > MediaSource::ReadOptions::SEEK_CLOSEST) {
-
-        LOGE("Unknown seek mode: %d", seekMode);
-        return NULL;
-    }
 
     MediaSource::ReadOptions::SeekMode mode =
             static_cast<MediaSource::ReadOptions::SeekMode>(seekMode);
@@ -173,6 +212,7 @@ static VideoFrame *extractVideoFrameWithCodecFlags(
 
         LOGV("decoding frame failed.");
         decoder->stop();
+        mVideoDecoder.clear();
 
         return NULL;
     }
@@ -189,6 +229,7 @@ static VideoFrame *extractVideoFrameWithCodecFlags(
         buffer = NULL;
 
         decoder->stop();
+        mVideoDecoder.clear();
 
         return NULL;
     }
@@ -261,7 +302,13 @@ static VideoFrame *extractVideoFrameWithCodecFlags(
     buffer->release();
     buffer = NULL;
 
-    decoder->stop();
+    if (keepDecoder) {
+        mVideoDecoder = decoder;
+        mVideoDecoderFlags = flags;
+    } else {
+        decoder->stop();
+        mVideoDecoder.clear();
+    }
 
     if (err != OK) {
         LOGE("Colorconverter failed to convert frame.");
@@ -317,13 +364,6 @@ VideoFrame *StagefrightMetadataRetriever::getFrameAtTime(
     sp<MetaData> trackMeta = mExtractor->getTrackMetaData(
             i, MediaExtractor::kIncludeExtensiveMetaData);
 
-    sp<MediaSource> source = mExtractor->getTrack(i);
-
-    if (source.get() == NULL) {
-        LOGV("unable to instantiate video track.");
-        return NULL;
-    }
-
     const void *data;
     uint32_t type;
     size_t dataSize;
@@ -337,14 +377,14 @@ VideoFrame *StagefrightMetadataRetriever::getFrameAtTime(
 
     VideoFrame *frame =
         extractVideoFrameWithCodecFlags(
-                &mClient, trackMeta, source, OMXCodec::kPreferSoftwareCodecs,
+                trackMeta, i, OMXCodec::kPreferSoftwareCodecs,
                 timeUs, option);
 
     if (frame == NULL) {
         LOGV("Software decoder failed to extract thumbnail, "
              "trying hardware decoder.");
 
-        frame = extractVideoFrameWithCodecFlags(&mClient, trackMeta, source, 0,
+        frame = extractVideoFrameWithCodecFlags(trackMeta, i, 0,
                         timeUs, option);
     }
 
@@ -454,6 +454,7 @@ status_t SurfaceMediaSource::disconnect(int api) {
 }
 
 status_t SurfaceMediaSource::queueBuffer(int bufIndex, int64_t timestamp,
+        const Rect& dirty,
         uint32_t* outWidth, uint32_t* outHeight, uint32_t* outTransform) {
     LOGV("queueBuffer");
 
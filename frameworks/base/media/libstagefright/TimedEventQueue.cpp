@@ -40,7 +40,10 @@
 namespace android {
 
 TimedEventQueue::TimedEventQueue()
-    : mNextEventID(1),
+    : mNextSeq(0),
+      mNumSlackEvents(0),
+      mWakeupTimeUs(INT64_MAX),
+      mNextEventID(1),
       mRunning(false),
       mStopped(false) {
 }
@@ -81,7 +84,12 @@ void TimedEventQueue::stop(bool flush) {
     void *dummy;
     pthread_join(mThread, &dummy);
 
+    for (size_t i = 0; i < mQueue.size(); ++i) {
+        mQueue[i].event->setEventID(0);
+    }
     mQueue.clear();
+    mEventsByID.clear();
+    mNumSlackEvents = 0;
 
     mRunning = false;
 }
@@ -98,62 +106,82 @@ TimedEventQueue::event_id TimedEventQueue::postEventToBack(
 }
 
 TimedEventQueue::event_id TimedEventQueue::postEventWithDelay(
-        const sp<Event> &event, int64_t delay_us) {
+        const sp<Event> &event, int64_t delay_us, int64_t slack_us) {
     CHECK(delay_us >= 0);
-    return postTimedEvent(event, getRealTimeUs() + delay_us);
+    return postTimedEvent(event, getRealTimeUs() + delay_us, slack_us);
+}
+
+static int64_t GetDeadlineUs(int64_t realtime_us, int64_t slack_us) {
+    if (realtime_us < 0 || slack_us <= 0
+            || realtime_us > INT64_MAX - slack_us) {
+        return realtime_us;
+    }
+
+    return realtime_us + slack_us;
 }
 
 TimedEventQueue::event_id TimedEventQueue::postTimedEvent(
-        const sp<Event> &event, int64_t realtime_us) {
+        const sp<Event> &event, int64_t realtime_us, int64_t slack_us) {
     Mutex::Autolock autoLock(mLock);
 
-    event->setEventID(mNextEventID++);
-
-    List<QueueItem>::iterator it = mQueue.begin();
-    while (it != mQueue.end() && realtime_us >= (*it).realtime_us) {
-        ++it;
+    ssize_t index = mEventsByID.indexOfKey(event->eventID());
+    if (index >= 0 && mEventsByID.valueAt(index) == event.get()) {
+        // Still pending, only its time changes.
+        if (event->mQueueIndex == 0) {
+            mQueueHeadChangedCondition.signal();
+        }
+        removeQueueItem_l(event->mQueueIndex);
     }
 
+    event->setEventID(mNextEventID++);
+
     QueueItem item;
     item.event = event;
     item.realtime_us = realtime_us;
+    item.slack_us = slack_us;
+    item.seq = mNextSeq++;
 
-    if (it == mQueue.begin()) {
-        mQueueHeadChangedCondition.signal();
+    if (slack_us > 0) {
+        ++mNumSlackEvents;
     }
 
-    mQueue.insert(it, item);
+    event->mQueueIndex = mQueue.add(item);
+    siftUp_l(event->mQueueIndex);
+
+    mEventsByID.add(event->eventID(), event.get());
+
+    if (event->mQueueIndex == 0
+            || GetDeadlineUs(realtime_us, slack_us) < mWakeupTimeUs) {
+        mQueueHeadChangedCondition.signal();
+    }
 
     mQueueNotEmptyCondition.signal();
 
     return event->eventID();
 }
 
-static bool MatchesEventID(
-        void *cookie, const sp<TimedEventQueue::Event> &event) {
-    TimedEventQueue::event_id *id =
-        static_cast<TimedEventQueue::event_id *>(cookie);
-
-    if (event->eventID() != *id) {
+bool TimedEventQueue::cancelEvent(event_id id) {
+    if (id == 0) {
         return false;
     }
 
-    *id = 0;
-
-    return true;
-}
+    Mutex::Autolock autoLock(mLock);
 
-bool TimedEventQueue::cancelEvent(event_id id) {
-    if (id == 0) {
+    ssize_t index = mEventsByID.indexOfKey(id);
+    if (index < 0) {
         return false;
     }
 
-    cancelEvents(&MatchesEventID, &id, true /* stopAfterFirstMatch */);
+    size_t queueIndex = mEventsByID.valueAt(index)->mQueueIndex;
+    if (queueIndex == 0) {
+        mQueueHeadChangedCondition.signal();
+    }
+
+    LOGV("cancelling event %d", id);
 
-    // if MatchesEventID found a match, it will have set id to 0
-    // (which is not a valid event_id).
+    removeQueueItem_l(queueIndex);
 
-    return id == 0;
+    return true;
 }
 
 void TimedEventQueue::cancelEvents(
@@ -162,25 +190,27 @@ void TimedEventQueue::cancelEvents(
         bool stopAfterFirstMatch) {
     Mutex::Autolock autoLock(mLock);
 
-    List<QueueItem>::iterator it = mQueue.begin();
-    while (it != mQueue.end()) {
-        if (!(*predicate)(cookie, (*it).event)) {
-            ++it;
-            continue;
+    // Removing items reorders the heap, find all of them first.
+    Vector<event_id> ids;
+    for (size_t i = 0; i < mQueue.size(); ++i) {
+        if ((*predicate)(cookie, mQueue[i].event)) {
+            ids.push(mQueue[i].event->eventID());
+
+            if (stopAfterFirstMatch) {
+                break;
+            }
         }
+    }
 
-        if (it == mQueue.begin()) {
+    for (size_t i = 0; i < ids.size(); ++i) {
+        size_t queueIndex = mEventsByID.valueFor(ids[i])->mQueueIndex;
+        if (queueIndex == 0) {
             mQueueHeadChangedCondition.signal();
         }
 
-        LOGV("cancelling event %d", (*it).event->eventID());
+        LOGV("cancelling event %d", ids[i]);
 
-        (*it).event->setEventID(0);
-        it = mQueue.erase(it);
-
-        if (stopAfterFirstMatch) {
-            return;
-        }
+        removeQueueItem_l(queueIndex);
     }
 }
 
@@ -237,7 +267,6 @@ void TimedEventQueue::threadEntry() {
                 mQueueNotEmptyCondition.wait(mLock);
             }
 
-            event_id eventID = 0;
             for (;;) {
                 if (mQueue.empty()) {
                     // The only event in the queue could have been cancelled
@@ -245,11 +274,8 @@ void TimedEventQueue::threadEntry() {
                     break;
                 }
 
-                List<QueueItem>::iterator it = mQueue.begin();
-                eventID = (*it).event->eventID();
-
                 now_us = getRealTimeUs();
-                int64_t when_us = (*it).realtime_us;
+                int64_t when_us = getWakeupTimeUs_l();
 
                 int64_t delay_us;
                 if (when_us < 0 || when_us == INT64_MAX) {
@@ -275,8 +301,10 @@ void TimedEventQueue::threadEntry() {
                     timeoutCapped = true;
                 }
 
+                mWakeupTimeUs = when_us;
                 status_t err = mQueueHeadChangedCondition.waitRelative(
                         mLock, delay_us * 1000ll);
+                mWakeupTimeUs = INT64_MAX;
 
                 if (!timeoutCapped && err == -ETIMEDOUT) {
                     // We finally hit the time this event is supposed to
@@ -286,12 +314,15 @@ void TimedEventQueue::threadEntry() {
                 }
             }
 
-            // The event w/ this id may have been cancelled while we're
-            // waiting for its trigger-time, in that case
-            // removeEventFromQueue_l will return NULL.
-            // Otherwise, the QueueItem will be removed
-            // from the queue and the referenced event returned.
-            event = removeEventFromQueue_l(eventID);
+            // The head may have changed while we were waking up, only
+            // fire it if it is due. Events that were due in the meantime
+            // fire right after, without waiting again.
+            if (!mQueue.empty()) {
+                int64_t when_us = mQueue[0].realtime_us;
+                if (when_us < 0 || when_us == INT64_MAX || when_us <= now_us) {
+                    event = removeQueueItem_l(0);
+                }
+            }
         }
 
         if (event != NULL) {
@@ -301,23 +332,115 @@ void TimedEventQueue::threadEntry() {
     }
 }
 
-sp<TimedEventQueue::Event> TimedEventQueue::removeEventFromQueue_l(
-        event_id id) {
-    for (List<QueueItem>::iterator it = mQueue.begin();
-         it != mQueue.end(); ++it) {
-        if ((*it).event->eventID() == id) {
-            sp<Event> event = (*it).event;
-            event->setEventID(0);
+sp<TimedEventQueue::Event> TimedEventQueue::removeQueueItem_l(
+        size_t index) {
+    sp<Event> event = mQueue[index].event;
 
-            mQueue.erase(it);
+    if (mQueue[index].slack_us > 0) {
+        --mNumSlackEvents;
+    }
 
-            return event;
+    size_t last = mQueue.size() - 1;
+    if (index != last) {
+        moveItem_l(last, index);
+    }
+    mQueue.removeAt(last);
+
+    if (index < mQueue.size()) {
+        if (index > 0 && ItemBefore(mQueue[index], mQueue[(index - 1) / 2])) {
+            siftUp_l(index);
+        } else {
+            siftDown_l(index);
         }
     }
 
-    LOGW("Event %d was not found in the queue, already cancelled?", id);
+    mEventsByID.removeItem(event->eventID());
+    event->setEventID(0);
 
-    return NULL;
+    return event;
+}
+
+int64_t TimedEventQueue::getWakeupTimeUs_l() const {
+    int64_t when_us = mQueue[0].realtime_us;
+
+    if (when_us < 0 || when_us == INT64_MAX || mNumSlackEvents == 0) {
+        return when_us;
+    }
+
+    // Sleep until the first event that cannot be delayed any further,
+    // everything due by then fires in the same wakeup.
+    int64_t wakeup_us = INT64_MAX;
+    for (size_t i = 0; i < mQueue.size(); ++i) {
+        const QueueItem &item = mQueue[i];
+
+        if (item.realtime_us == INT64_MAX) {
+            continue;
+        }
+
+        int64_t deadline_us = GetDeadlineUs(item.realtime_us, item.slack_us);
+        if (deadline_us < wakeup_us) {
+            wakeup_us = deadline_us;
+        }
+    }
+
+    return wakeup_us;
+}
+
+// static
+bool TimedEventQueue::ItemBefore(const QueueItem &a, const QueueItem &b) {
+    if (a.realtime_us != b.realtime_us) {
+        return a.realtime_us < b.realtime_us;
+    }
+
+    return a.seq < b.seq;
+}
+
+void TimedEventQueue::moveItem_l(size_t from, size_t to) {
+    mQueue.editItemAt(to) = mQueue[from];
+    mQueue[to].event->mQueueIndex = to;
+}
+
+void TimedEventQueue::siftUp_l(size_t index) {
+    QueueItem item = mQueue[index];
+
+    while (index > 0) {
+        size_t parent = (index - 1) / 2;
+        if (!ItemBefore(item, mQueue[parent])) {
+            break;
+        }
+
+        moveItem_l(parent, index);
+        index = parent;
+    }
+
+    mQueue.editItemAt(index) = item;
+    item.event->mQueueIndex = index;
+}
+
+void TimedEventQueue::siftDown_l(size_t index) {
+    QueueItem item = mQueue[index];
+    size_t n = mQueue.size();
+
+    for (;;) {
+        size_t child = 2 * index + 1;
+        if (child >= n) {
+            break;
+        }
+
+        if (child + 1 < n && ItemBefore(mQueue[child + 1], mQueue[child])) {
+            ++child;
+        }
+
+        if (!ItemBefore(mQueue[child], item)) {
+            break;
+        }
+
+        moveItem_l(child, index);
+        index = child;
+    }
+
+    mQueue.editItemAt(index) = item;
+    item.event->mQueueIndex = index;
 }
 
 }  // namespace android
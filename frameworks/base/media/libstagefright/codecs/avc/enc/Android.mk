@@ -32,4 +32,8 @@ LOCAL_CFLAGS := \
     -D__arm__ \
     -DOSCL_IMPORT_REF= -DOSCL_UNUSED_ARG= -DOSCL_EXPORT_REF=
 
+ifeq ($(ARCH_ARM_HAVE_NEON),true)
+    LOCAL_CFLAGS += -D__ARM_HAVE_NEON
+endif
+
 include $(BUILD_STATIC_LIBRARY)
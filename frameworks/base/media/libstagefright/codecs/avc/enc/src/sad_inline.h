@@ -18,6 +18,10 @@
 #ifndef _SAD_INLINE_H_
 #define _SAD_INLINE_H_
 
+#if defined(__ARM_HAVE_NEON)
+#include <arm_neon.h>
+#endif
+
 #ifdef __cplusplus
 extern "C"
 {
@@ -74,6 +78,42 @@ extern "C"
 #include "sad_mb_offset.h"
 
 
+#if defined(__ARM_HAVE_NEON)
+
+    /* NEON loads need no alignment, so all ref offsets share this loop. The
+       sum is compared with dmin every 4 rows instead of every row, as the
+       horizontal add costs more than the rows it could save. */
+    __inline int32 simd_sad_mb(uint8 *ref, uint8 *blk, int dmin, int lx)
+    {
+        uint16x8_t acc = vdupq_n_u16(0);
+        uint32 sad = 0;
+        int i, j;
+
+        for (i = 0; i < 4; i++)
+        {
+            for (j = 0; j < 4; j++)
+            {
+                uint8x16_t r = vld1q_u8(ref);
+                uint8x16_t b = vld1q_u8(blk);
+                acc = vabal_u8(acc, vget_low_u8(r), vget_low_u8(b));
+                acc = vabal_u8(acc, vget_high_u8(r), vget_high_u8(b));
+                ref += lx;
+                blk += 16;
+            }
+
+            uint64x2_t sum = vpaddlq_u32(vpaddlq_u16(acc));
+            sad = (uint32)(vgetq_lane_u64(sum, 0) + vgetq_lane_u64(sum, 1));
+            if ((int)sad > dmin)
+            {
+                break;
+            }
+        }
+
+        return sad;
+    }
+
+#else
+
     __inline int32 simd_sad_mb(uint8 *ref, uint8 *blk, int dmin, int lx)
     {
         int32 x4, x5, x6, x8, x9, x10, x11, x12, x14;
@@ -167,6 +207,8 @@ SadMBOffset1:
 
     }
 
+#endif // __ARM_HAVE_NEON
+
 #elif defined(__CC_ARM)  /* only work with arm v5 */
 
     __inline int32 SUB_SAD(int32 sad, int32 tmp, int32 tmp2)
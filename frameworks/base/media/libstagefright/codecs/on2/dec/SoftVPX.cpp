@@ -45,6 +45,7 @@ SoftVPX::SoftVPX(
         OMX_COMPONENTTYPE **component)
     : SimpleSoftOMXComponent(name, callbacks, appData, component),
       mCtx(NULL),
+      mPendingImage(NULL),
       mWidth(320),
       mHeight(240),
       mOutputPortSettingsChange(NONE) {
@@ -115,6 +116,8 @@ void SoftVPX::initPorts() {
         (def.format.video.nFrameWidth * def.format.video.nFrameHeight * 3) / 2;
 
     addPort(def);
+
+    editPortInfo(1)->mSupportsNativeBuffers = true;
 }
 
 static int GetCPUCoreCount() {
@@ -248,21 +251,28 @@ void SoftVPX::onQueueFilled(OMX_U32 portIndex) {
             return;
         }
 
-        if (vpx_codec_decode(
-                    (vpx_codec_ctx_t *)mCtx,
-                    inHeader->pBuffer + inHeader->nOffset,
-                    inHeader->nFilledLen,
-                    NULL,
-                    0)) {
-            LOGE("on2 decoder failed to decode frame.");
+        // A frame that triggered a port reconfiguration was already decoded,
+        // it stays valid in the decoder until the next call to decode.
+        vpx_image_t *img = (vpx_image_t *)mPendingImage;
+        mPendingImage = NULL;
+
+        if (img == NULL) {
+            if (vpx_codec_decode(
+                        (vpx_codec_ctx_t *)mCtx,
+                        inHeader->pBuffer + inHeader->nOffset,
+                        inHeader->nFilledLen,
+                        NULL,
+                        0)) {
+                LOGE("on2 decoder failed to decode frame.");
+
+                notify(OMX_EventError, OMX_ErrorUndefined, 0, NULL);
+                return;
+            }
 
-            notify(OMX_EventError, OMX_ErrorUndefined, 0, NULL);
-            return;
+            vpx_codec_iter_t iter = NULL;
+            img = vpx_codec_get_frame((vpx_codec_ctx_t *)mCtx, &iter);
         }
 
-        vpx_codec_iter_t iter = NULL;
-        vpx_image_t *img = vpx_codec_get_frame((vpx_codec_ctx_t *)mCtx, &iter);
-
         if (img != NULL) {
             CHECK_EQ(img->fmt, IMG_FMT_I420);
 
@@ -277,37 +287,23 @@ void SoftVPX::onQueueFilled(OMX_U32 portIndex) {
 
                 notify(OMX_EventPortSettingsChanged, 1, 0, NULL);
                 mOutputPortSettingsChange = AWAITING_DISABLED;
+                mPendingImage = img;
                 return;
             }
 
             outHeader->nOffset = 0;
-            outHeader->nFilledLen = (width * height * 3) / 2;
             outHeader->nFlags = 0;
             outHeader->nTimeStamp = inHeader->nTimeStamp;
 
-            const uint8_t *srcLine = (const uint8_t *)img->planes[PLANE_Y];
-            uint8_t *dst = outHeader->pBuffer;
-            for (size_t i = 0; i < img->d_h; ++i) {
-                memcpy(dst, srcLine, img->d_w);
-
-                srcLine += img->stride[PLANE_Y];
-                dst += img->d_w;
-            }
-
-            srcLine = (const uint8_t *)img->planes[PLANE_U];
-            for (size_t i = 0; i < img->d_h / 2; ++i) {
-                memcpy(dst, srcLine, img->d_w / 2);
-
-                srcLine += img->stride[PLANE_U];
-                dst += img->d_w / 2;
-            }
-
-            srcLine = (const uint8_t *)img->planes[PLANE_V];
-            for (size_t i = 0; i < img->d_h / 2; ++i) {
-                memcpy(dst, srcLine, img->d_w / 2);
-
-                srcLine += img->stride[PLANE_V];
-                dst += img->d_w / 2;
+            if (writeYUV420Planar(
+                        outInfo, img->d_w, img->d_h,
+                        (const uint8_t *)img->planes[PLANE_Y],
+                        img->stride[PLANE_Y],
+                        (const uint8_t *)img->planes[PLANE_U],
+                        (const uint8_t *)img->planes[PLANE_V],
+                        img->stride[PLANE_U]) != OMX_ErrorNone) {
+                notify(OMX_EventError, OMX_ErrorUndefined, 0, NULL);
+                return;
             }
 
             outInfo->mOwnedByUs = false;
@@ -326,6 +322,10 @@ void SoftVPX::onQueueFilled(OMX_U32 portIndex) {
 }
 
 void SoftVPX::onPortFlushCompleted(OMX_U32 portIndex) {
+    if (portIndex == 0) {
+        // the input buffer the pending frame was decoded from is gone
+        mPendingImage = NULL;
+    }
 }
 
 void SoftVPX::onPortEnableCompleted(OMX_U32 portIndex, bool enabled) {
@@ -47,6 +47,7 @@ private:
     };
 
     void *mCtx;
+    void *mPendingImage;
 
     int32_t mWidth;
     int32_t mHeight;
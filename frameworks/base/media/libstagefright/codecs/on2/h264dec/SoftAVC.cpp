@@ -156,6 +156,8 @@ void SoftAVC::initPorts() {
         (def.format.video.nFrameWidth * def.format.video.nFrameHeight * 3) / 2;
 
     addPort(def);
+
+    editPortInfo(kOutputPortIndex)->mSupportsNativeBuffers = true;
 }
 
 status_t SoftAVC::initDecoder() {
@@ -457,15 +459,24 @@ void SoftAVC::drainOneOutputBuffer(int32_t picId, uint8_t* data) {
     OMX_BUFFERHEADERTYPE *header = mPicToHeaderMap.valueFor(picId);
     outHeader->nTimeStamp = header->nTimeStamp;
     outHeader->nFlags = header->nFlags;
-    outHeader->nFilledLen = mPictureSize;
-    memcpy(outHeader->pBuffer + outHeader->nOffset,
-            data, mPictureSize);
+    writePicture(outInfo, data);
     mPicToHeaderMap.removeItem(picId);
     delete header;
     outInfo->mOwnedByUs = false;
     notifyFillBufferDone(outHeader);
 }
 
+void SoftAVC::writePicture(BufferInfo *outInfo, const uint8_t *data) {
+    const uint8_t *u = data + mWidth * mHeight;
+    const uint8_t *v = u + (mWidth / 2) * (mHeight / 2);
+
+    if (writeYUV420Planar(
+                outInfo, mWidth, mHeight, data, mWidth,
+                u, v, mWidth / 2) != OMX_ErrorNone) {
+        notify(OMX_EventError, OMX_ErrorUndefined, 0, NULL);
+    }
+}
+
 bool SoftAVC::drainAllOutputBuffers() {
     List<BufferInfo *> &outQueue = getPortQueue(kOutputPortIndex);
     H264SwDecPicture decodedPicture;
@@ -481,14 +492,11 @@ bool SoftAVC::drainAllOutputBuffers() {
             int32_t picId = decodedPicture.picId;
             CHECK(mPicToHeaderMap.indexOfKey(picId) >= 0);
 
-            memcpy(outHeader->pBuffer + outHeader->nOffset,
-                decodedPicture.pOutputPicture,
-                mPictureSize);
+            writePicture(outInfo, (uint8_t *)decodedPicture.pOutputPicture);
 
             OMX_BUFFERHEADERTYPE *header = mPicToHeaderMap.valueFor(picId);
             outHeader->nTimeStamp = header->nTimeStamp;
             outHeader->nFlags = header->nFlags;
-            outHeader->nFilledLen = mPictureSize;
             mPicToHeaderMap.removeItem(picId);
             delete header;
         } else {
@@ -93,6 +93,7 @@ private:
     void updatePortDefinitions();
     bool drainAllOutputBuffers();
     void drainOneOutputBuffer(int32_t picId, uint8_t *data);
+    void writePicture(BufferInfo *outInfo, const uint8_t *data);
     void saveFirstOutputBuffer(int32_t pidId, uint8_t *data);
     bool handleCropRectEvent(const CropParams* crop);
     bool handlePortSettingChangeEvent(const H264SwDecInfo *info);
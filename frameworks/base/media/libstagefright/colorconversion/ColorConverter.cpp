@@ -22,6 +22,14 @@
 #include <media/stagefright/MediaDebug.h>
 #include <media/stagefright/MediaErrors.h>
 
+#include <string.h>
+
+#if defined(__ARM_HAVE_NEON)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 namespace android {
 
 ColorConverter::ColorConverter(
@@ -132,6 +140,226 @@ status_t ColorConverter::convert(
     return err;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+
+// Vectorized conversion of a row of 4:2:0 pixels to RGB565, with the same
+// fixed point coefficients as the scalar loops below. Narrowing with
+// saturation clips like the table does, so the results are identical. Each
+// function converts as many pixels as fit in whole vectors and returns how
+// many, the callers convert the rest. "swapRB" puts blue in the high bits,
+// as some of the semi planar conversions do.
+
+#if defined(__ARM_HAVE_NEON)
+
+// Converts 8 pixels, "u" and "v" already minus 128.
+static inline uint16x8_t yuvToRGB565(
+        uint8x8_t y8, int16x8_t u, int16x8_t v, bool swapRB) {
+    int16x8_t y = vreinterpretq_s16_u16(vsubl_u8(y8, vdup_n_u8(16)));
+
+    int32x4_t tmp_lo = vmull_n_s16(vget_low_s16(y), 298);
+    int32x4_t tmp_hi = vmull_n_s16(vget_high_s16(y), 298);
+
+    int32x4_t b_lo = vmlal_n_s16(tmp_lo, vget_low_s16(u), 517);
+    int32x4_t b_hi = vmlal_n_s16(tmp_hi, vget_high_s16(u), 517);
+
+    int32x4_t g_lo = vmlsl_n_s16(
+            vmlsl_n_s16(tmp_lo, vget_low_s16(v), 208), vget_low_s16(u), 100);
+    int32x4_t g_hi = vmlsl_n_s16(
+            vmlsl_n_s16(tmp_hi, vget_high_s16(v), 208), vget_high_s16(u), 100);
+
+    int32x4_t r_lo = vmlal_n_s16(tmp_lo, vget_low_s16(v), 409);
+    int32x4_t r_hi = vmlal_n_s16(tmp_hi, vget_high_s16(v), 409);
+
+    uint8x8_t b = vqmovn_u16(vcombine_u16(
+                vqshrun_n_s32(b_lo, 8), vqshrun_n_s32(b_hi, 8)));
+    uint8x8_t g = vqmovn_u16(vcombine_u16(
+                vqshrun_n_s32(g_lo, 8), vqshrun_n_s32(g_hi, 8)));
+    uint8x8_t r = vqmovn_u16(vcombine_u16(
+                vqshrun_n_s32(r_lo, 8), vqshrun_n_s32(r_hi, 8)));
+
+    uint16x8_t rgb = vshll_n_u8(swapRB ? b : r, 8);
+    rgb = vsriq_n_u16(rgb, vshll_n_u8(g, 8), 5);
+    rgb = vsriq_n_u16(rgb, vshll_n_u8(swapRB ? r : b, 8), 11);
+
+    return rgb;
+}
+
+static inline int16x8_t chroma(uint8x8_t c) {
+    return vreinterpretq_s16_u16(vsubl_u8(c, vdup_n_u8(128)));
+}
+
+static size_t convertRowPlanar(
+        uint16_t *dst, const uint8_t *src_y,
+        const uint8_t *src_u, const uint8_t *src_v,
+        size_t count, bool swapRB) {
+    size_t x = 0;
+    for (; x + 16 <= count; x += 16) {
+        uint8x16_t y = vld1q_u8(&src_y[x]);
+
+        uint8x8_t u = vld1_u8(&src_u[x / 2]);
+        uint8x8_t v = vld1_u8(&src_v[x / 2]);
+        uint8x8x2_t u2 = vzip_u8(u, u);
+        uint8x8x2_t v2 = vzip_u8(v, v);
+
+        vst1q_u16(&dst[x], yuvToRGB565(
+                    vget_low_u8(y), chroma(u2.val[0]), chroma(v2.val[0]),
+                    swapRB));
+        vst1q_u16(&dst[x + 8], yuvToRGB565(
+                    vget_high_u8(y), chroma(u2.val[1]), chroma(v2.val[1]),
+                    swapRB));
+    }
+
+    return x;
+}
+
+static size_t convertRowSemiPlanar(
+        uint16_t *dst, const uint8_t *src_y, const uint8_t *src_uv,
+        size_t count, bool vFirst, bool swapRB) {
+    size_t x = 0;
+    for (; x + 16 <= count; x += 16) {
+        uint8x16_t y = vld1q_u8(&src_y[x]);
+
+        uint8x8x2_t uv = vld2_u8(&src_uv[x]);
+        uint8x8_t u = vFirst ? uv.val[1] : uv.val[0];
+        uint8x8_t v = vFirst ? uv.val[0] : uv.val[1];
+        uint8x8x2_t u2 = vzip_u8(u, u);
+        uint8x8x2_t v2 = vzip_u8(v, v);
+
+        vst1q_u16(&dst[x], yuvToRGB565(
+                    vget_low_u8(y), chroma(u2.val[0]), chroma(v2.val[0]),
+                    swapRB));
+        vst1q_u16(&dst[x + 8], yuvToRGB565(
+                    vget_high_u8(y), chroma(u2.val[1]), chroma(v2.val[1]),
+                    swapRB));
+    }
+
+    return x;
+}
+
+#elif defined(__SSE2__)
+
+// Converts 8 pixels, all three minus their offsets.
+static inline __m128i yuvToRGB565(
+        __m128i y, __m128i u, __m128i v, bool swapRB) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i kMax = _mm_set1_epi16(255);
+    const __m128i kB = _mm_set_epi16(517, 298, 517, 298, 517, 298, 517, 298);
+    const __m128i kG = _mm_set_epi16(-100, 298, -100, 298, -100, 298, -100, 298);
+    const __m128i kGV = _mm_set_epi16(0, -208, 0, -208, 0, -208, 0, -208);
+    const __m128i kR = _mm_set_epi16(409, 298, 409, 298, 409, 298, 409, 298);
+
+    __m128i yu_lo = _mm_unpacklo_epi16(y, u);
+    __m128i yu_hi = _mm_unpackhi_epi16(y, u);
+    __m128i yv_lo = _mm_unpacklo_epi16(y, v);
+    __m128i yv_hi = _mm_unpackhi_epi16(y, v);
+    __m128i v_lo = _mm_unpacklo_epi16(v, zero);
+    __m128i v_hi = _mm_unpackhi_epi16(v, zero);
+
+    __m128i b = _mm_packs_epi32(
+            _mm_srai_epi32(_mm_madd_epi16(yu_lo, kB), 8),
+            _mm_srai_epi32(_mm_madd_epi16(yu_hi, kB), 8));
+    __m128i g = _mm_packs_epi32(
+            _mm_srai_epi32(_mm_add_epi32(
+                    _mm_madd_epi16(yu_lo, kG), _mm_madd_epi16(v_lo, kGV)), 8),
+            _mm_srai_epi32(_mm_add_epi32(
+                    _mm_madd_epi16(yu_hi, kG), _mm_madd_epi16(v_hi, kGV)), 8));
+    __m128i r = _mm_packs_epi32(
+            _mm_srai_epi32(_mm_madd_epi16(yv_lo, kR), 8),
+            _mm_srai_epi32(_mm_madd_epi16(yv_hi, kR), 8));
+
+    b = _mm_min_epi16(_mm_max_epi16(b, zero), kMax);
+    g = _mm_min_epi16(_mm_max_epi16(g, zero), kMax);
+    r = _mm_min_epi16(_mm_max_epi16(r, zero), kMax);
+
+    __m128i high = swapRB ? b : r;
+    __m128i low = swapRB ? r : b;
+
+    return _mm_or_si128(
+            _mm_or_si128(
+                _mm_slli_epi16(_mm_srli_epi16(high, 3), 11),
+                _mm_slli_epi16(_mm_srli_epi16(g, 2), 5)),
+            _mm_srli_epi16(low, 3));
+}
+
+static inline __m128i luma(const uint8_t *src) {
+    return _mm_sub_epi16(
+            _mm_unpacklo_epi8(
+                _mm_loadl_epi64((const __m128i *)src), _mm_setzero_si128()),
+            _mm_set1_epi16(16));
+}
+
+// Loads 4 chroma samples, each for 2 pixels.
+static inline __m128i chroma(const uint8_t *src) {
+    int32_t c4;
+    memcpy(&c4, src, sizeof(c4));
+
+    __m128i c = _mm_cvtsi32_si128(c4);
+    c = _mm_unpacklo_epi8(c, c);
+
+    return _mm_sub_epi16(
+            _mm_unpacklo_epi8(c, _mm_setzero_si128()), _mm_set1_epi16(128));
+}
+
+static size_t convertRowPlanar(
+        uint16_t *dst, const uint8_t *src_y,
+        const uint8_t *src_u, const uint8_t *src_v,
+        size_t count, bool swapRB) {
+    size_t x = 0;
+    for (; x + 8 <= count; x += 8) {
+        _mm_storeu_si128((__m128i *)&dst[x], yuvToRGB565(
+                    luma(&src_y[x]),
+                    chroma(&src_u[x / 2]), chroma(&src_v[x / 2]),
+                    swapRB));
+    }
+
+    return x;
+}
+
+static size_t convertRowSemiPlanar(
+        uint16_t *dst, const uint8_t *src_y, const uint8_t *src_uv,
+        size_t count, bool vFirst, bool swapRB) {
+    size_t x = 0;
+    for (; x + 8 <= count; x += 8) {
+        // u0 v0 u1 v1 u2 v2 u3 v3, each for 2 pixels.
+        __m128i uv = _mm_sub_epi16(
+                _mm_unpacklo_epi8(
+                    _mm_loadl_epi64((const __m128i *)&src_uv[x]),
+                    _mm_setzero_si128()),
+                _mm_set1_epi16(128));
+
+        __m128i even = _mm_shufflehi_epi16(
+                _mm_shufflelo_epi16(uv, _MM_SHUFFLE(2, 2, 0, 0)),
+                _MM_SHUFFLE(2, 2, 0, 0));
+        __m128i odd = _mm_shufflehi_epi16(
+                _mm_shufflelo_epi16(uv, _MM_SHUFFLE(3, 3, 1, 1)),
+                _MM_SHUFFLE(3, 3, 1, 1));
+
+        _mm_storeu_si128((__m128i *)&dst[x], yuvToRGB565(
+                    luma(&src_y[x]),
+                    vFirst ? odd : even, vFirst ? even : odd,
+                    swapRB));
+    }
+
+    return x;
+}
+
+#else
+
+static size_t convertRowPlanar(
+        uint16_t *dst, const uint8_t *src_y,
+        const uint8_t *src_u, const uint8_t *src_v,
+        size_t count, bool swapRB) {
+    return 0;
+}
+
+static size_t convertRowSemiPlanar(
+        uint16_t *dst, const uint8_t *src_y, const uint8_t *src_uv,
+        size_t count, bool vFirst, bool swapRB) {
+    return 0;
+}
+
+#endif
+
 status_t ColorConverter::convertCbYCrY(
         const BitmapParams &src, const BitmapParams &dst) {
     // XXX Untested
@@ -216,7 +444,10 @@ status_t ColorConverter::convertYUV420Planar(
         src_u + (src.mWidth / 2) * (src.mHeight / 2);
 
     for (size_t y = 0; y < src.cropHeight(); ++y) {
-        for (size_t x = 0; x < src.cropWidth(); x += 2) {
+        size_t x = convertRowPlanar(
+                dst_ptr, src_y, src_u, src_v, src.cropWidth(), false);
+
+        for (; x < src.cropWidth(); x += 2) {
             // B = 1.164 * (Y - 16) + 2.018 * (U - 128)
             // G = 1.164 * (Y - 16) - 0.813 * (V - 128) - 0.391 * (U - 128)
             // R = 1.164 * (Y - 16) + 1.596 * (V - 128)
@@ -308,7 +539,11 @@ status_t ColorConverter::convertQCOMYUV420SemiPlanar(
         + src.mCropTop * src.mWidth + src.mCropLeft;
 
     for (size_t y = 0; y < src.cropHeight(); ++y) {
-        for (size_t x = 0; x < src.cropWidth(); x += 2) {
+        size_t x = convertRowSemiPlanar(
+                (uint16_t *)dst_ptr, src_y, src_u, src.cropWidth(),
+                false /* vFirst */, true /* swapRB */);
+
+        for (; x < src.cropWidth(); x += 2) {
             signed y1 = (signed)src_y[x] - 16;
             signed y2 = (signed)src_y[x + 1] - 16;
 
@@ -379,7 +614,11 @@ status_t ColorConverter::convertYUV420SemiPlanar(
         + src.mCropTop * src.mWidth + src.mCropLeft;
 
     for (size_t y = 0; y < src.cropHeight(); ++y) {
-        for (size_t x = 0; x < src.cropWidth(); x += 2) {
+        size_t x = convertRowSemiPlanar(
+                (uint16_t *)dst_ptr, src_y, src_u, src.cropWidth(),
+                true /* vFirst */, true /* swapRB */);
+
+        for (; x < src.cropWidth(); x += 2) {
             signed y1 = (signed)src_y[x] - 16;
             signed y2 = (signed)src_y[x + 1] - 16;
 
@@ -446,7 +685,11 @@ status_t ColorConverter::convertTIYUV420PackedSemiPlanar(
         (const uint8_t *)src_y + src.mWidth * (src.mHeight - src.mCropTop / 2);
 
     for (size_t y = 0; y < src.cropHeight(); ++y) {
-        for (size_t x = 0; x < src.cropWidth(); x += 2) {
+        size_t x = convertRowSemiPlanar(
+                (uint16_t *)dst_ptr, src_y, src_u, src.cropWidth(),
+                false /* vFirst */, false /* swapRB */);
+
+        for (; x < src.cropWidth(); x += 2) {
             signed y1 = (signed)src_y[x] - 16;
             signed y2 = (signed)src_y[x + 1] - 16;
 
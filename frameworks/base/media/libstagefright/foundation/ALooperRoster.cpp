@@ -73,17 +73,30 @@ void ALooperRoster::unregisterHandler(ALooper::handler_id handlerID) {
 
 status_t ALooperRoster::postMessage(
         const sp<AMessage> &msg, int64_t delayUs) {
-    Mutex::Autolock autoLock(mLock);
-    return postMessage_l(msg, delayUs);
+    sp<ALooper> looper;
+
+    {
+        Mutex::Autolock autoLock(mLock);
+        looper = findTargetLooper_l(msg);
+    }
+
+    if (looper == NULL) {
+        return -ENOENT;
+    }
+
+    // The looper's event queue has a lock of its own, every post would
+    // otherwise contend on the roster lock for the whole enqueue.
+    looper->post(msg, delayUs);
+
+    return OK;
 }
 
-status_t ALooperRoster::postMessage_l(
-        const sp<AMessage> &msg, int64_t delayUs) {
+sp<ALooper> ALooperRoster::findTargetLooper_l(const sp<AMessage> &msg) {
     ssize_t index = mHandlers.indexOfKey(msg->target());
 
     if (index < 0) {
         LOGW("failed to post message. Target handler not registered.");
-        return -ENOENT;
+        return NULL;
     }
 
     const HandlerInfo &info = mHandlers.valueAt(index);
@@ -96,12 +109,10 @@ status_t ALooperRoster::postMessage_l(
              msg->target());
 
         mHandlers.removeItemsAt(index);
-        return -ENOENT;
+        return NULL;
     }
 
-    looper->post(msg, delayUs);
-
-    return OK;
+    return looper;
 }
 
 void ALooperRoster::deliverMessage(const sp<AMessage> &msg) {
@@ -154,19 +165,25 @@ sp<ALooper> ALooperRoster::findLooper(ALooper::handler_id handlerID) {
 
 status_t ALooperRoster::postAndAwaitResponse(
         const sp<AMessage> &msg, sp<AMessage> *response) {
-    Mutex::Autolock autoLock(mLock);
+    uint32_t replyID;
 
-    uint32_t replyID = mNextReplyID++;
+    {
+        Mutex::Autolock autoLock(mLock);
+        replyID = mNextReplyID++;
+    }
 
     msg->setInt32("replyID", replyID);
 
-    status_t err = postMessage_l(msg, 0 /* delayUs */);
+    status_t err = postMessage(msg, 0 /* delayUs */);
 
     if (err != OK) {
         response->clear();
         return err;
     }
 
+    // A reply posted before we get here simply waits in mReplies.
+    Mutex::Autolock autoLock(mLock);
+
     ssize_t index;
     while ((index = mReplies.indexOfKey(replyID)) < 0) {
         mRepliesCondition.wait(mLock);
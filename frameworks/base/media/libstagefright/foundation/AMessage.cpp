@@ -85,11 +85,16 @@ void AMessage::freeItem(Item *item) {
     }
 }
 
-AMessage::Item *AMessage::allocateItem(const char *name) {
-    name = AAtomizer::Atomize(name);
+// Messages only hold a handful of items, comparing the names directly is
+// cheaper than atomizing the name first, which takes the atomizer's global
+// lock and walks one of its hash chains.
+static bool isItemName(const char *itemName, const char *name) {
+    return itemName == name || !strcmp(itemName, name);
+}
 
+AMessage::Item *AMessage::allocateItem(const char *name) {
     size_t i = 0;
-    while (i < mNumItems && mItems[i].mName != name) {
+    while (i < mNumItems && !isItemName(mItems[i].mName, name)) {
         ++i;
     }
 
@@ -103,7 +108,7 @@ AMessage::Item *AMessage::allocateItem(const char *name) {
         i = mNumItems++;
         item = &mItems[i];
 
-        item->mName = name;
+        item->mName = AAtomizer::Atomize(name);
     }
 
     return item;
@@ -111,12 +116,10 @@ AMessage::Item *AMessage::allocateItem(const char *name) {
 
 const AMessage::Item *AMessage::findItem(
         const char *name, Type type) const {
-    name = AAtomizer::Atomize(name);
-
     for (size_t i = 0; i < mNumItems; ++i) {
         const Item *item = &mItems[i];
 
-        if (item->mName == name) {
+        if (isItemName(item->mName, name)) {
             return item->mType == type ? item : NULL;
         }
     }
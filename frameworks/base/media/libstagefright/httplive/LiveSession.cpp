@@ -29,6 +29,7 @@
 #include <media/stagefright/foundation/hexdump.h>
 #include <media/stagefright/foundation/ABuffer.h>
 #include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/foundation/ALooper.h>
 #include <media/stagefright/foundation/AMessage.h>
 #include <media/stagefright/DataSource.h>
 #include <media/stagefright/FileSource.h>
@@ -40,6 +41,50 @@
 
 namespace android {
 
+// Switching to a higher bandwidth requires this many fragments queued and
+// this much time spent at the current bandwidth.
+static const size_t kMinQueuedFragmentsForUpSwitch = 2;
+static const int64_t kMinUpSwitchIntervalUs = 10000000ll;
+
+// Downloads segments ahead of time, each fetcher has a thread and an http
+// connection of its own.
+struct LiveSession::SegmentFetcher : public AHandler {
+    SegmentFetcher(LiveSession *session, const sp<HTTPBase> &httpSource)
+        : mSession(session),
+          mHTTPDataSource(httpSource) {
+    }
+
+    void fetch(const AString &url) {
+        sp<AMessage> msg = new AMessage(kWhatFetch, id());
+        msg->setString("url", url.c_str());
+        msg->post();
+    }
+
+    void disconnect() {
+        mHTTPDataSource->disconnect();
+    }
+
+protected:
+    virtual void onMessageReceived(const sp<AMessage> &msg) {
+        CHECK_EQ(msg->what(), (uint32_t)kWhatFetch);
+
+        AString url;
+        CHECK(msg->findString("url", &url));
+
+        mSession->onPrefetch(mHTTPDataSource, url);
+    }
+
+private:
+    enum {
+        kWhatFetch = 'fetc',
+    };
+
+    LiveSession *mSession;
+    sp<HTTPBase> mHTTPDataSource;
+
+    DISALLOW_EVIL_CONSTRUCTORS(SegmentFetcher);
+};
+
 LiveSession::LiveSession(uint32_t flags, bool uidValid, uid_t uid)
     : mFlags(flags),
       mUIDValid(uidValid),
@@ -59,13 +104,47 @@ LiveSession::LiveSession(uint32_t flags, bool uidValid, uid_t uid)
       mSeekDone(false),
       mDisconnectPending(false),
       mMonitorQueueGeneration(0),
+      mNextFetcher(0),
+      mNumActiveFetches(0),
+      mHaveBandwidthEstimate(false),
+      mBandwidthEstimateBps(0.0),
+      mLastBandwidthSwitchTimeUs(-1),
       mRefreshState(INITIAL_MINIMUM_RELOAD_DELAY) {
     if (mUIDValid) {
         mHTTPDataSource->setUID(mUID);
     }
+
+    for (size_t i = 0; i < kNumSegmentFetchers; ++i) {
+        sp<HTTPBase> httpSource =
+            HTTPBase::Create(
+                (mFlags & kFlagIncognito)
+                    ? HTTPBase::kFlagIncognito
+                    : 0);
+
+        if (mUIDValid) {
+            httpSource->setUID(mUID);
+        }
+
+        sp<ALooper> looper = new ALooper;
+        looper->setName("LiveSession fetcher");
+        looper->start();
+
+        sp<SegmentFetcher> fetcher = new SegmentFetcher(this, httpSource);
+        looper->registerHandler(fetcher);
+
+        mFetcherLoopers.push(looper);
+        mFetchers.push(fetcher);
+    }
 }
 
 LiveSession::~LiveSession() {
+    // The fetchers call back into us, make sure they are done before
+    // going away.
+    for (size_t i = 0; i < mFetchers.size(); ++i) {
+        mFetchers[i]->disconnect();
+        mFetcherLoopers[i]->unregisterHandler(mFetchers[i]->id());
+        mFetcherLoopers[i]->stop();
+    }
 }
 
 sp<DataSource> LiveSession::getDataSource() {
@@ -92,6 +171,13 @@ void LiveSession::disconnect() {
 
     mHTTPDataSource->disconnect();
 
+    for (size_t i = 0; i < mFetchers.size(); ++i) {
+        mFetchers[i]->disconnect();
+    }
+
+    // Wake up onDownloadNext if it is waiting for a prefetched segment.
+    mCondition.broadcast();
+
     (new AMessage(kWhatDisconnect, id()))->post();
 }
 
@@ -213,9 +299,17 @@ void LiveSession::onDisconnect() {
 
     Mutex::Autolock autoLock(mLock);
     mDisconnectPending = false;
+    mPrefetchItems.clear();
 }
 
 status_t LiveSession::fetchFile(const char *url, sp<ABuffer> *out) {
+    return fetchFile(mHTTPDataSource, url, out);
+}
+
+// Also called on the fetcher threads, mExtraHeaders is only modified by
+// onConnect before anything is prefetched.
+status_t LiveSession::fetchFile(
+        const sp<HTTPBase> &httpSource, const char *url, sp<ABuffer> *out) {
     *out = NULL;
 
     sp<DataSource> source;
@@ -234,14 +328,14 @@ status_t LiveSession::fetchFile(const char *url, sp<ABuffer> *out) {
             }
         }
 
-        status_t err = mHTTPDataSource->connect(
+        status_t err = httpSource->connect(
                 url, mExtraHeaders.isEmpty() ? NULL : &mExtraHeaders);
 
         if (err != OK) {
             return err;
         }
 
-        source = mHTTPDataSource;
+        source = httpSource;
     }
 
     off64_t size;
@@ -344,6 +438,166 @@ sp<M3UParser> LiveSession::fetchPlaylist(const char *url, bool *unchanged) {
     return playlist;
 }
 
+status_t LiveSession::fetchSegment(const char *url, sp<ABuffer> *out) {
+    {
+        Mutex::Autolock autoLock(mLock);
+
+        // Only this thread removes items, the index remains valid while
+        // waiting.
+        ssize_t index = findPrefetchItem_l(url);
+
+        if (index >= 0) {
+            while (!mPrefetchItems[index].mDone && !mDisconnectPending) {
+                mCondition.wait(mLock);
+            }
+
+            if (!mPrefetchItems[index].mDone) {
+                return ERROR_IO;
+            }
+
+            LOGV("using prefetched segment '%s'", url);
+
+            status_t err = mPrefetchItems[index].mError;
+            *out = mPrefetchItems[index].mBuffer;
+            mPrefetchItems.removeAt(index);
+
+            return err;
+        }
+
+        ++mNumActiveFetches;
+    }
+
+    int64_t startUs = ALooper::GetNowUs();
+    status_t err = fetchFile(url, out);
+    int64_t delayUs = ALooper::GetNowUs() - startUs;
+
+    Mutex::Autolock autoLock(mLock);
+    if (err == OK) {
+        addBandwidthSample_l((*out)->size(), delayUs);
+    }
+    --mNumActiveFetches;
+
+    return err;
+}
+
+void LiveSession::prefetchSegments(int32_t firstSeqNumberInPlaylist) {
+    Vector<AString> urls;
+    for (size_t i = 0; i < kNumSegmentFetchers; ++i) {
+        int32_t index = mSeqNumber + (int32_t)i - firstSeqNumberInPlaylist;
+
+        AString url;
+        if (index < 0 || !mPlaylist->itemAt(index, &url)) {
+            break;
+        }
+
+        urls.push(url);
+    }
+
+    Mutex::Autolock autoLock(mLock);
+
+    // Drop what is not going to be played next after a seek or a
+    // bandwidth change, the fetchers ignore them once they complete.
+    for (size_t i = mPrefetchItems.size(); i-- > 0;) {
+        bool wanted = false;
+        for (size_t j = 0; j < urls.size(); ++j) {
+            if (urls[j] == mPrefetchItems[i].mURI) {
+                wanted = true;
+                break;
+            }
+        }
+
+        if (!wanted) {
+            mPrefetchItems.removeAt(i);
+        }
+    }
+
+    for (size_t i = 0; i < urls.size(); ++i) {
+        if (findPrefetchItem_l(urls[i]) >= 0) {
+            continue;
+        }
+
+        PrefetchItem item;
+        item.mURI = urls[i];
+        item.mDone = false;
+        item.mError = OK;
+        mPrefetchItems.push(item);
+
+        mFetchers[mNextFetcher]->fetch(urls[i]);
+        mNextFetcher = (mNextFetcher + 1) % mFetchers.size();
+    }
+}
+
+// Called on the fetcher threads.
+void LiveSession::onPrefetch(
+        const sp<HTTPBase> &httpSource, const AString &url) {
+    {
+        Mutex::Autolock autoLock(mLock);
+
+        if (mDisconnectPending || findPrefetchItem_l(url) < 0) {
+            // No longer wanted.
+            return;
+        }
+
+        ++mNumActiveFetches;
+    }
+
+    sp<ABuffer> buffer;
+    int64_t startUs = ALooper::GetNowUs();
+    status_t err = fetchFile(httpSource, url.c_str(), &buffer);
+    int64_t delayUs = ALooper::GetNowUs() - startUs;
+
+    Mutex::Autolock autoLock(mLock);
+    if (err == OK) {
+        addBandwidthSample_l(buffer->size(), delayUs);
+    }
+    --mNumActiveFetches;
+
+    ssize_t index = findPrefetchItem_l(url);
+    if (index >= 0) {
+        PrefetchItem *item = &mPrefetchItems.editItemAt(index);
+        item->mDone = true;
+        item->mError = err;
+        item->mBuffer = buffer;
+
+        mCondition.broadcast();
+    }
+}
+
+ssize_t LiveSession::findPrefetchItem_l(const AString &url) const {
+    for (size_t i = 0; i < mPrefetchItems.size(); ++i) {
+        if (mPrefetchItems[i].mURI == url) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+void LiveSession::addBandwidthSample_l(size_t numBytes, int64_t delayUs) {
+    if (delayUs <= 0) {
+        return;
+    }
+
+    // Concurrent downloads share the link, each of them only sees
+    // part of the bandwidth.
+    double sampleBps =
+        numBytes * 8E6 * mNumActiveFetches / (double)delayUs;
+
+    if (!mHaveBandwidthEstimate) {
+        mBandwidthEstimateBps = sampleBps;
+        mHaveBandwidthEstimate = true;
+    } else {
+        // Follow drops faster than improvements.
+        double alpha = (sampleBps < mBandwidthEstimateBps) ? 0.5 : 0.2;
+        mBandwidthEstimateBps =
+            alpha * sampleBps + (1.0 - alpha) * mBandwidthEstimateBps;
+    }
+
+    LOGV("segment of %d bytes fetched in %lld us, bandwidth now estimated "
+         "at %.2f kbps",
+         numBytes, delayUs, mBandwidthEstimateBps / 1024.0);
+}
+
 static double uniformRand() {
     return (double)rand() / RAND_MAX;
 }
@@ -355,14 +609,20 @@ size_t LiveSession::getBandwidthIndex() {
 
 #if 1
     int32_t bandwidthBps;
-    if (mHTTPDataSource != NULL
-            && mHTTPDataSource->estimateBandwidth(&bandwidthBps)) {
-        LOGV("bandwidth estimated at %.2f kbps", bandwidthBps / 1024.0f);
-    } else {
-        LOGV("no bandwidth estimate.");
-        return 0;  // Pick the lowest bandwidth stream by default.
+    {
+        Mutex::Autolock autoLock(mLock);
+
+        if (!mHaveBandwidthEstimate) {
+            LOGV("no bandwidth estimate.");
+            return 0;  // Pick the lowest bandwidth stream by default.
+        }
+
+        bandwidthBps = mBandwidthEstimateBps > 0x7fffffff
+            ? 0x7fffffff : (int32_t)mBandwidthEstimateBps;
     }
 
+    LOGV("bandwidth estimated at %.2f kbps", bandwidthBps / 1024.0f);
+
     char value[PROPERTY_VALUE_MAX];
     if (property_get("media.httplive.max-bw", value, NULL)) {
         char *end;
@@ -385,6 +645,30 @@ size_t LiveSession::getBandwidthIndex() {
                             > (size_t)bandwidthBps) {
         --index;
     }
+
+    if (mPrevBandwidthIndex >= 0
+            && (size_t)mPrevBandwidthIndex < mBandwidthItems.size()) {
+        size_t prevIndex = mPrevBandwidthIndex;
+        size_t numQueued = mDataSource->countQueuedBuffers();
+
+        if (index > prevIndex) {
+            // Go up one step at a time, and only once enough is queued to
+            // survive a wrong guess.
+            if (numQueued < kMinQueuedFragmentsForUpSwitch
+                    || ALooper::GetNowUs() - mLastBandwidthSwitchTimeUs
+                            < kMinUpSwitchIntervalUs) {
+                index = prevIndex;
+            } else {
+                index = prevIndex + 1;
+            }
+        } else if (index < prevIndex
+                && numQueued >= kMinQueuedFragmentsForUpSwitch
+                && (unsigned long)bandwidthBps
+                        >= mBandwidthItems.itemAt(prevIndex).mBandwidth / 2) {
+            // A dip that the queued fragments can absorb.
+            index = prevIndex;
+        }
+    }
 #elif 0
     // Change bandwidth at random()
     size_t index = uniformRand() * mBandwidthItems.size();
@@ -660,7 +944,7 @@ rinse_repeat:
     }
 
     sp<ABuffer> buffer;
-    status_t err = fetchFile(uri.c_str(), &buffer);
+    status_t err = fetchSegment(uri.c_str(), &buffer);
     if (err != OK) {
         LOGE("failed to fetch .ts segment at url '%s'", uri.c_str());
         mDataSource->queueEOS(err);
@@ -710,6 +994,11 @@ rinse_repeat:
         bandwidthChanged = false;
     }
 
+    if (mPrevBandwidthIndex < 0
+            || (size_t)mPrevBandwidthIndex != bandwidthIndex) {
+        mLastBandwidthSwitchTimeUs = ALooper::GetNowUs();
+    }
+
     if (seekDiscontinuity || explicitDiscontinuity || bandwidthChanged) {
         // Signal discontinuity.
 
@@ -730,6 +1019,8 @@ rinse_repeat:
     mPrevBandwidthIndex = bandwidthIndex;
     ++mSeqNumber;
 
+    prefetchSegments(firstSeqNumberInPlaylist);
+
     postMonitorQueue();
 }
 
@@ -143,6 +143,10 @@ private:
         TEXTPLAYER_STARTED  = 0x20000,
 
         SLOW_DECODER_HACK   = 0x40000,
+
+        // The compressed audio is passed to the audio hardware, which
+        // decodes it.
+        AUDIO_OFFLOAD       = 0x80000,
     };
 
     mutable Mutex mLock;
@@ -263,6 +267,8 @@ private:
 
     void setAudioSource(sp<MediaSource> source);
     status_t initAudioDecoder();
+    bool shouldOffloadAudio(const char *mime) const;
+    status_t fallBackFromAudioOffload_l();
 
     void setVideoSource(sp<MediaSource> source);
     status_t initVideoDecoder(uint32_t flags = 0);
@@ -25,6 +25,7 @@
 namespace android {
 
 struct ABuffer;
+struct ALooper;
 struct DataSource;
 struct LiveDataSource;
 struct M3UParser;
@@ -60,6 +61,10 @@ private:
     enum {
         kMaxNumQueuedFragments = 3,
         kMaxNumRetries         = 5,
+
+        // Number of segments downloaded ahead of the one being queued,
+        // each by a fetcher of its own.
+        kNumSegmentFetchers    = 2,
     };
 
     enum {
@@ -74,6 +79,15 @@ private:
         unsigned long mBandwidth;
     };
 
+    struct SegmentFetcher;
+
+    struct PrefetchItem {
+        AString mURI;
+        bool mDone;
+        status_t mError;
+        sp<ABuffer> mBuffer;
+    };
+
     uint32_t mFlags;
     bool mUIDValid;
     uid_t mUID;
@@ -104,6 +118,18 @@ private:
 
     int32_t mMonitorQueueGeneration;
 
+    Vector<sp<ALooper> > mFetcherLoopers;
+    Vector<sp<SegmentFetcher> > mFetchers;
+    size_t mNextFetcher;
+
+    // Guarded by mLock.
+    Vector<PrefetchItem> mPrefetchItems;
+    size_t mNumActiveFetches;
+
+    bool mHaveBandwidthEstimate;
+    double mBandwidthEstimateBps;
+    int64_t mLastBandwidthSwitchTimeUs;
+
     enum RefreshState {
         INITIAL_MINIMUM_RELOAD_DELAY,
         FIRST_UNCHANGED_RELOAD_ATTEMPT,
@@ -121,9 +147,19 @@ private:
     void onSeek(const sp<AMessage> &msg);
 
     status_t fetchFile(const char *url, sp<ABuffer> *out);
+    status_t fetchFile(
+            const sp<HTTPBase> &httpSource,
+            const char *url, sp<ABuffer> *out);
     sp<M3UParser> fetchPlaylist(const char *url, bool *unchanged);
     size_t getBandwidthIndex();
 
+    // Returns the segment, downloaded ahead of time if it was prefetched.
+    status_t fetchSegment(const char *url, sp<ABuffer> *out);
+    void prefetchSegments(int32_t firstSeqNumberInPlaylist);
+    void onPrefetch(const sp<HTTPBase> &httpSource, const AString &url);
+    ssize_t findPrefetchItem_l(const AString &url) const;
+    void addBandwidthSample_l(size_t numBytes, int64_t delayUs);
+
     status_t decryptBuffer(
             size_t playlistIndex, const sp<ABuffer> &buffer);
 
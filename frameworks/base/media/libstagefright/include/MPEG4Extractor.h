@@ -46,6 +46,15 @@ protected:
     virtual ~MPEG4Extractor();
 
 private:
+    friend class MPEG4Source;
+
+    // Defaults for the samples of the movie fragments of a track ('trex').
+    struct TrackExtends {
+        uint32_t defaultSampleDuration;
+        uint32_t defaultSampleSize;
+        uint32_t defaultSampleFlags;
+    };
+
     struct Track {
         Track *next;
         sp<MetaData> meta;
@@ -53,6 +62,12 @@ private:
         sp<SampleTable> sampleTable;
         bool includes_expensive_metadata;
         bool skipTrack;
+
+        // A fragmented track has no samples in the movie box, they are
+        // described by the movie fragments following it.
+        bool hasTrackExtends;
+        bool isFragmented;
+        TrackExtends trackExtends;
     };
 
     sp<DataSource> mDataSource;
@@ -65,6 +80,13 @@ private:
 
     Vector<uint32_t> mPath;
 
+    // Fragmented files: the movie timescale and the duration of the whole
+    // presentation ('mehd') in it, and where to look for the first movie
+    // fragment.
+    uint32_t mMovieTimescale;
+    int64_t mFragmentDuration;
+    off64_t mFirstMoofOffset;
+
     status_t readMetaData();
     status_t parseChunk(off64_t *offset, int depth);
     status_t parseMetaData(off64_t offset, size_t size);
@@ -88,6 +110,8 @@ private:
     status_t parseDrmSINF(off64_t *offset, off64_t data_offset);
 
     status_t parseTrackHeader(off64_t data_offset, off64_t data_size);
+    status_t parseTrackExtends(off64_t data_offset, off64_t data_size);
+    void setupFragmentedTracks();
 
     Track *findTrackByMimePrefix(const char *mimePrefix);
 
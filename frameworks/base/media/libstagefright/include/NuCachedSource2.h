@@ -21,6 +21,7 @@
 #include <media/stagefright/foundation/ABase.h>
 #include <media/stagefright/foundation/AHandlerReflector.h>
 #include <media/stagefright/DataSource.h>
+#include <utils/Vector.h>
 
 namespace android {
 
@@ -75,6 +76,10 @@ private:
         kDefaultHighWaterThreshold      = 20 * 1024 * 1024,
         kDefaultLowWaterThreshold       = 4 * 1024 * 1024,
 
+        // Data cached before a seek moved away from it is kept up to
+        // this size.
+        kMaxRetainedBytes               = 8 * 1024 * 1024,
+
         // Read data after a 15 sec timeout whether we're actively
         // fetching or not.
         kDefaultKeepAliveIntervalUs     = 15000000,
@@ -99,6 +104,17 @@ private:
 
     PageCache *mCache;
     off64_t mCacheOffset;
+
+    // Ranges of the stream cached earlier, by offset. They do not overlap
+    // the range being fetched, which is merged with the next one when it
+    // reaches it, so seeking back to them does not fetch them again.
+    struct RetainedRange {
+        off64_t mOffset;
+        PageCache *mCache;
+    };
+    Vector<RetainedRange> mRetainedRanges;
+    size_t mRetainedBytes;
+
     status_t mFinalStatus;
     off64_t mLastAccessPos;
     sp<AMessage> mAsyncResult;
@@ -123,6 +139,12 @@ private:
     ssize_t readInternal(off64_t offset, void *data, size_t size);
     status_t seekInternal_l(off64_t offset);
 
+    void retainCache_l();
+    ssize_t findRetainedRange_l(off64_t offset) const;
+    bool readFromRetainedRange_l(off64_t offset, void *data, size_t size);
+    void trimRetainedRanges_l();
+    size_t prepareFetch_l();
+
     size_t approxDataRemaining_l(status_t *finalStatus);
 
     void restartPrefetcherIfNecessary_l(
@@ -111,6 +111,10 @@ private:
     uint32_t mTimeToSampleCount;
     uint32_t *mTimeToSample;
 
+    // The index and decoding time of the first sample of each time-to-sample
+    // entry, so that the time of a sample is found by a binary search.
+    uint32_t *mTimeToSampleStart;
+
     struct SampleTimeEntry {
         uint32_t mSampleIndex;
         uint32_t mCompositionTime;
@@ -135,11 +139,26 @@ private:
     };
     SampleToChunkEntry *mSampleToChunkEntries;
 
+    // Sample sizes are decoded kSampleSizeBlockSize at a time, so that
+    // walking through them does not read the table entry by entry.
+    enum {
+        kSampleSizeBlockSize = 1024
+    };
+    uint32_t *mSampleSizeBlock;
+    uint32_t mSampleSizeBlockStart;
+    uint32_t mSampleSizeBlockCount;
+
     friend struct SampleIterator;
 
     status_t getSampleSize_l(uint32_t sample_index, size_t *sample_size);
+    status_t loadSampleSizeBlock_l(uint32_t blockStart);
     uint32_t getCompositionTimeOffset(uint32_t sampleIndex);
 
+    uint32_t getSampleDecodingTime(uint32_t sampleIndex) const;
+    void getSortedSampleEntry(
+            uint32_t i, uint32_t *sampleIndex, uint32_t *compositionTime) const;
+    uint32_t findSyncSampleEntry(uint32_t sampleIndex) const;
+
     static int CompareIncreasingTime(const void *, const void *);
 
     void buildSampleEntriesTable();
@@ -21,6 +21,7 @@
 #include "SoftOMXComponent.h"
 
 #include <media/stagefright/foundation/AHandlerReflector.h>
+#include <ui/android_native_buffer.h>
 #include <utils/RefBase.h>
 #include <utils/threads.h>
 #include <utils/Vector.h>
@@ -44,6 +45,10 @@ protected:
     struct BufferInfo {
         OMX_BUFFERHEADERTYPE *mHeader;
         bool mOwnedByUs;
+
+        // Set if the buffer is a GraphicBuffer of the client's native
+        // window, mHeader->pBuffer is then its handle.
+        sp<ANativeWindowBuffer> mNativeBuffer;
     };
 
     struct PortInfo {
@@ -51,6 +56,12 @@ protected:
         Vector<BufferInfo> mBuffers;
         List<BufferInfo *> mQueue;
 
+        // Video output ports whose frames are written with
+        // writeYUV420Planar() may accept native window buffers instead of
+        // plain memory, the client then decides whether to use them.
+        bool mSupportsNativeBuffers;
+        bool mUseNativeBuffers;
+
         enum {
             NONE,
             DISABLING,
@@ -74,6 +85,14 @@ protected:
 
     PortInfo *editPortInfo(OMX_U32 portIndex);
 
+    // Copies a planar YUV 4:2:0 frame into an output buffer, as I420 into
+    // plain memory or as YV12 into a native window buffer, and sets the
+    // filled length of the buffer.
+    OMX_ERRORTYPE writeYUV420Planar(
+            BufferInfo *info, size_t width, size_t height,
+            const uint8_t *y, size_t yStride,
+            const uint8_t *u, const uint8_t *v, size_t uvStride);
+
 private:
     enum {
         kWhatSendCommand,
@@ -81,6 +100,13 @@ private:
         kWhatFillThisBuffer,
     };
 
+    // Indices of the Android native buffer extensions.
+    enum {
+        kIndexEnableAndroidNativeBuffers = OMX_IndexVendorStartUnused + 0x100,
+        kIndexGetAndroidNativeBufferUsage,
+        kIndexUseAndroidNativeBuffer,
+    };
+
     Mutex mLock;
 
     sp<ALooper> mLooper;
@@ -103,6 +129,9 @@ private:
     virtual OMX_ERRORTYPE setParameter(
             OMX_INDEXTYPE index, const OMX_PTR params);
 
+    virtual OMX_ERRORTYPE getExtensionIndex(
+            const char *name, OMX_INDEXTYPE *index);
+
     virtual OMX_ERRORTYPE useBuffer(
             OMX_BUFFERHEADERTYPE **buffer,
             OMX_U32 portIndex,
@@ -110,6 +139,13 @@ private:
             OMX_U32 size,
             OMX_U8 *ptr);
 
+    BufferInfo *addBuffer_l(
+            OMX_BUFFERHEADERTYPE **buffer,
+            OMX_U32 portIndex,
+            OMX_PTR appPrivate,
+            OMX_U32 size,
+            OMX_U8 *ptr);
+
     virtual OMX_ERRORTYPE allocateBuffer(
             OMX_BUFFERHEADERTYPE **buffer,
             OMX_U32 portIndex,
@@ -27,6 +27,8 @@ namespace android {
 
 struct DataSource;
 class MediaExtractor;
+class MediaSource;
+class MetaData;
 
 struct StagefrightMetadataRetriever : public MediaMetadataRetrieverInterface {
     StagefrightMetadataRetriever();
@@ -51,8 +53,22 @@ private:
     KeyedVector<int, String8> mMetaData;
     MediaAlbumArt *mAlbumArt;
 
+    // A software video decoder is kept started between frames of the
+    // same data source, the callers usually grab several of them.
+    sp<MediaSource> mVideoDecoder;
+    uint32_t mVideoDecoderFlags;
+
     void parseMetaData();
 
+    VideoFrame *extractVideoFrameWithCodecFlags(
+            const sp<MetaData> &trackMeta,
+            size_t trackIndex,
+            uint32_t flags,
+            int64_t frameTimeUs,
+            int seekMode);
+
+    void releaseVideoDecoder();
+
     StagefrightMetadataRetriever(const StagefrightMetadataRetriever &);
 
     StagefrightMetadataRetriever &operator=(
@@ -20,9 +20,10 @@
 
 #include <pthread.h>
 
-#include <utils/List.h>
+#include <utils/KeyedVector.h>
 #include <utils/RefBase.h>
 #include <utils/threads.h>
+#include <utils/Vector.h>
 
 namespace android {
 
@@ -32,7 +33,8 @@ struct TimedEventQueue {
 
     struct Event : public RefBase {
         Event()
-            : mEventID(0) {
+            : mEventID(0),
+              mQueueIndex(0) {
         }
 
         virtual ~Event() {}
@@ -49,6 +51,9 @@ struct TimedEventQueue {
 
         event_id mEventID;
 
+        // Position in the queue's heap while the event is pending.
+        size_t mQueueIndex;
+
         void setEventID(event_id id) {
             mEventID = id;
         }
@@ -75,11 +80,17 @@ struct TimedEventQueue {
     event_id postEventToBack(const sp<Event> &event);
 
     // It is an error to post an event with a negative delay.
-    event_id postEventWithDelay(const sp<Event> &event, int64_t delay_us);
+    // The event may fire up to slack_us late, which lets the queue handle
+    // it together with a later event instead of waking up just for it.
+    event_id postEventWithDelay(
+            const sp<Event> &event, int64_t delay_us, int64_t slack_us = 0);
 
     // If the event is to be posted at a time that has already passed,
-    // it will fire as soon as possible.
-    event_id postTimedEvent(const sp<Event> &event, int64_t realtime_us);
+    // it will fire as soon as possible. Posting an event that is still
+    // pending moves it to the new time.
+    event_id postTimedEvent(
+            const sp<Event> &event, int64_t realtime_us,
+            int64_t slack_us = 0);
 
     // Returns true iff event is currently in the queue and has been
     // successfully cancelled. In this case the event will have been
@@ -88,7 +99,8 @@ struct TimedEventQueue {
 
     // Cancel any pending event that satisfies the predicate.
     // If stopAfterFirstMatch is true, only cancels the first event
-    // satisfying the predicate (if any).
+    // satisfying the predicate (if any), events are not visited in
+    // any particular order.
     void cancelEvents(
             bool (*predicate)(void *cookie, const sp<Event> &event),
             void *cookie,
@@ -100,6 +112,11 @@ private:
     struct QueueItem {
         sp<Event> event;
         int64_t realtime_us;
+        int64_t slack_us;
+
+        // Events posted for the same time fire in the order they were
+        // posted.
+        uint64_t seq;
     };
 
     struct StopEvent : public TimedEventQueue::Event {
@@ -109,7 +126,14 @@ private:
     };
 
     pthread_t mThread;
-    List<QueueItem> mQueue;
+
+    // A binary min-heap ordered by time, and the pending events by id.
+    Vector<QueueItem> mQueue;
+    KeyedVector<event_id, Event *> mEventsByID;
+    uint64_t mNextSeq;
+    size_t mNumSlackEvents;
+    int64_t mWakeupTimeUs;
+
     Mutex mLock;
     Condition mQueueNotEmptyCondition;
     Condition mQueueHeadChangedCondition;
@@ -121,7 +145,13 @@ private:
     static void *ThreadWrapper(void *me);
     void threadEntry();
 
-    sp<Event> removeEventFromQueue_l(event_id id);
+    sp<Event> removeQueueItem_l(size_t index);
+    int64_t getWakeupTimeUs_l() const;
+
+    static bool ItemBefore(const QueueItem &a, const QueueItem &b);
+    void moveItem_l(size_t from, size_t to);
+    void siftUp_l(size_t index);
+    void siftDown_l(size_t index);
 
     TimedEventQueue(const TimedEventQueue &);
     TimedEventQueue &operator=(const TimedEventQueue &);
@@ -43,6 +43,10 @@ struct AnotherPacketSource : public MediaSource {
 
     bool hasBufferAvailable(status_t *finalResult);
 
+    // Returns the number of queued buffers, finalResult is set to the
+    // error signalled by signalEOS, or OK.
+    size_t getAvailableBufferCount(status_t *finalResult);
+
     status_t nextBufferTime(int64_t *timeUs);
 
     void queueAccessUnit(const sp<ABuffer> &buffer);
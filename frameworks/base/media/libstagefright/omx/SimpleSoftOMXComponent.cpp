@@ -23,6 +23,9 @@
 #include <media/stagefright/foundation/ADebug.h>
 #include <media/stagefright/foundation/ALooper.h>
 #include <media/stagefright/foundation/AMessage.h>
+#include <media/stagefright/HardwareAPI.h>
+#include <ui/GraphicBufferMapper.h>
+#include <ui/Rect.h>
 
 namespace android {
 
@@ -93,6 +96,12 @@ bool SimpleSoftOMXComponent::isSetParameterAllowed(
             break;
         }
 
+        case kIndexUseAndroidNativeBuffer:
+        {
+            portIndex = ((UseAndroidNativeBufferParams *)params)->nPortIndex;
+            break;
+        }
+
         default:
             return false;
     }
@@ -136,6 +145,29 @@ OMX_ERRORTYPE SimpleSoftOMXComponent::internalGetParameter(
 
             memcpy(defParams, &port->mDef, sizeof(port->mDef));
 
+            if (port->mUseNativeBuffers) {
+                // The color format of a port using native buffers is an
+                // Android pixel format.
+                defParams->format.video.eColorFormat =
+                    (OMX_COLOR_FORMATTYPE)HAL_PIXEL_FORMAT_YV12;
+            }
+
+            return OMX_ErrorNone;
+        }
+
+        case kIndexGetAndroidNativeBufferUsage:
+        {
+            GetAndroidNativeBufferUsageParams *usageParams =
+                (GetAndroidNativeBufferUsageParams *)params;
+
+            if (usageParams->nPortIndex >= mPorts.size()
+                    || !mPorts.itemAt(
+                            usageParams->nPortIndex).mSupportsNativeBuffers) {
+                return OMX_ErrorUndefined;
+            }
+
+            usageParams->nUsage = GRALLOC_USAGE_SW_WRITE_OFTEN;
+
             return OMX_ErrorNone;
         }
 
@@ -177,11 +209,90 @@ OMX_ERRORTYPE SimpleSoftOMXComponent::internalSetParameter(
             return OMX_ErrorNone;
         }
 
+        case kIndexEnableAndroidNativeBuffers:
+        {
+            EnableAndroidNativeBuffersParams *enableParams =
+                (EnableAndroidNativeBuffersParams *)params;
+
+            if (enableParams->nPortIndex >= mPorts.size()) {
+                return OMX_ErrorUndefined;
+            }
+
+            PortInfo *port = &mPorts.editItemAt(enableParams->nPortIndex);
+
+            if (!port->mSupportsNativeBuffers) {
+                return OMX_ErrorUnsupportedSetting;
+            }
+
+            port->mUseNativeBuffers = (enableParams->enable == OMX_TRUE);
+
+            return OMX_ErrorNone;
+        }
+
+        case kIndexUseAndroidNativeBuffer:
+        {
+            UseAndroidNativeBufferParams *useParams =
+                (UseAndroidNativeBufferParams *)params;
+
+            if (useParams->nPortIndex >= mPorts.size()
+                    || !mPorts.itemAt(
+                            useParams->nPortIndex).mUseNativeBuffers) {
+                return OMX_ErrorUndefined;
+            }
+
+            const sp<ANativeWindowBuffer> &nativeBuffer =
+                useParams->nativeBuffer;
+
+            BufferInfo *buffer = addBuffer_l(
+                    useParams->bufferHeader,
+                    useParams->nPortIndex,
+                    useParams->pAppPrivate,
+                    mPorts.itemAt(useParams->nPortIndex).mDef.nBufferSize,
+                    (OMX_U8 *)nativeBuffer->handle);
+
+            buffer->mNativeBuffer = nativeBuffer;
+
+            return OMX_ErrorNone;
+        }
+
         default:
             return OMX_ErrorUnsupportedIndex;
     }
 }
 
+OMX_ERRORTYPE SimpleSoftOMXComponent::getExtensionIndex(
+        const char *name, OMX_INDEXTYPE *index) {
+    Mutex::Autolock autoLock(mLock);
+
+    bool supportsNativeBuffers = false;
+    for (size_t i = 0; i < mPorts.size(); ++i) {
+        if (mPorts.itemAt(i).mSupportsNativeBuffers) {
+            supportsNativeBuffers = true;
+            break;
+        }
+    }
+
+    if (!supportsNativeBuffers) {
+        return OMX_ErrorUndefined;
+    }
+
+    if (!strcmp(name, "OMX.google.android.index.enableAndroidNativeBuffers")) {
+        *index = (OMX_INDEXTYPE)kIndexEnableAndroidNativeBuffers;
+    } else if (!strcmp(name,
+                "OMX.google.android.index.getAndroidNativeBufferUsage")) {
+        *index = (OMX_INDEXTYPE)kIndexGetAndroidNativeBufferUsage;
+    } else if (!strcmp(name,
+                "OMX.google.android.index.useAndroidNativeBuffer")) {
+        // The first version of the extension is the one that hands us the
+        // ANativeWindowBuffer, whose stride we need to lay out the frames.
+        *index = (OMX_INDEXTYPE)kIndexUseAndroidNativeBuffer;
+    } else {
+        return OMX_ErrorUndefined;
+    }
+
+    return OMX_ErrorNone;
+}
+
 OMX_ERRORTYPE SimpleSoftOMXComponent::useBuffer(
         OMX_BUFFERHEADERTYPE **header,
         OMX_U32 portIndex,
@@ -189,6 +300,18 @@ OMX_ERRORTYPE SimpleSoftOMXComponent::useBuffer(
         OMX_U32 size,
         OMX_U8 *ptr) {
     Mutex::Autolock autoLock(mLock);
+
+    addBuffer_l(header, portIndex, appPrivate, size, ptr);
+
+    return OMX_ErrorNone;
+}
+
+SimpleSoftOMXComponent::BufferInfo *SimpleSoftOMXComponent::addBuffer_l(
+        OMX_BUFFERHEADERTYPE **header,
+        OMX_U32 portIndex,
+        OMX_PTR appPrivate,
+        OMX_U32 size,
+        OMX_U8 *ptr) {
     CHECK_LT(portIndex, mPorts.size());
 
     *header = new OMX_BUFFERHEADERTYPE;
@@ -226,13 +349,14 @@ OMX_ERRORTYPE SimpleSoftOMXComponent::useBuffer(
 
     buffer->mHeader = *header;
     buffer->mOwnedByUs = false;
+    buffer->mNativeBuffer.clear();
 
     if (port->mBuffers.size() == port->mDef.nBufferCountActual) {
         port->mDef.bPopulated = OMX_TRUE;
         checkTransitions();
     }
 
-    return OMX_ErrorNone;
+    return buffer;
 }
 
 OMX_ERRORTYPE SimpleSoftOMXComponent::allocateBuffer(
@@ -617,6 +741,8 @@ void SimpleSoftOMXComponent::addPort(const OMX_PARAM_PORTDEFINITIONTYPE &def) {
     PortInfo *info = &mPorts.editItemAt(mPorts.size() - 1);
     info->mDef = def;
     info->mTransition = PortInfo::NONE;
+    info->mSupportsNativeBuffers = false;
+    info->mUseNativeBuffers = false;
 }
 
 void SimpleSoftOMXComponent::onQueueFilled(OMX_U32 portIndex) {
@@ -641,4 +767,68 @@ SimpleSoftOMXComponent::PortInfo *SimpleSoftOMXComponent::editPortInfo(
     return &mPorts.editItemAt(portIndex);
 }
 
+static size_t align(size_t x, size_t alignment) {
+    // alignment must be a power of 2.
+    return (x + alignment - 1) & ~(alignment - 1);
+}
+
+static void copyPlane(
+        uint8_t *dst, size_t dstStride,
+        const uint8_t *src, size_t srcStride,
+        size_t width, size_t height) {
+    for (size_t i = 0; i < height; ++i) {
+        memcpy(dst, src, width);
+
+        dst += dstStride;
+        src += srcStride;
+    }
+}
+
+OMX_ERRORTYPE SimpleSoftOMXComponent::writeYUV420Planar(
+        BufferInfo *info, size_t width, size_t height,
+        const uint8_t *y, size_t yStride,
+        const uint8_t *u, const uint8_t *v, size_t uvStride) {
+    OMX_BUFFERHEADERTYPE *header = info->mHeader;
+
+    header->nFilledLen = (width * height * 3) / 2;
+
+    if (info->mNativeBuffer == NULL) {
+        uint8_t *dstY = header->pBuffer + header->nOffset;
+        uint8_t *dstU = dstY + width * height;
+        uint8_t *dstV = dstU + (width / 2) * (height / 2);
+
+        copyPlane(dstY, width, y, yStride, width, height);
+        copyPlane(dstU, width / 2, u, uvStride, width / 2, height / 2);
+        copyPlane(dstV, width / 2, v, uvStride, width / 2, height / 2);
+
+        return OMX_ErrorNone;
+    }
+
+    // Native buffers are YV12: the Cr plane comes before the Cb plane and
+    // the chroma rows are aligned to 16 bytes.
+    const sp<ANativeWindowBuffer> &buf = info->mNativeBuffer;
+
+    GraphicBufferMapper &mapper = GraphicBufferMapper::get();
+
+    void *dst;
+    if (mapper.lock(buf->handle, GRALLOC_USAGE_SW_WRITE_OFTEN,
+                Rect(width, height), &dst) != 0) {
+        LOGE("unable to lock native buffer %p", buf->handle);
+        return OMX_ErrorUndefined;
+    }
+
+    size_t dstCStride = align(buf->stride / 2, 16);
+    uint8_t *dstY = (uint8_t *)dst;
+    uint8_t *dstV = dstY + buf->stride * buf->height;
+    uint8_t *dstU = dstV + dstCStride * buf->height / 2;
+
+    copyPlane(dstY, buf->stride, y, yStride, width, height);
+    copyPlane(dstU, dstCStride, u, uvStride, width / 2, height / 2);
+    copyPlane(dstV, dstCStride, v, uvStride, width / 2, height / 2);
+
+    CHECK_EQ(mapper.unlock(buf->handle), (status_t)OK);
+
+    return OMX_ErrorNone;
+}
+
 }  // namespace android
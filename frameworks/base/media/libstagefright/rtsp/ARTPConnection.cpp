@@ -30,12 +30,22 @@
 #include <media/stagefright/foundation/hexdump.h>
 
 #include <arpa/inet.h>
+#include <errno.h>
+#include <sys/epoll.h>
 #include <sys/socket.h>
+#include <unistd.h>
 
 namespace android {
 
 static const size_t kMaxUDPSize = 1500;
 
+// At most this many datagrams are read from a socket per poll, so that a
+// busy stream doesn't starve the others or the receiver reports.
+static const size_t kMaxPacketsPerPoll = 32;
+
+// Size hint, streams come in rtp/rtcp pairs.
+static const int kEpollSizeHint = 8;
+
 static uint16_t u16at(const uint8_t *data) {
     return data[0] << 8 | data[1];
 }
@@ -49,7 +59,7 @@ static uint64_t u64at(const uint8_t *data) {
 }
 
 // static
-const int64_t ARTPConnection::kSelectTimeoutUs = 1000ll;
+const int64_t ARTPConnection::kPollTimeoutUs = 1000ll;
 
 struct ARTPConnection::StreamInfo {
     int mRTPSocket;
@@ -68,11 +78,16 @@ struct ARTPConnection::StreamInfo {
 
 ARTPConnection::ARTPConnection(uint32_t flags)
     : mFlags(flags),
+      mEpollFd(epoll_create(kEpollSizeHint)),
+      mReceiveBuffer(new ABuffer(65536)),
       mPollEventPending(false),
       mLastReceiverReportTimeUs(-1) {
+    CHECK_GE(mEpollFd, 0);
 }
 
 ARTPConnection::~ARTPConnection() {
+    close(mEpollFd);
+    mEpollFd = -1;
 }
 
 void ARTPConnection::addStream(
@@ -204,6 +219,16 @@ void ARTPConnection::onAddStream(const sp<AMessage> &msg) {
     memset(&info->mRemoteRTCPAddr, 0, sizeof(info->mRemoteRTCPAddr));
 
     if (!injected) {
+        int sockets[2] = { info->mRTPSocket, info->mRTCPSocket };
+        for (size_t i = 0; i < 2; ++i) {
+            struct epoll_event event;
+            memset(&event, 0, sizeof(event));
+            event.events = EPOLLIN;
+            event.data.fd = sockets[i];
+
+            CHECK_EQ(epoll_ctl(mEpollFd, EPOLL_CTL_ADD, sockets[i], &event), 0);
+        }
+
         postPollEvent();
     }
 }
@@ -223,6 +248,12 @@ void ARTPConnection::onRemoveStream(const sp<AMessage> &msg) {
         TRESPASS();
     }
 
+    if (!it->mIsInjected) {
+        // The sockets may already be closed, which removed them as well.
+        epoll_ctl(mEpollFd, EPOLL_CTL_DEL, it->mRTPSocket, NULL);
+        epoll_ctl(mEpollFd, EPOLL_CTL_DEL, it->mRTCPSocket, NULL);
+    }
+
     mStreams.erase(it);
 }
 
@@ -244,50 +275,39 @@ void ARTPConnection::onPollStreams() {
         return;
     }
 
-    struct timeval tv;
-    tv.tv_sec = 0;
-    tv.tv_usec = kSelectTimeoutUs;
-
-    fd_set rs;
-    FD_ZERO(&rs);
-
-    int maxSocket = -1;
+    bool polling = false;
     for (List<StreamInfo>::iterator it = mStreams.begin();
          it != mStreams.end(); ++it) {
-        if ((*it).mIsInjected) {
-            continue;
-        }
-
-        FD_SET(it->mRTPSocket, &rs);
-        FD_SET(it->mRTCPSocket, &rs);
-
-        if (it->mRTPSocket > maxSocket) {
-            maxSocket = it->mRTPSocket;
-        }
-        if (it->mRTCPSocket > maxSocket) {
-            maxSocket = it->mRTCPSocket;
+        if (!it->mIsInjected) {
+            polling = true;
+            break;
         }
     }
 
-    if (maxSocket == -1) {
+    if (!polling) {
         return;
     }
 
-    int res = select(maxSocket + 1, &rs, NULL, NULL, &tv);
-    CHECK_GE(res, 0);
+    struct epoll_event events[kEpollSizeHint];
+    int res = epoll_wait(
+            mEpollFd, events, kEpollSizeHint, kPollTimeoutUs / 1000);
+    CHECK(res >= 0 || errno == EINTR);
+
+    for (int i = 0; i < res; ++i) {
+        int fd = events[i].data.fd;
 
-    if (res > 0) {
         for (List<StreamInfo>::iterator it = mStreams.begin();
              it != mStreams.end(); ++it) {
             if ((*it).mIsInjected) {
                 continue;
             }
 
-            if (FD_ISSET(it->mRTPSocket, &rs)) {
-                receive(&*it, true);
-            }
-            if (FD_ISSET(it->mRTCPSocket, &rs)) {
-                receive(&*it, false);
+            if (it->mRTPSocket == fd) {
+                receiveAll(&*it, true);
+                break;
+            } else if (it->mRTCPSocket == fd) {
+                receiveAll(&*it, false);
+                break;
             }
         }
     }
@@ -339,30 +359,39 @@ void ARTPConnection::onPollStreams() {
     }
 }
 
+void ARTPConnection::receiveAll(StreamInfo *s, bool receiveRTP) {
+    for (size_t i = 0; i < kMaxPacketsPerPoll; ++i) {
+        if (receive(s, receiveRTP) == -EAGAIN) {
+            break;
+        }
+    }
+}
+
 status_t ARTPConnection::receive(StreamInfo *s, bool receiveRTP) {
     LOGV("receiving %s", receiveRTP ? "RTP" : "RTCP");
 
     CHECK(!s->mIsInjected);
 
-    sp<ABuffer> buffer = new ABuffer(65536);
-
     socklen_t remoteAddrLen =
         (!receiveRTP && s->mNumRTCPPacketsReceived == 0)
             ? sizeof(s->mRemoteRTCPAddr) : 0;
 
     ssize_t nbytes = recvfrom(
             receiveRTP ? s->mRTPSocket : s->mRTCPSocket,
-            buffer->data(),
-            buffer->capacity(),
-            0,
+            mReceiveBuffer->data(),
+            mReceiveBuffer->capacity(),
+            MSG_DONTWAIT,
             remoteAddrLen > 0 ? (struct sockaddr *)&s->mRemoteRTCPAddr : NULL,
             remoteAddrLen > 0 ? &remoteAddrLen : NULL);
 
     if (nbytes < 0) {
-        return -1;
+        return (errno == EAGAIN || errno == EWOULDBLOCK) ? -EAGAIN : -1;
     }
 
-    buffer->setRange(0, nbytes);
+    // The buffer outlives this call in the source's queue or an assembled
+    // access unit, only take what the datagram needs.
+    sp<ABuffer> buffer = new ABuffer(nbytes);
+    memcpy(buffer->data(), mReceiveBuffer->data(), nbytes);
 
     // LOGI("received %d bytes.", buffer->size());
 
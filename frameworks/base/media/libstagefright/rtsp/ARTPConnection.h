@@ -62,10 +62,16 @@ private:
         kWhatInjectPacket,
     };
 
-    static const int64_t kSelectTimeoutUs;
+    static const int64_t kPollTimeoutUs;
 
     uint32_t mFlags;
 
+    int mEpollFd;
+
+    // Every datagram is received here first, then copied into a buffer
+    // of its own size.
+    sp<ABuffer> mReceiveBuffer;
+
     struct StreamInfo;
     List<StreamInfo> mStreams;
 
@@ -79,6 +85,7 @@ private:
     void onSendReceiverReports();
 
     status_t receive(StreamInfo *info, bool receiveRTP);
+    void receiveAll(StreamInfo *info, bool receiveRTP);
 
     status_t parseRTP(StreamInfo *info, const sp<ABuffer> &buffer);
     status_t parseRTCP(StreamInfo *info, const sp<ABuffer> &buffer);
@@ -36,6 +36,10 @@ namespace android {
 
 static const uint32_t kSourceID = 0xdeadbeef;
 
+// A missing packet is waited for 3 times the jitter, within these bounds.
+static const int64_t kMinPacketLossTimeoutUs = 10000ll;
+static const int64_t kMaxPacketLossTimeoutUs = 150000ll;
+
 ARTPSource::ARTPSource(
         uint32_t id,
         const sp<ASessionDescription> &sessionDesc, size_t index,
@@ -43,6 +47,13 @@ ARTPSource::ARTPSource(
     : mID(id),
       mHighestSeqNumber(0),
       mNumBuffersReceived(0),
+      mClockRate(0),
+      mBaseSeqNumber(0),
+      mExpectedPrior(0),
+      mReceivedPrior(0),
+      mHaveTransit(false),
+      mLastTransit(0),
+      mJitter(0.0),
       mLastNTPTime(0),
       mLastNTPTimeUpdateUs(0),
       mIssueFIRRequests(false),
@@ -54,6 +65,10 @@ ARTPSource::ARTPSource(
     AString params;
     sessionDesc->getFormatType(index, &PT, &desc, &params);
 
+    int32_t numChannels;
+    ASessionDescription::ParseFormatDesc(
+            desc.c_str(), &mClockRate, &numChannels);
+
     if (!strncmp(desc.c_str(), "H264/", 5)) {
         mAssembler = new AAVCAssembler(notify);
         mIssueFIRRequests = true;
@@ -83,6 +98,8 @@ static uint32_t AbsDiff(uint32_t seq1, uint32_t seq2) {
 }
 
 void ARTPSource::processRTPPacket(const sp<ABuffer> &buffer) {
+    updateJitter(buffer, ALooper::GetNowUs());
+
     if (queuePacket(buffer) && mAssembler != NULL) {
         mAssembler->onPacketReceived(this);
     }
@@ -104,6 +121,7 @@ bool ARTPSource::queuePacket(const sp<ABuffer> &buffer) {
 
     if (mNumBuffersReceived++ == 0) {
         mHighestSeqNumber = seqNum;
+        mBaseSeqNumber = seqNum;
         mQueue.push_back(buffer);
         return true;
     }
@@ -156,6 +174,55 @@ bool ARTPSource::queuePacket(const sp<ABuffer> &buffer) {
     return true;
 }
 
+void ARTPSource::updateJitter(
+        const sp<ABuffer> &buffer, int64_t arrivalTimeUs) {
+    if (mClockRate <= 0) {
+        return;
+    }
+
+    uint32_t rtpTime;
+    CHECK(buffer->meta()->findInt32("rtp-time", (int32_t *)&rtpTime));
+
+    // The difference of the arrival time and the rtp time, both in
+    // units of the rtp clock, only its variations matter.
+    uint64_t t = (uint64_t)arrivalTimeUs;
+    uint32_t arrival = (uint32_t)((t / 1000000) * mClockRate
+            + ((t % 1000000) * mClockRate) / 1000000);
+    int32_t transit = (int32_t)(arrival - rtpTime);
+
+    if (mHaveTransit) {
+        int32_t d = transit - mLastTransit;
+        if (d < 0) {
+            d = -d;
+        }
+
+        mJitter += (d - mJitter) / 16.0;
+    }
+
+    mLastTransit = transit;
+    mHaveTransit = true;
+}
+
+int64_t ARTPSource::jitterUs() const {
+    if (mClockRate <= 0) {
+        return 0;
+    }
+
+    return (int64_t)(mJitter * 1E6 / mClockRate);
+}
+
+int64_t ARTPSource::packetLossTimeoutUs() const {
+    int64_t timeoutUs = 3 * jitterUs();
+
+    if (timeoutUs < kMinPacketLossTimeoutUs) {
+        return kMinPacketLossTimeoutUs;
+    } else if (timeoutUs > kMaxPacketLossTimeoutUs) {
+        return kMaxPacketLossTimeoutUs;
+    }
+
+    return timeoutUs;
+}
+
 void ARTPSource::byeReceived() {
     mAssembler->onByeReceived();
 }
@@ -232,21 +299,52 @@ void ARTPSource::addReceiverReport(const sp<ABuffer> &buffer) {
     data[10] = (mID >> 8) & 0xff;
     data[11] = mID & 0xff;
 
-    data[12] = 0x00;  // fraction lost
+    uint8_t fractionLost = 0;
+    int32_t cumulativeLost = 0;
+    if (mNumBuffersReceived > 0) {
+        uint32_t expected = mHighestSeqNumber - mBaseSeqNumber + 1;
+
+        int64_t lost = (int64_t)expected - mNumBuffersReceived;
+        if (lost > 0x7fffff) {
+            lost = 0x7fffff;
+        } else if (lost < -0x800000) {
+            lost = -0x800000;
+        }
+        cumulativeLost = (int32_t)lost;
+
+        uint32_t expectedInterval = expected - mExpectedPrior;
+        int32_t receivedInterval = mNumBuffersReceived - mReceivedPrior;
+        int64_t lostInterval = (int64_t)expectedInterval - receivedInterval;
+
+        if (expectedInterval > 0 && lostInterval > 0) {
+            fractionLost = (uint8_t)((lostInterval << 8) / expectedInterval);
+        }
+
+        mExpectedPrior = expected;
+        mReceivedPrior = mNumBuffersReceived;
 
-    data[13] = 0x00;  // cumulative lost
-    data[14] = 0x00;
-    data[15] = 0x00;
+        LOGV("ssrc 0x%08x: %d packets lost (fraction %u/256), "
+             "jitter %lld us",
+             mID, cumulativeLost, fractionLost, jitterUs());
+    }
+
+    data[12] = fractionLost;
+
+    data[13] = (cumulativeLost >> 16) & 0xff;
+    data[14] = (cumulativeLost >> 8) & 0xff;
+    data[15] = cumulativeLost & 0xff;
 
     data[16] = mHighestSeqNumber >> 24;
     data[17] = (mHighestSeqNumber >> 16) & 0xff;
     data[18] = (mHighestSeqNumber >> 8) & 0xff;
     data[19] = mHighestSeqNumber & 0xff;
 
-    data[20] = 0x00;  // Interarrival jitter
-    data[21] = 0x00;
-    data[22] = 0x00;
-    data[23] = 0x00;
+    uint32_t jitter = (uint32_t)mJitter;
+
+    data[20] = jitter >> 24;  // Interarrival jitter
+    data[21] = (jitter >> 16) & 0xff;
+    data[22] = (jitter >> 8) & 0xff;
+    data[23] = jitter & 0xff;
 
     uint32_t LSR = 0;
     uint32_t DLSR = 0;
@@ -46,11 +46,27 @@ struct ARTPSource : public RefBase {
     void addReceiverReport(const sp<ABuffer> &buffer);
     void addFIR(const sp<ABuffer> &buffer);
 
+    // Interarrival jitter as defined by RFC 3550.
+    int64_t jitterUs() const;
+
+    // How long the assembler waits for a missing packet before giving
+    // up on it, grows with the jitter of the stream.
+    int64_t packetLossTimeoutUs() const;
+
 private:
     uint32_t mID;
     uint32_t mHighestSeqNumber;
     int32_t mNumBuffersReceived;
 
+    // Receiver statistics, RFC 3550 appendix A.3 and A.8.
+    int32_t mClockRate;
+    uint32_t mBaseSeqNumber;
+    uint32_t mExpectedPrior;
+    int32_t mReceivedPrior;
+    bool mHaveTransit;
+    int32_t mLastTransit;
+    double mJitter;
+
     List<sp<ABuffer> > mQueue;
     sp<ARTPAssembler> mAssembler;
 
@@ -64,6 +80,7 @@ private:
     sp<AMessage> mNotify;
 
     bool queuePacket(const sp<ABuffer> &buffer);
+    void updateJitter(const sp<ABuffer> &buffer, int64_t arrivalTimeUs);
 
     DISALLOW_EVIL_CONSTRUCTORS(ARTPSource);
 };
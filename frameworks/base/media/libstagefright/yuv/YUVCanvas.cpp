@@ -91,6 +91,12 @@ void YUVCanvas::downsample(
     CHECK((srcOffsetX + (mYUVImage.width() - 1) * skipX) < srcImage.width());
     CHECK((srcOffsetY + (mYUVImage.height() - 1) * skipY) < srcImage.height());
 
+    if (YUVImage::fastDownsample(
+                srcOffsetX, srcOffsetY, skipX, skipY,
+                srcImage, mYUVImage)) {
+        return;
+    }
+
     uint8_t yValue;
     uint8_t uValue;
     uint8_t vValue;
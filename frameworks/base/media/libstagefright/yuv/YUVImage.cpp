@@ -364,6 +364,64 @@ bool YUVImage::fastCopyRectangle(
     return false;
 }
 
+// static
+bool YUVImage::fastDownsample(
+        int32_t srcOffsetX, int32_t srcOffsetY,
+        int32_t skipX, int32_t skipY,
+        const YUVImage &srcImage, YUVImage &destImage) {
+    if (srcImage.mYUVFormat != destImage.mYUVFormat
+            || (destImage.mWidth & 1) || (destImage.mHeight & 1)) {
+        return false;
+    }
+
+    int32_t width = destImage.mWidth;
+    int32_t height = destImage.mHeight;
+
+    // Chroma samples of a row are interleaved in the semi planar format.
+    int32_t uvStep = (srcImage.mYUVFormat == YUV420SemiPlanar) ? 2 : 1;
+
+    uint8_t *ySrcAddr;
+    uint8_t *uSrcAddr;
+    uint8_t *vSrcAddr;
+    uint8_t *yDestAddr;
+    uint8_t *uDestAddr;
+    uint8_t *vDestAddr;
+
+    // Copy Y
+    for (int32_t y = 0; y < height; ++y) {
+        srcImage.getYUVAddresses(srcOffsetX, srcOffsetY + y * skipY,
+                &ySrcAddr, &uSrcAddr, &vSrcAddr);
+        destImage.getYUVAddresses(0, y,
+                &yDestAddr, &uDestAddr, &vDestAddr);
+
+        for (int32_t x = 0; x < width; ++x) {
+            yDestAddr[x] = ySrcAddr[x * skipX];
+        }
+    }
+
+    // Copy U and V. Each destination sample covers a 2x2 block of pixels,
+    // the per pixel copy leaves it with the value of the block's last
+    // pixel, so that is the one sampled here.
+    for (int32_t y = 1; y < height; y += 2) {
+        srcImage.getYUVAddresses(0, srcOffsetY + y * skipY,
+                &ySrcAddr, &uSrcAddr, &vSrcAddr);
+        destImage.getYUVAddresses(0, y,
+                &yDestAddr, &uDestAddr, &vDestAddr);
+
+        int32_t srcX = srcOffsetX + skipX;
+        for (int32_t x = 0; x < width; x += 2) {
+            int32_t srcIndex = (srcX >> 1) * uvStep;
+            *uDestAddr = uSrcAddr[srcIndex];
+            *vDestAddr = vSrcAddr[srcIndex];
+
+            uDestAddr += uvStep;
+            vDestAddr += uvStep;
+            srcX += 2 * skipX;
+        }
+    }
+    return true;
+}
+
 uint8_t clamp(uint8_t v, uint8_t minValue, uint8_t maxValue) {
     CHECK(maxValue >= minValue);
 
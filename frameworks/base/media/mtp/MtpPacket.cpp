@@ -47,6 +47,15 @@ MtpPacket::~MtpPacket() {
 }
 
 void MtpPacket::reset() {
+    // Give back what a large packet (an object property list for a big
+    // folder, say) made us grow to, or every following reset would clear it.
+    if (mBufferSize > mAllocationIncrement) {
+        uint8_t* buffer = (uint8_t *)realloc(mBuffer, mAllocationIncrement);
+        if (buffer) {
+            mBuffer = buffer;
+            mBufferSize = mAllocationIncrement;
+        }
+    }
     allocate(MTP_CONTAINER_HEADER_SIZE);
     mPacketSize = MTP_CONTAINER_HEADER_SIZE;
     memset(mBuffer, 0, mBufferSize);
@@ -55,6 +64,10 @@ void MtpPacket::reset() {
 void MtpPacket::allocate(int length) {
     if (length > mBufferSize) {
         int newLength = length + mAllocationIncrement;
+        // grow geometrically, so that a packet built one field at a time
+        // isn't copied over and over
+        if (newLength < mBufferSize * 2)
+            newLength = mBufferSize * 2;
         mBuffer = (uint8_t *)realloc(mBuffer, newLength);
         if (!mBuffer) {
             LOGE("out of memory!");
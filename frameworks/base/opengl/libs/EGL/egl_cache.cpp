@@ -0,0 +1,340 @@
+/*
+ ** Copyright 2011, The Android Open Source Project
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **     http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <utils/Log.h>
+#include <utils/threads.h>
+
+#include "egl_cache.h"
+#include "egl_display.h"
+#include "egl_impl.h"
+#include "egldefs.h"
+
+// Cache size limits.
+static const size_t maxKeySize = 1024;
+static const size_t maxValueSize = 64 * 1024;
+static const size_t maxTotalSize = 256 * 1024;
+
+// Cache file header
+static const char* cacheFileMagic = "EGL$";
+static const size_t cacheFileHeaderSize = 8;
+
+// The time in seconds to wait before saving newly inserted cache entries.
+static const unsigned int deferredSaveDelay = 4;
+
+// ----------------------------------------------------------------------------
+namespace android {
+// ----------------------------------------------------------------------------
+
+#define BC_EXT_STR "EGL_ANDROID_blob_cache"
+
+//
+// Callback functions passed to EGL.
+//
+static void setBlob(const void* key, EGLsizeiANDROID keySize,
+        const void* value, EGLsizeiANDROID valueSize) {
+    egl_cache_t::get()->setBlob(key, keySize, value, valueSize);
+}
+
+static EGLsizeiANDROID getBlob(const void* key, EGLsizeiANDROID keySize,
+        void* value, EGLsizeiANDROID valueSize) {
+    return egl_cache_t::get()->getBlob(key, keySize, value, valueSize);
+}
+
+static bool hasExtension(const char* exts, const char* name) {
+    const size_t nameLen = strlen(name);
+    for (const char* p = exts; p && *p; ) {
+        const char* end = strchr(p, ' ');
+        const size_t len = end ? size_t(end - p) : strlen(p);
+        if (len == nameLen && !strncmp(p, name, len)) {
+            return true;
+        }
+        p = end ? end + 1 : NULL;
+    }
+    return false;
+}
+
+// Standard CRC-32 (the one used by zlib), used to detect files that were
+// only partially written.
+static uint32_t crc32(const uint8_t* buf, size_t len) {
+    uint32_t r = 0xFFFFFFFF;
+    for (size_t i = 0; i < len; i++) {
+        r ^= buf[i];
+        for (int j = 0; j < 8; j++) {
+            r = (r >> 1) ^ (0xEDB88320 & -(r & 1));
+        }
+    }
+    return ~r;
+}
+
+//
+// egl_cache_t definition
+//
+
+class egl_cache_t::DelayedSaveThread : public Thread {
+public:
+    DelayedSaveThread() : Thread(false) { }
+
+private:
+    virtual bool threadLoop() {
+        sleep(deferredSaveDelay);
+
+        egl_cache_t* c = egl_cache_t::get();
+        Mutex::Autolock lock(c->mMutex);
+        if (c->mInitialized) {
+            c->saveBlobCacheLocked();
+        }
+        c->mSavePending = false;
+        return false;
+    }
+};
+
+egl_cache_t egl_cache_t::sCache;
+
+egl_cache_t::egl_cache_t() :
+        mInitialized(false),
+        mSavePending(false),
+        mDirty(false) {
+}
+
+egl_cache_t::~egl_cache_t() {
+}
+
+egl_cache_t* egl_cache_t::get() {
+    return &sCache;
+}
+
+void egl_cache_t::initialize(egl_display_t *display) {
+    Mutex::Autolock lock(mMutex);
+    for (int i = 0; i < IMPL_NUM_IMPLEMENTATIONS; i++) {
+        egl_connection_t* const cnx = &gEGLImpl[i];
+        if (cnx->dso && cnx->major >= 0 && cnx->minor >= 0) {
+            const char* exts = display->disp[i].queryString.extensions;
+            if (hasExtension(exts, BC_EXT_STR)) {
+                PFNEGLSETBLOBCACHEFUNCSANDROIDPROC eglSetBlobCacheFuncsANDROID =
+                        reinterpret_cast<PFNEGLSETBLOBCACHEFUNCSANDROIDPROC>(
+                                cnx->egl.eglGetProcAddress("eglSetBlobCacheFuncsANDROID"));
+                if (eglSetBlobCacheFuncsANDROID == NULL) {
+                    LOGE("EGL_ANDROID_blob_cache advertised by display %d, "
+                            "but unable to get eglSetBlobCacheFuncsANDROID", i);
+                    continue;
+                }
+
+                eglSetBlobCacheFuncsANDROID(display->disp[i].dpy, android::setBlob,
+                        android::getBlob);
+                EGLint err = cnx->egl.eglGetError();
+                if (err != EGL_SUCCESS) {
+                    LOGE("eglSetBlobCacheFuncsANDROID resulted in an error: "
+                            "%#x", err);
+                }
+            }
+        }
+    }
+    mInitialized = true;
+}
+
+void egl_cache_t::terminate() {
+    Mutex::Autolock lock(mMutex);
+    saveBlobCacheLocked();
+    mBlobCache = NULL;
+    mInitialized = false;
+}
+
+void egl_cache_t::setBlob(const void* key, EGLsizeiANDROID keySize,
+        const void* value, EGLsizeiANDROID valueSize) {
+    Mutex::Autolock lock(mMutex);
+
+    if (keySize < 0 || valueSize < 0) {
+        LOGW("EGL_ANDROID_blob_cache set: negative sizes are not allowed");
+        return;
+    }
+
+    if (mInitialized) {
+        sp<BlobCache> bc = getBlobCacheLocked();
+        bc->set(key, keySize, value, valueSize);
+        mDirty = true;
+        scheduleSaveLocked();
+    }
+}
+
+EGLsizeiANDROID egl_cache_t::getBlob(const void* key, EGLsizeiANDROID keySize,
+        void* value, EGLsizeiANDROID valueSize) {
+    Mutex::Autolock lock(mMutex);
+
+    if (keySize < 0 || valueSize < 0) {
+        LOGW("EGL_ANDROID_blob_cache get: negative sizes are not allowed");
+        return 0;
+    }
+
+    if (mInitialized) {
+        sp<BlobCache> bc = getBlobCacheLocked();
+        return bc->get(key, keySize, value, valueSize);
+    }
+    return 0;
+}
+
+void egl_cache_t::setCacheFilename(const char* filename) {
+    Mutex::Autolock lock(mMutex);
+    mFilename = filename;
+}
+
+sp<BlobCache> egl_cache_t::getBlobCacheLocked() {
+    if (mBlobCache == NULL) {
+        mBlobCache = new BlobCache(maxKeySize, maxValueSize, maxTotalSize);
+        loadBlobCacheLocked();
+    }
+    return mBlobCache;
+}
+
+void egl_cache_t::scheduleSaveLocked() {
+    if (!mSavePending && mFilename.length() > 0) {
+        sp<Thread> saveThread(new DelayedSaveThread());
+        if (saveThread->run("EGL cache saver", PRIORITY_BACKGROUND) == NO_ERROR) {
+            mSavePending = true;
+        }
+    }
+}
+
+void egl_cache_t::saveBlobCacheLocked() {
+    if (!mDirty || mFilename.length() == 0 || mBlobCache == NULL) {
+        return;
+    }
+
+    // The contents are written to a temporary file that then replaces the
+    // old one, so a crash never leaves a truncated cache behind.
+    String8 tmpFilename(mFilename);
+    tmpFilename.append(".tmp");
+
+    size_t cacheSize = mBlobCache->getFlattenedSize();
+    size_t fileSize = cacheSize + cacheFileHeaderSize;
+
+    int fd = open(tmpFilename.string(), O_CREAT | O_TRUNC | O_RDWR,
+            S_IRUSR | S_IWUSR);
+    if (fd == -1) {
+        LOGE("error creating cache file %s: %s (%d)", tmpFilename.string(),
+                strerror(errno), errno);
+        return;
+    }
+
+    if (ftruncate(fd, fileSize) == -1) {
+        LOGE("error sizing cache file %s to %d bytes: %s (%d)",
+                tmpFilename.string(), fileSize, strerror(errno), errno);
+        close(fd);
+        unlink(tmpFilename.string());
+        return;
+    }
+
+    uint8_t* buf = reinterpret_cast<uint8_t*>(mmap(NULL, fileSize,
+            PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0));
+    if (buf == MAP_FAILED) {
+        LOGE("error mmaping cache file %s: %s (%d)", tmpFilename.string(),
+                strerror(errno), errno);
+        close(fd);
+        unlink(tmpFilename.string());
+        return;
+    }
+
+    status_t err = mBlobCache->flatten(buf + cacheFileHeaderSize, cacheSize, NULL, 0);
+    if (err == OK) {
+        memcpy(buf, cacheFileMagic, 4);
+        uint32_t* crc = reinterpret_cast<uint32_t*>(buf + 4);
+        *crc = crc32(buf + cacheFileHeaderSize, cacheSize);
+    } else {
+        LOGE("error writing cache contents: %s (%d)", strerror(-err), -err);
+    }
+    munmap(buf, fileSize);
+    close(fd);
+
+    if (err != OK || rename(tmpFilename.string(), mFilename.string()) == -1) {
+        if (err == OK) {
+            LOGE("error renaming cache file %s: %s (%d)", tmpFilename.string(),
+                    strerror(errno), errno);
+        }
+        unlink(tmpFilename.string());
+        return;
+    }
+    mDirty = false;
+}
+
+void egl_cache_t::loadBlobCacheLocked() {
+    if (mFilename.length() == 0) {
+        return;
+    }
+
+    int fd = open(mFilename.string(), O_RDONLY, 0);
+    if (fd == -1) {
+        if (errno != ENOENT) {
+            LOGE("error opening cache file %s: %s (%d)", mFilename.string(),
+                    strerror(errno), errno);
+        }
+        return;
+    }
+
+    struct stat statBuf;
+    if (fstat(fd, &statBuf) == -1) {
+        LOGE("error stat'ing cache file: %s (%d)", strerror(errno), errno);
+        close(fd);
+        return;
+    }
+
+    // Sanity check the size before trying to mmap it.
+    size_t fileSize = statBuf.st_size;
+    if (fileSize < cacheFileHeaderSize || fileSize > maxTotalSize * 2) {
+        LOGE("cache file has an unexpected size: %d bytes", fileSize);
+        close(fd);
+        return;
+    }
+
+    uint8_t* buf = reinterpret_cast<uint8_t*>(mmap(NULL, fileSize,
+            PROT_READ, MAP_PRIVATE, fd, 0));
+    if (buf == MAP_FAILED) {
+        LOGE("error mmaping cache file: %s (%d)", strerror(errno), errno);
+        close(fd);
+        return;
+    }
+
+    // Check the file magic and CRC
+    size_t cacheSize = fileSize - cacheFileHeaderSize;
+    if (memcmp(buf, cacheFileMagic, 4) != 0) {
+        LOGE("cache file has bad mojo");
+    } else if (crc32(buf + cacheFileHeaderSize, cacheSize) !=
+            *reinterpret_cast<const uint32_t*>(buf + 4)) {
+        LOGE("cache file failed CRC check");
+    } else {
+        status_t err = mBlobCache->unflatten(buf + cacheFileHeaderSize, cacheSize,
+                NULL, 0);
+        if (err != OK) {
+            LOGE("error reading cache contents: %s (%d)", strerror(-err), -err);
+        }
+    }
+
+    munmap(buf, fileSize);
+    close(fd);
+}
+
+// ----------------------------------------------------------------------------
+}; // namespace android
+// ----------------------------------------------------------------------------
+
+extern "C" EGLAPI void egl_set_cache_filename(const char* filename) {
+    android::egl_cache_t::get()->setCacheFilename(filename);
+}
@@ -14,6 +14,7 @@
  ** limitations under the License.
  */
 
+#include "egl_cache.h"
 #include "egl_display.h"
 #include "egl_object.h"
 #include "egl_tls.h"
@@ -208,6 +209,8 @@ EGLBoolean egl_display_t::initialize(EGLint *major, EGLint *minor) {
         // sort our configurations so we can do binary-searches
         qsort(configs, numTotalConfigs, sizeof(egl_config_t), cmp_configs);
 
+        egl_cache_t::get()->initialize(this);
+
         refs++;
         if (major != NULL)
             *major = VERSION_MAJOR;
@@ -264,6 +267,8 @@ EGLBoolean egl_display_t::terminate() {
     // this marks all object handles are "terminated"
     objects.clear();
 
+    egl_cache_t::get()->terminate();
+
     refs--;
     numTotalConfigs = 0;
     delete[] configs;
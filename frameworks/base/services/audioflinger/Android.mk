@@ -6,7 +6,7 @@ LOCAL_SRC_FILES:=               \
     AudioFlinger.cpp            \
     AudioMixer.cpp.arm          \
     AudioResampler.cpp.arm      \
-    AudioResamplerSinc.cpp.arm  \
+    AudioResamplerPolyphase.cpp.arm \
     AudioResamplerCubic.cpp.arm \
     AudioPolicyService.cpp
 
@@ -30,4 +30,8 @@ LOCAL_STATIC_LIBRARIES := \
 
 LOCAL_MODULE:= libaudioflinger
 
+ifeq ($(ARCH_ARM_HAVE_NEON),true)
+    LOCAL_CFLAGS += -D__ARM_HAVE_NEON
+endif
+
 include $(BUILD_SHARED_LIBRARY)
@@ -21,6 +21,8 @@
 
 #include <math.h>
 #include <signal.h>
+#include <sched.h>
+#include <errno.h>
 #include <sys/time.h>
 #include <sys/resource.h>
 
@@ -54,7 +56,7 @@
 #include <audio_effects/effect_ns.h>
 #include <audio_effects/effect_aec.h>
 
-#include <cpustats/ThreadCpuUsage.h>
+#include <cpustats/ThreadCpuUsageLogger.h>
 #include <powermanager/PowerManager.h>
 // #define DEBUG_CPU_USAGE 10  // log statistics every n wall clock seconds
 
@@ -78,6 +80,9 @@ static const int8_t kMaxTrackStartupRetries = 50;
 // direct outputs can be a scarce resource in audio hardware and should
 // be released as quickly as possible.
 static const int8_t kMaxTrackRetriesDirect = 2;
+// compressed data read from a file can arrive late but the hardware holds
+// seconds of it: do not stop the track at the first underrun
+static const int8_t kMaxTrackRetriesOffload = 20;
 
 static const int kDumpLockRetries = 50;
 static const int kDumpLockSleep = 20000;
@@ -89,6 +94,17 @@ static const int kRecordThreadSleepUs = 5000;
 
 static const nsecs_t kSetParametersTimeout = seconds(2);
 
+// the mixer period is divided by 2 until it is at most kFastMixerPeriodMs
+// while fast tracks are active, but not below kMinFastFrameCount frames
+static const uint32_t kFastMixerPeriodMs = 5;
+static const size_t kMinFastFrameCount = 64;
+// a fast track buffer holds kFastTrackBufferCount fast mixer periods
+static const size_t kFastTrackBufferCount = 2;
+// number of fast tracks per mixer thread
+static const size_t kMaxFastTracks = 4;
+// SCHED_FIFO priority of a mixer thread in fast mode
+static const int kFastMixerPriority = 2;
+
 // ----------------------------------------------------------------------------
 
 static bool recordingAllowed() {
@@ -444,7 +460,7 @@ sp<IAudioTrack> AudioFlinger::createTrack(
         LOGV("createTrack() lSessionId: %d", lSessionId);
 
         track = thread->createTrack_l(client, streamType, sampleRate, format,
-                channelMask, frameCount, sharedBuffer, lSessionId, &lStatus);
+                channelMask, frameCount, sharedBuffer, lSessionId, flags >> 16, &lStatus);
 
         // move effect chain to this output thread if an effect on same session was waiting
         // for a track to be created
@@ -1364,8 +1380,8 @@ AudioFlinger::PlaybackThread::PlaybackThread(const sp<AudioFlinger>& audioFlinge
                                              int id,
                                              uint32_t device)
     :   ThreadBase(audioFlinger, id, device),
-        mMixBuffer(0), mSuspended(0), mBytesWritten(0), mOutput(output),
-        mLastWriteTime(0), mNumWrites(0), mNumDelayedWrites(0), mInWrite(false)
+        mMixBuffer(0), mSuspended(0), mBytesWritten(0), mFastFrameCount(0), mFastTrackCount(0),
+        mOutput(output), mLastWriteTime(0), mNumWrites(0), mNumDelayedWrites(0), mInWrite(false)
 {
     snprintf(mName, kNameLength, "AudioOut_%d", id);
 
@@ -1402,7 +1418,7 @@ status_t AudioFlinger::PlaybackThread::dumpTracks(int fd, const Vector<String16>
 
     snprintf(buffer, SIZE, "Output thread %p tracks\n", this);
     result.append(buffer);
-    result.append("   Name  Clien Typ Fmt Chn mask   Session Buf  S M F SRate LeftV RighV  Serv       User       Main buf   Aux Buf\n");
+    result.append("   Name  Clien Typ Fmt Chn mask   Session Buf  S M F SRate LeftV RighV  Serv       User       Main buf   Aux Buf    Unrun\n");
     for (size_t i = 0; i < mTracks.size(); ++i) {
         sp<Track> track = mTracks[i];
         if (track != 0) {
@@ -1413,7 +1429,7 @@ status_t AudioFlinger::PlaybackThread::dumpTracks(int fd, const Vector<String16>
 
     snprintf(buffer, SIZE, "Output thread %p active tracks\n", this);
     result.append(buffer);
-    result.append("   Name  Clien Typ Fmt Chn mask   Session Buf  S M F SRate LeftV RighV  Serv       User       Main buf   Aux Buf\n");
+    result.append("   Name  Clien Typ Fmt Chn mask   Session Buf  S M F SRate LeftV RighV  Serv       User       Main buf   Aux Buf    Unrun\n");
     for (size_t i = 0; i < mActiveTracks.size(); ++i) {
         wp<Track> wTrack = mActiveTracks[i];
         if (wTrack != 0) {
@@ -1482,10 +1498,12 @@ sp<AudioFlinger::PlaybackThread::Track>  AudioFlinger::PlaybackThread::createTra
         int frameCount,
         const sp<IMemory>& sharedBuffer,
         int sessionId,
+        uint32_t flags,
         status_t *status)
 {
     sp<Track> track;
     status_t lStatus;
+    bool fast = false;
 
     if (mType == DIRECT) {
         if ((format & AUDIO_FORMAT_MAIN_MASK) == AUDIO_FORMAT_PCM) {
@@ -1504,6 +1522,17 @@ sp<AudioFlinger::PlaybackThread::Track>  AudioFlinger::PlaybackThread::createTra
             lStatus = BAD_VALUE;
             goto Exit;
         }
+        // tracks of more than 2 channels are mixed without resampling to the same
+        // channels of a multichannel mixer
+        if (popcount(channelMask) > 2 &&
+                (mType != MIXER || (channelMask & ~mChannelMask) != 0 ||
+                 sampleRate != mSampleRate)) {
+            LOGE("createTrack_l() Bad parameter: channelMask 0x%08x sampleRate %d "
+                    "for output %p with channelMask 0x%08x", channelMask, sampleRate,
+                    mOutput, mChannelMask);
+            lStatus = BAD_VALUE;
+            goto Exit;
+        }
     }
 
     lStatus = initCheck();
@@ -1531,12 +1560,39 @@ sp<AudioFlinger::PlaybackThread::Track>  AudioFlinger::PlaybackThread::createTra
             }
         }
 
+        // a fast track is mixed without resampling nor effects. If it cannot be
+        // granted, a normal track is created instead and sized for the normal
+        // mixer period as the client did not do it.
+        if ((flags & AUDIO_POLICY_OUTPUT_FLAG_FAST) && sharedBuffer == 0) {
+            if (mType == MIXER && mFastFrameCount != 0 && mFastTrackCount < kMaxFastTracks &&
+                    sampleRate == mSampleRate && format == AUDIO_FORMAT_PCM_16_BIT &&
+                    mEffectChains.isEmpty() && getEffectChain_l(sessionId) == 0) {
+                fast = true;
+                if (frameCount < (int)(kFastTrackBufferCount * mFastFrameCount)) {
+                    frameCount = kFastTrackBufferCount * mFastFrameCount;
+                }
+            } else {
+                LOGV("createTrack_l() fast track denied on thread %p", this);
+                uint32_t minBufCount = mOutput->stream->get_latency(mOutput->stream) /
+                        ((1000 * mFrameCount) / mSampleRate);
+                if (minBufCount < 2) minBufCount = 2;
+                int minFrameCount = (mFrameCount * sampleRate * minBufCount) / mSampleRate;
+                if (frameCount < minFrameCount) {
+                    frameCount = minFrameCount;
+                }
+            }
+        }
+
         track = new Track(this, client, streamType, sampleRate, format,
                 channelMask, frameCount, sharedBuffer, sessionId);
         if (track->getCblk() == NULL || track->name() < 0) {
             lStatus = NO_MEMORY;
             goto Exit;
         }
+        if (fast) {
+            track->mIsFast = true;
+            mFastTrackCount++;
+        }
         mTracks.add(track);
 
         sp<EffectChain> chain = getEffectChain_l(sessionId);
@@ -1662,6 +1718,9 @@ void AudioFlinger::PlaybackThread::removeTrack_l(const sp<Track>& track)
 {
     mTracks.remove(track);
     deleteTrackName_l(track->name());
+    if (track->isFast()) {
+        mFastTrackCount--;
+    }
     sp<EffectChain> chain = getEffectChain_l(track->sessionId());
     if (chain != 0) {
         chain->decTrackCnt();
@@ -1720,11 +1779,12 @@ void AudioFlinger::PlaybackThread::readOutputParameters()
     mFrameSize = (uint16_t)audio_stream_frame_size(&mOutput->stream->common);
     mFrameCount = mOutput->stream->common.get_buffer_size(&mOutput->stream->common) / mFrameSize;
 
-    // FIXME - Current mixer implementation only supports stereo output: Always
-    // Allocate a stereo buffer even if HW output is mono.
+    // The mixer outputs stereo or more channels: always allocate a stereo buffer
+    // even if HW output is mono.
+    size_t mixChannelCount = mChannelCount > 2 ? mChannelCount : 2;
     if (mMixBuffer != NULL) delete[] mMixBuffer;
-    mMixBuffer = new int16_t[mFrameCount * 2];
-    memset(mMixBuffer, 0, mFrameCount * 2 * sizeof(int16_t));
+    mMixBuffer = new int16_t[mFrameCount * mixChannelCount];
+    memset(mMixBuffer, 0, mFrameCount * mixChannelCount * sizeof(int16_t));
 
     // force reconfiguration of effect chains and engines to take new buffer size and audio
     // parameters into account
@@ -1817,12 +1877,18 @@ audio_stream_t* AudioFlinger::PlaybackThread::stream()
 
 AudioFlinger::MixerThread::MixerThread(const sp<AudioFlinger>& audioFlinger, AudioStreamOut* output, int id, uint32_t device)
     :   PlaybackThread(audioFlinger, output, id, device),
-        mAudioMixer(0)
+        mAudioMixer(0), mFastMode(false), mActiveFastTracks(0), mFloatMix(false)
 {
     mType = ThreadBase::MIXER;
-    mAudioMixer = new AudioMixer(mFrameCount, mSampleRate);
+    char value[PROPERTY_VALUE_MAX];
+    if (property_get("ro.audio.float_mix", value, "0") &&
+            (!strcmp(value, "1") || !strcasecmp(value, "true"))) {
+        mFloatMix = true;
+    }
+    mAudioMixer = new AudioMixer(mFrameCount, mSampleRate, mChannelMask, mFloatMix);
+    updateFastFrameCount();
 
-    // FIXME - Current mixer implementation only supports stereo output
+    // FIXME - Current mixer implementation does not support mono output
     if (mChannelCount == 1) {
         LOGE("Invalid audio hardware channel count");
     }
@@ -1851,8 +1917,7 @@ bool AudioFlinger::MixerThread::threadLoop()
     uint32_t sleepTime = idleSleepTime;
     Vector< sp<EffectChain> > effectChains;
 #ifdef DEBUG_CPU_USAGE
-    ThreadCpuUsage cpu;
-    const CentralTendencyStatistics& stats = cpu.statistics();
+    ThreadCpuUsageLogger cpu("MixerThread", DEBUG_CPU_USAGE);
 #endif
 
     acquireWakeLock();
@@ -1860,31 +1925,7 @@ bool AudioFlinger::MixerThread::threadLoop()
     while (!exitPending())
     {
 #ifdef DEBUG_CPU_USAGE
-        cpu.sampleAndEnable();
-        unsigned n = stats.n();
-        // cpu.elapsed() is expensive, so don't call it every loop
-        if ((n & 127) == 1) {
-            long long elapsed = cpu.elapsed();
-            if (elapsed >= DEBUG_CPU_USAGE * 1000000000LL) {
-                double perLoop = elapsed / (double) n;
-                double perLoop100 = perLoop * 0.01;
-                double mean = stats.mean();
-                double stddev = stats.stddev();
-                double minimum = stats.minimum();
-                double maximum = stats.maximum();
-                cpu.resetStatistics();
-                LOGI("CPU usage over past %.1f secs (%u mixer loops at %.1f mean ms per loop):\n  us per mix loop: mean=%.0f stddev=%.0f min=%.0f max=%.0f\n  %% of wall: mean=%.1f stddev=%.1f min=%.1f max=%.1f",
-                        elapsed * .000000001, n, perLoop * .000001,
-                        mean * .001,
-                        stddev * .001,
-                        minimum * .001,
-                        maximum * .001,
-                        mean / perLoop100,
-                        stddev / perLoop100,
-                        minimum / perLoop100,
-                        maximum / perLoop100);
-            }
-        }
+        cpu.sample();
 #endif
         processConfigEvents();
 
@@ -1894,12 +1935,12 @@ bool AudioFlinger::MixerThread::threadLoop()
             Mutex::Autolock _l(mLock);
 
             if (checkForNewParameters_l()) {
-                mixBufferSize = mFrameCount * mFrameSize;
+                mixBufferSize = mixFrameCount() * mFrameSize;
                 // FIXME: Relaxed timing because of a certain device that can't meet latency
                 // Should be reduced to 2x after the vendor fixes the driver issue
                 // increase threshold again due to low power audio mode. The way this warning
                 // threshold is calculated and its usefulness should be reconsidered anyway.
-                maxPeriod = seconds(mFrameCount) / mSampleRate * 15;
+                maxPeriod = seconds(mixFrameCount()) / mSampleRate * 15;
                 activeSleepTime = activeSleepTimeUs();
                 idleSleepTime = idleSleepTimeUs();
             }
@@ -1946,6 +1987,16 @@ bool AudioFlinger::MixerThread::threadLoop()
 
             mixerStatus = prepareTracks_l(activeTracks, &tracksToRemove);
 
+            // mix and write shorter buffers while fast tracks play
+            bool fast = mActiveFastTracks != 0 && mEffectChains.isEmpty();
+            if (fast != mFastMode) {
+                setFastMode_l(fast);
+                mixBufferSize = mixFrameCount() * mFrameSize;
+                maxPeriod = seconds(mixFrameCount()) / mSampleRate * 15;
+                activeSleepTime = activeSleepTimeUs();
+                idleSleepTime = idleSleepTimeUs();
+            }
+
             // prevent any changes in effect chain list and in each effect chain
             // during mixing and effect process as the audio buffers could be deleted
             // or modified if an effect is created or deleted
@@ -2043,6 +2094,7 @@ uint32_t AudioFlinger::MixerThread::prepareTracks_l(const SortedVector< wp<Track
     size_t count = activeTracks.size();
     size_t mixedTracks = 0;
     size_t tracksWithEffect = 0;
+    size_t fastTracks = 0;
 
     float masterVolume = mMasterVolume;
     bool  masterMute = mMasterMute;
@@ -2066,10 +2118,35 @@ uint32_t AudioFlinger::MixerThread::prepareTracks_l(const SortedVector< wp<Track
         Track* const track = t.get();
         audio_track_cblk_t* cblk = track->cblk();
 
+        // fast tracks are counted even before their buffer is filled: it
+        // is too small for the normal mixer period
+        if (track->isFast()) {
+            if (cblk->sampleRate != mSampleRate) {
+                // the client changed the playback rate, it must use a normal track
+                android_atomic_or(CBLK_INVALID_ON, &cblk->flags);
+            } else {
+                fastTracks++;
+            }
+        }
+
+        // a streaming track that started playing underruns when it does not provide
+        // the frames needed for this mix
+        uint32_t framesReady = cblk->framesReady();
+        if (track->mFillingUpStatus == Track::FS_ACTIVE && track->mSharedBuffer == 0 &&
+                track->mState == TrackBase::ACTIVE) {
+            uint32_t minFrames = mixFrameCount();
+            if (cblk->sampleRate != mSampleRate) {
+                minFrames = (uint32_t)(((uint64_t)minFrames * cblk->sampleRate) / mSampleRate);
+            }
+            if (framesReady < minFrames) {
+                track->mUnderrunCount++;
+            }
+        }
+
         // The first time a track is added we wait
         // for all its buffers to be filled before processing it
         mAudioMixer->setActiveTrack(track->name());
-        if (cblk->framesReady() && track->isReady() &&
+        if (framesReady && track->isReady() &&
                 !track->isPaused() && !track->isTerminated())
         {
             //LOGV("track %d u=%08x, s=%08x [OK] on thread %p", track->name(), cblk->user, cblk->server, this);
@@ -2163,6 +2240,14 @@ uint32_t AudioFlinger::MixerThread::prepareTracks_l(const SortedVector< wp<Track
             mAudioMixer->setParameter(
                 AudioMixer::TRACK,
                 AudioMixer::CHANNEL_MASK, (void *)track->channelMask());
+            // music is worth the polyphase resampler, most of it is 44.1KHz;
+            // the quality must be set before the sample rate
+            int quality = track->type() == AUDIO_STREAM_MUSIC ?
+                    AudioResampler::HIGH_QUALITY : AudioResampler::DEFAULT;
+            mAudioMixer->setParameter(
+                AudioMixer::RESAMPLE,
+                AudioMixer::QUALITY,
+                (void *)quality);
             mAudioMixer->setParameter(
                 AudioMixer::RESAMPLE,
                 AudioMixer::SAMPLE_RATE,
@@ -2228,6 +2313,8 @@ uint32_t AudioFlinger::MixerThread::prepareTracks_l(const SortedVector< wp<Track
         memset(mMixBuffer, 0, mFrameCount * mChannelCount * sizeof(int16_t));
     }
 
+    mActiveFastTracks = fastTracks;
+
     return mixerStatus;
 }
 
@@ -2242,7 +2329,7 @@ void AudioFlinger::MixerThread::invalidateTracks(int streamType)
         sp<Track> t = mTracks[i];
         if (t->type() == streamType) {
             android_atomic_or(CBLK_INVALID_ON, &t->mCblk->flags);
-            t->mCblk->cv.signal();
+            t->mCblk->signalStep();
         }
     }
 }
@@ -2291,8 +2378,13 @@ bool AudioFlinger::MixerThread::checkForNewParameters_l()
             }
         }
         if (param.getInt(String8(AudioParameter::keyChannels), value) == NO_ERROR) {
-            if (value != AUDIO_CHANNEL_OUT_STEREO) {
+            if (!AudioMixer::isValidBusChannelMask(value)) {
                 status = BAD_VALUE;
+            } else if (value != (int)mChannelMask &&
+                    (!mTracks.isEmpty() || !mEffectChains.isEmpty())) {
+                // tracks of the current channels may not fit in the new bus and
+                // effects are processed in stereo
+                status = INVALID_OPERATION;
             } else {
                 reconfig = true;
             }
@@ -2348,9 +2440,11 @@ bool AudioFlinger::MixerThread::checkForNewParameters_l()
                                                        keyValuePair.string());
             }
             if (status == NO_ERROR && reconfig) {
+                setFastMode_l(false);
                 delete mAudioMixer;
                 readOutputParameters();
-                mAudioMixer = new AudioMixer(mFrameCount, mSampleRate);
+                updateFastFrameCount();
+                mAudioMixer = new AudioMixer(mFrameCount, mSampleRate, mChannelMask, mFloatMix);
                 for (size_t i = 0; i < mTracks.size() ; i++) {
                     int name = getTrackName_l();
                     if (name < 0) break;
@@ -2385,23 +2479,68 @@ status_t AudioFlinger::MixerThread::dumpInternals(int fd, const Vector<String16>
 
     snprintf(buffer, SIZE, "AudioMixer tracks: %08x\n", mAudioMixer->trackNames());
     result.append(buffer);
+    snprintf(buffer, SIZE, "Mix bus: %s, channel mask %08x\n",
+            mAudioMixer->isFloatBus() ? "float" : "int32", mAudioMixer->channelMask());
+    result.append(buffer);
+    snprintf(buffer, SIZE, "Fast mixer period: %d frames, fast mode: %s, active fast tracks: %d\n",
+            mFastFrameCount, mFastMode ? "on" : "off", mActiveFastTracks);
+    result.append(buffer);
     write(fd, result.string(), result.size());
     return NO_ERROR;
 }
 
 uint32_t AudioFlinger::MixerThread::activeSleepTimeUs()
 {
+    if (mFastMode) {
+        return (uint32_t)((mFastFrameCount * 1000000LL) / mSampleRate) / 2;
+    }
     return (uint32_t)(mOutput->stream->get_latency(mOutput->stream) * 1000) / 2;
 }
 
 uint32_t AudioFlinger::MixerThread::idleSleepTimeUs()
 {
-    return (uint32_t)(((mFrameCount * 1000) / mSampleRate) * 1000) / 2;
+    return (uint32_t)((mixFrameCount() * 1000000LL) / mSampleRate) / 2;
 }
 
 uint32_t AudioFlinger::MixerThread::suspendSleepTimeUs()
 {
-    return (uint32_t)(((mFrameCount * 1000) / mSampleRate) * 1000);
+    return (uint32_t)((mixFrameCount() * 1000000LL) / mSampleRate);
+}
+
+// updateFastFrameCount() must be called after readOutputParameters()
+void AudioFlinger::MixerThread::updateFastFrameCount()
+{
+    size_t frameCount = mFrameCount;
+    while (frameCount * 1000 > kFastMixerPeriodMs * mSampleRate &&
+            (frameCount & 1) == 0 && frameCount / 2 >= kMinFastFrameCount) {
+        frameCount /= 2;
+    }
+    mFastFrameCount = frameCount;
+}
+
+// setFastMode_l() must be called with ThreadBase::mLock held, by the mixer thread
+void AudioFlinger::MixerThread::setFastMode_l(bool fast)
+{
+    if (fast == mFastMode) {
+        return;
+    }
+    mFastMode = fast;
+    mAudioMixer->setFrameCount(mixFrameCount());
+    LOGV("MixerThread %p fast mode %s, period %d frames", this, fast ? "on" : "off",
+            mixFrameCount());
+
+    // a short period only works if the thread is not preempted by normal threads
+    struct sched_param param;
+    if (fast) {
+        param.sched_priority = kFastMixerPriority;
+        if (sched_setscheduler(0, SCHED_FIFO, &param) != 0) {
+            LOGW("MixerThread %p could not use SCHED_FIFO: %s", this, strerror(errno));
+        }
+    } else {
+        param.sched_priority = 0;
+        sched_setscheduler(0, SCHED_OTHER, &param);
+        androidSetThreadPriority(gettid(), ANDROID_PRIORITY_URGENT_AUDIO);
+    }
 }
 
 // ----------------------------------------------------------------------------
@@ -2520,12 +2659,15 @@ bool AudioFlinger::DirectOutputThread::threadLoop()
     nsecs_t standbyTime = systemTime();
     int8_t *curBuf;
     size_t mixBufferSize = mFrameCount*mFrameSize;
+    size_t writeSize = mixBufferSize;
     uint32_t activeSleepTime = activeSleepTimeUs();
     uint32_t idleSleepTime = idleSleepTimeUs();
     uint32_t sleepTime = idleSleepTime;
     // use shorter standby delay as on normal output to release
     // hardware resources as soon as possible
     nsecs_t standbyDelay = microseconds(activeSleepTime*2);
+    // compressed audio is decoded by the audio hardware (offload)
+    bool offload = !audio_is_linear_pcm(mFormat);
 
     acquireWakeLock();
 
@@ -2549,6 +2691,7 @@ bool AudioFlinger::DirectOutputThread::threadLoop()
                 activeSleepTime = activeSleepTimeUs();
                 idleSleepTime = idleSleepTimeUs();
                 standbyDelay = microseconds(activeSleepTime*2);
+                offload = !audio_is_linear_pcm(mFormat);
             }
 
             // put audio hardware into standby after short delay
@@ -2677,7 +2820,7 @@ bool AudioFlinger::DirectOutputThread::threadLoop()
                     }
 
                     // reset retry count
-                    track->mRetryCount = kMaxTrackRetriesDirect;
+                    track->mRetryCount = offload ? kMaxTrackRetriesOffload : kMaxTrackRetriesDirect;
                     activeTrack = t;
                     mixerStatus = MIXER_TRACKS_READY;
                 } else {
@@ -2722,12 +2865,18 @@ bool AudioFlinger::DirectOutputThread::threadLoop()
             AudioBufferProvider::Buffer buffer;
             size_t frameCount = mFrameCount;
             curBuf = (int8_t *)mMixBuffer;
+            writeSize = mixBufferSize;
             // output audio to hardware
             while (frameCount) {
                 buffer.frameCount = frameCount;
                 activeTrack->getNextBuffer(&buffer);
                 if (UNLIKELY(buffer.raw == 0)) {
-                    memset(curBuf, 0, frameCount * mFrameSize);
+                    if (offload) {
+                        // silence cannot be inserted in a compressed stream
+                        writeSize -= frameCount * mFrameSize;
+                    } else {
+                        memset(curBuf, 0, frameCount * mFrameSize);
+                    }
                     break;
                 }
                 memcpy(curBuf, buffer.raw, buffer.frameCount * mFrameSize);
@@ -2746,6 +2895,7 @@ bool AudioFlinger::DirectOutputThread::threadLoop()
                 }
             } else if (mBytesWritten != 0 && audio_is_linear_pcm(mFormat)) {
                 memset (mMixBuffer, 0, mFrameCount * mFrameSize);
+                writeSize = mixBufferSize;
                 sleepTime = 0;
             }
         }
@@ -2763,14 +2913,22 @@ bool AudioFlinger::DirectOutputThread::threadLoop()
             }
             unlockEffectChains(effectChains);
 
+            // the write of compressed data blocks until the hardware has room for it, which
+            // can take seconds: let the application processor sleep meanwhile
+            if (offload) {
+                releaseWakeLock();
+            }
             mLastWriteTime = systemTime();
             mInWrite = true;
-            mBytesWritten += mixBufferSize;
-            int bytesWritten = (int)mOutput->stream->write(mOutput->stream, mMixBuffer, mixBufferSize);
-            if (bytesWritten < 0) mBytesWritten -= mixBufferSize;
+            mBytesWritten += writeSize;
+            int bytesWritten = (int)mOutput->stream->write(mOutput->stream, mMixBuffer, writeSize);
+            if (bytesWritten < 0) mBytesWritten -= writeSize;
             mNumWrites++;
             mInWrite = false;
             mStandby = false;
+            if (offload) {
+                acquireWakeLock();
+            }
         } else {
             unlockEffectChains(effectChains);
             usleep(sleepTime);
@@ -3303,7 +3461,7 @@ AudioFlinger::PlaybackThread::Track::Track(
             int sessionId)
     :   TrackBase(thread, client, sampleRate, format, channelMask, frameCount, 0, sharedBuffer, sessionId),
     mMute(false), mSharedBuffer(sharedBuffer), mName(-1), mMainBuffer(NULL), mAuxBuffer(NULL),
-    mAuxEffectId(0), mHasVolumeController(false)
+    mAuxEffectId(0), mHasVolumeController(false), mIsFast(false), mUnderrunCount(0)
 {
     if (mCblk != NULL) {
         sp<ThreadBase> baseThread = thread.promote();
@@ -3369,7 +3527,7 @@ void AudioFlinger::PlaybackThread::Track::destroy()
 
 void AudioFlinger::PlaybackThread::Track::dump(char* buffer, size_t size)
 {
-    snprintf(buffer, size, "   %05d %05d %03u %03u 0x%08x %05u   %04u %1d %1d %1d %05u %05u %05u  0x%08x 0x%08x 0x%08x 0x%08x\n",
+    snprintf(buffer, size, "   %05d %05d %03u %03u 0x%08x %05u   %04u %1d %1d %1d %05u %05u %05u  0x%08x 0x%08x 0x%08x 0x%08x %05u\n",
             mName - AudioMixer::TRACK0,
             (mClient == NULL) ? getpid() : mClient->pid(),
             mStreamType,
@@ -3386,7 +3544,8 @@ void AudioFlinger::PlaybackThread::Track::dump(char* buffer, size_t size)
             mCblk->server,
             mCblk->user,
             (int)mMainBuffer,
-            (int)mAuxBuffer);
+            (int)mAuxBuffer,
+            mUnderrunCount);
 }
 
 status_t AudioFlinger::PlaybackThread::Track::getNextBuffer(AudioBufferProvider::Buffer* buffer)
@@ -3899,6 +4058,7 @@ status_t AudioFlinger::PlaybackThread::OutputTrack::obtainBuffer(AudioBufferProv
     buffer->frameCount  = 0;
 
     uint32_t framesAvail = cblk->framesAvailable();
+    int32_t step;
 
 
     if (framesAvail == 0) {
@@ -3910,12 +4070,13 @@ status_t AudioFlinger::PlaybackThread::OutputTrack::obtainBuffer(AudioBufferProv
                 LOGV("Not active and NO_MORE_BUFFERS");
                 return AudioTrack::NO_MORE_BUFFERS;
             }
-            result = cblk->cv.waitRelative(cblk->lock, milliseconds(waitTimeMs));
+            result = cblk->waitForStep_l(step, waitTimeMs);
             if (result != NO_ERROR) {
                 return AudioTrack::NO_MORE_BUFFERS;
             }
             // read the server count again
         start_loop_here:
+            step = android_atomic_acquire_load(&cblk->steps);
             framesAvail = cblk->framesAvailable_l();
         }
     }
@@ -3959,7 +4120,8 @@ void AudioFlinger::PlaybackThread::OutputTrack::clearBufferQueue()
 AudioFlinger::Client::Client(const sp<AudioFlinger>& audioFlinger, pid_t pid)
     :   RefBase(),
         mAudioFlinger(audioFlinger),
-        mMemoryDealer(new MemoryDealer(1024*1024, "AudioFlinger::Client")),
+        mMemoryDealer(new MemoryDealer(1024*1024, "AudioFlinger::Client",
+                MemoryDealer::SLAB_ALLOCATION)),
         mPid(pid)
 {
     // 1 MB of address space is good for 32 tracks, 8 buffers each, 4 KB/buffer
@@ -4352,11 +4514,12 @@ bool AudioFlinger::RecordThread::threadLoop()
                     // are 32 bit aligned which should be always true.
                     if (mChannelCount == 2 && mReqChannelCount == 1) {
                         AudioMixer::ditherAndClamp(mRsmpOutBuffer, mRsmpOutBuffer, framesOut);
-                        // the resampler always outputs stereo samples: do post stereo to mono conversion
+                        // the resampler always outputs stereo samples, both channels
+                        // hold the input already downmixed by getNextBuffer()
                         int16_t *src = (int16_t *)mRsmpOutBuffer;
                         int16_t *dst = buffer.i16;
                         while (framesOut--) {
-                            *dst++ = (int16_t)(((int32_t)*src + (int32_t)*(src + 1)) >> 1);
+                            *dst++ = *src;
                             src += 2;
                         }
                     } else {
@@ -4585,13 +4748,23 @@ status_t AudioFlinger::RecordThread::getNextBuffer(AudioBufferProvider::Buffer*
         }
         mRsmpInIndex = 0;
         framesReady = mFrameCount;
+
+        if (mChannelCount == 2 && mReqChannelCount == 1) {
+            // downmix in place, the resampler then only has one channel to process
+            int16_t *src = mRsmpInBuffer;
+            int16_t *dst = mRsmpInBuffer;
+            for (size_t i = 0; i < mFrameCount; i++) {
+                *dst++ = (int16_t)(((int32_t)*src + (int32_t)*(src + 1)) >> 1);
+                src += 2;
+            }
+        }
     }
 
     if (framesReq > framesReady) {
         framesReq = framesReady;
     }
 
-    if (mChannelCount == 1 && mReqChannelCount == 2) {
+    if (mChannelCount != mReqChannelCount) {
         channelCount = 1;
     } else {
         channelCount = 2;
@@ -4739,8 +4912,8 @@ void AudioFlinger::RecordThread::audioConfigChanged_l(int event, int param) {
 
 void AudioFlinger::RecordThread::readInputParameters()
 {
-    if (mRsmpInBuffer) delete mRsmpInBuffer;
-    if (mRsmpOutBuffer) delete mRsmpOutBuffer;
+    if (mRsmpInBuffer) delete[] mRsmpInBuffer;
+    if (mRsmpOutBuffer) delete[] mRsmpOutBuffer;
     if (mResampler) delete mResampler;
     mResampler = 0;
 
@@ -4758,7 +4931,9 @@ void AudioFlinger::RecordThread::readInputParameters()
         int channelCount;
          // optmization: if mono to mono, use the resampler in stereo to stereo mode to avoid
          // stereo to mono post process as the resampler always outputs stereo.
-        if (mChannelCount == 1 && mReqChannelCount == 2) {
+         // optimization: if stereo to mono, getNextBuffer() downmixes the input so that
+         // only one channel is resampled.
+        if (mReqChannelCount == 1 ? mChannelCount == 2 : mChannelCount == 1) {
             channelCount = 1;
         } else {
             channelCount = 2;
@@ -4882,9 +5057,10 @@ int AudioFlinger::openOutput(uint32_t *pDevices,
         AudioStreamOut *output = new AudioStreamOut(outHwDev, outStream);
         int id = nextUniqueId();
 
+        // the mixer outputs stereo and, with its float bus, more channels
         if ((flags & AUDIO_POLICY_OUTPUT_FLAG_DIRECT) ||
             (format != AUDIO_FORMAT_PCM_16_BIT) ||
-            (channels != AUDIO_CHANNEL_OUT_STEREO)) {
+            !AudioMixer::isValidBusChannelMask(channels)) {
             thread = new DirectOutputThread(this, output, id, *pDevices);
             LOGV("openOutput() created direct output: ID %d thread %p", id, thread);
         } else {
@@ -5643,6 +5819,13 @@ sp<AudioFlinger::EffectHandle> AudioFlinger::ThreadBase::createEffect_l(
         lStatus = BAD_VALUE;
         goto Exit;
     }
+    // Effects are processed in mono or stereo
+    if (mType != RECORD && mChannelCount > 2) {
+        LOGW("createEffect_l() Cannot add effect %s on output with %d channels",
+                desc->name, mChannelCount);
+        lStatus = BAD_VALUE;
+        goto Exit;
+    }
     // Only Pre processor effects are allowed on input threads and only on input threads
     if ((mType == RECORD &&
             (desc->flags & EFFECT_FLAG_TYPE_MASK) != EFFECT_FLAG_TYPE_PRE_PROC) ||
@@ -5914,6 +6097,19 @@ status_t AudioFlinger::PlaybackThread::addEffectChain_l(const sp<EffectChain>& c
     mEffectChains.insertAt(chain, i);
     checkSuspendOnAddEffectChain_l(chain);
 
+    // effects are not applied in fast mode: the clients of the fast tracks
+    // recreate them as normal tracks
+    if (mFastTrackCount != 0) {
+        for (size_t i = 0; i < mTracks.size(); ++i) {
+            sp<Track> track = mTracks[i];
+            if (track->isFast()) {
+                LOGV("addEffectChain_l() invalidating fast track %p", track.get());
+                android_atomic_or(CBLK_INVALID_ON, &track->mCblk->flags);
+                track->mCblk->signalStep();
+            }
+        }
+    }
+
     return NO_ERROR;
 }
 
@@ -5965,6 +6161,9 @@ status_t AudioFlinger::PlaybackThread::attachAuxEffect_l(
 
     if (EffectId == 0) {
         track->setAuxBuffer(0, NULL);
+    } else if (track->isFast()) {
+        // fast tracks are not mixed into effects
+        status = INVALID_OPERATION;
     } else {
         // Auxiliary effects are always in audio session AUDIO_SESSION_OUTPUT_MIX
         sp<EffectModule> effect = getEffect_l(AUDIO_SESSION_OUTPUT_MIX, EffectId);
@@ -6034,7 +6233,8 @@ AudioFlinger::EffectModule::EffectModule(const wp<ThreadBase>& wThread,
                                         int id,
                                         int sessionId)
     : mThread(wThread), mChain(chain), mId(id), mSessionId(sessionId), mEffectInterface(NULL),
-      mStatus(NO_INIT), mState(IDLE), mSuspended(false)
+      mStatus(NO_INIT), mState(IDLE), mSuspended(false),
+      mProcessTime(0), mMaxProcessTime(0), mProcessCount(0)
 {
     LOGV("Constructor %p", this);
     int lStatus;
@@ -6237,9 +6437,16 @@ void AudioFlinger::EffectModule::process()
         }
 
         // do the actual processing in the effect engine
+        nsecs_t start = systemTime();
         int ret = (*mEffectInterface)->process(mEffectInterface,
                                                &mConfig.inputCfg.buffer,
                                                &mConfig.outputCfg.buffer);
+        nsecs_t delta = systemTime() - start;
+        mProcessTime += delta;
+        if (delta > mMaxProcessTime) {
+            mMaxProcessTime = delta;
+        }
+        mProcessCount++;
 
         // force transition to IDLE state when engine is ready
         if (mState == STOPPED && ret == -ENODATA) {
@@ -6258,11 +6465,9 @@ void AudioFlinger::EffectModule::process()
         sp<EffectChain> chain = mChain.promote();
         if (chain != 0 && chain->activeTrackCnt() != 0) {
             size_t frameCnt = mConfig.inputCfg.buffer.frameCount * 2;  //always stereo here
-            int16_t *in = mConfig.inputCfg.buffer.s16;
-            int16_t *out = mConfig.outputCfg.buffer.s16;
-            for (size_t i = 0; i < frameCnt; i++) {
-                out[i] = clamp16((int32_t)out[i] + (int32_t)in[i]);
-            }
+            AudioMixer::accumulate16(mConfig.outputCfg.buffer.s16,
+                                     mConfig.inputCfg.buffer.s16,
+                                     frameCnt);
         }
     }
 }
@@ -6722,6 +6927,21 @@ status_t AudioFlinger::EffectModule::dump(int fd, const Vector<String16>& args)
             mConfig.outputCfg.format);
     result.append(buffer);
 
+    // the load is the share of the buffer period spent in the effect engine
+    result.append("\t\t- Processing:\n");
+    result.append("\t\t\tCalls      Avg (us) Max (us) Load (%)\n");
+    uint32_t avgUs = mProcessCount != 0 ?
+            (uint32_t)(ns2us(mProcessTime) / mProcessCount) : 0;
+    uint32_t periodUs = mConfig.outputCfg.samplingRate != 0 ?
+            (uint32_t)(((int64_t)mConfig.outputCfg.buffer.frameCount * 1000000) /
+                    mConfig.outputCfg.samplingRate) : 0;
+    snprintf(buffer, SIZE, "\t\t\t%010u %08u %08u %.1f\n",
+            mProcessCount,
+            avgUs,
+            (uint32_t)ns2us(mMaxProcessTime),
+            periodUs != 0 ? (avgUs * 100.0f) / periodUs : 0.0f);
+    result.append(buffer);
+
     snprintf(buffer, SIZE, "\t\t%d Clients:\n", mHandles.size());
     result.append(buffer);
     result.append("\t\t\tPid   Priority Ctrl Locked client server\n");
@@ -7019,7 +7239,8 @@ AudioFlinger::EffectChain::EffectChain(const wp<ThreadBase>& wThread,
                                         int sessionId)
     : mThread(wThread), mSessionId(sessionId), mActiveTrackCnt(0), mTrackCnt(0),
       mOwnInBuffer(false), mVolumeCtrlIdx(-1), mLeftVolume(UINT_MAX), mRightVolume(UINT_MAX),
-      mNewLeftVolume(UINT_MAX), mNewRightVolume(UINT_MAX)
+      mNewLeftVolume(UINT_MAX), mNewRightVolume(UINT_MAX),
+      mProcessTime(0), mMaxProcessTime(0), mProcessCount(0)
 {
     mStrategy = AudioSystem::getStrategyForStream(AUDIO_STREAM_MUSIC);
 }
@@ -7105,9 +7326,16 @@ void AudioFlinger::EffectChain::process_l()
     size_t size = mEffects.size();
     // do not process effect if no track is present in same audio session
     if (isGlobalSession || tracksOnSession) {
+        nsecs_t start = systemTime();
         for (size_t i = 0; i < size; i++) {
             mEffects[i]->process();
         }
+        nsecs_t delta = systemTime() - start;
+        mProcessTime += delta;
+        if (delta > mMaxProcessTime) {
+            mMaxProcessTime = delta;
+        }
+        mProcessCount++;
     }
     for (size_t i = 0; i < size; i++) {
         mEffects[i]->updateState();
@@ -7360,6 +7588,15 @@ status_t AudioFlinger::EffectChain::dump(int fd, const Vector<String16>& args)
             (uint32_t)mOutBuffer,
             mActiveTrackCnt);
     result.append(buffer);
+
+    // time spent processing the whole chain, including the effects that only
+    // accumulate their input while idle
+    result.append("\tProcessed  Avg (us) Max (us)\n");
+    snprintf(buffer, SIZE, "\t%010u %08u %08u\n",
+            mProcessCount,
+            mProcessCount != 0 ? (uint32_t)(ns2us(mProcessTime) / mProcessCount) : 0,
+            (uint32_t)ns2us(mMaxProcessTime));
+    result.append(buffer);
     write(fd, result.string(), result.size());
 
     for (size_t i = 0; i < mEffects.size(); ++i) {
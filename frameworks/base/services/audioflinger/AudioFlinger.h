@@ -610,6 +610,7 @@ private:
                     void        setMainBuffer(int16_t *buffer) { mMainBuffer = buffer; }
                     int16_t     *mainBuffer() { return mMainBuffer; }
                     int         auxEffectId() { return mAuxEffectId; }
+                    bool        isFast() const { return mIsFast; }
 
 
         protected:
@@ -653,6 +654,10 @@ private:
             int32_t             *mAuxBuffer;
             int                 mAuxEffectId;
             bool                mHasVolumeController;
+            // fast tracks are mixed with a short period, see MixerThread::setFastMode_l()
+            bool                mIsFast;
+            // number of mixes that lacked frames of this track since it was created
+            uint32_t            mUnderrunCount;
         };  // end of Track
 
 
@@ -728,6 +733,7 @@ private:
                                     int frameCount,
                                     const sp<IMemory>& sharedBuffer,
                                     int sessionId,
+                                    uint32_t flags,
                                     status_t *status);
 
                     AudioStreamOut* getOutput();
@@ -773,6 +779,9 @@ private:
         int                             mBytesWritten;
         bool                            mMasterMute;
         SortedVector< wp<Track> >       mActiveTracks;
+        // mixer period used while fast tracks play, 0 if fast tracks are not supported
+        size_t                          mFastFrameCount;
+        size_t                          mFastTrackCount;
 
         virtual int             getTrackName_l() = 0;
         virtual void            deleteTrackName_l(int name) = 0;
@@ -837,7 +846,18 @@ private:
         virtual     uint32_t    idleSleepTimeUs();
         virtual     uint32_t    suspendSleepTimeUs();
 
+                    void        setFastMode_l(bool fast);
+                    void        updateFastFrameCount();
+                    size_t      mixFrameCount() const {
+                        return mFastMode ? mFastFrameCount : mFrameCount;
+                    }
+
         AudioMixer*                     mAudioMixer;
+        // true while the mixer runs with the fast period
+        bool                            mFastMode;
+        size_t                          mActiveFastTracks;
+        // mix stereo outputs in float as well, multichannel outputs always are
+        bool                            mFloatMix;
     };
 
     class DirectOutputThread : public PlaybackThread {
@@ -1160,6 +1180,9 @@ private:
                                         // sending disable command.
         uint32_t mDisableWaitCnt;       // current process() calls count during disable period.
         bool     mSuspended;            // effect is suspended: temporarily disabled by framework
+        nsecs_t  mProcessTime;          // total time spent in the effect engine process()
+        nsecs_t  mMaxProcessTime;       // longest call to the effect engine process()
+        uint32_t mProcessCount;         // number of calls to the effect engine process()
     };
 
     // The EffectHandle class implements the IEffect interface. It provides resources
@@ -1345,6 +1368,9 @@ private:
         uint32_t mNewLeftVolume;       // new volume on left channel
         uint32_t mNewRightVolume;      // new volume on right channel
         uint32_t mStrategy; // strategy for this effect chain
+        nsecs_t mProcessTime;       // total time spent in process_l()
+        nsecs_t mMaxProcessTime;    // longest call to process_l()
+        uint32_t mProcessCount;     // number of calls to process_l() processing the effects
         // mSuspendedEffects lists all effect currently suspended in the chain
         // use effect type UUID timelow field as key. There is no real risk of identical
         // timeLow fields among effect type UUIDs.
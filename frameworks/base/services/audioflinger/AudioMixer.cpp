@@ -30,6 +30,12 @@
 
 #include <system/audio.h>
 
+#if defined(__ARM_HAVE_NEON)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #include "AudioMixer.h"
 
 namespace android {
@@ -44,14 +50,27 @@ static inline int16_t clamp16(int32_t sample)
 
 // ----------------------------------------------------------------------------
 
-AudioMixer::AudioMixer(size_t frameCount, uint32_t sampleRate)
-    :   mActiveTrack(0), mTrackNames(0), mSampleRate(sampleRate)
+AudioMixer::AudioMixer(size_t frameCount, uint32_t sampleRate, uint32_t channelMask,
+        bool floatBus)
+    :   mActiveTrack(0), mTrackNames(0), mSampleRate(sampleRate),
+        mMaxFrameCount(frameCount)
 {
+    if (!isValidBusChannelMask(channelMask)) {
+        LOGE("invalid mixer channel mask %08x, mixing in stereo", channelMask);
+        channelMask = AUDIO_CHANNEL_OUT_STEREO;
+    }
     mState.enabledTracks= 0;
     mState.needsChanged = 0;
     mState.frameCount   = frameCount;
     mState.outputTemp   = 0;
     mState.resampleTemp = 0;
+    mState.bus          = 0;
+    mState.busChannelMask = channelMask;
+    // only the float bus has more than 2 channels
+    if (floatBus || channelMask != AUDIO_CHANNEL_OUT_STEREO) {
+        // allocated for the largest frame count, it is never reallocated
+        mState.bus = new float[frameCount * popcount(channelMask)];
+    }
     mState.hook         = process__nop;
     track_t* t = mState.tracks;
     for (int i=0 ; i<32 ; i++) {
@@ -71,6 +90,7 @@ AudioMixer::AudioMixer(size_t frameCount, uint32_t sampleRate)
         t->hook = 0;
         t->resampler = 0;
         t->sampleRate = mSampleRate;
+        t->resamplerQuality = AudioResampler::DEFAULT;
         t->in = 0;
         t->mainBuffer = NULL;
         t->auxBuffer = NULL;
@@ -87,8 +107,16 @@ AudioMixer::AudioMixer(size_t frameCount, uint32_t sampleRate)
      }
      delete [] mState.outputTemp;
      delete [] mState.resampleTemp;
+     delete [] mState.bus;
  }
 
+bool AudioMixer::isValidBusChannelMask(uint32_t channelMask)
+{
+    return (channelMask & ~AUDIO_CHANNEL_OUT_ALL) == 0 &&
+            (channelMask & AUDIO_CHANNEL_OUT_STEREO) == AUDIO_CHANNEL_OUT_STEREO &&
+            popcount(channelMask) <= MAX_NUM_BUS_CHANNELS;
+}
+
  int AudioMixer::getTrackName()
  {
     uint32_t names = mTrackNames;
@@ -131,6 +159,7 @@ AudioMixer::AudioMixer(size_t frameCount, uint32_t sampleRate)
             track.sampleRate = mSampleRate;
             invalidateState(1<<name);
         }
+        track.resamplerQuality = AudioResampler::DEFAULT;
         track.volumeInc[0] = 0;
         track.volumeInc[1] = 0;
         mTrackNames &= ~(1<<name);
@@ -189,7 +218,11 @@ status_t AudioMixer::setParameter(int target, int name, void *value)
             uint32_t mask = (uint32_t)value;
             if (mState.tracks[ mActiveTrack ].channelMask != mask) {
                 uint8_t channelCount = popcount(mask);
-                if ((channelCount <= MAX_NUM_CHANNELS) && (channelCount)) {
+                // tracks of more than 2 channels can be mixed to the matching
+                // channels of a float bus
+                if (((channelCount <= MAX_NUM_CHANNELS) ||
+                        (mState.bus != 0 && (mask & ~mState.busChannelMask) == 0)) &&
+                        (channelCount)) {
                     mState.tracks[ mActiveTrack ].channelMask = mask;
                     mState.tracks[ mActiveTrack ].channelCount = channelCount;
                     LOGV("setParameter(TRACK, CHANNEL_MASK, %x)", mask);
@@ -236,6 +269,14 @@ status_t AudioMixer::setParameter(int target, int name, void *value)
             invalidateState(1<<mActiveTrack);
             return NO_ERROR;
         }
+        if (name == QUALITY) {
+            track_t& track = mState.tracks[ mActiveTrack ];
+            if (track.setResamplerQuality(valueInt, mSampleRate)) {
+                LOGV("setParameter(RESAMPLE, QUALITY, %d)", valueInt);
+                invalidateState(1<<mActiveTrack);
+            }
+            return NO_ERROR;
+        }
         break;
     case RAMP_VOLUME:
     case VOLUME:
@@ -287,12 +328,17 @@ status_t AudioMixer::setParameter(int target, int name, void *value)
 
 bool AudioMixer::track_t::setResampler(uint32_t value, uint32_t devSampleRate)
 {
+    // the resamplers output stereo: tracks of more channels are not resampled
+    if (channelCount > MAX_NUM_CHANNELS) {
+        LOGW_IF(value != devSampleRate, "cannot resample %d channels", channelCount);
+        return false;
+    }
     if (value!=devSampleRate || resampler) {
         if (sampleRate != value) {
             sampleRate = value;
             if (resampler == 0) {
                 resampler = AudioResampler::create(
-                        format, channelCount, devSampleRate);
+                        format, channelCount, devSampleRate, resamplerQuality);
             }
             return true;
         }
@@ -300,6 +346,22 @@ bool AudioMixer::track_t::setResampler(uint32_t value, uint32_t devSampleRate)
     return false;
 }
 
+bool AudioMixer::track_t::setResamplerQuality(int quality, uint32_t devSampleRate)
+{
+    if (resamplerQuality == quality) {
+        return false;
+    }
+    resamplerQuality = quality;
+    if (resampler != 0) {
+        // the next sample rate creates a resampler of the new quality
+        delete resampler;
+        resampler = 0;
+        sampleRate = devSampleRate;
+        return true;
+    }
+    return false;
+}
+
 bool AudioMixer::track_t::doesResample() const
 {
     return resampler != 0;
@@ -345,6 +407,24 @@ void AudioMixer::process()
     mState.hook(&mState);
 }
 
+status_t AudioMixer::setFrameCount(size_t frameCount)
+{
+    if (frameCount == 0 || frameCount > mMaxFrameCount) {
+        return BAD_VALUE;
+    }
+    if (frameCount != mState.frameCount) {
+        mState.frameCount = frameCount;
+        // the temporary buffers are sized by the frame count, process__validate()
+        // allocates them again if they are needed
+        delete [] mState.outputTemp;
+        mState.outputTemp = 0;
+        delete [] mState.resampleTemp;
+        mState.resampleTemp = 0;
+        invalidateState(mState.enabledTracks);
+    }
+    return NO_ERROR;
+}
+
 
 void AudioMixer::process__validate(state_t* state)
 {
@@ -419,7 +499,12 @@ void AudioMixer::process__validate(state_t* state)
     // select the processing hooks
     state->hook = process__nop;
     if (countActiveTracks) {
-        if (resampling) {
+        if (state->bus) {
+            if (resampling && !state->resampleTemp) {
+                state->resampleTemp = new int32_t[MAX_NUM_CHANNELS * state->frameCount];
+            }
+            state->hook = process__floatBus;
+        } else if (resampling) {
             if (!state->outputTemp) {
                 state->outputTemp = new int32_t[MAX_NUM_CHANNELS * state->frameCount];
             }
@@ -471,7 +556,7 @@ void AudioMixer::process__validate(state_t* state)
        }
        if (allMuted) {
            state->hook = process__nop;
-       } else if (all16BitsStereoNoResample) {
+       } else if (all16BitsStereoNoResample && !state->bus) {
            if (countActiveTracks == 1) {
               state->hook = process__OneTrack16BitsStereoNoResampling;
            }
@@ -562,6 +647,157 @@ int32_t mulRL(int left, uint32_t inRL, uint32_t vRL)
 }
 
 
+// ----------------------------------------------------------------------------
+// Mixing kernels for 16 bits stereo. Each one processes as many frames as
+// possible with NEON or SSE2 and finishes with the same scalar code as the
+// other mixing loops; the results are identical.
+
+#if !defined(__ARM_HAVE_NEON) && defined(__SSE2__)
+// out[0..7] += s * v, for 8 samples and their 8 gains
+static inline void mulAdd8(int32_t* out, __m128i s, __m128i v)
+{
+    const __m128i lo = _mm_mullo_epi16(s, v);
+    const __m128i hi = _mm_mulhi_epi16(s, v);
+    __m128i* o = reinterpret_cast<__m128i*>(out);
+    _mm_storeu_si128(o, _mm_add_epi32(_mm_loadu_si128(o), _mm_unpacklo_epi16(lo, hi)));
+    _mm_storeu_si128(o + 1, _mm_add_epi32(_mm_loadu_si128(o + 1), _mm_unpackhi_epi16(lo, hi)));
+}
+#endif
+
+// mixes 16 bits stereo frames with constant gains: out += in * v
+static inline
+void mixStereo16(int32_t* out, int16_t const* in, size_t frameCount, int16_t vl, int16_t vr)
+{
+    size_t i = 0;
+#if defined(__ARM_HAVE_NEON)
+    const int16_t gains[4] = { vl, vr, vl, vr };
+    const int16x4_t v = vld1_s16(gains);
+    for ( ; i + 4 <= frameCount ; i += 4) {
+        const int16x8_t s = vld1q_s16(in + i*2);
+        vst1q_s32(out + i*2, vmlal_s16(vld1q_s32(out + i*2), vget_low_s16(s), v));
+        vst1q_s32(out + i*2 + 4, vmlal_s16(vld1q_s32(out + i*2 + 4), vget_high_s16(s), v));
+    }
+#elif defined(__SSE2__)
+    const __m128i v = _mm_set_epi16(vr, vl, vr, vl, vr, vl, vr, vl);
+    for ( ; i + 4 <= frameCount ; i += 4) {
+        mulAdd8(out + i*2, _mm_loadu_si128(reinterpret_cast<__m128i const*>(in + i*2)), v);
+    }
+#endif
+    for ( ; i < frameCount ; i++) {
+        out[i*2] = mulAdd(in[i*2], vl, out[i*2]);
+        out[i*2 + 1] = mulAdd(in[i*2 + 1], vr, out[i*2 + 1]);
+    }
+}
+
+// mixes 16 bits stereo frames with 16.16 gains ramping by vlInc and vrInc
+// per frame: out += in * (v >> 16), the gains are updated
+static inline
+void rampStereo16(int32_t* out, int16_t const* in, size_t frameCount,
+        int32_t* vlp, int32_t* vrp, int32_t vlInc, int32_t vrInc)
+{
+    int32_t vl = *vlp;
+    int32_t vr = *vrp;
+    size_t i = 0;
+#if defined(__ARM_HAVE_NEON)
+    // the gains of two consecutive frames
+    const int32_t gains[4] = { vl, vr, vl + vlInc, vr + vrInc };
+    const int32_t incs[4] = { vlInc*2, vrInc*2, vlInc*2, vrInc*2 };
+    int32x4_t v = vld1q_s32(gains);
+    const int32x4_t inc = vld1q_s32(incs);
+    for ( ; i + 2 <= frameCount ; i += 2) {
+        const int32x4_t s = vmovl_s16(vld1_s16(in + i*2));
+        vst1q_s32(out + i*2, vmlaq_s32(vld1q_s32(out + i*2), vshrq_n_s32(v, 16), s));
+        v = vaddq_s32(v, inc);
+    }
+#elif defined(__SSE2__)
+    // the gains of four consecutive frames; they are within the range of
+    // the 3.12 volumes, packing them to 16 bits does not saturate
+    __m128i v0 = _mm_set_epi32(vr + vrInc, vl + vlInc, vr, vl);
+    __m128i v1 = _mm_set_epi32(vr + vrInc*3, vl + vlInc*3, vr + vrInc*2, vl + vlInc*2);
+    const __m128i inc = _mm_set_epi32(vrInc*4, vlInc*4, vrInc*4, vlInc*4);
+    for ( ; i + 4 <= frameCount ; i += 4) {
+        const __m128i v = _mm_packs_epi32(_mm_srai_epi32(v0, 16), _mm_srai_epi32(v1, 16));
+        mulAdd8(out + i*2, _mm_loadu_si128(reinterpret_cast<__m128i const*>(in + i*2)), v);
+        v0 = _mm_add_epi32(v0, inc);
+        v1 = _mm_add_epi32(v1, inc);
+    }
+#endif
+    // the gains wrap around like the scalar loop's
+    vl = int32_t(uint32_t(vl) + uint32_t(vlInc) * i);
+    vr = int32_t(uint32_t(vr) + uint32_t(vrInc) * i);
+    for ( ; i < frameCount ; i++) {
+        out[i*2] += (vl >> 16) * int32_t(in[i*2]);
+        out[i*2 + 1] += (vr >> 16) * int32_t(in[i*2 + 1]);
+        vl += vlInc;
+        vr += vrInc;
+    }
+    *vlp = vl;
+    *vrp = vr;
+}
+
+// mixes 4.12 stereo frames, truncated to 16 bits, with constant gains:
+// out += int16_t(temp >> 12) * v
+static inline
+void mixStereoTemp(int32_t* out, int32_t const* temp, size_t frameCount, int16_t vl, int16_t vr)
+{
+    size_t i = 0;
+#if defined(__ARM_HAVE_NEON)
+    const int16_t gains[4] = { vl, vr, vl, vr };
+    const int16x4_t v = vld1_s16(gains);
+    for ( ; i + 2 <= frameCount ; i += 2) {
+        const int16x4_t s = vmovn_s32(vshrq_n_s32(vld1q_s32(temp + i*2), 12));
+        vst1q_s32(out + i*2, vmlal_s16(vld1q_s32(out + i*2), s, v));
+    }
+#elif defined(__SSE2__)
+    const __m128i v = _mm_set_epi16(vr, vl, vr, vl, vr, vl, vr, vl);
+    for ( ; i + 4 <= frameCount ; i += 4) {
+        // sign extend the low 16 bits so that packing truncates
+        __m128i t0 = _mm_loadu_si128(reinterpret_cast<__m128i const*>(temp + i*2));
+        __m128i t1 = _mm_loadu_si128(reinterpret_cast<__m128i const*>(temp + i*2 + 4));
+        t0 = _mm_srai_epi32(_mm_slli_epi32(_mm_srai_epi32(t0, 12), 16), 16);
+        t1 = _mm_srai_epi32(_mm_slli_epi32(_mm_srai_epi32(t1, 12), 16), 16);
+        mulAdd8(out + i*2, _mm_packs_epi32(t0, t1), v);
+    }
+#endif
+    for ( ; i < frameCount ; i++) {
+        out[i*2] = mulAdd(int16_t(temp[i*2] >> 12), vl, out[i*2]);
+        out[i*2 + 1] = mulAdd(int16_t(temp[i*2 + 1] >> 12), vr, out[i*2 + 1]);
+    }
+}
+
+// scales 16 bits stereo frames and writes them clamped to 16 bits:
+// out = clamp16((in * v) >> 12)
+static inline
+void scaleStereo16(int32_t* out, int16_t const* in, size_t frameCount, int16_t vl, int16_t vr)
+{
+    size_t i = 0;
+#if defined(__ARM_HAVE_NEON)
+    const int16_t gains[4] = { vl, vr, vl, vr };
+    const int16x4_t v = vld1_s16(gains);
+    for ( ; i + 4 <= frameCount ; i += 4) {
+        const int16x8_t s = vld1q_s16(in + i*2);
+        const int16x4_t l = vqshrn_n_s32(vmull_s16(vget_low_s16(s), v), 12);
+        const int16x4_t h = vqshrn_n_s32(vmull_s16(vget_high_s16(s), v), 12);
+        vst1q_s16(reinterpret_cast<int16_t*>(out + i), vcombine_s16(l, h));
+    }
+#elif defined(__SSE2__)
+    const __m128i v = _mm_set_epi16(vr, vl, vr, vl, vr, vl, vr, vl);
+    for ( ; i + 4 <= frameCount ; i += 4) {
+        const __m128i s = _mm_loadu_si128(reinterpret_cast<__m128i const*>(in + i*2));
+        const __m128i lo = _mm_mullo_epi16(s, v);
+        const __m128i hi = _mm_mulhi_epi16(s, v);
+        const __m128i p0 = _mm_srai_epi32(_mm_unpacklo_epi16(lo, hi), 12);
+        const __m128i p1 = _mm_srai_epi32(_mm_unpackhi_epi16(lo, hi), 12);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_packs_epi32(p0, p1));
+    }
+#endif
+    for ( ; i < frameCount ; i++) {
+        int32_t l = clamp16(mul(in[i*2], vl) >> 12);
+        int32_t r = clamp16(mul(in[i*2 + 1], vr) >> 12);
+        out[i] = (r<<16) | (l & 0xFFFF);
+    }
+}
+
 void AudioMixer::track__genericResample(track_t* t, int32_t* out, size_t outFrameCount, int32_t* temp, int32_t* aux)
 {
     t->resampler->setSampleRate(t->sampleRate);
@@ -659,13 +895,7 @@ void AudioMixer::volumeStereo(track_t* t, int32_t* out, size_t frameCount, int32
             aux++;
         } while (--frameCount);
     } else {
-        do {
-            int16_t l = (int16_t)(*temp++ >> 12);
-            int16_t r = (int16_t)(*temp++ >> 12);
-            out[0] = mulAdd(l, vl, out[0]);
-            out[1] = mulAdd(r, vr, out[1]);
-            out += 2;
-        } while (--frameCount);
+        mixStereoTemp(out, temp, frameCount, vl, vr);
     }
 }
 
@@ -732,12 +962,8 @@ void AudioMixer::track__16BitsStereo(track_t* t, int32_t* out, size_t frameCount
             //        t, vlInc/65536.0f, vl/65536.0f, t->volume[0],
             //        (vl + vlInc*frameCount)/65536.0f, frameCount);
 
-            do {
-                *out++ += (vl >> 16) * (int32_t) *in++;
-                *out++ += (vr >> 16) * (int32_t) *in++;
-                vl += vlInc;
-                vr += vrInc;
-            } while (--frameCount);
+            rampStereo16(out, in, frameCount, &vl, &vr, vlInc, vrInc);
+            in += frameCount*2;
 
             t->prevVolume[0] = vl;
             t->prevVolume[1] = vr;
@@ -746,14 +972,8 @@ void AudioMixer::track__16BitsStereo(track_t* t, int32_t* out, size_t frameCount
 
         // constant gain
         else {
-            const uint32_t vrl = t->volumeRL;
-            do {
-                uint32_t rl = *reinterpret_cast<uint32_t const *>(in);
-                in += 2;
-                out[0] = mulAddRL(1, rl, vrl, out[0]);
-                out[1] = mulAddRL(0, rl, vrl, out[1]);
-                out += 2;
-            } while (--frameCount);
+            mixStereo16(out, in, frameCount, t->volume[0], t->volume[1]);
+            in += frameCount*2;
         }
     }
     t->in = in;
@@ -847,7 +1067,25 @@ void AudioMixer::track__16BitsMono(track_t* t, int32_t* out, size_t frameCount,
 
 void AudioMixer::ditherAndClamp(int32_t* out, int32_t const *sums, size_t c)
 {
-    for (size_t i=0 ; i<c ; i++) {
+    size_t i = 0;
+#if defined(__ARM_HAVE_NEON)
+    for ( ; i + 4 <= c ; i += 4) {
+        const int16x4_t l = vqshrn_n_s32(vld1q_s32(sums), 12);
+        const int16x4_t h = vqshrn_n_s32(vld1q_s32(sums + 4), 12);
+        vst1q_s16(reinterpret_cast<int16_t*>(out), vcombine_s16(l, h));
+        sums += 8;
+        out += 4;
+    }
+#elif defined(__SSE2__)
+    for ( ; i + 4 <= c ; i += 4) {
+        const __m128i l = _mm_srai_epi32(_mm_loadu_si128(reinterpret_cast<__m128i const*>(sums)), 12);
+        const __m128i h = _mm_srai_epi32(_mm_loadu_si128(reinterpret_cast<__m128i const*>(sums + 4)), 12);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_packs_epi32(l, h));
+        sums += 8;
+        out += 4;
+    }
+#endif
+    for ( ; i<c ; i++) {
         int32_t l = *sums++;
         int32_t r = *sums++;
         int32_t nl = l >> 12;
@@ -858,11 +1096,35 @@ void AudioMixer::ditherAndClamp(int32_t* out, int32_t const *sums, size_t c)
     }
 }
 
+void AudioMixer::accumulate16(int16_t* out, int16_t const *in, size_t c)
+{
+    size_t i = 0;
+#if defined(__ARM_HAVE_NEON)
+    for ( ; i + 8 <= c ; i += 8) {
+        vst1q_s16(out, vqaddq_s16(vld1q_s16(out), vld1q_s16(in)));
+        in += 8;
+        out += 8;
+    }
+#elif defined(__SSE2__)
+    for ( ; i + 8 <= c ; i += 8) {
+        const __m128i o = _mm_loadu_si128(reinterpret_cast<__m128i const*>(out));
+        const __m128i s = _mm_loadu_si128(reinterpret_cast<__m128i const*>(in));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_adds_epi16(o, s));
+        in += 8;
+        out += 8;
+    }
+#endif
+    for ( ; i<c ; i++) {
+        *out = clamp16((int32_t)*out + (int32_t)*in++);
+        out++;
+    }
+}
+
 // no-op case
 void AudioMixer::process__nop(state_t* state)
 {
     uint32_t e0 = state->enabledTracks;
-    size_t bufSize = state->frameCount * sizeof(int16_t) * MAX_NUM_CHANNELS;
+    size_t bufSize = state->frameCount * sizeof(int16_t) * popcount(state->busChannelMask);
     while (e0) {
         // process by group of tracks with same output buffer to
         // avoid multiple memset() on same buffer
@@ -1072,7 +1334,6 @@ void AudioMixer::process__OneTrack16BitsStereoNoResampling(state_t* state)
 
     const int16_t vl = t.volume[0];
     const int16_t vr = t.volume[1];
-    const uint32_t vrl = t.volumeRL;
     while (numFrames) {
         b.frameCount = numFrames;
         t.bufferProvider->getNextBuffer(&b);
@@ -1088,28 +1349,10 @@ void AudioMixer::process__OneTrack16BitsStereoNoResampling(state_t* state)
         }
         size_t outFrames = b.frameCount;
 
-        if (UNLIKELY(uint32_t(vl) > UNITY_GAIN || uint32_t(vr) > UNITY_GAIN)) {
-            // volume is boosted, so we might need to clamp even though
-            // we process only one track.
-            do {
-                uint32_t rl = *reinterpret_cast<uint32_t const *>(in);
-                in += 2;
-                int32_t l = mulRL(1, rl, vrl) >> 12;
-                int32_t r = mulRL(0, rl, vrl) >> 12;
-                // clamping...
-                l = clamp16(l);
-                r = clamp16(r);
-                *out++ = (r<<16) | (l & 0xFFFF);
-            } while (--outFrames);
-        } else {
-            do {
-                uint32_t rl = *reinterpret_cast<uint32_t const *>(in);
-                in += 2;
-                int32_t l = mulRL(1, rl, vrl) >> 12;
-                int32_t r = mulRL(0, rl, vrl) >> 12;
-                *out++ = (r<<16) | (l & 0xFFFF);
-            } while (--outFrames);
-        }
+        // clamping is only needed when the volume is boosted, otherwise it
+        // does not change the samples
+        scaleStereo16(out, in, outFrames, vl, vr);
+        out += outFrames;
         numFrames -= b.frameCount;
         t.bufferProvider->releaseBuffer(&b);
     }
@@ -1213,6 +1456,275 @@ void AudioMixer::process__TwoTracks16BitsStereoNoResampling(state_t* state)
     }
 }
 
+// ----------------------------------------------------------------------------
+// float bus
+
+// scale of the samples read by mixToBus(): 16 bit samples of the tracks and
+// 4.27 samples of the resamplers
+static inline float busScale(int16_t const*)
+{
+    return 1.0f / (1 << 15);
+}
+
+static inline float busScale(int32_t const*)
+{
+    return 1.0f / (1 << 27);
+}
+
+// adds the stereo 16 bit frames of in to the stereo bus
+static inline
+void mixStereo16ToBus(float* bus, int16_t const* in, size_t frameCount, float vl, float vr)
+{
+    size_t i = 0;
+#if defined(__ARM_HAVE_NEON)
+    const float vlr[4] = { vl, vr, vl, vr };
+    const float32x4_t v = vld1q_f32(vlr);
+    for ( ; i + 4 <= frameCount ; i += 4) {
+        const int16x8_t s = vld1q_s16(in);
+        const float32x4_t lo = vcvtq_f32_s32(vmovl_s16(vget_low_s16(s)));
+        const float32x4_t hi = vcvtq_f32_s32(vmovl_s16(vget_high_s16(s)));
+        vst1q_f32(bus, vmlaq_f32(vld1q_f32(bus), lo, v));
+        vst1q_f32(bus + 4, vmlaq_f32(vld1q_f32(bus + 4), hi, v));
+        in += 8;
+        bus += 8;
+    }
+#elif defined(__SSE2__)
+    const __m128 v = _mm_setr_ps(vl, vr, vl, vr);
+    for ( ; i + 4 <= frameCount ; i += 4) {
+        const __m128i s = _mm_loadu_si128(reinterpret_cast<__m128i const*>(in));
+        const __m128 lo = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(s, s), 16));
+        const __m128 hi = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(s, s), 16));
+        _mm_storeu_ps(bus, _mm_add_ps(_mm_loadu_ps(bus), _mm_mul_ps(lo, v)));
+        _mm_storeu_ps(bus + 4, _mm_add_ps(_mm_loadu_ps(bus + 4), _mm_mul_ps(hi, v)));
+        in += 8;
+        bus += 8;
+    }
+#endif
+    for ( ; i < frameCount ; i++) {
+        bus[0] += in[0] * vl;
+        bus[1] += in[1] * vr;
+        in += 2;
+        bus += 2;
+    }
+}
+
+// converts the bus to 16 bit samples, clamped and rounded half away from zero
+static inline
+void busToPcm16(int16_t* out, float const* bus, size_t c)
+{
+    size_t i = 0;
+#if defined(__ARM_HAVE_NEON)
+    const float32x4_t scale = vdupq_n_f32(1 << 15);
+    const float32x4_t max = vdupq_n_f32(32767.0f);
+    const float32x4_t min = vdupq_n_f32(-32768.0f);
+    const float32x4_t half = vdupq_n_f32(0.5f);
+    const float32x4_t minusHalf = vdupq_n_f32(-0.5f);
+    const float32x4_t zero = vdupq_n_f32(0.0f);
+    for ( ; i + 8 <= c ; i += 8) {
+        float32x4_t l = vminq_f32(vmaxq_f32(vmulq_f32(vld1q_f32(bus), scale), min), max);
+        float32x4_t h = vminq_f32(vmaxq_f32(vmulq_f32(vld1q_f32(bus + 4), scale), min), max);
+        l = vaddq_f32(l, vbslq_f32(vcltq_f32(l, zero), minusHalf, half));
+        h = vaddq_f32(h, vbslq_f32(vcltq_f32(h, zero), minusHalf, half));
+        vst1q_s16(out, vcombine_s16(vqmovn_s32(vcvtq_s32_f32(l)), vqmovn_s32(vcvtq_s32_f32(h))));
+        bus += 8;
+        out += 8;
+    }
+#elif defined(__SSE2__)
+    const __m128 scale = _mm_set1_ps(1 << 15);
+    const __m128 max = _mm_set1_ps(32767.0f);
+    const __m128 min = _mm_set1_ps(-32768.0f);
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 sign = _mm_set1_ps(-0.0f);
+    for ( ; i + 8 <= c ; i += 8) {
+        __m128 l = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(bus), scale), min), max);
+        __m128 h = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(bus + 4), scale), min), max);
+        l = _mm_add_ps(l, _mm_or_ps(_mm_and_ps(l, sign), half));
+        h = _mm_add_ps(h, _mm_or_ps(_mm_and_ps(h, sign), half));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out),
+                _mm_packs_epi32(_mm_cvttps_epi32(l), _mm_cvttps_epi32(h)));
+        bus += 8;
+        out += 8;
+    }
+#endif
+    for ( ; i < c ; i++) {
+        float s = *bus++ * (1 << 15);
+        if (s > 32767.0f) {
+            s = 32767.0f;
+        } else if (s < -32768.0f) {
+            s = -32768.0f;
+        }
+        *out++ = (int16_t)(s < 0 ? s - 0.5f : s + 0.5f);
+    }
+}
+
+static inline bool isLeftChannel(uint32_t channel)
+{
+    return (channel & (AUDIO_CHANNEL_OUT_FRONT_LEFT | AUDIO_CHANNEL_OUT_BACK_LEFT |
+            AUDIO_CHANNEL_OUT_FRONT_LEFT_OF_CENTER | AUDIO_CHANNEL_OUT_SIDE_LEFT |
+            AUDIO_CHANNEL_OUT_TOP_FRONT_LEFT | AUDIO_CHANNEL_OUT_TOP_BACK_LEFT)) != 0;
+}
+
+static inline bool isRightChannel(uint32_t channel)
+{
+    return (channel & (AUDIO_CHANNEL_OUT_FRONT_RIGHT | AUDIO_CHANNEL_OUT_BACK_RIGHT |
+            AUDIO_CHANNEL_OUT_FRONT_RIGHT_OF_CENTER | AUDIO_CHANNEL_OUT_SIDE_RIGHT |
+            AUDIO_CHANNEL_OUT_TOP_FRONT_RIGHT | AUDIO_CHANNEL_OUT_TOP_BACK_RIGHT)) != 0;
+}
+
+// Adds frameCount frames of in, of channel mask inChannelMask, to the bus with
+// the volume and auxiliary send level of the track, and advances the ramps.
+// A channel of the bus that is neither left nor right gets the mean volume.
+template <typename T>
+void AudioMixer::mixToBus(track_t* t, float* bus, uint32_t busChannelMask,
+        T const* in, uint32_t inChannelMask, size_t frameCount, int32_t* aux)
+{
+    const uint32_t busChannels = popcount(busChannelMask);
+    const uint32_t inChannels = popcount(inChannelMask);
+    const float scale = busScale(in);
+    // volumes are 4.12 and ramp in 16.16
+    const float volumeScale = scale / UNITY_GAIN;
+    const float rampScale = volumeScale / (1 << 16);
+    const bool ramp = (t->volumeInc[0] | t->volumeInc[1]) != 0 ||
+            (aux != NULL && t->auxInc != 0);
+
+    float vl, vr, vlInc, vrInc;
+    if (ramp) {
+        vl = t->prevVolume[0] * rampScale;
+        vr = t->prevVolume[1] * rampScale;
+        vlInc = t->volumeInc[0] * rampScale;
+        vrInc = t->volumeInc[1] * rampScale;
+    } else {
+        vl = t->volume[0] * volumeScale;
+        vr = t->volume[1] * volumeScale;
+        vlInc = 0;
+        vrInc = 0;
+    }
+
+    if (!ramp && aux == NULL && inChannelMask == AUDIO_CHANNEL_OUT_STEREO &&
+            busChannelMask == AUDIO_CHANNEL_OUT_STEREO && sizeof(T) == sizeof(int16_t)) {
+        mixStereo16ToBus(bus, reinterpret_cast<int16_t const*>(in), frameCount, vl, vr);
+        return;
+    }
+
+    // for each channel of the bus: channel of the input frame and volume
+    int8_t map[MAX_NUM_BUS_CHANNELS];
+    uint8_t side[MAX_NUM_BUS_CHANNELS];
+    uint32_t busMask = busChannelMask;
+    for (uint32_t c = 0; c < busChannels; c++) {
+        const uint32_t channel = busMask & -busMask;
+        busMask &= ~channel;
+        if (inChannels == 1) {
+            map[c] = (channel & AUDIO_CHANNEL_OUT_STEREO) ? 0 : -1;
+        } else if (channel & inChannelMask) {
+            map[c] = popcount(inChannelMask & (channel - 1));
+        } else {
+            map[c] = -1;
+        }
+        side[c] = isLeftChannel(channel) ? 0 : (isRightChannel(channel) ? 1 : 2);
+    }
+
+    // the auxiliary buffer gets the mean of the first 2 channels in 16 bit units,
+    // scaled by the 4.12 send level like the other hooks do
+    int32_t va = ramp ? t->prevAuxLevel : t->auxLevel << 16;
+    const int32_t vaInc = aux != NULL ? t->auxInc : 0;
+    const float auxScale = scale * (1 << 15) / (1 << 16);
+
+    for (size_t i = 0; i < frameCount; i++) {
+        const float v[3] = { vl, vr, (vl + vr) * 0.5f };
+        for (uint32_t c = 0; c < busChannels; c++) {
+            if (map[c] >= 0) {
+                bus[c] += in[map[c]] * v[side[c]];
+            }
+        }
+        if (aux != NULL) {
+            const float a = inChannels == 1 ? (float)in[0] : ((float)in[0] + in[1]) * 0.5f;
+            *aux++ += (int32_t)(a * auxScale * va);
+            va += vaInc;
+        }
+        vl += vlInc;
+        vr += vrInc;
+        in += inChannels;
+        bus += busChannels;
+    }
+
+    if (ramp) {
+        t->prevVolume[0] += t->volumeInc[0] * (int32_t)frameCount;
+        t->prevVolume[1] += t->volumeInc[1] * (int32_t)frameCount;
+        if (aux != NULL) {
+            t->prevAuxLevel = va;
+        }
+        t->adjustVolumeRamp(aux != NULL);
+    }
+}
+
+// mix in the float bus, with or without resampling
+void AudioMixer::process__floatBus(state_t* state)
+{
+    const uint32_t busChannels = popcount(state->busChannelMask);
+    const size_t numFrames = state->frameCount;
+    float* const bus = state->bus;
+
+    uint32_t e0 = state->enabledTracks;
+    while (e0) {
+        // process by group of tracks with same output buffer
+        // to optimize cache use
+        uint32_t e1 = e0, e2 = e0;
+        int j = 31 - __builtin_clz(e1);
+        track_t& t1 = state->tracks[j];
+        e2 &= ~(1<<j);
+        while (e2) {
+            j = 31 - __builtin_clz(e2);
+            e2 &= ~(1<<j);
+            track_t& t2 = state->tracks[j];
+            if UNLIKELY(t2.mainBuffer != t1.mainBuffer) {
+                e1 &= ~(1<<j);
+            }
+        }
+        e0 &= ~(e1);
+        int16_t *out = reinterpret_cast<int16_t*>(t1.mainBuffer);
+        memset(bus, 0, numFrames * busChannels * sizeof(float));
+        while (e1) {
+            const int i = 31 - __builtin_clz(e1);
+            e1 &= ~(1<<i);
+            track_t& t = state->tracks[i];
+            const bool muted = (t.needs & NEEDS_MUTE__MASK) == NEEDS_MUTE_ENABLED;
+            int32_t *aux = NULL;
+            if UNLIKELY((t.needs & NEEDS_AUX__MASK) == NEEDS_AUX_ENABLED) {
+                aux = t.auxBuffer;
+            }
+
+            if ((t.needs & NEEDS_RESAMPLE__MASK) == NEEDS_RESAMPLE_ENABLED) {
+                int32_t* temp = state->resampleTemp;
+                t.resampler->setSampleRate(t.sampleRate);
+                t.resampler->setVolume(UNITY_GAIN, UNITY_GAIN);
+                memset(temp, 0, numFrames * MAX_NUM_CHANNELS * sizeof(int32_t));
+                t.resampler->resample(temp, numFrames, t.bufferProvider);
+                mixToBus(&t, bus, state->busChannelMask, temp, AUDIO_CHANNEL_OUT_STEREO,
+                        numFrames, aux);
+            } else {
+                size_t outFrames = 0;
+                while (outFrames < numFrames) {
+                    t.buffer.frameCount = numFrames - outFrames;
+                    t.bufferProvider->getNextBuffer(&t.buffer);
+                    t.in = t.buffer.raw;
+                    // t.in == NULL can happen if the track was flushed just after having
+                    // been enabled for mixing.
+                    if (t.in == NULL) break;
+
+                    if (!muted) {
+                        mixToBus(&t, bus + outFrames * busChannels, state->busChannelMask,
+                                t.buffer.i16, t.channelMask, t.buffer.frameCount,
+                                aux != NULL ? aux + outFrames : NULL);
+                    }
+                    outFrames += t.buffer.frameCount;
+                    t.bufferProvider->releaseBuffer(&t.buffer);
+                }
+            }
+        }
+        busToPcm16(out, bus, numFrames * busChannels);
+    }
+}
+
 // ----------------------------------------------------------------------------
 }; // namespace android
 
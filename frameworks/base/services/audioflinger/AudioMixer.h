@@ -21,6 +21,8 @@
 #include <stdint.h>
 #include <sys/types.h>
 
+#include <system/audio.h>
+
 #include "AudioBufferProvider.h"
 #include "AudioResampler.h"
 
@@ -33,15 +35,25 @@ namespace android {
 
 // ----------------------------------------------------------------------------
 
+// The mixer accumulates the tracks in 32 bit integers and outputs 16 bit stereo.
+// It can instead accumulate them in a float bus of up to MAX_NUM_BUS_CHANNELS
+// channels, which is converted to 16 bit samples of the bus channel mask at the
+// end: this leaves headroom to the mix and lets tracks of more than 2 channels
+// be mixed without a downmix. Mono and stereo tracks go to the front left and
+// right channels of the bus; the channels of the other tracks go to the same
+// channels of the bus, they are not resampled.
 class AudioMixer
 {
 public:
-                            AudioMixer(size_t frameCount, uint32_t sampleRate);
+                            AudioMixer(size_t frameCount, uint32_t sampleRate,
+                                    uint32_t channelMask = AUDIO_CHANNEL_OUT_STEREO,
+                                    bool floatBus = false);
 
                             ~AudioMixer();
 
     static const uint32_t MAX_NUM_TRACKS = 32;
     static const uint32_t MAX_NUM_CHANNELS = 2;
+    static const uint32_t MAX_NUM_BUS_CHANNELS = 8;
 
     static const uint16_t UNITY_GAIN = 0x1000;
 
@@ -68,6 +80,7 @@ public:
         // for TARGET RESAMPLE
         SAMPLE_RATE     = 0x4100,
         RESET           = 0x4101,
+        QUALITY         = 0x4102, // AudioResampler::src_quality
         // for TARGET VOLUME (8 channels max)
         VOLUME0         = 0x4200,
         VOLUME1         = 0x4201,
@@ -87,9 +100,24 @@ public:
     status_t    setBufferProvider(AudioBufferProvider* bufferProvider);
     void        process();
 
+    // changes the number of frames mixed by process(), up to the frame count
+    // the mixer was created with
+    status_t    setFrameCount(size_t frameCount);
+    size_t      frameCount() const { return mState.frameCount; }
+
     uint32_t    trackNames() const { return mTrackNames; }
 
+    // the mix is output with this channel mask
+    uint32_t    channelMask() const { return mState.busChannelMask; }
+    bool        isFloatBus() const { return mState.bus != 0; }
+
+    // true if a mixer can output the channel mask: the bus must have a front
+    // left and a front right channel
+    static bool isValidBusChannelMask(uint32_t channelMask);
+
     static void ditherAndClamp(int32_t* out, int32_t const *sums, size_t c);
+    // adds c samples of in to out with saturation
+    static void accumulate16(int16_t* out, int16_t const *in, size_t c);
 
 private:
 
@@ -160,10 +188,12 @@ private:
 
         AudioResampler*     resampler;
         uint32_t            sampleRate;
+        int                 resamplerQuality;
         int32_t*           mainBuffer;
         int32_t*           auxBuffer;
 
         bool        setResampler(uint32_t sampleRate, uint32_t devSampleRate);
+        bool        setResamplerQuality(int quality, uint32_t devSampleRate);
         bool        doesResample() const;
         void        resetResampler();
         void        adjustVolumeRamp(bool aux);
@@ -177,13 +207,15 @@ private:
         mix_t           hook;
         int32_t         *outputTemp;
         int32_t         *resampleTemp;
-        int32_t         reserved[2];
+        float           *bus;           // NULL unless the mix is done in float
+        uint32_t        busChannelMask;
         track_t         tracks[32]; __attribute__((aligned(32)));
     };
 
     int             mActiveTrack;
     uint32_t        mTrackNames;
     const uint32_t  mSampleRate;
+    const size_t    mMaxFrameCount;
 
     state_t         mState __attribute__((aligned(32)));
 
@@ -202,6 +234,11 @@ private:
     static void process__genericResampling(state_t* state);
     static void process__OneTrack16BitsStereoNoResampling(state_t* state);
     static void process__TwoTracks16BitsStereoNoResampling(state_t* state);
+    static void process__floatBus(state_t* state);
+
+    template <typename T>
+    static void mixToBus(track_t* t, float* bus, uint32_t busChannelMask,
+            T const* in, uint32_t inChannelMask, size_t frameCount, int32_t* aux);
 };
 
 // ----------------------------------------------------------------------------
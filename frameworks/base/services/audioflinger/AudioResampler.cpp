@@ -23,7 +23,7 @@
 #include <cutils/log.h>
 #include <cutils/properties.h>
 #include "AudioResampler.h"
-#include "AudioResamplerSinc.h"
+#include "AudioResamplerPolyphase.h"
 #include "AudioResamplerCubic.h"
 
 #ifdef __arm__
@@ -104,8 +104,10 @@ AudioResampler* AudioResampler::create(int bitDepth, int inChannelCount,
         resampler = new AudioResamplerCubic(bitDepth, inChannelCount, sampleRate);
         break;
     case HIGH_QUALITY:
-        LOGV("Create sinc Resampler");
-        resampler = new AudioResamplerSinc(bitDepth, inChannelCount, sampleRate);
+    case VERY_HIGH_QUALITY:
+        LOGV("Create polyphase Resampler");
+        resampler = new AudioResamplerPolyphase(bitDepth, inChannelCount, sampleRate,
+                quality);
         break;
     }
 
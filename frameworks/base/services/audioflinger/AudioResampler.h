@@ -30,15 +30,16 @@ public:
     // Determines quality of SRC.
     //  LOW_QUALITY: linear interpolator (1st order)
     //  MED_QUALITY: cubic interpolator (3rd order)
-    //  HIGH_QUALITY: fixed multi-tap FIR (e.g. 48KHz->44.1KHz)
-    // NOTE: high quality SRC will only be supported for
-    // certain fixed rate conversions. Sample rate cannot be
-    // changed dynamically. 
+    //  HIGH_QUALITY: 32-tap polyphase FIR
+    //  VERY_HIGH_QUALITY: 64-tap polyphase FIR
+    // NOTE: the polyphase filters are exact for ratios such as
+    // 44.1KHz->48KHz, other ratios interpolate between 2 phases.
     enum src_quality {
         DEFAULT=0,
         LOW_QUALITY=1,
         MED_QUALITY=2,
-        HIGH_QUALITY=3
+        HIGH_QUALITY=3,
+        VERY_HIGH_QUALITY=4
     };
 
     static AudioResampler* create(int bitDepth, int inChannelCount,
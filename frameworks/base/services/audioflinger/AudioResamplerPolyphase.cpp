@@ -0,0 +1,475 @@
+/*
+ * Copyright (C) 2011 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "AudioResamplerPolyphase"
+//#define LOG_NDEBUG 0
+
+#include <math.h>
+#include <string.h>
+
+#if defined(__ARM_HAVE_NEON)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "AudioResamplerPolyphase.h"
+
+namespace android {
+// ----------------------------------------------------------------------------
+
+/*
+ * Coefficients of one filter for all its phases. Phase i is for an output
+ * frame i/phaseCount after the input frame in the middle of the taps; with
+ * lerp there is an extra phase for the position 1, so that the results of
+ * phases i and i+1 can always be interpolated.
+ */
+struct AudioResamplerPolyphase::Bank {
+    uint32_t phaseCount;
+    bool lerp;
+    // the cutoff is scaled down by num/den when below 1
+    uint32_t num;
+    uint32_t den;
+    uint32_t halfNumCoefs;
+    int16_t* coefs;
+    int refs;
+};
+
+Mutex AudioResamplerPolyphase::sBankLock;
+Vector<AudioResamplerPolyphase::Bank*> AudioResamplerPolyphase::sBanks;
+
+static uint32_t gcd(uint32_t a, uint32_t b)
+{
+    while (b) {
+        uint32_t t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+// modified Bessel function of the first kind, for the Kaiser window
+static double besselI0(double x)
+{
+    double sum = 1.0;
+    double term = 1.0;
+    const double y = x * x / 4.0;
+    for (int k = 1 ; term > sum * 1e-12 ; k++) {
+        term *= y / (double(k) * k);
+        sum += term;
+    }
+    return sum;
+}
+
+static void computeCoefs(int16_t* coefs, uint32_t phaseCount, uint32_t rowCount,
+        uint32_t halfNumCoefs, double cutoff, double beta)
+{
+    const uint32_t numCoefs = halfNumCoefs * 2;
+    const double i0Beta = besselI0(beta);
+    double* row = new double[numCoefs];
+
+    for (uint32_t i = 0 ; i < rowCount ; i++) {
+        const double frac = double(i) / phaseCount;
+        double sum = 0;
+        for (uint32_t k = 0 ; k < numCoefs ; k++) {
+            // distance of the input frame from the output frame
+            const double t = double(k) - (halfNumCoefs - 1) - frac;
+            const double x = 2.0 * cutoff * t;
+            double v = 2.0 * cutoff * (x == 0 ? 1.0 : sin(M_PI * x) / (M_PI * x));
+            const double w = t / halfNumCoefs;
+            v *= w < 1.0 ? besselI0(beta * sqrt(1.0 - w * w)) / i0Beta : 0.0;
+            row[k] = v;
+            sum += v;
+        }
+        // unity gain at DC for every phase
+        for (uint32_t k = 0 ; k < numCoefs ; k++) {
+            double v = floor(row[k] / sum * (1 << 14) + 0.5);
+            coefs[i*numCoefs + k] = int16_t(v > 32767 ? 32767 : (v < -32767 ? -32767 : v));
+        }
+    }
+
+    delete [] row;
+}
+
+AudioResamplerPolyphase::Bank* AudioResamplerPolyphase::acquireBank(
+        uint32_t phaseCount, bool lerp, uint32_t num, uint32_t den)
+{
+    Mutex::Autolock _l(sBankLock);
+
+    for (size_t i = 0 ; i < sBanks.size() ; i++) {
+        Bank* bank = sBanks[i];
+        if (bank->phaseCount == phaseCount && bank->lerp == lerp &&
+                bank->num == num && bank->den == den &&
+                bank->halfNumCoefs == mHalfNumCoefs) {
+            bank->refs++;
+            return bank;
+        }
+    }
+
+    Bank* bank = new Bank;
+    bank->phaseCount = phaseCount;
+    bank->lerp = lerp;
+    bank->num = num;
+    bank->den = den;
+    bank->halfNumCoefs = mHalfNumCoefs;
+    bank->refs = 1;
+
+    const uint32_t rowCount = lerp ? phaseCount + 1 : phaseCount;
+    double cutoff = 0.5 * mBandwidth;
+    if (num < den) {
+        cutoff = cutoff * num / den;
+    }
+    bank->coefs = new int16_t[rowCount * mHalfNumCoefs * 2];
+    computeCoefs(bank->coefs, phaseCount, rowCount, mHalfNumCoefs, cutoff, mBeta);
+    LOGV("new bank: %u phases, %u coefs, cutoff %f", phaseCount, mHalfNumCoefs * 2, cutoff);
+
+    sBanks.add(bank);
+    return bank;
+}
+
+void AudioResamplerPolyphase::releaseBank(Bank* bank)
+{
+    Mutex::Autolock _l(sBankLock);
+
+    if (--bank->refs > 0) {
+        return;
+    }
+
+    size_t unused = 0;
+    for (size_t i = 0 ; i < sBanks.size() ; i++) {
+        if (sBanks[i]->refs == 0) {
+            unused++;
+        }
+    }
+    // drop the oldest unused banks first
+    for (size_t i = 0 ; i < sBanks.size() && unused > kMaxUnusedBanks ; ) {
+        Bank* b = sBanks[i];
+        if (b->refs == 0) {
+            delete [] b->coefs;
+            delete b;
+            sBanks.removeAt(i);
+            unused--;
+        } else {
+            i++;
+        }
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+// inner products of numCoefs frames with numCoefs coefficients, numCoefs
+// is a multiple of 8
+
+static inline
+int32_t dotMono(int16_t const* x, int16_t const* h, uint32_t numCoefs)
+{
+#if defined(__ARM_HAVE_NEON)
+    int32x4_t acc = vdupq_n_s32(0);
+    for (uint32_t k = 0 ; k < numCoefs ; k += 8) {
+        const int16x8_t s = vld1q_s16(x + k);
+        const int16x8_t c = vld1q_s16(h + k);
+        acc = vmlal_s16(acc, vget_low_s16(s), vget_low_s16(c));
+        acc = vmlal_s16(acc, vget_high_s16(s), vget_high_s16(c));
+    }
+    int32x2_t sum = vadd_s32(vget_low_s32(acc), vget_high_s32(acc));
+    return vget_lane_s32(vpadd_s32(sum, sum), 0);
+#elif defined(__SSE2__)
+    __m128i acc = _mm_setzero_si128();
+    for (uint32_t k = 0 ; k < numCoefs ; k += 8) {
+        const __m128i s = _mm_loadu_si128(reinterpret_cast<__m128i const*>(x + k));
+        const __m128i c = _mm_loadu_si128(reinterpret_cast<__m128i const*>(h + k));
+        acc = _mm_add_epi32(acc, _mm_madd_epi16(s, c));
+    }
+    acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, 0x4E));
+    acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, 0xB1));
+    return _mm_cvtsi128_si32(acc);
+#else
+    int32_t acc = 0;
+    for (uint32_t k = 0 ; k < numCoefs ; k++) {
+        acc += int32_t(x[k]) * h[k];
+    }
+    return acc;
+#endif
+}
+
+static inline
+void dotStereo(int32_t& l, int32_t& r, int16_t const* x, int16_t const* h, uint32_t numCoefs)
+{
+#if defined(__ARM_HAVE_NEON)
+    int32x4_t accL = vdupq_n_s32(0);
+    int32x4_t accR = vdupq_n_s32(0);
+    for (uint32_t k = 0 ; k < numCoefs ; k += 8) {
+        const int16x8x2_t s = vld2q_s16(x + k*2);
+        const int16x8_t c = vld1q_s16(h + k);
+        accL = vmlal_s16(accL, vget_low_s16(s.val[0]), vget_low_s16(c));
+        accL = vmlal_s16(accL, vget_high_s16(s.val[0]), vget_high_s16(c));
+        accR = vmlal_s16(accR, vget_low_s16(s.val[1]), vget_low_s16(c));
+        accR = vmlal_s16(accR, vget_high_s16(s.val[1]), vget_high_s16(c));
+    }
+    int32x2_t sumL = vadd_s32(vget_low_s32(accL), vget_high_s32(accL));
+    int32x2_t sumR = vadd_s32(vget_low_s32(accR), vget_high_s32(accR));
+    const int32x2_t sum = vpadd_s32(sumL, sumR);
+    l = vget_lane_s32(sum, 0);
+    r = vget_lane_s32(sum, 1);
+#elif defined(__SSE2__)
+    // the coefficients are interleaved with zeroes to select one channel
+    const __m128i zero = _mm_setzero_si128();
+    __m128i accL = zero;
+    __m128i accR = zero;
+    for (uint32_t k = 0 ; k < numCoefs ; k += 8) {
+        const __m128i s0 = _mm_loadu_si128(reinterpret_cast<__m128i const*>(x + k*2));
+        const __m128i s1 = _mm_loadu_si128(reinterpret_cast<__m128i const*>(x + k*2 + 8));
+        const __m128i c = _mm_loadu_si128(reinterpret_cast<__m128i const*>(h + k));
+        accL = _mm_add_epi32(accL, _mm_madd_epi16(s0, _mm_unpacklo_epi16(c, zero)));
+        accR = _mm_add_epi32(accR, _mm_madd_epi16(s0, _mm_unpacklo_epi16(zero, c)));
+        accL = _mm_add_epi32(accL, _mm_madd_epi16(s1, _mm_unpackhi_epi16(c, zero)));
+        accR = _mm_add_epi32(accR, _mm_madd_epi16(s1, _mm_unpackhi_epi16(zero, c)));
+    }
+    accL = _mm_add_epi32(accL, _mm_shuffle_epi32(accL, 0x4E));
+    accL = _mm_add_epi32(accL, _mm_shuffle_epi32(accL, 0xB1));
+    accR = _mm_add_epi32(accR, _mm_shuffle_epi32(accR, 0x4E));
+    accR = _mm_add_epi32(accR, _mm_shuffle_epi32(accR, 0xB1));
+    l = _mm_cvtsi128_si32(accL);
+    r = _mm_cvtsi128_si32(accR);
+#else
+    int32_t accL = 0;
+    int32_t accR = 0;
+    for (uint32_t k = 0 ; k < numCoefs ; k++) {
+        accL += int32_t(x[k*2]) * h[k];
+        accR += int32_t(x[k*2 + 1]) * h[k];
+    }
+    l = accL;
+    r = accR;
+#endif
+}
+
+static inline
+int32_t lerp(int32_t a, int32_t b, uint32_t w, int bits)
+{
+    return a + int32_t((int64_t(b - a) * w) >> bits);
+}
+
+// ----------------------------------------------------------------------------
+
+AudioResamplerPolyphase::AudioResamplerPolyphase(int bitDepth,
+        int inChannelCount, int32_t sampleRate, int quality)
+    : AudioResampler(bitDepth, inChannelCount, sampleRate),
+    mBank(0), mExact(true), mPhase(0), mPhaseCount(1), mPhaseStep(1),
+    mRing(0), mRingIndex(0), mPending(0)
+{
+    // the number of taps, the Kaiser window and the passband of each tier;
+    // with 64 taps the stop-band attenuation is about 90dB
+    if (quality == VERY_HIGH_QUALITY) {
+        mHalfNumCoefs = 32;
+        mBeta = 9.0;
+        mBandwidth = 0.91;
+    } else {
+        mHalfNumCoefs = 16;
+        mBeta = 7.0;
+        mBandwidth = 0.85;
+    }
+
+    const size_t ringSize = mHalfNumCoefs * 2 * 2 * inChannelCount;
+    mRing = new int16_t[ringSize];
+    reset();
+}
+
+AudioResamplerPolyphase::~AudioResamplerPolyphase()
+{
+    if (mBank) {
+        releaseBank(mBank);
+    }
+    delete [] mRing;
+}
+
+void AudioResamplerPolyphase::init() {
+}
+
+void AudioResamplerPolyphase::reset()
+{
+    AudioResampler::reset();
+    memset(mRing, 0, mHalfNumCoefs * 2 * 2 * mChannelCount * sizeof(int16_t));
+    mRingIndex = 0;
+    mPhase = 0;
+    // the taps end mHalfNumCoefs frames after the one at the output position
+    mPending = mHalfNumCoefs + 1;
+}
+
+void AudioResamplerPolyphase::setSampleRate(int32_t inSampleRate)
+{
+    if (mBank && inSampleRate == mInSampleRate) {
+        return;
+    }
+
+    // keep the current position between 2 input frames
+    const uint32_t fraction = mExact ?
+            uint32_t((uint64_t(mPhase) << kNumPhaseBits) / mPhaseCount) : mPhaseFraction;
+
+    AudioResampler::setSampleRate(inSampleRate);
+
+    const uint32_t g = gcd(inSampleRate, mSampleRate);
+    const uint32_t outCount = mSampleRate / g;
+    const uint32_t inCount = inSampleRate / g;
+
+    Bank* bank;
+    if (outCount <= kMaxPhases) {
+        mExact = true;
+        mPhaseCount = outCount;
+        mPhaseStep = inCount;
+        mPhase = uint32_t((uint64_t(fraction) * outCount) >> kNumPhaseBits);
+        bank = acquireBank(outCount, false, outCount, inCount);
+    } else {
+        mExact = false;
+        mPhaseFraction = fraction;
+        if (inCount <= outCount) {
+            bank = acquireBank(kGenericPhases, true, 1, 1);
+        } else {
+            // round the cutoff down to 1/32 so that arbitrary ratios
+            // share a few banks
+            uint32_t num = uint32_t((uint64_t(outCount) * 32) / inCount);
+            bank = acquireBank(kGenericPhases, true, num ? num : 1, 32);
+        }
+    }
+
+    if (mBank) {
+        releaseBank(mBank);
+    }
+    mBank = bank;
+}
+
+void AudioResamplerPolyphase::resample(int32_t* out, size_t outFrameCount,
+            AudioBufferProvider* provider)
+{
+    if (mBank == 0) {
+        setSampleRate(mInSampleRate);
+    }
+
+    // select the appropriate resampler
+    switch (mChannelCount) {
+    case 1:
+        resample<1>(out, outFrameCount, provider);
+        break;
+    case 2:
+        resample<2>(out, outFrameCount, provider);
+        break;
+    }
+}
+
+template<int CHANNELS>
+void AudioResamplerPolyphase::resample(int32_t* out, size_t outFrameCount,
+        AudioBufferProvider* provider)
+{
+    const int32_t vl = mVolume[0];
+    const int32_t vr = mVolume[1];
+    const size_t inFrameCount = (outFrameCount*mInSampleRate)/mSampleRate;
+
+    AudioBufferProvider::Buffer& buffer(mBuffer);
+    for (size_t outputIndex = 0 ; outputIndex < outFrameCount ; outputIndex++) {
+        // read the input frames needed by this output frame
+        while (mPending) {
+            if (buffer.frameCount == 0) {
+                buffer.frameCount = inFrameCount > mPending ? inFrameCount : mPending;
+                provider->getNextBuffer(&buffer);
+                if (buffer.raw == NULL) {
+                    return;
+                }
+            }
+            size_t count = buffer.frameCount - mInputIndex;
+            if (count > mPending) {
+                count = mPending;
+            }
+            push<CHANNELS>(buffer.i16 + mInputIndex*CHANNELS, count);
+            mInputIndex += count;
+            mPending -= count;
+            if (mInputIndex >= buffer.frameCount) {
+                provider->releaseBuffer(&buffer);
+                mInputIndex = 0;
+            }
+        }
+
+        int32_t l, r;
+        filter<CHANNELS>(l, r);
+        out[outputIndex*2] += int32_t((int64_t(l) * vl) >> kCoefBits);
+        out[outputIndex*2 + 1] += int32_t((int64_t(r) * vr) >> kCoefBits);
+
+        if (mExact) {
+            mPhase += mPhaseStep;
+            while (mPhase >= mPhaseCount) {
+                mPhase -= mPhaseCount;
+                mPending++;
+            }
+        } else {
+            mPhaseFraction += mPhaseIncrement;
+            mPending += mPhaseFraction >> kNumPhaseBits;
+            mPhaseFraction &= kPhaseMask;
+        }
+    }
+}
+
+template<int CHANNELS>
+void AudioResamplerPolyphase::push(int16_t const* in, size_t frameCount)
+{
+    const uint32_t numCoefs = mHalfNumCoefs * 2;
+    int16_t* ring = mRing;
+    uint32_t index = mRingIndex;
+    for (size_t i = 0 ; i < frameCount ; i++) {
+        ring[index*CHANNELS] = ring[(index + numCoefs)*CHANNELS] = in[i*CHANNELS];
+        if (CHANNELS == 2) {
+            ring[index*2 + 1] = ring[(index + numCoefs)*2 + 1] = in[i*2 + 1];
+        }
+        if (++index == numCoefs) {
+            index = 0;
+        }
+    }
+    mRingIndex = index;
+}
+
+template<int CHANNELS>
+void AudioResamplerPolyphase::filter(int32_t& l, int32_t& r)
+{
+    const uint32_t numCoefs = mHalfNumCoefs * 2;
+    int16_t const* samples = mRing + mRingIndex*CHANNELS;
+    int16_t const* coefs = mBank->coefs;
+
+    if (mExact) {
+        coefs += mPhase * numCoefs;
+        if (CHANNELS == 2) {
+            dotStereo(l, r, samples, coefs, numCoefs);
+        } else {
+            r = l = dotMono(samples, coefs, numCoefs);
+        }
+        return;
+    }
+
+    // interpolate between the 2 nearest phases
+    const uint32_t phase = mPhaseFraction >> (kNumPhaseBits - kGenericPhaseBits);
+    const uint32_t w = (mPhaseFraction >> (kNumPhaseBits - kGenericPhaseBits - kLerpBits)) &
+            ((1 << kLerpBits) - 1);
+    coefs += phase * numCoefs;
+    if (CHANNELS == 2) {
+        int32_t l1, r1;
+        dotStereo(l, r, samples, coefs, numCoefs);
+        dotStereo(l1, r1, samples, coefs + numCoefs, numCoefs);
+        l = lerp(l, l1, w, kLerpBits);
+        r = lerp(r, r1, w, kLerpBits);
+    } else {
+        l = dotMono(samples, coefs, numCoefs);
+        r = l = lerp(l, dotMono(samples, coefs + numCoefs, numCoefs), w, kLerpBits);
+    }
+}
+
+// ----------------------------------------------------------------------------
+}; // namespace android
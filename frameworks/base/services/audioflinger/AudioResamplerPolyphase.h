@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2011 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_AUDIO_RESAMPLER_POLYPHASE_H
+#define ANDROID_AUDIO_RESAMPLER_POLYPHASE_H
+
+#include <stdint.h>
+#include <sys/types.h>
+#include <cutils/log.h>
+#include <utils/threads.h>
+#include <utils/Vector.h>
+
+#include "AudioResampler.h"
+
+namespace android {
+
+// ----------------------------------------------------------------------------
+
+/*
+ * Polyphase FIR resampler. Each output frame is the inner product of the
+ * last input frames with one phase of a windowed sinc filter, so nothing is
+ * interpolated per sample.
+ *
+ * When the ratio reduces to at most kMaxPhases output frames for a whole
+ * number of input frames (44.1KHz->48KHz is 147:160, 22.05KHz->44.1KHz is
+ * 1:2) there is one phase per output position and the resampling is exact.
+ * Other ratios use kGenericPhases phases and interpolate between the results
+ * of the two nearest ones.
+ *
+ * The coefficients are computed when a ratio is first used and shared by
+ * all the resamplers of the process.
+ */
+class AudioResamplerPolyphase : public AudioResampler {
+public:
+    AudioResamplerPolyphase(int bitDepth, int inChannelCount, int32_t sampleRate,
+            int quality);
+
+    ~AudioResamplerPolyphase();
+
+    virtual void setSampleRate(int32_t inSampleRate);
+    virtual void resample(int32_t* out, size_t outFrameCount,
+            AudioBufferProvider* provider);
+    virtual void reset();
+
+private:
+    struct Bank;
+
+    void init();
+
+    Bank* acquireBank(uint32_t phaseCount, bool lerp, uint32_t num, uint32_t den);
+    static void releaseBank(Bank* bank);
+
+    // banks are shared by all the resamplers; a few unused ones are kept
+    // so that tracks coming and going do not recompute them
+    static Mutex sBankLock;
+    static Vector<Bank*> sBanks;
+    static const size_t kMaxUnusedBanks = 4;
+
+    template<int CHANNELS>
+    void resample(int32_t* out, size_t outFrameCount,
+            AudioBufferProvider* provider);
+
+    template<int CHANNELS>
+    inline void push(int16_t const* in, size_t frameCount);
+
+    template<int CHANNELS>
+    inline void filter(int32_t& l, int32_t& r);
+
+    // largest number of phases of an exact ratio
+    static const uint32_t kMaxPhases = 320;
+
+    // number of phases used for the other ratios, must be a power of 2
+    static const int kGenericPhaseBits = 8;
+    static const uint32_t kGenericPhases = 1 << kGenericPhaseBits;
+
+    // bits of the weight of the interpolation between 2 phases
+    static const int kLerpBits = 15;
+
+    // coefficients are in 1.14 fixed point
+    static const int kCoefBits = 14;
+
+    uint32_t mHalfNumCoefs;
+    double mBeta;
+    double mBandwidth;
+
+    Bank* mBank;
+    // exact ratios: mPhase / mPhaseCount is the position between 2 input
+    // frames, it advances by mPhaseStep per output frame
+    bool mExact;
+    uint32_t mPhase;
+    uint32_t mPhaseCount;
+    uint32_t mPhaseStep;
+
+    // the last 2*mHalfNumCoefs frames, stored twice so that they are always
+    // contiguous in memory from mRing + mRingIndex
+    int16_t* mRing;
+    uint32_t mRingIndex;
+    // number of input frames to read before the next output frame
+    size_t mPending;
+};
+
+// ----------------------------------------------------------------------------
+}; // namespace android
+
+#endif /*ANDROID_AUDIO_RESAMPLER_POLYPHASE_H*/
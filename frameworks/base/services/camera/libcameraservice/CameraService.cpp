@@ -367,6 +367,8 @@ CameraService::Client::Client(const sp<CameraService>& cameraService,
     mPreviewCallbackFlag = CAMERA_FRAME_CALLBACK_FLAG_NOOP;
     mOrientation = getOrientation(0, mCameraFacing == CAMERA_FACING_FRONT);
     mPlayShutterSound = true;
+    mPreviewFrameSize = 0;
+    mNextPreviewFrame = 0;
     cameraService->setCameraBusy(cameraId);
     cameraService->loadSound();
     LOG1("Client::Client X (pid %d)", callingPid);
@@ -701,7 +703,7 @@ void CameraService::Client::stopPreview() {
     disableMsgType(CAMERA_MSG_PREVIEW_FRAME);
     mHardware->stopPreview();
 
-    mPreviewBuffer.clear();
+    clearPreviewBuffer();
 }
 
 // stop recording mode
@@ -714,7 +716,7 @@ void CameraService::Client::stopRecording() {
     disableMsgType(CAMERA_MSG_VIDEO_FRAME);
     mHardware->stopRecording();
 
-    mPreviewBuffer.clear();
+    clearPreviewBuffer();
 }
 
 // release a recording frame
@@ -1178,34 +1180,44 @@ void CameraService::Client::copyFrameAndPostCopiedFrame(
     // provided it's big enough. Don't allocate the memory or
     // perform the copy if there's no callback.
     // hold the preview lock while we grab a reference to the preview buffer
-    sp<MemoryHeapBase> previewBuffer;
-
-    if (mPreviewBuffer == 0) {
-        mPreviewBuffer = new MemoryHeapBase(size, 0, NULL);
-    } else if (size > mPreviewBuffer->virtualSize()) {
-        mPreviewBuffer.clear();
-        mPreviewBuffer = new MemoryHeapBase(size, 0, NULL);
-    }
-    if (mPreviewBuffer == 0) {
-        LOGE("failed to allocate space for preview buffer");
-        mLock.unlock();
-        return;
+    if (mPreviewBuffer == 0 || size > mPreviewFrameSize) {
+        clearPreviewBuffer();
+        mPreviewBuffer = new MemoryHeapBase(size * kNumPreviewFrames, 0, NULL);
+        if (mPreviewBuffer->getHeapID() < 0) {
+            LOGE("failed to allocate space for preview buffer");
+            mPreviewBuffer.clear();
+            mLock.unlock();
+            return;
+        }
+        mPreviewFrameSize = size;
     }
-    previewBuffer = mPreviewBuffer;
 
-    memcpy(previewBuffer->base(), (uint8_t *)heap->base() + offset, size);
+    int index = mNextPreviewFrame;
+    mNextPreviewFrame = (mNextPreviewFrame + 1) % kNumPreviewFrames;
 
-    sp<MemoryBase> frame = new MemoryBase(previewBuffer, 0, size);
-    if (frame == 0) {
-        LOGE("failed to allocate space for frame callback");
-        mLock.unlock();
-        return;
+    sp<MemoryBase> frame = mPreviewFrames[index];
+    ssize_t frameOffset = index * mPreviewFrameSize;
+    if (frame == 0 || frame->size() != size) {
+        frame = new MemoryBase(mPreviewBuffer, frameOffset, size);
+        mPreviewFrames[index] = frame;
     }
 
+    memcpy((uint8_t *)mPreviewBuffer->base() + frameOffset,
+            (uint8_t *)heap->base() + offset, size);
+
     mLock.unlock();
     client->dataCallback(msgType, frame, metadata);
 }
 
+void CameraService::Client::clearPreviewBuffer() {
+    for (int i = 0; i < kNumPreviewFrames; i++) {
+        mPreviewFrames[i].clear();
+    }
+    mPreviewBuffer.clear();
+    mPreviewFrameSize = 0;
+    mNextPreviewFrame = 0;
+}
+
 int CameraService::Client::getOrientation(int degrees, bool mirror) {
     if (!mirror) {
         if (degrees == 0) return 0;
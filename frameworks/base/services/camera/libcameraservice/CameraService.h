@@ -27,6 +27,7 @@
 
 namespace android {
 
+class MemoryBase;
 class MemoryHeapBase;
 class MediaPlayer;
 class CameraHardwareInterface;
@@ -192,7 +193,16 @@ private:
 
         // If the user want us to return a copy of the preview frame (instead
         // of the original one), we allocate mPreviewBuffer and reuse it if possible.
+        // It is split in kNumPreviewFrames slots used in turn, so that a frame
+        // is not overwritten while the client is still copying it out, and
+        // the MemoryBase of each slot is kept so no allocation is made per frame.
+        enum { kNumPreviewFrames = 3 };
         sp<MemoryHeapBase>              mPreviewBuffer;
+        sp<MemoryBase>                  mPreviewFrames[kNumPreviewFrames];
+        size_t                          mPreviewFrameSize;
+        int                             mNextPreviewFrame;
+
+        void                    clearPreviewBuffer();
 
         // We need to avoid the deadlock when the incoming command thread and
         // the CameraHardwareInterface callback thread both want to grab mLock.
@@ -118,7 +118,8 @@ EventHub::Device::Device(int fd, int32_t id, const String8& path,
         const InputDeviceIdentifier& identifier) :
         next(NULL),
         fd(fd), id(id), path(path), identifier(identifier),
-        classes(0), configuration(NULL), virtualKeyMap(NULL) {
+        classes(0), configuration(NULL), virtualKeyMap(NULL),
+        eventCount(0), coalescedEventCount(0) {
     memset(keyBitmask, 0, sizeof(keyBitmask));
     memset(absBitmask, 0, sizeof(absBitmask));
     memset(relBitmask, 0, sizeof(relBitmask));
@@ -652,7 +653,16 @@ size_t EventHub::getEvents(int timeoutMillis, RawEvent* buffer, size_t bufferSiz
                 } else {
                     int32_t deviceId = device->id == mBuiltInKeyboardId ? 0 : device->id;
 
+                    // Absolute axis updates only take effect at the end of the report, so
+                    // when the same axis is reported again within a run of absolute axis
+                    // events, the earlier event is updated instead of adding another one.
+                    // The runs are broken by any other event, including SYN_MT_REPORT, and
+                    // by slot and tracking id changes since they delimit the pointers.
+                    RawEvent* firstEvent = event;
+                    RawEvent* absRunStart = event;
+
                     size_t count = size_t(readSize) / sizeof(struct input_event);
+                    device->eventCount += count;
                     for (size_t i = 0; i < count; i++) {
                         const struct input_event& iev = readBuffer[i];
                         LOGV("%s got: t0=%d, t1=%d, type=%d, code=%d, value=%d",
@@ -672,12 +682,27 @@ size_t EventHub::getEvents(int timeoutMillis, RawEvent* buffer, size_t bufferSiz
                         // The systemTime(SYSTEM_TIME_MONOTONIC) function we use everywhere
                         // calls clock_gettime(CLOCK_MONOTONIC) which is implemented as a
                         // system call that also queries ktime_get_ts().
-                        event->when = nsecs_t(iev.time.tv_sec) * 1000000000LL
+                        nsecs_t when = nsecs_t(iev.time.tv_sec) * 1000000000LL
                                 + nsecs_t(iev.time.tv_usec) * 1000LL;
-                        LOGV("event time %lld, now %lld", event->when, now);
+                        LOGV("event time %lld, now %lld", when, now);
 #else
-                        event->when = now;
+                        nsecs_t when = now;
 #endif
+                        if (iev.type == EV_ABS
+                                && iev.code != ABS_MT_SLOT && iev.code != ABS_MT_TRACKING_ID) {
+                            RawEvent* previous = absRunStart;
+                            while (previous != event && previous->scanCode != iev.code) {
+                                previous += 1;
+                            }
+                            if (previous != event) {
+                                previous->when = when;
+                                previous->value = iev.value;
+                                device->coalescedEventCount += 1;
+                                continue;
+                            }
+                        }
+
+                        event->when = when;
                         event->deviceId = deviceId;
                         event->type = iev.type;
                         event->scanCode = iev.code;
@@ -691,8 +716,12 @@ size_t EventHub::getEvents(int timeoutMillis, RawEvent* buffer, size_t bufferSiz
                                     iev.code, event->keyCode, event->flags, err);
                         }
                         event += 1;
+                        if (iev.type != EV_ABS
+                                || iev.code == ABS_MT_SLOT || iev.code == ABS_MT_TRACKING_ID) {
+                            absRunStart = event;
+                        }
                     }
-                    capacity -= count;
+                    capacity -= event - firstEvent;
                     if (capacity == 0) {
                         // The result buffer is full.  Reset the pending event index
                         // so we will try to read the device again on the next iteration.
@@ -1331,6 +1360,8 @@ void EventHub::dump(String8& dump) {
                     device->keyMap.keyCharacterMapFile.string());
             dump.appendFormat(INDENT3 "ConfigurationFile: %s\n",
                     device->configurationFile.string());
+            dump.appendFormat(INDENT3 "Events: read=%u, coalesced=%u\n",
+                    device->eventCount, device->coalescedEventCount);
         }
     } // release lock
 }
@@ -297,6 +297,9 @@ private:
         VirtualKeyMap* virtualKeyMap;
         KeyMap keyMap;
 
+        uint32_t eventCount; // number of events read from the device
+        uint32_t coalescedEventCount; // number of absolute axis events merged into others
+
         Device(int fd, int32_t id, const String8& path, const InputDeviceIdentifier& identifier);
         ~Device();
 
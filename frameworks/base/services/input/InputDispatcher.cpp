@@ -57,6 +57,8 @@
 #include <ui/PowerManager.h>
 
 #include <stddef.h>
+#include <stdlib.h>
+#include <malloc.h>
 #include <unistd.h>
 #include <errno.h>
 #include <limits.h>
@@ -79,6 +81,17 @@ const nsecs_t APP_SWITCH_TIMEOUT = 500 * 1000000LL; // 0.5sec
 // before considering it stale and dropping it.
 const nsecs_t STALE_EVENT_TIMEOUT = 10000 * 1000000LL; // 10sec
 
+// Entry pool slots are aligned on this size so that entries do not share cache lines.
+const size_t ENTRY_POOL_ALIGNMENT = 64;
+
+// Capacity of the entry pools.  Enough for a few windows and monitors receiving a
+// fast touch stream while their consumers are a few frames late.
+const size_t KEY_ENTRY_POOL_CAPACITY = 16;
+const size_t MOTION_ENTRY_POOL_CAPACITY = 32;
+const size_t MOTION_SAMPLE_POOL_CAPACITY = 64;
+const size_t DISPATCH_ENTRY_POOL_CAPACITY = 64;
+const size_t COMMAND_ENTRY_POOL_CAPACITY = 32;
+
 // Motion samples that are received within this amount of time are simply coalesced
 // when batched instead of being appended.  This is done because some drivers update
 // the location of pointers one at a time instead of all at once.
@@ -214,6 +227,7 @@ InputDispatcher::InputDispatcher(const sp<InputDispatcherPolicyInterface>& polic
     mCurrentInputTargetsValid(false),
     mInputTargetWaitCause(INPUT_TARGET_WAIT_CAUSE_NONE) {
     mLooper = new Looper(false);
+    mLooper->setStatisticsEnabled(true);
 
     mKeyRepeatState.lastKeyEntry = NULL;
 
@@ -479,6 +493,7 @@ void InputDispatcher::dispatchIdleLocked() {
 
 bool InputDispatcher::enqueueInboundEventLocked(EventEntry* entry) {
     bool needWake = mInboundQueue.isEmpty();
+    entry->enqueueTime = now();
     mInboundQueue.enqueueAtTail(entry);
 
     switch (entry->type) {
@@ -537,9 +552,10 @@ bool InputDispatcher::enqueueInboundEventLocked(EventEntry* entry) {
 
 sp<InputWindowHandle> InputDispatcher::findTouchedWindowAtLocked(int32_t x, int32_t y) {
     // Traverse windows from front to back to find touched window.
-    size_t numWindows = mWindowHandles.size();
-    for (size_t i = 0; i < numWindows; i++) {
-        sp<InputWindowHandle> windowHandle = mWindowHandles.itemAt(i);
+    const Vector<uint32_t>& candidates = mWindowHitIndex.getCandidates(x, y);
+    size_t numCandidates = candidates.size();
+    for (size_t i = 0; i < numCandidates; i++) {
+        const sp<InputWindowHandle>& windowHandle = mWindowHandles.itemAt(candidates.itemAt(i));
         const InputWindowInfo* windowInfo = windowHandle->getInfo();
         int32_t flags = windowInfo->layoutParamsFlags;
 
@@ -726,6 +742,7 @@ InputDispatcher::KeyEntry* InputDispatcher::synthesizeKeyRepeatLocked(nsecs_t cu
         entry = newEntry;
     }
     entry->syntheticRepeat = true;
+    entry->enqueueTime = currentTime;
 
     // Increment reference count since we keep a reference to the event in
     // mKeyRepeatState.lastKeyEntry in addition to the one we return.
@@ -1333,9 +1350,11 @@ int32_t InputDispatcher::findTouchedWindowTargetsLocked(nsecs_t currentTime,
         bool isTouchModal = false;
 
         // Traverse windows from front to back to find touched window and outside targets.
-        size_t numWindows = mWindowHandles.size();
-        for (size_t i = 0; i < numWindows; i++) {
-            sp<InputWindowHandle> windowHandle = mWindowHandles.itemAt(i);
+        const Vector<uint32_t>& candidates = mWindowHitIndex.getCandidates(x, y);
+        size_t numCandidates = candidates.size();
+        for (size_t i = 0; i < numCandidates; i++) {
+            const sp<InputWindowHandle>& windowHandle =
+                    mWindowHandles.itemAt(candidates.itemAt(i));
             const InputWindowInfo* windowInfo = windowHandle->getInfo();
             int32_t flags = windowInfo->layoutParamsFlags;
 
@@ -1794,13 +1813,18 @@ bool InputDispatcher::checkInjectionPermission(const sp<InputWindowHandle>& wind
 
 bool InputDispatcher::isWindowObscuredAtPointLocked(
         const sp<InputWindowHandle>& windowHandle, int32_t x, int32_t y) const {
-    size_t numWindows = mWindowHandles.size();
-    for (size_t i = 0; i < numWindows; i++) {
-        sp<InputWindowHandle> otherHandle = mWindowHandles.itemAt(i);
-        if (otherHandle == windowHandle) {
+    // Only the windows in front of this one can obscure it.
+    ssize_t windowIndex = mWindowHitIndex.indexOf(windowHandle);
+    const Vector<uint32_t>& candidates = mWindowHitIndex.getCandidates(x, y);
+    size_t numCandidates = candidates.size();
+    for (size_t i = 0; i < numCandidates; i++) {
+        uint32_t otherIndex = candidates.itemAt(i);
+        if (windowIndex >= 0 && otherIndex >= uint32_t(windowIndex)) {
             break;
         }
 
+        const sp<InputWindowHandle>& otherHandle = mWindowHandles.itemAt(otherIndex);
+
         const InputWindowInfo* otherInfo = otherHandle->getInfo();
         if (otherInfo->visible && ! otherInfo->isTrustedOverlay()
                 && otherInfo->frameContainsPoint(x, y)) {
@@ -2054,9 +2078,6 @@ void InputDispatcher::enqueueDispatchEntryLocked(
     DispatchEntry* dispatchEntry = new DispatchEntry(eventEntry, // increments ref
             inputTargetFlags, inputTarget->xOffset, inputTarget->yOffset,
             inputTarget->scaleFactor);
-    if (dispatchEntry->hasForegroundTarget()) {
-        incrementPendingForegroundDispatchesLocked(eventEntry);
-    }
 
     // Handle the case where we could not stream a new motion sample because the consumer has
     // already consumed the motion event (otherwise the corresponding dispatch entry would
@@ -2085,6 +2106,7 @@ void InputDispatcher::enqueueDispatchEntryLocked(
             LOGD("channel '%s' ~ enqueueDispatchEntryLocked: skipping inconsistent key event",
                     connection->getInputChannelName());
 #endif
+            delete dispatchEntry;
             return; // skip the inconsistent event
         }
         break;
@@ -2126,14 +2148,26 @@ void InputDispatcher::enqueueDispatchEntryLocked(
             LOGD("channel '%s' ~ enqueueDispatchEntryLocked: skipping inconsistent motion event",
                     connection->getInputChannelName());
 #endif
+            delete dispatchEntry;
             return; // skip the inconsistent event
         }
         break;
     }
     }
 
+    // Remember that we are waiting for this dispatch to complete.
+    if (dispatchEntry->hasForegroundTarget()) {
+        incrementPendingForegroundDispatchesLocked(eventEntry);
+    }
+
     // Enqueue the dispatch entry.
+    dispatchEntry->deliveryTime = now();
     connection->outboundQueue.enqueueAtTail(dispatchEntry);
+    connection->dispatchEntryCount += 1;
+    connection->outboundQueueLength += 1;
+    if (connection->outboundQueueLength > connection->maxOutboundQueueLength) {
+        connection->maxOutboundQueueLength = connection->outboundQueueLength;
+    }
 }
 
 void InputDispatcher::startDispatchCycleLocked(nsecs_t currentTime,
@@ -2151,6 +2185,7 @@ void InputDispatcher::startDispatchCycleLocked(nsecs_t currentTime,
 
     // Mark the dispatch entry as in progress.
     dispatchEntry->inProgress = true;
+    dispatchEntry->publishTime = currentTime;
 
     // Publish the event.
     status_t status;
@@ -2241,39 +2276,39 @@ void InputDispatcher::startDispatchCycleLocked(nsecs_t currentTime,
                 || dispatchEntry->resolvedAction == AMOTION_EVENT_ACTION_HOVER_MOVE) {
             // Append additional motion samples.
             MotionSample* nextMotionSample = firstMotionSample->next;
-            for (; nextMotionSample != NULL; nextMotionSample = nextMotionSample->next) {
-                if (usingCoords == scaledCoords) {
-                    if (!(dispatchEntry->targetFlags & InputTarget::FLAG_ZERO_COORDS)) {
-                        for (size_t i = 0; i < motionEntry->pointerCount; i++) {
-                            scaledCoords[i] = nextMotionSample->pointerCoords[i];
-                            scaledCoords[i].scale(scaleFactor);
-                        }
-                    }
-                } else {
-                    usingCoords = nextMotionSample->pointerCoords;
-                }
-                status = connection->inputPublisher.appendMotionSample(
-                        nextMotionSample->eventTime, usingCoords);
-                if (status == NO_MEMORY) {
-#if DEBUG_DISPATCH_CYCLE
-                    LOGD("channel '%s' ~ Shared memory buffer full.  Some motion samples will "
-                            "be sent in the next dispatch cycle.",
-                            connection->getInputChannelName());
-#endif
-                    break;
-                }
-                if (status != OK) {
-                    LOGE("channel '%s' ~ Could not append motion sample "
-                            "for a reason other than out of memory, status=%d",
-                            connection->getInputChannelName(), status);
-                    abortBrokenDispatchCycleLocked(currentTime, connection, true /*notify*/);
-                    return;
-                }
+            status = appendMotionSamplesLocked(connection, dispatchEntry, &nextMotionSample);
+            if (status) {
+                abortBrokenDispatchCycleLocked(currentTime, connection, true /*notify*/);
+                return;
             }
 
             // Remember the next motion sample that we could not dispatch, in case we ran out
             // of space in the shared memory buffer.
             dispatchEntry->tailMotionSample = nextMotionSample;
+
+            // Publish the samples of the moves queued behind this one in the same event,
+            // so that a consumer that fell behind gets them all in one dispatch cycle.
+            // The batched entries are in progress and finish along with this one.
+            DispatchEntry* batchedEntry = dispatchEntry;
+            while (!nextMotionSample && batchedEntry->next
+                    && batchedEntry->next->canBatchWith(dispatchEntry)) {
+                batchedEntry = batchedEntry->next;
+                batchedEntry->inProgress = true;
+                batchedEntry->publishTime = currentTime;
+                nextMotionSample = & static_cast<MotionEntry*>(
+                        batchedEntry->eventEntry)->firstSample;
+                status = appendMotionSamplesLocked(connection, batchedEntry, &nextMotionSample);
+                if (status) {
+                    abortBrokenDispatchCycleLocked(currentTime, connection, true /*notify*/);
+                    return;
+                }
+                batchedEntry->tailMotionSample = nextMotionSample;
+                connection->batchedEntryCount += 1;
+#if DEBUG_BATCHING
+                LOGD("channel '%s' ~ Batched the samples of a queued move event.",
+                        connection->getInputChannelName());
+#endif
+            }
         }
         break;
     }
@@ -2295,11 +2330,59 @@ void InputDispatcher::startDispatchCycleLocked(nsecs_t currentTime,
     // Record information about the newly started dispatch cycle.
     connection->lastEventTime = eventEntry->eventTime;
     connection->lastDispatchTime = currentTime;
+    connection->dispatchCycleCount += 1;
 
     // Notify other system components.
     onDispatchCycleStartedLocked(currentTime, connection);
 }
 
+status_t InputDispatcher::appendMotionSamplesLocked(const sp<Connection>& connection,
+        const DispatchEntry* dispatchEntry, MotionSample** inOutMotionSample) {
+    const MotionEntry* motionEntry = static_cast<const MotionEntry*>(dispatchEntry->eventEntry);
+    bool zeroCoords = dispatchEntry->targetFlags & InputTarget::FLAG_ZERO_COORDS;
+    bool scaleCoords = !zeroCoords && (motionEntry->source & AINPUT_SOURCE_CLASS_POINTER)
+            && dispatchEntry->scaleFactor != 1.0f;
+
+    PointerCoords scaledCoords[MAX_POINTERS];
+    if (zeroCoords) {
+        for (size_t i = 0; i < motionEntry->pointerCount; i++) {
+            scaledCoords[i].clear();
+        }
+    }
+
+    MotionSample* nextMotionSample = *inOutMotionSample;
+    for (; nextMotionSample != NULL; nextMotionSample = nextMotionSample->next) {
+        const PointerCoords* usingCoords = nextMotionSample->pointerCoords;
+        if (zeroCoords) {
+            usingCoords = scaledCoords;
+        } else if (scaleCoords) {
+            for (size_t i = 0; i < motionEntry->pointerCount; i++) {
+                scaledCoords[i] = nextMotionSample->pointerCoords[i];
+                scaledCoords[i].scale(dispatchEntry->scaleFactor);
+            }
+            usingCoords = scaledCoords;
+        }
+        status_t status = connection->inputPublisher.appendMotionSample(
+                nextMotionSample->eventTime, usingCoords);
+        if (status == NO_MEMORY) {
+#if DEBUG_DISPATCH_CYCLE
+            LOGD("channel '%s' ~ Shared memory buffer full.  Some motion samples will "
+                    "be sent in the next dispatch cycle.",
+                    connection->getInputChannelName());
+#endif
+            break;
+        }
+        if (status != OK) {
+            LOGE("channel '%s' ~ Could not append motion sample "
+                    "for a reason other than out of memory, status=%d",
+                    connection->getInputChannelName(), status);
+            return status;
+        }
+    }
+    *inOutMotionSample = nextMotionSample;
+    return OK;
+}
+
 void InputDispatcher::finishDispatchCycleLocked(nsecs_t currentTime,
         const sp<Connection>& connection, bool handled) {
 #if DEBUG_DISPATCH_CYCLE
@@ -2316,6 +2399,9 @@ void InputDispatcher::finishDispatchCycleLocked(nsecs_t currentTime,
         return;
     }
 
+    // Account for the latency of the events before the publisher forgets its consume time.
+    trackDispatchLatencyLocked(currentTime, connection);
+
     // Reset the publisher since the event has been consumed.
     // We do this now so that the publisher can release some of its internal resources
     // while waiting for the next dispatch cycle to begin.
@@ -2349,6 +2435,7 @@ void InputDispatcher::startNextDispatchCycleLocked(nsecs_t currentTime,
             }
             // Finished.
             connection->outboundQueue.dequeueAtHead();
+            connection->outboundQueueLength -= 1;
             if (dispatchEntry->hasForegroundTarget()) {
                 decrementPendingForegroundDispatchesLocked(dispatchEntry->eventEntry);
             }
@@ -2391,6 +2478,7 @@ void InputDispatcher::abortBrokenDispatchCycleLocked(nsecs_t currentTime,
 void InputDispatcher::drainOutboundQueueLocked(Connection* connection) {
     while (! connection->outboundQueue.isEmpty()) {
         DispatchEntry* dispatchEntry = connection->outboundQueue.dequeueAtHead();
+        connection->outboundQueueLength -= 1;
         if (dispatchEntry->hasForegroundTarget()) {
             decrementPendingForegroundDispatchesLocked(dispatchEntry->eventEntry);
         }
@@ -3278,6 +3366,8 @@ void InputDispatcher::setInputWindows(const Vector<sp<InputWindowHandle> >& inpu
             }
         }
 
+        mWindowHitIndex.build(mWindowHandles);
+
         if (!foundHoveredWindow) {
             mLastHoverWindowHandle = NULL;
         }
@@ -3598,6 +3688,8 @@ void InputDispatcher::dumpDispatchStateLocked(String8& dump) {
         dump.append(INDENT "Windows: <none>\n");
     }
 
+    mWindowHitIndex.dump(dump);
+
     if (!mMonitoringChannels.isEmpty()) {
         dump.append(INDENT "MonitoringChannels:\n");
         for (size_t i = 0; i < mMonitoringChannels.size(); i++) {
@@ -3615,15 +3707,25 @@ void InputDispatcher::dumpDispatchStateLocked(String8& dump) {
         for (size_t i = 0; i < mActiveConnections.size(); i++) {
             const Connection* connection = mActiveConnections[i];
             dump.appendFormat(INDENT2 "%d: '%s', status=%s, outboundQueueLength=%u, "
-                    "inputState.isNeutral=%s\n",
+                    "maxOutboundQueueLength=%u, dispatchEntries=%u, dispatchCycles=%u, "
+                    "batchedEntries=%u, inputState.isNeutral=%s\n",
                     i, connection->getInputChannelName(), connection->getStatusLabel(),
-                    connection->outboundQueue.count(),
+                    connection->outboundQueueLength, connection->maxOutboundQueueLength,
+                    connection->dispatchEntryCount, connection->dispatchCycleCount,
+                    connection->batchedEntryCount,
                     toString(connection->inputState.isNeutral()));
         }
     } else {
         dump.append(INDENT "ActiveConnections: <none>\n");
     }
 
+    dump.append(INDENT "EntryPools:\n");
+    KeyEntry::sPool.dump(dump);
+    MotionEntry::sPool.dump(dump);
+    MotionSample::sPool.dump(dump);
+    DispatchEntry::sPool.dump(dump);
+    CommandEntry::sPool.dump(dump);
+
     if (isAppSwitchPendingLocked()) {
         dump.appendFormat(INDENT "AppSwitch: pending, due in %01.1fms\n",
                 (mAppSwitchDueTime - now()) / 1000000.0);
@@ -4061,6 +4163,17 @@ void InputDispatcher::updateDispatchStatisticsLocked(nsecs_t currentTime, const
     // TODO Write some statistics about how long we spend waiting.
 }
 
+void InputDispatcher::trackDispatchLatencyLocked(nsecs_t currentTime,
+        const sp<Connection>& connection) {
+    nsecs_t consumeTime = connection->inputPublisher.getConsumeTime();
+
+    // The head entry was published along with the following ones that are in progress.
+    for (DispatchEntry* dispatchEntry = connection->outboundQueue.head;
+            dispatchEntry && dispatchEntry->inProgress; dispatchEntry = dispatchEntry->next) {
+        mLatencyTracker.addSample(dispatchEntry, consumeTime, currentTime);
+    }
+}
+
 void InputDispatcher::dump(String8& dump) {
     AutoMutex _l(mLock);
 
@@ -4071,6 +4184,11 @@ void InputDispatcher::dump(String8& dump) {
     dump.appendFormat(INDENT2 "MaxEventsPerSecond: %d\n", mConfig.maxEventsPerSecond);
     dump.appendFormat(INDENT2 "KeyRepeatDelay: %0.1fms\n", mConfig.keyRepeatDelay * 0.000001f);
     dump.appendFormat(INDENT2 "KeyRepeatTimeout: %0.1fms\n", mConfig.keyRepeatTimeout * 0.000001f);
+
+    mLatencyTracker.dump(dump);
+
+    dump.append(INDENT "Looper:\n");
+    mLooper->dump(dump, INDENT2);
 }
 
 void InputDispatcher::monitor() {
@@ -4092,6 +4210,75 @@ uint32_t InputDispatcher::Queue<T>::count() const {
 }
 
 
+// --- InputDispatcher::EntryPool ---
+
+InputDispatcher::EntryPool::EntryPool(const char* name, size_t objectSize, size_t capacity) :
+        mName(name),
+        mSlotSize((objectSize + ENTRY_POOL_ALIGNMENT - 1) & ~(ENTRY_POOL_ALIGNMENT - 1)),
+        mCapacity(capacity), mSlab(NULL), mFreeList(NULL), mUnusedSlots(0),
+        mInUse(0), mMaxInUse(0), mAllocations(0), mHeapAllocations(0) {
+}
+
+void* InputDispatcher::EntryPool::allocate(size_t size) {
+    AutoMutex _l(mLock);
+
+    void* ptr = NULL;
+    if (size <= mSlotSize) {
+        if (!mSlab) {
+            mSlab = static_cast<char*>(memalign(ENTRY_POOL_ALIGNMENT, mSlotSize * mCapacity));
+            mUnusedSlots = mSlab ? mCapacity : 0;
+        }
+        if (mFreeList) {
+            ptr = mFreeList;
+            mFreeList = mFreeList->next;
+        } else if (mUnusedSlots) {
+            ptr = mSlab + (mCapacity - mUnusedSlots) * mSlotSize;
+            mUnusedSlots -= 1;
+        }
+    }
+    if (!ptr) {
+        ptr = malloc(size);
+        if (!ptr) {
+            LOG_ALWAYS_FATAL("Could not allocate %s", mName);
+        }
+        mHeapAllocations += 1;
+    }
+
+    mAllocations += 1;
+    mInUse += 1;
+    if (mInUse > mMaxInUse) {
+        mMaxInUse = mInUse;
+    }
+    return ptr;
+}
+
+void InputDispatcher::EntryPool::free(void* ptr) {
+    if (!ptr) {
+        return;
+    }
+
+    AutoMutex _l(mLock);
+
+    char* p = static_cast<char*>(ptr);
+    if (mSlab && p >= mSlab && p < mSlab + mSlotSize * mCapacity) {
+        Slot* slot = reinterpret_cast<Slot*>(p);
+        slot->next = mFreeList;
+        mFreeList = slot;
+    } else {
+        ::free(ptr);
+    }
+    mInUse -= 1;
+}
+
+void InputDispatcher::EntryPool::dump(String8& dump) const {
+    AutoMutex _l(mLock);
+
+    dump.appendFormat(INDENT2 "%s: capacity=%u, slotSize=%u, inUse=%u, maxInUse=%u, "
+            "allocations=%u, heapAllocations=%u\n",
+            mName, mCapacity, mSlotSize, mInUse, mMaxInUse, mAllocations, mHeapAllocations);
+}
+
+
 // --- InputDispatcher::InjectionState ---
 
 InputDispatcher::InjectionState::InjectionState(int32_t injectorPid, int32_t injectorUid) :
@@ -4117,8 +4304,8 @@ void InputDispatcher::InjectionState::release() {
 // --- InputDispatcher::EventEntry ---
 
 InputDispatcher::EventEntry::EventEntry(int32_t type, nsecs_t eventTime, uint32_t policyFlags) :
-        refCount(1), type(type), eventTime(eventTime), policyFlags(policyFlags),
-        injectionState(NULL), dispatchInProgress(false) {
+        refCount(1), type(type), eventTime(eventTime), enqueueTime(eventTime),
+        policyFlags(policyFlags), injectionState(NULL), dispatchInProgress(false) {
 }
 
 InputDispatcher::EventEntry::~EventEntry() {
@@ -4165,6 +4352,9 @@ InputDispatcher::DeviceResetEntry::~DeviceResetEntry() {
 
 // --- InputDispatcher::KeyEntry ---
 
+InputDispatcher::EntryPool InputDispatcher::KeyEntry::sPool("KeyEntry",
+        sizeof(InputDispatcher::KeyEntry), KEY_ENTRY_POOL_CAPACITY);
+
 InputDispatcher::KeyEntry::KeyEntry(nsecs_t eventTime,
         int32_t deviceId, uint32_t source, uint32_t policyFlags, int32_t action,
         int32_t flags, int32_t keyCode, int32_t scanCode, int32_t metaState,
@@ -4192,6 +4382,9 @@ void InputDispatcher::KeyEntry::recycle() {
 
 // --- InputDispatcher::MotionSample ---
 
+InputDispatcher::EntryPool InputDispatcher::MotionSample::sPool("MotionSample",
+        sizeof(InputDispatcher::MotionSample), MOTION_SAMPLE_POOL_CAPACITY);
+
 InputDispatcher::MotionSample::MotionSample(nsecs_t eventTime,
         const PointerCoords* pointerCoords, uint32_t pointerCount) :
         next(NULL), eventTime(eventTime), eventTimeBeforeCoalescing(eventTime) {
@@ -4203,6 +4396,9 @@ InputDispatcher::MotionSample::MotionSample(nsecs_t eventTime,
 
 // --- InputDispatcher::MotionEntry ---
 
+InputDispatcher::EntryPool InputDispatcher::MotionEntry::sPool("MotionEntry",
+        sizeof(InputDispatcher::MotionEntry), MOTION_ENTRY_POOL_CAPACITY);
+
 InputDispatcher::MotionEntry::MotionEntry(nsecs_t eventTime,
         int32_t deviceId, uint32_t source, uint32_t policyFlags, int32_t action, int32_t flags,
         int32_t metaState, int32_t buttonState,
@@ -4263,12 +4459,15 @@ void InputDispatcher::MotionEntry::appendSample(
 
 // --- InputDispatcher::DispatchEntry ---
 
+InputDispatcher::EntryPool InputDispatcher::DispatchEntry::sPool("DispatchEntry",
+        sizeof(InputDispatcher::DispatchEntry), DISPATCH_ENTRY_POOL_CAPACITY);
+
 InputDispatcher::DispatchEntry::DispatchEntry(EventEntry* eventEntry,
         int32_t targetFlags, float xOffset, float yOffset, float scaleFactor) :
         eventEntry(eventEntry), targetFlags(targetFlags),
         xOffset(xOffset), yOffset(yOffset), scaleFactor(scaleFactor),
         inProgress(false),
-        resolvedAction(0), resolvedFlags(0),
+        resolvedAction(0), resolvedFlags(0), deliveryTime(0), publishTime(0),
         headMotionSample(NULL), tailMotionSample(NULL) {
     eventEntry->refCount += 1;
 }
@@ -4277,6 +4476,39 @@ InputDispatcher::DispatchEntry::~DispatchEntry() {
     eventEntry->release();
 }
 
+bool InputDispatcher::DispatchEntry::canBatchWith(const DispatchEntry* moveEntry) const {
+    if (inProgress || headMotionSample
+            || eventEntry->type != EventEntry::TYPE_MOTION
+            || resolvedAction != moveEntry->resolvedAction
+            || resolvedFlags != moveEntry->resolvedFlags
+            || targetFlags != moveEntry->targetFlags
+            || xOffset != moveEntry->xOffset
+            || yOffset != moveEntry->yOffset
+            || scaleFactor != moveEntry->scaleFactor) {
+        return false;
+    }
+
+    const MotionEntry* motionEntry = static_cast<const MotionEntry*>(eventEntry);
+    const MotionEntry* moveMotionEntry = static_cast<const MotionEntry*>(moveEntry->eventEntry);
+    if (motionEntry->deviceId != moveMotionEntry->deviceId
+            || motionEntry->source != moveMotionEntry->source
+            || motionEntry->metaState != moveMotionEntry->metaState
+            || motionEntry->buttonState != moveMotionEntry->buttonState
+            || motionEntry->edgeFlags != moveMotionEntry->edgeFlags
+            || motionEntry->xPrecision != moveMotionEntry->xPrecision
+            || motionEntry->yPrecision != moveMotionEntry->yPrecision
+            || motionEntry->downTime != moveMotionEntry->downTime
+            || motionEntry->pointerCount != moveMotionEntry->pointerCount) {
+        return false;
+    }
+    for (uint32_t i = 0; i < motionEntry->pointerCount; i++) {
+        if (motionEntry->pointerProperties[i] != moveMotionEntry->pointerProperties[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
 
 // --- InputDispatcher::InputState ---
 
@@ -4597,7 +4829,9 @@ InputDispatcher::Connection::Connection(const sp<InputChannel>& inputChannel,
         status(STATUS_NORMAL), inputChannel(inputChannel), inputWindowHandle(inputWindowHandle),
         monitor(monitor),
         inputPublisher(inputChannel),
-        lastEventTime(LONG_LONG_MAX), lastDispatchTime(LONG_LONG_MAX) {
+        lastEventTime(LONG_LONG_MAX), lastDispatchTime(LONG_LONG_MAX),
+        outboundQueueLength(0), maxOutboundQueueLength(0), dispatchEntryCount(0),
+        dispatchCycleCount(0), batchedEntryCount(0) {
 }
 
 InputDispatcher::Connection::~Connection() {
@@ -4637,6 +4871,9 @@ InputDispatcher::DispatchEntry* InputDispatcher::Connection::findQueuedDispatchE
 
 // --- InputDispatcher::CommandEntry ---
 
+InputDispatcher::EntryPool InputDispatcher::CommandEntry::sPool("CommandEntry",
+        sizeof(InputDispatcher::CommandEntry), COMMAND_ENTRY_POOL_CAPACITY);
+
 InputDispatcher::CommandEntry::CommandEntry(Command command) :
     command(command), eventTime(0), keyEntry(NULL), userActivityEventType(0), handled(false) {
 }
@@ -4645,6 +4882,220 @@ InputDispatcher::CommandEntry::~CommandEntry() {
 }
 
 
+// --- InputDispatcher::WindowHitIndex ---
+
+InputDispatcher::WindowHitIndex::WindowHitIndex() :
+        mLeft(0), mTop(0), mCellWidth(0), mCellHeight(0) {
+}
+
+void InputDispatcher::WindowHitIndex::build(
+        const Vector<sp<InputWindowHandle> >& windowHandles) {
+    mGlobalCandidates.clear();
+    for (size_t i = 0; i < GRID_SIZE * GRID_SIZE; i++) {
+        mCells[i].clear();
+    }
+    mIndices.clear();
+
+    // Compute the bounds of each window: its frame, which can obscure other windows,
+    // and its touchable region.  Invisible windows cannot be hit.
+    size_t numWindows = windowHandles.size();
+    Vector<SkIRect> bounds;
+    bounds.setCapacity(numWindows);
+    SkIRect gridBounds;
+    gridBounds.setEmpty();
+    for (size_t i = 0; i < numWindows; i++) {
+        const InputWindowInfo* windowInfo = windowHandles.itemAt(i)->getInfo();
+        int32_t flags = windowInfo->layoutParamsFlags;
+        mIndices.add(windowHandles.itemAt(i).get(), i);
+
+        SkIRect rect;
+        rect.setEmpty();
+        if (windowInfo->visible) {
+            // The frame includes its right and bottom edges.
+            SkIRect frame;
+            frame.set(windowInfo->frameLeft, windowInfo->frameTop,
+                    windowInfo->frameRight + 1, windowInfo->frameBottom + 1);
+            rect.join(frame);
+            if (!(flags & InputWindowInfo::FLAG_NOT_TOUCHABLE)) {
+                rect.join(windowInfo->touchableRegion.getBounds());
+            }
+        }
+        gridBounds.join(rect);
+        bounds.push(rect);
+    }
+
+    if (gridBounds.isEmpty()) {
+        mLeft = mTop = mCellWidth = mCellHeight = 0;
+    } else {
+        mLeft = gridBounds.fLeft;
+        mTop = gridBounds.fTop;
+        mCellWidth = (gridBounds.width() + GRID_SIZE - 1) / GRID_SIZE;
+        mCellHeight = (gridBounds.height() + GRID_SIZE - 1) / GRID_SIZE;
+    }
+
+    // Fill the cells in window order so that the candidates are listed front to back.
+    for (size_t i = 0; i < numWindows; i++) {
+        const InputWindowInfo* windowInfo = windowHandles.itemAt(i)->getInfo();
+        int32_t flags = windowInfo->layoutParamsFlags;
+
+        bool global = flags & InputWindowInfo::FLAG_SYSTEM_ERROR;
+        if (windowInfo->visible) {
+            if (!(flags & InputWindowInfo::FLAG_NOT_TOUCHABLE)
+                    && (flags & (InputWindowInfo::FLAG_NOT_FOCUSABLE
+                            | InputWindowInfo::FLAG_NOT_TOUCH_MODAL)) == 0) {
+                global = true;
+            }
+            if (flags & InputWindowInfo::FLAG_WATCH_OUTSIDE_TOUCH) {
+                global = true;
+            }
+        }
+
+        if (global) {
+            mGlobalCandidates.push(i);
+            if (mCellWidth) {
+                for (size_t j = 0; j < GRID_SIZE * GRID_SIZE; j++) {
+                    mCells[j].push(i);
+                }
+            }
+            continue;
+        }
+
+        const SkIRect& rect = bounds.itemAt(i);
+        if (rect.isEmpty()) {
+            continue;
+        }
+        int32_t left = (rect.fLeft - mLeft) / mCellWidth;
+        int32_t top = (rect.fTop - mTop) / mCellHeight;
+        int32_t right = (rect.fRight - 1 - mLeft) / mCellWidth;
+        int32_t bottom = (rect.fBottom - 1 - mTop) / mCellHeight;
+        for (int32_t row = top; row <= bottom; row++) {
+            for (int32_t column = left; column <= right; column++) {
+                mCells[row * GRID_SIZE + column].push(i);
+            }
+        }
+    }
+}
+
+const Vector<uint32_t>& InputDispatcher::WindowHitIndex::getCandidates(
+        int32_t x, int32_t y) const {
+    if (mCellWidth && x >= mLeft && y >= mTop) {
+        int32_t column = (x - mLeft) / mCellWidth;
+        int32_t row = (y - mTop) / mCellHeight;
+        if (column < GRID_SIZE && row < GRID_SIZE) {
+            return mCells[row * GRID_SIZE + column];
+        }
+    }
+    return mGlobalCandidates;
+}
+
+ssize_t InputDispatcher::WindowHitIndex::indexOf(
+        const sp<InputWindowHandle>& windowHandle) const {
+    ssize_t index = mIndices.indexOfKey(windowHandle.get());
+    return index >= 0 ? ssize_t(mIndices.valueAt(index)) : -1;
+}
+
+void InputDispatcher::WindowHitIndex::dump(String8& dump) const {
+    size_t maxCandidates = mGlobalCandidates.size();
+    size_t totalCandidates = 0;
+    for (size_t i = 0; i < GRID_SIZE * GRID_SIZE; i++) {
+        size_t numCandidates = mCells[i].size();
+        totalCandidates += numCandidates;
+        if (numCandidates > maxCandidates) {
+            maxCandidates = numCandidates;
+        }
+    }
+    dump.appendFormat(INDENT "WindowHitIndex: origin=(%d,%d), cellSize=%dx%d, "
+            "globalCandidates=%u, averageCandidates=%0.1f, maxCandidates=%u\n",
+            mLeft, mTop, mCellWidth, mCellHeight, mGlobalCandidates.size(),
+            float(totalCandidates) / (GRID_SIZE * GRID_SIZE), maxCandidates);
+}
+
+
+// --- InputDispatcher::LatencyTracker ---
+
+static const char* const LATENCY_STAGE_LABELS[] = {
+    "Read", "Target", "Queue", "Consume", "Handle", "Total",
+};
+
+static int compareMicros(const void* a, const void* b) {
+    uint32_t lhs = *static_cast<const uint32_t*>(a);
+    uint32_t rhs = *static_cast<const uint32_t*>(b);
+    return lhs < rhs ? -1 : lhs > rhs ? 1 : 0;
+}
+
+static inline uint32_t toLatencyMicros(nsecs_t start, nsecs_t end) {
+    nsecs_t micros = (end - start) / 1000;
+    return micros <= 0 ? 0 : micros >= 0xffffffffLL ? 0xffffffff : uint32_t(micros);
+}
+
+InputDispatcher::LatencyTracker::LatencyTracker() :
+        mSampleCount(0) {
+    memset(mHistogram, 0, sizeof(mHistogram));
+}
+
+size_t InputDispatcher::LatencyTracker::getBucket(uint32_t micros) {
+    size_t bucket = 0;
+    for (uint32_t millis = micros / 1000; millis && bucket < BUCKET_COUNT - 1; millis >>= 1) {
+        bucket += 1;
+    }
+    return bucket;
+}
+
+void InputDispatcher::LatencyTracker::addSample(const DispatchEntry* dispatchEntry,
+        nsecs_t consumeTime, nsecs_t finishTime) {
+    const EventEntry* entry = dispatchEntry->eventEntry;
+    nsecs_t publishTime = dispatchEntry->publishTime;
+    if (consumeTime < publishTime) {
+        // Not consumed by this dispatch cycle, leave the whole time to the application.
+        consumeTime = publishTime;
+    }
+
+    Sample& sample = mSamples[mSampleCount % RING_SIZE];
+    sample.stageMicros[STAGE_READ] = toLatencyMicros(entry->eventTime, entry->enqueueTime);
+    sample.stageMicros[STAGE_TARGET] = toLatencyMicros(entry->enqueueTime,
+            dispatchEntry->deliveryTime);
+    sample.stageMicros[STAGE_QUEUE] = toLatencyMicros(dispatchEntry->deliveryTime, publishTime);
+    sample.stageMicros[STAGE_CONSUME] = toLatencyMicros(publishTime, consumeTime);
+    sample.stageMicros[STAGE_HANDLE] = toLatencyMicros(consumeTime, finishTime);
+    sample.stageMicros[STAGE_TOTAL] = toLatencyMicros(entry->eventTime, finishTime);
+    mSampleCount += 1;
+
+    for (size_t i = 0; i < STAGE_COUNT; i++) {
+        mHistogram[i][getBucket(sample.stageMicros[i])] += 1;
+    }
+}
+
+void InputDispatcher::LatencyTracker::dump(String8& dump) const {
+    if (!mSampleCount) {
+        dump.append(INDENT "Latency: <no samples>\n");
+        return;
+    }
+
+    size_t count = mSampleCount < RING_SIZE ? mSampleCount : RING_SIZE;
+    dump.appendFormat(INDENT "Latency: %u dispatch cycles, percentiles of the last %u\n",
+            mSampleCount, count);
+
+    uint32_t micros[RING_SIZE];
+    for (size_t i = 0; i < STAGE_COUNT; i++) {
+        for (size_t j = 0; j < count; j++) {
+            micros[j] = mSamples[j].stageMicros[i];
+        }
+        qsort(micros, count, sizeof(uint32_t), compareMicros);
+
+        dump.appendFormat(INDENT2 "%s: p50=%0.1fms, p90=%0.1fms, p99=%0.1fms, max=%0.1fms, "
+                "histogram=[",
+                LATENCY_STAGE_LABELS[i],
+                micros[count * 50 / 100] * 0.001f, micros[count * 90 / 100] * 0.001f,
+                micros[count * 99 / 100] * 0.001f, micros[count - 1] * 0.001f);
+        for (size_t j = 0; j < BUCKET_COUNT; j++) {
+            dump.appendFormat(j ? ", %u" : "%u", mHistogram[i][j]);
+        }
+        dump.append("]\n");
+    }
+    dump.append(INDENT2 "Histogram buckets: <1ms, then doubling from 1ms to 1024ms and more\n");
+}
+
+
 // --- InputDispatcher::TouchState ---
 
 InputDispatcher::TouchState::TouchState() :
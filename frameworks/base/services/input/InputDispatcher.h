@@ -406,6 +406,41 @@ private:
         T* prev;
     };
 
+    // A fixed capacity pool of objects of one type.  The objects are carved out of a single
+    // slab of cache line aligned slots that is allocated when the pool is first used, and
+    // recycled through a free list.  The heap is only used once all the slots are taken.
+    //
+    // Each pool is shared by all the dispatchers of the process.  Its lock is not contended
+    // in practice since entries are only allocated and released with the dispatcher lock held.
+    class EntryPool {
+    public:
+        EntryPool(const char* name, size_t objectSize, size_t capacity);
+
+        void* allocate(size_t size);
+        void free(void* ptr);
+
+        void dump(String8& dump) const;
+
+    private:
+        struct Slot {
+            Slot* next;
+        };
+
+        const char* mName;
+        size_t mSlotSize;
+        size_t mCapacity;
+
+        mutable Mutex mLock;
+        char* mSlab;        // NULL until the first allocation
+        Slot* mFreeList;    // released slots
+        size_t mUnusedSlots; // slots at the end of the slab never allocated yet
+
+        size_t mInUse;
+        size_t mMaxInUse;
+        uint32_t mAllocations;
+        uint32_t mHeapAllocations;
+    };
+
     struct InjectionState {
         mutable int32_t refCount;
 
@@ -433,6 +468,7 @@ private:
         mutable int32_t refCount;
         int32_t type;
         nsecs_t eventTime;
+        nsecs_t enqueueTime; // the time when the event was added to the inbound queue
         uint32_t policyFlags;
         InjectionState* injectionState;
 
@@ -492,6 +528,10 @@ private:
                 int32_t repeatCount, nsecs_t downTime);
         void recycle();
 
+        static void* operator new(size_t size) { return sPool.allocate(size); }
+        static void operator delete(void* ptr) { sPool.free(ptr); }
+        static EntryPool sPool;
+
     protected:
         virtual ~KeyEntry();
     };
@@ -505,6 +545,10 @@ private:
 
         MotionSample(nsecs_t eventTime, const PointerCoords* pointerCoords,
                 uint32_t pointerCount);
+
+        static void* operator new(size_t size) { return sPool.allocate(size); }
+        static void operator delete(void* ptr) { sPool.free(ptr); }
+        static EntryPool sPool;
     };
 
     struct MotionEntry : EventEntry {
@@ -540,6 +584,10 @@ private:
 
         void appendSample(nsecs_t eventTime, const PointerCoords* pointerCoords);
 
+        static void* operator new(size_t size) { return sPool.allocate(size); }
+        static void operator delete(void* ptr) { sPool.free(ptr); }
+        static EntryPool sPool;
+
     protected:
         virtual ~MotionEntry();
     };
@@ -559,6 +607,9 @@ private:
         int32_t resolvedAction;
         int32_t resolvedFlags;
 
+        nsecs_t deliveryTime; // the time when the entry was added to the outbound queue
+        nsecs_t publishTime; // the time when the entry was last published
+
         // For motion events:
         //   Pointer to the first motion sample to dispatch in this cycle.
         //   Usually NULL to indicate that the list of motion samples begins at
@@ -583,6 +634,14 @@ private:
         inline bool isSplit() const {
             return targetFlags & InputTarget::FLAG_SPLIT;
         }
+
+        // True if the motion samples of the entry can be published in the same event as
+        // those of the specified in progress move, right after them.
+        bool canBatchWith(const DispatchEntry* moveEntry) const;
+
+        static void* operator new(size_t size) { return sPool.allocate(size); }
+        static void operator delete(void* ptr) { sPool.free(ptr); }
+        static EntryPool sPool;
     };
 
     // A command entry captures state and behavior for an action to be performed in the
@@ -619,6 +678,10 @@ private:
         sp<InputWindowHandle> inputWindowHandle;
         int32_t userActivityEventType;
         bool handled;
+
+        static void* operator new(size_t size) { return sPool.allocate(size); }
+        static void operator delete(void* ptr) { sPool.free(ptr); }
+        static EntryPool sPool;
     };
 
     // Generic queue implementation.
@@ -824,6 +887,13 @@ private:
         nsecs_t lastEventTime; // the time when the event was originally captured
         nsecs_t lastDispatchTime; // the time when the last event was dispatched
 
+        // Statistics, shown by dump().
+        uint32_t outboundQueueLength; // number of entries in the outbound queue
+        uint32_t maxOutboundQueueLength;
+        uint32_t dispatchEntryCount; // number of dispatch entries enqueued so far
+        uint32_t dispatchCycleCount; // number of events published so far
+        uint32_t batchedEntryCount; // number of entries published in the event of another
+
         explicit Connection(const sp<InputChannel>& inputChannel,
                 const sp<InputWindowHandle>& inputWindowHandle, bool monitor);
 
@@ -961,6 +1031,41 @@ private:
 
     Vector<sp<InputWindowHandle> > mWindowHandles;
 
+    // Spatial index of the windows for hit-testing, rebuilt by setInputWindows.
+    // The screen area covered by the windows is divided into a grid and each cell lists,
+    // front to back, the windows that could be hit or obscure another window in the cell.
+    // Windows that can catch a touch anywhere (touch modal, system error and outside touch
+    // watching windows) are listed in every cell, and are the only candidates for the
+    // points outside of the grid.  Callers still test each candidate as they would when
+    // traversing all the windows, so the results are the same.
+    class WindowHitIndex {
+    public:
+        WindowHitIndex();
+
+        void build(const Vector<sp<InputWindowHandle> >& windowHandles);
+
+        // Returns the indices in the window list, front to back, of the candidate windows.
+        const Vector<uint32_t>& getCandidates(int32_t x, int32_t y) const;
+
+        // Returns the index of a window in the window list, or -1 if not found.
+        ssize_t indexOf(const sp<InputWindowHandle>& windowHandle) const;
+
+        void dump(String8& dump) const;
+
+    private:
+        enum { GRID_SIZE = 16 };
+
+        int32_t mLeft;
+        int32_t mTop;
+        int32_t mCellWidth; // 0 if the grid is empty
+        int32_t mCellHeight;
+        Vector<uint32_t> mGlobalCandidates;
+        Vector<uint32_t> mCells[GRID_SIZE * GRID_SIZE];
+        KeyedVector<const InputWindowHandle*, uint32_t> mIndices;
+    };
+
+    WindowHitIndex mWindowHitIndex;
+
     sp<InputWindowHandle> getWindowHandleLocked(const sp<InputChannel>& inputChannel) const;
     bool hasWindowHandleLocked(const sp<InputWindowHandle>& windowHandle) const;
 
@@ -1074,6 +1179,8 @@ private:
             EventEntry* eventEntry, const InputTarget* inputTarget,
             bool resumeWithAppendedMotionSample, int32_t dispatchMode);
     void startDispatchCycleLocked(nsecs_t currentTime, const sp<Connection>& connection);
+    status_t appendMotionSamplesLocked(const sp<Connection>& connection,
+            const DispatchEntry* dispatchEntry, MotionSample** inOutMotionSample);
     void finishDispatchCycleLocked(nsecs_t currentTime, const sp<Connection>& connection,
             bool handled);
     void startNextDispatchCycleLocked(nsecs_t currentTime, const sp<Connection>& connection);
@@ -1135,6 +1242,51 @@ private:
     // Statistics gathering.
     void updateDispatchStatisticsLocked(nsecs_t currentTime, const EventEntry* entry,
             int32_t injectionResult, nsecs_t timeSpentWaitingForApplication);
+
+    // Tracks the time spent by the events in each stage of the input pipeline, from the
+    // kernel timestamp to the finished signal of the application.  A sample is added for
+    // each dispatch cycle.  The last samples are kept in a ring buffer for the percentiles
+    // and a histogram accumulates all of them.
+    class LatencyTracker {
+    public:
+        enum Stage {
+            STAGE_READ,     // kernel timestamp to inbound queue (EventHub and InputReader)
+            STAGE_TARGET,   // inbound queue to outbound queue (finding the targets)
+            STAGE_QUEUE,    // outbound queue to published (waiting for earlier events)
+            STAGE_CONSUME,  // published to consumed by the application
+            STAGE_HANDLE,   // consumed to finished by the application
+            STAGE_TOTAL,    // kernel timestamp to finished
+
+            STAGE_COUNT
+        };
+
+        LatencyTracker();
+
+        void addSample(const DispatchEntry* dispatchEntry, nsecs_t consumeTime,
+                nsecs_t finishTime);
+
+        void dump(String8& dump) const;
+
+    private:
+        // Bucket 0 holds the durations under 1ms, bucket i those from 2^(i-1) to 2^i ms
+        // and the last one everything longer.
+        static const size_t BUCKET_COUNT = 12;
+        static const size_t RING_SIZE = 256;
+
+        struct Sample {
+            uint32_t stageMicros[STAGE_COUNT];
+        };
+
+        Sample mSamples[RING_SIZE];
+        uint32_t mSampleCount;
+        uint32_t mHistogram[STAGE_COUNT][BUCKET_COUNT];
+
+        static size_t getBucket(uint32_t micros);
+    };
+
+    LatencyTracker mLatencyTracker;
+
+    void trackDispatchLatencyLocked(nsecs_t currentTime, const sp<Connection>& connection);
 };
 
 /* Enqueues and dispatches input events, endlessly. */
@@ -401,7 +401,18 @@ void SpriteController::SpriteImpl::setIcon(const SpriteIcon& icon) {
 
     uint32_t dirty;
     if (icon.isValid()) {
+        // Spots and the pointer are often given the icon they already show,
+        // don't copy and redraw the same pixels again.
+        uint32_t generationId = icon.bitmap.getGenerationID();
+        if (generationId != 0 && generationId == mLocked.state.iconGenerationId
+                && mLocked.state.icon.isValid()
+                && mLocked.state.icon.hotSpotX == icon.hotSpotX
+                && mLocked.state.icon.hotSpotY == icon.hotSpotY) {
+            return;
+        }
+
         icon.bitmap.copyTo(&mLocked.state.icon.bitmap, SkBitmap::kARGB_8888_Config);
+        mLocked.state.iconGenerationId = generationId;
 
         if (!mLocked.state.icon.isValid()
                 || mLocked.state.icon.hotSpotX != icon.hotSpotX
@@ -414,6 +425,7 @@ void SpriteController::SpriteImpl::setIcon(const SpriteIcon& icon) {
         }
     } else if (mLocked.state.icon.isValid()) {
         mLocked.state.icon.bitmap.reset();
+        mLocked.state.iconGenerationId = 0;
         dirty = DIRTY_BITMAP | DIRTY_HOTSPOT;
     } else {
         return; // setting to invalid icon and already invalid so nothing to do
@@ -178,7 +178,7 @@ private:
      * Note that the SkBitmap holds a reference to a shared (and immutable) pixel ref. */
     struct SpriteState {
         inline SpriteState() :
-                dirty(0), visible(false),
+                dirty(0), iconGenerationId(0), visible(false),
                 positionX(0), positionY(0), layer(0), alpha(1.0f),
                 surfaceWidth(0), surfaceHeight(0), surfaceDrawn(false), surfaceVisible(false) {
         }
@@ -186,6 +186,8 @@ private:
         uint32_t dirty;
 
         SpriteIcon icon;
+        // generation id of the bitmap the icon was copied from, 0 if unknown
+        uint32_t iconGenerationId;
         bool visible;
         float positionX;
         float positionY;
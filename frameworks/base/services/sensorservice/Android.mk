@@ -24,6 +24,8 @@ LOCAL_SHARED_LIBRARIES := \
 	libui \
 	libgui
 
+LOCAL_STATIC_LIBRARIES := \
+	libcpustats
 
 
 LOCAL_MODULE:= libsensorservice
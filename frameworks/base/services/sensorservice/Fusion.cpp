@@ -387,7 +387,19 @@ void Fusion::predict(const vec3_t& w, float dT) {
     Phi[0][0] = I33 - wx*(k1*ilwe) + wx2*k0;
     Phi[1][0] = wx*k0 - I33dT - wx2*(ilwe*ilwe*ilwe)*(lwedT-k1);
 
-    P = Phi*P*transpose(Phi) + GQGt;
+    // Phi's bottom row is [ 0 I ], so rather than doing the sixteen 3x3
+    // products of the generic block multiply, half of which are by zero
+    // or identity, we expand Phi*P*transpose(Phi) by hand.
+    const mat33_t& Phi00(Phi[0][0]);
+    const mat33_t& Phi10(Phi[1][0]);
+    const mat33_t Phi00t(transpose(Phi00));
+    const mat33_t Phi10t(transpose(Phi10));
+    const mat33_t PhiP00(Phi00*P[0][0] + Phi10*P[0][1]);
+    const mat33_t PhiP10(Phi00*P[1][0] + Phi10*P[1][1]);
+    P[0][0] = PhiP00*Phi00t + PhiP10*Phi10t + GQGt[0][0];
+    P[0][1] = P[0][1]*Phi00t + P[1][1]*Phi10t + GQGt[0][1];
+    P[1][0] = PhiP10 + GQGt[1][0];
+    P[1][1] += GQGt[1][1];
 
     checkState();
 }
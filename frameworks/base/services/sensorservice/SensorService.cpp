@@ -33,6 +33,8 @@
 #include <binder/IServiceManager.h>
 #include <binder/PermissionCache.h>
 
+#include <cpustats/ThreadCpuUsageLogger.h>
+
 #include <gui/ISensorServer.h>
 #include <gui/ISensorEventConnection.h>
 
@@ -58,6 +60,8 @@ namespace android {
  *
  */
 
+// #define DEBUG_CPU_USAGE 10  // log statistics every n wall clock seconds
+
 SensorService::SensorService()
     : mInitCheck(NO_INIT)
 {
@@ -229,6 +233,9 @@ bool SensorService::threadLoop()
     sensors_event_t scratch[numEventMax];
     SensorDevice& device(SensorDevice::getInstance());
     const size_t vcount = mVirtualSensorList.size();
+#ifdef DEBUG_CPU_USAGE
+    ThreadCpuUsageLogger cpu("SensorService", DEBUG_CPU_USAGE);
+#endif
 
     ssize_t count;
     do {
@@ -237,6 +244,9 @@ bool SensorService::threadLoop()
             LOGE("sensor poll failed (%s)", strerror(-count));
             break;
         }
+#ifdef DEBUG_CPU_USAGE
+        cpu.sample();
+#endif
 
         recordLastValue(buffer, count);
 
@@ -479,7 +489,15 @@ status_t SensorService::setEventRate(const sp<SensorEventConnection>& connection
 
     SensorInterface* sensor = mSensorMap.valueFor(handle);
     if (!sensor) return BAD_VALUE;
-    return sensor->setDelay(connection.get(), handle, ns);
+    status_t err = sensor->setDelay(connection.get(), handle, ns);
+    if (err == NO_ERROR) {
+        // the sensor runs at the fastest rate any connection asked for,
+        // other connections get their events decimated to their own rate.
+        // Events of non-continuous sensors are never dropped.
+        connection->setEventPeriod(handle,
+                sensor->getSensor().getMinDelay() ? ns : 0);
+    }
+    return err;
 }
 
 // ---------------------------------------------------------------------------
@@ -530,8 +548,8 @@ void SensorService::SensorEventConnection::onFirstRef()
 
 bool SensorService::SensorEventConnection::addSensor(int32_t handle) {
     Mutex::Autolock _l(mConnectionLock);
-    if (mSensorInfo.indexOf(handle) <= 0) {
-        mSensorInfo.add(handle);
+    if (mSensorInfo.indexOfKey(handle) < 0) {
+        mSensorInfo.add(handle, SensorInfo());
         return true;
     }
     return false;
@@ -539,7 +557,7 @@ bool SensorService::SensorEventConnection::addSensor(int32_t handle) {
 
 bool SensorService::SensorEventConnection::removeSensor(int32_t handle) {
     Mutex::Autolock _l(mConnectionLock);
-    if (mSensorInfo.remove(handle) >= 0) {
+    if (mSensorInfo.removeItem(handle) >= 0) {
         return true;
     }
     return false;
@@ -547,7 +565,7 @@ bool SensorService::SensorEventConnection::removeSensor(int32_t handle) {
 
 bool SensorService::SensorEventConnection::hasSensor(int32_t handle) const {
     Mutex::Autolock _l(mConnectionLock);
-    return mSensorInfo.indexOf(handle) >= 0;
+    return mSensorInfo.indexOfKey(handle) >= 0;
 }
 
 bool SensorService::SensorEventConnection::hasAnySensor() const {
@@ -555,6 +573,38 @@ bool SensorService::SensorEventConnection::hasAnySensor() const {
     return mSensorInfo.size() ? true : false;
 }
 
+void SensorService::SensorEventConnection::setEventPeriod(
+        int32_t handle, nsecs_t ns) {
+    Mutex::Autolock _l(mConnectionLock);
+    ssize_t index = mSensorInfo.indexOfKey(handle);
+    if (index >= 0) {
+        SensorInfo& info(mSensorInfo.editValueAt(index));
+        info.periodNs = ns;
+        info.nextEventNs = 0;
+    }
+}
+
+bool SensorService::SensorEventConnection::SensorInfo::shouldSendEvent(
+        nsecs_t timestamp) {
+    if (periodNs == 0) {
+        return true;
+    }
+    // accept events up to half a period early, so that a sensor running
+    // at about our rate is never decimated because of jitter. Keeping the
+    // schedule rather than restarting it from each event keeps the
+    // average rate at the requested one.
+    if (timestamp < nextEventNs - periodNs/2 &&
+            timestamp >= nextEventNs - 2*periodNs) {
+        return false;
+    }
+    nextEventNs += periodNs;
+    if (nextEventNs <= timestamp || nextEventNs > timestamp + 2*periodNs) {
+        // first event, gap in the stream or time went backward
+        nextEventNs = timestamp + periodNs;
+    }
+    return true;
+}
+
 status_t SensorService::SensorEventConnection::sendEvents(
         sensors_event_t const* buffer, size_t numEvents,
         sensors_event_t* scratch)
@@ -566,9 +616,14 @@ status_t SensorService::SensorEventConnection::sendEvents(
         size_t i=0;
         while (i<numEvents) {
             const int32_t curr = buffer[i].sensor;
-            if (mSensorInfo.indexOf(curr) >= 0) {
+            ssize_t index = mSensorInfo.indexOfKey(curr);
+            if (index >= 0) {
+                SensorInfo& info(mSensorInfo.editValueAt(index));
                 do {
-                    scratch[count++] = buffer[i++];
+                    if (info.shouldSendEvent(buffer[i].timestamp)) {
+                        scratch[count++] = buffer[i];
+                    }
+                    i++;
                 } while ((i<numEvents) && (buffer[i].sensor == curr));
             } else {
                 i++;
@@ -79,8 +79,16 @@ class SensorService :
         sp<SensorChannel> const mChannel;
         mutable Mutex mConnectionLock;
 
+        struct SensorInfo {
+            SensorInfo() : periodNs(0), nextEventNs(0) { }
+            // the rate this connection asked for, 0 if it gets every event
+            nsecs_t periodNs;
+            nsecs_t nextEventNs;
+            bool shouldSendEvent(nsecs_t timestamp);
+        };
+
         // protected by SensorService::mLock
-        SortedVector<int> mSensorInfo;
+        KeyedVector<int32_t, SensorInfo> mSensorInfo;
 
     public:
         SensorEventConnection(const sp<SensorService>& service);
@@ -91,6 +99,7 @@ class SensorService :
         bool hasAnySensor() const;
         bool addSensor(int32_t handle);
         bool removeSensor(int32_t handle);
+        void setEventPeriod(int32_t handle, nsecs_t ns);
     };
 
     class SensorRecord {
@@ -18,6 +18,12 @@
 #include <stdio.h>
 #include <string.h>
 #include <math.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+
+#include <linux/fb.h>
 
 #include <cutils/properties.h>
 
@@ -44,6 +50,10 @@
 
 using namespace android;
 
+#ifndef FBIO_WAITFORVSYNC
+#define FBIO_WAITFORVSYNC   _IOW('F', 0x20, __u32)
+#endif
+
 
 static __attribute__((noinline))
 void checkGLErrors()
@@ -76,7 +86,7 @@ DisplayHardware::DisplayHardware(
         const sp<SurfaceFlinger>& flinger,
         uint32_t dpy)
     : DisplayHardwareBase(flinger, dpy),
-      mFlinger(flinger), mFlags(0), mHwc(0)
+      mFlinger(flinger), mVSyncFd(-1), mFlags(0), mHwc(0)
 {
     init(dpy);
 }
@@ -90,6 +100,7 @@ float DisplayHardware::getDpiX() const          { return mDpiX; }
 float DisplayHardware::getDpiY() const          { return mDpiY; }
 float DisplayHardware::getDensity() const       { return mDensity; }
 float DisplayHardware::getRefreshRate() const   { return mRefreshRate; }
+nsecs_t DisplayHardware::getRefreshPeriod() const { return mRefreshPeriod; }
 int DisplayHardware::getWidth() const           { return mWidth; }
 int DisplayHardware::getHeight() const          { return mHeight; }
 PixelFormat DisplayHardware::getFormat() const  { return mFormat; }
@@ -140,6 +151,13 @@ void DisplayHardware::init(uint32_t dpy)
     mDpiX = mNativeWindow->xdpi;
     mDpiY = mNativeWindow->ydpi;
     mRefreshRate = fbDev->fps;
+    mRefreshPeriod = nsecs_t(1e9 / (mRefreshRate > 0 ? mRefreshRate : 60.0f));
+
+    // the framebuffer HAL doesn't expose vsync, ask the driver directly
+    mVSyncFd = open("/dev/graphics/fb0", O_RDWR);
+    if (mVSyncFd < 0) {
+        mVSyncFd = open("/dev/fb0", O_RDWR);
+    }
 
     EGLint w, h, dummy;
     EGLint numConfigs=0;
@@ -332,6 +350,9 @@ void DisplayHardware::fini()
 {
     eglMakeCurrent(mDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
     eglTerminate(mDisplay);
+    if (mVSyncFd >= 0) {
+        close(mVSyncFd);
+    }
 }
 
 void DisplayHardware::releaseScreen() const
@@ -351,6 +372,18 @@ uint32_t DisplayHardware::getPageFlipCount() const {
     return mPageFlipCount;
 }
 
+status_t DisplayHardware::waitForVSync(nsecs_t* timestamp) const {
+    if (mVSyncFd < 0) {
+        return NO_INIT;
+    }
+    __u32 crtc = 0;
+    if (ioctl(mVSyncFd, FBIO_WAITFORVSYNC, &crtc) < 0) {
+        return -errno;
+    }
+    *timestamp = systemTime();
+    return NO_ERROR;
+}
+
 status_t DisplayHardware::compositionComplete() const {
     return mNativeWindow->compositionComplete();
 }
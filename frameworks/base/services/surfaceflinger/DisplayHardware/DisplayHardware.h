@@ -19,6 +19,8 @@
 
 #include <stdlib.h>
 
+#include <utils/Timers.h>
+
 #include <ui/PixelFormat.h>
 #include <ui/Region.h>
 
@@ -65,6 +67,7 @@ public:
     float       getDpiX() const;
     float       getDpiY() const;
     float       getRefreshRate() const;
+    nsecs_t     getRefreshPeriod() const;
     float       getDensity() const;
     int         getWidth() const;
     int         getHeight() const;
@@ -75,6 +78,11 @@ public:
     uint32_t    getMaxViewportDims() const;
 
     uint32_t getPageFlipCount() const;
+
+    // Blocks until the next vertical sync of the display and returns its
+    // time in the systemTime() base. Fails if the framebuffer driver
+    // doesn't report vsync.
+    status_t waitForVSync(nsecs_t* timestamp) const;
     EGLDisplay getEGLDisplay() const { return mDisplay; }
 
     void dump(String8& res) const;
@@ -104,6 +112,8 @@ private:
     float           mDpiX;
     float           mDpiY;
     float           mRefreshRate;
+    nsecs_t         mRefreshPeriod;
+    int             mVSyncFd;
     float           mDensity;
     int             mWidth;
     int             mHeight;
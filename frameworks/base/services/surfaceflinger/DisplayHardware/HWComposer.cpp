@@ -43,6 +43,7 @@ HWComposer::HWComposer(const sp<SurfaceFlinger>& flinger)
       mNumOVLayers(0), mNumFBLayers(0),
       mDpy(EGL_NO_DISPLAY), mSur(EGL_NO_SURFACE)
 {
+    memset(&mStats, 0, sizeof(mStats));
     int err = hw_get_module(HWC_HARDWARE_MODULE_ID, &mModule);
     LOGW_IF(err, "%s module not found", HWC_HARDWARE_MODULE_ID);
     if (err == 0) {
@@ -97,11 +98,22 @@ status_t HWComposer::createWorkList(size_t numLayers) {
     return NO_ERROR;
 }
 
+static uint64_t visiblePixels(const hwc_layer& l) {
+    uint64_t pixels = 0;
+    for (size_t i=0 ; i<l.visibleRegionScreen.numRects ; i++) {
+        const hwc_rect_t& r(l.visibleRegionScreen.rects[i]);
+        pixels += uint64_t(r.right - r.left) * uint64_t(r.bottom - r.top);
+    }
+    return pixels;
+}
+
 status_t HWComposer::prepare() const {
     int err = mHwc->prepare(mHwc, mList);
     if (err == NO_ERROR) {
         size_t numOVLayers = 0;
         size_t numFBLayers = 0;
+        uint64_t overlayPixels = 0;
+        uint64_t fbPixels = 0;
         size_t count = mList->numHwLayers;
         for (size_t i=0 ; i<count ; i++) {
             hwc_layer& l(mList->hwLayers[i]);
@@ -111,14 +123,30 @@ status_t HWComposer::prepare() const {
             switch (l.compositionType) {
                 case HWC_OVERLAY:
                     numOVLayers++;
+                    overlayPixels += visiblePixels(l);
                     break;
                 case HWC_FRAMEBUFFER:
                     numFBLayers++;
+                    fbPixels += visiblePixels(l);
                     break;
             }
         }
         mNumOVLayers = numOVLayers;
         mNumFBLayers = numFBLayers;
+
+        mStats.frames++;
+        if (mList->flags & HWC_GEOMETRY_CHANGED) {
+            mStats.geometryChanges++;
+        }
+        if (numOVLayers) {
+            if (numFBLayers) {
+                mStats.mixedFrames++;
+            } else {
+                mStats.overlayFrames++;
+            }
+        }
+        mStats.overlayPixels += overlayPixels;
+        mStats.fbPixels += fbPixels;
     }
     return (status_t)err;
 }
@@ -175,6 +203,22 @@ void HWComposer::dump(String8& result, char* buffer, size_t SIZE,
         snprintf(buffer, SIZE, "  numHwLayers=%u, flags=%08x\n",
                 mList->numHwLayers, mList->flags);
         result.append(buffer);
+
+        // GLES composition reads each pixel and writes it to the
+        // framebuffer, which scanout then reads again; an overlay is
+        // only read by scanout. Assume 32 bits per pixel.
+        const Statistics& s(mStats);
+        const uint32_t frames = s.frames ? s.frames : 1;
+        snprintf(buffer, SIZE,
+                "  %u frames: %u overlay only, %u mixed, %u GLES only, "
+                "%u geometry changes\n"
+                "  per frame: %llu overlay pixels, %llu GLES pixels, "
+                "~%llu KB saved by overlays\n",
+                s.frames, s.overlayFrames, s.mixedFrames,
+                s.frames - s.overlayFrames - s.mixedFrames, s.geometryChanges,
+                s.overlayPixels / frames, s.fbPixels / frames,
+                (s.overlayPixels / frames) * 8 / 1024);
+        result.append(buffer);
         result.append(
                 "   type   |  handle  |   hints  |   flags  | tr | blend |  format  |       source crop         |           frame           name \n"
                 "----------+----------+----------+----------+----+-------+----------+---------------------------+--------------------------------\n");
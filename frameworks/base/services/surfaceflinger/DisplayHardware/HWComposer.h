@@ -79,6 +79,16 @@ private:
     static void hook_invalidate(struct hwc_procs* procs);
     void invalidate();
 
+    // composition statistics, updated in prepare()
+    struct Statistics {
+        uint32_t    frames;
+        uint32_t    geometryChanges;    // frames with HWC_GEOMETRY_CHANGED
+        uint32_t    overlayFrames;      // composed by overlays only
+        uint32_t    mixedFrames;        // overlays and GLES
+        uint64_t    overlayPixels;      // visible pixels in overlays
+        uint64_t    fbPixels;           // visible pixels composed by GLES
+    };
+
     sp<SurfaceFlinger>      mFlinger;
     hw_module_t const*      mModule;
     hwc_composer_device_t*  mHwc;
@@ -89,6 +99,7 @@ private:
     hwc_display_t           mDpy;
     hwc_surface_t           mSur;
     cb_context              mCBContext;
+    mutable Statistics      mStats;
 };
 
 
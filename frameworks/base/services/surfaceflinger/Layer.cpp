@@ -80,7 +80,13 @@ void Layer::onFirstRef()
             }
         }
     };
-    mSurfaceTexture = new SurfaceTextureLayer(mTextureName, this);
+    // buffers are recycled among the layers of the same client
+    sp<GraphicBufferAlloc> allocator;
+    sp<Client> client(getClient());
+    if (client != 0) {
+        allocator = client->getGraphicBufferAlloc();
+    }
+    mSurfaceTexture = new SurfaceTextureLayer(mTextureName, this, allocator);
     mSurfaceTexture->setFrameAvailableListener(new FrameQueuedListener(this));
     mSurfaceTexture->setSynchronousMode(true);
     mSurfaceTexture->setBufferCountServer(2);
@@ -469,8 +475,18 @@ void Layer::lockPageFlip(bool& recomputeVisibleRegions)
         // update the layer size and release freeze-lock
         const Layer::State& front(drawingState());
 
-        // FIXME: mPostedDirtyRegion = dirty & bounds
-        mPostedDirtyRegion.set(front.w, front.h);
+        // only the buffer's damage needs to be recomposed, as long as
+        // buffer coordinates are the layer's coordinates
+        const Rect dirty(mSurfaceTexture->getCurrentDirty());
+        if (dirty.isValid() && oldActiveBuffer != NULL &&
+                mCurrentTransform == 0 &&
+                (crop.isEmpty() || crop == Rect(bufWidth, bufHeight)) &&
+                bufWidth == front.w && bufHeight == front.h) {
+            mPostedDirtyRegion.set(dirty);
+            mPostedDirtyRegion.andSelf(Rect(front.w, front.h));
+        } else {
+            mPostedDirtyRegion.set(front.w, front.h);
+        }
 
         if ((front.w != front.requested_w) ||
             (front.h != front.requested_h))
@@ -52,6 +52,8 @@ LayerBase::LayerBase(SurfaceFlinger* flinger, DisplayID display)
 {
     const DisplayHardware& hw(flinger->graphicPlane(0).displayHardware());
     mFlags = hw.getFlags();
+    // no layer is above itself, so this never matches
+    mVisibilityKey.above = this;
 }
 
 LayerBase::~LayerBase()
@@ -262,6 +264,28 @@ void LayerBase::validateVisibility(const Transform& planeTransform)
     mTransformedBounds = tr.makeBounds(w, h);
 }
 
+bool LayerBase::updateVisibilityKey(const LayerBase* above)
+{
+    const Layer::State& s(drawingState());
+    const bool opaque = isOpaque();
+    VisibilityKey& k(mVisibilityKey);
+    const bool changed = (k.above != above) ||
+            (k.sequence != s.sequence) ||
+            (k.bounds != mTransformedBounds) ||
+            (k.orientation != mOrientation) ||
+            (k.planeOrientation != mPlaneOrientation) ||
+            (k.opaque != opaque);
+    if (changed) {
+        k.above = above;
+        k.bounds = mTransformedBounds;
+        k.sequence = s.sequence;
+        k.orientation = mOrientation;
+        k.planeOrientation = mPlaneOrientation;
+        k.opaque = opaque;
+    }
+    return changed;
+}
+
 void LayerBase::lockPageFlip(bool& recomputeVisibleRegions)
 {
 }
@@ -544,6 +568,10 @@ wp<IBinder> LayerBaseClient::getSurfaceBinder() const {
     return mClientSurfaceBinder;
 }
 
+sp<Client> LayerBaseClient::getClient() const {
+    return mClientRef.promote();
+}
+
 wp<IBinder> LayerBaseClient::getSurfaceTextureBinder() const {
     return 0;
 }
@@ -64,6 +64,10 @@ public:
             Region      visibleRegionScreen;
             Region      transparentRegionScreen;
             Region      coveredRegionScreen;
+            // opaque and visible regions of this layer and all the ones
+            // above it, as accumulated by computeVisibleRegions()
+            Region      aboveOpaqueScreen;
+            Region      aboveCoveredScreen;
             int32_t     sequence;
             
             struct State {
@@ -159,6 +163,13 @@ public:
      */
     virtual void validateVisibility(const Transform& globalTransform);
 
+    /**
+     * updateVisibilityKey - records what the visible regions are about
+     * to be computed from, given the layer right above this one, and
+     * returns whether any of it changed since the last call.
+     */
+            bool updateVisibilityKey(const LayerBase* above);
+
     /**
      * lockPageFlip - called each time the screen is redrawn and returns whether
      * the visible regions need to be recomputed (this is a fairly heavy
@@ -259,6 +270,17 @@ protected:
                 Transform       mTransform;
                 GLfloat         mVertices[4][2];
                 Rect            mTransformedBounds;
+
+                // see updateVisibilityKey()
+                struct VisibilityKey {
+                    const LayerBase*    above;
+                    Rect                bounds;
+                    int32_t             sequence;
+                    int32_t             orientation;
+                    int32_t             planeOrientation;
+                    bool                opaque;
+                };
+                VisibilityKey   mVisibilityKey;
             
                 // these are protected by an external lock
                 State           mCurrentState;
@@ -305,6 +327,8 @@ public:
 
     uint32_t getIdentity() const { return mIdentity; }
 
+    sp<Client> getClient() const;
+
 protected:
     virtual void dump(String8& result, char* scratch, size_t size) const;
     virtual void shortDump(String8& result, char* scratch, size_t size) const;
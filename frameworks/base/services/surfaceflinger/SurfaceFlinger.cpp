@@ -17,6 +17,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdint.h>
+#include <string.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <errno.h>
@@ -38,6 +39,7 @@
 #include <utils/String16.h>
 #include <utils/StopWatch.h>
 
+#include <ui/GraphicBuffer.h>
 #include <ui/GraphicBufferAllocator.h>
 #include <ui/GraphicLog.h>
 #include <ui/PixelFormat.h>
@@ -99,6 +101,12 @@ SurfaceFlinger::SurfaceFlinger()
         mDebugInTransaction(0),
         mLastTransactionTime(0),
         mBootFinished(false),
+        mBufferPoolSize(0),
+        mVSyncCompose(true),
+        mVSyncPhaseOffset(0),
+        mHardwareVSync(true),
+        mVSyncRequested(false),
+        mLastVSyncTime(0),
         mConsoleSignals(0),
         mSecureFrameBuffer(0)
 {
@@ -124,9 +132,21 @@ void SurfaceFlinger::init()
         DdmConnection::start(getServiceName());
     }
 
+    // compose once per refresh, debug.sf.vsync_phase microseconds
+    // after the vsync
+    property_get("debug.sf.vsync", value, "1");
+    mVSyncCompose = atoi(value);
+    property_get("debug.sf.vsync_phase", value, "0");
+    mVSyncPhaseOffset = us2ns(atoi(value));
+
+    // how much memory each client may keep in buffers for recycling
+    property_get("debug.sf.buffer_pool_kb", value, "4096");
+    mBufferPoolSize = size_t(atoi(value)) * 1024;
+
     LOGI_IF(mDebugRegion,       "showupdates enabled");
     LOGI_IF(mDebugBackground,   "showbackground enabled");
     LOGI_IF(mDebugDDMS,         "DDMS debugging enabled");
+    LOGI_IF(!mVSyncCompose,     "vsync composition disabled");
 }
 
 SurfaceFlinger::~SurfaceFlinger()
@@ -215,6 +235,40 @@ static inline uint16_t pack565(int r, int g, int b) {
     return (r<<11)|(g<<5)|b;
 }
 
+// Tracks hardware vsync while the main thread is composing, and sleeps
+// when the screen is idle. It exits if the driver can't report vsync, in
+// which case the page-flip times are used as the reference instead.
+class SurfaceFlinger::VSyncThread : public Thread {
+    SurfaceFlinger* const mFlinger;
+public:
+    VSyncThread(SurfaceFlinger* flinger)
+        : Thread(false), mFlinger(flinger) { }
+private:
+    virtual bool threadLoop() {
+        { // scope for the lock
+            Mutex::Autolock _l(mFlinger->mVSyncLock);
+            while (!mFlinger->mVSyncRequested) {
+                mFlinger->mVSyncCondition.wait(mFlinger->mVSyncLock);
+            }
+            mFlinger->mVSyncRequested = false;
+        }
+        const DisplayHardware& hw(mFlinger->graphicPlane(0).displayHardware());
+        nsecs_t timestamp;
+        status_t err = hw.waitForVSync(&timestamp);
+        if (err == -EINTR) {
+            return true;
+        }
+        if (err != NO_ERROR) {
+            LOGW("no hardware vsync (%s), using page-flips instead",
+                    strerror(-err));
+            mFlinger->mHardwareVSync = false;
+            return false;
+        }
+        mFlinger->onVSync(timestamp);
+        return true;
+    }
+};
+
 status_t SurfaceFlinger::readyToRun()
 {
     LOGI(   "SurfaceFlinger's main thread ready to run. "
@@ -263,6 +317,7 @@ status_t SurfaceFlinger::readyToRun()
     dcblk->ydpi         = hw.getDpiY();
     dcblk->fps          = hw.getRefreshRate();
     dcblk->density      = hw.getDensity();
+    dcblk->vsyncPeriod  = hw.getRefreshPeriod();
 
     // Initialize OpenGL|ES
     glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
@@ -301,6 +356,9 @@ status_t SurfaceFlinger::readyToRun()
     // put the origin in the left-bottom corner
     glOrthof(0, w, 0, h, 0, 1); // l=0, r=w ; b=0, t=h
 
+    mVSyncThread = new VSyncThread(this);
+    mVSyncThread->run("VSyncThread", PRIORITY_URGENT_DISPLAY);
+
     mReadyToRunBarrier.open();
 
     /*
@@ -360,6 +418,46 @@ void SurfaceFlinger::waitForEvent()
     }
 }
 
+void SurfaceFlinger::waitForCompositionTime()
+{
+    const DisplayHardware& hw(graphicPlane(0).displayHardware());
+    const nsecs_t period = hw.getRefreshPeriod();
+    nsecs_t phase;
+    {
+        Mutex::Autolock _l(mVSyncLock);
+        // have the vsync thread refresh our reference point
+        mVSyncRequested = true;
+        mVSyncCondition.signal();
+        phase = mLastVSyncTime + mVSyncPhaseOffset;
+    }
+
+    // compose at the first phase point after now, so that everything
+    // posted until then is latched together, once per refresh.
+    nsecs_t now = systemTime();
+    const nsecs_t delta = now - phase;
+    const nsecs_t n = (delta >= 0) ? (delta / period + 1) : -(-delta / period);
+    const nsecs_t when = phase + n * period;
+    while (now < when) {
+        // keep handling messages, further invalidates are folded into
+        // this composition
+        mEventQueue.waitMessage(when - now);
+        now = systemTime();
+    }
+}
+
+void SurfaceFlinger::onVSync(nsecs_t timestamp)
+{
+    Mutex::Autolock _l(mVSyncLock);
+    mLastVSyncTime = timestamp;
+
+    // publish it to clients, see getVSyncTiming()
+    volatile display_cblk_t* dcblk = mServerCblk->displays;
+    const int32_t seq = dcblk->vsyncSequence;
+    android_atomic_acquire_store(seq + 1, &dcblk->vsyncSequence);
+    dcblk->lastVSyncTime = timestamp;
+    android_atomic_release_store(seq + 2, &dcblk->vsyncSequence);
+}
+
 void SurfaceFlinger::signalEvent() {
     mEventQueue.invalidate();
 }
@@ -431,6 +529,10 @@ bool SurfaceFlinger::threadLoop()
 {
     waitForEvent();
 
+    if (LIKELY(mVSyncCompose)) {
+        waitForCompositionTime();
+    }
+
     // check for transactions
     if (UNLIKELY(mConsoleSignals)) {
         handleConsoleEvents();
@@ -477,7 +579,7 @@ bool SurfaceFlinger::threadLoop()
     } else {
         // pretend we did the post
         hw.compositionComplete();
-        usleep(16667); // 60 fps period
+        usleep(ns2us(hw.getRefreshPeriod()));
     }
     return true;
 }
@@ -491,7 +593,13 @@ void SurfaceFlinger::postFramebuffer()
     const nsecs_t now = systemTime();
     mDebugInSwapBuffers = now;
     hw.flip(mSwapRegion);
-    mLastSwapBufferTime = systemTime() - now;
+    const nsecs_t flipTime = systemTime();
+    mLastSwapBufferTime = flipTime - now;
+    if (!mHardwareVSync) {
+        // eglSwapBuffers() on the framebuffer returns at the flip, which
+        // is the best estimate of the vsync we have
+        onVSync(flipTime);
+    }
     mDebugInSwapBuffers = 0;
     mSwapRegion.clear();
 }
@@ -626,7 +734,20 @@ sp<FreezeLock> SurfaceFlinger::getFreezeLock() const
     return new FreezeLock(const_cast<SurfaceFlinger *>(this));
 }
 
-void SurfaceFlinger::computeVisibleRegions(
+static inline bool isSameRegion(const Region& a, const Region& b)
+{
+    if (a.getBounds() != b.getBounds())
+        return false;
+    if (a.isRect() && b.isRect())
+        return true;
+    return a.subtract(b).isEmpty() && b.subtract(a).isEmpty();
+}
+
+/*
+ * Returns whether the geometry of any layer changed, including its visible
+ * region, which means the h/w composer work list must be rebuilt.
+ */
+bool SurfaceFlinger::computeVisibleRegions(
     const LayerVector& currentLayers, Region& dirtyRegion, Region& opaqueRegion)
 {
     const GraphicPlane& plane(graphicPlane(0));
@@ -640,11 +761,36 @@ void SurfaceFlinger::computeVisibleRegions(
 
     bool secureFrameBuffer = false;
 
+    /*
+     * Layers at the top of the stack that haven't changed since the last
+     * pass, and have the same layers above them, end up with the same
+     * visible and covered regions. Skip them and resume from what was
+     * accumulated above the first one that did change.
+     */
+    bool unchanged = true;
+    bool geometryChanged = false;
+    const LayerBase* above = 0;
+
     size_t i = currentLayers.size();
     while (i--) {
         const sp<LayerBase>& layer = currentLayers[i];
         layer->validateVisibility(planeTransform);
 
+        const bool changed = layer->updateVisibilityKey(above);
+        above = layer.get();
+        if (unchanged && !changed && !layer->contentDirty) {
+            aboveOpaqueLayers = layer->aboveOpaqueScreen;
+            aboveCoveredLayers = layer->aboveCoveredScreen;
+            if (layer->isSecure() && !layer->visibleRegionScreen.isEmpty()) {
+                secureFrameBuffer = true;
+            }
+            continue;
+        }
+        unchanged = false;
+        if (changed || layer->contentDirty) {
+            geometryChanged = true;
+        }
+
         // start with the whole surface at its current location
         const Layer::State& s(layer->drawingState());
 
@@ -733,9 +879,16 @@ void SurfaceFlinger::computeVisibleRegions(
         // Update aboveOpaqueLayers for next (lower) layer
         aboveOpaqueLayers.orSelf(opaqueRegion);
 
+        if (!geometryChanged &&
+                !isSameRegion(visibleRegion, layer->visibleRegionScreen)) {
+            geometryChanged = true;
+        }
+
         // Store the visible region is screen space
         layer->setVisibleRegion(visibleRegion);
         layer->setCoveredRegion(coveredRegion);
+        layer->aboveOpaqueScreen = aboveOpaqueLayers;
+        layer->aboveCoveredScreen = aboveCoveredLayers;
 
         // If a secure layer is partially visible, lock-down the screen!
         if (layer->isSecure() && !visibleRegion.isEmpty()) {
@@ -749,6 +902,7 @@ void SurfaceFlinger::computeVisibleRegions(
 
     mSecureFrameBuffer = secureFrameBuffer;
     opaqueRegion = aboveOpaqueLayers;
+    return geometryChanged;
 }
 
 
@@ -769,22 +923,36 @@ void SurfaceFlinger::handlePageFlip()
         const Region screenRegion(hw.bounds());
         if (visibleRegions) {
             Region opaqueRegion;
-            computeVisibleRegions(currentLayers, mDirtyRegion, opaqueRegion);
+            bool geometryChanged = computeVisibleRegions(
+                    currentLayers, mDirtyRegion, opaqueRegion);
 
             /*
              *  rebuild the visible layer list
              */
             const size_t count = currentLayers.size();
+            const Vector< sp<LayerBase> > previous(mVisibleLayersSortedByZ);
             mVisibleLayersSortedByZ.clear();
             mVisibleLayersSortedByZ.setCapacity(count);
             for (size_t i=0 ; i<count ; i++) {
                 if (!currentLayers[i]->visibleRegionScreen.isEmpty())
                     mVisibleLayersSortedByZ.add(currentLayers[i]);
             }
+            if (!geometryChanged) {
+                const size_t n = previous.size();
+                geometryChanged = (n != mVisibleLayersSortedByZ.size());
+                for (size_t i=0 ; !geometryChanged && i<n ; i++) {
+                    geometryChanged = (previous[i] != mVisibleLayersSortedByZ[i]);
+                }
+            }
 
             mWormholeRegion = screenRegion.subtract(opaqueRegion);
             mVisibleRegionsDirty = false;
-            invalidateHwcGeometry();
+
+            // the h/w composer keeps its current plan as long as nothing
+            // it was given changed
+            if (geometryChanged) {
+                invalidateHwcGeometry();
+            }
         }
 
     unlockPageFlip(currentLayers);
@@ -1265,11 +1433,12 @@ void SurfaceFlinger::setTransactionState(const Vector<ComposerState>& state,
         flags |= setClientStateLocked(client, s.state);
     }
     if (flags) {
+        // this wakes up the server if it isn't already about to run a
+        // transaction; states that didn't change anything don't need to
+        // cause a new composition.
         setTransactionFlags(flags);
     }
 
-    signalEvent();
-
     // if there is a transaction with a resize, wait for it to
     // take effect before returning.
     while (mResizeTransationPending) {
@@ -1661,6 +1830,12 @@ status_t SurfaceFlinger::dump(int fd, const Vector<String16>& args)
             result.append(buffer);
         }
 
+        uint32_t permissionHits, permissionMisses;
+        PermissionCache::getStatistics(&permissionHits, &permissionMisses);
+        snprintf(buffer, SIZE, "  permission cache: %u hits, %u misses\n",
+                permissionHits, permissionMisses);
+        result.append(buffer);
+
         /*
          * Dump HWComposer state
          */
@@ -1671,6 +1846,8 @@ status_t SurfaceFlinger::dump(int fd, const Vector<String16>& args)
         result.append(buffer);
         hwc.dump(result, buffer, SIZE, mVisibleLayersSortedByZ);
 
+        GraphicBufferAlloc::dumpStats(result, buffer, SIZE);
+
         /*
          * Dump gralloc state
          */
@@ -2308,6 +2485,133 @@ status_t SurfaceFlinger::turnElectronBeamOn(int32_t mode)
 
 // ---------------------------------------------------------------------------
 
+void SurfaceFlinger::drawScreenshotLayersLocked(const DisplayHardware& hw,
+        uint32_t sw, uint32_t sh, uint32_t minLayerZ, uint32_t maxLayerZ)
+{
+    // invert everything, b/c glReadPixel() below will invert the FB, and
+    // so does reading a buffer the FBO rendered into
+    glViewport(0, 0, sw, sh);
+    glScissor(0, 0, sw, sh);
+    glEnable(GL_SCISSOR_TEST);
+    glMatrixMode(GL_PROJECTION);
+    glPushMatrix();
+    glLoadIdentity();
+    glOrthof(0, hw.getWidth(), hw.getHeight(), 0, 0, 1);
+    glMatrixMode(GL_MODELVIEW);
+
+    // redraw the screen entirely...
+    glClearColor(0,0,0,1);
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    const LayerVector& layers(mDrawingState.layersSortedByZ);
+    const size_t count = layers.size();
+    for (size_t i=0 ; i<count ; ++i) {
+        const sp<LayerBase>& layer(layers[i]);
+        const uint32_t flags = layer->drawingState().flags;
+        if (!(flags & ISurfaceComposer::eLayerHidden)) {
+            const uint32_t z = layer->drawingState().z;
+            if (z >= minLayerZ && z <= maxLayerZ) {
+                layer->drawForSreenShot();
+            }
+        }
+    }
+
+    // XXX: this is needed on tegra
+    glEnable(GL_SCISSOR_TEST);
+    glScissor(0, 0, sw, sh);
+}
+
+void SurfaceFlinger::endScreenshotLocked(const DisplayHardware& hw)
+{
+    glEnable(GL_SCISSOR_TEST);
+    glViewport(0, 0, hw.getWidth(), hw.getHeight());
+    glMatrixMode(GL_PROJECTION);
+    glPopMatrix();
+    glMatrixMode(GL_MODELVIEW);
+}
+
+status_t SurfaceFlinger::captureScreenToBufferLocked(DisplayID dpy,
+        sp<GraphicBuffer>* buffer,
+        uint32_t sw, uint32_t sh,
+        uint32_t minLayerZ, uint32_t maxLayerZ)
+{
+    // only one display supported for now
+    if (UNLIKELY(uint32_t(dpy) >= DISPLAY_COUNT))
+        return BAD_VALUE;
+
+    if (!GLExtensions::getInstance().haveDirectTexture() ||
+            !GLExtensions::getInstance().haveFramebufferObject())
+        return INVALID_OPERATION;
+
+    // get screen geometry
+    const DisplayHardware& hw(graphicPlane(dpy).displayHardware());
+    const uint32_t hw_w = hw.getWidth();
+    const uint32_t hw_h = hw.getHeight();
+
+    if ((sw > hw_w) || (sh > hw_h))
+        return BAD_VALUE;
+
+    sw = (!sw) ? hw_w : sw;
+    sh = (!sh) ? hw_h : sh;
+
+    sp<GraphicBuffer> target(new GraphicBuffer(sw, sh, PIXEL_FORMAT_RGBA_8888,
+            GraphicBuffer::USAGE_HW_RENDER | GraphicBuffer::USAGE_SW_READ_OFTEN));
+    if (target->initCheck() != NO_ERROR)
+        return INVALID_OPERATION;
+
+    const EGLDisplay display(hw.getEGLDisplay());
+    EGLint attrs[] = {
+        EGL_IMAGE_PRESERVED_KHR,    EGL_TRUE,
+        EGL_NONE,
+    };
+    EGLImageKHR image = eglCreateImageKHR(display, EGL_NO_CONTEXT,
+            EGL_NATIVE_BUFFER_ANDROID,
+            (EGLClientBuffer)target->getNativeBuffer(), attrs);
+    if (image == EGL_NO_IMAGE_KHR)
+        return INVALID_OPERATION;
+
+    status_t result = INVALID_OPERATION;
+
+    // make sure to clear all GL error flags
+    while ( glGetError() != GL_NO_ERROR ) ;
+
+    // create a FBO rendering straight into the buffer
+    GLuint name, tname;
+    glGenRenderbuffersOES(1, &tname);
+    glBindRenderbufferOES(GL_RENDERBUFFER_OES, tname);
+    glEGLImageTargetRenderbufferStorageOES(GL_RENDERBUFFER_OES,
+            (GLeglImageOES)image);
+    glGenFramebuffersOES(1, &name);
+    glBindFramebufferOES(GL_FRAMEBUFFER_OES, name);
+    glFramebufferRenderbufferOES(GL_FRAMEBUFFER_OES,
+            GL_COLOR_ATTACHMENT0_OES, GL_RENDERBUFFER_OES, tname);
+
+    GLenum status = glCheckFramebufferStatusOES(GL_FRAMEBUFFER_OES);
+
+    if (status == GL_FRAMEBUFFER_COMPLETE_OES) {
+        drawScreenshotLayersLocked(hw, sw, sh, minLayerZ, maxLayerZ);
+
+        // the pixels are read by the caller, outside of our thread; all
+        // we need here is for the GPU to be done with the buffer.
+        glFinish();
+        if (glGetError() == GL_NO_ERROR) {
+            *buffer = target;
+            result = NO_ERROR;
+        }
+        endScreenshotLocked(hw);
+    }
+
+    // release FBO resources
+    glBindFramebufferOES(GL_FRAMEBUFFER_OES, 0);
+    glDeleteRenderbuffersOES(1, &tname);
+    glDeleteFramebuffersOES(1, &name);
+    eglDestroyImageKHR(display, image);
+
+    hw.compositionComplete();
+
+    return result;
+}
+
 status_t SurfaceFlinger::captureScreenImplLocked(DisplayID dpy,
         sp<IMemoryHeap>* heap,
         uint32_t* w, uint32_t* h, PixelFormat* f,
@@ -2354,37 +2658,7 @@ status_t SurfaceFlinger::captureScreenImplLocked(DisplayID dpy,
     GLenum status = glCheckFramebufferStatusOES(GL_FRAMEBUFFER_OES);
 
     if (status == GL_FRAMEBUFFER_COMPLETE_OES) {
-
-        // invert everything, b/c glReadPixel() below will invert the FB
-        glViewport(0, 0, sw, sh);
-        glScissor(0, 0, sw, sh);
-        glEnable(GL_SCISSOR_TEST);
-        glMatrixMode(GL_PROJECTION);
-        glPushMatrix();
-        glLoadIdentity();
-        glOrthof(0, hw_w, hw_h, 0, 0, 1);
-        glMatrixMode(GL_MODELVIEW);
-
-        // redraw the screen entirely...
-        glClearColor(0,0,0,1);
-        glClear(GL_COLOR_BUFFER_BIT);
-
-        const LayerVector& layers(mDrawingState.layersSortedByZ);
-        const size_t count = layers.size();
-        for (size_t i=0 ; i<count ; ++i) {
-            const sp<LayerBase>& layer(layers[i]);
-            const uint32_t flags = layer->drawingState().flags;
-            if (!(flags & ISurfaceComposer::eLayerHidden)) {
-                const uint32_t z = layer->drawingState().z;
-                if (z >= minLayerZ && z <= maxLayerZ) {
-                    layer->drawForSreenShot();
-                }
-            }
-        }
-
-        // XXX: this is needed on tegra
-        glEnable(GL_SCISSOR_TEST);
-        glScissor(0, 0, sw, sh);
+        drawScreenshotLayersLocked(hw, sw, sh, minLayerZ, maxLayerZ);
 
         // check for errors and return screen capture
         if (glGetError() != GL_NO_ERROR) {
@@ -2410,11 +2684,7 @@ status_t SurfaceFlinger::captureScreenImplLocked(DisplayID dpy,
                 result = NO_MEMORY;
             }
         }
-        glEnable(GL_SCISSOR_TEST);
-        glViewport(0, 0, hw_w, hw_h);
-        glMatrixMode(GL_PROJECTION);
-        glPopMatrix();
-        glMatrixMode(GL_MODELVIEW);
+        endScreenshotLocked(hw);
     } else {
         result = BAD_VALUE;
     }
@@ -2431,6 +2701,44 @@ status_t SurfaceFlinger::captureScreenImplLocked(DisplayID dpy,
     return result;
 }
 
+// Copies a screenshot rendered by captureScreenToBufferLocked() into
+// shared memory, in the same tightly packed layout glReadPixels() produces.
+static status_t copyScreenshot(const sp<GraphicBuffer>& buffer,
+        sp<IMemoryHeap>* heap,
+        uint32_t* width, uint32_t* height, PixelFormat* format)
+{
+    const uint32_t w = buffer->getWidth();
+    const uint32_t h = buffer->getHeight();
+    const size_t bpr = w * 4;
+
+    sp<MemoryHeapBase> base(new MemoryHeapBase(bpr * h, 0, "screen-capture"));
+    uint8_t* const dst = static_cast<uint8_t*>(base->getBase());
+    if (!dst) {
+        return NO_MEMORY;
+    }
+
+    void* vaddr;
+    status_t err = buffer->lock(GraphicBuffer::USAGE_SW_READ_OFTEN, &vaddr);
+    if (err != NO_ERROR) {
+        return err;
+    }
+    const uint8_t* src = static_cast<const uint8_t*>(vaddr);
+    const size_t stride = buffer->getStride() * 4;
+    if (stride == bpr) {
+        memcpy(dst, src, bpr * h);
+    } else {
+        for (uint32_t y=0 ; y<h ; y++) {
+            memcpy(dst + y*bpr, src + y*stride, bpr);
+        }
+    }
+    buffer->unlock();
+
+    *heap = base;
+    *width = w;
+    *height = h;
+    *format = PIXEL_FORMAT_RGBA_8888;
+    return NO_ERROR;
+}
 
 status_t SurfaceFlinger::captureScreen(DisplayID dpy,
         sp<IMemoryHeap>* heap,
@@ -2449,6 +2757,7 @@ status_t SurfaceFlinger::captureScreen(DisplayID dpy,
         SurfaceFlinger* flinger;
         DisplayID dpy;
         sp<IMemoryHeap>* heap;
+        sp<GraphicBuffer>* buffer;
         uint32_t* w;
         uint32_t* h;
         PixelFormat* f;
@@ -2459,11 +2768,12 @@ status_t SurfaceFlinger::captureScreen(DisplayID dpy,
         status_t result;
     public:
         MessageCaptureScreen(SurfaceFlinger* flinger, DisplayID dpy,
-                sp<IMemoryHeap>* heap, uint32_t* w, uint32_t* h, PixelFormat* f,
+                sp<IMemoryHeap>* heap, sp<GraphicBuffer>* buffer,
+                uint32_t* w, uint32_t* h, PixelFormat* f,
                 uint32_t sw, uint32_t sh,
                 uint32_t minLayerZ, uint32_t maxLayerZ)
             : flinger(flinger), dpy(dpy),
-              heap(heap), w(w), h(h), f(f), sw(sw), sh(sh),
+              heap(heap), buffer(buffer), w(w), h(h), f(f), sw(sw), sh(sh),
               minLayerZ(minLayerZ), maxLayerZ(maxLayerZ),
               result(PERMISSION_DENIED)
         {
@@ -2478,19 +2788,30 @@ status_t SurfaceFlinger::captureScreen(DisplayID dpy,
             if (flinger->mSecureFrameBuffer)
                 return true;
 
-            result = flinger->captureScreenImplLocked(dpy,
-                    heap, w, h, f, sw, sh, minLayerZ, maxLayerZ);
+            // render into a buffer the calling thread can read back
+            // itself, so the main thread doesn't wait for glReadPixels()
+            result = flinger->captureScreenToBufferLocked(dpy,
+                    buffer, sw, sh, minLayerZ, maxLayerZ);
+            if (result == INVALID_OPERATION) {
+                result = flinger->captureScreenImplLocked(dpy,
+                        heap, w, h, f, sw, sh, minLayerZ, maxLayerZ);
+            }
 
             return true;
         }
     };
 
+    sp<GraphicBuffer> buffer;
     sp<MessageBase> msg = new MessageCaptureScreen(this,
-            dpy, heap, width, height, format, sw, sh, minLayerZ, maxLayerZ);
+            dpy, heap, &buffer, width, height, format,
+            sw, sh, minLayerZ, maxLayerZ);
     status_t res = postMessageSync(msg);
     if (res == NO_ERROR) {
         res = static_cast<MessageCaptureScreen*>( msg.get() )->getResult();
     }
+    if (res == NO_ERROR && buffer != 0) {
+        res = copyScreenshot(buffer, heap, width, height, format);
+    }
     return res;
 }
 
@@ -2507,7 +2828,9 @@ sp<Layer> SurfaceFlinger::getLayer(const sp<ISurface>& sur) const
 // ---------------------------------------------------------------------------
 
 Client::Client(const sp<SurfaceFlinger>& flinger)
-    : mFlinger(flinger), mNameGenerator(1)
+    : mFlinger(flinger),
+      mGraphicBufferAlloc(new GraphicBufferAlloc(flinger->mBufferPoolSize)),
+      mNameGenerator(1)
 {
 }
 
@@ -2630,14 +2953,47 @@ status_t Client::destroySurface(SurfaceID sid) {
 
 // ---------------------------------------------------------------------------
 
-GraphicBufferAlloc::GraphicBufferAlloc() {}
+volatile int32_t GraphicBufferAlloc::sHits = 0;
+volatile int32_t GraphicBufferAlloc::sMisses = 0;
+
+GraphicBufferAlloc::GraphicBufferAlloc(size_t poolSize)
+    : mPoolSize(poolSize)
+{
+}
 
 GraphicBufferAlloc::~GraphicBufferAlloc() {}
 
+static size_t graphicBufferSize(const sp<GraphicBuffer>& buffer) {
+    ssize_t bpp = bytesPerPixel(buffer->getPixelFormat());
+    if (bpp <= 0) {
+        // YUV and other formats we don't know the size of
+        bpp = 4;
+    }
+    return buffer->getStride() * buffer->getHeight() * bpp;
+}
+
 sp<GraphicBuffer> GraphicBufferAlloc::createGraphicBuffer(uint32_t w, uint32_t h,
         PixelFormat format, uint32_t usage, status_t* error) {
+    if (mPoolSize) {
+        Mutex::Autolock _l(mLock);
+        sp<GraphicBuffer> buffer(recycleBufferLocked(w, h, format, usage));
+        if (buffer != 0) {
+            android_atomic_inc(&sHits);
+            *error = NO_ERROR;
+            return buffer;
+        }
+        android_atomic_inc(&sMisses);
+    }
+
     sp<GraphicBuffer> graphicBuffer(new GraphicBuffer(w, h, format, usage));
     status_t err = graphicBuffer->initCheck();
+    if (err == NO_MEMORY && mPoolSize) {
+        // we're low on memory, give back what we were holding on to
+        // and try again
+        trim();
+        graphicBuffer = new GraphicBuffer(w, h, format, usage);
+        err = graphicBuffer->initCheck();
+    }
     *error = err;
     if (err != 0 || graphicBuffer->handle == 0) {
         if (err == NO_MEMORY) {
@@ -2648,9 +3004,67 @@ sp<GraphicBuffer> GraphicBufferAlloc::createGraphicBuffer(uint32_t w, uint32_t h
                 w, h, strerror(-err), graphicBuffer->handle);
         return 0;
     }
+
+    if (mPoolSize) {
+        Mutex::Autolock _l(mLock);
+        mBuffers.add(graphicBuffer);
+        trimLocked(mPoolSize);
+    }
     return graphicBuffer;
 }
 
+sp<GraphicBuffer> GraphicBufferAlloc::recycleBufferLocked(uint32_t w, uint32_t h,
+        PixelFormat format, uint32_t usage) {
+    const size_t count = mBuffers.size();
+    for (size_t i=0 ; i<count ; i++) {
+        const sp<GraphicBuffer>& buffer(mBuffers[i]);
+        // nobody else can get a new reference to a buffer only we hold
+        if (buffer->getStrongCount() == 1 &&
+                buffer->getWidth() == w && buffer->getHeight() == h &&
+                buffer->getPixelFormat() == format &&
+                buffer->getUsage() == usage) {
+            sp<GraphicBuffer> result(buffer);
+            mBuffers.removeAt(i);
+            mBuffers.add(result);
+            return result;
+        }
+    }
+    return 0;
+}
+
+void GraphicBufferAlloc::trim() {
+    Mutex::Autolock _l(mLock);
+    trimLocked(0);
+}
+
+void GraphicBufferAlloc::trimLocked(size_t poolSize) {
+    size_t unused = 0;
+    const size_t count = mBuffers.size();
+    for (size_t i=0 ; i<count ; i++) {
+        if (mBuffers[i]->getStrongCount() == 1) {
+            unused += graphicBufferSize(mBuffers[i]);
+        }
+    }
+    // free the least recently used buffers first
+    for (size_t i=0 ; i<mBuffers.size() && unused > poolSize ; ) {
+        if (mBuffers[i]->getStrongCount() == 1) {
+            unused -= graphicBufferSize(mBuffers[i]);
+            mBuffers.removeAt(i);
+        } else {
+            i++;
+        }
+    }
+}
+
+void GraphicBufferAlloc::dumpStats(String8& result, char* buffer, size_t SIZE) {
+    const int32_t hits = android_atomic_acquire_load(&sHits);
+    const int32_t misses = android_atomic_acquire_load(&sMisses);
+    const int32_t total = hits + misses;
+    snprintf(buffer, SIZE, "  buffer recycling: %d hits, %d misses (%.1f%% hit rate)\n",
+            hits, misses, total ? (100.0 * hits) / total : 0.0);
+    result.append(buffer);
+}
+
 // ---------------------------------------------------------------------------
 
 GraphicPlane::GraphicPlane()
@@ -47,6 +47,7 @@ namespace android {
 class Client;
 class DisplayHardware;
 class FreezeLock;
+class GraphicBufferAlloc;
 class Layer;
 class LayerDim;
 class LayerScreenshot;
@@ -70,6 +71,11 @@ public:
     void detachLayer(const LayerBaseClient* layer);
     sp<LayerBaseClient> getLayerUser(int32_t i) const;
 
+    // allocates, and recycles, the buffers of this client's layers
+    const sp<GraphicBufferAlloc>& getGraphicBufferAlloc() const {
+        return mGraphicBufferAlloc;
+    }
+
 private:
     // ISurfaceComposerClient interface
     virtual sp<ISurface> createSurface(
@@ -82,6 +88,7 @@ private:
 
     // constant
     sp<SurfaceFlinger> mFlinger;
+    sp<GraphicBufferAlloc> mGraphicBufferAlloc;
 
     // protected by mLock
     DefaultKeyedVector< size_t, wp<LayerBaseClient> > mLayers;
@@ -94,10 +101,37 @@ private:
 class GraphicBufferAlloc : public BnGraphicBufferAlloc
 {
 public:
-    GraphicBufferAlloc();
+    // poolSize is how many bytes of buffers that are no longer used may be
+    // kept around to be handed out again; 0 disables the recycling.
+    // Recycled buffers keep their old content, and only the owner of the
+    // allocator may still have them mapped, so only allocators whose
+    // buffers stay within one client may recycle them.
+    GraphicBufferAlloc(size_t poolSize = 0);
     virtual ~GraphicBufferAlloc();
     virtual sp<GraphicBuffer> createGraphicBuffer(uint32_t w, uint32_t h,
         PixelFormat format, uint32_t usage, status_t* error);
+
+    // frees the unused buffers kept for recycling
+    void trim();
+
+    // statistics of all the recycling allocators
+    static void dumpStats(String8& result, char* buffer, size_t SIZE);
+
+private:
+    sp<GraphicBuffer> recycleBufferLocked(uint32_t w, uint32_t h,
+        PixelFormat format, uint32_t usage);
+    void trimLocked(size_t poolSize);
+
+    const size_t mPoolSize;
+
+    // protected by mLock
+    // the buffers allocated while recycling is enabled, least recently
+    // handed out first. The ones only referenced from here are unused.
+    Vector< sp<GraphicBuffer> > mBuffers;
+    mutable Mutex mLock;
+
+    static volatile int32_t sHits;
+    static volatile int32_t sMisses;
 };
 
 // ---------------------------------------------------------------------------
@@ -288,12 +322,17 @@ public:     // hack to work around gcc 4.0.3 bug
           void              repaintEverything();
 
 private:
+            class VSyncThread;
+            friend class VSyncThread;
+
             void        waitForEvent();
+            void        waitForCompositionTime();
+            void        onVSync(nsecs_t timestamp);
             void        handleConsoleEvents();
             void        handleTransaction(uint32_t transactionFlags);
             void        handleTransactionLocked(uint32_t transactionFlags);
 
-            void        computeVisibleRegions(
+            bool        computeVisibleRegions(
                             const LayerVector& currentLayers,
                             Region& dirtyRegion,
                             Region& wormholeRegion);
@@ -323,6 +362,16 @@ private:
             void        commitTransaction();
 
 
+            void drawScreenshotLayersLocked(const DisplayHardware& hw,
+                    uint32_t width, uint32_t height,
+                    uint32_t minLayerZ, uint32_t maxLayerZ);
+            void endScreenshotLocked(const DisplayHardware& hw);
+
+            status_t captureScreenToBufferLocked(DisplayID dpy,
+                    sp<GraphicBuffer>* buffer,
+                    uint32_t reqWidth, uint32_t reqHeight,
+                    uint32_t minLayerZ, uint32_t maxLayerZ);
+
             status_t captureScreenImplLocked(DisplayID dpy,
                     sp<IMemoryHeap>* heap,
                     uint32_t* width, uint32_t* height, PixelFormat* format,
@@ -408,6 +457,19 @@ private:
                 volatile nsecs_t            mDebugInTransaction;
                 nsecs_t                     mLastTransactionTime;
                 bool                        mBootFinished;
+                size_t                      mBufferPoolSize;
+
+                // vsync-driven composition (debug.sf.vsync, debug.sf.vsync_phase)
+                bool                        mVSyncCompose;
+                nsecs_t                     mVSyncPhaseOffset;
+    volatile    bool                        mHardwareVSync;
+                sp<Thread>                  mVSyncThread;
+
+                // protected by mVSyncLock
+    mutable     Mutex                       mVSyncLock;
+                Condition                   mVSyncCondition;
+                bool                        mVSyncRequested;
+                nsecs_t                     mLastVSyncTime;
 
                 // these are thread safe
     mutable     Barrier                     mReadyToRunBarrier;
@@ -27,8 +27,10 @@ namespace android {
 // ---------------------------------------------------------------------------
 
 
-SurfaceTextureLayer::SurfaceTextureLayer(GLuint tex, const sp<Layer>& layer)
-    : SurfaceTexture(tex), mLayer(layer) {
+SurfaceTextureLayer::SurfaceTextureLayer(GLuint tex, const sp<Layer>& layer,
+        const sp<IGraphicBufferAlloc>& allocator)
+    : SurfaceTexture(tex, true, GL_TEXTURE_EXTERNAL_OES, allocator),
+      mLayer(layer) {
 }
 
 SurfaceTextureLayer::~SurfaceTextureLayer() {
@@ -53,9 +55,10 @@ status_t SurfaceTextureLayer::setBufferCount(int bufferCount) {
 }
 
 status_t SurfaceTextureLayer::queueBuffer(int buf, int64_t timestamp,
+        const Rect& dirty,
         uint32_t* outWidth, uint32_t* outHeight, uint32_t* outTransform) {
 
-    status_t res = SurfaceTexture::queueBuffer(buf, timestamp,
+    status_t res = SurfaceTexture::queueBuffer(buf, timestamp, dirty,
             outWidth, outHeight, outTransform);
     sp<Layer> layer(mLayer.promote());
     if (layer != NULL) {
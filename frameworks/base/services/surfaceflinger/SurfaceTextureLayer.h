@@ -35,7 +35,8 @@ class SurfaceTextureLayer : public SurfaceTexture
     uint32_t mDefaultFormat;
 
 public:
-    SurfaceTextureLayer(GLuint tex, const sp<Layer>& layer);
+    SurfaceTextureLayer(GLuint tex, const sp<Layer>& layer,
+            const sp<IGraphicBufferAlloc>& allocator);
     ~SurfaceTextureLayer();
 
     status_t setDefaultBufferSize(uint32_t w, uint32_t h);
@@ -45,7 +46,7 @@ public:
     virtual status_t setBufferCount(int bufferCount);
 
 protected:
-    virtual status_t queueBuffer(int buf, int64_t timestamp,
+    virtual status_t queueBuffer(int buf, int64_t timestamp, const Rect& dirty,
             uint32_t* outWidth, uint32_t* outHeight, uint32_t* outTransform);
 
     virtual status_t dequeueBuffer(int *buf, uint32_t w, uint32_t h,
@@ -14,6 +14,10 @@
 #include "FileFinder.h"
 #include "CacheUpdater.h"
 
+#include <utils/threads.h>
+
+#include <unistd.h>
+
 #if HAVE_PRINTF_ZD
 #  define ZD "%zd"
 #  define ZD_TYPE ssize_t
@@ -302,6 +306,88 @@ static status_t makeFileResources(Bundle* bundle, const sp<AaptAssets>& assets,
     return hasErrors ? UNKNOWN_ERROR : NO_ERROR;
 }
 
+// Upper bound on the number of threads used to crunch images.
+static const size_t kMaxPreProcessThreads = 8;
+
+// Crunches the images of a resource set on a small pool of threads. Each
+// image is read from its own source file and written to its own AaptFile,
+// so the only state the workers share is the index of the next file.
+class PreProcessImageQueue
+{
+public:
+    PreProcessImageQueue(Bundle* bundle, const sp<AaptAssets>& assets,
+                         const Vector<sp<AaptFile> >& files)
+        : mBundle(bundle), mAssets(assets), mFiles(files), mNext(0),
+          mHasErrors(false)
+    {
+    }
+
+    // Processes one image, returns false once all of them have been taken.
+    bool processNext()
+    {
+        size_t index;
+        {
+            Mutex::Autolock _l(mLock);
+            if (mNext >= mFiles.size()) {
+                return false;
+            }
+            index = mNext++;
+        }
+
+        status_t res = preProcessImage(mBundle, mAssets, mFiles[index], NULL);
+        if (res < NO_ERROR) {
+            Mutex::Autolock _l(mLock);
+            mHasErrors = true;
+        }
+        return true;
+    }
+
+    bool hasErrors() const { return mHasErrors; }
+
+private:
+    Bundle* mBundle;
+    const sp<AaptAssets>& mAssets;
+    const Vector<sp<AaptFile> >& mFiles;
+    Mutex mLock;
+    size_t mNext;
+    bool mHasErrors;
+};
+
+class PreProcessImageThread : public Thread
+{
+public:
+    PreProcessImageThread(PreProcessImageQueue* queue)
+        : Thread(false), mQueue(queue)
+    {
+    }
+
+private:
+    virtual bool threadLoop()
+    {
+        return mQueue->processNext();
+    }
+
+    PreProcessImageQueue* mQueue;
+};
+
+static size_t getPreProcessThreadCount(size_t numFiles)
+{
+    size_t count = 1;
+#ifdef _SC_NPROCESSORS_ONLN
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpus > 1) {
+        count = (size_t)cpus;
+    }
+#endif
+    if (count > kMaxPreProcessThreads) {
+        count = kMaxPreProcessThreads;
+    }
+    if (count > numFiles) {
+        count = numFiles;
+    }
+    return count;
+}
+
 static status_t preProcessImages(Bundle* bundle, const sp<AaptAssets>& assets,
                           const sp<ResourceTypeSet>& set, const char* type)
 {
@@ -309,14 +395,32 @@ static status_t preProcessImages(Bundle* bundle, const sp<AaptAssets>& assets,
     ssize_t res = NO_ERROR;
     if (bundle->getUseCrunchCache() == false) {
         ResourceDirIterator it(set, String8(type));
-        Vector<sp<AaptFile> > newNameFiles;
-        Vector<String8> newNamePaths;
+        Vector<sp<AaptFile> > files;
         while ((res=it.next()) == NO_ERROR) {
-            res = preProcessImage(bundle, assets, it.getFile(), NULL);
-            if (res < NO_ERROR) {
-                hasErrors = true;
+            files.add(it.getFile());
+        }
+
+        PreProcessImageQueue queue(bundle, assets, files);
+        const size_t numThreads = getPreProcessThreadCount(files.size());
+        if (numThreads <= 1) {
+            while (queue.processNext()) {
+            }
+        } else {
+            Vector<sp<Thread> > threads;
+            for (size_t i = 0; i < numThreads; i++) {
+                sp<Thread> thread = new PreProcessImageThread(&queue);
+                if (thread->run("aapt-crunch") == NO_ERROR) {
+                    threads.add(thread);
+                }
+            }
+            // Whatever the threads could not take is done here.
+            while (queue.processNext()) {
+            }
+            for (size_t i = 0; i < threads.size(); i++) {
+                threads[i]->join();
             }
         }
+        hasErrors = queue.hasErrors();
     }
     return (hasErrors || (res < NO_ERROR)) ? UNKNOWN_ERROR : NO_ERROR;
 }
@@ -38,8 +38,10 @@
 #include "SourceInfo.h"
 
 #include <errno.h>
+#include <stdio.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <unistd.h>
 
 #include <new>
 #include <string.h>
@@ -395,20 +397,21 @@ int Script::internalCompile(bool compileOnly) {
 #endif
 
 
-    // Remove the file if it already exists before writing the new file.
-    // The old file may still be mapped elsewhere in memory and we do not want
-    // to modify its contents.  (The same script may be running concurrently in
-    // the same process or a different process!)
-    ::unlink(objPath.c_str());
-#if !USE_OLD_JIT && USE_MCJIT
-    ::unlink(infoPath.c_str());
-#endif
+    // The cache files are written under temporary names and renamed into
+    // place once complete, so that a reader never sees a partially written
+    // file, even if this process dies half way through.  The names include
+    // our pid since the same script may be compiled concurrently in another
+    // process.
+    char suffix[32];
+    snprintf(suffix, sizeof(suffix), ".%d.tmp", (int)getpid());
+    std::string objTmpPath(objPath + suffix);
+    std::string infoTmpPath(infoPath + suffix);
 
     FileHandle objFile;
     FileHandle infoFile;
 
-    if (objFile.open(objPath.c_str(), OpenMode::Write) >= 0 &&
-        infoFile.open(infoPath.c_str(), OpenMode::Write) >= 0) {
+    if (objFile.open(objTmpPath.c_str(), OpenMode::Write) >= 0 &&
+        infoFile.open(infoTmpPath.c_str(), OpenMode::Write) >= 0) {
 
 #if USE_OLD_JIT
       CacheWriter writer;
@@ -437,24 +440,29 @@ int Script::internalCompile(bool compileOnly) {
                                         "__isThreadable");
       }
 
-      if (!writer.writeCacheFile(&objFile, &infoFile, this, libRS_threadable)) {
-        objFile.truncate();
-        objFile.close();
-
-        if (unlink(objPath.c_str()) != 0) {
-          LOGE("Unable to remove the invalid cache file: %s. (reason: %s)\n",
-               objPath.c_str(), strerror(errno));
-        }
-
-        infoFile.truncate();
-        infoFile.close();
-
-        if (unlink(infoPath.c_str()) != 0) {
-          LOGE("Unable to remove the invalid cache file: %s. (reason: %s)\n",
-               infoPath.c_str(), strerror(errno));
-        }
+      bool written =
+        writer.writeCacheFile(&objFile, &infoFile, this, libRS_threadable);
+
+      objFile.close();
+      infoFile.close();
+
+      // Drop the old metadata first: a reader finding the new executable
+      // next to the old metadata must miss instead of loading a mismatch.
+      // The old files may still be mapped elsewhere, renaming over them
+      // leaves those mappings intact.
+      if (written &&
+          (::unlink(infoPath.c_str()) == 0 || errno == ENOENT) &&
+          ::rename(objTmpPath.c_str(), objPath.c_str()) == 0 &&
+          ::rename(infoTmpPath.c_str(), infoPath.c_str()) == 0) {
+        return 0;
       }
+
+      LOGE("Unable to write the cache file: %s. (reason: %s)\n",
+           objPath.c_str(), written ? strerror(errno) : "write failed");
     }
+
+    ::unlink(objTmpPath.c_str());
+    ::unlink(infoTmpPath.c_str());
   }
 #endif // USE_CACHE
 
@@ -270,7 +270,8 @@ public:
     // request to open a direct output with getOutput() (by opposition to sharing an output with other AudioTracks)
     enum output_flags {
         OUTPUT_FLAG_INDIRECT = 0x0,
-        OUTPUT_FLAG_DIRECT = 0x1
+        OUTPUT_FLAG_DIRECT = 0x1,
+        OUTPUT_FLAG_FAST = 0x2
     };
 
     // device categories used for setForceUse()
@@ -19,10 +19,13 @@
 #include "JNIHelp.h"
 #include "JniConstants.h"
 #include "JniException.h"
+#include "ScopedPthreadMutexLock.h"
 #include "ScopedUtfChars.h"
 #include "unicode/ubrk.h"
 #include "unicode/putil.h"
+#include <map>
 #include <stdlib.h>
+#include <string>
 
 /**
  * ICU4C 4.6 doesn't let us update the pointers inside a UBreakIterator to track our char[] as it
@@ -113,13 +116,44 @@ static UBreakIterator* breakIterator(jint address) {
     return BreakIteratorPeer::fromAddress(address)->breakIterator();
 }
 
+// ubrk_open builds a rule-based iterator from the locale's break rules every
+// time, while cloning an existing one is a copy. So we keep one iterator per
+// type and locale, never given any text, and hand out clones of it. The size
+// limit keeps a caller walking every available locale from filling the cache.
+static const size_t MAX_CACHED_ITERATORS = 16;
+static pthread_mutex_t iteratorCacheMutex = PTHREAD_MUTEX_INITIALIZER;
+static std::map<std::pair<int, std::string>, UBreakIterator*> iteratorCache;
+
+static UBreakIterator* openIterator(UBreakIteratorType type, const char* locale, UErrorCode* status) {
+    ScopedPthreadMutexLock lock(&iteratorCacheMutex);
+    std::pair<int, std::string> key(type, locale);
+    std::map<std::pair<int, std::string>, UBreakIterator*>::iterator it = iteratorCache.find(key);
+    if (it == iteratorCache.end()) {
+        if (iteratorCache.size() >= MAX_CACHED_ITERATORS) {
+            return ubrk_open(type, locale, NULL, 0, status);
+        }
+        UBreakIterator* prototype = ubrk_open(type, locale, NULL, 0, status);
+        if (U_FAILURE(*status)) {
+            return prototype;
+        }
+        it = iteratorCache.insert(std::make_pair(key, prototype)).first;
+    }
+    UErrorCode cloneStatus = U_ZERO_ERROR;
+    jint bufferSize = U_BRK_SAFECLONE_BUFFERSIZE;
+    UBreakIterator* result = ubrk_safeClone(it->second, NULL, &bufferSize, &cloneStatus);
+    if (U_FAILURE(cloneStatus)) {
+        *status = cloneStatus;
+    }
+    return result;
+}
+
 static jint makeIterator(JNIEnv* env, jstring locale, UBreakIteratorType type) {
     UErrorCode status = U_ZERO_ERROR;
     const ScopedUtfChars localeChars(env, locale);
     if (localeChars.c_str() == NULL) {
         return 0;
     }
-    UBreakIterator* it = ubrk_open(type, localeChars.c_str(), NULL, 0, &status);
+    UBreakIterator* it = openIterator(type, localeChars.c_str(), &status);
     if (maybeThrowIcuException(env, status)) {
         return 0;
     }
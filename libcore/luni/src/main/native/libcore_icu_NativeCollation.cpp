@@ -12,12 +12,15 @@
 #include "JNIHelp.h"
 #include "JniConstants.h"
 #include "JniException.h"
+#include "ScopedPthreadMutexLock.h"
 #include "ScopedStringChars.h"
 #include "ScopedUtfChars.h"
 #include "UniquePtr.h"
 #include "ucol_imp.h"
 #include "unicode/ucol.h"
 #include "unicode/ucoleitr.h"
+#include <map>
+#include <string>
 
 static UCollator* toCollator(jint address) {
     return reinterpret_cast<UCollator*>(static_cast<uintptr_t>(address));
@@ -110,13 +113,46 @@ static jint NativeCollation_next(JNIEnv* env, jclass, jint address) {
     return result;
 }
 
+// Opening a collator loads and parses the locale's tailoring, which is
+// much more expensive than cloning an open one. So we keep one pristine
+// collator per locale for the life of the process and hand out clones.
+// Only a few locales are ever used, but don't let a caller iterating over
+// every available locale grow this without bound.
+static const size_t MAX_CACHED_COLLATORS = 16;
+static pthread_mutex_t collatorCacheMutex = PTHREAD_MUTEX_INITIALIZER;
+static std::map<std::string, UCollator*> collatorCache;
+
+static UCollator* openCollator(const char* localeName, UErrorCode* status) {
+    ScopedPthreadMutexLock lock(&collatorCacheMutex);
+    std::map<std::string, UCollator*>::iterator it = collatorCache.find(localeName);
+    if (it == collatorCache.end()) {
+        if (collatorCache.size() >= MAX_CACHED_COLLATORS) {
+            return ucol_open(localeName, status);
+        }
+        UCollator* c = ucol_open(localeName, status);
+        if (U_FAILURE(*status)) {
+            return c;
+        }
+        it = collatorCache.insert(std::make_pair(std::string(localeName), c)).first;
+    }
+    // The clone is only ever handed out, so a fallback warning from the
+    // original ucol_open is of no interest to the caller.
+    UErrorCode cloneStatus = U_ZERO_ERROR;
+    jint bufferSize = U_COL_SAFECLONE_BUFFERSIZE;
+    UCollator* c = ucol_safeClone(it->second, NULL, &bufferSize, &cloneStatus);
+    if (U_FAILURE(cloneStatus)) {
+        *status = cloneStatus;
+    }
+    return c;
+}
+
 static jint NativeCollation_openCollator(JNIEnv* env, jclass, jstring localeName) {
     ScopedUtfChars localeChars(env, localeName);
     if (localeChars.c_str() == NULL) {
         return 0;
     }
     UErrorCode status = U_ZERO_ERROR;
-    UCollator* c = ucol_open(localeChars.c_str(), &status);
+    UCollator* c = openCollator(localeChars.c_str(), &status);
     maybeThrowIcuException(env, status);
     return static_cast<jint>(reinterpret_cast<uintptr_t>(c));
 }
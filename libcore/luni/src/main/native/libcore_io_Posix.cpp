@@ -53,6 +53,8 @@
 #include <sys/vfs.h> // Bionic doesn't have <sys/statvfs.h>
 #include <sys/wait.h>
 #include <unistd.h>
+#include <algorithm>
+#include <vector>
 
 #define TO_JAVA_STRING(NAME, EXP) \
         jstring NAME = env->NewStringUTF(EXP); \
@@ -158,10 +160,26 @@ static rc_t throwIfMinusOne(JNIEnv* env, const char* name, rc_t rc) {
     return rc;
 }
 
+// The kernel rejects readv/writev calls with more than this many buffers.
+static size_t getIovMax() {
+    static size_t iovMax = 0;
+    if (iovMax == 0) {
+        long limit = sysconf(_SC_IOV_MAX);
+        iovMax = (limit > 0) ? limit : 1024;
+    }
+    return iovMax;
+}
+
 template <typename ScopedT>
 class IoVec {
 public:
-    IoVec(JNIEnv* env, size_t bufferCount) : mEnv(env), mBufferCount(bufferCount) {
+    // Scatter/gather I/O is allowed to transfer fewer bytes than asked for, so
+    // rather than failing with EINVAL we only hand the first IOV_MAX buffers to
+    // the kernel and let the caller come back for the rest.
+    IoVec(JNIEnv* env, size_t bufferCount)
+    : mEnv(env), mBufferCount(std::min(bufferCount, getIovMax())) {
+        mIoVec.reserve(mBufferCount);
+        mScopedBuffers.reserve(mBufferCount);
     }
 
     bool init(jobjectArray javaBuffers, jintArray javaOffsets, jintArray javaByteCounts) {
@@ -177,8 +195,6 @@ public:
         if (byteCounts.get() == NULL) {
             return false;
         }
-        // TODO: Linux actually has a 1024 buffer limit. glibc works around this, and we should too.
-        // TODO: you can query the limit at runtime with sysconf(_SC_IOV_MAX).
         for (size_t i = 0; i < mBufferCount; ++i) {
             jobject buffer = mEnv->GetObjectArrayElement(javaBuffers, i); // We keep this local ref.
             mScopedBuffers.push_back(new ScopedT(mEnv, buffer));
@@ -31,6 +31,7 @@
 
 #include <string.h>
 #include <expat.h>
+#include <string>
 
 #define BUCKET_COUNT 128
 
@@ -170,6 +171,9 @@ public:
     /** Buffer for text events. */
     jcharArray buffer;
 
+    /** UTF-8 text received from Expat but not yet passed to Java. */
+    std::string pendingText;
+
 private:
     /** The size of our buffer in jchars. */
     int bufferSize;
@@ -457,6 +461,22 @@ static void bufferAndInvoke(jmethodID method, void* data, const char* text, size
     env->CallVoidMethod(javaParser, method, buffer, utf16length);
 }
 
+/**
+ * Passes the text collected by text() to the Java parser. Expat delivers
+ * character data in many small pieces, splitting it at every line break and
+ * entity reference, so consecutive pieces are joined and sent up in one JNI
+ * call. Every other handler calls this first to keep the events in order.
+ *
+ * @param parsingContext the context holding the pending text
+ */
+static void flushText(ParsingContext* parsingContext) {
+    std::string& pendingText = parsingContext->pendingText;
+    if (pendingText.empty()) return;
+
+    bufferAndInvoke(textMethod, parsingContext, pendingText.data(), pendingText.size());
+    pendingText.clear();
+}
+
 static const char** toAttributes(jint attributePointer) {
     return reinterpret_cast<const char**>(static_cast<uintptr_t>(attributePointer));
 }
@@ -597,6 +617,7 @@ private:
  */
 static void startElement(void* data, const char* elementName, const char** attributes) {
     ParsingContext* parsingContext = toParsingContext(data);
+    flushText(parsingContext);
     JNIEnv* env = parsingContext->env;
 
     // Bail out if a previously called handler threw an exception.
@@ -637,6 +658,7 @@ static void startElement(void* data, const char* elementName, const char** attri
  */
 static void endElement(void* data, const char* /*elementName*/) {
     ParsingContext* parsingContext = toParsingContext(data);
+    flushText(parsingContext);
     JNIEnv* env = parsingContext->env;
 
     // Bail out if a previously called handler threw an exception.
@@ -652,16 +674,17 @@ static void endElement(void* data, const char* /*elementName*/) {
 }
 
 /**
- * Called by Expat when it encounters text. Delegates to the same method
- * on the Java parser. This may be called mutiple times with incremental pieces
- * of the same contiguous block of text.
+ * Called by Expat when it encounters text. This may be called mutiple times
+ * with incremental pieces of the same contiguous block of text, so the text
+ * is only buffered here and passed to Java by flushText().
  *
  * @param data parsing context
  * @param characters buffer containing encountered text
  * @param length number of characters in the buffer
  */
 static void text(void* data, const char* characters, int length) {
-    bufferAndInvoke(textMethod, data, characters, length);
+    ParsingContext* parsingContext = toParsingContext(data);
+    parsingContext->pendingText.append(characters, length);
 }
 
 /**
@@ -672,6 +695,7 @@ static void text(void* data, const char* characters, int length) {
  * @param comment 0-terminated
  */
 static void comment(void* data, const char* comment) {
+    flushText(toParsingContext(data));
     bufferAndInvoke(commentMethod, data, comment, strlen(comment));
 }
 
@@ -684,6 +708,7 @@ static void comment(void* data, const char* comment) {
  */
 static void startNamespace(void* data, const char* prefix, const char* uri) {
     ParsingContext* parsingContext = toParsingContext(data);
+    flushText(parsingContext);
     JNIEnv* env = parsingContext->env;
 
     // Bail out if a previously called handler threw an exception.
@@ -716,6 +741,7 @@ static void startNamespace(void* data, const char* prefix, const char* uri) {
  */
 static void endNamespace(void* data, const char* /*prefix*/) {
     ParsingContext* parsingContext = toParsingContext(data);
+    flushText(parsingContext);
     JNIEnv* env = parsingContext->env;
 
     // Bail out if a previously called handler threw an exception.
@@ -734,6 +760,7 @@ static void endNamespace(void* data, const char* /*prefix*/) {
  */
 static void startCdata(void* data) {
     ParsingContext* parsingContext = toParsingContext(data);
+    flushText(parsingContext);
     JNIEnv* env = parsingContext->env;
 
     // Bail out if a previously called handler threw an exception.
@@ -750,6 +777,7 @@ static void startCdata(void* data) {
  */
 static void endCdata(void* data) {
     ParsingContext* parsingContext = toParsingContext(data);
+    flushText(parsingContext);
     JNIEnv* env = parsingContext->env;
 
     // Bail out if a previously called handler threw an exception.
@@ -766,6 +794,7 @@ static void endCdata(void* data) {
 static void startDtd(void* data, const char* name,
         const char* systemId, const char* publicId, int /*hasInternalSubset*/) {
     ParsingContext* parsingContext = toParsingContext(data);
+    flushText(parsingContext);
     JNIEnv* env = parsingContext->env;
 
     // Bail out if a previously called handler threw an exception.
@@ -792,6 +821,7 @@ static void startDtd(void* data, const char* name,
  */
 static void endDtd(void* data) {
     ParsingContext* parsingContext = toParsingContext(data);
+    flushText(parsingContext);
     JNIEnv* env = parsingContext->env;
 
     // Bail out if a previously called handler threw an exception.
@@ -810,6 +840,7 @@ static void endDtd(void* data) {
  */
 static void processingInstruction(void* data, const char* target, const char* instructionData) {
     ParsingContext* parsingContext = toParsingContext(data);
+    flushText(parsingContext);
     JNIEnv* env = parsingContext->env;
 
     // Bail out if a previously called handler threw an exception.
@@ -856,6 +887,7 @@ static jint ExpatParser_createEntityParser(JNIEnv* env, jobject, jint parentPars
 static int handleExternalEntity(XML_Parser parser, const char* context,
         const char*, const char* systemId, const char* publicId) {
     ParsingContext* parsingContext = toParsingContext(parser);
+    flushText(parsingContext);
     jobject javaParser = parsingContext->object;
     JNIEnv* env = parsingContext->env;
     jobject object = parsingContext->object;
@@ -900,6 +932,7 @@ static int handleExternalEntity(XML_Parser parser, const char* context,
  */
 static void unparsedEntityDecl(void* data, const char* name, const char* /*base*/, const char* systemId, const char* publicId, const char* notationName) {
     ParsingContext* parsingContext = toParsingContext(data);
+    flushText(parsingContext);
     jobject javaParser = parsingContext->object;
     JNIEnv* env = parsingContext->env;
 
@@ -923,6 +956,7 @@ static void unparsedEntityDecl(void* data, const char* name, const char* /*base*
  */
 static void notationDecl(void* data, const char* name, const char* /*base*/, const char* systemId, const char* publicId) {
     ParsingContext* parsingContext = toParsingContext(data);
+    flushText(parsingContext);
     jobject javaParser = parsingContext->object;
     JNIEnv* env = parsingContext->env;
 
@@ -1011,6 +1045,8 @@ static void append(JNIEnv* env, jobject object, jint pointer,
     if (!XML_Parse(parser, bytes + byteOffset, byteCount, isFinal) && !env->ExceptionCheck()) {
         jniThrowExpatException(env, XML_GetErrorCode(parser));
     }
+    // Don't hold text back across calls, the caller may never append more.
+    flushText(context);
     context->object = NULL;
     context->env = NULL;
 }
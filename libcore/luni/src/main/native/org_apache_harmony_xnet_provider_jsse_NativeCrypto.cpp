@@ -22,6 +22,7 @@
 
 #include <algorithm>
 #include <fcntl.h>
+#include <pthread.h>
 #include <sys/socket.h>
 #include <unistd.h>
 
@@ -1116,13 +1117,13 @@ static jobjectArray getPrincipalBytes(JNIEnv* env, const STACK_OF(X509_NAME)* na
  * the JNIEnv on calls that can read and write to the SSL such as
  * SSL_do_handshake, SSL_read, SSL_write, and SSL_shutdown.
  *
- * Finally, we have two emphemeral keys setup by OpenSSL callbacks:
+ * Finally, we have an emphemeral key setup by OpenSSL callbacks:
  *
  * (8) a set of ephemeral RSA keys that is lazily generated if a peer
  * wants to use an exportable RSA cipher suite.
  *
- * (9) a set of ephemeral EC keys that is lazily generated if a peer
- * wants to use an TLS_ECDHE_* cipher suite.
+ * The EC parameters for TLS_ECDHE_* cipher suites are not per-SSL,
+ * see tmp_ecdh_callback.
  *
  */
 class AppData {
@@ -1135,7 +1136,6 @@ class AppData {
     jobject sslHandshakeCallbacks;
     jobject fileDescriptor;
     Unique_RSA ephemeralRsa;
-    Unique_EC_KEY ephemeralEc;
 
     /**
      * Creates the application data context for the SSL*.
@@ -1172,8 +1172,7 @@ class AppData {
             waitingThreads(0),
             env(NULL),
             sslHandshakeCallbacks(NULL),
-            ephemeralRsa(NULL),
-            ephemeralEc(NULL) {
+            ephemeralRsa(NULL) {
         fdsEmergency[0] = -1;
         fdsEmergency[1] = -1;
     }
@@ -1587,20 +1586,28 @@ static EC_KEY* ecGenerateKey(int keylength __attribute__ ((unused))) {
     return ec.release();
 }
 
+static EC_KEY* sharedEcKey = NULL;
+
+static void initSharedEcKey() {
+    sharedEcKey = ecGenerateKey(0);
+}
+
 /**
  * Call back to ask for an ephemeral EC key for TLS_ECDHE_* cipher suites
+ *
+ * Because of SSL_OP_SINGLE_ECDH_USE, OpenSSL only takes the curve from
+ * the returned key and generates the actual ephemeral key in a copy, so
+ * one set of parameters is shared by every SSL in the process instead of
+ * setting up the curve again for each handshake.
  */
 static EC_KEY* tmp_ecdh_callback(SSL* ssl __attribute__ ((unused)),
                                  int is_export __attribute__ ((unused)),
-                                 int keylength) {
+                                 int keylength __attribute__ ((unused))) {
     JNI_TRACE("ssl=%p tmp_ecdh_callback is_export=%d keylength=%d", ssl, is_export, keylength);
-    AppData* appData = toAppData(ssl);
-    if (appData->ephemeralEc.get() == NULL) {
-        JNI_TRACE("ssl=%p tmp_ecdh_callback generating ephemeral EC key", ssl);
-        appData->ephemeralEc.reset(ecGenerateKey(keylength));
-    }
-    JNI_TRACE("ssl=%p tmp_ecdh_callback => %p", ssl, appData->ephemeralEc.get());
-    return appData->ephemeralEc.get();
+    static pthread_once_t once = PTHREAD_ONCE_INIT;
+    pthread_once(&once, initSharedEcKey);
+    JNI_TRACE("ssl=%p tmp_ecdh_callback => %p", ssl, sharedEcKey);
+    return sharedEcKey;
 }
 
 /*
@@ -330,6 +330,8 @@ void handle_packet(apacket *p, atransport *t)
             t->connection_state = CS_OFFLINE;
             handle_offline(t);
         }
+        t->max_payload = p->msg.arg1 < MAX_PAYLOAD ? p->msg.arg1 : MAX_PAYLOAD;
+        if(t->max_payload < MAX_PAYLOAD_V1) t->max_payload = MAX_PAYLOAD_V1;
         parse_banner((char*) p->data, t);
         handle_online();
         if(!HOST) send_connect(t);
@@ -21,7 +21,12 @@
 
 #include "transport.h"  /* readx(), writex() */
 
-#define MAX_PAYLOAD 4096
+#define MAX_PAYLOAD 65536
+
+/* the payload size every peer understands; a larger one is only used
+** once the peer has advertised it in its CONNECT message
+*/
+#define MAX_PAYLOAD_V1 4096
 
 #define A_SYNC 0x434e5953
 #define A_CNXN 0x4e584e43
@@ -187,6 +192,9 @@ struct atransport
     char *product;
     int adb_port; // Use for emulators (local transport)
 
+        /* largest payload we may send, negotiated on CONNECT */
+    size_t max_payload;
+
         /* a list of adisconnect callbacks called when the transport is kicked */
     int          kicked;
     adisconnect  disconnects;
@@ -24,7 +24,6 @@
 #include <dirent.h>
 #include <limits.h>
 #include <sys/types.h>
-#include <zipfile/zipfile.h>
 
 #include "sysdeps.h"
 #include "adb.h"
@@ -244,31 +243,6 @@ static int write_data_file(int fd, const char *path, syncsendbuf *sbuf)
     return err;
 }
 
-static int write_data_buffer(int fd, char* file_buffer, int size, syncsendbuf *sbuf)
-{
-    int err = 0;
-    int total = 0;
-
-    sbuf->id = ID_DATA;
-    while (total < size) {
-        int count = size - total;
-        if (count > SYNC_DATA_MAX) {
-            count = SYNC_DATA_MAX;
-        }
-
-        memcpy(sbuf->data, &file_buffer[total], count);
-        sbuf->size = htoll(count);
-        if(writex(fd, sbuf, sizeof(unsigned) * 2 + count)){
-            err = -1;
-            break;
-        }
-        total += count;
-        total_bytes += count;
-    }
-
-    return err;
-}
-
 #ifdef HAVE_SYMLINKS
 static int write_data_link(int fd, const char *path, syncsendbuf *sbuf)
 {
@@ -294,14 +268,128 @@ static int write_data_link(int fd, const char *path, syncsendbuf *sbuf)
 }
 #endif
 
+#define ZIP_EOCD_SIG      0x06054b50
+#define ZIP_EOCD_LEN      22
+#define ZIP_CENTRAL_SIG   0x02014b50
+#define ZIP_CENTRAL_LEN   46
+#define ZIP_COMMENT_MAX   65535
+
+static unsigned zip_u16(const unsigned char *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static unsigned zip_u32(const unsigned char *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned)p[3] << 24);
+}
+
+static int read_at(int lfd, off_t offset, void *buf, int len)
+{
+    if(adb_lseek(lfd, offset, SEEK_SET) != offset) return -1;
+    return readx(lfd, buf, len);
+}
+
+/* sanity check that an APK is a real zip file containing an
+** AndroidManifest.xml. Only the end of central directory record
+** and the central directory are read, so the file itself can be
+** streamed to the device afterwards instead of being buffered.
+*/
+static int verify_apk_file(const char *lpath)
+{
+    unsigned char *buf = NULL;
+    unsigned char *p, *end;
+    unsigned cd_size, cd_offset;
+    int lfd, size, tail, i;
+    int found = 0;
+
+    lfd = adb_open(lpath, O_RDONLY);
+    if(lfd < 0) {
+        fprintf(stderr,"cannot open '%s': %s\n", lpath, strerror(errno));
+        return -1;
+    }
+
+    size = adb_lseek(lfd, 0, SEEK_END);
+    if(size == -1) {
+        fprintf(stderr, "error seeking in file '%s'\n", lpath);
+        goto done;
+    }
+    if(size < ZIP_EOCD_LEN) goto bad_zip;
+
+        /* the record sits at the end, behind a comment of up to 64K */
+    tail = size < ZIP_EOCD_LEN + ZIP_COMMENT_MAX ?
+           size : ZIP_EOCD_LEN + ZIP_COMMENT_MAX;
+    buf = malloc(tail);
+    if(buf == NULL) {
+        fprintf(stderr, "could not allocate buffer for '%s'\n", lpath);
+        goto done;
+    }
+    if(read_at(lfd, size - tail, buf, tail)) {
+        fprintf(stderr, "error reading from file: '%s'\n", lpath);
+        goto done;
+    }
+
+    for(i = tail - ZIP_EOCD_LEN; i >= 0; i--) {
+        if(zip_u32(buf + i) == ZIP_EOCD_SIG) break;
+    }
+    if(i < 0) goto bad_zip;
+
+    cd_size = zip_u32(buf + i + 12);
+    cd_offset = zip_u32(buf + i + 16);
+    if(cd_offset > (unsigned)size || cd_size > (unsigned)size - cd_offset)
+        goto bad_zip;
+
+    free(buf);
+    buf = malloc(cd_size ? cd_size : 1);
+    if(buf == NULL) {
+        fprintf(stderr, "could not allocate buffer for '%s'\n", lpath);
+        goto done;
+    }
+    if(read_at(lfd, cd_offset, buf, cd_size)) {
+        fprintf(stderr, "error reading from file: '%s'\n", lpath);
+        goto done;
+    }
+
+    p = buf;
+    end = buf + cd_size;
+    while(end - p >= ZIP_CENTRAL_LEN && zip_u32(p) == ZIP_CENTRAL_SIG) {
+        unsigned namelen = zip_u16(p + 28);
+        unsigned skip = ZIP_CENTRAL_LEN + namelen +
+                        zip_u16(p + 30) + zip_u16(p + 32);
+
+        if((unsigned)(end - p) < skip) break;
+        if(namelen == strlen("AndroidManifest.xml") &&
+           !memcmp(p + ZIP_CENTRAL_LEN, "AndroidManifest.xml", namelen)) {
+            found = 1;
+            break;
+        }
+        p += skip;
+    }
+
+    if(found) {
+        free(buf);
+        adb_close(lfd);
+        return 0;
+    }
+
+    fprintf(stderr, "file '%s' does not contain AndroidManifest.xml\n",
+            lpath);
+    goto done;
+
+bad_zip:
+    fprintf(stderr, "file '%s' is not a valid zip file\n", lpath);
+done:
+    free(buf);
+    adb_close(lfd);
+    return -1;
+}
+
 static int sync_send(int fd, const char *lpath, const char *rpath,
                      unsigned mtime, mode_t mode, int verifyApk)
 {
     syncmsg msg;
     int len, r;
     syncsendbuf *sbuf = &send_buffer;
-    char* file_buffer = NULL;
-    int size = 0;
     char tmp[64];
 
     len = strlen(rpath);
@@ -310,61 +398,8 @@ static int sync_send(int fd, const char *lpath, const char *rpath,
     snprintf(tmp, sizeof(tmp), ",%d", mode);
     r = strlen(tmp);
 
-    if (verifyApk) {
-        int lfd;
-        zipfile_t zip;
-        zipentry_t entry;
-        int amt;
-
-        // if we are transferring an APK file, then sanity check to make sure
-        // we have a real zip file that contains an AndroidManifest.xml
-        // this requires that we read the entire file into memory.
-        lfd = adb_open(lpath, O_RDONLY);
-        if(lfd < 0) {
-            fprintf(stderr,"cannot open '%s': %s\n", lpath, strerror(errno));
-            return -1;
-        }
-
-        size = adb_lseek(lfd, 0, SEEK_END);
-        if (size == -1 || -1 == adb_lseek(lfd, 0, SEEK_SET)) {
-            fprintf(stderr, "error seeking in file '%s'\n", lpath);
-            adb_close(lfd);
-            return 1;
-        }
-
-        file_buffer = (char *)malloc(size);
-        if (file_buffer == NULL) {
-            fprintf(stderr, "could not allocate buffer for '%s'\n",
-                    lpath);
-            adb_close(lfd);
-            return 1;
-        }
-        amt = adb_read(lfd, file_buffer, size);
-        if (amt != size) {
-            fprintf(stderr, "error reading from file: '%s'\n", lpath);
-            adb_close(lfd);
-            free(file_buffer);
-            return 1;
-        }
-
-        adb_close(lfd);
-
-        zip = init_zipfile(file_buffer, size);
-        if (zip == NULL) {
-            fprintf(stderr, "file '%s' is not a valid zip file\n",
-                    lpath);
-            free(file_buffer);
-            return 1;
-        }
-
-        entry = lookup_zipentry(zip, "AndroidManifest.xml");
-        release_zipfile(zip);
-        if (entry == NULL) {
-            fprintf(stderr, "file '%s' does not contain AndroidManifest.xml\n",
-                    lpath);
-            free(file_buffer);
-            return 1;
-        }
+    if (verifyApk && verify_apk_file(lpath)) {
+        return 1;
     }
 
     msg.req.id = ID_SEND;
@@ -372,14 +407,10 @@ static int sync_send(int fd, const char *lpath, const char *rpath,
 
     if(writex(fd, &msg.req, sizeof(msg.req)) ||
        writex(fd, rpath, len) || writex(fd, tmp, r)) {
-        free(file_buffer);
         goto fail;
     }
 
-    if (file_buffer) {
-        write_data_buffer(fd, file_buffer, size, sbuf);
-        free(file_buffer);
-    } else if (S_ISREG(mode))
+    if (S_ISREG(mode))
         write_data_file(fd, lpath, sbuf);
 #ifdef HAVE_SYMLINKS
     else if (S_ISLNK(mode))
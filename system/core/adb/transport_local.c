@@ -284,6 +284,7 @@ int init_socket_transport(atransport *t, int s, int adb_port, int local)
     t->write_to_remote = remote_write;
     t->sfd = s;
     t->sync_token = 1;
+    t->max_payload = MAX_PAYLOAD_V1;
     t->connection_state = CS_OFFLINE;
     t->type = kTransportLocal;
     t->adb_port = 0;
@@ -94,16 +94,26 @@ int usb_write(usb_handle *h, const void *data, int len)
     return 0;
 }
 
-int usb_read(usb_handle *h, void *data, int len)
+int usb_read(usb_handle *h, void *_data, int len)
 {
+    unsigned char *data = (unsigned char*) _data;
     int n;
 
     D("about to read (fd=%d, len=%d)\n", h->fd, len);
-    n = adb_read(h->fd, data, len);
-    if(n != len) {
-        D("ERROR: fd = %d, n = %d, errno = %d (%s)\n",
-            h->fd, n, errno, strerror(errno));
-        return -1;
+    while(len > 0) {
+            /* the gadget driver completes at most one bulk
+            ** buffer per read, so large payloads take several
+            */
+        int xfer = (len > MAX_PAYLOAD_V1) ? MAX_PAYLOAD_V1 : len;
+
+        n = adb_read(h->fd, data, xfer);
+        if(n <= 0) {
+            D("ERROR: fd = %d, n = %d, errno = %d (%s)\n",
+                h->fd, n, errno, strerror(errno));
+            return -1;
+        }
+        len -= n;
+        data += n;
     }
     D("[ done fd=%d ]\n", h->fd);
     return 0;
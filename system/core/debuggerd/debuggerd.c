@@ -234,11 +234,47 @@ static void parse_elf_info(mapinfo *milist, pid_t pid)
     }
 }
 
-void dump_crash_report(int tfd, unsigned pid, unsigned tid, bool at_fault)
+/*
+ * Read the memory map of pid and the symbols of every ELF file in it. All
+ * threads share one address space, so this is done once per crash rather
+ * than once for every thread that gets dumped.
+ */
+static mapinfo *load_map_info_list(unsigned pid, unsigned tid)
 {
     char data[1024];
     FILE *fp;
     mapinfo *milist = 0;
+
+    sprintf(data, "/proc/%d/maps", pid);
+    fp = fopen(data, "r");
+    if(fp) {
+        while(fgets(data, 1024, fp)) {
+            mapinfo *mi = parse_maps_line(data);
+            if(mi) {
+                mi->next = milist;
+                milist = mi;
+            }
+        }
+        fclose(fp);
+    }
+
+    parse_elf_info(milist, tid);
+    return milist;
+}
+
+static void free_map_info_list(mapinfo *milist)
+{
+    while(milist) {
+        mapinfo *next = milist->next;
+        symbol_table_free(milist->symbols);
+        free(milist);
+        milist = next;
+    }
+}
+
+void dump_crash_report(int tfd, unsigned pid, unsigned tid, bool at_fault,
+                       mapinfo *milist)
+{
     unsigned int sp_list[STACK_CONTENT_DEPTH];
     int stack_depth;
 #ifdef __arm__
@@ -256,21 +292,6 @@ void dump_crash_report(int tfd, unsigned pid, unsigned tid, bool at_fault)
     /* Clear stack pointer records */
     memset(sp_list, 0, sizeof(sp_list));
 
-    sprintf(data, "/proc/%d/maps", pid);
-    fp = fopen(data, "r");
-    if(fp) {
-        while(fgets(data, 1024, fp)) {
-            mapinfo *mi = parse_maps_line(data);
-            if(mi) {
-                mi->next = milist;
-                milist = mi;
-            }
-        }
-        fclose(fp);
-    }
-
-    parse_elf_info(milist, tid);
-
 #if __arm__
     /* If stack unwinder fails, use the default solution to dump the stack
      * content.
@@ -294,13 +315,6 @@ void dump_crash_report(int tfd, unsigned pid, unsigned tid, bool at_fault)
 #else
 #error "Unsupported architecture"
 #endif
-
-    while(milist) {
-        mapinfo *next = milist->next;
-        symbol_table_free(milist->symbols);
-        free(milist);
-        milist = next;
-    }
 }
 
 #define MAX_TOMBSTONES	10
@@ -364,7 +378,8 @@ static int find_and_open_tombstone(void)
 }
 
 /* Return true if some thread is not detached cleanly */
-static bool dump_sibling_thread_report(int tfd, unsigned pid, unsigned tid)
+static bool dump_sibling_thread_report(int tfd, unsigned pid, unsigned tid,
+                                       mapinfo *milist)
 {
     char task_path[1024];
 
@@ -393,7 +408,7 @@ static bool dump_sibling_thread_report(int tfd, unsigned pid, unsigned tid)
         if (ptrace(PTRACE_ATTACH, new_tid, 0, 0) < 0)
             continue;
 
-        dump_crash_report(tfd, pid, new_tid, false);
+        dump_crash_report(tfd, pid, new_tid, false, milist);
         need_cleanup |= ptrace(PTRACE_DETACH, new_tid, 0, 0);
     }
     closedir(d);
@@ -406,6 +421,7 @@ static bool engrave_tombstone(unsigned pid, unsigned tid, int debug_uid,
 {
     int fd;
     bool need_cleanup = false;
+    mapinfo *milist;
 
     mkdir(TOMBSTONE_DIR, 0755);
     chown(TOMBSTONE_DIR, AID_SYSTEM, AID_SYSTEM);
@@ -414,16 +430,19 @@ static bool engrave_tombstone(unsigned pid, unsigned tid, int debug_uid,
     if (fd < 0)
         return need_cleanup;
 
+    milist = load_map_info_list(pid, tid);
+
     dump_crash_banner(fd, pid, tid, signal);
-    dump_crash_report(fd, pid, tid, true);
+    dump_crash_report(fd, pid, tid, true, milist);
     /*
      * If the user has requested to attach gdb, don't collect the per-thread
      * information as it increases the chance to lose track of the process.
      */
     if ((signed)pid > debug_uid) {
-        need_cleanup = dump_sibling_thread_report(fd, pid, tid);
+        need_cleanup = dump_sibling_thread_report(fd, pid, tid, milist);
     }
 
+    free_map_info_list(milist);
     close(fd);
     return need_cleanup;
 }
@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2011 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * A region allocator. Allocations are carved out of large blocks and are
+ * never freed individually; everything goes away at once when the arena
+ * is reset or freed. Suits data that is built up and then discarded
+ * together, like a parsed config file or the state of one request.
+ *
+ * Not thread safe.
+ */
+
+#ifndef __CUTILS_ARENA_H
+#define __CUTILS_ARENA_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdlib.h>
+
+/** An arena. */
+typedef struct Arena Arena;
+
+/**
+ * Constructs a new arena that grabs memory blockSize bytes at a time,
+ * or a default size if blockSize is 0. Returns NULL if we ran out of
+ * memory.
+ */
+Arena* arenaCreate(size_t blockSize);
+
+/** Frees an arena and everything allocated from it. */
+void arenaFree(Arena* arena);
+
+/**
+ * Returns size bytes, aligned for any type, that stay valid until the
+ * arena is reset or freed. Returns NULL if we ran out of memory.
+ */
+void* arenaAlloc(Arena* arena, size_t size);
+
+/** Like arenaAlloc(), but the memory is zeroed. */
+void* arenaCalloc(Arena* arena, size_t size);
+
+/** Copies a string into the arena. Returns NULL if we ran out of memory. */
+char* arenaStrdup(Arena* arena, const char* str);
+
+/**
+ * Releases everything allocated from the arena at once. The first block
+ * is kept so that a reused arena does not go back to malloc.
+ */
+void arenaReset(Arena* arena);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __CUTILS_ARENA_H */
@@ -31,11 +31,14 @@ __BEGIN_DECLS
  */
 
 /* request to open a direct output with get_output() (by opposition to
- * sharing an output with other AudioTracks)
+ * sharing an output with other AudioTracks). AUDIO_POLICY_OUTPUT_FLAG_FAST
+ * does not change the output selection: it asks the mixer for a low latency
+ * track, which falls back to a normal track if it cannot be granted.
  */
 typedef enum {
     AUDIO_POLICY_OUTPUT_FLAG_INDIRECT = 0x0,
-    AUDIO_POLICY_OUTPUT_FLAG_DIRECT = 0x1
+    AUDIO_POLICY_OUTPUT_FLAG_DIRECT = 0x1,
+    AUDIO_POLICY_OUTPUT_FLAG_FAST = 0x2
 } audio_policy_output_flags_t;
 
 /* device categories used for audio_policy->set_force_use() */
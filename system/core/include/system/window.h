@@ -211,6 +211,16 @@ enum {
      *
      */
     NATIVE_WINDOW_TRANSFORM_HINT = 8,
+
+    /*
+     * The age of the contents of the most recently dequeued buffer, in
+     * frames: 1 means it holds the frame queued just before the current
+     * one, 2 the frame before that, and so on.  0 means the contents are
+     * undefined (e.g. the buffer was just allocated) and the whole buffer
+     * must be redrawn.  A producer that tracks its own damage can use this
+     * to redraw only what changed in the last 'age' frames.
+     */
+    NATIVE_WINDOW_BUFFER_AGE = 9,
 };
 
 /* valid operations for the (*perform)() hook */
@@ -766,11 +766,17 @@ void handle_device_fd()
 ** to cause the kernel to regenerate device add events that happened
 ** before init's device manager was started
 **
-** We drain any pending events from the netlink socket every time
-** we poke another uevent file to make sure we don't overrun the
-** socket's buffer.  
+** We drain the pending events from the netlink socket after every
+** COLDBOOT_BATCH uevent files we poke, rather than after each one,
+** which saves a recvmsg() that would find the socket empty per device.
+** A batch of events is far smaller than the socket's buffer, so it
+** can't be overrun.
 */
 
+#define COLDBOOT_BATCH  32
+
+static int coldboot_pending;
+
 static void do_coldboot(DIR *d)
 {
     struct dirent *de;
@@ -782,7 +788,10 @@ static void do_coldboot(DIR *d)
     if(fd >= 0) {
         write(fd, "add\n", 4);
         close(fd);
-        handle_device_fd();
+        if (++coldboot_pending >= COLDBOOT_BATCH) {
+            handle_device_fd();
+            coldboot_pending = 0;
+        }
     }
 
     while((de = readdir(d))) {
@@ -812,6 +821,10 @@ static void coldboot(const char *path)
         do_coldboot(d);
         closedir(d);
     }
+
+    /* handle the events of the last, partial batch */
+    handle_device_fd();
+    coldboot_pending = 0;
 }
 
 void device_init(void)
@@ -820,8 +833,8 @@ void device_init(void)
     struct stat info;
     int fd;
 
-    /* is 64K enough? udev uses 16MB! */
-    device_fd = uevent_open_socket(64*1024, true);
+    /* is 256K enough? udev uses 16MB! */
+    device_fd = uevent_open_socket(256*1024, true);
     if(device_fd < 0)
         return;
 
@@ -25,6 +25,7 @@
 #include <limits.h>
 #include <errno.h>
 
+#include <cutils/atomic.h>
 #include <cutils/misc.h>
 #include <cutils/sockets.h>
 
@@ -145,12 +146,16 @@ out:
     return -1;
 }
 
-/* (8 header words + 247 toc words) = 1020 bytes */
-/* 1024 bytes header and toc + 247 prop_infos @ 128 bytes = 32640 bytes */
+/* 8 header words + 480 toc words + 480 chain links + 256 hash buckets
+ * = 3936 bytes, 4096 bytes header and index + 480 prop_infos @ 128 bytes
+ * = 65536 bytes */
 
-#define PA_COUNT_MAX  247
-#define PA_INFO_START 1024
-#define PA_SIZE       32768
+#define PA_COUNT_MAX    480
+#define PA_HASH_BUCKETS 256
+#define PA_CHAIN_START  (8 * 4 + PA_COUNT_MAX * 4)
+#define PA_HASH_START   (PA_CHAIN_START + PA_COUNT_MAX * 2)
+#define PA_INFO_START   4096
+#define PA_SIZE         65536
 
 static workspace pa_workspace;
 static prop_info *pa_info_array;
@@ -175,6 +180,9 @@ static int init_property_area(void)
     memset(pa, 0, PA_SIZE);
     pa->magic = PROP_AREA_MAGIC;
     pa->version = PROP_AREA_VERSION;
+    pa->hash_buckets = PA_HASH_BUCKETS;
+    pa->hash_offset = PA_HASH_START;
+    pa->chain_offset = PA_CHAIN_START;
 
         /* plug into the lib property services */
     __system_property_area__ = pa;
@@ -281,6 +289,7 @@ int property_set(const char *name, const char *value)
 {
     prop_area *pa;
     prop_info *pi;
+    unsigned bucket;
 
     int namelen = strlen(name);
     int valuelen = strlen(value);
@@ -311,7 +320,15 @@ int property_set(const char *name, const char *value)
         pa->toc[pa->count] =
             (namelen << 24) | (((unsigned) pi) - ((unsigned) pa));
 
-        pa->count++;
+        /* publish the entry at the head of its bucket, readers may
+         * be walking the chain concurrently */
+        bucket = prop_name_hash(name, namelen) & (PA_HASH_BUCKETS - 1);
+        PROP_HASH_CHAIN(pa)[pa->count] = PROP_HASH_TABLE(pa)[bucket];
+        android_atomic_release_store(pa->count + 1,
+                (volatile int32_t*) &PROP_HASH_TABLE(pa)[bucket]);
+
+        android_atomic_release_store(pa->count + 1,
+                (volatile int32_t*) &pa->count);
         pa->serial++;
         __futex_wake(&pa->serial, INT32_MAX);
     }
@@ -24,6 +24,7 @@ endif
 hostSmpFlag := -DANDROID_SMP=0
 
 commonSources := \
+	arena.c \
 	array.c \
 	hashmap.c \
 	atomic.c.arm \
@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) 2011 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cutils/arena.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DEFAULT_BLOCK_SIZE (4096)
+#define ALIGNMENT          (8)
+
+typedef struct Block Block;
+struct Block {
+    Block* next;
+    size_t size;
+    size_t used;
+    // Keeps data[] aligned on 32-bit targets.
+    size_t pad;
+    char data[];
+};
+
+struct Arena {
+    Block* blocks;
+    size_t blockSize;
+};
+
+static Block* createBlock(size_t size) {
+    Block* block = malloc(sizeof(Block) + size);
+    if (block == NULL) {
+        return NULL;
+    }
+    block->next = NULL;
+    block->size = size;
+    block->used = 0;
+    return block;
+}
+
+Arena* arenaCreate(size_t blockSize) {
+    Arena* arena = malloc(sizeof(Arena));
+    if (arena == NULL) {
+        return NULL;
+    }
+    arena->blockSize = blockSize ? blockSize : DEFAULT_BLOCK_SIZE;
+    arena->blocks = NULL;
+    return arena;
+}
+
+static void freeBlocks(Block* block) {
+    while (block != NULL) {
+        Block* next = block->next;
+        free(block);
+        block = next;
+    }
+}
+
+void arenaFree(Arena* arena) {
+    assert(arena != NULL);
+
+    freeBlocks(arena->blocks);
+    free(arena);
+}
+
+void* arenaAlloc(Arena* arena, size_t size) {
+    assert(arena != NULL);
+
+    size = (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+    if (size == 0) {
+        size = ALIGNMENT;
+    }
+
+    Block* block = arena->blocks;
+    if (block == NULL || block->size - block->used < size) {
+        // Oversized requests get a block of their own, which goes behind
+        // the current one so that its free space is not wasted.
+        size_t blockSize = size > arena->blockSize ? size : arena->blockSize;
+        Block* newBlock = createBlock(blockSize);
+        if (newBlock == NULL) {
+            return NULL;
+        }
+        if (block != NULL && blockSize > arena->blockSize) {
+            newBlock->next = block->next;
+            block->next = newBlock;
+        } else {
+            newBlock->next = block;
+            arena->blocks = newBlock;
+        }
+        block = newBlock;
+    }
+
+    void* p = block->data + block->used;
+    block->used += size;
+    return p;
+}
+
+void* arenaCalloc(Arena* arena, size_t size) {
+    void* p = arenaAlloc(arena, size);
+    if (p != NULL) {
+        memset(p, 0, size);
+    }
+    return p;
+}
+
+char* arenaStrdup(Arena* arena, const char* str) {
+    size_t len = strlen(str) + 1;
+    char* copy = arenaAlloc(arena, len);
+    if (copy != NULL) {
+        memcpy(copy, str, len);
+    }
+    return copy;
+}
+
+void arenaReset(Arena* arena) {
+    assert(arena != NULL);
+
+    Block* block = arena->blocks;
+    if (block == NULL) {
+        return;
+    }
+    freeBlocks(block->next);
+    block->next = NULL;
+    block->used = 0;
+}
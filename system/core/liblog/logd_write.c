@@ -24,6 +24,10 @@
 #include <string.h>
 #include <stdlib.h>
 #include <stdarg.h>
+#include <time.h>
+#if !FAKE_LOG_DEVICE
+#include <sys/system_properties.h>
+#endif
 
 #include <cutils/logger.h>
 #include <cutils/logd.h>
@@ -31,6 +35,14 @@
 
 #define LOG_BUF_SIZE	1024
 
+/* name of the system property holding the maximum number of lines a
+ * process may log per second under a single tag, 0 or unset for no limit */
+#define LOG_RATE_PROP_NAME  "log.tag_rate_limit"
+
+/* number of tags tracked by the rate limiter, tags hashing to the same
+ * slot share their budget */
+#define LOG_RATE_SLOTS      64
+
 #if FAKE_LOG_DEVICE
 // This will be defined when building for the host.
 #define log_open(pathname, flags) fakeLogOpen(pathname, flags)
@@ -130,10 +142,109 @@ static int __write_to_log_init(log_id_t log_id, struct iovec *vec, size_t nr)
     return write_to_log(log_id, vec, nr);
 }
 
+/*
+ * Per-tag rate limiting, so that a chatty component can't flood the log
+ * device and push out everybody else's messages.  Each tag hashes to a
+ * slot counting the lines logged during the current second; lines
+ * beyond the limit are dropped, and the number dropped is reported
+ * under the same tag once the tag logs again in a later second.
+ */
+struct log_rate_slot {
+    time_t second;
+    unsigned count;
+    unsigned dropped;
+};
+
+static struct log_rate_slot log_rate_slots[LOG_RATE_SLOTS];
+static int log_rate_limit = -1;
+#ifdef HAVE_PTHREADS
+static pthread_mutex_t log_rate_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+static int __log_rate_get_limit(void)
+{
+    if (log_rate_limit < 0) {
+        int limit = 0;
+#if !FAKE_LOG_DEVICE
+        char value[PROP_VALUE_MAX];
+
+        if (__system_property_get(LOG_RATE_PROP_NAME, value) > 0)
+            limit = atoi(value);
+#endif
+        log_rate_limit = limit > 0 ? limit : 0;
+    }
+    return log_rate_limit;
+}
+
+/*
+ * Returns 1 if a line under this tag may be written now.  If lines were
+ * dropped in an earlier second, *dropped is set to their count so that
+ * the caller can report them.
+ */
+static int __log_rate_check(const char *tag, unsigned *dropped)
+{
+    struct log_rate_slot *slot;
+    struct timespec now;
+    unsigned hash = 2166136261u;
+    const char *p;
+    int allowed = 1;
+    int limit = __log_rate_get_limit();
+
+    *dropped = 0;
+    if (limit == 0)
+        return 1;
+
+    for (p = tag; *p; p++)
+        hash = (hash ^ (unsigned char)*p) * 16777619u;
+    slot = &log_rate_slots[hash % LOG_RATE_SLOTS];
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+#ifdef HAVE_PTHREADS
+    pthread_mutex_lock(&log_rate_lock);
+#endif
+    if (slot->second != now.tv_sec) {
+        slot->second = now.tv_sec;
+        slot->count = 0;
+        *dropped = slot->dropped;
+        slot->dropped = 0;
+    }
+    if (slot->count < (unsigned)limit) {
+        slot->count++;
+    } else {
+        slot->dropped++;
+        allowed = 0;
+    }
+#ifdef HAVE_PTHREADS
+    pthread_mutex_unlock(&log_rate_lock);
+#endif
+
+    return allowed;
+}
+
+static void __log_rate_report(log_id_t log_id, int prio, const char *tag,
+                              unsigned dropped)
+{
+    struct iovec vec[3];
+    char msg[64];
+
+    snprintf(msg, sizeof(msg), "%u lines suppressed by rate limit", dropped);
+
+    vec[0].iov_base   = (unsigned char *) &prio;
+    vec[0].iov_len    = 1;
+    vec[1].iov_base   = (void *) tag;
+    vec[1].iov_len    = strlen(tag) + 1;
+    vec[2].iov_base   = (void *) msg;
+    vec[2].iov_len    = strlen(msg) + 1;
+
+    write_to_log(log_id, vec, 3);
+}
+
 int __android_log_write(int prio, const char *tag, const char *msg)
 {
     struct iovec vec[3];
     log_id_t log_id = LOG_ID_MAIN;
+    unsigned dropped;
 
     if (!tag)
         tag = "";
@@ -149,6 +260,11 @@ int __android_log_write(int prio, const char *tag, const char *msg)
         !strcmp(tag, "SMS"))
             log_id = LOG_ID_RADIO;
 
+    if (!__log_rate_check(tag, &dropped))
+        return 0;
+    if (dropped)
+        __log_rate_report(log_id, prio, tag, dropped);
+
     vec[0].iov_base   = (unsigned char *) &prio;
     vec[0].iov_len    = 1;
     vec[1].iov_base   = (void *) tag;
@@ -162,6 +278,7 @@ int __android_log_write(int prio, const char *tag, const char *msg)
 int __android_log_buf_write(int bufID, int prio, const char *tag, const char *msg)
 {
     struct iovec vec[3];
+    unsigned dropped;
 
     if (!tag)
         tag = "";
@@ -177,6 +294,11 @@ int __android_log_buf_write(int bufID, int prio, const char *tag, const char *ms
         !strcmp(tag, "SMS"))
             bufID = LOG_ID_RADIO;
 
+    if (!__log_rate_check(tag, &dropped))
+        return 0;
+    if (dropped)
+        __log_rate_report(bufID, prio, tag, dropped);
+
     vec[0].iov_base   = (unsigned char *) &prio;
     vec[0].iov_len    = 1;
     vec[1].iov_base   = (void *) tag;
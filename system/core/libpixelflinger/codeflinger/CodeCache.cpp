@@ -105,7 +105,8 @@ void Assembly::ensureMbaseExecutable()
 // ----------------------------------------------------------------------------
 
 CodeCache::CodeCache(size_t size)
-    : mCacheSize(size), mCacheInUse(0)
+    : mWhen(0), mCacheSize(size), mCacheInUse(0),
+      mHits(0), mMisses(0), mEvictions(0)
 {
     pthread_mutex_init(&mLock, 0);
 }
@@ -124,6 +125,9 @@ sp<Assembly> CodeCache::lookup(const AssemblyKeyBase& keyBase) const
         const cache_entry_t& e = mCacheData.valueAt(index);
         e.when = mWhen++;
         r = e.entry;
+        mHits++;
+    } else {
+        mMisses++;
     }
     pthread_mutex_unlock(&mLock);
     return r;
@@ -139,6 +143,10 @@ int CodeCache::cache(  const AssemblyKeyBase& keyBase,
         // evict the LRU
         size_t lru = 0;
         size_t count = mCacheData.size();
+        if (count == 0) {
+            // larger than the whole cache, keep it anyway
+            break;
+        }
         for (size_t i=0 ; i<count ; i++) {
             const cache_entry_t& e = mCacheData.valueAt(i);
             if (e.when < mCacheData.valueAt(lru).when) {
@@ -148,6 +156,9 @@ int CodeCache::cache(  const AssemblyKeyBase& keyBase,
         const cache_entry_t& e = mCacheData.valueAt(lru);
         mCacheInUse -= e.entry->size();
         mCacheData.removeItemsAt(lru);
+        mEvictions++;
+        LOGD("CodeCache: evicted a pipeline (%u hits, %u misses, %u evictions)",
+                mHits, mMisses, mEvictions);
     }
 
     ssize_t err = mCacheData.add(key_t(keyBase), cache_entry_t(assembly, mWhen));
@@ -114,6 +114,9 @@ private:
     mutable int64_t                     mWhen;
     size_t                              mCacheSize;
     size_t                              mCacheInUse;
+    mutable uint32_t                    mHits;
+    mutable uint32_t                    mMisses;
+    uint32_t                            mEvictions;
     KeyedVector<key_t, cache_entry_t>   mCacheData;
 
     friend int compare_type(
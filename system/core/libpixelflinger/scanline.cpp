@@ -262,7 +262,7 @@ static  const needs_filter_t fill16noblend = {
 // ----------------------------------------------------------------------------
 
 #if ANDROID_ARM_CODEGEN
-static CodeCache gCodeCache(12 * 1024);
+static CodeCache gCodeCache(32 * 1024);
 
 class ScanlineAssembly : public Assembly {
     AssemblyKey<needs_t> mKey;
@@ -92,20 +92,51 @@ static u32 crc32_tab[] = {
 };
 
 /*
- * A function that calculates the CRC-32 based on the table above is
- * given below for documentation purposes. An equivalent implementation
- * of this function that's actually used in the kernel can be found
- * in sys/libkern.h, where it can be inlined.
+ * crc32_tab_n[k][i] is the CRC of byte i followed by k + 1 zero bytes,
+ * which lets the loop below fold in four bytes per iteration
+ * ("slicing by 4") instead of one. Built from crc32_tab on first use.
  */
+static u32 crc32_tab_n[3][256];
+static int crc32_tab_n_ready;
+
+static void crc32_init_tables(void)
+{
+        u32 c;
+        int i, k;
+
+        for (i = 0; i < 256; i++) {
+                c = crc32_tab[i];
+                for (k = 0; k < 3; k++) {
+                        c = crc32_tab[c & 0xFF] ^ (c >> 8);
+                        crc32_tab_n[k][i] = c;
+                }
+        }
+        crc32_tab_n_ready = 1;
+}
 
 u32 sparse_crc32(u32 crc_in, const void *buf, int size)
 {
         const u8 *p = buf;
         u32 crc;
 
+        if (!crc32_tab_n_ready)
+                crc32_init_tables();
+
         crc = crc_in ^ ~0U;
+        while (size && ((unsigned long)p & 3)) {
+                crc = crc32_tab[(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+                size--;
+        }
+        while (size >= 4) {
+                crc ^= p[0] | (p[1] << 8) | (p[2] << 16) | ((u32)p[3] << 24);
+                crc = crc32_tab_n[2][crc & 0xFF] ^
+                      crc32_tab_n[1][(crc >> 8) & 0xFF] ^
+                      crc32_tab_n[0][(crc >> 16) & 0xFF] ^
+                      crc32_tab[crc >> 24];
+                p += 4;
+                size -= 4;
+        }
         while (size--)
                 crc = crc32_tab[(crc ^ *p++) & 0xFF] ^ (crc >> 8);
         return crc ^ ~0U;
 }
-